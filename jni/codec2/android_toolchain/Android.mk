@@ -42,6 +42,8 @@ LOCAL_SRC_FILES += $(PJ_CODEC2_PATH)/pj_codec2.c
 
 
 LOCAL_CFLAGS := $(MY_PJSIP_FLAGS)
+# Shared DSP kernels from pjmedia
+LOCAL_CFLAGS += -DCODEC2_HAVE_PJMEDIA_DSP
 LOCAL_SHARED_LIBRARIES += libpjsipjni
 
 LOCAL_STATIC_LIBRARIES += libgcc
@@ -35,11 +35,36 @@
 #define PLC_DISABLED	0
 #define THIS_FILE       "codec2.c"
 
-#define BITS_SIZE	((CODEC2_BITS_PER_FRAME + 7) / 8)
-
 #include <codec2.h>
 #include <pj_codec2.h>
 
+/*
+ * Codec2 modes, negotiated with the "mode" fmtp parameter whose value is
+ * the bit rate. Only modes with 20 ms frames can be listed since the
+ * frame ptime is fixed once the stream is created. The bundled codec2
+ * library only implements the 2500 bit/s mode.
+ */
+struct codec2_mode
+{
+    unsigned	bitrate;		/* Bit rate and fmtp mode value.    */
+    unsigned	samples_per_frame;	/* Samples per frame.		    */
+    unsigned	bytes_per_frame;	/* Size of one frame in payload.    */
+};
+
+static const struct codec2_mode codec2_modes[] =
+{
+    { 2500, CODEC2_SAMPLES_PER_FRAME, (CODEC2_BITS_PER_FRAME + 7) / 8 },
+};
+
+#define DEFAULT_MODE	(&codec2_modes[0])
+
+/* Frames per packet by default. With a 7 bytes frame the 40 bytes of
+ * IP/UDP/RTP header dominate, so pack two frames per packet.
+ */
+#define DEFAULT_FRAMES_PER_PACKET   2
+
+static const pj_str_t STR_MODE = { "mode", 4 };
+
 /* Prototypes for factory */
 static pj_status_t codec2_test_alloc( pjmedia_codec_factory *factory,
 				   const pjmedia_codec_info *id );
@@ -128,6 +153,8 @@ struct codec2_data
 {
     void	*encoder;
     void	*decoder;
+    const struct codec2_mode *enc_mode;
+    const struct codec2_mode *dec_mode;
     pj_bool_t		 plc_enabled;
     pj_bool_t		 vad_enabled;
 #if !PLC_DISABLED
@@ -139,6 +166,31 @@ struct codec2_data
 
 
 
+/*
+ * Get the mode in the fmtp, or the default mode if the fmtp has no mode.
+ * Returns NULL if the mode is not supported.
+ */
+static const struct codec2_mode* get_fmtp_mode(const pjmedia_codec_fmtp *fmtp)
+{
+    unsigned i, bitrate;
+
+    for (i = 0; i < fmtp->cnt; ++i) {
+	if (pj_stricmp(&fmtp->param[i].name, &STR_MODE) == 0)
+	    break;
+    }
+    if (i == fmtp->cnt)
+	return DEFAULT_MODE;
+
+    bitrate = (unsigned)pj_strtoul(&fmtp->param[i].val);
+    for (i = 0; i < PJ_ARRAY_SIZE(codec2_modes); ++i) {
+	if (codec2_modes[i].bitrate == bitrate)
+	    return &codec2_modes[i];
+    }
+
+    PJ_LOG(4, (THIS_FILE, "Unsupported codec2 mode %u", bitrate));
+    return NULL;
+}
+
 /*
  * Initialize and register GSM codec factory to pjmedia endpoint.
  */
@@ -256,13 +308,16 @@ static pj_status_t codec2_default_attr (pjmedia_codec_factory *factory,
     pj_bzero(attr, sizeof(pjmedia_codec_param));
     attr->info.clock_rate = 8000;
     attr->info.channel_cnt = 1;
-    attr->info.avg_bps = 2550;
-    attr->info.max_bps = 2550;
+    attr->info.avg_bps = DEFAULT_MODE->bitrate;
+    attr->info.max_bps = DEFAULT_MODE->bitrate;
     attr->info.pcm_bits_per_sample = 16;
     attr->info.frm_ptime = 20;
     attr->info.pt = PJMEDIA_RTP_PT_CODEC2;
 
-    attr->setting.frm_per_pkt = 1;
+    attr->setting.frm_per_pkt = DEFAULT_FRAMES_PER_PACKET;
+    attr->setting.dec_fmtp.cnt = 1;
+    attr->setting.dec_fmtp.param[0].name = STR_MODE;
+    attr->setting.dec_fmtp.param[0].val = pj_str("2500");
     attr->setting.vad = 1;
 #if !PLC_DISABLED
     attr->setting.plc = 1;
@@ -403,7 +458,18 @@ static pj_status_t codec2_codec_open( pjmedia_codec *codec,
     pj_assert(codec2_data != NULL);
     pj_assert(codec2_data->encoder == NULL && codec2_data->decoder == NULL);
 
-    PJ_LOG(4, (THIS_FILE, "codec2 open !! "));
+    /* Encode in the mode the remote wants to receive */
+    codec2_data->enc_mode = get_fmtp_mode(&attr->setting.enc_fmtp);
+    codec2_data->dec_mode = get_fmtp_mode(&attr->setting.dec_fmtp);
+    if (!codec2_data->enc_mode || !codec2_data->dec_mode)
+	return PJMEDIA_CODEC_EUNSUP;
+
+    PJ_LOG(4, (THIS_FILE, "codec2 open, encoder %u bps, decoder %u bps",
+	       codec2_data->enc_mode->bitrate,
+	       codec2_data->dec_mode->bitrate));
+
+    attr->info.avg_bps = codec2_data->enc_mode->bitrate;
+    attr->info.max_bps = codec2_data->enc_mode->bitrate;
 
     codec2_data->encoder = codec2_create();
     if (!codec2_data->encoder)
@@ -442,16 +508,44 @@ static pj_status_t codec2_codec_close( pjmedia_codec *codec )
 
 
 /*
- * Modify codec settings.
+ * Modify codec settings. The mode can be changed here for bandwidth
+ * adaptation, the codec state is reset when the mode changes.
  */
 static pj_status_t  codec2_codec_modify(pjmedia_codec *codec,
 				     const pjmedia_codec_param *attr )
 {
     struct codec2_data *codec2_data = (struct codec2_data*) codec->codec_data;
+    const struct codec2_mode *enc_mode, *dec_mode;
 
     pj_assert(codec2_data != NULL);
     pj_assert(codec2_data->encoder != NULL && codec2_data->decoder != NULL);
 
+    enc_mode = get_fmtp_mode(&attr->setting.enc_fmtp);
+    dec_mode = get_fmtp_mode(&attr->setting.dec_fmtp);
+    if (!enc_mode || !dec_mode)
+	return PJMEDIA_CODEC_EUNSUP;
+
+    if (enc_mode != codec2_data->enc_mode) {
+	void *encoder = codec2_create();
+	if (!encoder)
+	    return PJMEDIA_CODEC_EFAILED;
+	codec2_destroy(codec2_data->encoder);
+	codec2_data->encoder = encoder;
+	codec2_data->enc_mode = enc_mode;
+	PJ_LOG(4, (THIS_FILE, "codec2 encoder switched to %u bps",
+		   enc_mode->bitrate));
+    }
+    if (dec_mode != codec2_data->dec_mode) {
+	void *decoder = codec2_create();
+	if (!decoder)
+	    return PJMEDIA_CODEC_EFAILED;
+	codec2_destroy(codec2_data->decoder);
+	codec2_data->decoder = decoder;
+	codec2_data->dec_mode = dec_mode;
+	PJ_LOG(4, (THIS_FILE, "codec2 decoder switched to %u bps",
+		   dec_mode->bitrate));
+    }
+
     codec2_data->vad_enabled = (attr->setting.vad != 0);
     codec2_data->plc_enabled = (attr->setting.plc != 0);
 
@@ -469,26 +563,31 @@ static pj_status_t  codec2_codec_parse( pjmedia_codec *codec,
 				     unsigned *frame_cnt,
 				     pjmedia_frame frames[])
 {
+    struct codec2_data *codec2_data = (struct codec2_data*) codec->codec_data;
+    const struct codec2_mode *mode = codec2_data->dec_mode;
     unsigned count = 0;
 
-    PJ_UNUSED_ARG(codec);
-
     PJ_ASSERT_RETURN(frame_cnt, PJ_EINVAL);
 
-  //  PJ_LOG(4, (THIS_FILE, "codec2 parse %d", pkt_size));
-
-    while (pkt_size >= BITS_SIZE && count < *frame_cnt) {
+    /* The packet carries any number of frames of the decoder mode */
+    while (pkt_size >= mode->bytes_per_frame && count < *frame_cnt) {
 	frames[count].type = PJMEDIA_FRAME_TYPE_AUDIO;
 	frames[count].buf = pkt;
-	frames[count].size = BITS_SIZE;
-	frames[count].timestamp.u64 = ts->u64 + count * CODEC2_SAMPLES_PER_FRAME;
+	frames[count].size = mode->bytes_per_frame;
+	frames[count].timestamp.u64 = ts->u64 + 
+				      count * mode->samples_per_frame;
 
-	pkt = ((char*)pkt) + BITS_SIZE;
-	pkt_size -= BITS_SIZE;
+	pkt = ((char*)pkt) + mode->bytes_per_frame;
+	pkt_size -= mode->bytes_per_frame;
 
 	++count;
     }
-  //  PJ_LOG(4, (THIS_FILE, "Found : %d", count));
+
+    if (pkt_size && count < *frame_cnt) {
+	PJ_LOG(5, (THIS_FILE, "codec2 ignored %u trailing bytes",
+		   (unsigned)pkt_size));
+    }
+
     *frame_cnt = count;
     return PJ_SUCCESS;
 }
@@ -502,19 +601,22 @@ static pj_status_t codec2_codec_encode( pjmedia_codec *codec,
 				     struct pjmedia_frame *output)
 {
     struct codec2_data *codec2_data = (struct codec2_data*) codec->codec_data;
+    const struct codec2_mode *mode;
     pj_int16_t *pcm_in;
-    unsigned in_size;
+    unsigned in_size, pcm_frame_size;
 
-  //  PJ_LOG(4, (THIS_FILE, "codec2 encode ...."));
     pj_assert(codec2_data && input && output);
     
+    mode = codec2_data->enc_mode;
+    pcm_frame_size = mode->samples_per_frame * 2;
     pcm_in = (pj_int16_t*)input->buf;
     in_size = input->size;
-  //  PJ_LOG(4, (THIS_FILE, "codec2 encode %d ", input->size));
 
-    PJ_ASSERT_RETURN(in_size % (CODEC2_SAMPLES_PER_FRAME*2) == 0, PJMEDIA_CODEC_EPCMFRMINLEN);
-    //PJ_ASSERT_RETURN(output_buf_len >= BYTES_PER_FRAME * in_size/(CODEC2_SAMPLES_PER_FRAME*2),
-	//	     PJMEDIA_CODEC_EFRMTOOSHORT);
+    PJ_ASSERT_RETURN(in_size % pcm_frame_size == 0, 
+		     PJMEDIA_CODEC_EPCMFRMINLEN);
+    PJ_ASSERT_RETURN(output_buf_len >= mode->bytes_per_frame * 
+					in_size / pcm_frame_size,
+		     PJMEDIA_CODEC_EFRMTOOSHORT);
 
     /* Detect silence */
     if (codec2_data->vad_enabled) {
@@ -541,18 +643,16 @@ static pj_status_t codec2_codec_encode( pjmedia_codec *codec,
 		codec2_data->last_tx = input->timestamp;
 	}
     }
-    /* Encode */
+    /* Encode, frames are concatenated in the packet */
     output->size = 0;
-  //  PJ_LOG(4, (THIS_FILE, "codec2 encoding.... ", input->size));
-    while (in_size >= (CODEC2_SAMPLES_PER_FRAME*2)) {
-    codec2_encode(codec2_data->encoder,
-    		(void *) output->buf + output->size, /* Encoded */
-    		(void *) pcm_in /* Decoded */);
-	output->size += BITS_SIZE;
-	pcm_in += CODEC2_SAMPLES_PER_FRAME;
-	in_size -= (CODEC2_SAMPLES_PER_FRAME*2);
+    while (in_size >= pcm_frame_size) {
+	codec2_encode(codec2_data->encoder,
+		      (unsigned char*)output->buf + output->size,
+		      pcm_in);
+	output->size += mode->bytes_per_frame;
+	pcm_in += mode->samples_per_frame;
+	in_size -= pcm_frame_size;
     }
-  //  PJ_LOG(4, (THIS_FILE, "codec2 encoded.... %d", output->size));
 
     output->type = PJMEDIA_FRAME_TYPE_AUDIO;
     output->timestamp = input->timestamp;
@@ -569,30 +669,49 @@ static pj_status_t codec2_codec_decode( pjmedia_codec *codec,
 				     struct pjmedia_frame *output)
 {
     struct codec2_data *codec2_data = (struct codec2_data*) codec->codec_data;
+    const struct codec2_mode *mode;
+    const unsigned char *bits;
+    pj_int16_t *pcm_out;
+    unsigned in_size, pcm_frame_size;
 
     pj_assert(codec2_data != NULL);
     PJ_ASSERT_RETURN(input && output, PJ_EINVAL);
-  //  PJ_LOG(4, (THIS_FILE, "codec2 decode %d ", input->size));
 
-    if (output_buf_len < (CODEC2_SAMPLES_PER_FRAME*2))
+    mode = codec2_data->dec_mode;
+    pcm_frame_size = mode->samples_per_frame * 2;
+
+    if (output_buf_len < pcm_frame_size)
 	return PJMEDIA_CODEC_EPCMTOOSHORT;
 
-    if (input->size < BITS_SIZE)
+    if (input->size < mode->bytes_per_frame)
 	return PJMEDIA_CODEC_EFRMTOOSHORT;
 
-    codec2_decode(codec2_data->decoder,
-    	  (short int *)output->buf,
- 	      (const unsigned char *)input->buf);
-
-    output->size = (CODEC2_SAMPLES_PER_FRAME*2);
-    output->type = PJMEDIA_FRAME_TYPE_AUDIO;
-    output->timestamp = input->timestamp;
+    /* Normally the frames have been split by parse(), but decode all
+     * frames that fit in the output buffer if given a whole payload.
+     */
+    bits = (const unsigned char*)input->buf;
+    in_size = input->size;
+    pcm_out = (pj_int16_t*)output->buf;
+    output->size = 0;
+    while (in_size >= mode->bytes_per_frame &&
+	   output->size + pcm_frame_size <= output_buf_len)
+    {
+	codec2_decode(codec2_data->decoder, pcm_out, bits);
 
 #if !PLC_DISABLED
-    if (codec2_data->plc_enabled)
-	pjmedia_plc_save( codec2_data->plc, (pj_int16_t*)output->buf);
+	if (codec2_data->plc_enabled)
+	    pjmedia_plc_save( codec2_data->plc, pcm_out);
 #endif
 
+	bits += mode->bytes_per_frame;
+	in_size -= mode->bytes_per_frame;
+	pcm_out += mode->samples_per_frame;
+	output->size += pcm_frame_size;
+    }
+
+    output->type = PJMEDIA_FRAME_TYPE_AUDIO;
+    output->timestamp = input->timestamp;
+
     return PJ_SUCCESS;
 }
 
@@ -606,15 +725,15 @@ static pj_status_t  codec2_codec_recover(pjmedia_codec *codec,
 				      struct pjmedia_frame *output)
 {
     struct codec2_data *codec2_data = (struct codec2_data*) codec->codec_data;
+    unsigned pcm_frame_size = codec2_data->dec_mode->samples_per_frame * 2;
 
     PJ_ASSERT_RETURN(codec2_data->plc_enabled, PJ_EINVALIDOP);
 
-    PJ_ASSERT_RETURN(output_buf_len >= (CODEC2_SAMPLES_PER_FRAME*2), PJMEDIA_CODEC_EPCMTOOSHORT);
-
-  //  PJ_LOG(4, (THIS_FILE, "codec2 recover"));
+    PJ_ASSERT_RETURN(output_buf_len >= pcm_frame_size, 
+		     PJMEDIA_CODEC_EPCMTOOSHORT);
 
     pjmedia_plc_generate(codec2_data->plc, (pj_int16_t*)output->buf);
-    output->size = (CODEC2_SAMPLES_PER_FRAME*2);
+    output->size = pcm_frame_size;
 
     return PJ_SUCCESS;
 }
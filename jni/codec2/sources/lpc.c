@@ -33,6 +33,10 @@
 #include "defines.h"
 #include "lpc.h"
 
+#ifdef CODEC2_HAVE_PJMEDIA_DSP
+#include <pjmedia/dsp.h>
+#endif
+
 /*---------------------------------------------------------------------------*\
                                                                          
   hanning_window()                                                        
@@ -69,6 +73,9 @@ void autocorrelate(
   int order	/* order of LPC analysis */
 )
 {
+#ifdef CODEC2_HAVE_PJMEDIA_DSP
+  pjmedia_dsp_autocorr_f(Sn, Rn, Nsam, order+1);
+#else
   int i,j;	/* loop variables */
 
   for(j=0; j<order+1; j++) {
@@ -76,6 +83,7 @@ void autocorrelate(
     for(i=0; i<Nsam-j; i++)
       Rn[j] += Sn[i]*Sn[i+j];
   }
+#endif
 }
 
 /*---------------------------------------------------------------------------*\
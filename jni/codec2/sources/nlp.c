@@ -34,6 +34,10 @@
 #include <math.h>
 #include <stdlib.h>
 
+#ifdef CODEC2_HAVE_PJMEDIA_DSP
+#include <pjmedia/dsp.h>
+#endif
+
 /*---------------------------------------------------------------------------*\
                                                                              
  				DEFINES                                       
@@ -228,6 +232,21 @@ float nlp(
 	nlp->sq[i] = notch;
     }
 
+#ifdef CODEC2_HAVE_PJMEDIA_DSP
+    {				/* FIR filter vector, as one block */
+	float x[NLP_NTAP-1+PMAX_M];
+
+	for(j=0; j<NLP_NTAP-1; j++)
+	    x[j] = nlp->mem_fir[j+1];
+	for(i=0; i<n; i++)
+	    x[NLP_NTAP-1+i] = nlp->sq[m-n+i];
+
+	pjmedia_dsp_fir_f(x, nlp_fir, &nlp->sq[m-n], n, NLP_NTAP);
+
+	for(j=0; j<NLP_NTAP; j++)
+	    nlp->mem_fir[j] = x[n-1+j];
+    }
+#else
     for(i=m-n; i<m; i++) {	/* FIR filter vector */
 
 	for(j=0; j<NLP_NTAP-1; j++)
@@ -238,6 +257,7 @@ float nlp(
 	for(j=0; j<NLP_NTAP; j++)
 	    nlp->sq[i] += nlp->mem_fir[j]*nlp_fir[j];
     }
+#endif
 
     /* Decimate and DFT */
 
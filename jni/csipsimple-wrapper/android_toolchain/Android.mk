@@ -57,7 +57,15 @@ ifeq ($(MY_USE_AMR),1)
 endif
 
 
-LOCAL_STATIC_LIBRARIES += swig-glue pjsip pjmedia swig-glue pjnath pjlib-util pjlib resample srtp 
+LOCAL_STATIC_LIBRARIES += swig-glue pjsip pjmedia swig-glue pjnath pjlib-util pjlib resample srtp pjlib-util 
+
+# ARMv8 SHA1 and CRC32 kernels of pjlib-util
+ifeq ($(TARGET_ARCH_ABI),arm64-v8a)
+	LOCAL_STATIC_LIBRARIES += pjlib-util-armv8
+endif
+ifeq ($(TARGET_ARCH_ABI)$(MY_USE_ARMV8_HASH),armeabi-v7a1)
+	LOCAL_STATIC_LIBRARIES += pjlib-util-armv8
+endif
 
 
 ifeq ($(MY_USE_ILBC),1)
@@ -121,6 +129,9 @@ endif
 ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)	
 	LOCAL_STATIC_LIBRARIES += libwebrtc_ns_neon
 endif
+
+#AGC
+	LOCAL_STATIC_LIBRARIES += libwebrtc_agc
 	
 #Common
 	LOCAL_STATIC_LIBRARIES += libwebrtc_apm_utility libwebrtc_system_wrappers libwebrtc_spl 
@@ -24,6 +24,32 @@
 PJ_BEGIN_DECL
 
 PJ_DECL(void*) get_library_factory(dynamic_factory *impl);
+PJ_DECL(void) css_register_extra_aud_codecs(pjmedia_endpt *endpt);
+
+/**
+ * Startup phases timed by csipsimple_init and the media init stage.
+ */
+enum css_startup_phase {
+	CSS_STARTUP_BEGIN,
+	CSS_STARTUP_PJSUA_INIT,
+	CSS_STARTUP_SIP_READY,
+	CSS_STARTUP_AUDIO_DEV,
+	CSS_STARTUP_AUDIO_CODECS,
+	CSS_STARTUP_VIDEO,
+	CSS_STARTUP_MEDIA_READY,
+	CSS_STARTUP_PHASE_CNT
+};
+
+/**
+ * Immutable snapshot of the codecs known by the stack.
+ * A new snapshot is built each time codec factories change, the previous
+ * ones stay valid until csipsimple_destroy.
+ */
+struct css_codec_catalog {
+	unsigned gen;
+	unsigned count;
+	pj_str_t ids[PJMEDIA_CODEC_MGR_MAX_CODECS];
+};
 
 struct css_stereo_recorder_data {
 	pj_pool_t		*pool;
@@ -53,6 +79,27 @@ struct css_data {
 	dynamic_factory 	extra_vid_codecs[64];
 	dynamic_factory 	extra_vid_codecs_destroy[64];
 
+	// Media devices and converter
+	dynamic_factory 	audio_implementation;
+	dynamic_factory 	video_render_implementation;
+	dynamic_factory 	video_capture_implementation;
+	dynamic_factory 	vid_converter;
+
+	// Staged startup
+	pj_mutex_t		*media_init_mutex;
+	pj_thread_t		*media_init_thread;
+	pj_bool_t		media_ready;
+	pj_bool_t		media_late_calls[PJSUA_MAX_CALLS];
+	pj_timer_entry		media_ready_timer;
+	pj_timestamp		startup_ts[CSS_STARTUP_PHASE_CNT];
+	pj_bool_t		startup_ts_set[CSS_STARTUP_PHASE_CNT];
+
+	// Codec catalog, generation is bumped each time factories change
+	pj_mutex_t		*catalog_mutex;
+	unsigned		codec_gen;
+	struct css_codec_catalog *aud_catalog;
+	struct css_codec_catalog *vid_catalog;
+
 	// About ringback
     int			    ringback_slot;
     int			    ringback_cnt;
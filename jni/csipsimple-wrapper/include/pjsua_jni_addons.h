@@ -135,6 +135,28 @@ typedef struct csipsimple_config {
 	 */
 	pj_bool_t use_noise_suppressor;
 
+	/**
+	 * Enable or not the automatic gain controller.
+	 * It normalizes the microphone level after echo cancellation and noise
+	 * suppression, so the software micro amplification should be left at
+	 * its neutral value when it is enabled.
+	 * Only has impact if using webRTC echo canceller as backend.
+	 * Disabled by default
+	 */
+	pj_bool_t use_gain_controller;
+
+	/**
+	 * Initialize media subsystems (audio device, dynamically loaded codecs,
+	 * video devices and codecs) on a background thread so that SIP is usable
+	 * as soon as csipsimple_init returns.
+	 * Codecs enumeration waits for media to be ready. Calls are never
+	 * blocked : a call set up in the meantime only offers the built-in
+	 * codecs, and on_call_media_state is raised again for it once media
+	 * is ready so that its audio can be connected.
+	 * Enabled by default
+	 */
+	pj_bool_t use_deferred_media_init;
+
 } csipsimple_config;
 
 typedef struct csipsimple_acc_config {
@@ -168,6 +190,8 @@ PJ_DECL(pj_status_t) csipsimple_init(pjsua_config *ua_cfg,
 				csipsimple_config *css_cfg,
 				jobject context);
 PJ_DECL(pj_status_t) csipsimple_destroy(unsigned flags);
+PJ_DECL(pj_status_t) csipsimple_wait_media_ready(void);
+PJ_DECL(pj_str_t) csipsimple_get_startup_report(void);
 PJ_DECL(pj_status_t) csipsimple_set_acc_user_data(pjsua_acc_config* acc_cfg, csipsimple_acc_config* css_acc_cfg);
 PJ_DECL(pj_status_t) csipsimple_init_acc_msg_data(pjsua_acc_id acc_id, pjsua_msg_data* msg_data);
 PJ_DECL(pj_status_t) pj_timer_fire(int entry_id);
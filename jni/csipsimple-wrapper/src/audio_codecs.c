@@ -125,8 +125,18 @@ PJ_DEF(pj_status_t) pjmedia_codec_register_audio_codecs(pjmedia_endpt *endpt,
 		return status;
 #endif /* PJMEDIA_HAS_G729_CODEC */
 
-	// Dynamic loading of plugins codecs
+	// Dynamically loaded plugins codecs are registered later by the media
+	// init stage, see css_register_extra_aud_codecs
+
+	return PJ_SUCCESS;
+}
+
+/**
+ * Dynamic loading of plugins codecs
+ */
+PJ_DEF(void) css_register_extra_aud_codecs(pjmedia_endpt *endpt) {
 	unsigned i;
+	pj_status_t status;
 
 	for (i = 0; i < css_var.extra_aud_codecs_cnt; i++) {
 		dynamic_factory *codec = &css_var.extra_aud_codecs[i];
@@ -139,6 +149,4 @@ PJ_DEF(pj_status_t) pjmedia_codec_register_audio_codecs(pjmedia_endpt *endpt,
 			}
     	}
 	}
-
-	return PJ_SUCCESS;
 }
@@ -16,21 +16,80 @@
  */
 
 #include "csipsimple_codecs_utils.h"
+#include "csipsimple_internal.h"
 
 #define THIS_FILE "css_codecs_utils.c"
 
+/**
+ * Build a new catalog from a codec enumeration
+ */
+static struct css_codec_catalog* build_catalog(pjsua_codec_info c[],
+		unsigned count) {
+	struct css_codec_catalog *catalog;
+	unsigned i;
+
+	catalog = PJ_POOL_ZALLOC_T(css_var.pool, struct css_codec_catalog);
+	catalog->gen = css_var.codec_gen;
+	catalog->count = count;
+	for (i = 0; i < count; i++) {
+		pj_strdup_with_null(css_var.pool, &catalog->ids[i], &c[i].codec_id);
+	}
+	return catalog;
+}
+
+/**
+ * Get the current audio or video codec catalog.
+ * Enumeration is only done again if codec factories changed since the
+ * last snapshot.
+ */
+static struct css_codec_catalog* get_catalog(pj_bool_t video) {
+	struct css_codec_catalog *catalog;
+
+	if (css_var.catalog_mutex == NULL) {
+		return NULL;
+	}
+
+	// Codecs are not all there until media is ready
+	csipsimple_wait_media_ready();
+
+	pj_mutex_lock(css_var.catalog_mutex);
+	catalog = video ? css_var.vid_catalog : css_var.aud_catalog;
+	if (catalog == NULL || catalog->gen != css_var.codec_gen) {
+		pjsua_codec_info c[PJMEDIA_CODEC_MGR_MAX_CODECS];
+		unsigned count = PJ_ARRAY_SIZE(c);
+		pj_status_t status = PJ_ENOTSUP;
+
+		if (!video) {
+			status = pjsua_enum_codecs(c, &count);
+		}
+#if PJMEDIA_HAS_VIDEO
+		else {
+			status = pjsua_vid_enum_codecs(c, &count);
+		}
+#endif
+		if (status != PJ_SUCCESS) {
+			count = 0;
+		}
+
+		catalog = build_catalog(c, count);
+		if (video) {
+			css_var.vid_catalog = catalog;
+		} else {
+			css_var.aud_catalog = catalog;
+		}
+	}
+	pj_mutex_unlock(css_var.catalog_mutex);
+
+	return catalog;
+}
+
 /**
  * Get nbr of codecs
  */
 
 PJ_DECL(int) codecs_get_nbr() {
-	pjsua_codec_info c[32];
-	unsigned i, count = PJ_ARRAY_SIZE(c);
-	pj_status_t status = pjsua_enum_codecs(c, &count);
-	if (status == PJ_SUCCESS) {
-		return count;
-	}
-	return 0;
+	struct css_codec_catalog *catalog = get_catalog(PJ_FALSE);
+	return (catalog != NULL) ? catalog->count : 0;
 }
 
 /**
@@ -38,12 +97,10 @@ PJ_DECL(int) codecs_get_nbr() {
  */
 
 PJ_DECL(pj_str_t) codecs_get_id(int codec_id) {
-	pjsua_codec_info c[32];
-	unsigned i, count = PJ_ARRAY_SIZE(c);
+	struct css_codec_catalog *catalog = get_catalog(PJ_FALSE);
 
-	pjsua_enum_codecs(c, &count);
-	if (codec_id < count) {
-		return c[codec_id].codec_id;
+	if (catalog != NULL && codec_id >= 0 && codec_id < catalog->count) {
+		return catalog->ids[codec_id];
 	}
 	return pj_str((char *) "INVALID/8000/1");
 }
@@ -54,14 +111,11 @@ PJ_DECL(pj_str_t) codecs_get_id(int codec_id) {
 
 PJ_DECL(int) codecs_vid_get_nbr() {
 #if PJMEDIA_HAS_VIDEO
-	pjsua_codec_info c[32];
-	unsigned i, count = PJ_ARRAY_SIZE(c);
-	pj_status_t status = pjsua_vid_enum_codecs(c, &count);
-	if (status == PJ_SUCCESS) {
-		return count;
-	}
-#endif
+	struct css_codec_catalog *catalog = get_catalog(PJ_TRUE);
+	return (catalog != NULL) ? catalog->count : 0;
+#else
 	return 0;
+#endif
 }
 
 /**
@@ -70,12 +124,10 @@ PJ_DECL(int) codecs_vid_get_nbr() {
 
 PJ_DECL(pj_str_t) codecs_vid_get_id(int codec_id) {
 #if PJMEDIA_HAS_VIDEO
-	pjsua_codec_info c[32];
-	unsigned i, count = PJ_ARRAY_SIZE(c);
+	struct css_codec_catalog *catalog = get_catalog(PJ_TRUE);
 
-	pjsua_vid_enum_codecs(c, &count);
-	if (codec_id < count) {
-		return c[codec_id].codec_id;
+	if (catalog != NULL && codec_id >= 0 && codec_id < catalog->count) {
+		return catalog->ids[codec_id];
 	}
 #endif
 	return pj_str((char *) "INVALID/8000/1");
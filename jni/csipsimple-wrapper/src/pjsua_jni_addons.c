@@ -168,6 +168,16 @@ pjmedia_transport* on_transport_created_wrapper(pjsua_call_id call_id,
 
 	// By default, use default global def
 	pj_bool_t use_zrtp = css_var.default_use_zrtp;
+
+	// This runs on the SIP worker, don't wait for the media subsystems
+	// here. Calls set up before they are ready are completed by
+	// on_media_ready_timer().
+	pj_mutex_lock(css_var.catalog_mutex);
+	if (!css_var.media_ready) {
+		css_var.media_late_calls[call_id] = PJ_TRUE;
+	}
+	pj_mutex_unlock(css_var.catalog_mutex);
+
     status = pjsua_call_get_info(call_id, &call_info);
 	if(status == PJ_SUCCESS && pjsua_acc_is_valid (call_info.acc_id)){
 		acc_user_data = pjsua_acc_get_user_data(call_info.acc_id);
@@ -319,6 +329,8 @@ PJ_DECL(void) csipsimple_config_default(csipsimple_config *css_cfg) {
 	css_cfg->tsx_td_timeout = PJSIP_TD_TIMEOUT;
 	css_cfg->disable_tcp_switch = PJ_TRUE;
 	css_cfg->use_noise_suppressor = PJ_FALSE;
+	css_cfg->use_gain_controller = PJ_FALSE;
+	css_cfg->use_deferred_media_init = PJ_TRUE;
 }
 
 PJ_DECL(void*) get_library_factory(dynamic_factory *impl) {
@@ -343,6 +355,159 @@ PJ_DECL(void*) get_library_factory(dynamic_factory *impl) {
 	return NULL;
 }
 
+/**
+ * Run on the SIP worker once media is ready. Calls whose media was set up
+ * before could not connect to the sound device, as no audio device was
+ * registered yet : let the application connect their media again.
+ */
+static void on_media_ready_timer(pj_timer_heap_t *th, pj_timer_entry *entry) {
+	pj_bool_t late_calls[PJSUA_MAX_CALLS];
+	unsigned i;
+
+	PJ_UNUSED_ARG(th);
+	entry->id = PJ_FALSE;
+
+	pj_mutex_lock(css_var.catalog_mutex);
+	pj_memcpy(late_calls, css_var.media_late_calls, sizeof(late_calls));
+	pj_bzero(css_var.media_late_calls, sizeof(css_var.media_late_calls));
+	pj_mutex_unlock(css_var.catalog_mutex);
+
+	for (i = 0; i < PJSUA_MAX_CALLS; i++) {
+		if (late_calls[i] && pjsua_call_has_media(i)
+				&& pjsua_var.ua_cfg.cb.on_call_media_state) {
+			PJ_LOG(4, (THIS_FILE, "Call %d: media ready, connect again", i));
+			(*pjsua_var.ua_cfg.cb.on_call_media_state)(i);
+		}
+	}
+}
+
+static void mark_startup_phase(enum css_startup_phase phase) {
+	pj_get_timestamp(&css_var.startup_ts[phase]);
+	css_var.startup_ts_set[phase] = PJ_TRUE;
+}
+
+/**
+ * Second stage of the startup : everything that is only needed once
+ * there is some media to handle.
+ * Run at most once, either from the media init thread or by the first
+ * one needing media ; others wait on the mutex until it's done.
+ */
+static void init_media_subsys(void) {
+	pj_bool_t has_late_calls = PJ_FALSE;
+	unsigned i;
+
+	pj_mutex_lock(css_var.media_init_mutex);
+	if (css_var.media_ready) {
+		pj_mutex_unlock(css_var.media_init_mutex);
+		return;
+	}
+
+	// Init audio device
+	pj_status_t added_audio = PJ_ENOTFOUND;
+	if (css_var.audio_implementation.init_factory_name.slen > 0) {
+		pjmedia_aud_dev_factory* (*init_factory)(
+				pj_pool_factory *pf) = get_library_factory(&css_var.audio_implementation);
+		if(init_factory != NULL) {
+			pjmedia_aud_register_factory(init_factory);
+			added_audio = PJ_SUCCESS;
+			PJ_LOG(4, (THIS_FILE, "Loaded audio dev"));
+		}
+	}
+
+	// Fallback to default audio dev if no one found
+	if (added_audio != PJ_SUCCESS) {
+		pjmedia_aud_register_factory(&pjmedia_android_factory);
+	}
+	mark_startup_phase(CSS_STARTUP_AUDIO_DEV);
+
+	// Load audio codecs plugins
+	css_register_extra_aud_codecs(pjsua_get_pjmedia_endpt());
+	mark_startup_phase(CSS_STARTUP_AUDIO_CODECS);
+
+	// Init video device
+#if PJMEDIA_HAS_VIDEO
+	// load renderer
+	if (css_var.video_render_implementation.init_factory_name.slen > 0) {
+		pjmedia_vid_dev_factory* (*init_factory)(
+				pj_pool_factory *pf) = get_library_factory(&css_var.video_render_implementation);
+		if(init_factory != NULL) {
+			pjmedia_vid_register_factory(init_factory, NULL);
+			PJ_LOG(4, (THIS_FILE, "Loaded video render dev"));
+		}
+	}
+	// load capture
+	if (css_var.video_capture_implementation.init_factory_name.slen > 0) {
+		pjmedia_vid_dev_factory* (*init_factory)(
+							pj_pool_factory *pf) = get_library_factory(&css_var.video_capture_implementation);
+		if(init_factory != NULL) {
+			pjmedia_vid_register_factory(init_factory, NULL);
+			PJ_LOG(4, (THIS_FILE, "Loaded video capture dev"));
+		}
+	}
+
+	// Load ffmpeg converter
+	pjmedia_converter_mgr* cvrt_mgr = pjmedia_converter_mgr_instance();
+	if(css_var.vid_converter.init_factory_name.slen > 0){
+		pj_status_t (*init_factory)(pjmedia_converter_mgr* cvrt_mgr) = get_library_factory(&css_var.vid_converter);
+		if(init_factory != NULL) {
+			init_factory(cvrt_mgr);
+			PJ_LOG(4, (THIS_FILE, "Loaded video converter"));
+		}
+	}
+
+
+	// Load video codecs
+	pjmedia_vid_codec_mgr* vid_mgr = pjmedia_vid_codec_mgr_instance();
+
+	for (i = 0; i < css_var.extra_vid_codecs_cnt; i++) {
+		dynamic_factory *codec = &css_var.extra_vid_codecs[i];
+		pj_status_t (*init_factory)(pjmedia_vid_codec_mgr *mgr,
+                pj_pool_factory *pf) = get_library_factory(codec);
+		if(init_factory != NULL){
+			pj_status_t status = init_factory(vid_mgr, &pjsua_var.cp.factory);
+			if(status != PJ_SUCCESS) {
+				PJ_LOG(2, (THIS_FILE,"Error loading dynamic codec plugin"));
+			}
+    	}
+	}
+	mark_startup_phase(CSS_STARTUP_VIDEO);
+#endif
+
+	// Codecs factories changed, catalog has to be rebuilt
+	pj_mutex_lock(css_var.catalog_mutex);
+	css_var.codec_gen++;
+	css_var.media_ready = PJ_TRUE;
+	for (i = 0; i < PJSUA_MAX_CALLS; i++) {
+		if (css_var.media_late_calls[i]) {
+			has_late_calls = PJ_TRUE;
+		}
+	}
+	pj_mutex_unlock(css_var.catalog_mutex);
+
+	mark_startup_phase(CSS_STARTUP_MEDIA_READY);
+	pj_mutex_unlock(css_var.media_init_mutex);
+
+	// Complete the calls that did not wait for us
+	if (has_late_calls) {
+		pj_time_val delay = { 0, 0 };
+		pj_timer_entry_init(&css_var.media_ready_timer, PJ_TRUE, NULL,
+				&on_media_ready_timer);
+		if (pjsua_schedule_timer(&css_var.media_ready_timer, &delay)
+				!= PJ_SUCCESS) {
+			css_var.media_ready_timer.id = PJ_FALSE;
+		}
+	}
+
+	PJ_LOG(3, (THIS_FILE, "Startup : %s",
+			csipsimple_get_startup_report().ptr));
+}
+
+static int media_init_thread(void *arg) {
+	PJ_UNUSED_ARG(arg);
+	init_media_subsys();
+	return 0;
+}
+
 //Wrap start & stop
 PJ_DECL(pj_status_t) csipsimple_init(pjsua_config *ua_cfg,
 		pjsua_logging_config *log_cfg, pjsua_media_config *media_cfg,
@@ -350,6 +515,12 @@ PJ_DECL(pj_status_t) csipsimple_init(pjsua_config *ua_cfg,
 	pj_status_t result;
 	unsigned i;
 
+	pj_bzero(css_var.startup_ts_set, sizeof(css_var.startup_ts_set));
+	mark_startup_phase(CSS_STARTUP_BEGIN);
+	css_var.media_ready = PJ_FALSE;
+	css_var.media_init_thread = NULL;
+	pj_bzero(css_var.media_late_calls, sizeof(css_var.media_late_calls));
+
 	/* Create memory pool for application. */
 	if(css_var.pool == NULL){
 		css_var.pool = pjsua_pool_create("css", 1000, 1000);
@@ -365,6 +536,7 @@ PJ_DECL(pj_status_t) csipsimple_init(pjsua_config *ua_cfg,
 	extern pj_bool_t pjmedia_add_bandwidth_tias_in_sdp;
 	extern pj_bool_t pjsua_no_update;
 	extern pj_bool_t pjmedia_webrtc_use_ns;
+	extern pj_bool_t pjmedia_webrtc_use_agc;
 
 	pjsua_no_update = css_cfg->use_no_update ? PJ_TRUE : PJ_FALSE;
 
@@ -382,6 +554,9 @@ PJ_DECL(pj_status_t) csipsimple_init(pjsua_config *ua_cfg,
 	/* Use noise suppressor ? */
 	pjmedia_webrtc_use_ns =
 			css_cfg->use_noise_suppressor ? PJ_TRUE : PJ_FALSE;
+	/* Use automatic gain control ? */
+	pjmedia_webrtc_use_agc =
+			css_cfg->use_gain_controller ? PJ_TRUE : PJ_FALSE;
 
 	css_tcp_keep_alive_interval = css_cfg->tcp_keep_alive_interval;
 	css_tls_keep_alive_interval = css_cfg->tls_keep_alive_interval;
@@ -458,81 +633,107 @@ PJ_DECL(pj_status_t) csipsimple_init(pjsua_config *ua_cfg,
 	css_var.context = (*jni_env)->NewGlobalRef(jni_env, context);
 	DETACH_JVM(jni_env);
 
+	// Media devices and converter cfg
+	pj_strdup_with_null(css_var.pool, &css_var.audio_implementation.shared_lib_path,
+			&css_cfg->audio_implementation.shared_lib_path);
+	pj_strdup_with_null(css_var.pool, &css_var.audio_implementation.init_factory_name,
+			&css_cfg->audio_implementation.init_factory_name);
+	pj_strdup_with_null(css_var.pool, &css_var.video_render_implementation.shared_lib_path,
+			&css_cfg->video_render_implementation.shared_lib_path);
+	pj_strdup_with_null(css_var.pool, &css_var.video_render_implementation.init_factory_name,
+			&css_cfg->video_render_implementation.init_factory_name);
+	pj_strdup_with_null(css_var.pool, &css_var.video_capture_implementation.shared_lib_path,
+			&css_cfg->video_capture_implementation.shared_lib_path);
+	pj_strdup_with_null(css_var.pool, &css_var.video_capture_implementation.init_factory_name,
+			&css_cfg->video_capture_implementation.init_factory_name);
+	pj_strdup_with_null(css_var.pool, &css_var.vid_converter.shared_lib_path,
+			&css_cfg->vid_converter.shared_lib_path);
+	pj_strdup_with_null(css_var.pool, &css_var.vid_converter.init_factory_name,
+			&css_cfg->vid_converter.init_factory_name);
+
 	result = (pj_status_t) pjsua_init(ua_cfg, log_cfg, media_cfg);
+	mark_startup_phase(CSS_STARTUP_PJSUA_INIT);
 	if (result == PJ_SUCCESS) {
 		init_ringback_tone();
 
-		// Init audio device
-		pj_status_t added_audio = PJ_ENOTFOUND;
-		if (css_cfg->audio_implementation.init_factory_name.slen > 0) {
-			pjmedia_aud_dev_factory* (*init_factory)(
-					pj_pool_factory *pf) = get_library_factory(&css_cfg->audio_implementation);
-			if(init_factory != NULL) {
-				pjmedia_aud_register_factory(init_factory);
-				added_audio = PJ_SUCCESS;
-				PJ_LOG(4, (THIS_FILE, "Loaded audio dev"));
-			}
+		result = pj_mutex_create_simple(css_var.pool, "css_media",
+				&css_var.media_init_mutex);
+		if (result == PJ_SUCCESS) {
+			result = pj_mutex_create_simple(css_var.pool, "css_catalog",
+					&css_var.catalog_mutex);
 		}
-
-		// Fallback to default audio dev if no one found
-		if (added_audio != PJ_SUCCESS) {
-			pjmedia_aud_register_factory(&pjmedia_android_factory);
+		if (result != PJ_SUCCESS) {
+			return result;
 		}
 
-		// Init video device
-#if PJMEDIA_HAS_VIDEO
-		// load renderer
-		if (css_cfg->video_render_implementation.init_factory_name.slen > 0) {
-			pjmedia_vid_dev_factory* (*init_factory)(
-					pj_pool_factory *pf) = get_library_factory(&css_cfg->video_render_implementation);
-			if(init_factory != NULL) {
-				pjmedia_vid_register_factory(init_factory, NULL);
-				PJ_LOG(4, (THIS_FILE, "Loaded video render dev"));
+		// SIP is usable from now, media may follow in background
+		mark_startup_phase(CSS_STARTUP_SIP_READY);
+		if (css_cfg->use_deferred_media_init) {
+			result = pj_thread_create(css_var.pool, "css_media",
+					&media_init_thread, NULL, 0, 0,
+					&css_var.media_init_thread);
+			if (result != PJ_SUCCESS) {
+				PJ_LOG(2, (THIS_FILE, "Cannot defer media init, do it now"));
+				css_var.media_init_thread = NULL;
+				result = PJ_SUCCESS;
 			}
 		}
-		// load capture
-		if (css_cfg->video_capture_implementation.init_factory_name.slen > 0) {
-			pjmedia_vid_dev_factory* (*init_factory)(
-								pj_pool_factory *pf) = get_library_factory(&css_cfg->video_capture_implementation);
-			if(init_factory != NULL) {
-				pjmedia_vid_register_factory(init_factory, NULL);
-				PJ_LOG(4, (THIS_FILE, "Loaded video capture dev"));
-			}
+		if (css_var.media_init_thread == NULL) {
+			init_media_subsys();
 		}
+	}
 
-		// Load ffmpeg converter
-		pjmedia_converter_mgr* cvrt_mgr = pjmedia_converter_mgr_instance();
-		if(css_cfg->vid_converter.init_factory_name.slen > 0){
-			pj_status_t (*init_factory)(pjmedia_converter_mgr* cvrt_mgr) = get_library_factory(&css_cfg->vid_converter);
-			if(init_factory != NULL) {
-				init_factory(cvrt_mgr);
-				PJ_LOG(4, (THIS_FILE, "Loaded video converter"));
-			}
-		}
+	return result;
+}
 
+PJ_DECL(pj_status_t) csipsimple_wait_media_ready(void) {
+	if (css_var.media_init_mutex == NULL) {
+		return PJ_EINVALIDOP;
+	}
+	init_media_subsys();
+	return PJ_SUCCESS;
+}
 
-		// Load video codecs
-		pjmedia_vid_codec_mgr* vid_mgr = pjmedia_vid_codec_mgr_instance();
+static char startup_report[256];
+PJ_DECL(pj_str_t) csipsimple_get_startup_report(void) {
+	static const char *phase_names[CSS_STARTUP_PHASE_CNT] = {
+		"begin", "pjsua_init", "sip_ready", "audio_dev", "audio_codecs",
+		"video", "media_ready"
+	};
+	int len = 0;
+	unsigned i;
 
-		for (i = 0; i < css_var.extra_vid_codecs_cnt; i++) {
-			dynamic_factory *codec = &css_var.extra_vid_codecs[i];
-			pj_status_t (*init_factory)(pjmedia_vid_codec_mgr *mgr,
-                    pj_pool_factory *pf) = get_library_factory(codec);
-			if(init_factory != NULL){
-				pj_status_t status = init_factory(vid_mgr, &pjsua_var.cp.factory);
-				if(status != PJ_SUCCESS) {
-					PJ_LOG(2, (THIS_FILE,"Error loading dynamic codec plugin"));
-				}
-	    	}
+	startup_report[0] = '\0';
+	for (i = CSS_STARTUP_BEGIN + 1; i < CSS_STARTUP_PHASE_CNT; i++) {
+		int printed;
+		if (!css_var.startup_ts_set[i]) {
+			continue;
 		}
-
-#endif
+		printed = pj_ansi_snprintf(startup_report + len,
+				sizeof(startup_report) - len, "%s%s=%ums",
+				(len > 0) ? " " : "", phase_names[i],
+				pj_elapsed_msec(&css_var.startup_ts[CSS_STARTUP_BEGIN],
+						&css_var.startup_ts[i]));
+		if (printed < 0 || printed >= (int) sizeof(startup_report) - len) {
+			break;
 		}
-
-	return result;
+		len += printed;
+	}
+	return pj_str(startup_report);
 }
 
 PJ_DECL(pj_status_t) csipsimple_destroy(unsigned flags) {
+	// Media init may still be running in background
+	if (css_var.media_init_thread) {
+		pj_thread_join(css_var.media_init_thread);
+		pj_thread_destroy(css_var.media_init_thread);
+		css_var.media_init_thread = NULL;
+	}
+	if (css_var.media_ready_timer.id) {
+		pjsua_cancel_timer(&css_var.media_ready_timer);
+		css_var.media_ready_timer.id = PJ_FALSE;
+	}
+
 	destroy_ringback_tone();
 
 #if PJMEDIA_HAS_VIDEO
@@ -549,6 +750,18 @@ PJ_DECL(pj_status_t) csipsimple_destroy(unsigned flags) {
 	}
 #endif
 
+	if (css_var.media_init_mutex) {
+		pj_mutex_destroy(css_var.media_init_mutex);
+		css_var.media_init_mutex = NULL;
+	}
+	if (css_var.catalog_mutex) {
+		pj_mutex_destroy(css_var.catalog_mutex);
+		css_var.catalog_mutex = NULL;
+	}
+	css_var.aud_catalog = NULL;
+	css_var.vid_catalog = NULL;
+	css_var.media_ready = PJ_FALSE;
+
 	if (css_var.pool) {
 		pj_pool_release(css_var.pool);
 		css_var.pool = NULL;
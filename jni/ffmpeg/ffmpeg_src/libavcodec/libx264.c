@@ -141,6 +141,10 @@ static int avfmt2_num_planes(int avfmt)
     case PIX_FMT_RGB24:
         return 1;
 
+    case PIX_FMT_NV12:
+    case PIX_FMT_NV21:
+        return 2;
+
     default:
         return 3;
     }
@@ -259,6 +263,10 @@ static int convert_pix_fmt(enum PixelFormat pix_fmt)
     case PIX_FMT_YUV444P:
     case PIX_FMT_YUV444P9:
     case PIX_FMT_YUV444P10: return X264_CSP_I444;
+    case PIX_FMT_NV12:      return X264_CSP_NV12;
+#ifdef X264_CSP_NV21
+    case PIX_FMT_NV21:      return X264_CSP_NV21;
+#endif
 #ifdef X264_CSP_BGR
     case PIX_FMT_BGR24:
         return X264_CSP_BGR;
@@ -569,6 +577,10 @@ static const enum PixelFormat pix_fmts_8bit[] = {
     PIX_FMT_YUVJ420P,
     PIX_FMT_YUV422P,
     PIX_FMT_YUV444P,
+    PIX_FMT_NV12,
+#ifdef X264_CSP_NV21
+    PIX_FMT_NV21,
+#endif
     PIX_FMT_NONE
 };
 static const enum PixelFormat pix_fmts_9bit[] = {
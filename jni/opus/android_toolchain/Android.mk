@@ -46,6 +46,8 @@ LOCAL_CFLAGS += -Drestrict=__restrict
 ifeq ($(TARGET_ARCH_ABI),$(filter $(TARGET_ARCH_ABI),armeabi armeabi-v7a))
 LOCAL_CFLAGS += -DFIXED_POINT
 endif
+# Shared DSP kernels from pjmedia
+LOCAL_CFLAGS += -DOPUS_HAVE_PJMEDIA_DSP
 
 LOCAL_STATIC_LIBRARIES += libgcc
 
@@ -24,6 +24,7 @@
 #include <pj/string.h>
 #include <pj/assert.h>
 #include <pj/log.h>
+#include <pj/os.h>
 
 
 #if defined(PJMEDIA_HAS_OPUS_CODEC) && (PJMEDIA_HAS_OPUS_CODEC!=0)
@@ -109,6 +110,7 @@ static struct opus_factory
     pj_pool_t		       *pool;
     pj_mutex_t		       *mutex;
     pjmedia_codec	     codec_list;
+    pjmedia_codec_opus_governor gov;
 } opus_factory;
 
 
@@ -124,6 +126,21 @@ struct opus_private
 
     pj_bool_t		 dec_ready;
     OpusDecoder* psDec;
+
+    unsigned	 clock_rate;
+    unsigned	 channel_cnt;
+
+    /* Complexity governor */
+    pjmedia_codec_opus_governor gov;
+    int		 complexity;
+    int		 bandwidth;	/**< Current OPUS_BANDWIDTH_xxx.	    */
+    int		 max_bandwidth;	/**< Limit from clock rate and fmtp.	    */
+    pj_uint32_t	 win[PJMEDIA_CODEC_OPUS_GOV_MAX_WINDOW];
+    unsigned	 win_pos;
+    unsigned	 win_cnt;
+    pj_uint32_t	 win_sum;
+    unsigned	 since_change;
+    pjmedia_codec_opus_stat stat;
 };
 
 
@@ -154,6 +171,37 @@ int opus_to_pjsip_error_code(int opus_error){
 	return PJMEDIA_ERROR;
 }
 
+/* Map a sample rate, as used by maxcodedaudiobandwidth, to the Opus
+ * bandwidth that covers it, and back.
+ */
+static int opus_bandwidth_from_rate(unsigned rate)
+{
+    if (rate <= 8000)
+	return OPUS_BANDWIDTH_NARROWBAND;
+    else if (rate <= 12000)
+	return OPUS_BANDWIDTH_MEDIUMBAND;
+    else if (rate <= 16000)
+	return OPUS_BANDWIDTH_WIDEBAND;
+    else if (rate <= 24000)
+	return OPUS_BANDWIDTH_SUPERWIDEBAND;
+    return OPUS_BANDWIDTH_FULLBAND;
+}
+
+static unsigned opus_bandwidth_to_rate(int bandwidth)
+{
+    switch (bandwidth) {
+    case OPUS_BANDWIDTH_NARROWBAND:
+	return 8000;
+    case OPUS_BANDWIDTH_MEDIUMBAND:
+	return 12000;
+    case OPUS_BANDWIDTH_WIDEBAND:
+	return 16000;
+    case OPUS_BANDWIDTH_SUPERWIDEBAND:
+	return 24000;
+    }
+    return 48000;
+}
+
 /**
  * Apply opus settings to dec_fmtp parameters
  */
@@ -212,6 +260,8 @@ PJ_DEF(pj_status_t) pjmedia_codec_opus_init(pjmedia_endpt *endpt)
     /* Init list */
     pj_list_init(&opus_factory.codec_list);
 
+    pjmedia_codec_opus_governor_default(&opus_factory.gov);
+
     /* Create mutex. */
     status = pj_mutex_create_simple(opus_factory.pool, "opus codecs",
 				    &opus_factory.mutex);
@@ -290,6 +340,70 @@ PJ_DEF(pj_status_t) pjmedia_codec_opus_deinit(void)
     return status;
 }
 
+PJ_DEF(void) pjmedia_codec_opus_governor_default(
+					pjmedia_codec_opus_governor *gov)
+{
+    pj_bzero(gov, sizeof(*gov));
+    gov->enabled = PJ_FALSE;
+    gov->init_complexity = PJMEDIA_CODEC_OPUS_DEFAULT_COMPLEXITY;
+    gov->min_complexity = 0;
+    gov->max_complexity = PJMEDIA_CODEC_OPUS_DEFAULT_MAX_COMPLEXITY;
+    gov->high_pct = 40;
+    gov->low_pct = 15;
+    gov->window = 16;
+    gov->raise_delay = 100;
+    gov->adjust_bandwidth = PJ_TRUE;
+    gov->min_bandwidth = 8000;
+}
+
+PJ_DEF(pj_status_t) pjmedia_codec_opus_set_governor(
+				    const pjmedia_codec_opus_governor *gov)
+{
+    PJ_ASSERT_RETURN(gov, PJ_EINVAL);
+    PJ_ASSERT_RETURN(gov->min_complexity <= gov->init_complexity &&
+		     gov->init_complexity <= gov->max_complexity &&
+		     gov->max_complexity <= 10, PJ_EINVAL);
+    PJ_ASSERT_RETURN(gov->low_pct < gov->high_pct, PJ_EINVAL);
+    PJ_ASSERT_RETURN(gov->window > 0 &&
+		     gov->window <= PJMEDIA_CODEC_OPUS_GOV_MAX_WINDOW,
+		     PJ_EINVAL);
+    PJ_ASSERT_RETURN(opus_factory.endpt != NULL, PJ_EINVALIDOP);
+
+    pj_mutex_lock(opus_factory.mutex);
+    opus_factory.gov = *gov;
+    pj_mutex_unlock(opus_factory.mutex);
+
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pjmedia_codec_opus_get_governor(
+					pjmedia_codec_opus_governor *gov)
+{
+    PJ_ASSERT_RETURN(gov, PJ_EINVAL);
+    PJ_ASSERT_RETURN(opus_factory.endpt != NULL, PJ_EINVALIDOP);
+
+    pj_mutex_lock(opus_factory.mutex);
+    *gov = opus_factory.gov;
+    pj_mutex_unlock(opus_factory.mutex);
+
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pjmedia_codec_opus_get_stat(pjmedia_codec *codec,
+					pjmedia_codec_opus_stat *stat)
+{
+    struct opus_private *opus;
+
+    PJ_ASSERT_RETURN(codec && stat, PJ_EINVAL);
+    PJ_ASSERT_RETURN(codec->factory == &opus_factory.base, PJ_EINVAL);
+
+    opus = (struct opus_private*) codec->codec_data;
+    PJ_ASSERT_RETURN(opus->enc_ready, PJ_EINVALIDOP);
+
+    *stat = opus->stat;
+    return PJ_SUCCESS;
+}
+
 /*
  * Check if factory can allocate the specified codec.
  */
@@ -527,7 +641,20 @@ static pj_status_t opus_codec_open(pjmedia_codec *codec,
 
     // Set Encoder parameters
     // For android set 2 for now
-    opus_encoder_ctl(opus->psEnc, OPUS_SET_COMPLEXITY(2));
+    pj_mutex_lock(opus_factory.mutex);
+    opus->gov = opus_factory.gov;
+    pj_mutex_unlock(opus_factory.mutex);
+
+    opus->clock_rate = attr->info.clock_rate;
+    opus->channel_cnt = attr->info.channel_cnt;
+    opus->complexity = opus->gov.init_complexity;
+    opus->max_bandwidth = opus_bandwidth_from_rate(attr->info.clock_rate);
+    opus->win_pos = opus->win_cnt = 0;
+    opus->win_sum = 0;
+    opus->since_change = 0;
+    pj_bzero(&opus->stat, sizeof(opus->stat));
+
+    opus_encoder_ctl(opus->psEnc, OPUS_SET_COMPLEXITY(opus->complexity));
     opus_encoder_ctl(opus->psEnc, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
 
     // with fmtp params
@@ -547,16 +674,11 @@ static pj_status_t opus_codec_open(pjmedia_codec *codec,
 		}else if(pj_stricmp(&attr->setting.enc_fmtp.param[i].name,
 				   &STR_FMTP_MAX_CODED_AUDIO_BANDWIDTH) == 0)	{
 			tmpFmtpVal = (int) (pj_strtoul(&attr->setting.enc_fmtp.param[i].val));
-			if(tmpFmtpVal <= 8000){
-				opus_encoder_ctl(opus->psEnc, OPUS_SET_MAX_BANDWIDTH(OPUS_BANDWIDTH_NARROWBAND));
-			}else if(tmpFmtpVal <= 12000){
-				opus_encoder_ctl(opus->psEnc, OPUS_SET_MAX_BANDWIDTH(OPUS_BANDWIDTH_MEDIUMBAND));
-			}else if(tmpFmtpVal <= 16000){
-				opus_encoder_ctl(opus->psEnc, OPUS_SET_MAX_BANDWIDTH(OPUS_BANDWIDTH_WIDEBAND));
-			}else if(tmpFmtpVal <= 24000){
-				opus_encoder_ctl(opus->psEnc, OPUS_SET_MAX_BANDWIDTH(OPUS_BANDWIDTH_SUPERWIDEBAND));
-			}else if(tmpFmtpVal <= 48000){
-				opus_encoder_ctl(opus->psEnc, OPUS_SET_MAX_BANDWIDTH(OPUS_BANDWIDTH_FULLBAND));
+			if(tmpFmtpVal <= 48000){
+				int bw = opus_bandwidth_from_rate(tmpFmtpVal);
+				opus_encoder_ctl(opus->psEnc, OPUS_SET_MAX_BANDWIDTH(bw));
+				if(bw < opus->max_bandwidth)
+					opus->max_bandwidth = bw;
 			}
 		}else if(pj_stricmp(&attr->setting.enc_fmtp.param[i].name,
 				   &STR_FMTP_USE_DTX) == 0)	{
@@ -567,6 +689,12 @@ static pj_status_t opus_codec_open(pjmedia_codec *codec,
 
 	//attr->info.enc_ptime = ( attr->info.frm_ptime * attr->info.clock_rate) / 48000; // fake pjsip
 
+    // The governor only lowers the bandwidth below the negotiated one
+    opus->bandwidth = opus->max_bandwidth;
+    opus->stat.governor = opus->gov.enabled;
+    opus->stat.complexity = opus->complexity;
+    opus->stat.bandwidth = opus_bandwidth_to_rate(opus->bandwidth);
+
     opus->enc_ready = PJ_TRUE;
 
     //Decoder
@@ -611,6 +739,89 @@ static pj_status_t  opus_codec_modify(pjmedia_codec *codec,
 }
 
 
+/*
+ * Complexity governor: account one encode call, and lower or raise the
+ * encoder once a full window of frames has been measured.
+ */
+static void opus_governor_update(struct opus_private *opus,
+				 pj_uint32_t encode_usec,
+				 unsigned frame_usec)
+{
+    pjmedia_codec_opus_governor *gov = &opus->gov;
+    unsigned avg, load;
+    int min_bw;
+
+    opus->stat.encoded++;
+    opus->stat.frame_usec = frame_usec;
+    if (encode_usec > opus->stat.max_encode_usec)
+	opus->stat.max_encode_usec = encode_usec;
+
+    /* Moving window of the last encode times */
+    if (opus->win_cnt == gov->window)
+	opus->win_sum -= opus->win[opus->win_pos];
+    else
+	opus->win_cnt++;
+    opus->win[opus->win_pos] = encode_usec;
+    opus->win_sum += encode_usec;
+    opus->win_pos = (opus->win_pos + 1) % gov->window;
+    opus->since_change++;
+
+    avg = opus->win_sum / opus->win_cnt;
+    opus->stat.avg_encode_usec = avg;
+
+    if (!gov->enabled || opus->win_cnt < gov->window || frame_usec == 0)
+	return;
+
+    load = avg * 100 / frame_usec;
+    min_bw = opus_bandwidth_from_rate(gov->min_bandwidth);
+
+    if (load > gov->high_pct) {
+	if (opus->complexity > (int)gov->min_complexity) {
+	    opus->complexity--;
+	    opus_encoder_ctl(opus->psEnc,
+			     OPUS_SET_COMPLEXITY(opus->complexity));
+	} else if (gov->adjust_bandwidth && opus->bandwidth > min_bw) {
+	    opus->bandwidth--;
+	    opus_encoder_ctl(opus->psEnc,
+			     OPUS_SET_MAX_BANDWIDTH(opus->bandwidth));
+	} else {
+	    return;
+	}
+	opus->stat.lowered++;
+
+    } else if (load < gov->low_pct &&
+	       opus->since_change >= gov->raise_delay)
+    {
+	if (opus->bandwidth < opus->max_bandwidth) {
+	    opus->bandwidth++;
+	    opus_encoder_ctl(opus->psEnc,
+			     OPUS_SET_MAX_BANDWIDTH(opus->bandwidth));
+	} else if (opus->complexity < (int)gov->max_complexity) {
+	    opus->complexity++;
+	    opus_encoder_ctl(opus->psEnc,
+			     OPUS_SET_COMPLEXITY(opus->complexity));
+	} else {
+	    return;
+	}
+	opus->stat.raised++;
+
+    } else {
+	return;
+    }
+
+    PJ_LOG(4, (THIS_FILE, "Encode load %u%% (%uus of %uus), complexity %d, "
+	       "bandwidth %u", load, avg, frame_usec, opus->complexity,
+	       opus_bandwidth_to_rate(opus->bandwidth)));
+
+    opus->stat.complexity = opus->complexity;
+    opus->stat.bandwidth = opus_bandwidth_to_rate(opus->bandwidth);
+
+    /* Measure the new setting from scratch */
+    opus->win_pos = opus->win_cnt = 0;
+    opus->win_sum = 0;
+    opus->since_change = 0;
+}
+
 /*
  * Encode frame.
  */
@@ -621,18 +832,25 @@ static pj_status_t opus_codec_encode(pjmedia_codec *codec,
 {
 	struct opus_private *opus;
 	int ret, frameSize;
-    pj_assert(opus && input && output);
+	pj_timestamp t0, t1;
+    pj_assert(codec && input && output);
 
     opus = (struct opus_private*) codec->codec_data;
+    frameSize = (input->size >> 1) / opus->channel_cnt;
 
     /* Encode */
     output->size = 0;
     //PJ_LOG(4, (THIS_FILE, "Input size : %d - Encoder packet size", input->size));
 
     //That's fine with pjmedia cause input size is always already the good size
+	pj_get_timestamp(&t0);
 	ret = opus_encode(opus->psEnc,
-			(opus_int16*)input->buf, ( input->size >> 1 ),
+			(opus_int16*)input->buf, frameSize,
 			(unsigned char *)output->buf, output_buf_len);
+	pj_get_timestamp(&t1);
+	opus_governor_update(opus, pj_elapsed_usec(&t0, &t1),
+			     (unsigned)((pj_uint64_t)frameSize * 1000000 /
+					 opus->clock_rate));
 	if( ret < 0 ) {
 		PJ_LOG(1, (THIS_FILE, "Impossible to encode packet %d", ret));
 		return opus_to_pjsip_error_code(ret);
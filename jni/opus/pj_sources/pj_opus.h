@@ -10,11 +10,201 @@
 #include <pjmedia-codec/types.h>
 
 
+/**
+ * Encoder complexity used when the codec is opened, and the fixed
+ * complexity when the governor is disabled.
+ */
+#ifndef PJMEDIA_CODEC_OPUS_DEFAULT_COMPLEXITY
+#   define PJMEDIA_CODEC_OPUS_DEFAULT_COMPLEXITY	2
+#endif
+
+/**
+ * Highest complexity the governor raises the encoder to by default.
+ */
+#ifndef PJMEDIA_CODEC_OPUS_DEFAULT_MAX_COMPLEXITY
+#   define PJMEDIA_CODEC_OPUS_DEFAULT_MAX_COMPLEXITY	6
+#endif
+
+/**
+ * Largest governor window, in frames.
+ */
+#ifndef PJMEDIA_CODEC_OPUS_GOV_MAX_WINDOW
+#   define PJMEDIA_CODEC_OPUS_GOV_MAX_WINDOW		64
+#endif
+
+
 PJ_BEGIN_DECL
 
+/**
+ * Settings of the encoder complexity governor. The governor times every
+ * encode call, averages the time over a window of frames, and compares
+ * the average with the duration of the frame. When encoding takes too
+ * large a share of the frame, it lowers the complexity, and then the
+ * coded bandwidth once the complexity is at its minimum. When encoding
+ * is cheap again it raises them back, bandwidth first.
+ */
+typedef struct pjmedia_codec_opus_governor
+{
+    /**
+     * Enable the governor. When disabled, the encoder keeps
+     * init_complexity for the whole call, as it did before the governor
+     * was added.
+     *
+     * Default: PJ_FALSE
+     */
+    pj_bool_t	enabled;
+
+    /**
+     * Complexity set when the codec is opened, 0 to 10.
+     *
+     * Default: PJMEDIA_CODEC_OPUS_DEFAULT_COMPLEXITY
+     */
+    unsigned	init_complexity;
+
+    /**
+     * Lowest complexity the governor may set.
+     *
+     * Default: 0
+     */
+    unsigned	min_complexity;
+
+    /**
+     * Highest complexity the governor may set.
+     *
+     * Default: PJMEDIA_CODEC_OPUS_DEFAULT_MAX_COMPLEXITY
+     */
+    unsigned	max_complexity;
+
+    /**
+     * Lower the encoder when the average encode time is above this
+     * percentage of the frame duration.
+     *
+     * Default: 40
+     */
+    unsigned	high_pct;
+
+    /**
+     * Raise the encoder when the average encode time is below this
+     * percentage of the frame duration. Must be lower than high_pct, the
+     * gap between the two is the hysteresis.
+     *
+     * Default: 15
+     */
+    unsigned	low_pct;
+
+    /**
+     * Number of frames averaged, up to PJMEDIA_CODEC_OPUS_GOV_MAX_WINDOW.
+     * The window restarts after each change, so at least this many frames
+     * separate two changes.
+     *
+     * Default: 16
+     */
+    unsigned	window;
+
+    /**
+     * Minimum number of frames since the last change before raising,
+     * so that the encoder does not go back up right after going down.
+     *
+     * Default: 100
+     */
+    unsigned	raise_delay;
+
+    /**
+     * Also lower the maximum coded bandwidth once the complexity is at
+     * min_complexity.
+     *
+     * Default: PJ_TRUE
+     */
+    pj_bool_t	adjust_bandwidth;
+
+    /**
+     * Lowest coded bandwidth the governor may set, given as the sample
+     * rate like the maxcodedaudiobandwidth fmtp parameter (8000 for
+     * narrowband up to 48000 for fullband).
+     *
+     * Default: 8000
+     */
+    unsigned	min_bandwidth;
+
+} pjmedia_codec_opus_governor;
+
+
+/**
+ * State of an opened Opus codec instance.
+ */
+typedef struct pjmedia_codec_opus_stat
+{
+    pj_bool_t	governor;	/**< Governor is enabled.		    */
+    unsigned	complexity;	/**< Current encoder complexity.	    */
+    unsigned	bandwidth;	/**< Current maximum coded bandwidth, as
+				     a sample rate.			    */
+    unsigned	frame_usec;	/**< Duration of the last encoded frame.    */
+    unsigned	avg_encode_usec;/**< Average encode time in the window.	    */
+    unsigned	max_encode_usec;/**< Longest encode time since open.	    */
+    unsigned	encoded;	/**< Number of frames encoded.		    */
+    unsigned	lowered;	/**< Number of times the governor lowered
+				     the complexity or bandwidth.	    */
+    unsigned	raised;		/**< Number of times it raised them.	    */
+} pjmedia_codec_opus_stat;
+
+
+/**
+ * Initialize and register Opus codec factory to pjmedia endpoint.
+ *
+ * @param endpt		The pjmedia endpoint.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
 PJ_DECL(pj_status_t) pjmedia_codec_opus_init( pjmedia_endpt *endpt);
+
+/**
+ * Unregister Opus codec factory from pjmedia endpoint.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
 PJ_DECL(pj_status_t) pjmedia_codec_opus_deinit();
 
+/**
+ * Initialize governor settings with default values.
+ *
+ * @param gov		The governor settings.
+ */
+PJ_DECL(void) pjmedia_codec_opus_governor_default(
+					pjmedia_codec_opus_governor *gov);
+
+/**
+ * Set the governor settings used by Opus codecs opened after this call.
+ * Codecs that are already open keep their settings.
+ *
+ * @param gov		The governor settings.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_codec_opus_set_governor(
+				    const pjmedia_codec_opus_governor *gov);
+
+/**
+ * Get the governor settings currently used for new codecs.
+ *
+ * @param gov		Receives the governor settings.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_codec_opus_get_governor(
+					pjmedia_codec_opus_governor *gov);
+
+/**
+ * Get the state of an Opus codec instance. The values are read without
+ * locking the encoder, so they may be one frame old.
+ *
+ * @param codec		The codec, which must be an Opus codec.
+ * @param stat		Receives the state.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_codec_opus_get_stat(pjmedia_codec *codec,
+					pjmedia_codec_opus_stat *stat);
+
 PJ_END_DECL
 
 
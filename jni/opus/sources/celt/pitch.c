@@ -47,6 +47,10 @@
 #include "mathops.h"
 #include "celt_lpc.h"
 
+#if defined(FIXED_POINT) && defined(OPUS_HAVE_PJMEDIA_DSP)
+#include <pjmedia/dsp.h>
+#endif
+
 static void find_best_pitch(opus_val32 *xcorr, opus_val16 *y, int len,
                             int max_pitch, int *best_pitch
 #ifdef FIXED_POINT
@@ -201,6 +205,14 @@ void pitch_search(const opus_val16 * restrict x_lp, opus_val16 * restrict y,
 
    /* Coarse search with 4x decimation */
 
+#if defined(FIXED_POINT) && defined(OPUS_HAVE_PJMEDIA_DSP)
+   pjmedia_dsp_xcorr16(x_lp4, y_lp4, xcorr, len>>2, max_pitch>>2);
+   for (i=0;i<max_pitch>>2;i++)
+   {
+      maxcorr = MAX32(maxcorr, xcorr[i]);
+      xcorr[i] = MAX32(-1, xcorr[i]);
+   }
+#else
    for (i=0;i<max_pitch>>2;i++)
    {
       opus_val32 sum = 0;
@@ -211,6 +223,7 @@ void pitch_search(const opus_val16 * restrict x_lp, opus_val16 * restrict y,
       maxcorr = MAX32(maxcorr, sum);
 #endif
    }
+#endif
    find_best_pitch(xcorr, y_lp4, len>>2, max_pitch>>2, best_pitch
 #ifdef FIXED_POINT
                    , 0, maxcorr
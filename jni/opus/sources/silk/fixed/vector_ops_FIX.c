@@ -31,6 +31,10 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "SigProc_FIX.h"
 
+#ifdef OPUS_HAVE_PJMEDIA_DSP
+#include <pjmedia/dsp.h>
+#endif
+
 /* Copy and multiply a vector by a constant */
 void silk_scale_copy_vector16(
     opus_int16                  *data_out,
@@ -73,12 +77,16 @@ opus_int32 silk_inner_prod_aligned(
     const opus_int              len                 /*    I vector lengths                                              */
 )
 {
+#ifdef OPUS_HAVE_PJMEDIA_DSP
+    return pjmedia_dsp_inner_prod16( inVec1, inVec2, len );
+#else
     opus_int   i;
     opus_int32 sum = 0;
     for( i = 0; i < len; i++ ) {
         sum = silk_SMLABB( sum, inVec1[ i ], inVec2[ i ] );
     }
     return sum;
+#endif
 }
 
 opus_int64 silk_inner_prod16_aligned_64(
@@ -25,10 +25,23 @@
 
 /*
  * C compatible declaration of Android factory.
+ *
+ * The device draws from the GL thread of the Java view, which must call the
+ * pjmedia_ogl_surface_*() functions below from its GLSurfaceView.Renderer.
+ * Until a view does, the device is left out of the Android build.
  */
 PJ_BEGIN_DECL
 PJ_DECL(pjmedia_vid_dev_factory*) pjmedia_ogl_factory(pj_pool_factory *pf);
 
+/*
+ * Call from the GL thread when a new GL context has been created, e.g. from
+ * onSurfaceCreated() of the GLSurfaceView renderer.
+ */
+PJ_DECL(pj_status_t) pjmedia_ogl_surface_created(void);
+/*
+ * Call from the GL thread when the surface size changes, e.g. from
+ * onSurfaceChanged() of the GLSurfaceView renderer.
+ */
 PJ_DECL(pj_status_t) pjmedia_ogl_surface_init(int width, int height);
 PJ_DECL(pj_status_t) pjmedia_ogl_surface_draw(float *mappingWidth, float *mappingHeight);
 PJ_END_DECL
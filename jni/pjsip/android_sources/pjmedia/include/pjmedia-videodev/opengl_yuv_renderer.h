@@ -0,0 +1,96 @@
+/**
+ * Copyright (C) 2010 Regis Montoya (aka r3gis - www.r3gis.fr)
+ * This file is part of pjsip_android.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENGL_YUV_RENDERER_H_
+#define OPENGL_YUV_RENDERER_H_
+
+#include <pjmedia/format.h>
+#include <pj/pool.h>
+
+/*
+ * OpenGL ES 2 frame renderer used by the OpenGL video device.
+ *
+ * It keeps one persistent texture per plane of the frame format, only
+ * updates their content with glTexSubImage2D() on each frame and does the
+ * YUV to RGB conversion in a fragment shader, so frames don't need any
+ * CPU color conversion before being rendered.
+ *
+ * It does not depend on the Android window system: the caller owns the GL
+ * context and must call the *_gl functions and draw from the thread where
+ * that context is current. This makes it usable with any GLES2 context,
+ * e.g. an EGL surfaceless one for testing.
+ */
+
+PJ_BEGIN_DECL
+
+typedef struct pjmedia_ogl_renderer pjmedia_ogl_renderer;
+
+/*
+ * Check whether frames of the specified format can be rendered.
+ */
+PJ_DECL(pj_bool_t) pjmedia_ogl_renderer_is_supported(pjmedia_format_id id);
+
+/*
+ * Create a renderer for frames of the specified video format. This does
+ * not touch GL, so it can be called from any thread.
+ */
+PJ_DECL(pj_status_t) pjmedia_ogl_renderer_create(pj_pool_t *pool,
+					      const pjmedia_format *fmt,
+					      pjmedia_ogl_renderer **p_rdr);
+
+/*
+ * Get the size of a frame accepted by pjmedia_ogl_renderer_upload().
+ */
+PJ_DECL(pj_size_t) pjmedia_ogl_renderer_frame_size(
+				const pjmedia_ogl_renderer *rdr);
+
+/*
+ * Create the shader program and the plane textures in the current GL
+ * context. Must be called again whenever the GL context is recreated.
+ * When it is called again in the same context, the objects created by
+ * the previous call are released first.
+ */
+PJ_DECL(pj_status_t) pjmedia_ogl_renderer_init_gl(pjmedia_ogl_renderer *rdr);
+
+/*
+ * Upload a new frame into the plane textures.
+ */
+PJ_DECL(pj_status_t) pjmedia_ogl_renderer_upload(pjmedia_ogl_renderer *rdr,
+					      const void *buf);
+
+/*
+ * Draw the last uploaded frame to the whole current viewport.
+ */
+PJ_DECL(pj_status_t) pjmedia_ogl_renderer_draw(pjmedia_ogl_renderer *rdr);
+
+/*
+ * Release the GL objects owned by the renderer. Must be called from the
+ * GL thread while the context is still current.
+ */
+PJ_DECL(void) pjmedia_ogl_renderer_release_gl(pjmedia_ogl_renderer *rdr);
+
+/*
+ * Forget the GL objects owned by the renderer without deleting them. Call
+ * this when the GL context has been lost, since the objects went away with
+ * it and their names may be reused by the new context.
+ */
+PJ_DECL(void) pjmedia_ogl_renderer_reset_gl(pjmedia_ogl_renderer *rdr);
+
+PJ_END_DECL
+
+
+#endif /* OPENGL_YUV_RENDERER_H_ */
@@ -512,8 +512,9 @@ JNIEXPORT void JNICALL Java_com_csipsimple_ui_camera_VideoProducer_pushToNative
     		pj_mutex_unlock(current_capture_stream->frame_mutex);
     	}
 
-        //release arrays:
-        (*env)->ReleaseByteArrayElements(env, pinArray, inArray, 0);
+        //release arrays: we only read the frame, so don't let the VM copy
+        //it back into the java array if it handed us a copy
+        (*env)->ReleaseByteArrayElements(env, pinArray, inArray, JNI_ABORT);
 }
 
 
@@ -19,8 +19,10 @@
 #include <pj/log.h>
 #include <pj/os.h>
 
-#include <GLES/gl.h>
-#include <GLES/glext.h>
+#include "opengl_video_dev.h"
+#include "opengl_yuv_renderer.h"
+
+#include <GLES2/gl2.h>
 
 #define USE_CONVERTER 0
 #define USE_CSIPSIMPLE 1
@@ -33,36 +35,16 @@
 #define DEFAULT_FPS		15
 
 
-typedef struct ogl_fmt_info
-{
-    pjmedia_format_id   fmt_id;
-    GLenum internalFormat;
-    GLenum format;
-    GLenum type;
-} ogl_fmt_info;
-
-static ogl_fmt_info ogl_fmts[] =
+/* Formats rendered natively, YUV ones are converted by the fragment shader
+ * so the first one matches what the video decoders output.
+ */
+static pjmedia_format_id ogl_fmts[] =
 {
-
-    {PJMEDIA_FORMAT_RGBA,  GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE} ,
-//    {PJMEDIA_FORMAT_BGRA,  GL_BGRA, GL_BGRA, GL_UNSIGNED_BYTE} ,
-
-  //  {PJMEDIA_FORMAT_YUY2 , GL_LUMINANCE, GL_LUMINANCE, GL_UNSIGNED_BYTE}
-    //{PJMEDIA_FORMAT_RGB24, GL_RGB, GL_UNSIGNED_SHORT_4_4_4} ,
-    /*
-    {PJMEDIA_FORMAT_RGB24, 0, 0xFF, 0xFF00, 0xFF0000, 0} ,
-    {PJMEDIA_FORMAT_BGRA,  0, 0xFF0000, 0xFF00, 0xFF, 0xFF000000} ,
-
-    {PJMEDIA_FORMAT_DIB  , 0, 0xFF0000, 0xFF00, 0xFF, 0} ,
-
-    {PJMEDIA_FORMAT_YUY2, SDL_YUY2_OVERLAY, 0, 0, 0, 0} ,
-    {PJMEDIA_FORMAT_UYVY, SDL_UYVY_OVERLAY, 0, 0, 0, 0} ,
-    {PJMEDIA_FORMAT_YVYU, SDL_YVYU_OVERLAY, 0, 0, 0, 0} ,
-    {PJMEDIA_FORMAT_I420, SDL_IYUV_OVERLAY, 0, 0, 0, 0} ,
-    {PJMEDIA_FORMAT_YV12, SDL_YV12_OVERLAY, 0, 0, 0, 0} ,
-    {PJMEDIA_FORMAT_I420JPEG, SDL_IYUV_OVERLAY, 0, 0, 0, 0} ,
-    {PJMEDIA_FORMAT_I422JPEG, SDL_YV12_OVERLAY, 0, 0, 0, 0} ,
-    */
+    PJMEDIA_FORMAT_I420,
+    PJMEDIA_FORMAT_NV21,
+    PJMEDIA_FORMAT_NV12,
+    PJMEDIA_FORMAT_YV12,
+    PJMEDIA_FORMAT_RGBA,
 };
 
 
@@ -98,21 +80,15 @@ struct ogl_stream
     pj_bool_t			 render_exited;
     pj_status_t			 status;
 
-    // Gl texture infos
-    GLint textureWidth;
-    GLint textureHeight;
-    GLint frameWidth;
-    GLint frameHeight;
-    float glMappingWidth;
-    float glMappingHeight;
-    GLenum glInternalFormat;
-    GLenum glFormat;
-    GLenum glType;
-    // Gl texture state
-    pj_bool_t need_glTex_init;
+    // Gl renderer, its textures persist across frames
+    pjmedia_ogl_renderer *rdr;
+    // Gl renderer state
+    pj_bool_t need_gl_init;
+    // Set by destroy, for the GL thread to delete the GL objects
+    pj_bool_t need_gl_release;
     pj_mutex_t* frame_mutex;
     pj_bool_t has_changed;
-    //Gl texture datas
+    //Last frame, waiting for the GL thread to upload it
     void* imageData;
     pj_size_t imageSize;
 
@@ -224,7 +200,7 @@ static pj_status_t ogl_factory_init(pjmedia_vid_dev_factory *f)
     ddi->info.fmt_cnt = PJ_ARRAY_SIZE(ogl_fmts);
     for (i = 0; i < ddi->info.fmt_cnt; i++) {
         pjmedia_format *fmt = &ddi->info.fmt[i];
-        pjmedia_format_init_video(fmt, ogl_fmts[i].fmt_id,
+        pjmedia_format_init_video(fmt, ogl_fmts[i],
 				  DEFAULT_WIDTH, DEFAULT_HEIGHT,
 				  DEFAULT_FPS, 1);
     }
@@ -301,27 +277,13 @@ static pj_status_t ogl_factory_default_param(pj_pool_t *pool,
     param->flags = PJMEDIA_VID_DEV_CAP_FORMAT;
     param->fmt.type = PJMEDIA_TYPE_VIDEO;
     param->clock_rate = DEFAULT_CLOCK_RATE;
-    pjmedia_format_init_video(&param->fmt, ogl_fmts[0].fmt_id,
+    pjmedia_format_init_video(&param->fmt, ogl_fmts[0],
 			      DEFAULT_WIDTH, DEFAULT_HEIGHT,
 			      DEFAULT_FPS, 1);
 
     return PJ_SUCCESS;
 }
 
-static ogl_fmt_info* get_ogl_format_info(pjmedia_format_id id)
-{
-    unsigned i;
-
-    for (i = 0; i < sizeof(ogl_fmts)/sizeof(ogl_fmts[0]); i++) {
-        if (ogl_fmts[i].fmt_id == id)
-            return &ogl_fmts[i];
-    }
-
-    return NULL;
-}
-
-
-
 /* API: create stream */
 static pj_status_t ogl_factory_create_stream(
 					pjmedia_vid_dev_factory *f,
@@ -334,9 +296,6 @@ static pj_status_t ogl_factory_create_stream(
     pj_pool_t *pool;
     struct ogl_stream *strm;
     pj_status_t status;
-    pjmedia_video_format_detail *vfd;
-    const pjmedia_video_format_info *vfi;
-    ogl_fmt_info *ogl_fmt_info;
 
 
     /* Create and Initialize stream descriptor */
@@ -354,56 +313,29 @@ static pj_status_t ogl_factory_create_stream(
     if (param->dir & PJMEDIA_DIR_RENDER) {
         strm->status = PJ_SUCCESS;
 
-        // Get basic ogl-es parameters
-		vfd = pjmedia_format_get_video_format_detail(&strm->param.fmt, PJ_TRUE);
-
-
-		strm->frameWidth = (GLint)vfd->size.w;
-		strm->frameHeight = (GLint)vfd->size.h;
-
-		// Is that a supported format ?
-		ogl_fmt_info = get_ogl_format_info(strm->param.fmt.id);
+        // Is that a supported format ?
 		PJ_LOG(3, (THIS_FILE, "Requiring format : %d", strm->param.fmt.id));
-		if(ogl_fmt_info == NULL){
+		status = pjmedia_ogl_renderer_create(strm->pool, &strm->param.fmt,
+						     &strm->rdr);
+		if (status != PJ_SUCCESS) {
 			PJ_LOG(1, (THIS_FILE, "Bad format : %d", strm->param.fmt.id));
-	    	status = PJMEDIA_EVID_BADFORMAT;
-	    	goto on_error;
-		}
-
-		vfi = pjmedia_get_video_format_info(pjmedia_video_format_mgr_instance(), ogl_fmt_info->fmt_id);
-
-		strm->glInternalFormat = ogl_fmt_info->internalFormat;
-		strm->glFormat = ogl_fmt_info->format;
-		strm->glType = ogl_fmt_info->type;
-
-		//OpenGL-ES Only support pow x 2 textures so upscale texture with to lower matching sizes
-		GLint i = 64;
-		while( i <  strm->frameWidth){
-				i *= 2;
-		}
-		strm->textureWidth = i;
-		i = 64;
-		while( i <  strm->frameHeight){
-				i *= 2;
+			goto on_error;
 		}
-		strm->textureHeight = i;
 
-		strm->need_glTex_init = PJ_TRUE;
+		// GL objects can only be created from the GL thread, on next draw
+		strm->need_gl_init = PJ_TRUE;
 		strm->has_changed = PJ_FALSE;
 		strm->has_set_render_thread_prio = PJ_FALSE;
-		strm->glMappingWidth = (float) strm->frameWidth / (float) strm->textureWidth;
-		strm->glMappingHeight = (float) strm->frameHeight / (float) strm->textureHeight;
 
-
-
-		PJ_LOG(4, (THIS_FILE, "We expect : %d x %d x %d", strm->frameWidth , strm->frameHeight, vfi->bpp >> 3));
-		PJ_LOG(4, (THIS_FILE, "GL mapping is : %f x %f",  strm->glMappingWidth, strm->glMappingHeight));
-
-		strm->imageSize = strm->frameWidth * strm->frameHeight * (vfi->bpp >> 3);
-		strm->imageData = pj_pool_alloc(sf->pool, strm->imageSize);
+		strm->imageSize = pjmedia_ogl_renderer_frame_size(strm->rdr);
+		strm->imageData = pj_pool_alloc(strm->pool, strm->imageSize);
 		pj_bzero(strm->imageData, strm->imageSize);
 		pj_mutex_create_simple(strm->pool, "opengl-es", &strm->frame_mutex);
 
+		PJ_LOG(4, (THIS_FILE, "We expect : %d x %d, %d bytes per frame",
+			   strm->param.fmt.det.vid.size.w,
+			   strm->param.fmt.det.vid.size.h, strm->imageSize));
+
     }
 
 	/* Apply the remaining settings */
@@ -486,7 +418,6 @@ static pj_status_t ogl_stream_put_frame(pjmedia_vid_dev_stream *strm,
                                         const pjmedia_frame *frame)
 {
     struct ogl_stream *stream = (struct ogl_stream*)strm;
-    int i;
     pj_status_t status = PJ_SUCCESS;
 
 
@@ -506,14 +437,14 @@ static pj_status_t ogl_stream_put_frame(pjmedia_vid_dev_stream *strm,
 //    }
 #endif
 
-    // Sounds that's not really hurting to push incomplete frames so useless to protect imageData
-    // since we are always pointing same memory location and RGBA (worse case some px wrong)
-	//PJ_LOG(4, (THIS_FILE, "Direct frame"));
-	//pj_mutex_lock(stream->frame_mutex);
-	//PJ_LOG(4, (THIS_FILE, "Direct frame push"));
-	pj_memcpy(stream->imageData, frame->buf, frame->size);
-	current_stream->has_changed = PJ_TRUE;
-	//pj_mutex_unlock(stream->frame_mutex);
+    // YUV planes are uploaded separately, so protect imageData to avoid
+    // mixing the luma of a frame with the chroma of the next one
+	pj_mutex_lock(stream->frame_mutex);
+	pj_memcpy(stream->imageData, frame->buf,
+		  (frame->size < stream->imageSize? frame->size:
+		   stream->imageSize));
+	stream->has_changed = PJ_TRUE;
+	pj_mutex_unlock(stream->frame_mutex);
 
 on_return:
     return status;
@@ -553,15 +484,6 @@ static pj_status_t ogl_stream_stop(pjmedia_vid_dev_stream *strm)
     	pj_thread_sleep(10);
     }
 
-    //pj_mutex_lock(stream->frame_mutex);
-
-    stream->textureHeight = 0;
-    stream->textureWidth = 0;
-    stream->frameHeight = 0;
-    stream->frameWidth = 0;
-
-    //pj_mutex_unlock(stream->frame_mutex);
-
     PJ_LOG(4, (THIS_FILE, "Stopped opengl video stream"));
     return PJ_SUCCESS;
 }
@@ -577,6 +499,25 @@ static pj_status_t ogl_stream_destroy(pjmedia_vid_dev_stream *strm)
     PJ_LOG(4, (THIS_FILE, "Destroying opengl video stream"));
     ogl_stream_stop(strm);
 
+    /* GL objects can only be deleted from the GL thread, wait for the
+     * next draw to release them.
+     */
+    if (stream->rdr && !stream->need_gl_init) {
+	unsigned i;
+
+	pj_mutex_lock(stream->frame_mutex);
+	stream->need_gl_release = PJ_TRUE;
+	pj_mutex_unlock(stream->frame_mutex);
+
+	for (i=0; stream->need_gl_release && i<100; ++i) {
+	    pj_thread_sleep(10);
+	}
+	if (stream->need_gl_release) {
+	    PJ_LOG(3, (THIS_FILE, "GL thread did not release the renderer, "
+			  "its GL objects are left to the GL context"));
+	}
+    }
+
     //pj_mutex_lock(stream->frame_mutex);
     current_stream = NULL;
     //pj_mutex_unlock(stream->frame_mutex);
@@ -590,51 +531,80 @@ static pj_status_t ogl_stream_destroy(pjmedia_vid_dev_stream *strm)
 
 
 
-PJ_DECL(pj_status_t) pjmedia_ogl_surface_init(int width,
+PJ_DEF(pj_status_t) pjmedia_ogl_surface_created(void) {
+	// The GL context is new, objects of the previous one are gone
+	if (current_stream != NULL) {
+		pj_mutex_lock(current_stream->frame_mutex);
+		pjmedia_ogl_renderer_reset_gl(current_stream->rdr);
+		current_stream->need_gl_init = PJ_TRUE;
+		current_stream->has_changed = PJ_TRUE;
+		pj_mutex_unlock(current_stream->frame_mutex);
+	}
+	return PJ_SUCCESS;
+}
+
+
+PJ_DEF(pj_status_t) pjmedia_ogl_surface_init(int width,
 		int height) {
-//
+	glViewport(0, 0, width, height);
+
+	// Same context, the textures are kept and only need a redraw
+	if (current_stream != NULL) {
+		pj_mutex_lock(current_stream->frame_mutex);
+		current_stream->has_changed = PJ_TRUE;
+		pj_mutex_unlock(current_stream->frame_mutex);
+	}
 	return PJ_SUCCESS;
 }
 
 
-PJ_DECL(pj_status_t) pjmedia_ogl_surface_draw(float *mappingWidth, float *mappingHeight){
+PJ_DEF(pj_status_t) pjmedia_ogl_surface_draw(float *mappingWidth, float *mappingHeight){
+	struct ogl_stream *stream = current_stream;
+	pj_status_t status = PJ_SUCCESS;
+
 	*mappingHeight = 0.0f;
 	*mappingWidth = 0.0f;
 
-	if( current_stream != NULL && current_stream->textureWidth > 0 && current_stream->textureHeight > 0 && current_stream->is_running ){
-
-
-		//pj_mutex_lock(current_stream->frame_mutex);
+	if (stream != NULL && stream->need_gl_release) {
+		// The stream is being destroyed
+		pj_mutex_lock(stream->frame_mutex);
+		pjmedia_ogl_renderer_release_gl(stream->rdr);
+		stream->need_gl_init = PJ_TRUE;
+		stream->need_gl_release = PJ_FALSE;
+		pj_mutex_unlock(stream->frame_mutex);
+		return PJ_SUCCESS;
+	}
 
-		if(current_stream->need_glTex_init){
-			//Fill the entiere image with empty
-			glTexImage2D(GL_TEXTURE_2D, 0,
-					current_stream->glInternalFormat,
-					current_stream->textureWidth, current_stream->textureHeight, 0,
-					current_stream->glFormat, current_stream->glType, (GLvoid *) NULL);
-			current_stream->need_glTex_init = PJ_FALSE;
-			// Sounds this is maybe necessary, else android probably consider the texture as invalid... weird... to investigate
-		}
+	if (stream == NULL || !stream->is_running) {
+		//TODO : return not init if here
+		return PJ_SUCCESS;
+	}
 
-		if(current_stream->has_changed){
-			// Update relevant portion
-			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
-					current_stream->frameWidth, current_stream->frameHeight,
-					current_stream->glFormat, current_stream->glType, current_stream->imageData);
-			current_stream->has_changed = PJ_FALSE;
-		}
+	pj_mutex_lock(stream->frame_mutex);
 
-		//pj_mutex_unlock(current_stream->frame_mutex);
+	if (stream->need_gl_init) {
+		// Textures are allocated once here, frames only update them
+		status = pjmedia_ogl_renderer_init_gl(stream->rdr);
+		if (status == PJ_SUCCESS)
+			stream->need_gl_init = PJ_FALSE;
+	}
 
+	if (status == PJ_SUCCESS && stream->has_changed) {
+		status = pjmedia_ogl_renderer_upload(stream->rdr, stream->imageData);
+		stream->has_changed = PJ_FALSE;
+	}
 
-		//imageData
-		*mappingHeight = current_stream->glMappingHeight;
-		*mappingWidth = current_stream->glMappingWidth;
+	pj_mutex_unlock(stream->frame_mutex);
 
+	if (status != PJ_SUCCESS)
+		return status;
 
+	status = pjmedia_ogl_renderer_draw(stream->rdr);
 
+	// Textures have the exact frame size and the renderer draws the
+	// whole viewport itself
+	*mappingHeight = 1.0f;
+	*mappingWidth = 1.0f;
 
-	}
-	//TODO : return not init if here
-	return PJ_SUCCESS;
+	return status;
 }
@@ -0,0 +1,431 @@
+/**
+ * Copyright (C) 2010 Regis Montoya (aka r3gis - www.r3gis.fr)
+ * This file is part of pjsip_android.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "opengl_yuv_renderer.h"
+#include <pjmedia-videodev/errno.h>
+#include <pj/assert.h>
+#include <pj/log.h>
+#include <pj/string.h>
+
+#include <GLES2/gl2.h>
+
+#define THIS_FILE		"opengl_yuv_renderer.c"
+#define MAX_PLANES		3
+
+
+/* Fragment shader sampling, one per plane layout */
+enum ogl_layout
+{
+    OGL_LAYOUT_RGBA,	    /* One RGBA plane			    */
+    OGL_LAYOUT_PLANAR,	    /* Y, U and V planes		    */
+    OGL_LAYOUT_UV,	    /* Y plane and interleaved U+V plane    */
+    OGL_LAYOUT_VU	    /* Y plane and interleaved V+U plane    */
+};
+
+typedef struct ogl_fmt_layout
+{
+    pjmedia_format_id	fmt_id;
+    enum ogl_layout	layout;
+    /* Texture unit of each frame plane, i.e: which sampler of the shader
+     * reads it.
+     */
+    unsigned		tex_unit[MAX_PLANES];
+} ogl_fmt_layout;
+
+static const ogl_fmt_layout ogl_layouts[] =
+{
+    {PJMEDIA_FORMAT_RGBA, OGL_LAYOUT_RGBA,   {0} },
+    {PJMEDIA_FORMAT_I420, OGL_LAYOUT_PLANAR, {0, 1, 2} },
+    {PJMEDIA_FORMAT_YV12, OGL_LAYOUT_PLANAR, {0, 2, 1} },
+    {PJMEDIA_FORMAT_NV12, OGL_LAYOUT_UV,     {0, 1} },
+    {PJMEDIA_FORMAT_NV21, OGL_LAYOUT_VU,     {0, 1} },
+};
+
+typedef struct ogl_plane
+{
+    GLsizei		width;
+    GLsizei		height;
+    GLenum		gl_format;
+    pj_size_t		offset;
+    GLuint		tex;
+} ogl_plane;
+
+struct pjmedia_ogl_renderer
+{
+    const ogl_fmt_layout *fl;
+    unsigned		 plane_cnt;
+    ogl_plane		 planes[MAX_PLANES];
+    pj_size_t		 frame_size;
+
+    GLuint		 program;
+    GLint		 a_pos;
+    GLint		 a_tex;
+    pj_bool_t		 gl_ready;
+};
+
+static const char vertex_shader[] =
+    "attribute vec4 a_pos;\n"
+    "attribute vec2 a_tex;\n"
+    "varying vec2 v_tex;\n"
+    "void main() {\n"
+    "    gl_Position = a_pos;\n"
+    "    v_tex = a_tex;\n"
+    "}\n";
+
+#define FRAG_HEADER \
+    "precision mediump float;\n" \
+    "varying vec2 v_tex;\n" \
+    "uniform sampler2D s_tex0;\n" \
+    "uniform sampler2D s_tex1;\n" \
+    "uniform sampler2D s_tex2;\n" \
+    "void main() {\n"
+
+/* BT.601 limited range YUV to RGB */
+#define FRAG_YUV_TO_RGB \
+    "    y = 1.1643 * (y - 0.0625);\n" \
+    "    u = u - 0.5;\n" \
+    "    v = v - 0.5;\n" \
+    "    gl_FragColor = vec4(y + 1.5958 * v,\n" \
+    "                        y - 0.39173 * u - 0.81290 * v,\n" \
+    "                        y + 2.017 * u,\n" \
+    "                        1.0);\n" \
+    "}\n"
+
+static const char *fragment_shaders[] =
+{
+    /* OGL_LAYOUT_RGBA */
+    FRAG_HEADER
+    "    gl_FragColor = texture2D(s_tex0, v_tex);\n"
+    "}\n",
+
+    /* OGL_LAYOUT_PLANAR */
+    FRAG_HEADER
+    "    float y = texture2D(s_tex0, v_tex).r;\n"
+    "    float u = texture2D(s_tex1, v_tex).r;\n"
+    "    float v = texture2D(s_tex2, v_tex).r;\n"
+    FRAG_YUV_TO_RGB,
+
+    /* OGL_LAYOUT_UV, interleaved chroma is uploaded as luminance/alpha */
+    FRAG_HEADER
+    "    float y = texture2D(s_tex0, v_tex).r;\n"
+    "    vec4 c = texture2D(s_tex1, v_tex);\n"
+    "    float u = c.r;\n"
+    "    float v = c.a;\n"
+    FRAG_YUV_TO_RGB,
+
+    /* OGL_LAYOUT_VU */
+    FRAG_HEADER
+    "    float y = texture2D(s_tex0, v_tex).r;\n"
+    "    vec4 c = texture2D(s_tex1, v_tex);\n"
+    "    float u = c.a;\n"
+    "    float v = c.r;\n"
+    FRAG_YUV_TO_RGB,
+};
+
+/* Full viewport quad, the first frame row is on top */
+static const GLfloat quad_pos[] =
+{
+    -1.0f, -1.0f,   1.0f, -1.0f,   -1.0f, 1.0f,   1.0f, 1.0f
+};
+static const GLfloat quad_tex[] =
+{
+    0.0f, 1.0f,     1.0f, 1.0f,     0.0f, 0.0f,    1.0f, 0.0f
+};
+
+
+static const ogl_fmt_layout* get_fmt_layout(pjmedia_format_id id)
+{
+    unsigned i;
+
+    for (i = 0; i < PJ_ARRAY_SIZE(ogl_layouts); ++i) {
+	if (ogl_layouts[i].fmt_id == id)
+	    return &ogl_layouts[i];
+    }
+
+    return NULL;
+}
+
+PJ_DEF(pj_bool_t) pjmedia_ogl_renderer_is_supported(pjmedia_format_id id)
+{
+    return get_fmt_layout(id) != NULL;
+}
+
+PJ_DEF(pj_status_t) pjmedia_ogl_renderer_create(pj_pool_t *pool,
+					     const pjmedia_format *fmt,
+					     pjmedia_ogl_renderer **p_rdr)
+{
+    pjmedia_ogl_renderer *rdr;
+    const ogl_fmt_layout *fl;
+    const pjmedia_video_format_info *vfi;
+    pjmedia_video_apply_fmt_param vafp;
+    pj_size_t offset = 0;
+    unsigned i;
+
+    PJ_ASSERT_RETURN(pool && fmt && p_rdr, PJ_EINVAL);
+    PJ_ASSERT_RETURN(fmt->type == PJMEDIA_TYPE_VIDEO &&
+		     fmt->detail_type == PJMEDIA_FORMAT_DETAIL_VIDEO,
+		     PJ_EINVAL);
+
+    fl = get_fmt_layout(fmt->id);
+    vfi = pjmedia_get_video_format_info(NULL, fmt->id);
+    if (!fl || !vfi)
+	return PJMEDIA_EVID_BADFORMAT;
+
+    pj_bzero(&vafp, sizeof(vafp));
+    vafp.size = fmt->det.vid.size;
+    if ((*vfi->apply_fmt)(vfi, &vafp) != PJ_SUCCESS)
+	return PJMEDIA_EVID_BADFORMAT;
+
+    rdr = PJ_POOL_ZALLOC_T(pool, pjmedia_ogl_renderer);
+    rdr->fl = fl;
+    rdr->plane_cnt = vfi->plane_cnt;
+    rdr->frame_size = vafp.framebytes;
+
+    for (i = 0; i < rdr->plane_cnt; ++i) {
+	ogl_plane *pl = &rdr->planes[i];
+
+	pl->offset = offset;
+	offset += vafp.plane_bytes[i];
+
+	switch (fl->layout) {
+	case OGL_LAYOUT_RGBA:
+	    pl->gl_format = GL_RGBA;
+	    pl->width = vafp.strides[i] / 4;
+	    break;
+	case OGL_LAYOUT_PLANAR:
+	    pl->gl_format = GL_LUMINANCE;
+	    pl->width = vafp.strides[i];
+	    break;
+	default:
+	    /* One byte per sample for luma, two for interleaved chroma */
+	    pl->gl_format = (i == 0? GL_LUMINANCE: GL_LUMINANCE_ALPHA);
+	    pl->width = (i == 0? vafp.strides[i]: vafp.strides[i] / 2);
+	    break;
+	}
+	pl->height = (GLsizei)(vafp.plane_bytes[i] / vafp.strides[i]);
+    }
+
+    *p_rdr = rdr;
+
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_size_t) pjmedia_ogl_renderer_frame_size(
+				const pjmedia_ogl_renderer *rdr)
+{
+    return rdr->frame_size;
+}
+
+static GLuint compile_shader(GLenum type, const char *src)
+{
+    GLuint shader;
+    GLint compiled = 0;
+
+    shader = glCreateShader(type);
+    if (!shader)
+	return 0;
+
+    glShaderSource(shader, 1, &src, NULL);
+    glCompileShader(shader);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+	char log[256];
+
+	glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+	PJ_LOG(2, (THIS_FILE, "Shader compilation failed: %s", log));
+	glDeleteShader(shader);
+	return 0;
+    }
+
+    return shader;
+}
+
+static pj_status_t create_program(pjmedia_ogl_renderer *rdr)
+{
+    GLuint vs, fs;
+    GLint linked = 0;
+    unsigned i;
+
+    vs = compile_shader(GL_VERTEX_SHADER, vertex_shader);
+    fs = compile_shader(GL_FRAGMENT_SHADER,
+			fragment_shaders[rdr->fl->layout]);
+    if (!vs || !fs) {
+	if (vs) glDeleteShader(vs);
+	if (fs) glDeleteShader(fs);
+	return PJMEDIA_EVID_SYSERR;
+    }
+
+    rdr->program = glCreateProgram();
+    glAttachShader(rdr->program, vs);
+    glAttachShader(rdr->program, fs);
+    glLinkProgram(rdr->program);
+
+    /* The program keeps them alive as long as it needs them */
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    glGetProgramiv(rdr->program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+	PJ_LOG(2, (THIS_FILE, "Shader program link failed"));
+	glDeleteProgram(rdr->program);
+	rdr->program = 0;
+	return PJMEDIA_EVID_SYSERR;
+    }
+
+    rdr->a_pos = glGetAttribLocation(rdr->program, "a_pos");
+    rdr->a_tex = glGetAttribLocation(rdr->program, "a_tex");
+
+    /* Samplers never change, bind them once */
+    glUseProgram(rdr->program);
+    for (i = 0; i < MAX_PLANES; ++i) {
+	char name[8];
+	GLint loc;
+
+	pj_ansi_snprintf(name, sizeof(name), "s_tex%d", i);
+	loc = glGetUniformLocation(rdr->program, name);
+	if (loc >= 0)
+	    glUniform1i(loc, i);
+    }
+
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pjmedia_ogl_renderer_init_gl(pjmedia_ogl_renderer *rdr)
+{
+    pj_status_t status;
+    unsigned i;
+
+    PJ_ASSERT_RETURN(rdr, PJ_EINVAL);
+
+    /* The objects of a previous init still belong to the current context,
+     * unless pjmedia_ogl_renderer_reset_gl() has been called after the
+     * context was lost.
+     */
+    pjmedia_ogl_renderer_release_gl(rdr);
+
+    status = create_program(rdr);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    /* Textures are sized to the planes once, frames then only update
+     * their content.
+     */
+    for (i = 0; i < rdr->plane_cnt; ++i) {
+	ogl_plane *pl = &rdr->planes[i];
+
+	glGenTextures(1, &pl->tex);
+	glBindTexture(GL_TEXTURE_2D, pl->tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, pl->gl_format, pl->width, pl->height,
+		     0, pl->gl_format, GL_UNSIGNED_BYTE, NULL);
+    }
+
+    if (glGetError() != GL_NO_ERROR) {
+	pjmedia_ogl_renderer_release_gl(rdr);
+	return PJMEDIA_EVID_SYSERR;
+    }
+
+    rdr->gl_ready = PJ_TRUE;
+
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pjmedia_ogl_renderer_upload(pjmedia_ogl_renderer *rdr,
+					     const void *buf)
+{
+    const pj_uint8_t *p = (const pj_uint8_t*)buf;
+    unsigned i;
+
+    PJ_ASSERT_RETURN(rdr && buf, PJ_EINVAL);
+    PJ_ASSERT_RETURN(rdr->gl_ready, PJ_EINVALIDOP);
+
+    for (i = 0; i < rdr->plane_cnt; ++i) {
+	ogl_plane *pl = &rdr->planes[i];
+
+	glBindTexture(GL_TEXTURE_2D, pl->tex);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pl->width, pl->height,
+			pl->gl_format, GL_UNSIGNED_BYTE, p + pl->offset);
+    }
+
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(pj_status_t) pjmedia_ogl_renderer_draw(pjmedia_ogl_renderer *rdr)
+{
+    unsigned i;
+
+    PJ_ASSERT_RETURN(rdr, PJ_EINVAL);
+    PJ_ASSERT_RETURN(rdr->gl_ready, PJ_EINVALIDOP);
+
+    glUseProgram(rdr->program);
+
+    for (i = 0; i < rdr->plane_cnt; ++i) {
+	glActiveTexture(GL_TEXTURE0 + rdr->fl->tex_unit[i]);
+	glBindTexture(GL_TEXTURE_2D, rdr->planes[i].tex);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    glVertexAttribPointer(rdr->a_pos, 2, GL_FLOAT, GL_FALSE, 0, quad_pos);
+    glEnableVertexAttribArray(rdr->a_pos);
+    glVertexAttribPointer(rdr->a_tex, 2, GL_FLOAT, GL_FALSE, 0, quad_tex);
+    glEnableVertexAttribArray(rdr->a_tex);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glDisableVertexAttribArray(rdr->a_pos);
+    glDisableVertexAttribArray(rdr->a_tex);
+
+    return PJ_SUCCESS;
+}
+
+PJ_DEF(void) pjmedia_ogl_renderer_release_gl(pjmedia_ogl_renderer *rdr)
+{
+    unsigned i;
+
+    if (!rdr)
+	return;
+
+    for (i = 0; i < rdr->plane_cnt; ++i) {
+	if (rdr->planes[i].tex) {
+	    glDeleteTextures(1, &rdr->planes[i].tex);
+	    rdr->planes[i].tex = 0;
+	}
+    }
+    if (rdr->program) {
+	glDeleteProgram(rdr->program);
+	rdr->program = 0;
+    }
+    rdr->gl_ready = PJ_FALSE;
+}
+
+PJ_DEF(void) pjmedia_ogl_renderer_reset_gl(pjmedia_ogl_renderer *rdr)
+{
+    unsigned i;
+
+    if (!rdr)
+	return;
+
+    /* The context and its objects are gone, only forget the names */
+    for (i = 0; i < rdr->plane_cnt; ++i)
+	rdr->planes[i].tex = 0;
+    rdr->program = 0;
+    rdr->gl_ready = PJ_FALSE;
+}
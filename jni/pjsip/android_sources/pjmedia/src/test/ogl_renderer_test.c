@@ -0,0 +1,322 @@
+/**
+ * Copyright (C) 2010 Regis Montoya (aka r3gis - www.r3gis.fr)
+ * This file is part of pjsip_android.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Headless test and frame time benchmark of the OpenGL ES 2 renderer used
+ * by the OpenGL video device (opengl_yuv_renderer.c).
+ *
+ * The renderer has no Android dependency, so this runs on a desktop with
+ * an EGL implementation that supports surfaceless contexts, e.g. Mesa
+ * (llvmpipe when there is no GPU). It is not part of the NDK build, build
+ * it against a host pjlib, for example:
+ *
+ *   gcc -DPJMEDIA_HAS_VIDEO=1 <pjlib and pjmedia include flags> \
+ *	 -Iandroid_sources/pjmedia/include/pjmedia-videodev \
+ *	 ogl_renderer_test.c opengl_yuv_renderer.c pjmedia/format.c \
+ *	 <pjlib sources or library> -lEGL -lGLESv2
+ *
+ * For each supported format, it renders a red frame and checks the color
+ * read back. It renders it again after init_gl() is called again in the
+ * same context, checking that no texture is leaked, and after the context
+ * is replaced by a new one. Then it measures upload+draw+glFinish() time
+ * per frame.
+ */
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <pjlib.h>
+#include <pjmedia/format.h>
+
+#include "opengl_yuv_renderer.h"
+
+#define THIS_FILE	"ogl_renderer_test.c"
+#define WIDTH		640
+#define HEIGHT		480
+#define BENCH_FRAMES	200
+#define TOLERANCE	8
+
+typedef struct gl_target
+{
+    EGLDisplay	dpy;
+    EGLConfig	cfg;
+    EGLContext	ctx;
+    GLuint	fbo;
+    GLuint	color_tex;
+} gl_target;
+
+static pjmedia_format_id test_fmts[] =
+{
+    PJMEDIA_FORMAT_I420,
+    PJMEDIA_FORMAT_YV12,
+    PJMEDIA_FORMAT_NV12,
+    PJMEDIA_FORMAT_NV21,
+    PJMEDIA_FORMAT_RGBA,
+};
+
+static int open_display(gl_target *t)
+{
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display;
+    EGLint cfg_attr[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			  EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+			  EGL_NONE };
+    EGLint major, minor, cnt = 0;
+
+    get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+			   eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (!get_platform_display)
+	return -10;
+
+    t->dpy = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+				  EGL_DEFAULT_DISPLAY, NULL);
+    if (t->dpy == EGL_NO_DISPLAY || !eglInitialize(t->dpy, &major, &minor))
+	return -20;
+
+    eglBindAPI(EGL_OPENGL_ES_API);
+    if (!eglChooseConfig(t->dpy, cfg_attr, &t->cfg, 1, &cnt) || cnt < 1)
+	return -30;
+
+    return 0;
+}
+
+/* Create a context with an offscreen color buffer and make it current */
+static int create_context(gl_target *t)
+{
+    EGLint ctx_attr[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+
+    t->ctx = eglCreateContext(t->dpy, t->cfg, EGL_NO_CONTEXT, ctx_attr);
+    if (t->ctx == EGL_NO_CONTEXT)
+	return -40;
+    if (!eglMakeCurrent(t->dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, t->ctx))
+	return -50;
+
+    glGenTextures(1, &t->color_tex);
+    glBindTexture(GL_TEXTURE_2D, t->color_tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, WIDTH, HEIGHT, 0, GL_RGBA,
+		 GL_UNSIGNED_BYTE, NULL);
+    glGenFramebuffers(1, &t->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, t->fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+			   GL_TEXTURE_2D, t->color_tex, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	return -60;
+
+    glViewport(0, 0, WIDTH, HEIGHT);
+
+    return 0;
+}
+
+static void destroy_context(gl_target *t)
+{
+    eglMakeCurrent(t->dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(t->dpy, t->ctx);
+    t->ctx = EGL_NO_CONTEXT;
+}
+
+/* Fill the frame with pure red, Y=81 U=90 V=240 in BT.601 */
+static void fill_red(pjmedia_format_id id, pj_uint8_t *buf)
+{
+    const unsigned ysize = WIDTH * HEIGHT;
+    unsigned i;
+
+    if (id == PJMEDIA_FORMAT_RGBA) {
+	for (i = 0; i < ysize; ++i) {
+	    buf[4*i] = 255;
+	    buf[4*i+1] = 0;
+	    buf[4*i+2] = 0;
+	    buf[4*i+3] = 255;
+	}
+	return;
+    }
+
+    pj_memset(buf, 81, ysize);
+    if (id == PJMEDIA_FORMAT_I420) {
+	pj_memset(buf + ysize, 90, ysize / 4);
+	pj_memset(buf + ysize + ysize / 4, 240, ysize / 4);
+    } else if (id == PJMEDIA_FORMAT_YV12) {
+	pj_memset(buf + ysize, 240, ysize / 4);
+	pj_memset(buf + ysize + ysize / 4, 90, ysize / 4);
+    } else {
+	for (i = 0; i < ysize / 2; i += 2) {
+	    buf[ysize+i]   = (pj_uint8_t)(id==PJMEDIA_FORMAT_NV12? 90: 240);
+	    buf[ysize+i+1] = (pj_uint8_t)(id==PJMEDIA_FORMAT_NV12? 240: 90);
+	}
+    }
+}
+
+/* Count the texture objects of the current context */
+static unsigned count_textures(void)
+{
+    GLuint name;
+    unsigned cnt = 0;
+
+    for (name = 1; name < 1000; ++name) {
+	if (glIsTexture(name))
+	    ++cnt;
+    }
+
+    return cnt;
+}
+
+/* Render the frame and check that the center pixel is red */
+static int render_check(pjmedia_ogl_renderer *rdr, const pj_uint8_t *buf)
+{
+    pj_uint8_t px[4];
+
+    if (pjmedia_ogl_renderer_upload(rdr, buf) != PJ_SUCCESS ||
+	pjmedia_ogl_renderer_draw(rdr) != PJ_SUCCESS)
+    {
+	return -100;
+    }
+
+    glReadPixels(WIDTH/2, HEIGHT/2, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, px);
+    if (glGetError() != GL_NO_ERROR)
+	return -110;
+
+    if (px[0] < 255 - TOLERANCE || px[1] > TOLERANCE || px[2] > TOLERANCE) {
+	PJ_LOG(3,(THIS_FILE, "   error: got (%d,%d,%d) instead of red",
+		  px[0], px[1], px[2]));
+	return -120;
+    }
+
+    return 0;
+}
+
+static int format_test(pj_pool_t *pool, gl_target *t, pjmedia_format_id id)
+{
+    pjmedia_format fmt;
+    pjmedia_ogl_renderer *rdr;
+    pj_uint8_t *buf;
+    pj_timestamp t1, t2;
+    char name[5];
+    unsigned i, live;
+    int rc;
+
+    pjmedia_format_init_video(&fmt, id, WIDTH, HEIGHT, 30, 1);
+    if (pjmedia_ogl_renderer_create(pool, &fmt, &rdr) != PJ_SUCCESS)
+	return -200;
+
+    buf = (pj_uint8_t*)
+	  pj_pool_alloc(pool, pjmedia_ogl_renderer_frame_size(rdr));
+    fill_red(id, buf);
+
+    if (pjmedia_ogl_renderer_init_gl(rdr) != PJ_SUCCESS)
+	return -210;
+    rc = render_check(rdr, buf);
+    if (rc != 0)
+	return rc - 10;
+
+    /* Init again in the same context, e.g. on surface changes. The
+     * objects of the previous init must not be left behind.
+     */
+    live = count_textures();
+    for (i = 0; i < 10; ++i) {
+	if (pjmedia_ogl_renderer_init_gl(rdr) != PJ_SUCCESS)
+	    return -220;
+    }
+    if (count_textures() != live) {
+	PJ_LOG(3,(THIS_FILE, "   error: %u textures before init, %u after",
+		  live, count_textures()));
+	return -225;
+    }
+    rc = render_check(rdr, buf);
+    if (rc != 0)
+	return rc - 20;
+
+    /* Context loss, the objects went away with the old context */
+    destroy_context(t);
+    rc = create_context(t);
+    if (rc != 0)
+	return rc;
+    pjmedia_ogl_renderer_reset_gl(rdr);
+    if (pjmedia_ogl_renderer_init_gl(rdr) != PJ_SUCCESS)
+	return -230;
+    rc = render_check(rdr, buf);
+    if (rc != 0)
+	return rc - 30;
+
+    /* Frame time, upload and draw of a changing frame */
+    glFinish();
+    pj_get_timestamp(&t1);
+    for (i = 0; i < BENCH_FRAMES; ++i) {
+	buf[i] ^= 1;
+	pjmedia_ogl_renderer_upload(rdr, buf);
+	pjmedia_ogl_renderer_draw(rdr);
+	glFinish();
+    }
+    pj_get_timestamp(&t2);
+
+    PJ_LOG(3,(THIS_FILE, "  %s %dx%d: %u usec/frame (%u bytes per frame)",
+	      pjmedia_fourcc_name(id, name), WIDTH, HEIGHT,
+	      pj_elapsed_usec(&t1, &t2) / BENCH_FRAMES,
+	      (unsigned)pjmedia_ogl_renderer_frame_size(rdr)));
+
+    pjmedia_ogl_renderer_release_gl(rdr);
+    if (glGetError() != GL_NO_ERROR)
+	return -240;
+
+    return 0;
+}
+
+int main(void)
+{
+    pj_caching_pool cp;
+    pj_pool_t *pool;
+    gl_target t;
+    unsigned i;
+    int rc;
+
+    pj_bzero(&t, sizeof(t));
+
+    pj_init();
+    pj_caching_pool_init(&cp, NULL, 0);
+    pool = pj_pool_create(&cp.factory, "ogltest", 4000, 4000, NULL);
+    pjmedia_video_format_mgr_create(pool, 64, 0, NULL);
+
+    rc = open_display(&t);
+    if (rc == 0)
+	rc = create_context(&t);
+    if (rc != 0) {
+	PJ_LOG(3,(THIS_FILE, "Unable to create GLES2 context, rc=%d", rc));
+	goto on_return;
+    }
+
+    PJ_LOG(3,(THIS_FILE, "OpenGL ES renderer: %s",
+	      (const char*)glGetString(GL_RENDERER)));
+
+    for (i = 0; i < PJ_ARRAY_SIZE(test_fmts); ++i) {
+	char name[5];
+
+	rc = format_test(pool, &t, test_fmts[i]);
+	if (rc != 0) {
+	    PJ_LOG(3,(THIS_FILE, "  %s test failed, rc=%d",
+		      pjmedia_fourcc_name(test_fmts[i], name), rc));
+	    break;
+	}
+    }
+
+    destroy_context(&t);
+    eglTerminate(t.dpy);
+
+on_return:
+    PJ_LOG(3,(THIS_FILE, "Test %s, rc=%d", (rc==0? "passed": "failed"), rc));
+
+    pj_pool_release(pool);
+    pj_caching_pool_destroy(&cp);
+    pj_shutdown();
+
+    return rc == 0 ? 0 : 1;
+}
@@ -3,6 +3,19 @@
 ##############
 
 LOCAL_PATH := $(call my-dir)/../../sources/pjlib-util
+
+# ARMv8 SHA1 and CRC32 kernels, detected at runtime. They are built as a
+# separate module because only these files may use the instructions. On
+# armeabi-v7a this needs a toolchain that knows ARMv8, so it is opt-in
+# with MY_USE_ARMV8_HASH := 1.
+MY_PJLIB_UTIL_ARMV8_FLAGS :=
+ifeq ($(TARGET_ARCH_ABI),arm64-v8a)
+	MY_PJLIB_UTIL_ARMV8_FLAGS := -march=armv8-a+crc+crypto
+endif
+ifeq ($(TARGET_ARCH_ABI)$(MY_USE_ARMV8_HASH),armeabi-v7a1)
+	MY_PJLIB_UTIL_ARMV8_FLAGS := -march=armv8-a+crc -mfpu=crypto-neon-fp-armv8 -mfloat-abi=softfp
+endif
+
 include $(CLEAR_VARS)
 
 LOCAL_MODULE    := pjlib-util
@@ -18,6 +31,8 @@ LOCAL_SRC_FILES := $(PJLIB_SRC_DIR)/base64.c \
 	$(PJLIB_SRC_DIR)/dns_dump.c \
 	$(PJLIB_SRC_DIR)/dns_server.c \
 	$(PJLIB_SRC_DIR)/getopt.c \
+	$(PJLIB_SRC_DIR)/hash_accel.c \
+	$(PJLIB_SRC_DIR)/hash_accel_x86.c \
 	$(PJLIB_SRC_DIR)/hmac_md5.c \
 	$(PJLIB_SRC_DIR)/hmac_sha1.c \
 	$(PJLIB_SRC_DIR)/md5.c \
@@ -31,5 +46,22 @@ LOCAL_SRC_FILES := $(PJLIB_SRC_DIR)/base64.c \
 	$(PJLIB_SRC_DIR)/stun_simple_client.c \
 	$(PJLIB_SRC_DIR)/xml.c
 
+ifneq ($(MY_PJLIB_UTIL_ARMV8_FLAGS),)
+	LOCAL_CFLAGS += -DPJ_HASH_ACCEL_HAS_ARMV8=1
+endif
+
+include $(BUILD_STATIC_LIBRARY)
+
+
+ifneq ($(MY_PJLIB_UTIL_ARMV8_FLAGS),)
+include $(CLEAR_VARS)
+
+LOCAL_MODULE    := pjlib-util-armv8
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../pjlib/include $(LOCAL_PATH)/include
+LOCAL_CFLAGS := $(MY_PJSIP_FLAGS) $(MY_PJLIB_UTIL_ARMV8_FLAGS)
+LOCAL_SRC_FILES := src/pjlib-util/hash_accel_arm.c
+
 include $(BUILD_STATIC_LIBRARY)
+endif
 
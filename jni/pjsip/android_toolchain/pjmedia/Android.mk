@@ -24,7 +24,8 @@ PJMEDIACODEC_SRC_DIR := src/pjmedia-codec
 LOCAL_SRC_FILES := $(PJLIB_SRC_DIR)/alaw_ulaw.c $(PJLIB_SRC_DIR)/alaw_ulaw_table.c \
 	$(PJLIB_SRC_DIR)/bidirectional.c $(PJLIB_SRC_DIR)/format.c \
 	$(PJLIB_SRC_DIR)/clock_thread.c $(PJLIB_SRC_DIR)/codec.c \
-	$(PJLIB_SRC_DIR)/conference.c $(PJLIB_SRC_DIR)/conf_switch.c $(PJLIB_SRC_DIR)/delaybuf.c $(PJLIB_SRC_DIR)/echo_common.c \
+	$(PJLIB_SRC_DIR)/conference.c $(PJLIB_SRC_DIR)/conf_switch.c $(PJLIB_SRC_DIR)/delaybuf.c \
+	$(PJLIB_SRC_DIR)/dsp.c $(PJLIB_SRC_DIR)/dsp_x86.c $(PJLIB_SRC_DIR)/echo_common.c \
 	$(PJLIB_SRC_DIR)/echo_speex.c $(PJLIB_SRC_DIR)/echo_port.c $(PJLIB_SRC_DIR)/echo_suppress.c $(PJLIB_SRC_DIR)/endpoint.c $(PJLIB_SRC_DIR)/errno.c \
 	$(PJLIB_SRC_DIR)/g711.c $(PJLIB_SRC_DIR)/jbuf.c $(PJLIB_SRC_DIR)/master_port.c \
 	$(PJLIB_SRC_DIR)/mem_capture.c $(PJLIB_SRC_DIR)/mem_player.c \
@@ -36,6 +37,7 @@ LOCAL_SRC_FILES := $(PJLIB_SRC_DIR)/alaw_ulaw.c $(PJLIB_SRC_DIR)/alaw_ulaw_table
 	$(PJLIB_SRC_DIR)/sound_port.c $(PJLIB_SRC_DIR)/stereo_port.c \
 	$(PJLIB_SRC_DIR)/stream_common.c $(PJLIB_SRC_DIR)/stream_info.c \
 	$(PJLIB_SRC_DIR)/stream.c $(PJLIB_SRC_DIR)/tonegen.c $(PJLIB_SRC_DIR)/transport_adapter_sample.c \
+	$(PJLIB_SRC_DIR)/transport_bundle.c \
 	$(PJLIB_SRC_DIR)/transport_ice.c $(PJLIB_SRC_DIR)/transport_loop.c \
 	$(PJLIB_SRC_DIR)/transport_srtp.c $(PJLIB_SRC_DIR)/transport_udp.c \
 	$(PJLIB_SRC_DIR)/wav_player.c $(PJLIB_SRC_DIR)/wav_playlist.c $(PJLIB_SRC_DIR)/wav_writer.c $(PJLIB_SRC_DIR)/wave.c \
@@ -47,6 +49,12 @@ LOCAL_SRC_FILES := $(PJLIB_SRC_DIR)/alaw_ulaw.c $(PJLIB_SRC_DIR)/alaw_ulaw_table
 	$(PJMEDIADEV_VIDEO_SRC_DIR)/videodev.c $(PJMEDIADEV_VIDEO_SRC_DIR)/colorbar_dev.c $(PJMEDIADEV_VIDEO_SRC_DIR)/errno.c \
 	$(PJMEDIACODEC_SRC_DIR)/amr_sdp_match.c
 
+# NEON DSP kernels, detected at runtime on ARMv7
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+	LOCAL_SRC_FILES += $(PJLIB_SRC_DIR)/dsp_neon.c.neon
+	LOCAL_CFLAGS += -DPJMEDIA_DSP_HAS_NEON=1
+endif
+
 # If not csipsimple, load default audio codecs loader from pjmedia
 ifneq ($(MY_USE_CSIPSIMPLE),1)
 	LOCAL_SRC_FILES += $(PJMEDIACODEC_SRC_DIR)/audio_codecs.c
@@ -158,6 +166,9 @@ LOCAL_C_INCLUDES += $(LOCAL_PATH)/../../../ffmpeg/ffmpeg_src
 LOCAL_SRC_FILES += $(PJ_ANDROID_SRC_DIR)/pjmedia-videodev/webrtc_android_render_dev.cpp
 # Pj implementation for capture
 LOCAL_SRC_FILES += $(PJ_ANDROID_SRC_DIR)/pjmedia-videodev/webrtc_android_capture_dev.cpp
+# The OpenGL ES 2 renderer (opengl_video_dev.c, opengl_yuv_renderer.c) is not
+# built: no Java GLSurfaceView renderer calls pjmedia_ogl_surface_*() yet, so
+# pjmedia_ogl_factory must not be available to the video render settings.
 
 # Ffmpeg codec
 LOCAL_SRC_FILES += $(PJMEDIACODEC_SRC_DIR)/ffmpeg_vid_codecs.c \
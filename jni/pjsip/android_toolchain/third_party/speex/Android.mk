@@ -7,8 +7,11 @@ LOCAL_PATH := $(call my-dir)/../../../sources/third_party/speex
 include $(CLEAR_VARS)
 LOCAL_MODULE    := speex
 LOCAL_C_INCLUDES := $(LOCAL_PATH)/../build/speex $(LOCAL_PATH)/include \
-		   $(LOCAL_PATH)/libspeex $(LOCAL_PATH)/../../pjlib/include
+		   $(LOCAL_PATH)/libspeex $(LOCAL_PATH)/../../pjlib/include \
+		   $(LOCAL_PATH)/../../pjmedia/include
 LOCAL_CFLAGS := $(MY_PJSIP_FLAGS) -DHAVE_CONFIG_H=1
+# Shared DSP kernels from pjmedia
+LOCAL_CFLAGS += -DSPEEX_HAVE_PJMEDIA_DSP
 PJLIB_SRC_DIR := libspeex
 
 LOCAL_SRC_FILES := $(PJLIB_SRC_DIR)/bits.c $(PJLIB_SRC_DIR)/cb_search.c $(PJLIB_SRC_DIR)/exc_10_16_table.c  \
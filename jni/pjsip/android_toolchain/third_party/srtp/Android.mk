@@ -9,6 +9,7 @@ include $(CLEAR_VARS)
 LOCAL_MODULE    := srtp
 
 LOCAL_C_INCLUDES += $(LOCAL_PATH)/../../pjlib/include \
+			$(LOCAL_PATH)/../../pjlib-util/include \
 			$(LOCAL_PATH)/crypto/include \
 			$(LOCAL_PATH)/include \
 			$(LOCAL_PATH)/../build/srtp
@@ -35,6 +35,7 @@
 /* Crypto */
 #include <pjlib-util/base64.h>
 #include <pjlib-util/crc32.h>
+#include <pjlib-util/hash_accel.h>
 #include <pjlib-util/hmac_md5.h>
 #include <pjlib-util/hmac_sha1.h>
 #include <pjlib-util/md5.h>
@@ -254,6 +254,33 @@
 #   define PJ_CRC32_HAS_TABLES			    1
 #endif
 
+/**
+ * Specify whether SHA1 and CRC32 may use the CPU instructions made for
+ * them (see hash_accel.h). The CPU is checked at runtime, so this can stay
+ * enabled on builds that also run on older CPUs.
+ *
+ * Default: 1
+ */
+#ifndef PJ_HAS_HASH_ACCEL
+#   define PJ_HAS_HASH_ACCEL			    1
+#endif
+
+/**
+ * Specify whether the ARMv8 SHA1 and CRC32 kernels are compiled in.
+ * hash_accel_arm.c must then be built with those instructions enabled,
+ * e.g. with -march=armv8-a+crc+crypto, even when the rest of the library
+ * is not. Whether the CPU actually has them is checked at runtime.
+ *
+ * Default: 1 when the compiler targets both, otherwise 0.
+ */
+#ifndef PJ_HASH_ACCEL_HAS_ARMV8
+#   if defined(__ARM_FEATURE_CRYPTO) && defined(__ARM_FEATURE_CRC32)
+#	define PJ_HASH_ACCEL_HAS_ARMV8		    1
+#   else
+#	define PJ_HASH_ACCEL_HAS_ARMV8		    0
+#   endif
+#endif
+
 
 /* **************************************************************************
  * HTTP Client configuration
@@ -0,0 +1,112 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef __PJLIB_UTIL_HASH_ACCEL_H__
+#define __PJLIB_UTIL_HASH_ACCEL_H__
+
+/**
+ * @file hash_accel.h
+ * @brief Hardware acceleration of the SHA1 and CRC32 primitives
+ */
+
+#include <pjlib-util/types.h>
+
+PJ_BEGIN_DECL
+
+/**
+ * @defgroup PJLIB_UTIL_HASH_ACCEL Hash Acceleration
+ * @ingroup PJLIB_UTIL_ENCRYPTION
+ * @{
+ * The SHA1 block function and the CRC32 update may use CPU instructions
+ * made for them: the SHA extensions and PCLMULQDQ on x86, and the ARMv8
+ * SHA1 and CRC32 instructions. The implementation is chosen on first use
+ * according to the CPU features present, falling back to the portable
+ * code. The results are always identical.
+ *
+ * The SHA1 users (HMAC-SHA1 for the STUN MESSAGE-INTEGRITY, and SRTP
+ * authentication when libsrtp is built by pjproject) and the STUN
+ * FINGERPRINT CRC32 all go through these.
+ */
+
+/**
+ * CPU features that the hash functions may use.
+ */
+typedef enum pj_hash_accel_feature
+{
+    /** x86 SHA extensions, for SHA1. */
+    PJ_HASH_ACCEL_SHA_NI	= 1,
+
+    /** x86 carry-less multiplication (PCLMULQDQ), for CRC32. */
+    PJ_HASH_ACCEL_PCLMUL	= 2,
+
+    /** ARMv8 SHA1 instructions. */
+    PJ_HASH_ACCEL_ARMV8_SHA1	= 4,
+
+    /** ARMv8 CRC32 instructions. */
+    PJ_HASH_ACCEL_ARMV8_CRC32	= 8
+
+} pj_hash_accel_feature;
+
+
+/**
+ * Get the CPU features that are present and supported by the
+ * implementations compiled in.
+ *
+ * @return		Bitmask of #pj_hash_accel_feature.
+ */
+PJ_DECL(unsigned) pj_hash_accel_get_features(void);
+
+
+/**
+ * Restrict the CPU features used by the hash functions, e.g. to compare
+ * an implementation with the portable one. Features that are not present
+ * are ignored.
+ *
+ * @param features	Bitmask of #pj_hash_accel_feature to allow, or
+ *			zero to use the portable code only.
+ *
+ * @return		Bitmask of the features now in use.
+ */
+PJ_DECL(unsigned) pj_hash_accel_set_features(unsigned features);
+
+
+/**
+ * Get the name of the SHA1 implementation in use, e.g. "sha-ni".
+ *
+ * @return		Implementation name.
+ */
+PJ_DECL(const char*) pj_hash_accel_get_sha1_impl_name(void);
+
+
+/**
+ * Get the name of the CRC32 implementation in use, e.g. "pclmul".
+ *
+ * @return		Implementation name.
+ */
+PJ_DECL(const char*) pj_hash_accel_get_crc32_impl_name(void);
+
+
+/**
+ * @}
+ */
+
+PJ_END_DECL
+
+
+#endif	/* __PJLIB_UTIL_HASH_ACCEL_H__ */
@@ -68,6 +68,18 @@ PJ_DECL(void) pj_sha1_update(pj_sha1_context *ctx,
 PJ_DECL(void) pj_sha1_final(pj_sha1_context *ctx, 
 			    pj_uint8_t digest[PJ_SHA1_DIGEST_SIZE]);
 
+/** Run the SHA1 compression function over whole 64 byte blocks, without
+ *  any padding. This is for hash implementations that keep their own
+ *  context, such as libsrtp's, and uses the same hardware acceleration
+ *  as #pj_sha1_update().
+ *  @param state	The five chaining words.
+ *  @param data		The blocks, with no alignment requirement.
+ *  @param nblocks	Number of blocks.
+ */
+PJ_DECL(void) pj_sha1_transform(pj_uint32_t state[5],
+				const pj_uint8_t *data,
+				pj_size_t nblocks);
+
 
 /**
  * @}
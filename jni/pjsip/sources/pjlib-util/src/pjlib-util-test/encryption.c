@@ -494,6 +494,101 @@ static int crc32_test(void)
     return 0;
 }
 
+/*
+ * Compare the hardware accelerated SHA1 and CRC32 with the portable code
+ */
+#define ACCEL_MAX_LEN	3000
+#define ACCEL_ROUNDS	300
+
+static pj_uint8_t accel_data[ACCEL_MAX_LEN + 8];
+
+static void accel_hash(unsigned features, const pj_uint8_t *data,
+		       unsigned len, unsigned split,
+		       pj_uint8_t digest[PJ_SHA1_DIGEST_SIZE],
+		       pj_uint32_t *crc)
+{
+    pj_sha1_context sha1_ctx;
+    pj_crc32_context crc_ctx;
+
+    pj_hash_accel_set_features(features);
+
+    pj_sha1_init(&sha1_ctx);
+    pj_sha1_update(&sha1_ctx, data, split);
+    pj_sha1_update(&sha1_ctx, data + split, len - split);
+    pj_sha1_final(&sha1_ctx, digest);
+
+    pj_crc32_init(&crc_ctx);
+    pj_crc32_update(&crc_ctx, data, split);
+    pj_crc32_update(&crc_ctx, data + split, len - split);
+    *crc = pj_crc32_final(&crc_ctx);
+}
+
+static int hash_accel_compare(unsigned features)
+{
+    unsigned i;
+
+    for (i=0; i<ACCEL_ROUNDS; ++i) {
+	pj_uint8_t ref_digest[PJ_SHA1_DIGEST_SIZE];
+	pj_uint8_t digest[PJ_SHA1_DIGEST_SIZE];
+	pj_uint32_t ref_crc, crc;
+	unsigned j, len, split, offset;
+
+	/* Short lengths are the common case, so test them more often */
+	len = pj_rand() % ((i & 1) ? (ACCEL_MAX_LEN + 1) : 200);
+	split = pj_rand() % (len + 1);
+	offset = pj_rand() % 8;
+	for (j=0; j<len; ++j)
+	    accel_data[offset + j] = (pj_uint8_t)pj_rand();
+
+	accel_hash(0, accel_data + offset, len, split, ref_digest, &ref_crc);
+	accel_hash(features, accel_data + offset, len, split, digest, &crc);
+
+	if (pj_memcmp(digest, ref_digest, sizeof(digest)) != 0) {
+	    PJ_LOG(3,(THIS_FILE, "    error: sha1 %s mismatch, len=%u split=%u",
+		      pj_hash_accel_get_sha1_impl_name(), len, split));
+	    return -91;
+	}
+	if (crc != ref_crc) {
+	    PJ_LOG(3,(THIS_FILE, "    error: crc32 %s mismatch, len=%u split=%u",
+		      pj_hash_accel_get_crc32_impl_name(), len, split));
+	    return -92;
+	}
+    }
+
+    return 0;
+}
+
+static int hash_accel_test(void)
+{
+    unsigned features, mask;
+    int rc;
+
+    features = pj_hash_accel_get_features();
+    PJ_LOG(3, (THIS_FILE, "  hash acceleration test: features=0x%x, "
+			  "sha1 %s, crc32 %s", features,
+			  pj_hash_accel_get_sha1_impl_name(),
+			  pj_hash_accel_get_crc32_impl_name()));
+
+    /* Every subset of the available features */
+    for (mask=1; mask<=features; ++mask) {
+	if ((mask & features) != mask)
+	    continue;
+
+	pj_hash_accel_set_features(mask);
+	PJ_LOG(3, (THIS_FILE, "    comparing sha1 %s and crc32 %s with c",
+		   pj_hash_accel_get_sha1_impl_name(),
+		   pj_hash_accel_get_crc32_impl_name()));
+	rc = hash_accel_compare(mask);
+	if (rc != 0) {
+	    pj_hash_accel_set_features(features);
+	    return rc;
+	}
+    }
+
+    pj_hash_accel_set_features(features);
+    return 0;
+}
+
 enum
 {
     ENCODE = 1,
@@ -651,6 +746,10 @@ int encryption_test()
     if (rc != 0)
 	return rc;
 
+    rc = hash_accel_test();
+    if (rc != 0)
+	return rc;
+
     return 0;
 }
 
@@ -665,6 +764,47 @@ static void crc32_final(pj_crc32_context *ctx, pj_uint32_t *digest)
     *digest = pj_crc32_final(ctx);
 }
 
+/* Time the hash functions as they are used per packet: HMAC-SHA1 over
+ * a 172 byte SRTP packet (20ms of G.711 and the RTP header), and the
+ * FINGERPRINT CRC32 over a 100 byte STUN binding request. 2048 byte
+ * blocks show the bulk throughput.
+ */
+static void hash_accel_benchmark(const pj_uint8_t *input, unsigned features)
+{
+#if defined(PJ_DEBUG) && PJ_DEBUG!=0
+    enum { LOOP = 20000 };
+#else
+    enum { LOOP = 200000 };
+#endif
+    static const pj_uint8_t key[20] = { 0x0b };
+    pj_uint8_t digest[PJ_SHA1_DIGEST_SIZE];
+    pj_timestamp t0, t1, t2, t3;
+    pj_sha1_context ctx;
+    unsigned i;
+
+    pj_hash_accel_set_features(features);
+
+    pj_get_timestamp(&t0);
+    for (i=0; i<LOOP; ++i)
+	pj_hmac_sha1(input, 172, key, sizeof(key), digest);
+    pj_get_timestamp(&t1);
+    for (i=0; i<LOOP; ++i)
+	pj_crc32_calc(input, 100);
+    pj_get_timestamp(&t2);
+    pj_sha1_init(&ctx);
+    for (i=0; i<LOOP / 10; ++i)
+	pj_sha1_update(&ctx, input, 2048);
+    pj_sha1_final(&ctx, digest);
+    pj_get_timestamp(&t3);
+
+    PJ_LOG(3, (THIS_FILE, "    sha1 %-6s crc32 %-6s: %d pkts: srtp hmac %6d "
+			  "usec, stun crc %6d usec; bulk sha1 %6d usec",
+	       pj_hash_accel_get_sha1_impl_name(),
+	       pj_hash_accel_get_crc32_impl_name(), LOOP,
+	       pj_elapsed_usec(&t0, &t1), pj_elapsed_usec(&t1, &t2),
+	       pj_elapsed_usec(&t2, &t3)));
+}
+
 int encryption_benchmark()
 {
     pj_pool_t *pool;
@@ -757,6 +897,18 @@ int encryption_benchmark()
 		   ((unsigned)(bytes) % (1024 * 1024)) / 1024));
     }
 
+    /* Portable code, then the hardware implementations */
+    {
+	unsigned features = pj_hash_accel_get_features();
+
+	PJ_LOG(3, (THIS_FILE, "  hash acceleration, features=0x%x:",
+		   features));
+	hash_accel_benchmark(input, 0);
+	if (features)
+	    hash_accel_benchmark(input, features);
+	pj_hash_accel_set_features(features);
+    }
+
     return 0;
 }
 
@@ -10,10 +10,27 @@
  * this file is put on public domain as well.
  */
 #include <pjlib-util/crc32.h>
+#include "hash_accel_internal.h"
 
 
 #define CRC32_NEGL  0xffffffffL
 
+#if PJ_HAS_HASH_ACCEL && \
+    defined(PJ_IS_LITTLE_ENDIAN) && PJ_IS_LITTLE_ENDIAN != 0
+/* Let the hardware implementation, if there is one, take the bulk of the
+ * data. crc is the CRC register. Returns the number of bytes consumed.
+ */
+static pj_size_t crc32_accel(pj_uint32_t *crc, const pj_uint8_t *data,
+			     pj_size_t nbytes)
+{
+    const pj_crc32_impl *impl = pj_hash_accel_get_crc32_impl();
+
+    return impl->update ? (*impl->update)(crc, data, nbytes) : 0;
+}
+#else
+#   define crc32_accel(crc, data, nbytes)   0
+#endif
+
 #if defined(PJ_CRC32_HAS_TABLES) && PJ_CRC32_HAS_TABLES!=0
 // crc.cpp - written and placed in the public domain by Wei Dai
 
@@ -158,6 +175,11 @@ PJ_DEF(pj_uint32_t) pj_crc32_update(pj_crc32_context *ctx,
 				    pj_size_t nbytes)
 {
     pj_uint32_t crc = ctx->crc_state ^ CRC32_NEGL;
+    pj_size_t done;
+
+    done = crc32_accel(&crc, data, nbytes);
+    data += done;
+    nbytes -= done;
 
     for( ; (((unsigned long)data) & 0x03) && nbytes > 0; --nbytes) {
 	crc = crc_tab[CRC32_INDEX(crc) ^ *data++] ^ CRC32_SHIFTED(crc);
@@ -202,6 +224,11 @@ PJ_DEF(pj_uint32_t) pj_crc32_update(pj_crc32_context *ctx,
 
 {
     pj_uint32_t crc = ctx->crc_state;
+    pj_size_t done;
+
+    done = crc32_accel(&crc, octets, len);
+    octets += done;
+    len -= done;
     
     while (len--) {
 	pj_uint32_t temp;
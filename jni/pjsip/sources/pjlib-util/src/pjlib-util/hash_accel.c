@@ -0,0 +1,205 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "hash_accel_internal.h"
+#include <pj/string.h>
+
+#if HASH_ACCEL_HAS_X86
+#   if defined(_MSC_VER)
+#	include <intrin.h>
+#   else
+#	include <cpuid.h>
+#   endif
+#endif
+
+#if HASH_ACCEL_HAS_ARM && defined(__linux__)
+#   include <stdio.h>
+#endif
+
+
+static const pj_sha1_impl sha1_c_impl =
+{
+    "c",
+    &pj_sha1_blocks_c
+};
+
+static const pj_crc32_impl crc32_c_impl =
+{
+    "c",
+    NULL
+};
+
+
+/*
+ * CPU detection.
+ */
+#if HASH_ACCEL_HAS_X86
+static void hash_cpuid(unsigned leaf, unsigned regs[4])
+{
+#if defined(_MSC_VER)
+    __cpuidex((int*)regs, leaf, 0);
+#else
+    regs[0] = regs[1] = regs[2] = regs[3] = 0;
+    if (leaf > __get_cpuid_max(0, 0))
+	return;
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+#endif
+
+#if HASH_ACCEL_HAS_ARM && defined(__linux__)
+static unsigned hash_cpuinfo_features(void)
+{
+    char line[512];
+    FILE *f;
+    unsigned features = 0;
+
+    f = fopen("/proc/cpuinfo", "r");
+    if (!f)
+	return 0;
+
+    while (fgets(line, sizeof(line), f)) {
+	if (pj_ansi_strncmp(line, "Features", 8) != 0)
+	    continue;
+	if (pj_ansi_strstr(line, " sha1"))
+	    features |= PJ_HASH_ACCEL_ARMV8_SHA1;
+	if (pj_ansi_strstr(line, " crc32"))
+	    features |= PJ_HASH_ACCEL_ARMV8_CRC32;
+	break;
+    }
+
+    fclose(f);
+    return features;
+}
+#endif
+
+static unsigned hash_detect(void)
+{
+    unsigned features = 0;
+
+#if HASH_ACCEL_HAS_X86
+    {
+	unsigned regs[4];
+
+	/* Both kernels also use SSSE3 and SSE4.1 */
+	hash_cpuid(1, regs);
+	if ((regs[2] & (1 << 9)) && (regs[2] & (1 << 19))) {
+	    if (regs[2] & (1 << 1))
+		features |= PJ_HASH_ACCEL_PCLMUL;
+
+	    hash_cpuid(7, regs);
+	    if (regs[1] & (1 << 29))
+		features |= PJ_HASH_ACCEL_SHA_NI;
+	}
+    }
+#endif
+
+#if HASH_ACCEL_HAS_ARM
+#   if defined(__linux__)
+    features |= hash_cpuinfo_features();
+#   else
+    features |= PJ_HASH_ACCEL_ARMV8_SHA1 | PJ_HASH_ACCEL_ARMV8_CRC32;
+#   endif
+#endif
+
+    return features;
+}
+
+
+/*
+ * Dispatch.
+ */
+static unsigned hash_features;
+static unsigned hash_active;
+static const pj_sha1_impl *sha1_impl;
+static const pj_crc32_impl *crc32_impl;
+
+static void hash_select(unsigned features)
+{
+    sha1_impl = &sha1_c_impl;
+    crc32_impl = &crc32_c_impl;
+
+#if HASH_ACCEL_HAS_X86
+    if (features & PJ_HASH_ACCEL_SHA_NI)
+	sha1_impl = &pj_sha1_shani_impl;
+    if (features & PJ_HASH_ACCEL_PCLMUL)
+	crc32_impl = &pj_crc32_pclmul_impl;
+#endif
+#if HASH_ACCEL_HAS_ARM
+    if (features & PJ_HASH_ACCEL_ARMV8_SHA1)
+	sha1_impl = &pj_sha1_armv8_impl;
+    if (features & PJ_HASH_ACCEL_ARMV8_CRC32)
+	crc32_impl = &pj_crc32_armv8_impl;
+#endif
+    PJ_UNUSED_ARG(features);
+}
+
+/* Selecting the implementations twice from two threads is harmless, both
+ * end up with the same pointers. Each pointer is checked because they are
+ * set one after the other. This may run on media threads that are not
+ * known to pjlib, so don't log here.
+ */
+static void hash_init(void)
+{
+    if (sha1_impl == NULL || crc32_impl == NULL) {
+	hash_features = hash_detect();
+	hash_active = hash_features;
+	hash_select(hash_features);
+    }
+}
+
+PJ_DEF(unsigned) pj_hash_accel_get_features(void)
+{
+    hash_init();
+    return hash_features;
+}
+
+PJ_DEF(unsigned) pj_hash_accel_set_features(unsigned features)
+{
+    hash_init();
+    hash_active = features & hash_features;
+    hash_select(hash_active);
+    return hash_active;
+}
+
+PJ_DEF(const char*) pj_hash_accel_get_sha1_impl_name(void)
+{
+    hash_init();
+    return sha1_impl->name;
+}
+
+PJ_DEF(const char*) pj_hash_accel_get_crc32_impl_name(void)
+{
+    hash_init();
+    return crc32_impl->name;
+}
+
+const pj_crc32_impl *pj_hash_accel_get_crc32_impl(void)
+{
+    hash_init();
+    return crc32_impl;
+}
+
+PJ_DEF(void) pj_sha1_transform(pj_uint32_t state[5],
+			       const pj_uint8_t *data,
+			       pj_size_t nblocks)
+{
+    hash_init();
+    (*sha1_impl->blocks)(state, data, nblocks);
+}
@@ -0,0 +1,160 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "hash_accel_internal.h"
+
+/*
+ * ARMv8 kernels, for AArch64 and for AArch32 on ARMv8 cores. This file
+ * must be compiled with the SHA1 and CRC32 instructions enabled.
+ */
+#if HASH_ACCEL_HAS_ARM
+
+#include <arm_neon.h>
+#include <arm_acle.h>
+
+
+/*
+ * SHA1. sha1c/sha1p/sha1m do four rounds with the choose, parity and
+ * majority functions, sha1h gives the E of the next four rounds, and
+ * sha1su0/sha1su1 compute the message schedule.
+ */
+#define SHA1_ROUNDS4(op, k, m) \
+	e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0)); \
+	abcd = op(abcd, e0, vaddq_u32(m, k)); \
+	e0 = e1
+
+#define SHA1_SCHEDULE(m0, m1, m2, m3) \
+	m0 = vsha1su1q_u32(vsha1su0q_u32(m0, m1, m2), m3)
+
+static uint32x4_t sha1_load_be(const pj_uint8_t *data)
+{
+    return vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data)));
+}
+
+static void sha1_blocks_armv8(pj_uint32_t state[5],
+			      const pj_uint8_t *data,
+			      pj_size_t nblocks)
+{
+    const uint32x4_t k0 = vdupq_n_u32(0x5A827999);
+    const uint32x4_t k1 = vdupq_n_u32(0x6ED9EBA1);
+    const uint32x4_t k2 = vdupq_n_u32(0x8F1BBCDC);
+    const uint32x4_t k3 = vdupq_n_u32(0xCA62C1D6);
+    uint32x4_t abcd, abcd_save;
+    uint32x4_t msg0, msg1, msg2, msg3;
+    uint32_t e0, e1, e0_save;
+
+    abcd = vld1q_u32(state);
+    e0 = state[4];
+
+    for ( ; nblocks; --nblocks, data += 64) {
+	abcd_save = abcd;
+	e0_save = e0;
+
+	msg0 = sha1_load_be(data);
+	msg1 = sha1_load_be(data + 16);
+	msg2 = sha1_load_be(data + 32);
+	msg3 = sha1_load_be(data + 48);
+
+	SHA1_ROUNDS4(vsha1cq_u32, k0, msg0);
+	SHA1_SCHEDULE(msg0, msg1, msg2, msg3);
+	SHA1_ROUNDS4(vsha1cq_u32, k0, msg1);
+	SHA1_SCHEDULE(msg1, msg2, msg3, msg0);
+	SHA1_ROUNDS4(vsha1cq_u32, k0, msg2);
+	SHA1_SCHEDULE(msg2, msg3, msg0, msg1);
+	SHA1_ROUNDS4(vsha1cq_u32, k0, msg3);
+	SHA1_SCHEDULE(msg3, msg0, msg1, msg2);
+	SHA1_ROUNDS4(vsha1cq_u32, k0, msg0);
+	SHA1_SCHEDULE(msg0, msg1, msg2, msg3);
+	SHA1_ROUNDS4(vsha1pq_u32, k1, msg1);
+	SHA1_SCHEDULE(msg1, msg2, msg3, msg0);
+	SHA1_ROUNDS4(vsha1pq_u32, k1, msg2);
+	SHA1_SCHEDULE(msg2, msg3, msg0, msg1);
+	SHA1_ROUNDS4(vsha1pq_u32, k1, msg3);
+	SHA1_SCHEDULE(msg3, msg0, msg1, msg2);
+	SHA1_ROUNDS4(vsha1pq_u32, k1, msg0);
+	SHA1_SCHEDULE(msg0, msg1, msg2, msg3);
+	SHA1_ROUNDS4(vsha1pq_u32, k1, msg1);
+	SHA1_SCHEDULE(msg1, msg2, msg3, msg0);
+	SHA1_ROUNDS4(vsha1mq_u32, k2, msg2);
+	SHA1_SCHEDULE(msg2, msg3, msg0, msg1);
+	SHA1_ROUNDS4(vsha1mq_u32, k2, msg3);
+	SHA1_SCHEDULE(msg3, msg0, msg1, msg2);
+	SHA1_ROUNDS4(vsha1mq_u32, k2, msg0);
+	SHA1_SCHEDULE(msg0, msg1, msg2, msg3);
+	SHA1_ROUNDS4(vsha1mq_u32, k2, msg1);
+	SHA1_SCHEDULE(msg1, msg2, msg3, msg0);
+	SHA1_ROUNDS4(vsha1mq_u32, k2, msg2);
+	SHA1_SCHEDULE(msg2, msg3, msg0, msg1);
+	SHA1_ROUNDS4(vsha1pq_u32, k3, msg3);
+	SHA1_SCHEDULE(msg3, msg0, msg1, msg2);
+	SHA1_ROUNDS4(vsha1pq_u32, k3, msg0);
+	SHA1_ROUNDS4(vsha1pq_u32, k3, msg1);
+	SHA1_ROUNDS4(vsha1pq_u32, k3, msg2);
+	SHA1_ROUNDS4(vsha1pq_u32, k3, msg3);
+
+	abcd = vaddq_u32(abcd, abcd_save);
+	e0 += e0_save;
+    }
+
+    vst1q_u32(state, abcd);
+    state[4] = e0;
+}
+
+const pj_sha1_impl pj_sha1_armv8_impl =
+{
+    "armv8",
+    &sha1_blocks_armv8
+};
+
+
+/*
+ * CRC32. The crc32 instructions compute the ISO 3309 CRC on the register
+ * directly, so they take everything.
+ */
+static pj_size_t crc32_update_armv8(pj_uint32_t *crc,
+				    const pj_uint8_t *data,
+				    pj_size_t nbytes)
+{
+    pj_uint32_t c = *crc;
+    pj_size_t n = nbytes;
+
+    for ( ; n && (((pj_size_t)data) & 7); --n)
+	c = __crc32b(c, *data++);
+
+#if defined(__aarch64__)
+    for ( ; n >= 8; n -= 8, data += 8)
+	c = __crc32d(c, *(const uint64_t*)data);
+#endif
+    for ( ; n >= 4; n -= 4, data += 4)
+	c = __crc32w(c, *(const uint32_t*)data);
+
+    for ( ; n; --n)
+	c = __crc32b(c, *data++);
+
+    *crc = c;
+    return nbytes;
+}
+
+const pj_crc32_impl pj_crc32_armv8_impl =
+{
+    "armv8",
+    &crc32_update_armv8
+};
+
+#endif	/* HASH_ACCEL_HAS_ARM */
@@ -0,0 +1,95 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef __PJLIB_UTIL_HASH_ACCEL_INTERNAL_H__
+#define __PJLIB_UTIL_HASH_ACCEL_INTERNAL_H__
+
+#include <pjlib-util/hash_accel.h>
+#include <pjlib-util/sha1.h>
+
+/*
+ * Which implementations can be compiled in. The x86 kernels are compiled
+ * with a function target attribute, so they only need a compiler that
+ * knows about the SHA extensions.
+ */
+#if PJ_HAS_HASH_ACCEL && \
+    (defined(__i386__) || defined(__x86_64__) || \
+     defined(_M_IX86) || defined(_M_X64)) && \
+    (defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1900) || \
+     (defined(__GNUC__) && (__GNUC__ > 4 || \
+			    (__GNUC__==4 && __GNUC_MINOR__>=9))))
+#   define HASH_ACCEL_HAS_X86	    1
+#else
+#   define HASH_ACCEL_HAS_X86	    0
+#endif
+
+#if PJ_HAS_HASH_ACCEL && PJ_HASH_ACCEL_HAS_ARMV8
+#   define HASH_ACCEL_HAS_ARM	    1
+#else
+#   define HASH_ACCEL_HAS_ARM	    0
+#endif
+
+
+PJ_BEGIN_DECL
+
+/*
+ * SHA1 implementation: the compression function over whole blocks.
+ */
+typedef struct pj_sha1_impl
+{
+    const char *name;
+
+    void (*blocks)(pj_uint32_t state[5], const pj_uint8_t *data,
+		   pj_size_t nblocks);
+} pj_sha1_impl;
+
+/*
+ * CRC32 implementation. It takes the CRC register (i.e. the inverted CRC)
+ * and returns the number of bytes that it consumed, which may be less
+ * than nbytes; the table code in crc32.c then does the rest. A NULL
+ * update means that the table code does everything.
+ */
+typedef struct pj_crc32_impl
+{
+    const char *name;
+
+    pj_size_t (*update)(pj_uint32_t *crc, const pj_uint8_t *data,
+			pj_size_t nbytes);
+} pj_crc32_impl;
+
+/* Portable SHA1, in sha1.c */
+void pj_sha1_blocks_c(pj_uint32_t state[5], const pj_uint8_t *data,
+		      pj_size_t nblocks);
+
+/* The CRC32 implementation in use */
+const pj_crc32_impl *pj_hash_accel_get_crc32_impl(void);
+
+#if HASH_ACCEL_HAS_X86
+extern const pj_sha1_impl pj_sha1_shani_impl;
+extern const pj_crc32_impl pj_crc32_pclmul_impl;
+#endif
+#if HASH_ACCEL_HAS_ARM
+extern const pj_sha1_impl pj_sha1_armv8_impl;
+extern const pj_crc32_impl pj_crc32_armv8_impl;
+#endif
+
+PJ_END_DECL
+
+
+#endif	/* __PJLIB_UTIL_HASH_ACCEL_INTERNAL_H__ */
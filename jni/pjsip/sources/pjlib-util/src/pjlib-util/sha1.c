@@ -101,6 +101,7 @@ A million repetitions of "a"
 */
 #include <pjlib-util/sha1.h>
 #include <pj/string.h>
+#include "hash_accel_internal.h"
 
 #undef SHA1HANDSOFF
 
@@ -189,6 +190,21 @@ static void SHA1_Transform(pj_uint32_t state[5], pj_uint8_t buffer[64])
 }
 
 
+/* The portable block function. SHA1_Transform() expands the message in
+ * place, so each block is copied first.
+ */
+void pj_sha1_blocks_c(pj_uint32_t state[5], const pj_uint8_t *data,
+		      pj_size_t nblocks)
+{
+    pj_uint8_t tmp[64];
+
+    for ( ; nblocks; --nblocks, data += 64) {
+	pj_memcpy(tmp, data, 64);
+	SHA1_Transform(state, tmp);
+    }
+}
+
+
 /* SHA1Init - Initialize new context */
 PJ_DEF(void) pj_sha1_init(pj_sha1_context* context)
 {
@@ -213,12 +229,12 @@ PJ_DEF(void) pj_sha1_update(pj_sha1_context* context,
     context->count[1] += (len >> 29);
     if ((j + len) > 63) {
         pj_memcpy(&context->buffer[j], data, (i = 64-j));
-        SHA1_Transform(context->state, context->buffer);
-        for ( ; i + 63 < len; i += 64) {
-	    pj_uint8_t tmp[64];
-	    pj_memcpy(tmp, data + i, 64);
-            SHA1_Transform(context->state, tmp);
-        }
+        pj_sha1_transform(context->state, context->buffer, 1);
+	/* Whole blocks are hashed straight from the input */
+	if (len - i >= 64) {
+	    pj_sha1_transform(context->state, data + i, (len - i) >> 6);
+	    i += (len - i) & ~((pj_size_t)63);
+	}
         j = 0;
     }
     else i = 0;
@@ -231,6 +247,7 @@ PJ_DEF(void) pj_sha1_update(pj_sha1_context* context,
 PJ_DEF(void) pj_sha1_final(pj_sha1_context* context, 
 			   pj_uint8_t digest[PJ_SHA1_DIGEST_SIZE])
 {
+    static const pj_uint8_t padding[64] = { 0x80 };
     pj_uint32_t i;
     pj_uint8_t  finalcount[8];
 
@@ -238,10 +255,9 @@ PJ_DEF(void) pj_sha1_final(pj_sha1_context* context,
         finalcount[i] = (unsigned char)((context->count[(i >= 4 ? 0 : 1)]
          >> ((3-(i & 3)) * 8) ) & 255);  /* Endian independent */
     }
-    pj_sha1_update(context, (pj_uint8_t *)"\200", 1);
-    while ((context->count[0] & 504) != 448) {
-        pj_sha1_update(context, (pj_uint8_t *)"\0", 1);
-    }
+    /* Pad to 56 bytes mod 64 in one go */
+    i = (context->count[0] >> 3) & 63;
+    pj_sha1_update(context, padding, (i < 56) ? (56 - i) : (120 - i));
     pj_sha1_update(context, finalcount, 8);  /* Should cause a SHA1_Transform() */
     for (i = 0; i < PJ_SHA1_DIGEST_SIZE; i++) {
         digest[i] = (pj_uint8_t)
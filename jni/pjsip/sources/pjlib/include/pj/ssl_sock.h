@@ -647,7 +647,9 @@ typedef struct pj_ssl_sock_param
      * Specify buffer size for sending operation. Buffering sending data
      * is used for allowing application to perform multiple outstanding 
      * send operations. Whenever application specifies this setting too
-     * small, sending operation may return PJ_ENOMEM.
+     * small, the secured data that does not fit is kept aside until the
+     * earlier data has been sent, and further sending operations are
+     * delayed (returning PJ_EPENDING) until then.
      *  
      * Default value is 8192 bytes.
      */
@@ -170,12 +170,17 @@ struct pj_ssl_sock_t
     pj_bool_t		  flushing_write_pend; /* flag of flushing is ongoing*/
     send_buf_t		  send_buf;
     write_data_t	  send_pending;	/* list of pending write to network */
+    write_data_t	 *wbio_first;	/* first record not yet sent	    */
+    write_data_t	 *wbio_cur;	/* record being filled by BIO	    */
+    write_data_t	  wbio_pend;	/* BIO data waiting for send_buf    */
     pj_lock_t		 *write_mutex;	/* protect write BIO and send_buf   */
 
+    char		 *rbio_ptr;	/* unconsumed network data	    */
+    pj_size_t		  rbio_len;	/* length of unconsumed data	    */
+
     SSL_CTX		 *ossl_ctx;
     SSL			 *ossl_ssl;
-    BIO			 *ossl_rbio;
-    BIO			 *ossl_wbio;
+    BIO			 *ossl_bio;
 };
 
 
@@ -192,6 +197,9 @@ struct pj_ssl_cert_t
 
 
 static write_data_t* alloc_send_data(pj_ssl_sock_t *ssock, pj_size_t len);
+static pj_size_t get_send_data_avail(pj_ssl_sock_t *ssock);
+static pj_bool_t grow_send_data(pj_ssl_sock_t *ssock, write_data_t *wdata,
+				pj_size_t len);
 static void free_send_data(pj_ssl_sock_t *ssock, write_data_t *wdata);
 static pj_status_t flush_delayed_send(pj_ssl_sock_t *ssock);
 
@@ -484,6 +492,254 @@ static int verify_cb(int preverify_ok, X509_STORE_CTX *x509_ctx)
     return preverify_ok;
 }
 
+
+/*
+ * SSL socket BIO. Instead of buffering the secured data in OpenSSL memory
+ * BIOs and copying it again to/from the socket buffers, the BIO writes 
+ * records directly into the send buffer slots and reads directly from
+ * the active socket read buffer.
+ */
+
+/* Calculate the record slot length needed for the specified data length,
+ * aligned to 8.
+ */
+#define RECORD_LEN(data_len) \
+		((((data_len) + sizeof(write_data_t) + 7) >> 3) << 3)
+
+/* Start a new record, reserving just the slot needed for the specified
+ * data length. Must be called with write mutex held.
+ */
+static write_data_t* alloc_write_bio_record(pj_ssl_sock_t *ssock,
+					    pj_size_t data_len)
+{
+    write_data_t *wdata;
+
+    wdata = alloc_send_data(ssock, RECORD_LEN(data_len));
+    if (wdata == NULL)
+	return NULL;
+
+    pj_ioqueue_op_key_init(&wdata->key, sizeof(pj_ioqueue_op_key_t));
+    wdata->key.user_data = wdata;
+    wdata->app_key = &ssock->handshake_op_key;
+    wdata->record_len = RECORD_LEN(data_len);
+
+    ssock->wbio_cur = wdata;
+    if (ssock->wbio_first == NULL)
+	ssock->wbio_first = wdata;
+
+    return wdata;
+}
+
+/* Keep the data that does not fit into the send buffer, it will be moved
+ * into records as soon as the sent records free some room. Must be called
+ * with write mutex held.
+ */
+static pj_bool_t queue_write_bio_pend(pj_ssl_sock_t *ssock,
+				      const char *data,
+				      pj_size_t len)
+{
+    write_data_t *pend = &ssock->wbio_pend;
+
+    if (pend->data_len + len > pend->record_len) {
+	pj_size_t size;
+	char *buf;
+
+	size = PJ_MAX(pend->record_len * 2, pend->data_len + len);
+	size = PJ_MAX(size, ssock->param.send_buffer_size);
+	buf = (char*)pj_pool_alloc(ssock->pool, size);
+	if (buf == NULL)
+	    return PJ_FALSE;
+
+	if (pend->data_len)
+	    pj_memcpy(buf, pend->data.ptr, pend->data_len);
+	pend->data.ptr = buf;
+	pend->record_len = size;
+    }
+
+    pj_memcpy((char*)pend->data.ptr + pend->data_len, data, len);
+    pend->data_len += len;
+
+    return PJ_TRUE;
+}
+
+/* Move the data waiting in the pending buffer into records, as far as the
+ * send buffer has room. The application send key of the pending data goes
+ * to the record carrying its last part. Must be called with write mutex
+ * held.
+ */
+static void drain_write_bio_pend(pj_ssl_sock_t *ssock)
+{
+    write_data_t *pend = &ssock->wbio_pend;
+    write_data_t *wdata = NULL;
+    const char *ptr = pend->data.ptr;
+
+    ssock->wbio_cur = NULL;
+
+    while (pend->data_len) {
+	pj_size_t avail, len;
+
+	avail = (get_send_data_avail(ssock) >> 3) << 3;
+	if (avail <= sizeof(write_data_t))
+	    break;
+
+	len = PJ_MIN(pend->data_len, avail - sizeof(write_data_t));
+	wdata = alloc_write_bio_record(ssock, len);
+	pj_assert(wdata);
+
+	pj_memcpy(wdata->data.content, ptr, len);
+	wdata->data_len = len;
+	ptr += len;
+	pend->data_len -= len;
+    }
+
+    ssock->wbio_cur = NULL;
+
+    if (pend->data_len) {
+	if (ptr != pend->data.ptr)
+	    pj_memmove((char*)pend->data.ptr, ptr, pend->data_len);
+    } else if (wdata && pend->app_key) {
+	wdata->app_key = pend->app_key;
+	wdata->plain_data_len = pend->plain_data_len;
+	pend->app_key = NULL;
+	pend->plain_data_len = 0;
+    }
+}
+
+static int ssl_bio_write(BIO *bio, const char *data, int len)
+{
+    pj_ssl_sock_t *ssock = (pj_ssl_sock_t*)bio->ptr;
+    write_data_t *wdata;
+
+    BIO_clear_retry_flags(bio);
+
+    /* BIO has been detached from SSL socket, discard the data */
+    if (ssock == NULL)
+	return len;
+
+    if (len <= 0)
+	return 0;
+
+    /* Once some data is waiting for room in the send buffer, anything
+     * written after it has to wait as well to keep the stream in order.
+     */
+    if (ssock->wbio_pend.data_len == 0) {
+	/* Append to the current record, growing its slot when needed */
+	wdata = ssock->wbio_cur;
+	if (wdata) {
+	    pj_size_t rec_len = RECORD_LEN(wdata->data_len + len);
+
+	    if (rec_len > wdata->record_len &&
+		!grow_send_data(ssock, wdata, rec_len))
+	    {
+		ssock->wbio_cur = NULL;
+		wdata = NULL;
+	    }
+	}
+
+	if (wdata == NULL)
+	    wdata = alloc_write_bio_record(ssock, len);
+
+	if (wdata) {
+	    pj_memcpy(wdata->data.content + wdata->data_len, data, len);
+	    wdata->data_len += len;
+	    return len;
+	}
+    }
+
+    /* The send buffer is full. Never fail here, OpenSSL may be in the
+     * middle of a record and part of it may already be in the records.
+     */
+    if (!queue_write_bio_pend(ssock, data, len))
+	return -1;
+
+    return len;
+}
+
+static int ssl_bio_read(BIO *bio, char *data, int len)
+{
+    pj_ssl_sock_t *ssock = (pj_ssl_sock_t*)bio->ptr;
+
+    BIO_clear_retry_flags(bio);
+
+    if (ssock == NULL || ssock->rbio_len == 0) {
+	BIO_set_retry_read(bio);
+	return -1;
+    }
+
+    if ((pj_size_t)len > ssock->rbio_len)
+	len = ssock->rbio_len;
+
+    pj_memcpy(data, ssock->rbio_ptr, len);
+    ssock->rbio_ptr += len;
+    ssock->rbio_len -= len;
+
+    return len;
+}
+
+static int ssl_bio_puts(BIO *bio, const char *str)
+{
+    return ssl_bio_write(bio, str, pj_ansi_strlen(str));
+}
+
+static long ssl_bio_ctrl(BIO *bio, int cmd, long num, void *ptr)
+{
+    pj_ssl_sock_t *ssock = (pj_ssl_sock_t*)bio->ptr;
+
+    PJ_UNUSED_ARG(ptr);
+
+    switch (cmd) {
+    case BIO_CTRL_PENDING:
+	return ssock? (long)ssock->rbio_len : 0;
+    case BIO_CTRL_WPENDING:
+	/* Written data is never held in the BIO */
+	return 0;
+    case BIO_CTRL_GET_CLOSE:
+	return bio->shutdown;
+    case BIO_CTRL_SET_CLOSE:
+	bio->shutdown = (int)num;
+	return 1;
+    case BIO_CTRL_RESET:
+    case BIO_CTRL_FLUSH:
+    case BIO_CTRL_DUP:
+	return 1;
+    default:
+	return 0;
+    }
+}
+
+static int ssl_bio_create(BIO *bio)
+{
+    bio->init = 1;
+    bio->num = 0;
+    bio->ptr = NULL;
+    bio->flags = 0;
+    return 1;
+}
+
+static int ssl_bio_destroy(BIO *bio)
+{
+    if (bio == NULL)
+	return 0;
+
+    bio->ptr = NULL;
+    return 1;
+}
+
+static BIO_METHOD ssl_bio_method =
+{
+    BIO_TYPE_SOURCE_SINK,
+    "pj_ssl_sock",
+    &ssl_bio_write,
+    &ssl_bio_read,
+    &ssl_bio_puts,
+    NULL,
+    &ssl_bio_ctrl,
+    &ssl_bio_create,
+    &ssl_bio_destroy,
+    NULL
+};
+
+
 /* Setting SSL sock cipher list */
 static pj_status_t set_cipher_list(pj_ssl_sock_t *ssock);
 
@@ -611,12 +867,12 @@ static pj_status_t create_ssl(pj_ssl_sock_t *ssock)
     if (status != PJ_SUCCESS)
 	return status;
 
-    /* Setup SSL BIOs */
-    ssock->ossl_rbio = BIO_new(BIO_s_mem());
-    ssock->ossl_wbio = BIO_new(BIO_s_mem());
-    BIO_set_close(ssock->ossl_rbio, BIO_CLOSE);
-    BIO_set_close(ssock->ossl_wbio, BIO_CLOSE);
-    SSL_set_bio(ssock->ossl_ssl, ssock->ossl_rbio, ssock->ossl_wbio);
+    /* Setup SSL BIO, the same BIO is used for both reading and writing */
+    ssock->ossl_bio = BIO_new(&ssl_bio_method);
+    if (ssock->ossl_bio == NULL)
+	return GET_SSL_STATUS(ssock);
+    ssock->ossl_bio->ptr = ssock;
+    SSL_set_bio(ssock->ossl_ssl, ssock->ossl_bio, ssock->ossl_bio);
 
     return PJ_SUCCESS;
 }
@@ -627,10 +883,34 @@ static void destroy_ssl(pj_ssl_sock_t *ssock)
 {
     /* Destroy SSL instance */
     if (ssock->ossl_ssl) {
+	/* Detach the BIO first, data generated by SSL_shutdown() will
+	 * never be sent anyway.
+	 */
+	if (ssock->ossl_bio)
+	    ssock->ossl_bio->ptr = NULL;
 	SSL_shutdown(ssock->ossl_ssl);
 	SSL_free(ssock->ossl_ssl); /* this will also close BIOs */
 	ssock->ossl_ssl = NULL;
+	ssock->ossl_bio = NULL;
+    }
+
+    /* Release records that have not been handed to the network */
+    if (ssock->wbio_first) {
+	write_data_t *wdata = ssock->wbio_first;
+
+	while (wdata != &ssock->send_pending) {
+	    write_data_t *next = wdata->next;
+	    free_send_data(ssock, wdata);
+	    wdata = next;
+	}
+	ssock->wbio_first = NULL;
     }
+    ssock->wbio_cur = NULL;
+    ssock->wbio_pend.data_len = 0;
+    ssock->wbio_pend.app_key = NULL;
+    ssock->wbio_pend.plain_data_len = 0;
+    ssock->rbio_ptr = NULL;
+    ssock->rbio_len = 0;
 
     /* Destroy SSL context */
     if (ssock->ossl_ctx) {
@@ -1114,6 +1394,64 @@ init_send_data:
     return p;
 }
 
+/* Get the length of the largest contiguous free slot in the send buffer */
+static pj_size_t get_send_data_avail(pj_ssl_sock_t *ssock)
+{
+    send_buf_t *send_buf = &ssock->send_buf;
+    char *reg1;
+    pj_size_t reg1_len, reg2_len;
+
+    if (send_buf->len == 0)
+	return send_buf->max_len;
+
+    /* Same region analysis as in alloc_send_data() */
+    reg1 = send_buf->start + send_buf->len;
+    if (reg1 >= send_buf->buf + send_buf->max_len)
+	reg1 -= send_buf->max_len;
+    reg1_len = send_buf->max_len - send_buf->len;
+    if (reg1 + reg1_len > send_buf->buf + send_buf->max_len) {
+	reg1_len = send_buf->buf + send_buf->max_len - reg1;
+	reg2_len = send_buf->start - send_buf->buf;
+    } else {
+	reg2_len = 0;
+    }
+
+    return PJ_MAX(reg1_len, reg2_len);
+}
+
+/* Grow the slot of the last send data in place, this is only possible when
+ * the free space right after the slot is large enough.
+ */
+static pj_bool_t grow_send_data(pj_ssl_sock_t *ssock, write_data_t *wdata,
+				pj_size_t len)
+{
+    send_buf_t *send_buf = &ssock->send_buf;
+    char *end = (char*)wdata + wdata->record_len;
+    pj_size_t extra_len, free_len;
+
+    pj_assert(ssock->send_pending.prev == wdata);
+    pj_assert(len >= wdata->record_len);
+
+    extra_len = len - wdata->record_len;
+    if (send_buf->max_len - send_buf->len < extra_len)
+	return PJ_FALSE;
+
+    /* Free space after the slot ends at the buffer end, or at the first
+     * data when the buffer content is wrapped.
+     */
+    if (end >= send_buf->start)
+	free_len = send_buf->buf + send_buf->max_len - end;
+    else
+	free_len = send_buf->start - end;
+    if (free_len < extra_len)
+	return PJ_FALSE;
+
+    send_buf->len += extra_len;
+    wdata->record_len = len;
+
+    return PJ_TRUE;
+}
+
 static void free_send_data(pj_ssl_sock_t *ssock, write_data_t *wdata)
 {
     send_buf_t *buf = &ssock->send_buf;
@@ -1224,84 +1562,124 @@ pj_status_t pj_ssl_sock_ossl_test_send_buf(pj_pool_t *pool)
 
 
 /* Flush write BIO to network socket. Note that any access to write BIO
- * MUST be serialized, so mutex protection must cover any call to OpenSSL
- * API (that possibly generate data for write BIO) along with the call to
- * this function (flushing all data in write BIO generated by above 
- * OpenSSL API call).
+ * MUST be serialized, so the write mutex must be held by the caller, and
+ * it must cover any call to OpenSSL API (that possibly generate data for
+ * write BIO) along with the call to this function (flushing all data in
+ * write BIO generated by above OpenSSL API call).
+ *
+ * The write BIO puts the secured data directly into send buffer records,
+ * so flushing is just a matter of handing the records over to the active
+ * socket. The last record carries the application send key and the plain
+ * data length. When part of the data is still waiting for room in the
+ * send buffer, the send key goes along with that part and PJ_EPENDING is
+ * returned, the rest will be sent when the sent records free some room.
  */
 static pj_status_t flush_write_bio(pj_ssl_sock_t *ssock, 
 				   pj_ioqueue_op_key_t *send_key,
 				   pj_size_t orig_len,
 				   unsigned flags)
 {
-    char *data;
-    pj_ssize_t len;
-    write_data_t *wdata;
-    pj_size_t needed_len;
-    pj_status_t status;
+    write_data_t *pend = &ssock->wbio_pend;
+    pj_bool_t has_app_key = (send_key != &ssock->handshake_op_key);
+    pj_status_t status = PJ_SUCCESS;
+
+    /* The current record is complete */
+    ssock->wbio_cur = NULL;
+
+    if (has_app_key) {
+	if (pend->data_len) {
+	    pend->app_key = send_key;
+	    pend->plain_data_len = orig_len;
+	    status = PJ_EPENDING;
+	} else if (ssock->wbio_first) {
+	    ssock->send_pending.prev->app_key = send_key;
+	    ssock->send_pending.prev->plain_data_len = orig_len;
+	}
+    }
 
-    pj_lock_acquire(ssock->write_mutex);
+    while (1) {
+	write_data_t *wdata, *last;
 
-    /* Check if there is data in write BIO, flush it if any */
-    if (!BIO_pending(ssock->ossl_wbio)) {
-	pj_lock_release(ssock->write_mutex);
-	return PJ_SUCCESS;
-    }
+	/* Move the pending data into records as far as there is room, data
+	 * of another application send is left to its own sender.
+	 */
+	if (pend->data_len && (pend->app_key == NULL || 
+			       pend->app_key == send_key))
+	{
+	    drain_write_bio_pend(ssock);
+	}
 
-    /* Get data and its length */
-    len = BIO_get_mem_data(ssock->ossl_wbio, &data);
-    if (len == 0) {
-	pj_lock_release(ssock->write_mutex);
-	return PJ_SUCCESS;
-    }
+	/* Check if there is data in write BIO, flush it if any */
+	if (ssock->wbio_first == NULL)
+	    break;
 
-    /* Calculate buffer size needed, and align it to 8 */
-    needed_len = len + sizeof(write_data_t);
-    needed_len = ((needed_len + 7) >> 3) << 3;
+	/* Take over all records written by the BIO so far */
+	wdata = ssock->wbio_first;
+	last = ssock->send_pending.prev;
+	ssock->wbio_first = NULL;
 
-    /* Allocate buffer for send data */
-    wdata = alloc_send_data(ssock, needed_len);
-    if (wdata == NULL) {
-	pj_lock_release(ssock->write_mutex);
-	return PJ_ENOMEM;
-    }
+	/* Send them. The list is only followed with the mutex held, a sent
+	 * record may be freed by the send completion callback any time after
+	 * it has been handed to the active socket.
+	 */
+	while (1) {
+	    write_data_t *next = wdata->next;
+	    pj_bool_t is_last = (wdata == last);
+	    pj_bool_t is_app = (has_app_key && wdata->app_key == send_key);
+	    pj_ssize_t len = wdata->data_len;
+	    pj_status_t send_status;
 
-    /* Copy the data and set its properties into the send data */
-    pj_ioqueue_op_key_init(&wdata->key, sizeof(pj_ioqueue_op_key_t));
-    wdata->key.user_data = wdata;
-    wdata->app_key = send_key;
-    wdata->record_len = needed_len;
-    wdata->data_len = len;
-    wdata->plain_data_len = orig_len;
-    wdata->flags = flags;
-    pj_memcpy(&wdata->data, data, len);
+	    wdata->flags = flags;
 
-    /* Reset write BIO */
-    BIO_reset(ssock->ossl_wbio);
+	    /* Ticket #1573: Don't hold mutex while calling PJLIB socket
+	     * send().
+	     */
+	    pj_lock_release(ssock->write_mutex);
 
-    /* Ticket #1573: Don't hold mutex while calling PJLIB socket send(). */
-    pj_lock_release(ssock->write_mutex);
+	    if (ssock->param.sock_type == pj_SOCK_STREAM()) {
+		send_status = pj_activesock_send(ssock->asock, &wdata->key, 
+						 wdata->data.content, &len,
+						 flags);
+	    } else {
+		send_status = pj_activesock_sendto(ssock->asock, &wdata->key, 
+						   wdata->data.content, &len,
+						   flags,
+						   (pj_sockaddr_t*)
+						   &ssock->rem_addr,
+						   ssock->addr_len);
+	    }
 
-    /* Send it */
-    if (ssock->param.sock_type == pj_SOCK_STREAM()) {
-	status = pj_activesock_send(ssock->asock, &wdata->key, 
-				    wdata->data.content, &len,
-				    flags);
-    } else {
-	status = pj_activesock_sendto(ssock->asock, &wdata->key, 
-				      wdata->data.content, &len,
-				      flags,
-				      (pj_sockaddr_t*)&ssock->rem_addr,
-				      ssock->addr_len);
-    }
+	    pj_lock_acquire(ssock->write_mutex);
 
-    if (status != PJ_EPENDING) {
-	/* When the sending is not pending, remove the wdata from send
-	 * pending list.
-	 */
-	pj_lock_acquire(ssock->write_mutex);
-	free_send_data(ssock, wdata);
-	pj_lock_release(ssock->write_mutex);
+	    if (send_status != PJ_EPENDING) {
+		/* When the sending is not pending, remove the wdata from
+		 * send pending list.
+		 */
+		free_send_data(ssock, wdata);
+	    }
+
+	    if (send_status != PJ_SUCCESS && send_status != PJ_EPENDING) {
+		/* Drop the rest of the records and the pending data */
+		while (!is_last) {
+		    wdata = next;
+		    next = wdata->next;
+		    is_last = (wdata == last);
+		    free_send_data(ssock, wdata);
+		}
+		pend->data_len = 0;
+		if (pend->app_key == send_key)
+		    pend->app_key = NULL;
+		return send_status;
+	    }
+
+	    if (is_app)
+		status = send_status;
+
+	    if (is_last)
+		break;
+
+	    wdata = next;
+	}
     }
 
     return status;
@@ -1343,12 +1721,12 @@ static pj_status_t do_handshake(pj_ssl_sock_t *ssock)
     /* Perform SSL handshake */
     pj_lock_acquire(ssock->write_mutex);
     err = SSL_do_handshake(ssock->ossl_ssl);
-    pj_lock_release(ssock->write_mutex);
 
     /* SSL_do_handshake() may put some pending data into SSL write BIO, 
      * flush it if any.
      */
     status = flush_write_bio(ssock, &ssock->handshake_op_key, 0, 0);
+    pj_lock_release(ssock->write_mutex);
     if (status != PJ_SUCCESS && status != PJ_EPENDING) {
 	return status;
     }
@@ -1373,6 +1751,30 @@ static pj_status_t do_handshake(pj_ssl_sock_t *ssock)
 }
 
 
+/* Leave network data that has not been consumed by SSL in the active
+ * socket read buffer, it will be prepended to the next read.
+ */
+static pj_status_t keep_unread_data(pj_ssl_sock_t *ssock,
+				    void *data,
+				    pj_size_t *remainder)
+{
+    pj_size_t len = ssock->rbio_len;
+
+    if (len && ssock->rbio_ptr != (char*)data)
+	pj_memmove(data, ssock->rbio_ptr, len);
+
+    ssock->rbio_ptr = NULL;
+    ssock->rbio_len = 0;
+
+    /* Active socket needs some room for the next read */
+    if (len >= ssock->param.read_buffer_size)
+	return PJ_ETOOSMALL;
+
+    *remainder = len;
+    return PJ_SUCCESS;
+}
+
+
 /*
  *******************************************************************
  * Active socket callbacks.
@@ -1387,16 +1789,11 @@ static pj_bool_t asock_on_data_read (pj_activesock_t *asock,
 {
     pj_ssl_sock_t *ssock = (pj_ssl_sock_t*)
 			   pj_activesock_get_user_data(asock);
-    pj_size_t nwritten;
 
-    /* Socket error or closed */
+    /* Let the SSL BIO read directly from the active socket buffer */
     if (data && size > 0) {
-	/* Consume the whole data */
-	nwritten = BIO_write(ssock->ossl_rbio, data, size);
-	if (nwritten < size) {
-	    status = GET_SSL_STATUS(ssock);
-	    goto on_error;
-	}
+	ssock->rbio_ptr = (char*)data;
+	ssock->rbio_len = size;
     }
 
     /* Check if SSL handshake hasn't finished yet */
@@ -1410,7 +1807,20 @@ static pj_bool_t asock_on_data_read (pj_activesock_t *asock,
 	if (status != PJ_EPENDING)
 	    ret = on_handshake_complete(ssock, status);
 
-	return ret;
+	if (!ret)
+	    return PJ_FALSE;
+
+	/* Application data may follow the handshake in the same read,
+	 * deliver it now if application has started reading.
+	 */
+	if (status != PJ_SUCCESS || !ssock->read_started ||
+	    ssock->rbio_len == 0)
+	{
+	    status = keep_unread_data(ssock, data, remainder);
+	    if (status != PJ_SUCCESS)
+		goto on_error;
+	    return PJ_TRUE;
+	}
     }
 
     /* See if there is any decrypted data for the application */
@@ -1506,9 +1916,16 @@ static pj_bool_t asock_on_data_read (pj_activesock_t *asock,
 	} while (1);
     }
 
+    status = keep_unread_data(ssock, data, remainder);
+    if (status != PJ_SUCCESS)
+	goto on_error;
+
     return PJ_TRUE;
 
 on_error:
+    ssock->rbio_ptr = NULL;
+    ssock->rbio_len = 0;
+
     if (ssock->ssl_state == SSL_STATE_HANDSHAKING)
 	return on_handshake_complete(ssock, status);
 
@@ -1533,10 +1950,43 @@ static pj_bool_t asock_on_data_sent (pj_activesock_t *asock,
 {
     pj_ssl_sock_t *ssock = (pj_ssl_sock_t*)
 			   pj_activesock_get_user_data(asock);
+    write_data_t *wdata = (write_data_t*)send_key->user_data;
+    pj_ioqueue_op_key_t *app_key = wdata->app_key;
+    pj_size_t plain_data_len = wdata->plain_data_len;
+    pj_ioqueue_op_key_t *pend_key = NULL;
+    pj_ssize_t pend_sent = 0;
+    pj_bool_t pend_flushed = PJ_FALSE;
 
-    PJ_UNUSED_ARG(send_key);
     PJ_UNUSED_ARG(sent);
 
+    /* Update write buffer state */
+    pj_lock_acquire(ssock->write_mutex);
+    free_send_data(ssock, wdata);
+
+    /* Some room has been freed, send the data waiting for it */
+    if (ssock->wbio_pend.data_len) {
+	pj_ioqueue_op_key_t *key = ssock->wbio_pend.app_key;
+	pj_size_t len = ssock->wbio_pend.plain_data_len;
+	pj_status_t status;
+
+	status = flush_write_bio(ssock,
+				 key? key : &ssock->handshake_op_key,
+				 len, 0);
+
+	if (ssock->wbio_pend.data_len == 0) {
+	    pend_flushed = PJ_TRUE;
+
+	    /* Sending the application data has completed immediately or
+	     * failed, there will be no callback for it.
+	     */
+	    if (key && status != PJ_EPENDING) {
+		pend_key = key;
+		pend_sent = (status == PJ_SUCCESS)? (pj_ssize_t)len : -status;
+	    }
+	}
+    }
+    pj_lock_release(ssock->write_mutex);
+
     if (ssock->ssl_state == SSL_STATE_HANDSHAKING) {
 	/* Initial handshaking */
 	pj_status_t status;
@@ -1546,26 +1996,41 @@ static pj_bool_t asock_on_data_sent (pj_activesock_t *asock,
 	if (status != PJ_EPENDING)
 	    return on_handshake_complete(ssock, status);
 
-    } else if (send_key != &ssock->handshake_op_key) {
+    } else if (ssock->ssl_state == SSL_STATE_ESTABLISHED) {
 	/* Some data has been sent, notify application */
-	write_data_t *wdata = (write_data_t*)send_key->user_data;
-	if (ssock->param.cb.on_data_sent) {
+	if (ssock->param.cb.on_data_sent &&
+	    app_key != &ssock->handshake_op_key)
+	{
 	    pj_bool_t ret;
-	    ret = (*ssock->param.cb.on_data_sent)(ssock, wdata->app_key, 
-						  wdata->plain_data_len);
+	    ret = (*ssock->param.cb.on_data_sent)(ssock, app_key, 
+						  plain_data_len);
 	    if (!ret) {
 		/* We've been destroyed */
 		return PJ_FALSE;
 	    }
 	}
 
-	/* Update write buffer state */
-	pj_lock_acquire(ssock->write_mutex);
-	free_send_data(ssock, wdata);
-	pj_lock_release(ssock->write_mutex);
+	if (ssock->param.cb.on_data_sent && pend_key) {
+	    pj_bool_t ret;
+	    ret = (*ssock->param.cb.on_data_sent)(ssock, pend_key, pend_sent);
+	    if (!ret) {
+		/* We've been destroyed */
+		return PJ_FALSE;
+	    }
+	}
 
-    } else {
-	/* SSL re-negotiation is on-progress, just do nothing */
+	/* Sending delayed by the data waiting for room can go on now */
+	if (pend_flushed) {
+	    pj_status_t status;
+
+	    status = flush_delayed_send(ssock);
+	    if (status != PJ_SUCCESS && status != PJ_EPENDING &&
+		status != PJ_EBUSY)
+	    {
+		PJ_PERROR(1,(ssock->pool->obj_name, status, 
+			     "Failed to flush delayed send"));
+	    }
+	}
     }
 
     return PJ_TRUE;
@@ -2182,8 +2647,16 @@ static pj_status_t ssl_write(pj_ssl_sock_t *ssock,
      * until re-negotiation is completed.
      */
     pj_lock_acquire(ssock->write_mutex);
+
+    /* Some data is still waiting for room in the send buffer, just delay
+     * sending until it is sent.
+     */
+    if (ssock->wbio_pend.data_len) {
+	pj_lock_release(ssock->write_mutex);
+	return PJ_EBUSY;
+    }
+
     nwritten = SSL_write(ssock->ossl_ssl, data, size);
-    pj_lock_release(ssock->write_mutex);
     
     if (nwritten == size) {
 	/* All data written, flush write BIO to network socket */
@@ -2211,6 +2684,8 @@ static pj_status_t ssl_write(pj_ssl_sock_t *ssock,
 	status = PJ_ENOMEM;
     }
 
+    pj_lock_release(ssock->write_mutex);
+
     return status;
 }
 
@@ -79,6 +79,7 @@ struct test_state
     pj_bool_t	    done;	    /* test done flag			    */
     char	   *send_str;	    /* data to send once connected	    */
     unsigned	    send_str_len;   /* send data length			    */
+    unsigned	    send_chunk;	    /* max bytes per send, zero=no limit    */
     pj_bool_t	    check_echo;	    /* flag to compare sent & echoed data   */
     const char	   *check_echo_ptr; /* pointer/cursor for comparing data    */
     struct send_key send_key;	    /* send op key			    */
@@ -161,6 +162,8 @@ static pj_bool_t ssl_on_connect_complete(pj_ssl_sock_t *ssock,
 	pj_ssize_t size;
 
 	size = st->send_str_len - st->sent;
+	if (st->send_chunk && size > (pj_ssize_t)st->send_chunk)
+	    size = st->send_chunk;
 	status = pj_ssl_sock_send(ssock, (pj_ioqueue_op_key_t*)&st->send_key, 
 				  st->send_str + st->sent, &size, 0);
 	if (status != PJ_SUCCESS && status != PJ_EPENDING) {
@@ -174,6 +177,10 @@ static pj_bool_t ssl_on_connect_complete(pj_ssl_sock_t *ssock,
 	    break;
     }
 
+    /* The rest will be sent from ssl_on_data_sent() */
+    if (status == PJ_EPENDING)
+	status = PJ_SUCCESS;
+
 on_return:
     st->err = status;
 
@@ -232,6 +239,8 @@ static pj_bool_t ssl_on_accept_complete(pj_ssl_sock_t *ssock,
 	pj_ssize_t size;
 
 	size = st->send_str_len - st->sent;
+	if (st->send_chunk && size > (pj_ssize_t)st->send_chunk)
+	    size = st->send_chunk;
 	status = pj_ssl_sock_send(newsock, (pj_ioqueue_op_key_t*)&st->send_key, 
 				  st->send_str + st->sent, &size, 0);
 	if (status != PJ_SUCCESS && status != PJ_EPENDING) {
@@ -245,6 +254,10 @@ static pj_bool_t ssl_on_accept_complete(pj_ssl_sock_t *ssock,
 	    break;
     }
 
+    /* The rest will be sent from ssl_on_data_sent() */
+    if (status == PJ_EPENDING)
+	status = PJ_SUCCESS;
+
 on_return:
     st->err = status;
 
@@ -373,6 +386,8 @@ static pj_bool_t ssl_on_data_sent(pj_ssl_sock_t *ssock,
 	    pj_status_t status;
 
 	    size = st->send_str_len - st->sent;
+	    if (st->send_chunk && size > (pj_ssize_t)st->send_chunk)
+		size = st->send_chunk;
 	    status = pj_ssl_sock_send(ssock, (pj_ioqueue_op_key_t*)&st->send_key, 
 				      st->send_str + st->sent, &size, 0);
 	    if (status != PJ_SUCCESS && status != PJ_EPENDING) {
@@ -1329,6 +1344,185 @@ on_return:
     return status;
 }
 
+/* Test bulk data transfer speed. Server sends the data in chunks once
+ * the SSL connection is established, client verifies it.
+ */
+static int throughput_test(unsigned data_len, unsigned chunk,
+			   unsigned send_buf_size)
+{
+    pj_pool_t *pool = NULL;
+    pj_ioqueue_t *ioqueue = NULL;
+    pj_ssl_sock_t *ssock_serv = NULL;
+    pj_ssl_sock_t *ssock_cli = NULL;
+    pj_ssl_sock_param param;
+    struct test_state state_serv = { 0 };
+    struct test_state state_cli = { 0 };
+    pj_sockaddr addr, listen_addr;
+    pj_ssl_cipher ciphers[1];
+    pj_ssl_cert_t *cert = NULL;
+    pj_timestamp t1, t2;
+    pj_uint32_t msec;
+    pj_status_t status;
+
+    pool = pj_pool_create(mem, "ssl_thru", 256, 256, NULL);
+
+    status = pj_ioqueue_create(pool, 4, &ioqueue);
+    if (status != PJ_SUCCESS) {
+	goto on_return;
+    }
+
+    pj_ssl_sock_param_default(&param);
+    param.cb.on_accept_complete = &ssl_on_accept_complete;
+    param.cb.on_connect_complete = &ssl_on_connect_complete;
+    param.cb.on_data_read = &ssl_on_data_read;
+    param.cb.on_data_sent = &ssl_on_data_sent;
+    param.ioqueue = ioqueue;
+    param.ciphers = ciphers;
+    param.ciphers_num = 1;
+    param.send_buffer_size = send_buf_size;
+    ciphers[0] = PJ_TLS_RSA_WITH_AES_256_CBC_SHA;
+
+    {
+	pj_str_t tmp_st;
+	pj_sockaddr_init(PJ_AF_INET, &addr, pj_strset2(&tmp_st, "127.0.0.1"), 0);
+    }
+
+    /* Data to transfer */
+    state_serv.send_str_len = data_len;
+    state_serv.send_str = (char*)pj_pool_alloc(pool, data_len);
+    {
+	unsigned i;
+	for (i = 0; i < data_len; ++i)
+	    state_serv.send_str[i] = (char)(pj_rand() % 256);
+    }
+
+    /* === SERVER === */
+    param.user_data = &state_serv;
+
+    state_serv.pool = pool;
+    state_serv.is_server = PJ_TRUE;
+    state_serv.send_chunk = chunk;
+
+    status = pj_ssl_sock_create(pool, &param, &ssock_serv);
+    if (status != PJ_SUCCESS) {
+	goto on_return;
+    }
+
+    {
+	pj_str_t tmp1, tmp2, tmp3, tmp4;
+
+	status = pj_ssl_cert_load_from_files(pool, 
+					     pj_strset2(&tmp1, (char*)CERT_CA_FILE), 
+					     pj_strset2(&tmp2, (char*)CERT_FILE), 
+					     pj_strset2(&tmp3, (char*)CERT_PRIVKEY_FILE), 
+					     pj_strset2(&tmp4, (char*)CERT_PRIVKEY_PASS), 
+					     &cert);
+	if (status != PJ_SUCCESS) {
+	    goto on_return;
+	}
+
+	status = pj_ssl_sock_set_certificate(ssock_serv, pool, cert);
+	if (status != PJ_SUCCESS) {
+	    goto on_return;
+	}
+    }
+
+    status = pj_ssl_sock_start_accept(ssock_serv, pool, &addr, pj_sockaddr_get_len(&addr));
+    if (status != PJ_SUCCESS) {
+	goto on_return;
+    }
+
+    {
+	pj_ssl_sock_info info;
+
+	pj_ssl_sock_get_info(ssock_serv, &info);
+	pj_sockaddr_cp(&listen_addr, &info.local_addr);
+    }
+
+    /* === CLIENT === */
+    param.user_data = &state_cli;
+
+    /* Client only checks the data from server, it has nothing to send */
+    state_cli.pool = pool;
+    state_cli.check_echo = PJ_TRUE;
+    state_cli.send_str = state_serv.send_str;
+    state_cli.send_str_len = data_len;
+    state_cli.sent = data_len;
+
+    status = pj_ssl_sock_create(pool, &param, &ssock_cli);
+    if (status != PJ_SUCCESS) {
+	goto on_return;
+    }
+
+    pj_get_timestamp(&t1);
+
+    status = pj_ssl_sock_start_connect(ssock_cli, pool, &addr, &listen_addr, pj_sockaddr_get_len(&addr));
+    if (status == PJ_SUCCESS) {
+	ssl_on_connect_complete(ssock_cli, PJ_SUCCESS);
+    } else if (status == PJ_EPENDING) {
+	status = PJ_SUCCESS;
+    } else {
+	goto on_return;
+    }
+
+    /* Wait until everything has been received or error */
+    while (!state_serv.err && !state_cli.err && !state_cli.done)
+    {
+#ifdef PJ_SYMBIAN
+	pj_symbianos_poll(-1, 1000);
+#else
+	pj_time_val delay = {0, 100};
+	pj_ioqueue_poll(ioqueue, &delay);
+#endif
+    }
+
+    pj_get_timestamp(&t2);
+
+    /* Clean up sockets */
+    {
+	pj_time_val delay = {0, 100};
+	while (pj_ioqueue_poll(ioqueue, &delay) > 0);
+    }
+
+    if (state_serv.err || state_cli.err) {
+	if (state_serv.err != PJ_SUCCESS)
+	    status = state_serv.err;
+	else
+	    status = state_cli.err;
+
+	goto on_return;
+    }
+
+    /* Sender may have failed without client noticing it */
+    if (state_cli.recv != data_len) {
+	PJ_LOG(3, ("", "...ERROR: received %u of %u bytes",
+		   state_cli.recv, data_len));
+	status = PJ_EBUG;
+	goto on_return;
+    }
+
+    msec = pj_elapsed_msec(&t1, &t2);
+    if (msec == 0)
+	msec = 1;
+
+    PJ_LOG(3, ("", "...Done!"));
+    PJ_LOG(3, ("", ".....Received %u bytes in %u ms (%u KB/s)",
+	       state_cli.recv, msec,
+	       (unsigned)((pj_uint64_t)state_cli.recv * 1000 / msec / 1024)));
+
+on_return:
+    if (ssock_serv)
+	pj_ssl_sock_close(ssock_serv);
+    if (ssock_cli && !state_cli.err && !state_cli.done) 
+	pj_ssl_sock_close(ssock_cli);
+    if (ioqueue)
+	pj_ioqueue_destroy(ioqueue);
+    if (pool)
+	pj_pool_release(pool);
+
+    return status;
+}
+
 #if 0 && (!defined(PJ_SYMBIAN) || PJ_SYMBIAN==0)
 pj_status_t pj_ssl_sock_ossl_test_send_buf(pj_pool_t *pool);
 static int ossl_test_send_buf()
@@ -1422,6 +1616,16 @@ int ssl_sock_test(void)
     if (ret != 0)
 	return ret;
 
+    PJ_LOG(3,("", "..throughput test"));
+    ret = throughput_test(4 * 1024 * 1024, 16000, 4 * 16000);
+    if (ret != 0)
+	return ret;
+
+    PJ_LOG(3,("", "..throughput test w/ send buffer smaller than a record"));
+    ret = throughput_test(1024 * 1024, 16000, 4000);
+    if (ret != 0)
+	return ret;
+
     PJ_LOG(3,("", "..client non-SSL (handshake timeout 5 secs)"));
     ret = client_non_ssl(5000);
     /* PJ_TIMEDOUT won't be returned as accepted socket is deleted silently */
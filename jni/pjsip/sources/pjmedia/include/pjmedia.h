@@ -33,6 +33,7 @@
 #include <pjmedia/conference.h>
 #include <pjmedia/converter.h>
 #include <pjmedia/delaybuf.h>
+#include <pjmedia/dsp.h>
 #include <pjmedia/echo.h>
 #include <pjmedia/echo_port.h>
 #include <pjmedia/endpoint.h>
@@ -64,6 +65,7 @@
 #include <pjmedia/tonegen.h>
 #include <pjmedia/transport.h>
 #include <pjmedia/transport_adapter_sample.h>
+#include <pjmedia/transport_bundle.h>
 #include <pjmedia/transport_ice.h>
 #include <pjmedia/transport_loop.h>
 #include <pjmedia/transport_srtp.h>
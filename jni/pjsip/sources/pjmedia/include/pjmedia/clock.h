@@ -25,6 +25,7 @@
  * @brief Media clock.
  */
 #include <pjmedia/types.h>
+#include <pj/math.h>
 
 
 /**
@@ -75,6 +76,21 @@
  * the clock <b>tick</b> expires. When it is run synchronously, 
  * application must continuously polls the clock generator to synchronize
  * the timing.
+ *
+ * Asynchronous clocks don't get a thread each (except the ones created
+ * with PJMEDIA_CLOCK_NO_HIGHEST_PRIO): they are serviced by a
+ * small number of shared threads (see PJMEDIA_CLOCK_SCHED_THREAD_CNT),
+ * which keep the clocks ordered by their next deadline and sleep until the
+ * earliest one. Clocks with the same interval that are serviced by the
+ * same thread are aligned to tick together, so the callbacks of one clock
+ * may be delayed by the callbacks of the others and should be short.
+ *
+ * A shared thread is allocated from the pool factory of the clock that
+ * started it, and is stopped when its last clock is destroyed. If that
+ * happens from the clock's own callback, the thread can only be joined
+ * later, by the next clock operation, by pjmedia_endpt_destroy() or by
+ * pj_shutdown(). Applications without a media endpoint should call
+ * #pjmedia_clock_sched_reap() before destroying the pool factory.
  */
 
 PJ_BEGIN_DECL
@@ -176,6 +192,7 @@ enum pjmedia_clock_options
 
     /**
      * Prevent the clock from setting it's thread to highest priority.
+     * The clock then runs in its own thread instead of a shared one.
      */
     PJMEDIA_CLOCK_NO_HIGHEST_PRIO = 2
 };
@@ -194,6 +211,42 @@ typedef struct pjmedia_clock_param
     unsigned clock_rate;
 } pjmedia_clock_param;
 
+/**
+ * Media clock statistics, see #pjmedia_clock_get_stat().
+ */
+typedef struct pjmedia_clock_stat
+{
+    /**
+     * Number of ticks (callback invocations) since the clock was created.
+     */
+    unsigned	    tick_cnt;
+
+    /**
+     * How late the ticks were relative to their deadlines, in usec.
+     */
+    pj_math_stat    late_usec;
+
+    /**
+     * Number of ticks that were late by one full interval or more, e.g.
+     * because an earlier callback took too long.
+     */
+    unsigned	    overrun_cnt;
+
+    /**
+     * Number of times the clock gave up catching up with missed ticks
+     * after a large timing jump and restarted its schedule from now.
+     */
+    unsigned	    resync_cnt;
+
+    /**
+     * Number of wakeups of the thread servicing the clock. With shared
+     * clock threads (see PJMEDIA_CLOCK_SCHED_THREAD_CNT), this counts all
+     * wakeups of the thread, on behalf of any of its clocks.
+     */
+    unsigned	    thread_wakeups;
+
+} pjmedia_clock_stat;
+
 /**
  * Type of media clock callback.
  *
@@ -313,6 +366,16 @@ PJ_DECL(pj_bool_t) pjmedia_clock_wait(pjmedia_clock *clock,
 				      pj_timestamp *ts);
 
 
+/**
+ * Get the clock timing statistics.
+ * @param clock		    The media clock.
+ * @param stat		    Argument to receive the statistics.
+ * @return		    PJ_SUCCES on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_clock_get_stat(const pjmedia_clock *clock,
+					    pjmedia_clock_stat *stat);
+
+
 /**
  * Destroy the clock.
  *
@@ -323,6 +386,13 @@ PJ_DECL(pj_bool_t) pjmedia_clock_wait(pjmedia_clock *clock,
 PJ_DECL(pj_status_t) pjmedia_clock_destroy(pjmedia_clock *clock);
 
 
+/**
+ * Join and release the shared clock threads whose last clock was destroyed
+ * from its own callback. This is called by pjmedia_endpt_destroy().
+ */
+PJ_DECL(void) pjmedia_clock_sched_reap(void);
+
+
 
 PJ_END_DECL
 
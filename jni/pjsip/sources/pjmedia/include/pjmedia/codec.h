@@ -484,6 +484,32 @@ typedef struct pjmedia_codec_op
     pj_status_t (*recover)(pjmedia_codec *codec,
 			   unsigned out_size,
 			   struct pjmedia_frame *output);
+
+    /**
+     * Instruct the codec to decode several consecutive base frames, such
+     * as all frames of one packet, in one call. The decoded samples of
+     * the frames are placed one after another in the output buffer, as
+     * if decode() were called for each frame in turn. Codecs implement
+     * this when they can do it cheaper than one decode() per frame.
+     * This operation is optional and may be NULL.
+     *
+     * Application should call #pjmedia_codec_decode_frames() instead of 
+     * calling this function directly.
+     *
+     * @param codec	The codec instance.
+     * @param frame_cnt	Number of input frames.
+     * @param input	The input frames, each with base frame ptime.
+     * @param out_size	The length of buffer in the output frame.
+     * @param output	The output frame. On return, its size is the
+     *			total size of the decoded samples.
+     *
+     * @return		PJ_SUCCESS on success;
+     */
+    pj_status_t (*decode_frames)(pjmedia_codec *codec,
+				 unsigned frame_cnt,
+				 const struct pjmedia_frame input[],
+				 unsigned out_size,
+				 struct pjmedia_frame *output);
 } pjmedia_codec_op;
 
 
@@ -1093,6 +1119,29 @@ PJ_INLINE(pj_status_t) pjmedia_codec_decode(
 }
 
 
+/**
+ * Instruct the codec to decode several consecutive base frames, each
+ * with ptime equal to base frame ptime, into one output buffer. When
+ * the codec doesn't implement the decode_frames() operation, the frames
+ * are decoded one by one with decode().
+ *
+ * @param codec		The codec instance.
+ * @param frame_cnt	Number of input frames.
+ * @param input		The input frames.
+ * @param out_size	The length of buffer in the output frame.
+ * @param output	The output frame. On return, its size is the
+ *			total size of the decoded samples.
+ *
+ * @return		PJ_SUCCESS on success;
+ */
+PJ_DECL(pj_status_t) pjmedia_codec_decode_frames(
+					pjmedia_codec *codec,
+					unsigned frame_cnt,
+					const struct pjmedia_frame input[],
+					unsigned out_size,
+					struct pjmedia_frame *output );
+
+
 /**
  * Instruct the codec to recover a missing frame.
  *
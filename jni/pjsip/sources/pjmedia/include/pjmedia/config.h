@@ -201,6 +201,22 @@
 #endif
 
 
+/**
+ * Specify the maximum clock drift, in ppm, that the adaptive delay buffer
+ * compensates by continuously resampling its output. The delay buffer
+ * estimates the rate mismatch between its producer and consumer (for
+ * example the capture and playback clocks of a sound device) and keeps
+ * its level steady, so that WSOLA expansion and compression are only
+ * used when the drift exceeds this limit or on sudden level changes.
+ * Set this to zero to let WSOLA handle all drift.
+ *
+ * Default: 5000 (0.5%)
+ */
+#ifndef PJMEDIA_DELAY_BUF_MAX_DRIFT
+#   define PJMEDIA_DELAY_BUF_MAX_DRIFT	    5000
+#endif
+
+
 /**
  * Set this to non-zero to disable fade-out/in effect in the PLC when it
  * instructs WSOLA to generate synthetic frames. The use of fading may
@@ -261,6 +277,34 @@
 #endif
 
 
+/**
+ * Enable the SIMD implementations of the DSP kernels (see dsp.h). When
+ * disabled, only the scalar reference is compiled.
+ *
+ * Default: 1
+ */
+#ifndef PJMEDIA_HAS_DSP_SIMD
+#   define PJMEDIA_HAS_DSP_SIMD		    1
+#endif
+
+
+/**
+ * Specify whether the NEON DSP kernels are compiled in. dsp_neon.c must
+ * then be built with NEON enabled, e.g. with the ".neon" suffix in an
+ * Android.mk, even when the rest of the library is not. Whether the CPU
+ * actually has NEON is checked at runtime.
+ *
+ * Default: 1 when the compiler targets NEON, otherwise 0.
+ */
+#ifndef PJMEDIA_DSP_HAS_NEON
+#   if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#	define PJMEDIA_DSP_HAS_NEON	    1
+#   else
+#	define PJMEDIA_DSP_HAS_NEON	    0
+#   endif
+#endif
+
+
 /**
  * Unless specified otherwise, G711 codec is included by default.
  */
@@ -427,6 +471,19 @@
 #endif
 
 
+/**
+ * Specify the default setting of whether applications should offer and
+ * accept RTCP multiplexing on the RTP port (RFC 5761). When it is
+ * negotiated, a media line only needs one socket, and one ICE component
+ * instead of two. See #PJMEDIA_TPMED_RTCP_MUX.
+ *
+ * Default is equal to PJMEDIA_ADVERTISE_RTCP setting.
+ */
+#ifndef PJMEDIA_ADVERTISE_RTCP_MUX
+#   define PJMEDIA_ADVERTISE_RTCP_MUX		PJMEDIA_ADVERTISE_RTCP
+#endif
+
+
 /**
  * Interval to send RTCP packets, in msec
  */
@@ -561,6 +618,9 @@
 /**
  * Reserve some space for application extra data, e.g: SRTP auth tag,
  * in RTP payload, so the total payload length will not exceed the MTU.
+ * The stream also keeps this much free space after its outgoing RTP and
+ * RTCP packets, so the media transport can append the data in place
+ * (see #pjmedia_transport_send_rtp_inplace()).
  */
 #ifndef PJMEDIA_STREAM_RESV_PAYLOAD_LEN
 #   define PJMEDIA_STREAM_RESV_PAYLOAD_LEN	20
@@ -753,6 +813,83 @@
 #endif
 
 
+/**
+ * This macro declares the RTP header extension ID (RFC 5285) that is
+ * advertised by PJMEDIA in outgoing SDP for the client-to-mixer audio
+ * level extension (RFC 6464). When the remote SDP also has the extension,
+ * the stream stamps the level of every outgoing audio packet, and uses the
+ * levels received from the remote to skip decoding silent frames (see
+ * \a audio_level_skip in #pjmedia_stream_info). Valid values are 1 to 14.
+ * If this macro is set to zero, the extension would not be advertised
+ * nor used.
+ *
+ * If this value is changed to other number, please update the
+ * PJMEDIA_RTP_AUDIO_LEVEL_EXT_ID_STR too.
+ *
+ * Default: 0 (disabled)
+ */
+#ifndef PJMEDIA_RTP_AUDIO_LEVEL_EXT_ID
+#   define PJMEDIA_RTP_AUDIO_LEVEL_EXT_ID	    0
+#endif
+
+
+/**
+ * Macro to get the string representation of the audio level header
+ * extension ID.
+ */
+#ifndef PJMEDIA_RTP_AUDIO_LEVEL_EXT_ID_STR
+#   define PJMEDIA_RTP_AUDIO_LEVEL_EXT_ID_STR	    "1"
+#endif
+
+
+/**
+ * The time, in milliseconds, that the received audio level of a stream
+ * must stay below the skip threshold before the stream stops decoding
+ * frames. This hangover keeps the tail of a talk spurt from being clipped.
+ *
+ * Default: 200
+ */
+#ifndef PJMEDIA_STREAM_AUDIO_LEVEL_HANGOVER
+#   define PJMEDIA_STREAM_AUDIO_LEVEL_HANGOVER	    200
+#endif
+
+
+/**
+ * Packet loss, in percent, reported by remote in an RTCP report that
+ * makes a stream with adaptive packetization send longer packets. See
+ * \a adaptive_max_ptime in #pjmedia_stream_info.
+ *
+ * Default: 5
+ */
+#ifndef PJMEDIA_STREAM_ADAPTIVE_PTIME_LOSS
+#   define PJMEDIA_STREAM_ADAPTIVE_PTIME_LOSS	    5
+#endif
+
+
+/**
+ * Round trip time, in msec, that makes a stream with adaptive
+ * packetization send longer packets.
+ *
+ * Default: 400
+ */
+#ifndef PJMEDIA_STREAM_ADAPTIVE_PTIME_RTT
+#   define PJMEDIA_STREAM_ADAPTIVE_PTIME_RTT	    400
+#endif
+
+
+/**
+ * Number of consecutive RTCP reports with less than half of the loss
+ * and round trip time above, before a stream with adaptive packetization
+ * makes its packets shorter again. RTCP reports come every five seconds
+ * or so.
+ *
+ * Default: 3
+ */
+#ifndef PJMEDIA_STREAM_ADAPTIVE_PTIME_HOLD
+#   define PJMEDIA_STREAM_ADAPTIVE_PTIME_HOLD	    3
+#endif
+
+
 /**
  * Maximum tones/digits that can be enqueued in the tone generator.
  */
@@ -1122,6 +1259,63 @@
 #endif
 
 
+/**
+ * Number of shared threads servicing asynchronous media clocks (see
+ * #pjmedia_clock_create()). Each thread keeps its clocks ordered by their
+ * next deadline and sleeps until the earliest one, and clocks are spread
+ * over the threads. Clocks created with PJMEDIA_CLOCK_NO_HIGHEST_PRIO
+ * still get a thread of their own, running at normal priority.
+ *
+ * Set this to zero to run every clock in its own thread instead.
+ *
+ * Default: 1
+ */
+#ifndef PJMEDIA_CLOCK_SCHED_THREAD_CNT
+#   define PJMEDIA_CLOCK_SCHED_THREAD_CNT	    1
+#endif
+
+
+/**
+ * Make clock threads sleep to absolute CLOCK_MONOTONIC deadlines with
+ * clock_nanosleep(TIMER_ABSTIME), rather than with pj_thread_sleep(),
+ * which has millisecond resolution and accumulates wakeup latency.
+ *
+ * Default: 1 on Linux (including Android), 0 elsewhere.
+ */
+#ifndef PJMEDIA_CLOCK_HAS_ABS_SLEEP
+#   if (defined(PJ_LINUX) && PJ_LINUX!=0) || defined(__linux__)
+#	define PJMEDIA_CLOCK_HAS_ABS_SLEEP	    1
+#   else
+#	define PJMEDIA_CLOCK_HAS_ABS_SLEEP	    0
+#   endif
+#endif
+
+
+/**
+ * Number of events posted with PJMEDIA_EVENT_PUBLISH_POST_EVENT that the
+ * event manager may hold before publishers are slowed down. Pending
+ * idempotent events (e.g. keyframe requests or format changes) from the
+ * same source are coalesced and don't add up.
+ *
+ * Default: 256
+ */
+#ifndef PJMEDIA_EVENT_MGR_MAX_QUEUED_EVENTS
+#   define PJMEDIA_EVENT_MGR_MAX_QUEUED_EVENTS	    256
+#endif
+
+
+/**
+ * Maximum time, in milliseconds, a publisher waits for the event worker
+ * thread when the event queue is full. After that the event is queued
+ * anyway, events are never dropped.
+ *
+ * Default: 100
+ */
+#ifndef PJMEDIA_EVENT_MGR_MAX_POST_WAIT_MSEC
+#   define PJMEDIA_EVENT_MGR_MAX_POST_WAIT_MSEC	    100
+#endif
+
+
 /**
  * Minimum gap between two consecutive discards in jitter buffer,
  * in milliseconds.
@@ -54,6 +54,12 @@
  * audio samples in the buffer are too low or too high. It does this without
  * distorting the audio quality of the audio, by using \a PJMED_WSOLA.
  *
+ * A steady rate mismatch between the producer and the consumer, such as
+ * the clock skew between the capture and playback of a sound device, is
+ * compensated by resampling the output with a slowly adapting ratio (see
+ * #PJMEDIA_DELAY_BUF_MAX_DRIFT), so that WSOLA is only needed for sudden
+ * level changes.
+ *
  * The delay buffer is used in \ref PJMED_SND_PORT, \ref PJMEDIA_SPLITCOMB,
  * and \ref PJMEDIA_CONF.
  */
@@ -76,6 +82,23 @@ typedef enum pjmedia_delay_buf_flag
 
 } pjmedia_delay_buf_flag;
 
+/**
+ * Delay buffer statistics.
+ */
+typedef struct pjmedia_delay_buf_stat
+{
+    unsigned	buf_cnt;	/**< Number of samples in the buffer.	    */
+    unsigned	eff_cnt;	/**< Learnt effective number of samples.    */
+    int		drift;		/**< Estimated clock drift, in ppm, which
+					 is compensated by resampling. A
+					 positive value means the producer is
+					 faster than the consumer.	    */
+    unsigned	shrink_cnt;	/**< Number of times samples were discarded,
+					 by WSOLA or by dropping.	    */
+    unsigned	expand_cnt;	/**< Number of times a frame was generated
+					 on underflow.			    */
+} pjmedia_delay_buf_stat;
+
 /**
  * Create the delay buffer. Once the delay buffer is created, it will
  * enter learning state unless the delay argument is specified, which
@@ -157,6 +180,17 @@ PJ_DECL(pj_status_t) pjmedia_delay_buf_get(pjmedia_delay_buf *b,
  */
 PJ_DECL(pj_status_t) pjmedia_delay_buf_reset(pjmedia_delay_buf *b);
 
+/**
+ * Get the delay buffer statistics.
+ *
+ * @param b		    The delay buffer.
+ * @param stat		    Structure to receive the statistics.
+ *
+ * @return		    PJ_SUCCESS on success or the appropriate error.
+ */
+PJ_DECL(pj_status_t) pjmedia_delay_buf_get_stat(pjmedia_delay_buf *b,
+						pjmedia_delay_buf_stat *stat);
+
 /**
  * Destroy delay buffer.
  *
@@ -0,0 +1,242 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef __PJMEDIA_DSP_H__
+#define __PJMEDIA_DSP_H__
+
+
+/**
+ * @file dsp.h
+ * @brief Shared DSP kernels with runtime CPU dispatch.
+ */
+#include <pjmedia/types.h>
+
+
+/**
+ * @defgroup PJMEDIA_DSP DSP Kernels
+ * @ingroup PJMEDIA_FRAME_OP
+ * @brief Vector kernels shared by the codecs, with SIMD implementations
+ * selected at runtime.
+ * @{
+ *
+ * These kernels implement the inner loops that the bundled codecs
+ * otherwise each carry in scalar form. The implementation is chosen on
+ * first use according to the CPU features present (SSE2, AVX2 or NEON),
+ * falling back to a portable scalar reference.
+ *
+ * Every implementation produces results that are bit-exact with the
+ * scalar reference, including the floating point kernels, so codecs can
+ * use them without changing their output. Integer kernels use 32-bit
+ * wrap-around accumulation. Floating point kernels accumulate each output
+ * in the same order as the scalar loop and only vectorize across
+ * independent outputs. The one exception is ARMv7 NEON, which flushes
+ * subnormal floats to zero.
+ *
+ * Recursive filters such as biquads are not provided: every output
+ * depends on the previous one, so a single channel has nothing to spread
+ * over the vector lanes.
+ */
+
+
+PJ_BEGIN_DECL
+
+
+/**
+ * CPU features that the DSP kernels may use.
+ */
+typedef enum pjmedia_dsp_feature
+{
+    /** x86 SSE2. */
+    PJMEDIA_DSP_SSE2	= 1,
+
+    /** x86 AVX2. */
+    PJMEDIA_DSP_AVX2	= 2,
+
+    /** ARM NEON. */
+    PJMEDIA_DSP_NEON	= 4
+
+} pjmedia_dsp_feature;
+
+
+/**
+ * Get the CPU features that are present and supported by the kernels
+ * compiled in.
+ *
+ * @return		Bitmask of #pjmedia_dsp_feature.
+ */
+PJ_DECL(unsigned) pjmedia_dsp_get_features(void);
+
+
+/**
+ * Restrict the CPU features used by the kernels, e.g. to compare an
+ * implementation with the scalar reference. Features that are not
+ * present are ignored.
+ *
+ * @param features	Bitmask of #pjmedia_dsp_feature to allow, or
+ *			zero to use the scalar reference only.
+ *
+ * @return		Bitmask of the features now in use.
+ */
+PJ_DECL(unsigned) pjmedia_dsp_set_features(unsigned features);
+
+
+/**
+ * Get the name of the implementation in use, e.g. "neon".
+ *
+ * @return		Implementation name.
+ */
+PJ_DECL(const char*) pjmedia_dsp_get_impl_name(void);
+
+
+/**
+ * Compute the inner product of two 16-bit vectors:
+ * sum(x[i] * y[i]), i = 0..len-1, with 32-bit wrap-around accumulation.
+ *
+ * @param x		First vector.
+ * @param y		Second vector.
+ * @param len		Vector length.
+ *
+ * @return		The inner product.
+ */
+PJ_DECL(pj_int32_t) pjmedia_dsp_inner_prod16(const pj_int16_t *x,
+					     const pj_int16_t *y,
+					     unsigned len);
+
+
+/**
+ * Compute the cross-correlation of two 16-bit vectors for a range of
+ * lags: xcorr[k] = sum(x[i] * y[i+k]), i = 0..len-1, k = 0..lag_cnt-1,
+ * with 32-bit wrap-around accumulation.
+ *
+ * @param x		First vector, len samples.
+ * @param y		Second vector, len + lag_cnt - 1 samples.
+ * @param xcorr		Array to receive lag_cnt correlation values.
+ * @param len		Correlation length.
+ * @param lag_cnt	Number of lags.
+ */
+PJ_DECL(void) pjmedia_dsp_xcorr16(const pj_int16_t *x,
+				  const pj_int16_t *y,
+				  pj_int32_t *xcorr,
+				  unsigned len,
+				  unsigned lag_cnt);
+
+
+/**
+ * Compute the autocorrelation of a floating point vector:
+ * ac[k] = sum(x[i] * x[i+k]), i = 0..len-k-1, k = 0..lag_cnt-1, each
+ * accumulated in ascending i order starting from zero.
+ *
+ * @param x		Input vector.
+ * @param ac		Array to receive lag_cnt values.
+ * @param len		Vector length.
+ * @param lag_cnt	Number of lags, must not exceed len.
+ */
+PJ_DECL(void) pjmedia_dsp_autocorr_f(const float *x,
+				     float *ac,
+				     unsigned len,
+				     unsigned lag_cnt);
+
+
+/**
+ * Run a floating point FIR filter over a block:
+ * y[n] = sum(x[n+k] * h[k]), k = 0..tap_cnt-1, n = 0..len-1, each
+ * accumulated in ascending k order starting from zero. The filter
+ * history is the first tap_cnt-1 samples of x, so the coefficients are
+ * given oldest sample first.
+ *
+ * @param x		Input, len + tap_cnt - 1 samples.
+ * @param h		Filter coefficients.
+ * @param y		Array to receive len output samples. It may not
+ *			overlap x.
+ * @param len		Number of output samples.
+ * @param tap_cnt	Number of filter taps.
+ */
+PJ_DECL(void) pjmedia_dsp_fir_f(const float *x,
+				const float *h,
+				float *y,
+				unsigned len,
+				unsigned tap_cnt);
+
+
+/**
+ * Multiply and accumulate blocks of packed real spectra, as used by
+ * frequency domain adaptive filters. Each block holds len values in the
+ * FFTPACK order: the DC bin, (real, imaginary) pairs, then the Nyquist
+ * bin. The complex products of the blocks of x and y are summed into
+ * acc, each bin accumulated in ascending block order starting from zero.
+ *
+ * @param x		First operand, blk_cnt blocks of len values.
+ * @param y		Second operand, blk_cnt blocks of len values.
+ * @param acc		Array to receive len values.
+ * @param len		Block length, must be even.
+ * @param blk_cnt	Number of blocks.
+ */
+PJ_DECL(void) pjmedia_dsp_spectrum_mac_f(const float *x,
+					 const float *y,
+					 float *acc,
+					 unsigned len,
+					 unsigned blk_cnt);
+
+
+/**
+ * Compute an in-place fixed point complex FFT, bit-exact with the
+ * radix-2 FFT of the WebRTC signal processing library. The input must
+ * be in bit reversed order. Each stage scales the result by one half,
+ * and intermediate results are truncated to 16 bits.
+ *
+ * @param frfi		Interleaved (real, imaginary) samples, 2^stages
+ *			of them.
+ * @param stages	Number of radix-2 stages, at most 10.
+ * @param precise	Round the butterflies (WebRTC mode 1) rather than
+ *			truncate them (mode 0).
+ *
+ * @return		Zero, or -1 if stages is too large.
+ */
+PJ_DECL(int) pjmedia_dsp_cfft16(pj_int16_t *frfi,
+				unsigned stages,
+				pj_bool_t precise);
+
+
+/**
+ * Compute an in-place fixed point complex inverse FFT, bit-exact with
+ * the WebRTC signal processing library. Each stage scales the data down
+ * by up to two bits depending on its magnitude.
+ *
+ * @param frfi		Interleaved (real, imaginary) samples, 2^stages
+ *			of them, in bit reversed order.
+ * @param stages	Number of radix-2 stages, at most 10.
+ * @param precise	Round the butterflies (WebRTC mode 1) rather than
+ *			truncate them (mode 0).
+ *
+ * @return		The total right shift applied to the data, or -1
+ *			if stages is too large.
+ */
+PJ_DECL(int) pjmedia_dsp_cifft16(pj_int16_t *frfi,
+				 unsigned stages,
+				 pj_bool_t precise);
+
+
+PJ_END_DECL
+
+/**
+ * @}
+ */
+
+
+#endif	/* __PJMEDIA_DSP_H__ */
@@ -107,7 +107,29 @@ typedef enum pjmedia_echo_flag
      * If PJMEDIA_ECHO_USE_SW_ECHO flag is specified, software echo canceller
      * will be used instead of device EC.
      */
-    PJMEDIA_ECHO_USE_SW_ECHO = 64
+    PJMEDIA_ECHO_USE_SW_ECHO = 64,
+
+    /**
+     * If PJMEDIA_ECHO_USE_NOISE_SUPPRESSOR flag is specified, the echo
+     * canceller will also suppress the noise of the captured signal.
+     * Only the WebRTC backend supports this.
+     */
+    PJMEDIA_ECHO_USE_NOISE_SUPPRESSOR = 128,
+
+    /**
+     * If PJMEDIA_ECHO_USE_GAIN_CONTROLLER flag is specified, the echo
+     * canceller will also normalize the level of the captured signal
+     * with an adaptive digital gain. Only the WebRTC backend supports
+     * this.
+     */
+    PJMEDIA_ECHO_USE_GAIN_CONTROLLER = 256,
+
+    /**
+     * If PJMEDIA_ECHO_USE_HIGH_PASS_FILTER flag is specified, the echo
+     * canceller will remove the DC and low frequency hum of the captured
+     * signal before processing it. Only the WebRTC backend supports this.
+     */
+    PJMEDIA_ECHO_USE_HIGH_PASS_FILTER = 512
 
 } pjmedia_echo_flag;
 
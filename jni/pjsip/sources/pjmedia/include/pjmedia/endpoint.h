@@ -60,6 +60,65 @@ typedef enum pjmedia_endpt_flag
 } pjmedia_endpt_flag;
 
 
+/**
+ * Media endpoint worker threads settings, used with
+ * #pjmedia_endpt_create2().
+ */
+typedef struct pjmedia_endpt_worker_param
+{
+    /**
+     * Number of worker threads polling each ioqueue.
+     *
+     * Default: 1
+     */
+    unsigned	worker_cnt;
+
+    /**
+     * Number of ioqueues. The media transports can be spread over the
+     * ioqueues with #pjmedia_endpt_get_ioqueue_by_key(), e.g. by call,
+     * so that a busy call only delays the calls sharing its ioqueue.
+     * The first ioqueue is the one given to #pjmedia_endpt_create2(),
+     * if any, the others are created by the endpoint.
+     *
+     * Default: 1
+     */
+    unsigned	ioqueue_cnt;
+
+    /**
+     * Run the worker threads with the highest real-time priority the
+     * OS allows (SCHED_FIFO on Linux), so packet processing is not
+     * delayed by other threads of the application. This usually needs
+     * special privilege; the threads keep their priority when raising
+     * it fails.
+     *
+     * Default: PJ_FALSE
+     */
+    pj_bool_t	realtime;
+
+} pjmedia_endpt_worker_param;
+
+
+/**
+ * Load statistics of a media endpoint worker thread.
+ */
+typedef struct pjmedia_endpt_worker_stat
+{
+    /** Index of the ioqueue polled by the thread. */
+    unsigned	ioqueue_idx;
+
+    /** Number of ioqueue events handled by the thread. */
+    pj_uint32_t	event_cnt;
+
+    /** Largest number of events handled in a single poll. */
+    unsigned	max_burst;
+
+    /** CPU time used by the thread, in usec. Zero if the OS doesn't
+     *  support measuring it. */
+    pj_uint64_t	cpu_usec;
+
+} pjmedia_endpt_worker_stat;
+
+
 /**
  * Type of callback to register to pjmedia_endpt_atexit().
  */
@@ -86,6 +145,33 @@ PJ_DECL(pj_status_t) pjmedia_endpt_create( pj_pool_factory *pf,
 					   unsigned worker_cnt,
 					   pjmedia_endpt **p_endpt);
 
+/**
+ * Initialize media endpoint worker settings with default values.
+ *
+ * @param param		The settings to be initialized.
+ */
+PJ_DECL(void) pjmedia_endpt_worker_param_default(
+					pjmedia_endpt_worker_param *param);
+
+/**
+ * Create an instance of media endpoint with a pool of worker threads
+ * dedicated to media, possibly polling more than one ioqueue.
+ *
+ * @param pf		Pool factory, which will be used by the media endpoint
+ *			throughout its lifetime.
+ * @param ioqueue	Optional ioqueue instance to be used as the first
+ *			media ioqueue. If this argument is NULL, the endpoint
+ *			will create an internal ioqueue instance.
+ * @param param		Worker settings, or NULL to use the default.
+ * @param p_endpt	Pointer to receive the endpoint instance.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_endpt_create2(pj_pool_factory *pf,
+					   pj_ioqueue_t *ioqueue,
+				    const pjmedia_endpt_worker_param *param,
+					   pjmedia_endpt **p_endpt);
+
 /**
  * Destroy media endpoint instance.
  *
@@ -131,6 +217,30 @@ PJ_DECL(pj_status_t) pjmedia_endpt_get_flag(pjmedia_endpt *endpt,
 PJ_DECL(pj_ioqueue_t*) pjmedia_endpt_get_ioqueue(pjmedia_endpt *endpt);
 
 
+/**
+ * Get the number of ioqueues of the media endpoint.
+ *
+ * @param endpt		The media endpoint instance.
+ *
+ * @return		The number of ioqueues.
+ */
+PJ_DECL(unsigned) pjmedia_endpt_get_ioqueue_count(pjmedia_endpt *endpt);
+
+
+/**
+ * Get the ioqueue to be used for the media transports identified by
+ * the key. Transports with the same key, e.g. the RTP and RTCP sockets
+ * of all media of a call, are polled by the same worker threads.
+ *
+ * @param endpt		The media endpoint instance.
+ * @param key		Arbitrary key, such as the call index.
+ *
+ * @return		The ioqueue instance.
+ */
+PJ_DECL(pj_ioqueue_t*) pjmedia_endpt_get_ioqueue_by_key(pjmedia_endpt *endpt,
+							unsigned key);
+
+
 /**
  * Get the number of worker threads on the media endpoint
  *
@@ -150,6 +260,20 @@ PJ_DECL(unsigned) pjmedia_endpt_get_thread_count(pjmedia_endpt *endpt);
 PJ_DECL(pj_thread_t*) pjmedia_endpt_get_thread(pjmedia_endpt *endpt, 
 					       unsigned index);
 
+/**
+ * Get the load statistics of one of the worker threads of the media
+ * endpoint.
+ *
+ * @param endpt		The media endpoint instance.
+ * @param index		The index of the thread: 0<= index < thread_cnt
+ * @param stat		Structure to receive the statistics.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_endpt_get_worker_stat(pjmedia_endpt *endpt,
+					unsigned index,
+					pjmedia_endpt_worker_stat *stat);
+
 
 /**
  * Request the media endpoint to create pool.
@@ -82,7 +82,12 @@ typedef enum pjmedia_event_type
     /**
      * Video orientation has been changed event.
      */
-    PJMEDIA_EVENT_ORIENT_CHANGED = PJMEDIA_FOURCC('O', 'R', 'N', 'T')
+    PJMEDIA_EVENT_ORIENT_CHANGED = PJMEDIA_FOURCC('O', 'R', 'N', 'T'),
+
+    /**
+     * Audio stream packet duration has been changed event.
+     */
+    PJMEDIA_EVENT_PTIME_CHANGED = PJMEDIA_FOURCC('P', 'T', 'C', 'H')
 
 } pjmedia_event_type;
 
@@ -129,6 +134,16 @@ typedef struct pjmedia_event_wnd_closing_data
     pj_bool_t		cancel;
 } pjmedia_event_wnd_closing_data;
 
+/**
+ * Additional data/parameters for packet duration changed event
+ * (PJMEDIA_EVENT_PTIME_CHANGED).
+ */
+typedef struct pjmedia_event_ptime_changed_data
+{
+    /** The new duration of outgoing packets, in msec. */
+    unsigned		ptime;
+} pjmedia_event_ptime_changed_data;
+
 /** Additional parameters for window changed event. */
 typedef pjmedia_event_dummy_data pjmedia_event_wnd_closed_data;
 
@@ -211,6 +226,9 @@ typedef struct pjmedia_event
 	/** Keyframe missing event data */
 	pjmedia_event_keyframe_missing_data	keyframe_missing;
 
+	/** Packet duration changed event data */
+	pjmedia_event_ptime_changed_data	ptime_changed;
+
 	/** Storage for user event data */
 	pjmedia_event_user_data			user;
 
@@ -371,6 +389,15 @@ pjmedia_event_unsubscribe(pjmedia_event_mgr *mgr,
  * to the event manager and return immediately. It is the event manager
  * that will later notify all the publisher's subscribers.
  *
+ * Posted events are never dropped. If a pending posted event of an
+ * idempotent type (format changed, window resized, keyframe found or
+ * missing, orientation changed) from the same source is still waiting to
+ * be delivered, it is replaced by the new one. If the event manager has
+ * no worker thread, posted events are delivered immediately.
+ *
+ * Subscribers of the specific publisher are notified before subscribers
+ * of all publishers.
+ *
  * @param mgr		The event manager.
  * @param epub		The event publisher.
  * @param event		The event to be published.
@@ -176,6 +176,21 @@ typedef enum pjmedia_format_id
      */
     PJMEDIA_FORMAT_YV12	    = PJMEDIA_FORMAT_PACK('Y', 'V', '1', '2'),
 
+    /**
+     * This is semi-planar 4:2:0/12bpp YUV format, the data can be treated
+     * as two planes of color components, where the first plane contains
+     * only the Y samples and the second plane contains interleaved
+     * U (Cb) - V (Cr) samples.
+     */
+    PJMEDIA_FORMAT_NV12	    = PJMEDIA_FORMAT_PACK('N', 'V', '1', '2'),
+
+    /**
+     * This is semi-planar 4:2:0/12bpp YUV format, similar to NV12 but the
+     * second plane contains interleaved V (Cr) - U (Cb) samples. This is
+     * the default preview format of Android cameras.
+     */
+    PJMEDIA_FORMAT_NV21	    = PJMEDIA_FORMAT_PACK('N', 'V', '2', '1'),
+
     /**
      * This is planar 4:2:2/16bpp YUV format, the data can be treated as
      * three planes of color components, where the first plane contains
@@ -127,6 +127,42 @@ struct pjmedia_rtp_ext_hdr
 typedef struct pjmedia_rtp_ext_hdr pjmedia_rtp_ext_hdr;
 
 
+/**
+ * Profile value of the RTP extension header for the one-byte header
+ * extension format (RFC 5285).
+ */
+#define PJMEDIA_RTP_EXT_ONE_BYTE	0xBEDE
+
+/**
+ * Profile value of the RTP extension header for the two-byte header
+ * extension format (RFC 5285). The lowest four bits are application
+ * specific ("appbits") and are ignored when matching.
+ */
+#define PJMEDIA_RTP_EXT_TWO_BYTE	0x1000
+
+/**
+ * Maximum number of elements that can be decoded from, or encoded into,
+ * a single RTP header extension.
+ */
+#define PJMEDIA_RTP_EXT_MAX_ELEM	16
+
+/**
+ * URI of the client-to-mixer audio level header extension (RFC 6464).
+ */
+#define PJMEDIA_RTP_EXT_AUDIO_LEVEL_URI \
+	    "urn:ietf:params:rtp-hdrext:ssrc-audio-level"
+
+/**
+ * This describes one element of an RFC 5285 RTP header extension.
+ */
+typedef struct pjmedia_rtp_ext_elem
+{
+    pj_uint8_t	     id;	/**< Extension element ID.		    */
+    pj_uint8_t	     len;	/**< Length of the data, in bytes.	    */
+    const pj_uint8_t *data;	/**< The element data.			    */
+} pjmedia_rtp_ext_elem;
+
+
 #pragma pack(1)
 
 /**
@@ -357,6 +393,51 @@ PJ_DECL(void) pjmedia_rtp_session_update2(pjmedia_rtp_session *ses,
 					  pj_bool_t check_pt);
 
 
+/**
+ * Decode the elements of an RFC 5285 header extension (either the one-byte
+ * or the two-byte format) in an incoming RTP packet. Padding bytes are
+ * skipped. The returned element data point into the packet itself.
+ *
+ * @param pkt	    The received RTP packet, as given to
+ *		    #pjmedia_rtp_decode_rtp().
+ * @param pkt_len   The length of the packet.
+ * @param elem	    Array to receive the extension elements.
+ * @param count	    On input, the number of elements in the array. On
+ *		    output, the number of elements found. This is zero
+ *		    when the packet has no header extension.
+ *
+ * @return	    PJ_SUCCESS if the extension (if any) was decoded,
+ *		    PJ_ENOTSUP if the packet carries a header extension
+ *		    of a profile other than RFC 5285, or
+ *		    PJMEDIA_RTP_EINLEN if the extension is malformed.
+ */
+PJ_DECL(pj_status_t) pjmedia_rtp_decode_ext(const void *pkt, int pkt_len,
+					    pjmedia_rtp_ext_elem elem[],
+					    unsigned *count);
+
+/**
+ * Encode RTP header extension elements into an RFC 5285 header extension
+ * block, including the four bytes extension header and the padding
+ * needed to make it a multiple of 32 bits. The compact one-byte format is
+ * used whenever all the elements fit in it, otherwise the two-byte format
+ * is used. Application places the result right after the RTP header (and
+ * CSRC list) and sets the \a x bit of the RTP header.
+ *
+ * @param elem	    The extension elements.
+ * @param count	    Number of elements.
+ * @param buf	    Buffer to receive the extension block.
+ * @param buf_size  Size of the buffer.
+ * @param len	    On return, the length of the extension block.
+ *
+ * @return	    PJ_SUCCESS on success, or PJ_ETOOSMALL if the buffer
+ *		    is too small.
+ */
+PJ_DECL(pj_status_t) pjmedia_rtp_encode_ext(const pjmedia_rtp_ext_elem elem[],
+					    unsigned count,
+					    void *buf, unsigned buf_size,
+					    unsigned *len);
+
+
 /*
  * INTERNAL:
  */
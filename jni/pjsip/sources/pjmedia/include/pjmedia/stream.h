@@ -138,6 +138,44 @@ typedef struct pjmedia_stream_info
     pj_bool_t           rtcp_sdes_bye_disabled; 
                                     /**< Disable automatic sending of RTCP
                                          SDES and BYE.                      */
+    int			tx_audio_level_id;
+				    /**< RTP header extension ID to stamp the
+					 RFC 6464 audio level on outgoing
+					 packets, as advertised by remote,
+					 or zero if not used.		    */
+    int			rx_audio_level_id;
+				    /**< RTP header extension ID of the
+					 RFC 6464 audio level in incoming
+					 packets, as advertised locally, or
+					 zero if not used.		    */
+    unsigned		audio_level_skip;
+				    /**< When non-zero, incoming frames whose
+					 received audio level is at or below
+					 -audio_level_skip dBov are not
+					 decoded, and get_frame() returns
+					 PJMEDIA_FRAME_TYPE_NONE for them so
+					 that the conference bridge does not
+					 mix them either. This requires the
+					 remote to send RFC 6464 levels. Only
+					 frames of stateless codecs (G.711
+					 and L16) are skipped, the frames of
+					 other codecs are always decoded so
+					 that the decoder state stays in sync.
+					 Zero (the default) disables this.  */
+    unsigned		adaptive_max_ptime;
+				    /**< When non-zero, the stream makes its
+					 outgoing packets longer, up to this
+					 duration in msec, while the RTCP
+					 reports of remote show loss or long
+					 round trip time, to cut the per
+					 packet overhead. The packets go back
+					 to the negotiated duration when the
+					 congestion is over. Changes are
+					 published as
+					 PJMEDIA_EVENT_PTIME_CHANGED event.
+					 The duration never exceeds
+					 \a tx_maxptime when it's set. Zero
+					 (the default) disables this.	    */
 } pjmedia_stream_info;
 
 
@@ -287,6 +325,23 @@ PJ_DECL(pj_status_t) pjmedia_stream_get_stat( const pjmedia_stream *stream,
 PJ_DECL(pj_status_t) pjmedia_stream_reset_stat(pjmedia_stream *stream);
 
 
+/**
+ * Get the audio level of the last frame received from the remote, as
+ * reported by the remote in the RFC 6464 audio level RTP header extension.
+ * This does not require the frame to be decoded, so it is suitable for
+ * active speaker detection in large conferences.
+ *
+ * @param stream	The media stream.
+ * @param level		On return, the level in -dBov, i.e. from zero for
+ *			the loudest to 127 for silence.
+ *
+ * @return		PJ_SUCCESS on success, or PJ_ENOTFOUND if the
+ *			remote has not sent any audio level.
+ */
+PJ_DECL(pj_status_t) pjmedia_stream_get_rx_audio_level(
+					    const pjmedia_stream *stream,
+					    unsigned *level);
+
 #if defined(PJMEDIA_HAS_RTCP_XR) && (PJMEDIA_HAS_RTCP_XR != 0)
 /**
  * Get the stream extended report statistics (RTCP XR).
@@ -335,6 +390,33 @@ PJ_DECL(pj_status_t) pjmedia_stream_pause( pjmedia_stream *stream,
 PJ_DECL(pj_status_t) pjmedia_stream_resume(pjmedia_stream *stream,
 					   pjmedia_dir dir);
 
+/**
+ * Apply new stream info, e.g: the result of an SDP re-negotiation, to a
+ * running stream without recreating it, so that its port (and hence its
+ * slot in the conference bridge), RTP session and jitter buffer state
+ * are kept.
+ *
+ * The direction, remote RTP/RTCP addresses, payload types and RTP header
+ * extensions can always be changed. The codec and its packetization
+ * (ptime) can be changed as long as the stream port format stays the
+ * same, i.e: the new codec has the same clock rate and channel count, and
+ * the port frame is a multiple of the new codec frame. In that case the
+ * jitter buffer is reset, or recreated with the jitter buffer settings
+ * of the new info when the new codec frames don't fit in it. The RTP
+ * SSRC, sequence and timestamp of the stream are kept.
+ *
+ * When the new info cannot be applied, the stream is left unchanged and
+ * the function returns PJ_ENOTSUP, in which case the application should
+ * destroy the stream and create a new one.
+ *
+ * @param stream	The media stream.
+ * @param info		The new stream info.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_stream_update(pjmedia_stream *stream,
+					   const pjmedia_stream_info *info);
+
 /**
  * Transmit DTMF to this stream. The DTMF will be transmitted uisng
  * RTP telephone-events as described in RFC 2833. This operation is
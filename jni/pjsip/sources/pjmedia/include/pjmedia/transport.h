@@ -252,7 +252,17 @@ typedef enum pjmedia_tranport_media_option
      * transport SRTP, media transport validation only need to be done by 
      * transport SRTP.
      */
-    PJMEDIA_TPMED_NO_TRANSPORT_CHECKING = 1
+    PJMEDIA_TPMED_NO_TRANSPORT_CHECKING = 1,
+
+    /**
+     * When this flag is specified, the transport will offer RTCP
+     * multiplexing with "a=rtcp-mux" attribute (RFC 5761), or accept it
+     * when it is offered by remote. When both sides agree, RTCP is sent
+     * and received on the RTP port and the transport tells the packets
+     * apart by their payload type. Otherwise the transport falls back to
+     * using a separate RTCP port.
+     */
+    PJMEDIA_TPMED_RTCP_MUX = 2
 
 } pjmedia_tranport_media_option;
 
@@ -433,6 +443,36 @@ struct pjmedia_transport_op
      * calling this function directly.
      */
     pj_status_t (*destroy)(pjmedia_transport *tp);
+
+    /**
+     * This function is called by the stream to send RTP packet from a
+     * writable buffer, which has \a tailroom bytes of free space after
+     * the packet. The transport may transform the packet in place and
+     * expand it into the tailroom (e.g: to append SRTP authentication
+     * tag), so the content of the buffer is undefined after this call.
+     * This member is optional and may be NULL.
+     *
+     * Application should call #pjmedia_transport_send_rtp_inplace()
+     * instead of calling this function directly.
+     */
+    pj_status_t (*send_rtp_inplace)(pjmedia_transport *tp,
+				    void *pkt,
+				    pj_size_t size,
+				    pj_size_t tailroom);
+
+    /**
+     * This function is called by the stream to send RTCP packet from a
+     * writable buffer, which has \a tailroom bytes of free space after
+     * the packet. See \a send_rtp_inplace for the details. This member is
+     * optional and may be NULL.
+     *
+     * Application should call #pjmedia_transport_send_rtcp_inplace()
+     * instead of calling this function directly.
+     */
+    pj_status_t (*send_rtcp_inplace)(pjmedia_transport *tp,
+				     void *pkt,
+				     pj_size_t size,
+				     pj_size_t tailroom);
 };
 
 
@@ -460,6 +500,12 @@ typedef enum pjmedia_transport_type
      */
     PJMEDIA_TRANSPORT_TYPE_SRTP,
 
+    /**
+     * Member of a BUNDLE group, sharing the transport of another media
+     * line. See \ref PJMEDIA_TRANSPORT_BUNDLE.
+     */
+    PJMEDIA_TRANSPORT_TYPE_BUNDLE,
+
     /**
      * Start of user defined transport.
      */
@@ -677,6 +723,57 @@ PJ_INLINE(pj_status_t) pjmedia_transport_send_rtcp(pjmedia_transport *tp,
 }
 
 
+/**
+ * Send RTP packet from a writable buffer with the specified media transport.
+ * The transport may protect the packet in place, using up to \a tailroom
+ * bytes after the packet, instead of copying it to its own buffer. If the
+ * transport does not implement <tt>send_rtp_inplace()</tt>, this falls back
+ * to <tt>send_rtp()</tt>.
+ *
+ * The content of the buffer is undefined after this function returns.
+ *
+ * @param tp	    The media transport.
+ * @param pkt	    The packet to send.
+ * @param size	    Size of the packet.
+ * @param tailroom  Size of the free space after the packet in the buffer.
+ *
+ * @return	    PJ_SUCCESS on success, or the appropriate error code.
+ */
+PJ_INLINE(pj_status_t) pjmedia_transport_send_rtp_inplace(
+					    pjmedia_transport *tp,
+					    void *pkt,
+					    pj_size_t size,
+					    pj_size_t tailroom)
+{
+    if (tp->op->send_rtp_inplace)
+	return (*tp->op->send_rtp_inplace)(tp, pkt, size, tailroom);
+    return (*tp->op->send_rtp)(tp, pkt, size);
+}
+
+
+/**
+ * Send RTCP packet from a writable buffer with the specified media
+ * transport. See #pjmedia_transport_send_rtp_inplace() for the details.
+ *
+ * @param tp	    The media transport.
+ * @param pkt	    The packet to send.
+ * @param size	    Size of the packet.
+ * @param tailroom  Size of the free space after the packet in the buffer.
+ *
+ * @return	    PJ_SUCCESS on success, or the appropriate error code.
+ */
+PJ_INLINE(pj_status_t) pjmedia_transport_send_rtcp_inplace(
+					    pjmedia_transport *tp,
+					    void *pkt,
+					    pj_size_t size,
+					    pj_size_t tailroom)
+{
+    if (tp->op->send_rtcp_inplace)
+	return (*tp->op->send_rtcp_inplace)(tp, pkt, size, tailroom);
+    return (*tp->op->send_rtcp)(tp, pkt, size);
+}
+
+
 /**
  * Send RTCP packet with the specified media transport. This is just a simple
  * wrapper which calls <tt>send_rtcp2()</tt> member of the transport. The 
@@ -0,0 +1,116 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef __PJMEDIA_TRANSPORT_BUNDLE_H__
+#define __PJMEDIA_TRANSPORT_BUNDLE_H__
+
+
+/**
+ * @file transport_bundle.h
+ * @brief BUNDLE media transport
+ */
+
+#include <pjmedia/transport.h>
+
+
+/**
+ * @defgroup PJMEDIA_TRANSPORT_BUNDLE BUNDLE Media Transport
+ * @ingroup PJMEDIA_TRANSPORT
+ * @brief Share one media transport between several media lines.
+ * @{
+ *
+ * This transport lets the media lines of a BUNDLE group (SDP
+ * "a=group:BUNDLE") send and receive over the transport of a single
+ * media line, the "tagged" media line. Each media line gets its own
+ * member transport, which is used by its stream like any other media
+ * transport.
+ *
+ * Incoming RTP packets are delivered to the member whose stream has
+ * sent packets with the same SSRC before. Packets with an unknown SSRC
+ * are delivered to the member whose media line lists the payload type
+ * in the local or remote SDP, preferring the members that have not
+ * received any stream yet, and the SSRC is then remembered for that
+ * member. RTCP packets are delivered by the SSRC of the sender, or by
+ * the SSRC of the first report block when the sender is unknown, and
+ * to the tagged member otherwise.
+ *
+ * Only the tagged member passes the SDP operations (media_create(),
+ * encode_sdp(), media_start() and media_stop()) to the shared transport,
+ * so ICE and RTCP multiplexing are negotiated on the tagged media line
+ * only. The other members only learn the payload types of their media
+ * line from the SDP. The shared transport is destroyed when the last
+ * member is closed.
+ *
+ * Application is responsible for the BUNDLE negotiation itself, i.e.
+ * adding "a=mid" and "a=group:BUNDLE" to the SDP and deciding which
+ * media lines are bundled.
+ */
+
+PJ_BEGIN_DECL
+
+
+/**
+ * Create a BUNDLE group on top of the transport of the tagged media line.
+ * The returned member transport is to be used by the tagged media line,
+ * and it takes over the base transport: the base transport must not be
+ * used directly anymore, and it will be closed when the last member of
+ * the group is closed.
+ *
+ * @param endpt		The media endpoint.
+ * @param name		Optional name to identify this media transport
+ *			for logging purposes.
+ * @param base_tp	The transport to be shared by the group. It must not
+ *			be attached to any stream.
+ * @param p_tp		Pointer to receive the member transport of the
+ *			tagged media line.
+ *
+ * @return		PJ_SUCCESS on success, or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pjmedia_transport_bundle_create(pjmedia_endpt *endpt,
+						     const char *name,
+						     pjmedia_transport *base_tp,
+						     pjmedia_transport **p_tp);
+
+
+/**
+ * Add another media line to the BUNDLE group.
+ *
+ * @param tp		Any member transport of the group.
+ * @param name		Optional name to identify this media transport
+ *			for logging purposes.
+ * @param p_tp		Pointer to receive the new member transport.
+ *
+ * @return		PJ_SUCCESS on success, or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pjmedia_transport_bundle_add_member(
+						pjmedia_transport *tp,
+						const char *name,
+						pjmedia_transport **p_tp);
+
+
+PJ_END_DECL
+
+
+/**
+ * @}
+ */
+
+
+#endif	/* __PJMEDIA_TRANSPORT_BUNDLE_H__ */
+
+
@@ -49,6 +49,51 @@
 PJ_BEGIN_DECL
 
 
+/**
+ * Settings to be given when creating loopback media transport. Application
+ * should call #pjmedia_loop_tp_setting_default() to initialize this
+ * structure with its default values.
+ */
+typedef struct pjmedia_loop_tp_setting
+{
+    /**
+     * Address family, which would be pj_AF_INET() for IPv4, or
+     * pj_AF_INET6() for IPv6.
+     *
+     * Default: pj_AF_INET().
+     */
+    int		af;
+
+    /**
+     * Address to be advertised as the local address of the transport in
+     * #pjmedia_transport_get_info(). Streams and SDP built from a transport
+     * with a zero address are treated as inactive, so application that
+     * wants to run full offer/answer over this transport (for example
+     * with pjsua-lib) should set this to a non-zero address.
+     *
+     * Default: empty (the transport reports a zero address).
+     */
+    pj_str_t	addr;
+
+    /**
+     * RTP port to be advertised as the local port of the transport. The
+     * RTCP port will be this port plus one.
+     *
+     * Default: 0.
+     */
+    int		port;
+
+} pjmedia_loop_tp_setting;
+
+
+/**
+ * Initialize loopback media transport setting with its default values.
+ *
+ * @param opt	    The setting to be initialized.
+ */
+PJ_DECL(void) pjmedia_loop_tp_setting_default(pjmedia_loop_tp_setting *opt);
+
+
 /**
  * Create the loopback transport.
  *
@@ -61,6 +106,22 @@ PJ_DECL(pj_status_t) pjmedia_transport_loop_create(pjmedia_endpt *endpt,
 						   pjmedia_transport **p_tp);
 
 
+/**
+ * Create the loopback transport with the specified settings.
+ *
+ * @param endpt	    The media endpoint instance.
+ * @param opt	    The loopback transport settings, or NULL to use the
+ *		    default settings.
+ * @param p_tp	    Pointer to receive the transport instance.
+ *
+ * @return	    PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_transport_loop_create2(
+				    pjmedia_endpt *endpt,
+				    const pjmedia_loop_tp_setting *opt,
+				    pjmedia_transport **p_tp);
+
+
 /**
  * Set this stream as the receiver of incoming packets.
  */
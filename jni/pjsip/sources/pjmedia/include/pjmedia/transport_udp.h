@@ -149,6 +149,29 @@ PJ_DECL(pj_status_t) pjmedia_transport_udp_attach(pjmedia_endpt *endpt,
 						  pjmedia_transport **p_tp);
 
 
+/**
+ * Create UDP stream transport from existing sockets, and poll the sockets
+ * with the specified ioqueue instead of the default ioqueue of the media
+ * endpoint. See #pjmedia_endpt_get_ioqueue_by_key().
+ *
+ * @param endpt	    The media endpoint instance.
+ * @param name	    Optional name to be assigned to the transport.
+ * @param si	    Media socket info containing the RTP and RTCP sockets.
+ * @param options   Options, bitmask of #pjmedia_transport_udp_options.
+ * @param ioqueue   The ioqueue, or NULL to use the default ioqueue of
+ *		    the media endpoint.
+ * @param p_tp	    Pointer to receive the transport instance.
+ *
+ * @return	    PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjmedia_transport_udp_attach2(pjmedia_endpt *endpt,
+						   const char *name,
+						   const pjmedia_sock_info *si,
+						   unsigned options,
+						   pj_ioqueue_t *ioqueue,
+						   pjmedia_transport **p_tp);
+
+
 PJ_END_DECL
 
 
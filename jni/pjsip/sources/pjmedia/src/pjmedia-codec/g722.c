@@ -97,6 +97,11 @@ static pj_status_t  g722_codec_recover(pjmedia_codec *codec,
 				      unsigned output_buf_len,
 				      struct pjmedia_frame *output);
 #endif
+static pj_status_t  g722_codec_decode_frames(pjmedia_codec *codec,
+					     unsigned frame_cnt,
+					     const struct pjmedia_frame input[],
+					     unsigned output_buf_len,
+					     struct pjmedia_frame *output);
 
 /* Definition for G722 codec operations. */
 static pjmedia_codec_op g722_op = 
@@ -109,10 +114,11 @@ static pjmedia_codec_op g722_op =
     &g722_codec_encode,
     &g722_codec_decode,
 #if !PLC_DISABLED
-    &g722_codec_recover
+    &g722_codec_recover,
 #else
-    NULL
+    NULL,
 #endif
+    &g722_codec_decode_frames
 };
 
 /* Definition for G722 codec factory operations. */
@@ -685,6 +691,84 @@ static pj_status_t g722_codec_decode(pjmedia_codec *codec,
     return PJ_SUCCESS;
 }
 
+/*
+ * Decode several frames.
+ */
+static pj_status_t g722_codec_decode_frames(pjmedia_codec *codec,
+					    unsigned frame_cnt,
+					    const struct pjmedia_frame input[],
+					    unsigned output_buf_len,
+					    struct pjmedia_frame *output)
+{
+    struct g722_data *g722_data = (struct g722_data*) codec->codec_data;
+    pj_int16_t *out = (pj_int16_t*) output->buf;
+    pj_size_t cnt;
+    unsigned i;
+    pj_status_t status;
+
+    pj_assert(g722_data != NULL);
+    PJ_ASSERT_RETURN(input && output, PJ_EINVAL);
+
+    if (output_buf_len < frame_cnt * SAMPLES_PER_FRAME * 2)
+	return PJMEDIA_CODEC_EPCMTOOSHORT;
+
+    /* The ADPCM state runs from frame to frame, so decode them in turn */
+    for (i=0; i<frame_cnt; ++i) {
+	if (input[i].size != FRAME_LEN)
+	    return PJMEDIA_CODEC_EFRMTOOSHORT;
+
+	cnt = SAMPLES_PER_FRAME;
+	status = g722_dec_decode(&g722_data->decoder, input[i].buf,
+				 input[i].size, out + i * SAMPLES_PER_FRAME,
+				 &cnt);
+	if (status != PJ_SUCCESS) {
+	    TRACE_((THIS_FILE, "G722 decode() status: %d", status));
+	    return PJMEDIA_CODEC_EFAILED;
+	}
+	pj_assert(cnt == SAMPLES_PER_FRAME);
+    }
+
+    /* Adjust the signal level from 14-bit to 16-bit over all frames at
+     * once. Only when a sample would clip does this fall back to the
+     * sample by sample loop of g722_codec_decode(), which stops there.
+     */
+    if (g722_data->pcm_shift) {
+	pj_int16_t *p = out, *end = out + frame_cnt * SAMPLES_PER_FRAME;
+	pj_int16_t clip = 0;
+
+#if PJMEDIA_G722_STOP_PCM_SHIFT_ON_CLIPPING
+	for (p=out; p<end; ++p)
+	    clip |= *p;
+	clip &= g722_data->pcm_clip_mask;
+#endif
+	if (!clip) {
+	    for (p=out; p<end; ++p)
+		*p <<= g722_data->pcm_shift;
+	} else {
+	    for (p=out; p<end; ++p) {
+		if (*p & g722_data->pcm_clip_mask) {
+		    g722_data->pcm_shift = 0;
+		    break;
+		}
+		*p <<= g722_data->pcm_shift;
+	    }
+	}
+    }
+
+#if !PLC_DISABLED
+    if (g722_data->plc_enabled) {
+	for (i=0; i<frame_cnt; ++i)
+	    pjmedia_plc_save(g722_data->plc, out + i * SAMPLES_PER_FRAME);
+    }
+#endif
+
+    output->size = frame_cnt * SAMPLES_PER_FRAME * 2;
+    output->type = PJMEDIA_FRAME_TYPE_AUDIO;
+    output->timestamp = input[0].timestamp;
+
+    return PJ_SUCCESS;
+}
+
 
 #if !PLC_DISABLED
 /*
@@ -87,6 +87,11 @@ static pj_status_t  l16_recover(pjmedia_codec *codec,
 				unsigned output_buf_len,
 				struct pjmedia_frame *output);
 #endif
+static pj_status_t  l16_decode_frames(pjmedia_codec *codec,
+				      unsigned frame_cnt,
+				      const struct pjmedia_frame input[],
+				      unsigned output_buf_len,
+				      struct pjmedia_frame *output);
 
 /* Definition for L16 codec operations. */
 static pjmedia_codec_op l16_op = 
@@ -99,10 +104,11 @@ static pjmedia_codec_op l16_op =
     &l16_encode,
     &l16_decode,
 #if !PLC_DISABLED
-    &l16_recover
+    &l16_recover,
 #else
-    NULL
+    NULL,
 #endif
+    &l16_decode_frames
 };
 
 /* Definition for L16 codec factory operations. */
@@ -602,6 +608,26 @@ static pj_status_t  l16_parse( pjmedia_codec *codec,
     return PJ_SUCCESS;
 }
 
+/*
+ * Convert the samples between host and network byte order. This is
+ * written out rather than using pj_htons(), which is a function call on
+ * most platforms, so that the compiler can vectorize the loop.
+ */
+static void l16_swap_samples(pj_int16_t *dst, const pj_int16_t *src,
+			     unsigned count)
+{
+#if defined(PJ_IS_LITTLE_ENDIAN) && PJ_IS_LITTLE_ENDIAN!=0
+    unsigned i;
+
+    for (i=0; i<count; ++i) {
+	pj_uint16_t s = (pj_uint16_t)src[i];
+	dst[i] = (pj_int16_t)((s << 8) | (s >> 8));
+    }
+#else
+    pjmedia_copy_samples(dst, src, count);
+#endif
+}
+
 static pj_status_t l16_encode(pjmedia_codec *codec, 
 			      const struct pjmedia_frame *input,
 			      unsigned output_buf_len, 
@@ -609,7 +635,6 @@ static pj_status_t l16_encode(pjmedia_codec *codec,
 {
     struct l16_data *data = (struct l16_data*) codec->codec_data;
     const pj_int16_t *samp = (const pj_int16_t*) input->buf;
-    const pj_int16_t *samp_end = samp + input->size/sizeof(pj_int16_t);
     pj_int16_t *samp_out = (pj_int16_t*) output->buf;    
 
     pj_assert(data && input && output);
@@ -646,12 +671,7 @@ static pj_status_t l16_encode(pjmedia_codec *codec,
     }
 
     /* Encode */
-#if defined(PJ_IS_LITTLE_ENDIAN) && PJ_IS_LITTLE_ENDIAN!=0
-    while (samp!=samp_end)
-	*samp_out++ = pj_htons(*samp++);
-#else
-    pjmedia_copy_samples(samp_out, samp, input->size >> 1);
-#endif
+    l16_swap_samples(samp_out, samp, input->size >> 1);
 
 
     /* Done */
@@ -669,7 +689,6 @@ static pj_status_t l16_decode(pjmedia_codec *codec,
 {
     struct l16_data *l16_data = (struct l16_data*) codec->codec_data;
     const pj_int16_t *samp = (const pj_int16_t*) input->buf;
-    const pj_int16_t *samp_end = samp + input->size/sizeof(pj_int16_t);
     pj_int16_t *samp_out = (pj_int16_t*) output->buf;    
 
     pj_assert(l16_data != NULL);
@@ -682,12 +701,7 @@ static pj_status_t l16_decode(pjmedia_codec *codec,
 
 
     /* Decode */
-#if defined(PJ_IS_LITTLE_ENDIAN) && PJ_IS_LITTLE_ENDIAN!=0
-    while (samp!=samp_end)
-	*samp_out++ = pj_htons(*samp++);
-#else
-    pjmedia_copy_samples(samp_out, samp, input->size >> 1);
-#endif
+    l16_swap_samples(samp_out, samp, input->size >> 1);
 
 
     output->type = PJMEDIA_FRAME_TYPE_AUDIO;
@@ -702,6 +716,48 @@ static pj_status_t l16_decode(pjmedia_codec *codec,
     return PJ_SUCCESS;
 }
 
+/*
+ * Decode several frames.
+ */
+static pj_status_t l16_decode_frames(pjmedia_codec *codec,
+				     unsigned frame_cnt,
+				     const struct pjmedia_frame input[],
+				     unsigned output_buf_len,
+				     struct pjmedia_frame *output)
+{
+    struct l16_data *l16_data = (struct l16_data*) codec->codec_data;
+    pj_int16_t *samp_out = (pj_int16_t*) output->buf;
+    unsigned i, total = 0;
+
+    pj_assert(l16_data != NULL);
+    PJ_ASSERT_RETURN(input && output, PJ_EINVAL);
+
+    for (i=0; i<frame_cnt; ++i)
+	total += input[i].size;
+
+    /* Check output buffer length */
+    if (output_buf_len < total)
+	return PJMEDIA_CODEC_EPCMTOOSHORT;
+
+    /* Decode */
+    for (i=0; i<frame_cnt; ++i) {
+	l16_swap_samples(samp_out, (const pj_int16_t*)input[i].buf,
+			 input[i].size >> 1);
+
+#if !PLC_DISABLED
+	if (l16_data->plc_enabled)
+	    pjmedia_plc_save(l16_data->plc, samp_out);
+#endif
+	samp_out += input[i].size >> 1;
+    }
+
+    output->type = PJMEDIA_FRAME_TYPE_AUDIO;
+    output->size = total;
+    output->timestamp = input[0].timestamp;
+
+    return PJ_SUCCESS;
+}
+
 #if !PLC_DISABLED
 /*
  * Recover lost frame.
@@ -79,6 +79,10 @@ static struct cbar_fmt_info cbar_fmts[] =
     { PJMEDIA_FORMAT_I422 },
     { PJMEDIA_FORMAT_I420JPEG },
     { PJMEDIA_FORMAT_I422JPEG },
+
+    /* Semi-planar formats */
+    { PJMEDIA_FORMAT_NV12 },
+    { PJMEDIA_FORMAT_NV21 },
 };
 
 /* Video stream. */
@@ -370,6 +374,32 @@ static void fill_first_line(pj_uint8_t *first_lines[],
                     *p++ = c;
             }
         }
+
+    } else if (vfi->plane_cnt == 2) {
+        /* Semi-planar, the second plane carries interleaved chroma */
+        unsigned cb = 1, cr = 2;
+
+        if (vfi->id == PJMEDIA_FORMAT_NV21) {
+            cb = 2; cr = 1;
+        }
+
+        for (i = 0; i < 8; ++i) {
+            /* iterate bars */
+            pj_uint8_t *p;
+            unsigned bar_width;
+
+            bar_width = (vafp->strides[0]/8) & ~1;
+
+            p = first_lines[0] + bar_width*i;
+            for (k = 0; k < bar_width; ++k)
+                *p++ = yuv_colors[i][0];
+
+            p = first_lines[1] + bar_width*i;
+            for (k = 0; k < bar_width; k += 2) {
+                *p++ = yuv_colors[i][cb];
+                *p++ = yuv_colors[i][cr];
+            }
+        }
     }
 }
 
@@ -551,10 +581,11 @@ static pj_status_t spectrum_run(struct cbar_stream *d, pj_uint8_t *p,
         } else {
             pj_size_t offset_p = 0;
 
-            for (i = 0; i < 3; ++i) {
+            for (i = 0; i < d->vfi->plane_cnt; ++i) {
                 pj_uint8_t *ptr, c;
                 unsigned j;
                 pj_size_t dot_size = DOT_SIZE;
+                pj_size_t dot_rows;
 
                 if (d->vfi->color_model == PJMEDIA_COLOR_MODEL_RGB)
                     c = dot_clr_rgb[i];
@@ -562,9 +593,15 @@ static pj_status_t spectrum_run(struct cbar_stream *d, pj_uint8_t *p,
                     c = dot_clr_yuv[i];
 
                 dot_size /= (d->vafp.size.w / d->vafp.strides[i]);
-                ptr = p + offset_p + d->vafp.strides[i]*(dot_size+1) - 
+                dot_rows = dot_size;
+
+                /* Interleaved chroma plane has half the rows */
+                if (d->vfi->plane_cnt == 2 && i > 0)
+                    dot_rows >>= 1;
+
+                ptr = p + offset_p + d->vafp.strides[i]*(dot_rows+1) - 
                       2*dot_size;
-                for (j = 0; j < dot_size; ++j) {
+                for (j = 0; j < dot_rows; ++j) {
                     pj_memset(ptr, c, dot_size);
                     ptr += d->vafp.strides[i];
                 }
@@ -21,11 +21,17 @@
 #include <pjmedia/errno.h>
 #include <pj/assert.h>
 #include <pj/lock.h>
+#include <pj/log.h>
 #include <pj/os.h>
 #include <pj/pool.h>
 #include <pj/string.h>
 #include <pj/compat/high_precision.h>
 
+#if PJMEDIA_CLOCK_HAS_ABS_SLEEP
+#   include <errno.h>
+#   include <time.h>
+#endif
+
 /* API: Init clock source */
 PJ_DEF(pj_status_t) pjmedia_clock_src_init( pjmedia_clock_src *clocksrc,
                                             pjmedia_type media_type,
@@ -105,8 +111,18 @@ pjmedia_clock_src_get_time_msec( const pjmedia_clock_src *clocksrc )
 
 /*
  * Implementation of media clock with OS thread.
+ *
+ * Unless PJMEDIA_CLOCK_SCHED_THREAD_CNT is zero, asynchronous clocks don't
+ * get their own thread, they are assigned to one of the shared clock
+ * schedulers instead. A scheduler keeps its running clocks in a heap
+ * ordered by the next tick and its thread sleeps until the earliest one.
+ * Clocks created with PJMEDIA_CLOCK_NO_HIGHEST_PRIO, e.g. the video port
+ * ones, still get their own thread, so that their long callbacks don't
+ * delay the audio clocks.
  */
 
+typedef struct clock_sched clock_sched;
+
 struct pjmedia_clock
 {
     pj_pool_t		    *pool;
@@ -123,13 +139,489 @@ struct pjmedia_clock
     pj_bool_t		     running;
     pj_bool_t		     quitting;
     pj_lock_t		    *lock;
+    pjmedia_clock_stat	     stat;
+    clock_sched		    *sched;	/* Scheduler, NULL if own thread.   */
+    int			     heap_idx;	/* Index in scheduler heap, or -1.  */
 };
 
+#define THIS_FILE	"clock_thread.c"
+
+#if PJMEDIA_CLOCK_SCHED_THREAD_CNT > 0
+
+struct clock_sched
+{
+    pj_pool_t		    *pool;
+    clock_sched		    *next;	/* Next orphan scheduler.	    */
+    unsigned		     clock_cnt;	/* Clocks assigned to us.	    */
+    pj_thread_t		    *thread;
+    pj_mutex_t		    *mutex;
+    pj_sem_t		    *sem;	/* Wakes up the idle thread.	    */
+    pj_bool_t		     idle;	/* Waiting for sem.		    */
+    pj_bool_t		     sleeping;	/* Sleeping until sleep_until.	    */
+    pj_timestamp	     sleep_until;
+    pjmedia_clock	    *cur;	/* Clock whose callback is running. */
+    pjmedia_clock	   **heap;
+    unsigned		     heap_cnt;
+    unsigned		     heap_max;
+    unsigned		     wakeups;
+    pj_bool_t		     quitting;
+};
+
+/* The schedulers, created with their first clock and destroyed with their
+ * last one. A scheduler is allocated from the pool factory of the clock
+ * that created it.
+ */
+static clock_sched *clock_scheds[PJMEDIA_CLOCK_SCHED_THREAD_CNT];
+static pj_bool_t sched_atexit_set;
+
+/* Schedulers whose last clock was destroyed from its own callback. Their
+ * thread can't join itself, so they are destroyed by the next thread that
+ * creates or destroys a clock, by pjmedia_clock_sched_reap(), or on
+ * pj_shutdown().
+ */
+static clock_sched *sched_orphans;
+
+static int sched_thread(void *arg);
+
+#endif	/* PJMEDIA_CLOCK_SCHED_THREAD_CNT */
 
 static int clock_thread(void *arg);
 
 #define MAX_JUMP_MSEC	500
 #define USEC_IN_SEC	(pj_uint64_t)1000000
+#define NSEC_IN_SEC	(pj_uint64_t)1000000000
+
+
+/*
+ * Sleep until the specified timestamp. With PJMEDIA_CLOCK_HAS_ABS_SLEEP
+ * the deadline is converted to CLOCK_MONOTONIC time once, so the time
+ * spent before getting to sleep and the wakeup latency don't add up over
+ * the ticks.
+ */
+static void clock_sleep_until(const pj_timestamp *freq,
+			      const pj_timestamp *deadline)
+{
+    pj_timestamp now;
+
+#if PJMEDIA_CLOCK_HAS_ABS_SLEEP
+    struct timespec ts;
+    pj_uint64_t nsec;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    pj_get_timestamp(&now);
+    if (now.u64 >= deadline->u64)
+	return;
+
+    nsec = (deadline->u64 - now.u64) * NSEC_IN_SEC / freq->u64 + ts.tv_nsec;
+    ts.tv_sec += (time_t)(nsec / NSEC_IN_SEC);
+    ts.tv_nsec = (long)(nsec % NSEC_IN_SEC);
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)
+	   == EINTR)
+	;
+#else
+    PJ_UNUSED_ARG(freq);
+
+    /* Round up, or we'd keep waking up just before the deadline */
+    pj_get_timestamp(&now);
+    if (now.u64 < deadline->u64)
+	pj_thread_sleep((pj_elapsed_usec(&now, deadline) + 999) / 1000);
+#endif
+}
+
+
+/* Update the timing statistics before calling the callback */
+static void clock_update_stat(pjmedia_clock *clock)
+{
+    pj_timestamp now;
+    pj_int64_t late_usec;
+
+    pj_get_timestamp(&now);
+    late_usec = ((pj_int64_t)now.u64 - (pj_int64_t)clock->next_tick.u64) *
+		(pj_int64_t)USEC_IN_SEC / (pj_int64_t)clock->freq.u64;
+
+    ++clock->stat.tick_cnt;
+    pj_math_stat_update(&clock->stat.late_usec, (int)late_usec);
+    if (now.u64 >= clock->next_tick.u64 + clock->interval.u64)
+	++clock->stat.overrun_cnt;
+}
+
+
+#if PJMEDIA_CLOCK_SCHED_THREAD_CNT > 0
+
+/* Move the heap entry at idx up or down to restore the heap order */
+static void sched_heap_fix(clock_sched *sched, unsigned idx)
+{
+    pjmedia_clock **heap = sched->heap;
+    pjmedia_clock *clock = heap[idx];
+
+    while (idx > 0) {
+	unsigned parent = (idx - 1) / 2;
+	if (heap[parent]->next_tick.u64 <= clock->next_tick.u64)
+	    break;
+	heap[idx] = heap[parent];
+	heap[idx]->heap_idx = idx;
+	idx = parent;
+    }
+
+    for (;;) {
+	unsigned child = idx * 2 + 1;
+	if (child >= sched->heap_cnt)
+	    break;
+	if (child + 1 < sched->heap_cnt &&
+	    heap[child + 1]->next_tick.u64 < heap[child]->next_tick.u64)
+	{
+	    ++child;
+	}
+	if (clock->next_tick.u64 <= heap[child]->next_tick.u64)
+	    break;
+	heap[idx] = heap[child];
+	heap[idx]->heap_idx = idx;
+	idx = child;
+    }
+
+    heap[idx] = clock;
+    clock->heap_idx = idx;
+}
+
+static void sched_heap_insert(clock_sched *sched, pjmedia_clock *clock)
+{
+    if (sched->heap_cnt == sched->heap_max) {
+	/* The heap only grows when more clocks are running than ever
+	 * before, so just leave the old array in the pool.
+	 */
+	unsigned max = sched->heap_max ? sched->heap_max * 2 : 16;
+	pjmedia_clock **heap;
+
+	heap = (pjmedia_clock**)
+	       pj_pool_calloc(sched->pool, max, sizeof(pjmedia_clock*));
+	if (sched->heap_cnt)
+	    pj_memcpy(heap, sched->heap,
+		      sched->heap_cnt * sizeof(pjmedia_clock*));
+	sched->heap = heap;
+	sched->heap_max = max;
+    }
+
+    sched->heap[sched->heap_cnt++] = clock;
+    sched_heap_fix(sched, sched->heap_cnt - 1);
+}
+
+static void sched_heap_remove(clock_sched *sched, pjmedia_clock *clock)
+{
+    unsigned idx = clock->heap_idx;
+
+    clock->heap_idx = -1;
+    if (idx != --sched->heap_cnt) {
+	sched->heap[idx] = sched->heap[sched->heap_cnt];
+	sched_heap_fix(sched, idx);
+    }
+}
+
+/* Queue a started clock. Its first tick is aligned with the other clocks
+ * of the scheduler where possible, to save the thread some wakeups.
+ */
+static void sched_add_clock(clock_sched *sched, pjmedia_clock *clock)
+{
+    unsigned i;
+
+    pj_mutex_lock(sched->mutex);
+
+    clock->running = PJ_TRUE;
+    clock->quitting = PJ_FALSE;
+
+    if (clock->heap_idx >= 0 || sched->cur == clock) {
+	/* Already queued, or started from its own callback in which case
+	 * the scheduler queues it again after the callback.
+	 */
+	pj_mutex_unlock(sched->mutex);
+	return;
+    }
+
+    for (i = 0; i < sched->heap_cnt; ++i) {
+	pjmedia_clock *c = sched->heap[i];
+	if (c->interval.u64 == clock->interval.u64 &&
+	    c->next_tick.u64 < clock->next_tick.u64)
+	{
+	    clock->next_tick.u64 = c->next_tick.u64;
+	    break;
+	}
+    }
+
+    /* Don't expect the thread to wake up before it planned to */
+    if (i == sched->heap_cnt && sched->sleeping &&
+	clock->next_tick.u64 < sched->sleep_until.u64)
+    {
+	clock->next_tick.u64 = sched->sleep_until.u64;
+    }
+
+    sched_heap_insert(sched, clock);
+
+    if (sched->idle) {
+	sched->idle = PJ_FALSE;
+	pj_sem_post(sched->sem);
+    }
+
+    pj_mutex_unlock(sched->mutex);
+}
+
+/* Dequeue a clock, and wait until its callback returns unless it's being
+ * called from the callback itself.
+ */
+static void sched_remove_clock(clock_sched *sched, pjmedia_clock *clock)
+{
+    pj_mutex_lock(sched->mutex);
+
+    clock->running = PJ_FALSE;
+    clock->quitting = PJ_TRUE;
+
+    if (clock->heap_idx >= 0)
+	sched_heap_remove(sched, clock);
+
+    if (pj_thread_this() != sched->thread) {
+	while (sched->cur == clock) {
+	    pj_mutex_unlock(sched->mutex);
+	    pj_thread_sleep(1);
+	    pj_mutex_lock(sched->mutex);
+	}
+    }
+
+    pj_mutex_unlock(sched->mutex);
+}
+
+/* Stop the scheduler thread. Must not be called from the scheduler thread,
+ * nor with the critical section held since it waits for the thread.
+ */
+static void sched_stop(clock_sched *sched)
+{
+    if (sched->thread) {
+	pj_mutex_lock(sched->mutex);
+	sched->quitting = PJ_TRUE;
+	pj_mutex_unlock(sched->mutex);
+	pj_sem_post(sched->sem);
+	pj_thread_join(sched->thread);
+	pj_thread_destroy(sched->thread);
+	sched->thread = NULL;
+    }
+}
+
+/* Stop the scheduler thread and release the scheduler */
+static void sched_destroy(clock_sched *sched)
+{
+    sched_stop(sched);
+    if (sched->sem)
+	pj_sem_destroy(sched->sem);
+    if (sched->mutex)
+	pj_mutex_destroy(sched->mutex);
+
+    pj_pool_release(sched->pool);
+}
+
+/* Destroy the orphan schedulers that the calling thread can join */
+static void sched_reap_orphans(void)
+{
+    clock_sched *reap = NULL, **p;
+
+    pj_enter_critical_section();
+    p = &sched_orphans;
+    while (*p) {
+	clock_sched *sched = *p;
+
+	if (sched->thread != pj_thread_this()) {
+	    *p = sched->next;
+	    sched->next = reap;
+	    reap = sched;
+	} else {
+	    p = &sched->next;
+	}
+    }
+    pj_leave_critical_section();
+
+    while (reap) {
+	clock_sched *sched = reap;
+	reap = sched->next;
+	sched_destroy(sched);
+    }
+}
+
+/* Stop the scheduler threads on pj_shutdown(). Clocks still alive by then
+ * have been leaked by the application. Their schedulers' threads are
+ * stopped too, but the schedulers are not released since the leaked
+ * clocks still point to them.
+ */
+static void sched_atexit(void)
+{
+    clock_sched *leaked = NULL;
+    unsigned i;
+
+    sched_reap_orphans();
+
+    pj_enter_critical_section();
+    for (i = 0; i < PJMEDIA_CLOCK_SCHED_THREAD_CNT; ++i) {
+	if (clock_scheds[i]) {
+	    clock_scheds[i]->next = leaked;
+	    leaked = clock_scheds[i];
+	    clock_scheds[i] = NULL;
+	}
+    }
+    sched_atexit_set = PJ_FALSE;
+    pj_leave_critical_section();
+
+    if (leaked) {
+	PJ_LOG(2,(THIS_FILE, "Media clocks still exist on shutdown, "
+			     "stopping their threads"));
+    }
+
+    while (leaked) {
+	clock_sched *sched = leaked;
+	leaked = sched->next;
+	sched_stop(sched);
+    }
+}
+
+static pj_status_t sched_create(pj_pool_factory *pf, clock_sched **p_sched)
+{
+    pj_pool_t *pool;
+    clock_sched *sched;
+    pj_status_t status;
+
+    pool = pj_pool_create(pf, "clksched%p", 512, 512, NULL);
+    if (!pool)
+	return PJ_ENOMEM;
+
+    sched = PJ_POOL_ZALLOC_T(pool, clock_sched);
+    sched->pool = pool;
+
+    status = pj_mutex_create_simple(sched->pool, "clksched", &sched->mutex);
+    if (status == PJ_SUCCESS)
+	status = pj_sem_create(sched->pool, "clksched", 0, 1, &sched->sem);
+    if (status == PJ_SUCCESS)
+	status = pj_thread_create(sched->pool, "clock", &sched_thread, sched,
+				  0, 0, &sched->thread);
+    if (status != PJ_SUCCESS) {
+	sched_destroy(sched);
+	return status;
+    }
+
+    *p_sched = sched;
+
+    return PJ_SUCCESS;
+}
+
+/* Assign a scheduler to a new asynchronous clock. A new scheduler is
+ * created outside of the critical section, since that starts its thread,
+ * and is only published if its slot is still empty by then.
+ */
+static pj_status_t sched_attach(pjmedia_clock *clock, pj_pool_factory *pf)
+{
+    clock_sched *created = NULL;
+    pj_bool_t set_atexit = PJ_FALSE;
+    pj_status_t status;
+
+    sched_reap_orphans();
+
+    pj_enter_critical_section();
+    if (!sched_atexit_set) {
+	sched_atexit_set = PJ_TRUE;
+	set_atexit = PJ_TRUE;
+    }
+    pj_leave_critical_section();
+
+    if (set_atexit) {
+	status = pj_atexit(&sched_atexit);
+	if (status != PJ_SUCCESS) {
+	    pj_enter_critical_section();
+	    sched_atexit_set = PJ_FALSE;
+	    pj_leave_critical_section();
+	    return status;
+	}
+    }
+
+    for (;;) {
+	clock_sched **slot;
+	unsigned i;
+
+	pj_enter_critical_section();
+
+	/* An empty slot gets a new scheduler, otherwise pick the least
+	 * busy
+	 */
+	slot = &clock_scheds[0];
+	for (i = 0; i < PJMEDIA_CLOCK_SCHED_THREAD_CNT && *slot; ++i) {
+	    if (!clock_scheds[i] ||
+		clock_scheds[i]->clock_cnt < (*slot)->clock_cnt)
+	    {
+		slot = &clock_scheds[i];
+	    }
+	}
+
+	if (!*slot && created) {
+	    *slot = created;
+	    created = NULL;
+	}
+	if (*slot) {
+	    ++(*slot)->clock_cnt;
+	    clock->sched = *slot;
+	}
+
+	pj_leave_critical_section();
+
+	if (clock->sched)
+	    break;
+
+	status = sched_create(pf, &created);
+	if (status != PJ_SUCCESS)
+	    return status;
+    }
+
+    /* Another clock filled the slots while we created ours */
+    if (created)
+	sched_destroy(created);
+
+    return PJ_SUCCESS;
+}
+
+/* Release the clock's scheduler, destroying it with its last clock */
+static void sched_detach(pjmedia_clock *clock)
+{
+    clock_sched *sched = clock->sched;
+    pj_bool_t destroy = PJ_FALSE;
+    unsigned i;
+
+    pj_enter_critical_section();
+
+    clock->sched = NULL;
+
+    if (--sched->clock_cnt == 0) {
+	for (i = 0; i < PJMEDIA_CLOCK_SCHED_THREAD_CNT; ++i) {
+	    if (clock_scheds[i] == sched)
+		clock_scheds[i] = NULL;
+	}
+
+	if (pj_thread_this() != sched->thread) {
+	    destroy = PJ_TRUE;
+	} else {
+	    /* Destroyed from the clock callback, let the thread quit once
+	     * the callback returns, and have it joined later.
+	     */
+	    pj_mutex_lock(sched->mutex);
+	    sched->quitting = PJ_TRUE;
+	    pj_mutex_unlock(sched->mutex);
+
+	    sched->next = sched_orphans;
+	    sched_orphans = sched;
+	}
+    }
+
+    pj_leave_critical_section();
+
+    if (destroy)
+	sched_destroy(sched);
+    else
+	sched_reap_orphans();
+}
+
+#endif	/* PJMEDIA_CLOCK_SCHED_THREAD_CNT */
+
 
 /*
  * Create media clock.
@@ -165,7 +657,7 @@ PJ_DEF(pj_status_t) pjmedia_clock_create2(pj_pool_t *pool,
     PJ_ASSERT_RETURN(pool && param->usec_interval && param->clock_rate &&
                      p_clock, PJ_EINVAL);
 
-    clock = PJ_POOL_ALLOC_T(pool, pjmedia_clock);
+    clock = PJ_POOL_ZALLOC_T(pool, pjmedia_clock);
     clock->pool = pj_pool_create(pool->factory, "clock%p", 512, 512, NULL);
 
     status = pj_get_timestamp_freq(&clock->freq);
@@ -186,12 +678,24 @@ PJ_DEF(pj_status_t) pjmedia_clock_create2(pj_pool_t *pool,
     clock->thread = NULL;
     clock->running = PJ_FALSE;
     clock->quitting = PJ_FALSE;
+    clock->heap_idx = -1;
+    pj_math_stat_init(&clock->stat.late_usec);
     
     /* I don't think we need a mutex, so we'll use null. */
     status = pj_lock_create_null_mutex(pool, "clock", &clock->lock);
     if (status != PJ_SUCCESS)
 	return status;
 
+#if PJMEDIA_CLOCK_SCHED_THREAD_CNT > 0
+    if ((options & (PJMEDIA_CLOCK_NO_ASYNC | PJMEDIA_CLOCK_NO_HIGHEST_PRIO))
+	== 0)
+    {
+	status = sched_attach(clock, pool->factory);
+	if (status != PJ_SUCCESS)
+	    return status;
+    }
+#endif
+
     *p_clock = clock;
 
     return PJ_SUCCESS;
@@ -216,6 +720,14 @@ PJ_DEF(pj_status_t) pjmedia_clock_start(pjmedia_clock *clock)
 	return status;
 
     clock->next_tick.u64 = now.u64 + clock->interval.u64;
+
+#if PJMEDIA_CLOCK_SCHED_THREAD_CNT > 0
+    if (clock->sched) {
+	sched_add_clock(clock->sched, clock);
+	return PJ_SUCCESS;
+    }
+#endif
+
     clock->running = PJ_TRUE;
     clock->quitting = PJ_FALSE;
 
@@ -239,6 +751,13 @@ PJ_DEF(pj_status_t) pjmedia_clock_stop(pjmedia_clock *clock)
 {
     PJ_ASSERT_RETURN(clock != NULL, PJ_EINVAL);
 
+#if PJMEDIA_CLOCK_SCHED_THREAD_CNT > 0
+    if (clock->sched) {
+	sched_remove_clock(clock->sched, clock);
+	return PJ_SUCCESS;
+    }
+#endif
+
     clock->running = PJ_FALSE;
     clock->quitting = PJ_TRUE;
 
@@ -279,6 +798,7 @@ PJ_INLINE(void) clock_calc_next_tick(pjmedia_clock *clock,
     if (clock->next_tick.u64+clock->max_jump < now->u64) {
 	/* Timestamp has made large jump, adjust next_tick */
 	clock->next_tick.u64 = now->u64;
+	++clock->stat.resync_cnt;
     }
     clock->next_tick.u64 += clock->interval.u64;
 
@@ -305,15 +825,15 @@ PJ_DEF(pj_bool_t) pjmedia_clock_wait( pjmedia_clock *clock,
 
     /* Wait for the next tick to happen */
     if (now.u64 < clock->next_tick.u64) {
-	unsigned msec;
-
 	if (!wait)
 	    return PJ_FALSE;
 
-	msec = pj_elapsed_msec(&now, &clock->next_tick);
-	pj_thread_sleep(msec);
+	clock_sleep_until(&clock->freq, &clock->next_tick);
+	++clock->stat.thread_wakeups;
     }
 
+    clock_update_stat(clock);
+
     /* Call callback, if any */
     if (clock->cb)
 	(*clock->cb)(&clock->timestamp, clock->user_data);
@@ -333,6 +853,100 @@ PJ_DEF(pj_bool_t) pjmedia_clock_wait( pjmedia_clock *clock,
 }
 
 
+/* Set the calling clock thread priority to maximum */
+static void clock_thread_set_max_prio(void)
+{
+    int max = pj_thread_get_prio_max(pj_thread_this());
+    if (max > 0)
+	pj_thread_set_prio(pj_thread_this(), max);
+}
+
+
+#if PJMEDIA_CLOCK_SCHED_THREAD_CNT > 0
+
+/*
+ * Scheduler thread
+ */
+static int sched_thread(void *arg)
+{
+    clock_sched *sched = (clock_sched*) arg;
+
+    clock_thread_set_max_prio();
+
+    pj_mutex_lock(sched->mutex);
+
+    while (!sched->quitting) {
+	pjmedia_clock *clock;
+	pj_timestamp now;
+
+	if (sched->heap_cnt == 0) {
+	    sched->idle = PJ_TRUE;
+	    pj_mutex_unlock(sched->mutex);
+	    pj_sem_wait(sched->sem);
+	    pj_mutex_lock(sched->mutex);
+	    sched->idle = PJ_FALSE;
+	    continue;
+	}
+
+	/* Wait for the earliest tick. The heap may change meanwhile, so
+	 * look at it again after waking up.
+	 */
+	clock = sched->heap[0];
+	pj_get_timestamp(&now);
+	if (now.u64 < clock->next_tick.u64) {
+	    pj_timestamp deadline = clock->next_tick;
+
+	    sched->sleep_until = deadline;
+	    sched->sleeping = PJ_TRUE;
+	    pj_mutex_unlock(sched->mutex);
+
+	    clock_sleep_until(&clock->freq, &deadline);
+
+	    pj_mutex_lock(sched->mutex);
+	    sched->sleeping = PJ_FALSE;
+	    ++sched->wakeups;
+	    continue;
+	}
+
+	sched_heap_remove(sched, clock);
+	sched->cur = clock;
+	pj_mutex_unlock(sched->mutex);
+
+	pj_lock_acquire(clock->lock);
+
+	clock_update_stat(clock);
+
+	/* Call callback, if any */
+	if (clock->cb)
+	    (*clock->cb)(&clock->timestamp, clock->user_data);
+
+	/* Best effort way to detect if we've been destroyed in the callback */
+	if (clock->lock) {
+	    /* Increment timestamp */
+	    clock->timestamp.u64 += clock->timestamp_inc;
+
+	    /* Calculate next tick */
+	    clock_calc_next_tick(clock, &now);
+
+	    pj_lock_release(clock->lock);
+	}
+
+	pj_mutex_lock(sched->mutex);
+	sched->cur = NULL;
+
+	/* Queue it again, unless it was stopped by the callback */
+	if (clock->running && clock->heap_idx < 0)
+	    sched_heap_insert(sched, clock);
+    }
+
+    pj_mutex_unlock(sched->mutex);
+
+    return 0;
+}
+
+#endif	/* PJMEDIA_CLOCK_SCHED_THREAD_CNT */
+
+
 /*
  * Clock thread
  */
@@ -342,11 +956,8 @@ static int clock_thread(void *arg)
     pjmedia_clock *clock = (pjmedia_clock*) arg;
 
     /* Set thread priority to maximum unless not wanted. */
-    if ((clock->options & PJMEDIA_CLOCK_NO_HIGHEST_PRIO) == 0) {
-	int max = pj_thread_get_prio_max(pj_thread_this());
-	if (max > 0)
-	    pj_thread_set_prio(pj_thread_this(), max);
-    }
+    if ((clock->options & PJMEDIA_CLOCK_NO_HIGHEST_PRIO) == 0)
+	clock_thread_set_max_prio();
 
     /* Get the first tick */
     pj_get_timestamp(&clock->next_tick);
@@ -359,9 +970,8 @@ static int clock_thread(void *arg)
 
 	/* Wait for the next tick to happen */
 	if (now.u64 < clock->next_tick.u64) {
-	    unsigned msec;
-	    msec = pj_elapsed_msec(&now, &clock->next_tick);
-	    pj_thread_sleep(msec);
+	    clock_sleep_until(&clock->freq, &clock->next_tick);
+	    ++clock->stat.thread_wakeups;
 	}
 
 	/* Skip if not running */
@@ -373,6 +983,8 @@ static int clock_thread(void *arg)
 
 	pj_lock_acquire(clock->lock);
 
+	clock_update_stat(clock);
+
 	/* Call callback, if any */
 	if (clock->cb)
 	    (*clock->cb)(&clock->timestamp, clock->user_data);
@@ -394,6 +1006,36 @@ static int clock_thread(void *arg)
 }
 
 
+/*
+ * Get the clock statistics.
+ */
+PJ_DEF(pj_status_t) pjmedia_clock_get_stat(const pjmedia_clock *clock,
+					   pjmedia_clock_stat *stat)
+{
+    PJ_ASSERT_RETURN(clock && stat, PJ_EINVAL);
+
+    pj_memcpy(stat, &clock->stat, sizeof(*stat));
+
+#if PJMEDIA_CLOCK_SCHED_THREAD_CNT > 0
+    if (clock->sched)
+	stat->thread_wakeups = clock->sched->wakeups;
+#endif
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Release the orphan schedulers.
+ */
+PJ_DEF(void) pjmedia_clock_sched_reap(void)
+{
+#if PJMEDIA_CLOCK_SCHED_THREAD_CNT > 0
+    sched_reap_orphans();
+#endif
+}
+
+
 /*
  * Destroy the clock. 
  */
@@ -401,6 +1043,13 @@ PJ_DEF(pj_status_t) pjmedia_clock_destroy(pjmedia_clock *clock)
 {
     PJ_ASSERT_RETURN(clock != NULL, PJ_EINVAL);
 
+#if PJMEDIA_CLOCK_SCHED_THREAD_CNT > 0
+    if (clock->sched) {
+	sched_remove_clock(clock->sched, clock);
+	sched_detach(clock);
+    }
+#endif
+
     clock->running = PJ_FALSE;
     clock->quitting = PJ_TRUE;
 
@@ -422,5 +1071,3 @@ PJ_DEF(pj_status_t) pjmedia_clock_destroy(pjmedia_clock *clock)
     }
     return PJ_SUCCESS;
 }
-
-
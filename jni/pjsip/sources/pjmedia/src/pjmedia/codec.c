@@ -659,3 +659,43 @@ PJ_DEF(pj_status_t) pjmedia_codec_mgr_dealloc_codec(pjmedia_codec_mgr *mgr,
     return (*codec->factory->op->dealloc_codec)(codec->factory, codec);
 }
 
+
+
+/*
+ * Decode several base frames.
+ */
+PJ_DEF(pj_status_t) pjmedia_codec_decode_frames(pjmedia_codec *codec,
+						unsigned frame_cnt,
+						const pjmedia_frame input[],
+						unsigned out_size,
+						pjmedia_frame *output)
+{
+    unsigned i, total = 0;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(codec && input && output && frame_cnt, PJ_EINVAL);
+
+    if (codec->op->decode_frames)
+	return (*codec->op->decode_frames)(codec, frame_cnt, input,
+					   out_size, output);
+
+    for (i=0; i<frame_cnt; ++i) {
+	pjmedia_frame frm;
+
+	frm.buf = (pj_uint8_t*)output->buf + total;
+	frm.size = out_size - total;
+	status = (*codec->op->decode)(codec, &input[i], out_size - total,
+				      &frm);
+	if (status != PJ_SUCCESS) {
+	    output->size = total;
+	    return status;
+	}
+	total += frm.size;
+    }
+
+    output->type = PJMEDIA_FRAME_TYPE_AUDIO;
+    output->size = total;
+    output->timestamp = input[0].timestamp;
+
+    return PJ_SUCCESS;
+}
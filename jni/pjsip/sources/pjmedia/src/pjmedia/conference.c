@@ -1883,9 +1883,13 @@ static pj_status_t get_frame(pjmedia_port *this_port,
 	    if (conf->ports[i] == NULL)
 		continue;
 
-	    /* Ignore if we didn't get any frame */
-	    if (frame_type != PJMEDIA_FRAME_TYPE_AUDIO)
+	    /* Ignore if we didn't get any frame (e.g. the stream has
+	     * skipped decoding a silent frame).
+	     */
+	    if (frame_type != PJMEDIA_FRAME_TYPE_AUDIO) {
+		conf_port->rx_level = 0;
 		continue;
+	    }
 	}
 
 	p_in = (pj_int16_t*) frame->buf;
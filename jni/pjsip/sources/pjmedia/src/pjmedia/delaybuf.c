@@ -56,6 +56,18 @@ enum OP
  */
 #define SAFE_MARGIN	    0
 
+/* Drift compensator settings. The control loop settles in about
+ * DRIFT_LOOP_TIME seconds, slow enough to ignore the burstiness of the
+ * put() and get() operations. Level averaging is in 2^DRIFT_AVG_SHIFT
+ * frames.
+ */
+#define DRIFT_LOOP_TIME	    60
+#define DRIFT_AVG_SHIFT	    4
+#define DRIFT_2PI_Q24	    105414357	/* 2*pi, in Q24 */
+
+/* Number of input samples kept for the cubic interpolation */
+#define DRIFT_HIST	    4
+
 /* This structure describes internal delaybuf settings and states.
  */
 struct pjmedia_delay_buf
@@ -83,6 +95,22 @@ struct pjmedia_delay_buf
 
     /* Drift handler */
     pjmedia_wsola   *wsola;		/**< Drift handler		     */
+
+    /* Drift compensator, see drift_update() and drift_read() */
+    pj_int16_t	    *drift_buf;		/**< Interpolation history followed
+					     by the input samples	     */
+    pj_uint64_t	     drift_pos;		/**< Read position, Q32		     */
+    pj_bool_t	     drift_on;		/**< Running after level is learnt   */
+    pj_int32_t	     drift;		/**< Rate correction, Q32	     */
+    pj_int32_t	     max_drift;		/**< Maximum correction, Q32	     */
+    pj_int32_t	     drift_kp;		/**< Proportional gain		     */
+    pj_int64_t	     drift_ki;		/**< Integral gain, Q16		     */
+    pj_int64_t	     drift_integ;	/**< Integrated level error	     */
+    int		     lvl_avg;		/**< Average level at get(), Q8      */
+
+    /* Statistics */
+    unsigned	     shrink_cnt;	/**< Number of discards		     */
+    unsigned	     expand_cnt;	/**< Number of generated frames      */
 };
 
 
@@ -131,6 +159,32 @@ PJ_DEF(pj_status_t) pjmedia_delay_buf_create( pj_pool_t *pool,
         if (status != PJ_SUCCESS)
 	    return status;
         PJ_LOG(5, (b->obj_name, "Using delay buffer with WSOLA."));
+
+#if PJMEDIA_DELAY_BUF_MAX_DRIFT
+	/* Create drift compensator */
+	if (samples_per_frame / channel_count >= DRIFT_HIST) {
+	    unsigned spf = samples_per_frame / channel_count;
+	    unsigned max_in = spf + DRIFT_HIST +
+			      spf * PJMEDIA_DELAY_BUF_MAX_DRIFT / 1000000;
+
+	    b->drift_buf = (pj_int16_t*)
+			   pj_pool_calloc(pool, (DRIFT_HIST + max_in) *
+					  channel_count, sizeof(pj_int16_t));
+	    b->drift_pos = (pj_uint64_t)(DRIFT_HIST - 1) << 32;
+	    b->max_drift = (pj_int32_t)
+			   (((pj_int64_t)PJMEDIA_DELAY_BUF_MAX_DRIFT << 32) /
+			    1000000);
+	    b->lvl_avg = -1;
+
+	    /* Critically damped loop with w = 2*pi / DRIFT_LOOP_TIME:
+	     * kp = 2*w / clock_rate and ki = w^2 * ptime / clock_rate.
+	     */
+	    b->drift_kp = 2 * DRIFT_2PI_Q24 / (DRIFT_LOOP_TIME * clock_rate);
+	    b->drift_ki = (((pj_int64_t)DRIFT_2PI_Q24 * DRIFT_2PI_Q24) >> 8) *
+			  b->ptime / ((pj_int64_t)1000 * DRIFT_LOOP_TIME *
+				      DRIFT_LOOP_TIME * clock_rate);
+	}
+#endif
     } else {
         PJ_LOG(5, (b->obj_name, "Using simple FIFO delay buffer."));
     }
@@ -197,11 +251,113 @@ static void shrink_buffer(pjmedia_delay_buf *b, unsigned erase_cnt)
 				 pjmedia_circ_buf_get_len(b->circ_buf) - 
 				 erase_cnt);
 
+	++b->shrink_cnt;
 	PJ_LOG(5,(b->obj_name,"%d samples reduced, buf_cnt=%d", 
 	       erase_cnt, pjmedia_circ_buf_get_len(b->circ_buf)));
     }
 }
 
+/* Update the rate correction of the drift compensator from the buffer
+ * level. The integral term converges to the clock ratio between the
+ * producer and the consumer, the proportional term pulls the level back
+ * to the target. The target leaves half a frame of margin both for the
+ * extra get() when the two clocks slip past each other, and below the
+ * level where update() starts shrinking the buffer.
+ */
+static void drift_update(pjmedia_delay_buf *b)
+{
+    unsigned ch = b->channel_count;
+    int level, target, err;
+    pj_int64_t drift;
+
+    if (!b->drift_on)
+	return;
+
+    level = (int)(pjmedia_circ_buf_get_len(b->circ_buf) / ch) << 8;
+    if (b->lvl_avg < 0)
+	b->lvl_avg = level;
+    else
+	b->lvl_avg += (level - b->lvl_avg) >> DRIFT_AVG_SHIFT;
+
+    target = (int)((2 * b->samples_per_frame + (b->eff_cnt >> 1)) / ch) << 8;
+    err = b->lvl_avg - target;
+
+    drift = (pj_int64_t)err * b->drift_kp +
+	    ((b->drift_integ * b->drift_ki) >> 16);
+
+    /* Only integrate while not saturated, or when it reduces saturation */
+    if (drift > b->max_drift) {
+	drift = b->max_drift;
+	if (err < 0) b->drift_integ += err;
+    } else if (drift < -b->max_drift) {
+	drift = -b->max_drift;
+	if (err > 0) b->drift_integ += err;
+    } else {
+	b->drift_integ += err;
+    }
+
+    b->drift = (pj_int32_t)drift;
+}
+
+/* Catmull-Rom interpolation between p1 and p2, f is in Q15 */
+PJ_INLINE(pj_int16_t) interpolate(int p0, int p1, int p2, int p3, int f)
+{
+    pj_int64_t acc;
+
+    acc = ((pj_int64_t)(3 * (p1 - p2) + p3 - p0) * f) >> 15;
+    acc = ((acc + 2 * p0 - 5 * p1 + 4 * p2 - p3) * f) >> 15;
+    acc = ((acc + p2 - p0) * f) >> 16;
+    acc += p1;
+
+    if (acc > 32767) return 32767;
+    if (acc < -32768) return -32768;
+    return (pj_int16_t)acc;
+}
+
+/* Read one frame, resampled with the current rate correction. Returns
+ * PJ_FALSE if the buffer doesn't have enough samples.
+ */
+static pj_bool_t drift_read(pjmedia_delay_buf *b, pj_int16_t frame[])
+{
+    unsigned ch = b->channel_count;
+    unsigned spf = b->samples_per_frame / ch;
+    pj_uint64_t step = ((pj_uint64_t)1 << 32) + (pj_int64_t)b->drift;
+    pj_uint64_t pos = b->drift_pos;
+    pj_uint64_t end = pos + step * spf;
+    unsigned in_cnt = (unsigned)(end >> 32);
+    pj_int16_t *in = b->drift_buf;
+    unsigned i, c;
+
+    if (pjmedia_circ_buf_get_len(b->circ_buf) < in_cnt * ch)
+	return PJ_FALSE;
+
+    pjmedia_circ_buf_read(b->circ_buf, in + DRIFT_HIST * ch, in_cnt * ch);
+
+    /* Output sample at position t lies between in[t+1] and in[t+2] */
+    for (i = 0; i < spf; ++i, pos += step) {
+	const pj_int16_t *p = in + (unsigned)(pos >> 32) * ch;
+	int f = (int)(pos >> 17) & 0x7FFF;
+
+	for (c = 0; c < ch; ++c, ++p)
+	    *frame++ = interpolate(p[0], p[ch], p[2*ch], p[3*ch], f);
+    }
+
+    pjmedia_move_samples(in, in + in_cnt * ch, DRIFT_HIST * ch);
+    b->drift_pos = end & 0xFFFFFFFF;
+
+    return PJ_TRUE;
+}
+
+/* Continue resampling right after a frame that was not resampled */
+static void drift_restart(pjmedia_delay_buf *b, const pj_int16_t frame[])
+{
+    unsigned cnt = DRIFT_HIST * b->channel_count;
+
+    pjmedia_copy_samples(b->drift_buf, frame + b->samples_per_frame - cnt,
+			 cnt);
+    b->drift_pos = (pj_uint64_t)(DRIFT_HIST - 1) << 32;
+}
+
 /* Fast increase, slow decrease */
 #define AGC_UP(cur, target) cur = (cur + target*3) >> 2
 #define AGC_DOWN(cur, target) cur = (cur*3 + target) >> 2
@@ -243,6 +399,9 @@ static void update(pjmedia_delay_buf *b, enum OP op)
 	
 	b->max_level = 0;
 	b->recalc_timer = RECALC_TIME;
+
+	/* The level target is known now */
+	b->drift_on = (b->drift_buf != NULL);
     }
 
     /* See if we need to shrink the buffer to reduce delay */
@@ -305,6 +464,7 @@ PJ_DEF(pj_status_t) pjmedia_delay_buf_put(pjmedia_delay_buf *b,
 			b->samples_per_frame - b->max_cnt;
 
 	    pjmedia_circ_buf_adv_read_ptr(b->circ_buf, erase_cnt);
+	    ++b->shrink_cnt;
 
 	    PJ_LOG(4,(b->obj_name,"%sDropping %d eldest samples, buf_cnt=%d",
                       (b->wsola? "Shrinking failed or insufficient. ": ""),
@@ -330,21 +490,29 @@ PJ_DEF(pj_status_t) pjmedia_delay_buf_get( pjmedia_delay_buf *b,
     if (b->wsola)
         update(b, OP_GET);
 
+    /* Normally the frame is resampled to compensate clock drift */
+    if (b->drift_buf) {
+	drift_update(b);
+	if (drift_read(b, frame)) {
+	    pj_lock_release(b->lock);
+	    return PJ_SUCCESS;
+	}
+    }
+
     /* Starvation checking */
     if (pjmedia_circ_buf_get_len(b->circ_buf) < b->samples_per_frame) {
 
 	PJ_LOG(4,(b->obj_name,"Underflow, buf_cnt=%d, will generate 1 frame",
 		  pjmedia_circ_buf_get_len(b->circ_buf)));
+	++b->expand_cnt;
 
         if (b->wsola) {
             status = pjmedia_wsola_generate(b->wsola, frame);
 
 	    if (status == PJ_SUCCESS) {
 	        TRACE__((b->obj_name,"Successfully generate 1 frame"));
-	        if (pjmedia_circ_buf_get_len(b->circ_buf) == 0) {
-		    pj_lock_release(b->lock);
-		    return PJ_SUCCESS;
-	        }
+	        if (pjmedia_circ_buf_get_len(b->circ_buf) == 0)
+		    goto on_return;
 
 	        /* Put generated frame into buffer */
 	        pjmedia_circ_buf_write(b->circ_buf, frame,
@@ -367,14 +535,16 @@ PJ_DEF(pj_status_t) pjmedia_delay_buf_get( pjmedia_delay_buf *b,
 	    /* The buffer is empty now, reset it */
 	    pjmedia_circ_buf_reset(b->circ_buf);
 
-	    pj_lock_release(b->lock);
-
-	    return PJ_SUCCESS;
+	    goto on_return;
 	}
     }
 
     pjmedia_circ_buf_read(b->circ_buf, frame, b->samples_per_frame);
 
+on_return:
+    if (b->drift_buf)
+	drift_restart(b, frame);
+
     pj_lock_release(b->lock);
 
     return PJ_SUCCESS;
@@ -396,6 +566,13 @@ PJ_DEF(pj_status_t) pjmedia_delay_buf_reset(pjmedia_delay_buf *b)
     if (b->wsola)
         pjmedia_wsola_reset(b->wsola, 0);
 
+    /* Reset drift compensator, but keep the learnt clock ratio */
+    if (b->drift_buf) {
+	pjmedia_zero_samples(b->drift_buf, DRIFT_HIST * b->channel_count);
+	b->drift_pos = (pj_uint64_t)(DRIFT_HIST - 1) << 32;
+	b->lvl_avg = -1;
+    }
+
     pj_lock_release(b->lock);
 
     PJ_LOG(5,(b->obj_name,"Delay buffer is reset"));
@@ -403,3 +580,23 @@ PJ_DEF(pj_status_t) pjmedia_delay_buf_reset(pjmedia_delay_buf *b)
     return PJ_SUCCESS;
 }
 
+
+PJ_DEF(pj_status_t) pjmedia_delay_buf_get_stat(pjmedia_delay_buf *b,
+					       pjmedia_delay_buf_stat *stat)
+{
+    PJ_ASSERT_RETURN(b && stat, PJ_EINVAL);
+
+    pj_lock_acquire(b->lock);
+
+    stat->buf_cnt = pjmedia_circ_buf_get_len(b->circ_buf);
+    stat->eff_cnt = b->eff_cnt;
+    stat->drift = (int)((((b->drift_integ * b->drift_ki) >> 16) * 1000000) /
+			((pj_int64_t)1 << 32));
+    stat->shrink_cnt = b->shrink_cnt;
+    stat->expand_cnt = b->expand_cnt;
+
+    pj_lock_release(b->lock);
+
+    return PJ_SUCCESS;
+}
+
@@ -0,0 +1,588 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "dsp_internal.h"
+#include <pj/assert.h>
+#include <pj/string.h>
+
+#if DSP_HAS_SSE2 || DSP_HAS_AVX2
+#   if defined(_MSC_VER)
+#	include <intrin.h>
+#   else
+#	include <cpuid.h>
+#   endif
+#endif
+
+#if DSP_HAS_NEON && defined(__arm__) && defined(__linux__)
+#   include <stdio.h>
+#endif
+
+/*
+ * Scalar reference.
+ */
+pj_int32_t pjmedia_dsp_inner_prod16_c(const pj_int16_t *x,
+				      const pj_int16_t *y,
+				      unsigned len)
+{
+    pj_uint32_t sum = 0;
+    unsigned i;
+
+    for (i=0; i<len; ++i)
+	sum += (pj_uint32_t)((pj_int32_t)x[i] * y[i]);
+
+    return (pj_int32_t)sum;
+}
+
+static void xcorr16_c(const pj_int16_t *x, const pj_int16_t *y,
+		      pj_int32_t *xcorr, unsigned len, unsigned lag_cnt)
+{
+    unsigned k;
+
+    for (k=0; k<lag_cnt; ++k)
+	xcorr[k] = pjmedia_dsp_inner_prod16_c(x, y+k, len);
+}
+
+void pjmedia_dsp_autocorr_f_c(const float *x, float *ac, unsigned len,
+			      unsigned lag_cnt)
+{
+    unsigned i, k;
+
+    for (k=0; k<lag_cnt; ++k) {
+	float sum = 0;
+	for (i=0; i<len-k; ++i)
+	    sum += x[i] * x[i+k];
+	ac[k] = sum;
+    }
+}
+
+void pjmedia_dsp_fir_f_c(const float *x, const float *h, float *y,
+			 unsigned len, unsigned tap_cnt)
+{
+    unsigned n, k;
+
+    for (n=0; n<len; ++n) {
+	float sum = 0;
+	for (k=0; k<tap_cnt; ++k)
+	    sum += x[n+k] * h[k];
+	y[n] = sum;
+    }
+}
+
+/* Bins from the pair starting at "first", plus the DC and Nyquist bins */
+void pjmedia_dsp_spectrum_mac_tail_c(const float *x, const float *y,
+				     float *acc, unsigned len,
+				     unsigned blk_cnt, unsigned first)
+{
+    unsigned i, b;
+
+    acc[0] = 0;
+    for (i=first; i<len; ++i)
+	acc[i] = 0;
+
+    for (b=0; b<blk_cnt; ++b) {
+	acc[0] += x[0] * y[0];
+	for (i=first; i<len-1; i+=2) {
+	    acc[i] += x[i] * y[i] - x[i+1] * y[i+1];
+	    acc[i+1] += x[i+1] * y[i] + x[i] * y[i+1];
+	}
+	acc[len-1] += x[len-1] * y[len-1];
+	x += len;
+	y += len;
+    }
+}
+
+void pjmedia_dsp_spectrum_mac_f_c(const float *x, const float *y,
+				  float *acc, unsigned len, unsigned blk_cnt)
+{
+    pjmedia_dsp_spectrum_mac_tail_c(x, y, acc, len, blk_cnt, 1);
+}
+
+const pj_int16_t pjmedia_dsp_sin_tbl[1024] =
+{
+         0,    201,    402,    603,    804,   1005,   1206,   1406,
+      1607,   1808,   2009,   2209,   2410,   2610,   2811,   3011,
+      3211,   3411,   3611,   3811,   4011,   4210,   4409,   4608,
+      4807,   5006,   5205,   5403,   5601,   5799,   5997,   6195,
+      6392,   6589,   6786,   6982,   7179,   7375,   7571,   7766,
+      7961,   8156,   8351,   8545,   8739,   8932,   9126,   9319,
+      9511,   9703,   9895,  10087,  10278,  10469,  10659,  10849,
+     11038,  11227,  11416,  11604,  11792,  11980,  12166,  12353,
+     12539,  12724,  12909,  13094,  13278,  13462,  13645,  13827,
+     14009,  14191,  14372,  14552,  14732,  14911,  15090,  15268,
+     15446,  15623,  15799,  15975,  16150,  16325,  16499,  16672,
+     16845,  17017,  17189,  17360,  17530,  17699,  17868,  18036,
+     18204,  18371,  18537,  18702,  18867,  19031,  19194,  19357,
+     19519,  19680,  19840,  20000,  20159,  20317,  20474,  20631,
+     20787,  20942,  21096,  21249,  21402,  21554,  21705,  21855,
+     22004,  22153,  22301,  22448,  22594,  22739,  22883,  23027,
+     23169,  23311,  23452,  23592,  23731,  23869,  24006,  24143,
+     24278,  24413,  24546,  24679,  24811,  24942,  25072,  25201,
+     25329,  25456,  25582,  25707,  25831,  25954,  26077,  26198,
+     26318,  26437,  26556,  26673,  26789,  26905,  27019,  27132,
+     27244,  27355,  27466,  27575,  27683,  27790,  27896,  28001,
+     28105,  28208,  28309,  28410,  28510,  28608,  28706,  28802,
+     28897,  28992,  29085,  29177,  29268,  29358,  29446,  29534,
+     29621,  29706,  29790,  29873,  29955,  30036,  30116,  30195,
+     30272,  30349,  30424,  30498,  30571,  30643,  30713,  30783,
+     30851,  30918,  30984,  31049,  31113,  31175,  31236,  31297,
+     31356,  31413,  31470,  31525,  31580,  31633,  31684,  31735,
+     31785,  31833,  31880,  31926,  31970,  32014,  32056,  32097,
+     32137,  32176,  32213,  32249,  32284,  32318,  32350,  32382,
+     32412,  32441,  32468,  32495,  32520,  32544,  32567,  32588,
+     32609,  32628,  32646,  32662,  32678,  32692,  32705,  32717,
+     32727,  32736,  32744,  32751,  32757,  32761,  32764,  32766,
+     32767,  32766,  32764,  32761,  32757,  32751,  32744,  32736,
+     32727,  32717,  32705,  32692,  32678,  32662,  32646,  32628,
+     32609,  32588,  32567,  32544,  32520,  32495,  32468,  32441,
+     32412,  32382,  32350,  32318,  32284,  32249,  32213,  32176,
+     32137,  32097,  32056,  32014,  31970,  31926,  31880,  31833,
+     31785,  31735,  31684,  31633,  31580,  31525,  31470,  31413,
+     31356,  31297,  31236,  31175,  31113,  31049,  30984,  30918,
+     30851,  30783,  30713,  30643,  30571,  30498,  30424,  30349,
+     30272,  30195,  30116,  30036,  29955,  29873,  29790,  29706,
+     29621,  29534,  29446,  29358,  29268,  29177,  29085,  28992,
+     28897,  28802,  28706,  28608,  28510,  28410,  28309,  28208,
+     28105,  28001,  27896,  27790,  27683,  27575,  27466,  27355,
+     27244,  27132,  27019,  26905,  26789,  26673,  26556,  26437,
+     26318,  26198,  26077,  25954,  25831,  25707,  25582,  25456,
+     25329,  25201,  25072,  24942,  24811,  24679,  24546,  24413,
+     24278,  24143,  24006,  23869,  23731,  23592,  23452,  23311,
+     23169,  23027,  22883,  22739,  22594,  22448,  22301,  22153,
+     22004,  21855,  21705,  21554,  21402,  21249,  21096,  20942,
+     20787,  20631,  20474,  20317,  20159,  20000,  19840,  19680,
+     19519,  19357,  19194,  19031,  18867,  18702,  18537,  18371,
+     18204,  18036,  17868,  17699,  17530,  17360,  17189,  17017,
+     16845,  16672,  16499,  16325,  16150,  15975,  15799,  15623,
+     15446,  15268,  15090,  14911,  14732,  14552,  14372,  14191,
+     14009,  13827,  13645,  13462,  13278,  13094,  12909,  12724,
+     12539,  12353,  12166,  11980,  11792,  11604,  11416,  11227,
+     11038,  10849,  10659,  10469,  10278,  10087,   9895,   9703,
+      9511,   9319,   9126,   8932,   8739,   8545,   8351,   8156,
+      7961,   7766,   7571,   7375,   7179,   6982,   6786,   6589,
+      6392,   6195,   5997,   5799,   5601,   5403,   5205,   5006,
+      4807,   4608,   4409,   4210,   4011,   3811,   3611,   3411,
+      3211,   3011,   2811,   2610,   2410,   2209,   2009,   1808,
+      1607,   1406,   1206,   1005,    804,    603,    402,    201,
+         0,   -201,   -402,   -603,   -804,  -1005,  -1206,  -1406,
+     -1607,  -1808,  -2009,  -2209,  -2410,  -2610,  -2811,  -3011,
+     -3211,  -3411,  -3611,  -3811,  -4011,  -4210,  -4409,  -4608,
+     -4807,  -5006,  -5205,  -5403,  -5601,  -5799,  -5997,  -6195,
+     -6392,  -6589,  -6786,  -6982,  -7179,  -7375,  -7571,  -7766,
+     -7961,  -8156,  -8351,  -8545,  -8739,  -8932,  -9126,  -9319,
+     -9511,  -9703,  -9895, -10087, -10278, -10469, -10659, -10849,
+    -11038, -11227, -11416, -11604, -11792, -11980, -12166, -12353,
+    -12539, -12724, -12909, -13094, -13278, -13462, -13645, -13827,
+    -14009, -14191, -14372, -14552, -14732, -14911, -15090, -15268,
+    -15446, -15623, -15799, -15975, -16150, -16325, -16499, -16672,
+    -16845, -17017, -17189, -17360, -17530, -17699, -17868, -18036,
+    -18204, -18371, -18537, -18702, -18867, -19031, -19194, -19357,
+    -19519, -19680, -19840, -20000, -20159, -20317, -20474, -20631,
+    -20787, -20942, -21096, -21249, -21402, -21554, -21705, -21855,
+    -22004, -22153, -22301, -22448, -22594, -22739, -22883, -23027,
+    -23169, -23311, -23452, -23592, -23731, -23869, -24006, -24143,
+    -24278, -24413, -24546, -24679, -24811, -24942, -25072, -25201,
+    -25329, -25456, -25582, -25707, -25831, -25954, -26077, -26198,
+    -26318, -26437, -26556, -26673, -26789, -26905, -27019, -27132,
+    -27244, -27355, -27466, -27575, -27683, -27790, -27896, -28001,
+    -28105, -28208, -28309, -28410, -28510, -28608, -28706, -28802,
+    -28897, -28992, -29085, -29177, -29268, -29358, -29446, -29534,
+    -29621, -29706, -29790, -29873, -29955, -30036, -30116, -30195,
+    -30272, -30349, -30424, -30498, -30571, -30643, -30713, -30783,
+    -30851, -30918, -30984, -31049, -31113, -31175, -31236, -31297,
+    -31356, -31413, -31470, -31525, -31580, -31633, -31684, -31735,
+    -31785, -31833, -31880, -31926, -31970, -32014, -32056, -32097,
+    -32137, -32176, -32213, -32249, -32284, -32318, -32350, -32382,
+    -32412, -32441, -32468, -32495, -32520, -32544, -32567, -32588,
+    -32609, -32628, -32646, -32662, -32678, -32692, -32705, -32717,
+    -32727, -32736, -32744, -32751, -32757, -32761, -32764, -32766,
+    -32767, -32766, -32764, -32761, -32757, -32751, -32744, -32736,
+    -32727, -32717, -32705, -32692, -32678, -32662, -32646, -32628,
+    -32609, -32588, -32567, -32544, -32520, -32495, -32468, -32441,
+    -32412, -32382, -32350, -32318, -32284, -32249, -32213, -32176,
+    -32137, -32097, -32056, -32014, -31970, -31926, -31880, -31833,
+    -31785, -31735, -31684, -31633, -31580, -31525, -31470, -31413,
+    -31356, -31297, -31236, -31175, -31113, -31049, -30984, -30918,
+    -30851, -30783, -30713, -30643, -30571, -30498, -30424, -30349,
+    -30272, -30195, -30116, -30036, -29955, -29873, -29790, -29706,
+    -29621, -29534, -29446, -29358, -29268, -29177, -29085, -28992,
+    -28897, -28802, -28706, -28608, -28510, -28410, -28309, -28208,
+    -28105, -28001, -27896, -27790, -27683, -27575, -27466, -27355,
+    -27244, -27132, -27019, -26905, -26789, -26673, -26556, -26437,
+    -26318, -26198, -26077, -25954, -25831, -25707, -25582, -25456,
+    -25329, -25201, -25072, -24942, -24811, -24679, -24546, -24413,
+    -24278, -24143, -24006, -23869, -23731, -23592, -23452, -23311,
+    -23169, -23027, -22883, -22739, -22594, -22448, -22301, -22153,
+    -22004, -21855, -21705, -21554, -21402, -21249, -21096, -20942,
+    -20787, -20631, -20474, -20317, -20159, -20000, -19840, -19680,
+    -19519, -19357, -19194, -19031, -18867, -18702, -18537, -18371,
+    -18204, -18036, -17868, -17699, -17530, -17360, -17189, -17017,
+    -16845, -16672, -16499, -16325, -16150, -15975, -15799, -15623,
+    -15446, -15268, -15090, -14911, -14732, -14552, -14372, -14191,
+    -14009, -13827, -13645, -13462, -13278, -13094, -12909, -12724,
+    -12539, -12353, -12166, -11980, -11792, -11604, -11416, -11227,
+    -11038, -10849, -10659, -10469, -10278, -10087,  -9895,  -9703,
+     -9511,  -9319,  -9126,  -8932,  -8739,  -8545,  -8351,  -8156,
+     -7961,  -7766,  -7571,  -7375,  -7179,  -6982,  -6786,  -6589,
+     -6392,  -6195,  -5997,  -5799,  -5601,  -5403,  -5205,  -5006,
+     -4807,  -4608,  -4409,  -4210,  -4011,  -3811,  -3611,  -3411,
+     -3211,  -3011,  -2811,  -2610,  -2410,  -2209,  -2009,  -1808,
+     -1607,  -1406,  -1206,  -1005,   -804,   -603,   -402,   -201
+};
+
+void pjmedia_dsp_fft16_stage_c(pj_int16_t *frfi,
+			       const pjmedia_dsp_fft_stage *st)
+{
+    pj_int32_t rnd = st->out_rnd;
+    unsigned istep = st->l << 1;
+    unsigned i, j, m;
+
+    for (m=0; m<st->l; ++m) {
+	unsigned t = m << st->k;
+	pj_int32_t wr = pjmedia_dsp_sin_tbl[t + 256];
+	pj_int32_t wi = st->wi_sign * pjmedia_dsp_sin_tbl[t];
+
+	for (i=m; i<st->n; i+=istep) {
+	    pj_int32_t tr, ti, qr, qi;
+
+	    j = i + st->l;
+	    tr = (wr * frfi[2*j] - wi * frfi[2*j+1] + st->prod_rnd) >>
+		 st->prod_shift;
+	    ti = (wr * frfi[2*j+1] + wi * frfi[2*j] + st->prod_rnd) >>
+		 st->prod_shift;
+	    qr = (pj_int32_t)frfi[2*i] << st->q_shift;
+	    qi = (pj_int32_t)frfi[2*i+1] << st->q_shift;
+
+	    frfi[2*j]   = (pj_int16_t)((qr - tr + rnd) >> st->out_shift);
+	    frfi[2*j+1] = (pj_int16_t)((qi - ti + rnd) >> st->out_shift);
+	    frfi[2*i]   = (pj_int16_t)((qr + tr + rnd) >> st->out_shift);
+	    frfi[2*i+1] = (pj_int16_t)((qi + ti + rnd) >> st->out_shift);
+	}
+    }
+}
+
+static const pjmedia_dsp_ops dsp_c_ops =
+{
+    "c",
+    &pjmedia_dsp_inner_prod16_c,
+    &xcorr16_c,
+    &pjmedia_dsp_autocorr_f_c,
+    &pjmedia_dsp_fir_f_c,
+    &pjmedia_dsp_spectrum_mac_f_c,
+    &pjmedia_dsp_fft16_stage_c
+};
+
+
+/*
+ * CPU detection.
+ */
+#if DSP_HAS_SSE2 || DSP_HAS_AVX2
+static void dsp_cpuid(unsigned leaf, unsigned regs[4])
+{
+#if defined(_MSC_VER)
+    __cpuidex((int*)regs, leaf, 0);
+#else
+    regs[0] = regs[1] = regs[2] = regs[3] = 0;
+    if (leaf > __get_cpuid_max(0, 0))
+	return;
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+#endif
+
+#if DSP_HAS_AVX2
+static pj_bool_t dsp_os_has_avx(void)
+{
+    unsigned lo, hi;
+
+#if defined(_MSC_VER)
+    pj_uint64_t xcr0 = _xgetbv(0);
+    lo = (unsigned)xcr0;
+    hi = (unsigned)(xcr0 >> 32);
+#else
+    /* xgetbv, spelled out for assemblers that don't know it */
+    __asm__ volatile (".byte 0x0f, 0x01, 0xd0" : "=a"(lo), "=d"(hi) : "c"(0));
+#endif
+    PJ_UNUSED_ARG(hi);
+
+    /* XMM and YMM state enabled */
+    return (lo & 6) == 6;
+}
+#endif
+
+#if DSP_HAS_NEON && defined(__arm__) && defined(__linux__)
+static pj_bool_t dsp_cpuinfo_has_neon(void)
+{
+    char line[512];
+    FILE *f;
+    pj_bool_t found = PJ_FALSE;
+
+    f = fopen("/proc/cpuinfo", "r");
+    if (!f)
+	return PJ_FALSE;
+
+    while (!found && fgets(line, sizeof(line), f)) {
+	if (pj_ansi_strncmp(line, "Features", 8) == 0 &&
+	    pj_ansi_strstr(line, " neon"))
+	{
+	    found = PJ_TRUE;
+	}
+    }
+
+    fclose(f);
+    return found;
+}
+#endif
+
+static unsigned dsp_detect(void)
+{
+    unsigned features = 0;
+
+#if DSP_HAS_SSE2 || DSP_HAS_AVX2
+    {
+	unsigned regs[4];
+
+	dsp_cpuid(1, regs);
+#   if defined(__x86_64__) || defined(_M_X64)
+	features |= PJMEDIA_DSP_SSE2;
+#   else
+	if (regs[3] & (1 << 26))
+	    features |= PJMEDIA_DSP_SSE2;
+#   endif
+
+#   if DSP_HAS_AVX2
+	/* OSXSAVE and AVX, then AVX2 in leaf 7 */
+	if ((regs[2] & (1 << 27)) && (regs[2] & (1 << 28)) &&
+	    dsp_os_has_avx())
+	{
+	    dsp_cpuid(7, regs);
+	    if (regs[1] & (1 << 5))
+		features |= PJMEDIA_DSP_AVX2;
+	}
+#   endif
+    }
+#endif
+
+#if DSP_HAS_NEON
+#   if defined(__aarch64__) || !defined(__linux__)
+    features |= PJMEDIA_DSP_NEON;
+#   else
+    if (dsp_cpuinfo_has_neon())
+	features |= PJMEDIA_DSP_NEON;
+#   endif
+#endif
+
+    return features;
+}
+
+
+/*
+ * Dispatch.
+ */
+static unsigned dsp_features;
+static unsigned dsp_active;
+static const pjmedia_dsp_ops *dsp_ops;
+
+static const pjmedia_dsp_ops *dsp_select(unsigned features)
+{
+#if DSP_HAS_AVX2
+    /* The AVX2 kernels finish their tails with SSE2 */
+    if ((features & PJMEDIA_DSP_AVX2) && (features & PJMEDIA_DSP_SSE2))
+	return &pjmedia_dsp_avx2_ops;
+#endif
+#if DSP_HAS_SSE2
+    if (features & PJMEDIA_DSP_SSE2)
+	return &pjmedia_dsp_sse2_ops;
+#endif
+#if DSP_HAS_NEON
+    if (features & PJMEDIA_DSP_NEON)
+	return &pjmedia_dsp_neon_ops;
+#endif
+    PJ_UNUSED_ARG(features);
+    return &dsp_c_ops;
+}
+
+/* Selecting the implementation twice from two threads is harmless, both
+ * end up with the same pointer. This may run on codec threads that are
+ * not known to pjlib, so don't log here.
+ */
+static const pjmedia_dsp_ops *dsp_get_ops(void)
+{
+    if (dsp_ops == NULL) {
+	dsp_features = dsp_detect();
+	dsp_active = dsp_features;
+	dsp_ops = dsp_select(dsp_features);
+    }
+    return dsp_ops;
+}
+
+PJ_DEF(unsigned) pjmedia_dsp_get_features(void)
+{
+    dsp_get_ops();
+    return dsp_features;
+}
+
+PJ_DEF(unsigned) pjmedia_dsp_set_features(unsigned features)
+{
+    dsp_get_ops();
+    dsp_active = features & dsp_features;
+    dsp_ops = dsp_select(dsp_active);
+    return dsp_active;
+}
+
+PJ_DEF(const char*) pjmedia_dsp_get_impl_name(void)
+{
+    return dsp_get_ops()->name;
+}
+
+PJ_DEF(pj_int32_t) pjmedia_dsp_inner_prod16(const pj_int16_t *x,
+					    const pj_int16_t *y,
+					    unsigned len)
+{
+    return (*dsp_get_ops()->inner_prod16)(x, y, len);
+}
+
+PJ_DEF(void) pjmedia_dsp_xcorr16(const pj_int16_t *x,
+				 const pj_int16_t *y,
+				 pj_int32_t *xcorr,
+				 unsigned len,
+				 unsigned lag_cnt)
+{
+    (*dsp_get_ops()->xcorr16)(x, y, xcorr, len, lag_cnt);
+}
+
+PJ_DEF(void) pjmedia_dsp_autocorr_f(const float *x,
+				    float *ac,
+				    unsigned len,
+				    unsigned lag_cnt)
+{
+    pj_assert(lag_cnt <= len);
+    (*dsp_get_ops()->autocorr_f)(x, ac, len, lag_cnt);
+}
+
+PJ_DEF(void) pjmedia_dsp_fir_f(const float *x,
+			       const float *h,
+			       float *y,
+			       unsigned len,
+			       unsigned tap_cnt)
+{
+    (*dsp_get_ops()->fir_f)(x, h, y, len, tap_cnt);
+}
+
+PJ_DEF(void) pjmedia_dsp_spectrum_mac_f(const float *x,
+					const float *y,
+					float *acc,
+					unsigned len,
+					unsigned blk_cnt)
+{
+    pj_assert(len >= 2 && (len & 1) == 0);
+    (*dsp_get_ops()->spectrum_mac_f)(x, y, acc, len, blk_cnt);
+}
+
+/* The FFT drivers follow WebRtcSpl_ComplexFFT() and ComplexIFFT(), with
+ * the butterflies of each stage handed to the kernel.
+ */
+PJ_DEF(int) pjmedia_dsp_cfft16(pj_int16_t *frfi,
+			       unsigned stages,
+			       pj_bool_t precise)
+{
+    const pjmedia_dsp_ops *ops = dsp_get_ops();
+    pjmedia_dsp_fft_stage st;
+
+    if (stages > 10)
+	return -1;
+
+    st.n = 1 << stages;
+    st.wi_sign = -1;
+    if (precise) {
+	st.prod_rnd = 1;
+	st.prod_shift = 1;
+	st.q_shift = 14;
+	st.out_rnd = 16384;
+	st.out_shift = 15;
+    } else {
+	st.prod_rnd = 0;
+	st.prod_shift = 15;
+	st.q_shift = 0;
+	st.out_rnd = 0;
+	st.out_shift = 1;
+    }
+
+    for (st.l=1, st.k=9; st.l<st.n; st.l<<=1, --st.k)
+	(*ops->fft16_stage)(frfi, &st);
+
+    return 0;
+}
+
+static pj_int32_t max_abs16(const pj_int16_t *x, unsigned len)
+{
+    pj_int32_t max = 0;
+    unsigned i;
+
+    for (i=0; i<len; ++i) {
+	pj_int32_t v = x[i] < 0 ? -x[i] : x[i];
+	if (v > max)
+	    max = v;
+    }
+    return max;
+}
+
+PJ_DEF(int) pjmedia_dsp_cifft16(pj_int16_t *frfi,
+				unsigned stages,
+				pj_bool_t precise)
+{
+    const pjmedia_dsp_ops *ops = dsp_get_ops();
+    pjmedia_dsp_fft_stage st;
+    int scale = 0;
+
+    if (stages > 10)
+	return -1;
+
+    st.n = 1 << stages;
+    st.wi_sign = 1;
+
+    for (st.l=1, st.k=9; st.l<st.n; st.l<<=1, --st.k) {
+	pj_int32_t max = max_abs16(frfi, 2 * st.n);
+	unsigned shift = 0;
+
+	/* Scale down when the next stage could overflow */
+	if (max > 13573)
+	    ++shift;
+	if (max > 27146)
+	    ++shift;
+	scale += shift;
+
+	if (precise) {
+	    st.prod_rnd = 1;
+	    st.prod_shift = 1;
+	    st.q_shift = 14;
+	    st.out_rnd = 8192 << shift;
+	    st.out_shift = shift + 14;
+	} else {
+	    st.prod_rnd = 0;
+	    st.prod_shift = 15;
+	    st.q_shift = 0;
+	    st.out_rnd = 0;
+	    st.out_shift = shift;
+	}
+
+	(*ops->fft16_stage)(frfi, &st);
+    }
+
+    return scale;
+}
@@ -0,0 +1,137 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef __PJMEDIA_DSP_INTERNAL_H__
+#define __PJMEDIA_DSP_INTERNAL_H__
+
+#include <pjmedia/dsp.h>
+
+/*
+ * Which SIMD implementations can be compiled in. SSE2 is part of the
+ * x86-64 and Android x86 ABIs. AVX2 is compiled with a function target
+ * attribute, so it only needs a compiler that knows about it.
+ */
+#if PJMEDIA_HAS_DSP_SIMD && (defined(__SSE2__) || defined(_M_X64) || \
+			     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#   define DSP_HAS_SSE2	    1
+#else
+#   define DSP_HAS_SSE2	    0
+#endif
+
+#if DSP_HAS_SSE2 && (defined(__clang__) || \
+		     (defined(__GNUC__) && (__GNUC__ > 4 || \
+					    (__GNUC__==4 && __GNUC_MINOR__>=9))))
+#   define DSP_HAS_AVX2	    1
+#else
+#   define DSP_HAS_AVX2	    0
+#endif
+
+#if PJMEDIA_HAS_DSP_SIMD && PJMEDIA_DSP_HAS_NEON
+#   define DSP_HAS_NEON	    1
+#else
+#   define DSP_HAS_NEON	    0
+#endif
+
+/* The float kernels must round the product and the sum separately in
+ * every implementation, so don't let the compiler fuse them.
+ */
+#if defined(__clang__)
+#   pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__) && (__GNUC__ > 4 || \
+			    (__GNUC__==4 && __GNUC_MINOR__>=6))
+#   pragma GCC optimize ("fp-contract=off")
+#endif
+
+
+PJ_BEGIN_DECL
+
+/*
+ * One radix-2 stage of the fixed point complex FFT. The butterflies pair
+ * sample i with i+l, using the twiddle factor at table index m<<k where
+ * m = i mod l. The product of the twiddle factor and the second sample
+ * is rounded and shifted by prod_rnd/prod_shift, the first sample is
+ * shifted left by q_shift, and both sums are rounded and shifted right
+ * by out_rnd/out_shift before being truncated to 16 bits.
+ */
+typedef struct pjmedia_dsp_fft_stage
+{
+    unsigned	n;
+    unsigned	l;
+    unsigned	k;
+    int		wi_sign;
+    pj_int32_t	prod_rnd;
+    unsigned	prod_shift;
+    unsigned	q_shift;
+    pj_int32_t	out_rnd;
+    unsigned	out_shift;
+} pjmedia_dsp_fft_stage;
+
+/* Sine table of the WebRTC FFT, one full period in 1024 steps */
+extern const pj_int16_t pjmedia_dsp_sin_tbl[1024];
+
+/*
+ * Kernel implementation.
+ */
+typedef struct pjmedia_dsp_ops
+{
+    const char *name;
+
+    pj_int32_t (*inner_prod16)(const pj_int16_t *x, const pj_int16_t *y,
+			       unsigned len);
+    void (*xcorr16)(const pj_int16_t *x, const pj_int16_t *y,
+		    pj_int32_t *xcorr, unsigned len, unsigned lag_cnt);
+    void (*autocorr_f)(const float *x, float *ac, unsigned len,
+		       unsigned lag_cnt);
+    void (*fir_f)(const float *x, const float *h, float *y,
+		  unsigned len, unsigned tap_cnt);
+    void (*spectrum_mac_f)(const float *x, const float *y, float *acc,
+			   unsigned len, unsigned blk_cnt);
+    void (*fft16_stage)(pj_int16_t *frfi, const pjmedia_dsp_fft_stage *st);
+} pjmedia_dsp_ops;
+
+/* Scalar reference kernels, also used for the tails of SIMD kernels */
+pj_int32_t pjmedia_dsp_inner_prod16_c(const pj_int16_t *x,
+				      const pj_int16_t *y,
+				      unsigned len);
+void pjmedia_dsp_autocorr_f_c(const float *x, float *ac, unsigned len,
+			      unsigned lag_cnt);
+void pjmedia_dsp_fir_f_c(const float *x, const float *h, float *y,
+			 unsigned len, unsigned tap_cnt);
+void pjmedia_dsp_spectrum_mac_f_c(const float *x, const float *y,
+				  float *acc, unsigned len, unsigned blk_cnt);
+void pjmedia_dsp_spectrum_mac_tail_c(const float *x, const float *y,
+				     float *acc, unsigned len,
+				     unsigned blk_cnt, unsigned first);
+void pjmedia_dsp_fft16_stage_c(pj_int16_t *frfi,
+			       const pjmedia_dsp_fft_stage *st);
+
+#if DSP_HAS_SSE2
+extern const pjmedia_dsp_ops pjmedia_dsp_sse2_ops;
+#endif
+#if DSP_HAS_AVX2
+extern const pjmedia_dsp_ops pjmedia_dsp_avx2_ops;
+#endif
+#if DSP_HAS_NEON
+extern const pjmedia_dsp_ops pjmedia_dsp_neon_ops;
+#endif
+
+PJ_END_DECL
+
+
+#endif	/* __PJMEDIA_DSP_INTERNAL_H__ */
@@ -0,0 +1,256 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "dsp_internal.h"
+
+/*
+ * NEON kernels.
+ *
+ * The products are added with separate multiply and add instructions so
+ * that no fused multiply-add is used. Note that ARMv7 NEON always flushes
+ * subnormal floats to zero, which the VFP scalar code does not.
+ */
+#if DSP_HAS_NEON
+
+#include <arm_neon.h>
+
+
+static pj_int32_t hsum_s32(int32x4_t v)
+{
+    int32x2_t s = vadd_s32(vget_low_s32(v), vget_high_s32(v));
+    s = vpadd_s32(s, s);
+    return vget_lane_s32(s, 0);
+}
+
+static pj_int32_t add_wrap(pj_int32_t a, pj_int32_t b)
+{
+    return (pj_int32_t)((pj_uint32_t)a + (pj_uint32_t)b);
+}
+
+static int32x4_t mac8(int32x4_t acc, int16x8_t a, int16x8_t b)
+{
+    acc = vmlal_s16(acc, vget_low_s16(a), vget_low_s16(b));
+    return vmlal_s16(acc, vget_high_s16(a), vget_high_s16(b));
+}
+
+static pj_int32_t inner_prod16_neon(const pj_int16_t *x,
+				    const pj_int16_t *y,
+				    unsigned len)
+{
+    int32x4_t acc = vdupq_n_s32(0);
+    unsigned i;
+
+    for (i=0; i+8<=len; i+=8)
+	acc = mac8(acc, vld1q_s16(x+i), vld1q_s16(y+i));
+
+    return add_wrap(hsum_s32(acc),
+		    pjmedia_dsp_inner_prod16_c(x+i, y+i, len-i));
+}
+
+static void xcorr16_neon(const pj_int16_t *x, const pj_int16_t *y,
+			 pj_int32_t *xcorr, unsigned len, unsigned lag_cnt)
+{
+    unsigned i, k;
+
+    /* Four lags at a time, sharing the loads of x */
+    for (k=0; k+4<=lag_cnt; k+=4) {
+	int32x4_t a0 = vdupq_n_s32(0), a1 = vdupq_n_s32(0);
+	int32x4_t a2 = vdupq_n_s32(0), a3 = vdupq_n_s32(0);
+	const pj_int16_t *yk = y + k;
+
+	for (i=0; i+8<=len; i+=8) {
+	    int16x8_t vx = vld1q_s16(x+i);
+	    a0 = mac8(a0, vx, vld1q_s16(yk+i));
+	    a1 = mac8(a1, vx, vld1q_s16(yk+i+1));
+	    a2 = mac8(a2, vx, vld1q_s16(yk+i+2));
+	    a3 = mac8(a3, vx, vld1q_s16(yk+i+3));
+	}
+
+	xcorr[k]   = add_wrap(hsum_s32(a0),
+		       pjmedia_dsp_inner_prod16_c(x+i, yk+i, len-i));
+	xcorr[k+1] = add_wrap(hsum_s32(a1),
+		       pjmedia_dsp_inner_prod16_c(x+i, yk+i+1, len-i));
+	xcorr[k+2] = add_wrap(hsum_s32(a2),
+		       pjmedia_dsp_inner_prod16_c(x+i, yk+i+2, len-i));
+	xcorr[k+3] = add_wrap(hsum_s32(a3),
+		       pjmedia_dsp_inner_prod16_c(x+i, yk+i+3, len-i));
+    }
+
+    for (; k<lag_cnt; ++k)
+	xcorr[k] = inner_prod16_neon(x, y+k, len);
+}
+
+/* Lanes hold lags k..k+3. The vector loop runs while all four lags have
+ * samples left, then each lag finishes on its own.
+ */
+static void autocorr_f_neon(const float *x, float *ac, unsigned len,
+			    unsigned lag_cnt)
+{
+    unsigned i, j, k;
+
+    for (k=0; k+4<=lag_cnt && k+4<=len; k+=4) {
+	float32x4_t acc = vdupq_n_f32(0);
+	float sum[4];
+	unsigned n = len - k - 3;
+
+	for (i=0; i<n; ++i) {
+	    acc = vaddq_f32(acc, vmulq_f32(vdupq_n_f32(x[i]),
+					   vld1q_f32(x+i+k)));
+	}
+	vst1q_f32(sum, acc);
+
+	for (j=0; j<4; ++j) {
+	    for (i=n; i<len-k-j; ++i)
+		sum[j] += x[i] * x[i+k+j];
+	    ac[k+j] = sum[j];
+	}
+    }
+
+    for (; k<lag_cnt; ++k) {
+	float sum = 0;
+	for (i=0; i<len-k; ++i)
+	    sum += x[i] * x[i+k];
+	ac[k] = sum;
+    }
+}
+
+/* Lanes hold four consecutive outputs */
+static void fir_f_neon(const float *x, const float *h, float *y,
+		       unsigned len, unsigned tap_cnt)
+{
+    unsigned n, k;
+
+    for (n=0; n+4<=len; n+=4) {
+	float32x4_t acc = vdupq_n_f32(0);
+	for (k=0; k<tap_cnt; ++k) {
+	    acc = vaddq_f32(acc, vmulq_f32(vld1q_f32(x+n+k),
+					   vdupq_n_f32(h[k])));
+	}
+	vst1q_f32(y+n, acc);
+    }
+
+    pjmedia_dsp_fir_f_c(x+n, h, y+n, len-n, tap_cnt);
+}
+
+/* Lanes hold the real and imaginary parts of two bins. The imaginary
+ * products are swapped in and the real ones negated, so each lane adds
+ * the same two products as the scalar code.
+ */
+static void spectrum_mac_f_neon(const float *x, const float *y, float *acc,
+				unsigned len, unsigned blk_cnt)
+{
+    static const pj_uint32_t neg_re_mask[4] = { 0x80000000, 0,
+						0x80000000, 0 };
+    const uint32x4_t neg_re = vld1q_u32(neg_re_mask);
+    unsigned i, b;
+
+    for (i=1; i+4<len; i+=4) {
+	float32x4_t sum = vdupq_n_f32(0);
+
+	for (b=0; b<blk_cnt; ++b) {
+	    float32x4_t vx = vld1q_f32(x + b*len + i);
+	    float32x4_t vy = vld1q_f32(y + b*len + i);
+	    float32x4x2_t yy = vtrnq_f32(vy, vy);
+	    float32x4_t p = vmulq_f32(vx, yy.val[0]);
+	    float32x4_t q = vmulq_f32(vrev64q_f32(vx), yy.val[1]);
+
+	    q = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(q),
+						neg_re));
+	    sum = vaddq_f32(sum, vaddq_f32(p, q));
+	}
+	vst1q_f32(acc+i, sum);
+    }
+
+    pjmedia_dsp_spectrum_mac_tail_c(x, y, acc, len, blk_cnt, i);
+}
+
+/* Lanes hold four butterflies, with the real and imaginary parts
+ * separated by the structure loads. The narrowing moves truncate to 16
+ * bits like the scalar casts.
+ */
+static void fft16_stage_neon(pj_int16_t *frfi,
+			     const pjmedia_dsp_fft_stage *st)
+{
+    const int32x4_t prod_rnd = vdupq_n_s32(st->prod_rnd);
+    const int32x4_t out_rnd = vdupq_n_s32(st->out_rnd);
+    const int32x4_t prod_shift = vdupq_n_s32(-(int)st->prod_shift);
+    const int32x4_t q_shift = vdupq_n_s32(st->q_shift);
+    const int32x4_t out_shift = vdupq_n_s32(-(int)st->out_shift);
+    unsigned istep = st->l << 1;
+    unsigned i, m, c;
+
+    if (st->l < 4) {
+	pjmedia_dsp_fft16_stage_c(frfi, st);
+	return;
+    }
+
+    for (m=0; m<st->l; m+=4) {
+	pj_int16_t w[8];
+	int16x4_t wr, wi;
+
+	for (c=0; c<4; ++c) {
+	    unsigned t = (m + c) << st->k;
+	    w[c] = pjmedia_dsp_sin_tbl[t + 256];
+	    w[4+c] = (pj_int16_t)(st->wi_sign * pjmedia_dsp_sin_tbl[t]);
+	}
+	wr = vld1_s16(w);
+	wi = vld1_s16(w+4);
+
+	for (i=m; i<st->n; i+=istep) {
+	    pj_int16_t *pi = frfi + 2*i;
+	    pj_int16_t *pj = frfi + 2*(i + st->l);
+	    int16x4x2_t x = vld2_s16(pj);
+	    int16x4x2_t q = vld2_s16(pi);
+	    int32x4_t tr, ti, qr, qi;
+	    int16x4x2_t out;
+
+	    tr = vmlsl_s16(vmull_s16(wr, x.val[0]), wi, x.val[1]);
+	    ti = vmlal_s16(vmull_s16(wr, x.val[1]), wi, x.val[0]);
+	    tr = vshlq_s32(vaddq_s32(tr, prod_rnd), prod_shift);
+	    ti = vshlq_s32(vaddq_s32(ti, prod_rnd), prod_shift);
+	    qr = vshlq_s32(vmovl_s16(q.val[0]), q_shift);
+	    qi = vshlq_s32(vmovl_s16(q.val[1]), q_shift);
+
+	    out.val[0] = vmovn_s32(vshlq_s32(vaddq_s32(vsubq_s32(qr, tr),
+						       out_rnd), out_shift));
+	    out.val[1] = vmovn_s32(vshlq_s32(vaddq_s32(vsubq_s32(qi, ti),
+						       out_rnd), out_shift));
+	    vst2_s16(pj, out);
+
+	    out.val[0] = vmovn_s32(vshlq_s32(vaddq_s32(vaddq_s32(qr, tr),
+						       out_rnd), out_shift));
+	    out.val[1] = vmovn_s32(vshlq_s32(vaddq_s32(vaddq_s32(qi, ti),
+						       out_rnd), out_shift));
+	    vst2_s16(pi, out);
+	}
+    }
+}
+
+const pjmedia_dsp_ops pjmedia_dsp_neon_ops =
+{
+    "neon",
+    &inner_prod16_neon,
+    &xcorr16_neon,
+    &autocorr_f_neon,
+    &fir_f_neon,
+    &spectrum_mac_f_neon,
+    &fft16_stage_neon
+};
+
+#endif	/* DSP_HAS_NEON */
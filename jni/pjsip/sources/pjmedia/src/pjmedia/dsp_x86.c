@@ -0,0 +1,447 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "dsp_internal.h"
+
+/*
+ * SSE2 and AVX2 kernels.
+ *
+ * The 16-bit kernels use pmaddwd, whose pairwise sums wrap in the same
+ * way as the scalar 32-bit accumulation. The float kernels keep one
+ * output per lane and add the products in the scalar order, so they
+ * match the reference as long as the scalar code uses SSE math too
+ * (x87 keeps extended precision intermediates).
+ */
+#if DSP_HAS_SSE2
+
+#include <emmintrin.h>
+#if DSP_HAS_AVX2
+#   include <immintrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE_MATH__)
+#   define DSP_X86_FLOAT    1
+#else
+#   define DSP_X86_FLOAT    0
+#endif
+
+
+static pj_int32_t hsum_epi32(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1,0,3,2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2,3,0,1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+static pj_int32_t add_wrap(pj_int32_t a, pj_int32_t b)
+{
+    return (pj_int32_t)((pj_uint32_t)a + (pj_uint32_t)b);
+}
+
+
+/*
+ * SSE2
+ */
+static pj_int32_t inner_prod16_sse2(const pj_int16_t *x,
+				    const pj_int16_t *y,
+				    unsigned len)
+{
+    __m128i acc = _mm_setzero_si128();
+    unsigned i;
+
+    for (i=0; i+8<=len; i+=8) {
+	__m128i vx = _mm_loadu_si128((const __m128i*)(x+i));
+	__m128i vy = _mm_loadu_si128((const __m128i*)(y+i));
+	acc = _mm_add_epi32(acc, _mm_madd_epi16(vx, vy));
+    }
+
+    return add_wrap(hsum_epi32(acc),
+		    pjmedia_dsp_inner_prod16_c(x+i, y+i, len-i));
+}
+
+static void xcorr16_sse2(const pj_int16_t *x, const pj_int16_t *y,
+			 pj_int32_t *xcorr, unsigned len, unsigned lag_cnt)
+{
+    unsigned i, k;
+
+    /* Four lags at a time, sharing the loads of x */
+    for (k=0; k+4<=lag_cnt; k+=4) {
+	__m128i a0 = _mm_setzero_si128(), a1 = _mm_setzero_si128();
+	__m128i a2 = _mm_setzero_si128(), a3 = _mm_setzero_si128();
+	const pj_int16_t *yk = y + k;
+
+	for (i=0; i+8<=len; i+=8) {
+	    __m128i vx = _mm_loadu_si128((const __m128i*)(x+i));
+	    a0 = _mm_add_epi32(a0, _mm_madd_epi16(vx,
+			_mm_loadu_si128((const __m128i*)(yk+i))));
+	    a1 = _mm_add_epi32(a1, _mm_madd_epi16(vx,
+			_mm_loadu_si128((const __m128i*)(yk+i+1))));
+	    a2 = _mm_add_epi32(a2, _mm_madd_epi16(vx,
+			_mm_loadu_si128((const __m128i*)(yk+i+2))));
+	    a3 = _mm_add_epi32(a3, _mm_madd_epi16(vx,
+			_mm_loadu_si128((const __m128i*)(yk+i+3))));
+	}
+
+	xcorr[k]   = add_wrap(hsum_epi32(a0),
+		       pjmedia_dsp_inner_prod16_c(x+i, yk+i, len-i));
+	xcorr[k+1] = add_wrap(hsum_epi32(a1),
+		       pjmedia_dsp_inner_prod16_c(x+i, yk+i+1, len-i));
+	xcorr[k+2] = add_wrap(hsum_epi32(a2),
+		       pjmedia_dsp_inner_prod16_c(x+i, yk+i+2, len-i));
+	xcorr[k+3] = add_wrap(hsum_epi32(a3),
+		       pjmedia_dsp_inner_prod16_c(x+i, yk+i+3, len-i));
+    }
+
+    for (; k<lag_cnt; ++k)
+	xcorr[k] = inner_prod16_sse2(x, y+k, len);
+}
+
+#if DSP_X86_FLOAT
+static void autocorr_lags_c(const float *x, float *ac, unsigned len,
+			    unsigned k, unsigned lag_cnt)
+{
+    unsigned i;
+
+    for (; k<lag_cnt; ++k) {
+	float sum = 0;
+	for (i=0; i<len-k; ++i)
+	    sum += x[i] * x[i+k];
+	ac[k] = sum;
+    }
+}
+
+/* Lanes hold lags k..k+3. The vector loop runs while all four lags have
+ * samples left, then each lag finishes on its own.
+ */
+static void autocorr_lags_sse2(const float *x, float *ac, unsigned len,
+			       unsigned k, unsigned lag_cnt)
+{
+    unsigned i, j;
+
+    for (; k+4<=lag_cnt && k+4<=len; k+=4) {
+	__m128 acc = _mm_setzero_ps();
+	float sum[4];
+	unsigned n = len - k - 3;
+
+	for (i=0; i<n; ++i) {
+	    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(x[i]),
+					     _mm_loadu_ps(x+i+k)));
+	}
+	_mm_storeu_ps(sum, acc);
+
+	for (j=0; j<4; ++j) {
+	    for (i=n; i<len-k-j; ++i)
+		sum[j] += x[i] * x[i+k+j];
+	    ac[k+j] = sum[j];
+	}
+    }
+
+    autocorr_lags_c(x, ac, len, k, lag_cnt);
+}
+
+static void autocorr_f_sse2(const float *x, float *ac, unsigned len,
+			    unsigned lag_cnt)
+{
+    autocorr_lags_sse2(x, ac, len, 0, lag_cnt);
+}
+
+/* Lanes hold four consecutive outputs */
+static void fir_f_sse2(const float *x, const float *h, float *y,
+		       unsigned len, unsigned tap_cnt)
+{
+    unsigned n, k;
+
+    for (n=0; n+4<=len; n+=4) {
+	__m128 acc = _mm_setzero_ps();
+	for (k=0; k<tap_cnt; ++k) {
+	    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x+n+k),
+					     _mm_set1_ps(h[k])));
+	}
+	_mm_storeu_ps(y+n, acc);
+    }
+
+    pjmedia_dsp_fir_f_c(x+n, h, y+n, len-n, tap_cnt);
+}
+
+/* Lanes hold the real and imaginary parts of two bins. The imaginary
+ * products are swapped in and the real ones negated, so each lane adds
+ * the same two products as the scalar code.
+ */
+static void spectrum_mac_f_sse2(const float *x, const float *y, float *acc,
+				unsigned len, unsigned blk_cnt)
+{
+    const __m128 neg_re = _mm_castsi128_ps(_mm_set_epi32(0, (int)0x80000000,
+							  0, (int)0x80000000));
+    unsigned i, b;
+
+    for (i=1; i+4<len; i+=4) {
+	__m128 sum = _mm_setzero_ps();
+
+	for (b=0; b<blk_cnt; ++b) {
+	    __m128 vx = _mm_loadu_ps(x + b*len + i);
+	    __m128 vy = _mm_loadu_ps(y + b*len + i);
+	    __m128 yr = _mm_shuffle_ps(vy, vy, _MM_SHUFFLE(2,2,0,0));
+	    __m128 yi = _mm_shuffle_ps(vy, vy, _MM_SHUFFLE(3,3,1,1));
+	    __m128 xs = _mm_shuffle_ps(vx, vx, _MM_SHUFFLE(2,3,0,1));
+	    __m128 p = _mm_mul_ps(vx, yr);
+	    __m128 q = _mm_xor_ps(_mm_mul_ps(xs, yi), neg_re);
+
+	    sum = _mm_add_ps(sum, _mm_add_ps(p, q));
+	}
+	_mm_storeu_ps(acc+i, sum);
+    }
+
+    pjmedia_dsp_spectrum_mac_tail_c(x, y, acc, len, blk_cnt, i);
+}
+#endif	/* DSP_X86_FLOAT */
+
+/* Lanes hold four butterflies. pmaddwd computes both complex products
+ * from the interleaved samples, and the outputs are truncated to 16 bits
+ * by masking rather than with a saturating pack.
+ */
+static void fft16_stage_sse2(pj_int16_t *frfi,
+			     const pjmedia_dsp_fft_stage *st)
+{
+    const __m128i prod_rnd = _mm_set1_epi32(st->prod_rnd);
+    const __m128i out_rnd = _mm_set1_epi32(st->out_rnd);
+    const __m128i prod_shift = _mm_cvtsi32_si128(st->prod_shift);
+    const __m128i q_shift = _mm_cvtsi32_si128(st->q_shift);
+    const __m128i out_shift = _mm_cvtsi32_si128(st->out_shift);
+    const __m128i lo16 = _mm_set1_epi32(0xFFFF);
+    unsigned istep = st->l << 1;
+    unsigned i, m, c;
+
+    if (st->l < 4) {
+	pjmedia_dsp_fft16_stage_c(frfi, st);
+	return;
+    }
+
+    for (m=0; m<st->l; m+=4) {
+	pj_int16_t w[16];
+	__m128i wa, wb;
+
+	/* (wr, -wi) pairs give the real part, (wi, wr) the imaginary */
+	for (c=0; c<4; ++c) {
+	    unsigned t = (m + c) << st->k;
+	    pj_int16_t wr = pjmedia_dsp_sin_tbl[t + 256];
+	    pj_int16_t wi = (pj_int16_t)(st->wi_sign * pjmedia_dsp_sin_tbl[t]);
+
+	    w[2*c] = wr;
+	    w[2*c+1] = (pj_int16_t)-wi;
+	    w[8+2*c] = wi;
+	    w[8+2*c+1] = wr;
+	}
+	wa = _mm_loadu_si128((const __m128i*)w);
+	wb = _mm_loadu_si128((const __m128i*)(w+8));
+
+	for (i=m; i<st->n; i+=istep) {
+	    pj_int16_t *pi = frfi + 2*i;
+	    pj_int16_t *pj = frfi + 2*(i + st->l);
+	    __m128i x = _mm_loadu_si128((const __m128i*)pj);
+	    __m128i q = _mm_loadu_si128((const __m128i*)pi);
+	    __m128i tr, ti, qr, qi, r, im;
+
+	    tr = _mm_sra_epi32(_mm_add_epi32(_mm_madd_epi16(x, wa), prod_rnd),
+			       prod_shift);
+	    ti = _mm_sra_epi32(_mm_add_epi32(_mm_madd_epi16(x, wb), prod_rnd),
+			       prod_shift);
+	    qr = _mm_sll_epi32(_mm_srai_epi32(_mm_slli_epi32(q, 16), 16),
+			       q_shift);
+	    qi = _mm_sll_epi32(_mm_srai_epi32(q, 16), q_shift);
+
+	    r = _mm_sra_epi32(_mm_add_epi32(_mm_sub_epi32(qr, tr), out_rnd),
+			      out_shift);
+	    im = _mm_sra_epi32(_mm_add_epi32(_mm_sub_epi32(qi, ti), out_rnd),
+			       out_shift);
+	    _mm_storeu_si128((__m128i*)pj,
+			     _mm_or_si128(_mm_and_si128(r, lo16),
+					  _mm_slli_epi32(im, 16)));
+
+	    r = _mm_sra_epi32(_mm_add_epi32(_mm_add_epi32(qr, tr), out_rnd),
+			      out_shift);
+	    im = _mm_sra_epi32(_mm_add_epi32(_mm_add_epi32(qi, ti), out_rnd),
+			       out_shift);
+	    _mm_storeu_si128((__m128i*)pi,
+			     _mm_or_si128(_mm_and_si128(r, lo16),
+					  _mm_slli_epi32(im, 16)));
+	}
+    }
+}
+
+const pjmedia_dsp_ops pjmedia_dsp_sse2_ops =
+{
+    "sse2",
+    &inner_prod16_sse2,
+    &xcorr16_sse2,
+#if DSP_X86_FLOAT
+    &autocorr_f_sse2,
+    &fir_f_sse2,
+    &spectrum_mac_f_sse2,
+#else
+    &pjmedia_dsp_autocorr_f_c,
+    &pjmedia_dsp_fir_f_c,
+    &pjmedia_dsp_spectrum_mac_f_c,
+#endif
+    &fft16_stage_sse2
+};
+
+
+/*
+ * AVX2
+ */
+#if DSP_HAS_AVX2
+
+#define AVX2	__attribute__((target("avx2")))
+
+/* The AVX2 kernels clear the upper halves of the YMM registers before
+ * falling back to SSE code for the tails, otherwise every SSE instruction
+ * that follows, in here or in the codec, pays a state transition penalty.
+ */
+
+AVX2 static pj_int32_t hsum256_epi32(__m256i v)
+{
+    return hsum_epi32(_mm_add_epi32(_mm256_castsi256_si128(v),
+				    _mm256_extracti128_si256(v, 1)));
+}
+
+AVX2 static pj_int32_t inner_prod16_avx2(const pj_int16_t *x,
+					 const pj_int16_t *y,
+					 unsigned len)
+{
+    __m256i acc = _mm256_setzero_si256();
+    pj_int32_t sum;
+    unsigned i;
+
+    for (i=0; i+16<=len; i+=16) {
+	__m256i vx = _mm256_loadu_si256((const __m256i*)(x+i));
+	__m256i vy = _mm256_loadu_si256((const __m256i*)(y+i));
+	acc = _mm256_add_epi32(acc, _mm256_madd_epi16(vx, vy));
+    }
+    sum = hsum256_epi32(acc);
+    _mm256_zeroupper();
+
+    return add_wrap(sum, inner_prod16_sse2(x+i, y+i, len-i));
+}
+
+AVX2 static void xcorr16_avx2(const pj_int16_t *x, const pj_int16_t *y,
+			      pj_int32_t *xcorr, unsigned len,
+			      unsigned lag_cnt)
+{
+    unsigned i, j, k;
+
+    for (k=0; k+4<=lag_cnt; k+=4) {
+	__m256i a0 = _mm256_setzero_si256(), a1 = _mm256_setzero_si256();
+	__m256i a2 = _mm256_setzero_si256(), a3 = _mm256_setzero_si256();
+	const pj_int16_t *yk = y + k;
+
+	for (i=0; i+16<=len; i+=16) {
+	    __m256i vx = _mm256_loadu_si256((const __m256i*)(x+i));
+	    a0 = _mm256_add_epi32(a0, _mm256_madd_epi16(vx,
+			_mm256_loadu_si256((const __m256i*)(yk+i))));
+	    a1 = _mm256_add_epi32(a1, _mm256_madd_epi16(vx,
+			_mm256_loadu_si256((const __m256i*)(yk+i+1))));
+	    a2 = _mm256_add_epi32(a2, _mm256_madd_epi16(vx,
+			_mm256_loadu_si256((const __m256i*)(yk+i+2))));
+	    a3 = _mm256_add_epi32(a3, _mm256_madd_epi16(vx,
+			_mm256_loadu_si256((const __m256i*)(yk+i+3))));
+	}
+
+	xcorr[k]   = hsum256_epi32(a0);
+	xcorr[k+1] = hsum256_epi32(a1);
+	xcorr[k+2] = hsum256_epi32(a2);
+	xcorr[k+3] = hsum256_epi32(a3);
+	_mm256_zeroupper();
+
+	for (j=0; j<4; ++j) {
+	    xcorr[k+j] = add_wrap(xcorr[k+j],
+		pjmedia_dsp_inner_prod16_c(x+i, yk+i+j, len-i));
+	}
+    }
+
+    for (; k<lag_cnt; ++k)
+	xcorr[k] = inner_prod16_avx2(x, y+k, len);
+}
+
+#if DSP_X86_FLOAT
+AVX2 static void autocorr_f_avx2(const float *x, float *ac, unsigned len,
+				 unsigned lag_cnt)
+{
+    unsigned i, j, k;
+
+    for (k=0; k+8<=lag_cnt && k+8<=len; k+=8) {
+	__m256 acc = _mm256_setzero_ps();
+	float sum[8];
+	unsigned n = len - k - 7;
+
+	for (i=0; i<n; ++i) {
+	    acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(x[i]),
+						   _mm256_loadu_ps(x+i+k)));
+	}
+	_mm256_storeu_ps(sum, acc);
+	_mm256_zeroupper();
+
+	for (j=0; j<8; ++j) {
+	    for (i=n; i<len-k-j; ++i)
+		sum[j] += x[i] * x[i+k+j];
+	    ac[k+j] = sum[j];
+	}
+    }
+
+    autocorr_lags_sse2(x, ac, len, k, lag_cnt);
+}
+
+AVX2 static void fir_f_avx2(const float *x, const float *h, float *y,
+			    unsigned len, unsigned tap_cnt)
+{
+    unsigned n, k;
+
+    for (n=0; n+8<=len; n+=8) {
+	__m256 acc = _mm256_setzero_ps();
+	for (k=0; k<tap_cnt; ++k) {
+	    acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(x+n+k),
+						   _mm256_set1_ps(h[k])));
+	}
+	_mm256_storeu_ps(y+n, acc);
+    }
+    _mm256_zeroupper();
+
+    fir_f_sse2(x+n, h, y+n, len-n, tap_cnt);
+}
+#endif	/* DSP_X86_FLOAT */
+
+const pjmedia_dsp_ops pjmedia_dsp_avx2_ops =
+{
+    "avx2",
+    &inner_prod16_avx2,
+    &xcorr16_avx2,
+#if DSP_X86_FLOAT
+    &autocorr_f_avx2,
+    &fir_f_avx2,
+    &spectrum_mac_f_sse2,
+#else
+    &pjmedia_dsp_autocorr_f_c,
+    &pjmedia_dsp_fir_f_c,
+    &pjmedia_dsp_spectrum_mac_f_c,
+#endif
+    &fft16_stage_sse2
+};
+
+#endif	/* DSP_HAS_AVX2 */
+
+#endif	/* DSP_HAS_SSE2 */
@@ -35,6 +35,14 @@
 #define PJMEDIA_WEBRTC_USE_NS PJ_FALSE
 #endif
 
+#ifndef PJMEDIA_WEBRTC_USE_AGC
+#define PJMEDIA_WEBRTC_USE_AGC PJ_FALSE
+#endif
+
+#ifndef PJMEDIA_WEBRTC_USE_HPF
+#define PJMEDIA_WEBRTC_USE_HPF PJ_FALSE
+#endif
+
 #ifndef PJMEDIA_WEBRTC_AEC_AGGRESSIVENESS
     #define PJMEDIA_WEBRTC_AEC_AGGRESSIVENESS kAecNlpModerate
 #endif
@@ -43,6 +51,16 @@
     #define PJMEDIA_WEBRTC_NS_POLICY 0
 #endif
 
+/* Target level of the gain controller, in -dBOv */
+#ifndef PJMEDIA_WEBRTC_AGC_TARGET_LEVEL
+    #define PJMEDIA_WEBRTC_AGC_TARGET_LEVEL 3
+#endif
+
+/* Maximum gain the gain controller may apply, in dB */
+#ifndef PJMEDIA_WEBRTC_AGC_COMPRESSION_GAIN
+    #define PJMEDIA_WEBRTC_AGC_COMPRESSION_GAIN 9
+#endif
+
 
 #define THIS_FILE    "echo_webrtc_aec.c"
 
@@ -53,6 +71,8 @@
 #define W_WebRtcAec_get_error_code WebRtcAecm_get_error_code
 #define W_WebRtcAec_Init(INST, CR) WebRtcAecm_Init(INST, CR)
 #define W_WebRtcAec_BufferFarend WebRtcAecm_BufferFarend
+/* AECM only runs up to 16kHz, so at 32kHz it gets the lower band */
+#define W_WEBRTC_AEC_MAX_RATE 16000
 #else
 #include <modules/audio_processing/aec/include/echo_cancellation.h>
 #define W_WebRtcAec_Create WebRtcAec_Create
@@ -60,35 +80,176 @@
 #define W_WebRtcAec_get_error_code WebRtcAec_get_error_code
 #define W_WebRtcAec_Init(INST, CR) WebRtcAec_Init(INST, CR, CR)
 #define W_WebRtcAec_BufferFarend WebRtcAec_BufferFarend
+#define W_WEBRTC_AEC_MAX_RATE 32000
 #endif
 
 #include <modules/audio_processing/ns/include/noise_suppression_x.h>
+#include <modules/audio_processing/agc/include/gain_control.h>
+#include <common_audio/signal_processing/include/signal_processing_library.h>
 
 #include "echo_internal.h"
 
 
 
 pj_bool_t pjmedia_webrtc_use_ns = PJMEDIA_WEBRTC_USE_NS;
+pj_bool_t pjmedia_webrtc_use_agc = PJMEDIA_WEBRTC_USE_AGC;
 
+/*
+ * All enabled stages run in one pass over each 10ms block, in the order
+ * of the WebRTC audio processing module: high-pass filter, AGC analysis,
+ * AEC, noise suppression, AECM, then AGC gain. At 32kHz the block is
+ * split once into a 0-8kHz and a 8-16kHz band which every stage shares,
+ * and recombined at the end. Otherwise the stages work in place on the
+ * captured frame.
+ */
 typedef struct webrtc_ec
 {
 	void*		AEC_inst;
     NsxHandle*	NS_inst;
+    void*	AGC_inst;
     unsigned	samples_per_frame;
     unsigned	echo_tail;
     unsigned	echo_skew;
     unsigned   clock_rate;
     unsigned 	blockLen10ms;
-    pj_int16_t*	tmp_frame;
-    pj_int16_t*	tmp_frame2;
+
+    /* Band split, only at 32kHz */
+    pj_bool_t	split;
+    unsigned	band_len;
+    WebRtc_Word32 rec_analysis_state[2][6];
+    WebRtc_Word32 rec_synthesis_state[2][6];
+    WebRtc_Word32 play_analysis_state[2][6];
+    pj_int16_t*	rec_low;
+    pj_int16_t*	rec_high;
+    pj_int16_t*	play_low;
+    pj_int16_t*	play_high;
+
+    /* Lower band before noise suppression, for AECM */
+    pj_int16_t*	aecm_ref;
+
+    /* High-pass filter, see high_pass_filter_impl.cc */
+    pj_bool_t	hpf_enabled;
+    const pj_int16_t *hpf_ba;
+    pj_int16_t	hpf_x[2];
+    pj_int16_t	hpf_y[4];
+
+    /* Microphone level of the gain controller */
+    WebRtc_Word32 agc_level;
 } webrtc_ec;
 
 
+static const pj_int16_t hpf_coef_8khz[5] = {3798, -7596, 3798, 7807, -3733};
+static const pj_int16_t hpf_coef[5] = {4012, -8024, 4012, 8002, -3913};
+
+
 static void print_webrtc_aec_error(const char* tag, void *AEC_inst) {
 	unsigned status = W_WebRtcAec_get_error_code(AEC_inst);
     PJ_LOG(4, (THIS_FILE, "WebRTC AEC ERROR (%s) %d ", tag, status));
 }
 
+/*
+ * Second order IIR high-pass filter with a cut-off at 80Hz, in Q12 with
+ * the feedback part in double precision.
+ */
+static void hpf_process(webrtc_ec *echo, pj_int16_t *data, unsigned len)
+{
+    const pj_int16_t *ba = echo->hpf_ba;
+    pj_int16_t *x = echo->hpf_x;
+    pj_int16_t *y = echo->hpf_y;
+    unsigned i;
+
+    for (i=0; i<len; ++i) {
+	pj_int32_t tmp;
+
+	/* y[i] = b[0]*x[i] + b[1]*x[i-1] + b[2]*x[i-2]
+	 *        - a[1]*y[i-1] - a[2]*y[i-2]
+	 */
+	tmp = ((pj_int32_t)y[1] * ba[3] + (pj_int32_t)y[3] * ba[4]) >> 15;
+	tmp += (pj_int32_t)y[0] * ba[3] + (pj_int32_t)y[2] * ba[4];
+	tmp <<= 1;
+
+	tmp += (pj_int32_t)data[i] * ba[0];
+	tmp += (pj_int32_t)x[0] * ba[1];
+	tmp += (pj_int32_t)x[1] * ba[2];
+
+	x[1] = x[0];
+	x[0] = data[i];
+
+	y[2] = y[0];
+	y[3] = y[1];
+	y[0] = (pj_int16_t)(tmp >> 13);
+	y[1] = (pj_int16_t)((tmp - ((pj_int32_t)y[0] << 13)) << 2);
+
+	/* Round and saturate to 2^27 before going back to Q0 */
+	tmp += 2048;
+	if (tmp > 134217727)
+	    tmp = 134217727;
+	else if (tmp < -134217728)
+	    tmp = -134217728;
+
+	data[i] = (pj_int16_t)(tmp >> 12);
+    }
+}
+
+/*
+ * (Re)initialize every enabled stage and the filter states.
+ */
+static pj_status_t init_stages(webrtc_ec *echo)
+{
+    int status;
+
+    status = W_WebRtcAec_Init(echo->AEC_inst,
+			      (echo->split && W_WEBRTC_AEC_MAX_RATE < 32000) ?
+				  W_WEBRTC_AEC_MAX_RATE : echo->clock_rate);
+    if(status != 0) {
+	print_webrtc_aec_error("Init", echo->AEC_inst);
+	return PJ_EBUG;
+    }
+
+    if (echo->NS_inst) {
+	status = WebRtcNsx_Init(echo->NS_inst, echo->clock_rate);
+	if(status != 0) {
+	    PJ_LOG(4, (THIS_FILE, "Could not initialize noise suppressor"));
+	    return PJ_EBUG;
+	}
+
+	status = WebRtcNsx_set_policy(echo->NS_inst, PJMEDIA_WEBRTC_NS_POLICY);
+	if (status != 0) {
+	    PJ_LOG(2, (THIS_FILE, "Could not set noise suppressor policy"));
+	}
+    }
+
+    if (echo->AGC_inst) {
+	WebRtcAgc_config_t agc_config;
+
+	status = WebRtcAgc_Init(echo->AGC_inst, 0, 255,
+				kAgcModeAdaptiveDigital, echo->clock_rate);
+	if(status != 0) {
+	    PJ_LOG(4, (THIS_FILE, "Could not initialize gain controller"));
+	    return PJ_EBUG;
+	}
+
+	agc_config.targetLevelDbfs = PJMEDIA_WEBRTC_AGC_TARGET_LEVEL;
+	agc_config.compressionGaindB = PJMEDIA_WEBRTC_AGC_COMPRESSION_GAIN;
+	agc_config.limiterEnable = kAgcTrue;
+	status = WebRtcAgc_set_config(echo->AGC_inst, agc_config);
+	if (status != 0) {
+	    PJ_LOG(2, (THIS_FILE, "Could not set gain controller config"));
+	}
+	echo->agc_level = 0;
+    }
+
+    echo->hpf_ba = (echo->clock_rate == 8000) ? hpf_coef_8khz : hpf_coef;
+    pj_bzero(echo->hpf_x, sizeof(echo->hpf_x));
+    pj_bzero(echo->hpf_y, sizeof(echo->hpf_y));
+
+    pj_bzero(echo->rec_analysis_state, sizeof(echo->rec_analysis_state));
+    pj_bzero(echo->rec_synthesis_state, sizeof(echo->rec_synthesis_state));
+    pj_bzero(echo->play_analysis_state, sizeof(echo->play_analysis_state));
+
+    return PJ_SUCCESS;
+}
+
 /*
  * Create the AEC.
  */
@@ -101,103 +262,72 @@ PJ_DEF(pj_status_t) webrtc_aec_create(pj_pool_t *pool,
 				     void **p_echo )
 {
 	webrtc_ec *echo;
-    int sampling_rate;
-    int status;
+    pj_bool_t use_ns, use_agc;
+    pj_status_t status;
 
     *p_echo = NULL;
 
     echo = PJ_POOL_ZALLOC_T(pool, webrtc_ec);
     PJ_ASSERT_RETURN(echo != NULL, PJ_ENOMEM);
 
+    echo->samples_per_frame = samples_per_frame;
+    echo->echo_tail = tail_ms;
+    echo->echo_skew = 0;
+    echo->clock_rate = clock_rate;
+    echo->blockLen10ms = (10 * channel_count * clock_rate / 1000);
+    echo->split = (clock_rate == 32000);
+    echo->band_len = echo->split ? echo->blockLen10ms / 2 : echo->blockLen10ms;
+
+    use_ns = pjmedia_webrtc_use_ns ||
+	     (options & PJMEDIA_ECHO_USE_NOISE_SUPPRESSOR);
+    use_agc = pjmedia_webrtc_use_agc ||
+	      (options & PJMEDIA_ECHO_USE_GAIN_CONTROLLER);
+    echo->hpf_enabled = PJMEDIA_WEBRTC_USE_HPF ||
+			(options & PJMEDIA_ECHO_USE_HIGH_PASS_FILTER);
+
     // Alloc memory
-    status = W_WebRtcAec_Create(&echo->AEC_inst);
-    if(status){
-    	return PJ_ENOMEM;
+    if (W_WebRtcAec_Create(&echo->AEC_inst) != 0) {
+	echo->AEC_inst = NULL;
+	return PJ_ENOMEM;
     }
-PJ_LOG(4, (THIS_FILE, "Create webRTC AEC with clock rate %d", clock_rate));
-    // Init
-    status = W_WebRtcAec_Init(echo->AEC_inst,
-    		clock_rate);
-
-	if(status != 0) {
-        if (echo->AEC_inst) {
-            print_webrtc_aec_error("Init", echo->AEC_inst);
-            W_WebRtcAec_Free(echo->AEC_inst);
-            echo->AEC_inst = NULL;
-        }
-    	return PJ_EBUG;
+    if (use_ns && WebRtcNsx_Create(&echo->NS_inst) != 0) {
+	echo->NS_inst = NULL;
+	webrtc_aec_destroy(echo);
+	return PJ_ENOMEM;
+    }
+    if (use_agc && WebRtcAgc_Create(&echo->AGC_inst) != 0) {
+	echo->AGC_inst = NULL;
+	webrtc_aec_destroy(echo);
+	return PJ_ENOMEM;
     }
 
-	// Set configuration -- sample code for future use
-	// For now keep default values
-/*
-#if WEBRTC_AEC_USE_MOBILE == 1
-	AecmConfig aecm_config;
-	aecm_config.cngMode = AecmTrue;
-	aecm_config.echoMode = 4;
+    PJ_LOG(4, (THIS_FILE, "Create webRTC AEC with clock rate %d%s%s%s",
+	       clock_rate, (echo->hpf_enabled ? ", HPF" : ""),
+	       (use_ns ? ", NS" : ""), (use_agc ? ", AGC" : "")));
 
-    status = WebRtcAecm_set_config(echo->AEC_inst, aecm_config);
-    if(status != 0) {
-        print_webrtc_aec_error("Init config", echo->AEC_inst);
-        WebRtcAec_Free(echo->AEC_inst);
-    	return PJ_EBUG;
+    status = init_stages(echo);
+    if (status != PJ_SUCCESS) {
+	webrtc_aec_destroy(echo);
+	return status;
     }
-#else
-    AecConfig aec_config;
-    aec_config.nlpMode = PJMEDIA_WEBRTC_AEC_AGGRESSIVENESS;
-    aec_config.skewMode = kAecTrue;
-    aec_config.metricsMode = kAecFalse;
-    aec_config.delay_logging = kAecFalse;
 
-    status = WebRtcAec_set_config(echo->AEC_inst, aec_config);
-    if(status != 0) {
-        print_webrtc_aec_error("Init config", echo->AEC_inst);
-        WebRtcAec_Free(echo->AEC_inst);
-    	return PJ_EBUG;
+    /* Buffers shared by the stages for one 10ms block */
+    if (echo->split) {
+	echo->rec_low = (pj_int16_t*)
+			pj_pool_zalloc(pool, 2*echo->band_len);
+	echo->rec_high = (pj_int16_t*)
+			 pj_pool_zalloc(pool, 2*echo->band_len);
+	echo->play_low = (pj_int16_t*)
+			 pj_pool_zalloc(pool, 2*echo->band_len);
+	echo->play_high = (pj_int16_t*)
+			  pj_pool_zalloc(pool, 2*echo->band_len);
+    }
+#if WEBRTC_AEC_USE_MOBILE == 1
+    if (echo->NS_inst) {
+	echo->aecm_ref = (pj_int16_t*)
+			 pj_pool_zalloc(pool, 2*echo->band_len);
     }
 #endif
-*/
-
-	if(pjmedia_webrtc_use_ns == PJ_TRUE){
-		status = WebRtcNsx_Create(&echo->NS_inst);
-		if(status != 0) {
-			return PJ_ENOMEM;
-		}
-
-		status = WebRtcNsx_Init(echo->NS_inst, clock_rate);
-		if(status != 0) {
-			if(echo->AEC_inst){
-				W_WebRtcAec_Free(echo->AEC_inst);
-				echo->AEC_inst = NULL;
-			}
-
-			if (echo->NS_inst) {
-				PJ_LOG(4, (THIS_FILE, "Could not initialize noise suppressor"));
-				WebRtcNsx_Free(echo->NS_inst);
-				echo->NS_inst = NULL;
-			}
-			return PJ_EBUG;
-		}
-
-		status = WebRtcNsx_set_policy(echo->NS_inst, PJMEDIA_WEBRTC_NS_POLICY);
-		if (status != 0) {
-			PJ_LOG(2, (THIS_FILE, "Could not set noise suppressor policy"));
-		}
-	}else{
-		echo->NS_inst = NULL;
-	}
-
-    echo->samples_per_frame = samples_per_frame;
-    echo->echo_tail = tail_ms;
-    echo->echo_skew = 0;
-    echo->clock_rate = clock_rate;
-    echo->blockLen10ms = (10 * channel_count * clock_rate / 1000);
-
-    /* Create temporary frames for echo cancellation */
-    echo->tmp_frame = (pj_int16_t*) pj_pool_zalloc(pool, 2*samples_per_frame);
-    PJ_ASSERT_RETURN(echo->tmp_frame != NULL, PJ_ENOMEM);
-    echo->tmp_frame2 = (pj_int16_t*) pj_pool_zalloc(pool, 2*samples_per_frame);
-    PJ_ASSERT_RETURN(echo->tmp_frame2 != NULL, PJ_ENOMEM);
 
     /* Done */
     *p_echo = echo;
@@ -222,6 +352,10 @@ PJ_DEF(pj_status_t) webrtc_aec_destroy(void *state )
         WebRtcNsx_Free(echo->NS_inst);
         echo->NS_inst = NULL;
     }
+    if (echo->AGC_inst) {
+	WebRtcAgc_Free(echo->AGC_inst);
+	echo->AGC_inst = NULL;
+    }
 
     return PJ_SUCCESS;
 }
@@ -235,10 +369,8 @@ PJ_DEF(void) webrtc_aec_reset(void *state )
     webrtc_ec *echo = (webrtc_ec*) state;
     pj_assert(echo != NULL);
     int status;
-    /* re-initialize the EC */
-	status = W_WebRtcAec_Init(echo->AEC_inst, echo->clock_rate);
-    if(status != 0) {
-        print_webrtc_aec_error("re-Init", echo->AEC_inst);
+    /* re-initialize the EC and the other stages */
+    if (init_stages(echo) != PJ_SUCCESS) {
         return;
     } else {
 
@@ -287,54 +419,114 @@ PJ_DEF(pj_status_t) webrtc_aec_cancel_echo( void *state,
 
 	tail_factor = echo->samples_per_frame / echo->blockLen10ms;
     for(i=0; i < echo->samples_per_frame; i+= echo->blockLen10ms) {
-    	if(echo->NS_inst){
-			/* Noise suppression */
-			status = WebRtcNsx_Process(echo->NS_inst,
-									  (WebRtc_Word16 *) (&rec_frm[i]),
-									  NULL,
-									  (WebRtc_Word16 *) (&echo->tmp_frame[i]),
-									  NULL);
-			if (status != 0) {
-				PJ_LOG(1, (THIS_FILE, "Error suppressing noise"));
-				return PJ_EBUG;
-			}
-    	}
+	pj_int16_t *low, *high;
+	const pj_int16_t *play_low;
+	WebRtc_Word16 has_echo = 0;
+
+	if (echo->split) {
+	    WebRtcSpl_AnalysisQMF(&rec_frm[i], echo->rec_low, echo->rec_high,
+				  echo->rec_analysis_state[0],
+				  echo->rec_analysis_state[1]);
+	    WebRtcSpl_AnalysisQMF(&play_frm[i], echo->play_low,
+				  echo->play_high,
+				  echo->play_analysis_state[0],
+				  echo->play_analysis_state[1]);
+	    low = echo->rec_low;
+	    high = echo->rec_high;
+	    play_low = echo->play_low;
+	} else {
+	    low = &rec_frm[i];
+	    high = NULL;
+	    play_low = &play_frm[i];
+	}
+
+	if (echo->hpf_enabled)
+	    hpf_process(echo, low, echo->band_len);
+
+	if (echo->AGC_inst) {
+	    /* Level analysis, before anything alters the signal further */
+	    status = WebRtcAgc_AddFarend(echo->AGC_inst, play_low,
+					 (WebRtc_Word16)echo->band_len);
+	    if (status == 0) {
+		status = WebRtcAgc_VirtualMic(echo->AGC_inst, low, high,
+					      (WebRtc_Word16)echo->band_len,
+					      0, &echo->agc_level);
+	    }
+	    if (status != 0) {
+		PJ_LOG(1, (THIS_FILE, "Error analyzing gain"));
+		return PJ_EBUG;
+	    }
+	}
 
 		/* Feed farend buffer */
-		status = W_WebRtcAec_BufferFarend(echo->AEC_inst, &play_frm[i], echo->blockLen10ms);
+		status = W_WebRtcAec_BufferFarend(echo->AEC_inst, play_low, echo->band_len);
 		if(status != 0) {
 			print_webrtc_aec_error("buffer farend", echo->AEC_inst);
 			return PJ_EBUG;
 		}
 
-
+#if WEBRTC_AEC_USE_MOBILE == 0
 		/* Process echo cancellation */
-#if WEBRTC_AEC_USE_MOBILE == 1
-		status = WebRtcAecm_Process(echo->AEC_inst,
-							(WebRtc_Word16 *) (&rec_frm[i]),
-							(echo->NS_inst)?(WebRtc_Word16 *) (&echo->tmp_frame[i]):(WebRtc_Word16 *) (&rec_frm[i]),
-							(WebRtc_Word16 *) (&echo->tmp_frame2[i]),
-							echo->blockLen10ms,
-							echo->echo_tail / tail_factor);
-#else
 		status = WebRtcAec_Process(echo->AEC_inst,
-							(echo->NS_inst)?(WebRtc_Word16 *) (&echo->tmp_frame[i]):(WebRtc_Word16 *) (&rec_frm[i]),
-							NULL,
-							(WebRtc_Word16 *) (&echo->tmp_frame2[i]),
-							NULL,
-							echo->blockLen10ms,
+							low, high, low, high,
+							echo->band_len,
 							echo->echo_tail / tail_factor,
 							echo->echo_skew);
+		if(status != 0){
+			print_webrtc_aec_error("Process echo", echo->AEC_inst);
+			return PJ_EBUG;
+		}
+		if (echo->AGC_inst)
+		    WebRtcAec_get_echo_status(echo->AEC_inst, &has_echo);
+#else
+		/* AECM wants to see the signal before noise suppression too */
+		if (echo->aecm_ref)
+		    pjmedia_copy_samples(echo->aecm_ref, low, echo->band_len);
 #endif
+
+    	if(echo->NS_inst){
+			/* Noise suppression */
+			status = WebRtcNsx_Process(echo->NS_inst,
+						   low, high, low, high);
+			if (status != 0) {
+				PJ_LOG(1, (THIS_FILE, "Error suppressing noise"));
+				return PJ_EBUG;
+			}
+    	}
+
+#if WEBRTC_AEC_USE_MOBILE == 1
+		/* Process echo cancellation */
+		status = WebRtcAecm_Process(echo->AEC_inst,
+							(echo->aecm_ref ? echo->aecm_ref : low),
+							(echo->aecm_ref ? low : NULL),
+							low,
+							echo->band_len,
+							echo->echo_tail / tail_factor);
 		if(status != 0){
 			print_webrtc_aec_error("Process echo", echo->AEC_inst);
-			return;
+			return PJ_EBUG;
 		}
-    }
+#endif
 
+	if (echo->AGC_inst) {
+	    WebRtc_UWord8 saturated;
+
+	    status = WebRtcAgc_Process(echo->AGC_inst, low, high,
+				       (WebRtc_Word16)echo->band_len,
+				       low, high, echo->agc_level,
+				       &echo->agc_level, has_echo, &saturated);
+	    if (status != 0) {
+		PJ_LOG(1, (THIS_FILE, "Error controlling gain"));
+		return PJ_EBUG;
+	    }
+	}
 
-    /* Copy temporary buffer back to original rec_frm */
-    pjmedia_copy_samples(rec_frm, echo->tmp_frame2, echo->samples_per_frame);
+	if (echo->split) {
+	    WebRtcSpl_SynthesisQMF(echo->rec_low, echo->rec_high, &rec_frm[i],
+				   echo->rec_synthesis_state[0],
+				   echo->rec_synthesis_state[1]);
+	}
+    }
 
     return PJ_SUCCESS;
 
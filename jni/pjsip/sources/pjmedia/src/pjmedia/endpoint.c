@@ -18,7 +18,9 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
  */
 #include <pjmedia/endpoint.h>
+#include <pjmedia/clock.h>
 #include <pjmedia/errno.h>
+#include <pjmedia/rtp.h>
 #include <pjmedia/sdp.h>
 #include <pjmedia/vid_codec.h>
 #include <pjmedia-audiodev/audiodev.h>
@@ -31,6 +33,16 @@
 #include <pj/sock.h>
 #include <pj/string.h>
 
+/* Real-time priority and thread CPU time are set and read with pthreads */
+#if ((defined(PJ_LINUX) && PJ_LINUX!=0) || \
+     (defined(PJ_ANDROID) && PJ_ANDROID!=0)) && PJ_HAS_THREADS
+#   define HAS_PTHREAD_SCHED	1
+#   include <pthread.h>
+#   include <sched.h>
+#   include <time.h>
+#else
+#   define HAS_PTHREAD_SCHED	0
+#endif
 
 #define THIS_FILE   "endpoint.c"
 
@@ -62,6 +74,16 @@ static int PJ_THREAD_FUNC worker_proc(void*);
 #define MAX_THREADS	16
 
 
+/* Media worker thread */
+typedef struct worker
+{
+    pjmedia_endpt		*endpt;
+    pj_thread_t			*thread;
+    pj_ioqueue_t		*ioqueue;
+    pjmedia_endpt_worker_stat	 stat;
+} worker;
+
+
 /* List of media endpoint exit callback. */
 typedef struct exit_cb
 {
@@ -88,11 +110,20 @@ struct pjmedia_endpt
     /** Do we own the ioqueue? */
     pj_bool_t		  own_ioqueue;
 
+    /** Number of ioqueues, the first one is ioqueue above. */
+    unsigned		  ioqueue_cnt;
+
+    /** Media ioqueues. */
+    pj_ioqueue_t	 *ioqueue_list[MAX_THREADS];
+
+    /** Raise worker threads to real-time priority? */
+    pj_bool_t		  realtime;
+
     /** Number of threads. */
     unsigned		  thread_cnt;
 
-    /** IOqueue polling thread, if any. */
-    pj_thread_t		 *thread[MAX_THREADS];
+    /** IOqueue polling threads, if any. */
+    worker		  thread[MAX_THREADS];
 
     /** To signal polling thread to quit. */
     pj_bool_t		  quit_flag;
@@ -112,8 +143,38 @@ PJ_DEF(pj_status_t) pjmedia_endpt_create(pj_pool_factory *pf,
 					 unsigned worker_cnt,
 					 pjmedia_endpt **p_endpt)
 {
+    pjmedia_endpt_worker_param param;
+
+    pjmedia_endpt_worker_param_default(&param);
+    param.worker_cnt = worker_cnt;
+
+    return pjmedia_endpt_create2(pf, ioqueue, &param, p_endpt);
+}
+
+/**
+ * Initialize worker settings with default values.
+ */
+PJ_DEF(void) pjmedia_endpt_worker_param_default(
+					pjmedia_endpt_worker_param *param)
+{
+    pj_bzero(param, sizeof(*param));
+    param->worker_cnt = 1;
+    param->ioqueue_cnt = 1;
+}
+
+/**
+ * Initialize and get the instance of media endpoint with a pool of
+ * media worker threads.
+ */
+PJ_DEF(pj_status_t) pjmedia_endpt_create2(pj_pool_factory *pf,
+					  pj_ioqueue_t *ioqueue,
+				    const pjmedia_endpt_worker_param *param,
+					  pjmedia_endpt **p_endpt)
+{
+    pjmedia_endpt_worker_param def_param;
     pj_pool_t *pool;
     pjmedia_endpt *endpt;
+    unsigned worker_cnt;
     unsigned i;
     pj_status_t status;
 
@@ -121,7 +182,19 @@ PJ_DEF(pj_status_t) pjmedia_endpt_create(pj_pool_factory *pf,
 				  &pjmedia_strerror);
     pj_assert(status == PJ_SUCCESS);
 
+    if (param == NULL) {
+	pjmedia_endpt_worker_param_default(&def_param);
+	param = &def_param;
+    }
+
     PJ_ASSERT_RETURN(pf && p_endpt, PJ_EINVAL);
+    PJ_ASSERT_RETURN(param->ioqueue_cnt >= 1, PJ_EINVAL);
+
+    /* Additional ioqueues would never be polled without worker threads */
+    PJ_ASSERT_RETURN(param->ioqueue_cnt == 1 || param->worker_cnt > 0,
+		     PJ_EINVAL);
+
+    worker_cnt = param->worker_cnt * param->ioqueue_cnt;
     PJ_ASSERT_RETURN(worker_cnt <= MAX_THREADS, PJ_EINVAL);
 
     pool = pj_pool_create(pf, "med-ept", 512, 512, NULL);
@@ -132,6 +205,8 @@ PJ_DEF(pj_status_t) pjmedia_endpt_create(pj_pool_factory *pf,
     endpt->pool = pool;
     endpt->pf = pf;
     endpt->ioqueue = ioqueue;
+    endpt->ioqueue_cnt = 1;
+    endpt->realtime = param->realtime;
     endpt->thread_cnt = worker_cnt;
     endpt->has_telephone_event = PJ_TRUE;
 
@@ -163,15 +238,36 @@ PJ_DEF(pj_status_t) pjmedia_endpt_create(pj_pool_factory *pf,
 				 "media endpoint for internal ioqueue"));
 	}
     }
+    endpt->ioqueue_list[0] = endpt->ioqueue;
+
+    /* Create additional ioqueues, these are always ours */
+    for (i=1; i<param->ioqueue_cnt; ++i) {
+	status = pj_ioqueue_create( endpt->pool, PJ_IOQUEUE_MAX_HANDLES,
+				    &endpt->ioqueue_list[i]);
+	if (status != PJ_SUCCESS)
+	    goto on_error;
+	++endpt->ioqueue_cnt;
+    }
 
     /* Create worker threads if asked. */
     for (i=0; i<worker_cnt; ++i) {
+	worker *w = &endpt->thread[i];
+
+	w->endpt = endpt;
+	w->ioqueue = endpt->ioqueue_list[i % endpt->ioqueue_cnt];
+	w->stat.ioqueue_idx = i % endpt->ioqueue_cnt;
 	status = pj_thread_create( endpt->pool, "media", &worker_proc,
-				   endpt, 0, 0, &endpt->thread[i]);
+				   w, 0, 0, &w->thread);
 	if (status != PJ_SUCCESS)
 	    goto on_error;
     }
 
+    if (endpt->ioqueue_cnt > 1 || endpt->realtime) {
+	PJ_LOG(4,(THIS_FILE, "Media endpoint has %d ioqueue(s) polled by "
+			     "%d %sworker thread(s)", endpt->ioqueue_cnt,
+			     worker_cnt, (endpt->realtime? "real-time ":"")));
+    }
+
 
     *p_endpt = endpt;
     return PJ_SUCCESS;
@@ -179,18 +275,25 @@ PJ_DEF(pj_status_t) pjmedia_endpt_create(pj_pool_factory *pf,
 on_error:
 
     /* Destroy threads */
+    endpt->quit_flag = 1;
     for (i=0; i<endpt->thread_cnt; ++i) {
-	if (endpt->thread[i]) {
-	    pj_thread_destroy(endpt->thread[i]);
+	if (endpt->thread[i].thread) {
+	    pj_thread_join(endpt->thread[i].thread);
+	    pj_thread_destroy(endpt->thread[i].thread);
 	}
     }
 
-    /* Destroy internal ioqueue */
+    /* Destroy internal ioqueues */
+    for (i=1; i<endpt->ioqueue_cnt; ++i)
+	pj_ioqueue_destroy(endpt->ioqueue_list[i]);
     if (endpt->ioqueue && endpt->own_ioqueue)
 	pj_ioqueue_destroy(endpt->ioqueue);
 
     pjmedia_codec_mgr_destroy(&endpt->codec_mgr);
     pjmedia_aud_subsys_shutdown();
+
+    /* Clock threads left to join may use the pool factory */
+    pjmedia_clock_sched_reap();
     pj_pool_release(pool);
     return status;
 }
@@ -217,14 +320,20 @@ PJ_DEF(pj_status_t) pjmedia_endpt_destroy (pjmedia_endpt *endpt)
 
     /* Destroy threads */
     for (i=0; i<endpt->thread_cnt; ++i) {
-	if (endpt->thread[i]) {
-	    pj_thread_join(endpt->thread[i]);
-	    pj_thread_destroy(endpt->thread[i]);
-	    endpt->thread[i] = NULL;
+	if (endpt->thread[i].thread) {
+	    pj_thread_join(endpt->thread[i].thread);
+	    pj_thread_destroy(endpt->thread[i].thread);
+	    endpt->thread[i].thread = NULL;
 	}
     }
 
-    /* Destroy internal ioqueue */
+    /* Destroy internal ioqueues */
+    for (i=1; i<endpt->ioqueue_cnt; ++i) {
+	pj_ioqueue_destroy(endpt->ioqueue_list[i]);
+	endpt->ioqueue_list[i] = NULL;
+    }
+    endpt->ioqueue_cnt = 1;
+
     if (endpt->ioqueue && endpt->own_ioqueue) {
 	pj_ioqueue_destroy(endpt->ioqueue);
 	endpt->ioqueue = NULL;
@@ -235,6 +344,9 @@ PJ_DEF(pj_status_t) pjmedia_endpt_destroy (pjmedia_endpt *endpt)
     pjmedia_codec_mgr_destroy(&endpt->codec_mgr);
     pjmedia_aud_subsys_shutdown();
 
+    /* Clock threads left to join may use the pool factory */
+    pjmedia_clock_sched_reap();
+
     /* Call all registered exit callbacks */
     ecb = endpt->exit_cb_list.next;
     while (ecb != &endpt->exit_cb_list) {
@@ -290,6 +402,25 @@ PJ_DEF(pj_ioqueue_t*) pjmedia_endpt_get_ioqueue(pjmedia_endpt *endpt)
     return endpt->ioqueue;
 }
 
+/**
+ * Get the number of ioqueues of the media endpoint.
+ */
+PJ_DEF(unsigned) pjmedia_endpt_get_ioqueue_count(pjmedia_endpt *endpt)
+{
+    PJ_ASSERT_RETURN(endpt, 0);
+    return endpt->ioqueue_cnt;
+}
+
+/**
+ * Get the ioqueue for the media transports identified by the key.
+ */
+PJ_DEF(pj_ioqueue_t*) pjmedia_endpt_get_ioqueue_by_key(pjmedia_endpt *endpt,
+						       unsigned key)
+{
+    PJ_ASSERT_RETURN(endpt, NULL);
+    return endpt->ioqueue_list[key % endpt->ioqueue_cnt];
+}
+
 /**
  * Get the number of worker threads in media endpoint.
  */
@@ -310,7 +441,66 @@ PJ_DEF(pj_thread_t*) pjmedia_endpt_get_thread(pjmedia_endpt *endpt,
 
     /* here should be an assert on index >= 0 < endpt->thread_cnt */
 
-    return endpt->thread[index];
+    return endpt->thread[index].thread;
+}
+
+/**
+ * Get the load statistics of a worker thread.
+ */
+PJ_DEF(pj_status_t) pjmedia_endpt_get_worker_stat(pjmedia_endpt *endpt,
+					unsigned index,
+					pjmedia_endpt_worker_stat *stat)
+{
+    PJ_ASSERT_RETURN(endpt && stat, PJ_EINVAL);
+    PJ_ASSERT_RETURN(index < endpt->thread_cnt, PJ_EINVAL);
+
+    pj_memcpy(stat, &endpt->thread[index].stat, sizeof(*stat));
+
+#if HAS_PTHREAD_SCHED
+    {
+	pthread_t *thid;
+	clockid_t cid;
+	struct timespec ts;
+
+	thid = (pthread_t*)
+	       pj_thread_get_os_handle(endpt->thread[index].thread);
+	if (pthread_getcpuclockid(*thid, &cid) == 0 &&
+	    clock_gettime(cid, &ts) == 0)
+	{
+	    stat->cpu_usec = (pj_uint64_t)ts.tv_sec * 1000000 +
+			     ts.tv_nsec / 1000;
+	}
+    }
+#endif
+
+    return PJ_SUCCESS;
+}
+
+/* Raise the priority of the calling worker thread to real-time */
+static void set_realtime_prio(void)
+{
+#if HAS_PTHREAD_SCHED
+    struct sched_param param;
+    pthread_t *thid;
+    int rc;
+
+    thid = (pthread_t*) pj_thread_get_os_handle(pj_thread_this());
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    rc = pthread_setschedparam(*thid, SCHED_FIFO, &param);
+    if (rc != 0) {
+	PJ_LOG(4,(THIS_FILE, "Unable to set real-time priority for media "
+			     "worker thread, error: %d", rc));
+    }
+#else
+    pj_thread_t *thread = pj_thread_this();
+    pj_status_t status;
+
+    status = pj_thread_set_prio(thread, pj_thread_get_prio_max(thread));
+    if (status != PJ_SUCCESS) {
+	PJ_PERROR(4,(THIS_FILE, status, "Unable to set priority for media "
+					"worker thread"));
+    }
+#endif
 }
 
 /**
@@ -318,11 +508,22 @@ PJ_DEF(pj_thread_t*) pjmedia_endpt_get_thread(pjmedia_endpt *endpt,
  */
 static int PJ_THREAD_FUNC worker_proc(void *arg)
 {
-    pjmedia_endpt *endpt = (pjmedia_endpt*) arg;
+    worker *w = (worker*) arg;
+    pjmedia_endpt *endpt = w->endpt;
+
+    if (endpt->realtime)
+	set_realtime_prio();
 
     while (!endpt->quit_flag) {
 	pj_time_val timeout = { 0, 500 };
-	pj_ioqueue_poll(endpt->ioqueue, &timeout);
+	int n;
+
+	n = pj_ioqueue_poll(w->ioqueue, &timeout);
+	if (n > 0) {
+	    w->stat.event_cnt += n;
+	    if ((unsigned)n > w->stat.max_burst)
+		w->stat.max_burst = n;
+	}
     }
 
     return 0;
@@ -552,6 +753,21 @@ PJ_DEF(pj_status_t) pjmedia_endpt_create_audio_sdp(pjmedia_endpt *endpt,
     }
 #endif
 
+#if defined(PJMEDIA_RTP_AUDIO_LEVEL_EXT_ID) && \
+    PJMEDIA_RTP_AUDIO_LEVEL_EXT_ID != 0
+    /*
+     * Add client-to-mixer audio level header extension (RFC 6464). We
+     * don't run voice activity detection for it, hence "vad=off".
+     */
+    if (m->attr_count < PJMEDIA_MAX_SDP_ATTR) {
+	attr = PJ_POOL_ZALLOC_T(pool, pjmedia_sdp_attr);
+	attr->name = pj_str("extmap");
+	attr->value = pj_str(PJMEDIA_RTP_AUDIO_LEVEL_EXT_ID_STR " "
+			     PJMEDIA_RTP_EXT_AUDIO_LEVEL_URI " vad=off");
+	m->attr[m->attr_count++] = attr;
+    }
+#endif
+
     /* Put bandwidth info in media level using bandwidth modifier "TIAS"
      * (RFC3890).
      */
@@ -920,6 +1136,18 @@ PJ_DEF(pj_status_t) pjmedia_endpt_dump(pjmedia_endpt *endpt)
 		  (param.setting.penh ? " penh" : ""),
 		  (prio[i]==PJMEDIA_CODEC_PRIO_DISABLED?" disabled":"")));
     }
+
+    PJ_LOG(3,(THIS_FILE, "  Worker threads: %d, ioqueues: %d",
+	      endpt->thread_cnt, endpt->ioqueue_cnt));
+    for (i=0; i<endpt->thread_cnt; ++i) {
+	pjmedia_endpt_worker_stat stat;
+
+	pjmedia_endpt_get_worker_stat(endpt, i, &stat);
+	PJ_LOG(3,(THIS_FILE, "   Worker #%d: ioqueue=%d, events=%u, "
+		  "max burst=%u, cpu=%u ms",
+		  i, stat.ioqueue_idx, stat.event_cnt, stat.max_burst,
+		  (unsigned)(stat.cpu_usec / 1000)));
+    }
 #endif
 
     return PJ_SUCCESS;
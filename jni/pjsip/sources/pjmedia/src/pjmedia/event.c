@@ -19,6 +19,7 @@
 #include <pjmedia/event.h>
 #include <pjmedia/errno.h>
 #include <pj/assert.h>
+#include <pj/hash.h>
 #include <pj/list.h>
 #include <pj/log.h>
 #include <pj/os.h>
@@ -27,7 +28,8 @@
 
 #define THIS_FILE	"event.c"
 
-#define MAX_EVENTS 16
+/* Size of the publisher and coalescing hash tables */
+#define HASH_TABLE_SIZE	31
 
 typedef struct esub esub;
 
@@ -40,12 +42,42 @@ struct esub
     void                *epub;
 };
 
-typedef struct event_queue
+/* Subscribers of one publisher. Publishers are indexed in a hash table so
+ * that distributing an event only visits the subscribers it concerns.
+ */
+typedef struct epub_entry epub_entry;
+
+struct epub_entry
+{
+    PJ_DECL_LIST_MEMBER(epub_entry);
+
+    void                *epub;          /**< hash key.                  */
+    esub                 subs;          /**< list of subscribers.       */
+    unsigned             busy;          /**< events being distributed.  */
+    pj_hash_entry_buf    hentry;
+};
+
+/* Key of idempotent events that may be coalesced */
+typedef struct coalesce_key
 {
-    pjmedia_event   events[MAX_EVENTS]; /**< array of events.           */
-    int             head, tail;
-    pj_bool_t       is_full;
-} event_queue;
+    const void          *epub;
+    const void          *src;
+    pjmedia_event_type   type;
+    unsigned             dir;
+} coalesce_key;
+
+/* Queued event */
+typedef struct event_node event_node;
+
+struct event_node
+{
+    PJ_DECL_LIST_MEMBER(event_node);
+
+    pjmedia_event        ev;
+    pj_bool_t            coalescing;    /**< in the coalescing table.   */
+    coalesce_key         ckey;
+    pj_hash_entry_buf    hentry;
+};
 
 struct pjmedia_event_mgr
 {
@@ -53,76 +85,209 @@ struct pjmedia_event_mgr
     pj_thread_t    *thread;             /**< worker thread.             */
     pj_bool_t       is_quitting;
     pj_sem_t       *sem;
-    pj_mutex_t     *mutex;
-    event_queue     ev_queue;
-    event_queue    *pub_ev_queue;       /**< publish() event queue.     */
-    esub            esub_list;          /**< list of subscribers.       */
+    pj_mutex_t     *mutex;              /**< subscribers lock.          */
+    pj_hash_table_t *epub_table;        /**< subscribers by publisher.  */
+    esub            any_esub_list;      /**< subscribers to all pubs.   */
     esub            free_esub_list;     /**< list of subscribers.       */
+    epub_entry      free_epub_list;     /**< unused publisher entries.  */
     esub           *th_next_sub,        /**< worker thread's next sub.  */
                    *pub_next_sub;       /**< publish() next sub.        */
+    event_node     *pub_ev_queue;       /**< publish() event queue.     */
+
+    /* The event queue has its own lock and pool, so that posting events
+     * never waits for the subscriber callbacks.
+     */
+    pj_pool_t      *q_pool;
+    pj_mutex_t     *q_mutex;
+    event_node      ev_queue;           /**< posted events.             */
+    unsigned        ev_queue_len;
+    event_node      free_ev_list;       /**< unused event nodes.        */
+    pj_hash_table_t *coalesce_table;    /**< posted idempotent events.  */
 };
 
 static pjmedia_event_mgr *event_manager_instance;
 
-static pj_status_t event_queue_add_event(event_queue* ev_queue,
-                                         pjmedia_event *event)
+
+/* Check whether a newer event of this type supersedes a pending one from
+ * the same source, so that only the newer one needs to be delivered.
+ */
+static pj_bool_t event_is_idempotent(const pjmedia_event *event)
 {
-    if (ev_queue->is_full) {
-        char ev_name[5];
+    switch (event->type) {
+    case PJMEDIA_EVENT_FMT_CHANGED:
+    case PJMEDIA_EVENT_WND_RESIZED:
+    case PJMEDIA_EVENT_KEYFRAME_FOUND:
+    case PJMEDIA_EVENT_KEYFRAME_MISSING:
+    case PJMEDIA_EVENT_ORIENT_CHANGED:
+        return PJ_TRUE;
+    default:
+        return PJ_FALSE;
+    }
+}
 
-        /* This event will be ignored. */
-        PJ_LOG(4, (THIS_FILE, "Lost event %s from publisher [0x%p] "
-                              "due to full queue.",
-                              pjmedia_fourcc_name(event->type, ev_name),
-                              event->epub));
+/* Get an event node. Must be called with q_mutex held. */
+static event_node *event_node_alloc(pjmedia_event_mgr *mgr)
+{
+    event_node *node;
 
-        return PJ_ETOOMANY;
+    if (!pj_list_empty(&mgr->free_ev_list)) {
+        node = mgr->free_ev_list.next;
+        pj_list_erase(node);
+    } else {
+        node = PJ_POOL_ALLOC_T(mgr->q_pool, event_node);
     }
+    node->coalescing = PJ_FALSE;
 
-    pj_memcpy(&ev_queue->events[ev_queue->tail], event, sizeof(*event));
-    ev_queue->tail = (ev_queue->tail + 1) % MAX_EVENTS;
-    if (ev_queue->tail == ev_queue->head)
-        ev_queue->is_full = PJ_TRUE;
+    return node;
+}
 
-    return PJ_SUCCESS;
+/* Add an event to the posted event queue, replacing a pending idempotent
+ * event of the same source if there is one. The replaced event is moved to
+ * the tail, so that it is still delivered after any event the source has
+ * posted since. The queue grows as needed, events are never dropped.
+ * Returns PJ_TRUE if a new node was queued.
+ */
+static pj_bool_t event_queue_post(pjmedia_event_mgr *mgr,
+                                  const pjmedia_event *event,
+                                  pj_bool_t *was_empty)
+{
+    event_node *node;
+    coalesce_key key;
+    pj_uint32_t hval = 0;
+    pj_bool_t coalesce = event_is_idempotent(event);
+
+    *was_empty = (mgr->ev_queue_len == 0);
+
+    if (coalesce) {
+        pj_bzero(&key, sizeof(key));
+        key.epub = event->epub;
+        key.src = event->src;
+        key.type = event->type;
+        if (event->type == PJMEDIA_EVENT_FMT_CHANGED)
+            key.dir = event->data.fmt_changed.dir;
+
+        node = (event_node*)
+               pj_hash_get(mgr->coalesce_table, &key, sizeof(key), &hval);
+        if (node) {
+            pj_memcpy(&node->ev, event, sizeof(*event));
+            if (node != mgr->ev_queue.prev) {
+                pj_list_erase(node);
+                pj_list_push_back(&mgr->ev_queue, node);
+            }
+            return PJ_FALSE;
+        }
+    }
+
+    node = event_node_alloc(mgr);
+    pj_memcpy(&node->ev, event, sizeof(*event));
+    if (coalesce) {
+        pj_memcpy(&node->ckey, &key, sizeof(key));
+        pj_hash_set_np(mgr->coalesce_table, &node->ckey, sizeof(key), hval,
+                       node->hentry, node);
+        node->coalescing = PJ_TRUE;
+    }
+    pj_list_push_back(&mgr->ev_queue, node);
+    ++mgr->ev_queue_len;
+
+    return PJ_TRUE;
 }
 
-static pj_status_t event_mgr_distribute_events(pjmedia_event_mgr *mgr,
-                                               event_queue *ev_queue,
-                                               esub **next_sub,
-                                               pj_bool_t rls_lock)
+/* Take the oldest posted event, into *event. Must be called with q_mutex
+ * held.
+ */
+static pj_bool_t event_queue_pop(pjmedia_event_mgr *mgr,
+                                 pjmedia_event *event)
+{
+    event_node *node;
+
+    if (pj_list_empty(&mgr->ev_queue))
+        return PJ_FALSE;
+
+    node = mgr->ev_queue.next;
+    pj_list_erase(node);
+    --mgr->ev_queue_len;
+
+    /* From now on, new events from the source will be queued again */
+    if (node->coalescing) {
+        pj_hash_set_np(mgr->coalesce_table, &node->ckey,
+                       sizeof(node->ckey), 0, node->hentry, NULL);
+    }
+    pj_memcpy(event, &node->ev, sizeof(*event));
+    pj_list_push_back(&mgr->free_ev_list, node);
+
+    return PJ_TRUE;
+}
+
+/* Release a publisher entry which no longer has subscribers */
+static void epub_entry_release(pjmedia_event_mgr *mgr, epub_entry *pub)
+{
+    if (pub->busy || !pj_list_empty(&pub->subs))
+        return;
+
+    pj_hash_set_np(mgr->epub_table, &pub->epub, sizeof(pub->epub), 0,
+                   pub->hentry, NULL);
+    pj_list_push_back(&mgr->free_epub_list, pub);
+}
+
+static pj_status_t event_mgr_call_subs(pjmedia_event_mgr *mgr,
+                                       pjmedia_event *ev,
+                                       esub *list,
+                                       esub **next_sub,
+                                       pj_bool_t rls_lock)
 {
     pj_status_t err = PJ_SUCCESS;
-    esub * sub = mgr->esub_list.next;
-    pjmedia_event *ev = &ev_queue->events[ev_queue->head];
+    esub *sub = list->next;
+
+    while (sub != list) {
+        pjmedia_event_cb *cb = sub->cb;
+        void *user_data = sub->user_data;
+        pj_status_t status;
 
-    while (sub != &mgr->esub_list) {
         *next_sub = sub->next;
 
-        /* Check if the subscriber is interested in 
-         * receiving the event from the publisher.
-         */
-        if (sub->epub == ev->epub || !sub->epub) {
-            pjmedia_event_cb *cb = sub->cb;
-            void *user_data = sub->user_data;
-            pj_status_t status;
-            
-            if (rls_lock)
-                pj_mutex_unlock(mgr->mutex);
+        if (rls_lock)
+            pj_mutex_unlock(mgr->mutex);
 
-            status = (*cb)(ev, user_data);
-            if (status != PJ_SUCCESS && err == PJ_SUCCESS)
-	        err = status;
+        status = (*cb)(ev, user_data);
+        if (status != PJ_SUCCESS && err == PJ_SUCCESS)
+            err = status;
 
-            if (rls_lock)
-                pj_mutex_lock(mgr->mutex);
-        }
-	sub = *next_sub;
+        if (rls_lock)
+            pj_mutex_lock(mgr->mutex);
+
+        sub = *next_sub;
     }
     *next_sub = NULL;
 
-    ev_queue->head = (ev_queue->head + 1) % MAX_EVENTS;
-    ev_queue->is_full = PJ_FALSE;
+    return err;
+}
+
+/* Deliver an event to the subscribers of its publisher, then to the
+ * subscribers of all publishers. Must be called with mutex held.
+ */
+static pj_status_t event_mgr_distribute_event(pjmedia_event_mgr *mgr,
+                                              pjmedia_event *ev,
+                                              esub **next_sub,
+                                              pj_bool_t rls_lock)
+{
+    pj_status_t err = PJ_SUCCESS;
+    pj_status_t status;
+    epub_entry *pub;
+
+    pub = (epub_entry*) pj_hash_get(mgr->epub_table, &ev->epub,
+                                    sizeof(ev->epub), NULL);
+    if (pub) {
+        /* Keep the entry while the lock may be released */
+        ++pub->busy;
+        err = event_mgr_call_subs(mgr, ev, &pub->subs, next_sub, rls_lock);
+        --pub->busy;
+        epub_entry_release(mgr, pub);
+    }
+
+    status = event_mgr_call_subs(mgr, ev, &mgr->any_esub_list, next_sub,
+                                 rls_lock);
+    if (status != PJ_SUCCESS && err == PJ_SUCCESS)
+        err = status;
 
     return err;
 }
@@ -133,16 +298,30 @@ static int event_worker_thread(void *arg)
     pjmedia_event_mgr *mgr = (pjmedia_event_mgr *)arg;
 
     while (1) {
+        pjmedia_event ev;
+        pj_bool_t has_event, is_quitting;
+
 	/* Wait until there is an event. */
         pj_sem_wait(mgr->sem);
 
-        if (mgr->is_quitting)
+        pj_mutex_lock(mgr->q_mutex);
+        is_quitting = mgr->is_quitting;
+        pj_mutex_unlock(mgr->q_mutex);
+        if (is_quitting)
             break;
 
-        pj_mutex_lock(mgr->mutex);
-        event_mgr_distribute_events(mgr, &mgr->ev_queue,
-                                    &mgr->th_next_sub, PJ_TRUE);
-        pj_mutex_unlock(mgr->mutex);
+        do {
+            pj_mutex_lock(mgr->q_mutex);
+            has_event = event_queue_pop(mgr, &ev);
+            pj_mutex_unlock(mgr->q_mutex);
+
+            if (has_event) {
+                pj_mutex_lock(mgr->mutex);
+                event_mgr_distribute_event(mgr, &ev, &mgr->th_next_sub,
+                                           PJ_TRUE);
+                pj_mutex_unlock(mgr->mutex);
+            }
+        } while (has_event);
     }
 
     return 0;
@@ -157,14 +336,36 @@ PJ_DEF(pj_status_t) pjmedia_event_mgr_create(pj_pool_t *pool,
 
     mgr = PJ_POOL_ZALLOC_T(pool, pjmedia_event_mgr);
     mgr->pool = pj_pool_create(pool->factory, "evt mgr", 500, 500, NULL);
-    pj_list_init(&mgr->esub_list);
+    mgr->q_pool = pj_pool_create(pool->factory, "evt queue", 1000, 1000,
+                                 NULL);
+    pj_list_init(&mgr->any_esub_list);
     pj_list_init(&mgr->free_esub_list);
+    pj_list_init(&mgr->free_epub_list);
+    pj_list_init(&mgr->ev_queue);
+    pj_list_init(&mgr->free_ev_list);
+    mgr->epub_table = pj_hash_create(mgr->pool, HASH_TABLE_SIZE);
+    mgr->coalesce_table = pj_hash_create(mgr->q_pool, HASH_TABLE_SIZE);
+
+    status = pj_mutex_create_recursive(mgr->pool, "ev_mutex", &mgr->mutex);
+    if (status != PJ_SUCCESS) {
+        pjmedia_event_mgr_destroy(mgr);
+        return status;
+    }
+
+    status = pj_mutex_create_simple(mgr->q_pool, "ev_qmutex",
+                                    &mgr->q_mutex);
+    if (status != PJ_SUCCESS) {
+        pjmedia_event_mgr_destroy(mgr);
+        return status;
+    }
 
     if (!(options & PJMEDIA_EVENT_MGR_NO_THREAD)) {
-        status = pj_sem_create(mgr->pool, "ev_sem", 0, MAX_EVENTS + 1,
+        status = pj_sem_create(mgr->pool, "ev_sem", 0, PJ_MAXINT32,
                                &mgr->sem);
-        if (status != PJ_SUCCESS)
+        if (status != PJ_SUCCESS) {
+            pjmedia_event_mgr_destroy(mgr);
             return status;
+        }
 
         status = pj_thread_create(mgr->pool, "ev_thread",
                                   &event_worker_thread,
@@ -175,12 +376,6 @@ PJ_DEF(pj_status_t) pjmedia_event_mgr_create(pj_pool_t *pool,
         }
     }
 
-    status = pj_mutex_create_recursive(mgr->pool, "ev_mutex", &mgr->mutex);
-    if (status != PJ_SUCCESS) {
-        pjmedia_event_mgr_destroy(mgr);
-        return status;
-    }
-
     if (!event_manager_instance)
 	event_manager_instance = mgr;
 
@@ -206,7 +401,9 @@ PJ_DEF(void) pjmedia_event_mgr_destroy(pjmedia_event_mgr *mgr)
     PJ_ASSERT_ON_FAIL(mgr != NULL, return);
 
     if (mgr->thread) {
+        pj_mutex_lock(mgr->q_mutex);
         mgr->is_quitting = PJ_TRUE;
+        pj_mutex_unlock(mgr->q_mutex);
         pj_sem_post(mgr->sem);
         pj_thread_join(mgr->thread);
     }
@@ -216,11 +413,19 @@ PJ_DEF(void) pjmedia_event_mgr_destroy(pjmedia_event_mgr *mgr)
         mgr->sem = NULL;
     }
 
+    if (mgr->q_mutex) {
+        pj_mutex_destroy(mgr->q_mutex);
+        mgr->q_mutex = NULL;
+    }
+
     if (mgr->mutex) {
         pj_mutex_destroy(mgr->mutex);
         mgr->mutex = NULL;
     }
 
+    if (mgr->q_pool)
+        pj_pool_release(mgr->q_pool);
+
     if (mgr->pool)
         pj_pool_release(mgr->pool);
 
@@ -245,7 +450,7 @@ PJ_DEF(pj_status_t) pjmedia_event_subscribe( pjmedia_event_mgr *mgr,
                                              void *user_data,
                                              void *epub)
 {
-    esub *sub;
+    esub *list, *sub;
 
     PJ_ASSERT_RETURN(cb, PJ_EINVAL);
 
@@ -253,16 +458,39 @@ PJ_DEF(pj_status_t) pjmedia_event_subscribe( pjmedia_event_mgr *mgr,
     PJ_ASSERT_RETURN(mgr, PJ_EINVAL);
 
     pj_mutex_lock(mgr->mutex);
+
+    if (epub) {
+        epub_entry *pub;
+        pj_uint32_t hval = 0;
+
+        pub = (epub_entry*) pj_hash_get(mgr->epub_table, &epub,
+                                        sizeof(epub), &hval);
+        if (!pub) {
+            if (!pj_list_empty(&mgr->free_epub_list)) {
+                pub = mgr->free_epub_list.next;
+                pj_list_erase(pub);
+            } else {
+                pub = PJ_POOL_ZALLOC_T(mgr->pool, epub_entry);
+            }
+            pub->epub = epub;
+            pub->busy = 0;
+            pj_list_init(&pub->subs);
+            pj_hash_set_np(mgr->epub_table, &pub->epub, sizeof(pub->epub),
+                           hval, pub->hentry, pub);
+        }
+        list = &pub->subs;
+    } else {
+        list = &mgr->any_esub_list;
+    }
+
     /* Check whether callback function with the same user data is already
      * subscribed to the publisher. This is to prevent the callback function
      * receiving the same event from the same publisher more than once.
      */
-    sub = mgr->esub_list.next;
-    while (sub != &mgr->esub_list) {
+    sub = list->next;
+    while (sub != list) {
 	esub *next = sub->next;
-        if (sub->cb == cb && sub->user_data == user_data &&
-            sub->epub == epub)
-        {
+        if (sub->cb == cb && sub->user_data == user_data) {
             pj_mutex_unlock(mgr->mutex);
             return PJ_SUCCESS;
         }
@@ -277,32 +505,25 @@ PJ_DEF(pj_status_t) pjmedia_event_subscribe( pjmedia_event_mgr *mgr,
     sub->cb = cb;
     sub->user_data = user_data;
     sub->epub = epub;
-    pj_list_push_back(&mgr->esub_list, sub);
+    pj_list_push_back(list, sub);
     pj_mutex_unlock(mgr->mutex);
 
     return PJ_SUCCESS;
 }
 
-PJ_DEF(pj_status_t)
-pjmedia_event_unsubscribe(pjmedia_event_mgr *mgr,
-                          pjmedia_event_cb *cb,
-                          void *user_data,
-                          void *epub)
+/* Remove matching subscriptions from a subscriber list. Returns PJ_TRUE
+ * if the search is over.
+ */
+static pj_bool_t event_mgr_unsubscribe_list(pjmedia_event_mgr *mgr,
+                                            esub *list,
+                                            pjmedia_event_cb *cb,
+                                            void *user_data)
 {
-    esub *sub;
-
-    PJ_ASSERT_RETURN(cb, PJ_EINVAL);
-
-    if (!mgr) mgr = pjmedia_event_mgr_instance();
-    PJ_ASSERT_RETURN(mgr, PJ_EINVAL);
+    esub *sub = list->next;
 
-    pj_mutex_lock(mgr->mutex);
-    sub = mgr->esub_list.next;
-    while (sub != &mgr->esub_list) {
+    while (sub != list) {
 	esub *next = sub->next;
-        if (sub->cb == cb && (sub->user_data == user_data || !user_data) &&
-            (sub->epub == epub || !epub))
-        {
+        if (sub->cb == cb && (sub->user_data == user_data || !user_data)) {
             /* If the worker thread or pjmedia_event_publish() API is
              * in the process of distributing events, make sure that
              * its pointer to the next subscriber stays valid.
@@ -313,16 +534,116 @@ pjmedia_event_unsubscribe(pjmedia_event_mgr *mgr,
                 mgr->pub_next_sub = sub->next;
             pj_list_erase(sub);
             pj_list_push_back(&mgr->free_esub_list, sub);
-            if (user_data && epub)
-                break;
+            if (user_data)
+                return PJ_TRUE;
         }
 	sub = next;
     }
+
+    return PJ_FALSE;
+}
+
+PJ_DEF(pj_status_t)
+pjmedia_event_unsubscribe(pjmedia_event_mgr *mgr,
+                          pjmedia_event_cb *cb,
+                          void *user_data,
+                          void *epub)
+{
+    epub_entry *pub;
+
+    PJ_ASSERT_RETURN(cb, PJ_EINVAL);
+
+    if (!mgr) mgr = pjmedia_event_mgr_instance();
+    PJ_ASSERT_RETURN(mgr, PJ_EINVAL);
+
+    pj_mutex_lock(mgr->mutex);
+
+    if (epub) {
+        pub = (epub_entry*) pj_hash_get(mgr->epub_table, &epub,
+                                        sizeof(epub), NULL);
+        if (pub) {
+            event_mgr_unsubscribe_list(mgr, &pub->subs, cb, user_data);
+            epub_entry_release(mgr, pub);
+        }
+    } else {
+        pj_hash_iterator_t it_buf, *it;
+
+        event_mgr_unsubscribe_list(mgr, &mgr->any_esub_list, cb, user_data);
+
+        /* Entries may be released while iterating, so get the next one
+         * first.
+         */
+        it = pj_hash_first(mgr->epub_table, &it_buf);
+        while (it) {
+            pub = (epub_entry*) pj_hash_this(mgr->epub_table, it);
+            it = pj_hash_next(mgr->epub_table, it);
+            event_mgr_unsubscribe_list(mgr, &pub->subs, cb, user_data);
+            epub_entry_release(mgr, pub);
+        }
+    }
+
     pj_mutex_unlock(mgr->mutex);
 
     return PJ_SUCCESS;
 }
 
+/* Post an event to the worker thread, waiting a while for room if the
+ * queue is congested.
+ */
+static void event_mgr_post_event(pjmedia_event_mgr *mgr,
+                                 const pjmedia_event *event)
+{
+    pj_bool_t queued, was_empty, timed_out = PJ_FALSE;
+
+    pj_mutex_lock(mgr->q_mutex);
+
+    /* Back-pressure. The worker thread itself must not wait, and nobody
+     * waits forever, as the publisher may hold locks the subscribers need.
+     * Then the event is queued anyway rather than lost. The wait is
+     * measured rather than counted in sleeps, as sleeps may take longer.
+     */
+    if (mgr->ev_queue_len >= PJMEDIA_EVENT_MGR_MAX_QUEUED_EVENTS &&
+        pj_thread_this() != mgr->thread)
+    {
+        pj_timestamp start, now;
+
+        pj_get_timestamp(&start);
+        do {
+            pj_mutex_unlock(mgr->q_mutex);
+            pj_thread_sleep(1);
+            pj_mutex_lock(mgr->q_mutex);
+
+            pj_get_timestamp(&now);
+            if (pj_elapsed_msec(&start, &now) >=
+                PJMEDIA_EVENT_MGR_MAX_POST_WAIT_MSEC)
+            {
+                timed_out = PJ_TRUE;
+                break;
+            }
+        } while (mgr->ev_queue_len >= PJMEDIA_EVENT_MGR_MAX_QUEUED_EVENTS);
+    }
+
+    if (timed_out &&
+        mgr->ev_queue_len >= PJMEDIA_EVENT_MGR_MAX_QUEUED_EVENTS)
+    {
+        char ev_name[5];
+
+        PJ_LOG(4, (THIS_FILE, "Event queue congested, %u events pending "
+                              "when posting event %s from publisher [0x%p]",
+                              mgr->ev_queue_len,
+                              pjmedia_fourcc_name(event->type, ev_name),
+                              event->epub));
+    }
+
+    queued = event_queue_post(mgr, event, &was_empty);
+
+    pj_mutex_unlock(mgr->q_mutex);
+
+    /* The worker drains the queue on each wakeup */
+    if (queued && was_empty)
+        pj_sem_post(mgr->sem);
+}
+
 PJ_DEF(pj_status_t) pjmedia_event_publish( pjmedia_event_mgr *mgr,
                                            void *epub,
                                            pjmedia_event *event,
@@ -337,40 +658,59 @@ PJ_DEF(pj_status_t) pjmedia_event_publish( pjmedia_event_mgr *mgr,
 
     event->epub = epub;
 
+    /* Without worker thread, posted events are delivered right away */
+    if ((flag & PJMEDIA_EVENT_PUBLISH_POST_EVENT) && mgr->thread) {
+        event_mgr_post_event(mgr, event);
+        return PJ_SUCCESS;
+    }
+
     pj_mutex_lock(mgr->mutex);
-    if (flag & PJMEDIA_EVENT_PUBLISH_POST_EVENT) {
-        if (event_queue_add_event(&mgr->ev_queue, event) == PJ_SUCCESS)
-            pj_sem_post(mgr->sem);
+
+    /* For nested pjmedia_event_publish() calls, i.e. calling publish()
+     * inside the subscriber's callback, the function will only add
+     * the event to the event queue of the first publish() call. It
+     * is the first publish() call that will be responsible to
+     * distribute the events.
+     */
+    if (mgr->pub_ev_queue) {
+        event_node *node;
+
+        pj_mutex_lock(mgr->q_mutex);
+        node = event_node_alloc(mgr);
+        pj_mutex_unlock(mgr->q_mutex);
+
+        pj_memcpy(&node->ev, event, sizeof(*event));
+        pj_list_push_back(mgr->pub_ev_queue, node);
     } else {
-        /* For nested pjmedia_event_publish() calls, i.e. calling publish()
-         * inside the subscriber's callback, the function will only add
-         * the event to the event queue of the first publish() call. It
-         * is the first publish() call that will be responsible to
-         * distribute the events.
-         */
-        if (mgr->pub_ev_queue) {
-            event_queue_add_event(mgr->pub_ev_queue, event);
-        } else {
-            static event_queue ev_queue;
-            pj_status_t status;
-
-            ev_queue.head = ev_queue.tail = 0;
-            ev_queue.is_full = PJ_FALSE;
-            mgr->pub_ev_queue = &ev_queue;
-
-            event_queue_add_event(mgr->pub_ev_queue, event);
-
-            do {
-                status = event_mgr_distribute_events(mgr, mgr->pub_ev_queue,
-                                                     &mgr->pub_next_sub,
-                                                     PJ_FALSE);
-                if (status != PJ_SUCCESS && err == PJ_SUCCESS)
-	            err = status;
-            } while(ev_queue.head != ev_queue.tail || ev_queue.is_full);
-
-            mgr->pub_ev_queue = NULL;
+        event_node ev_queue;
+        pj_status_t status;
+
+        pj_list_init(&ev_queue);
+        mgr->pub_ev_queue = &ev_queue;
+
+        status = event_mgr_distribute_event(mgr, event, &mgr->pub_next_sub,
+                                            PJ_FALSE);
+        if (status != PJ_SUCCESS && err == PJ_SUCCESS)
+            err = status;
+
+        while (!pj_list_empty(&ev_queue)) {
+            event_node *node = ev_queue.next;
+
+            status = event_mgr_distribute_event(mgr, &node->ev,
+                                                &mgr->pub_next_sub,
+                                                PJ_FALSE);
+            if (status != PJ_SUCCESS && err == PJ_SUCCESS)
+                err = status;
+
+            pj_list_erase(node);
+            pj_mutex_lock(mgr->q_mutex);
+            pj_list_push_back(&mgr->free_ev_list, node);
+            pj_mutex_unlock(mgr->q_mutex);
         }
+
+        mgr->pub_ev_queue = NULL;
     }
+
     pj_mutex_unlock(mgr->mutex);
 
     return err;
@@ -53,6 +53,8 @@ static const struct ffmpeg_fmt_table_t
     { PJMEDIA_FORMAT_UYVY, PIX_FMT_UYVY422},
     { PJMEDIA_FORMAT_I420, PIX_FMT_YUV420P},
     //{ PJMEDIA_FORMAT_YV12, PIX_FMT_YUV420P},
+    { PJMEDIA_FORMAT_NV12, PIX_FMT_NV12},
+    { PJMEDIA_FORMAT_NV21, PIX_FMT_NV21},
     { PJMEDIA_FORMAT_I422, PIX_FMT_YUV422P},
     { PJMEDIA_FORMAT_I420JPEG, PIX_FMT_YUVJ420P},
     { PJMEDIA_FORMAT_I422JPEG, PIX_FMT_YUVJ422P},
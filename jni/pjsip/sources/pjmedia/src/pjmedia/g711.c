@@ -86,6 +86,11 @@ static pj_status_t  g711_recover( pjmedia_codec *codec,
 				  unsigned output_buf_len,
 				  struct pjmedia_frame *output);
 #endif
+static pj_status_t  g711_decode_frames( pjmedia_codec *codec,
+					unsigned frame_cnt,
+					const struct pjmedia_frame input[],
+					unsigned output_buf_len,
+					struct pjmedia_frame *output);
 
 /* Definition for G711 codec operations. */
 static pjmedia_codec_op g711_op = 
@@ -98,10 +103,11 @@ static pjmedia_codec_op g711_op =
     &g711_encode,
     &g711_decode,
 #if !PLC_DISABLED
-    &g711_recover
+    &g711_recover,
 #else
-    NULL
+    NULL,
 #endif
+    &g711_decode_frames
 };
 
 /* Definition for G711 codec factory operations. */
@@ -595,6 +601,70 @@ static pj_status_t  g711_decode(pjmedia_codec *codec,
     return PJ_SUCCESS;
 }
 
+static pj_status_t  g711_decode_frames(pjmedia_codec *codec,
+				       unsigned frame_cnt,
+				       const struct pjmedia_frame input[],
+				       unsigned output_buf_len,
+				       struct pjmedia_frame *output)
+{
+    struct g711_private *priv = (struct g711_private*) codec->codec_data;
+    pj_int16_t *dst = (pj_int16_t*) output->buf;
+    unsigned i;
+
+    PJ_ASSERT_RETURN(output_buf_len >= frame_cnt * SAMPLES_PER_FRAME * 2,
+		     PJMEDIA_CODEC_EPCMTOOSHORT);
+
+#if defined(PJMEDIA_HAS_ALAW_ULAW_TABLE) && PJMEDIA_HAS_ALAW_ULAW_TABLE!=0
+    {
+	const pj_int16_t *tab;
+	unsigned j;
+
+	/* Pick the table once for all frames, so that the loop over the
+	 * samples is a plain lookup.
+	 */
+	if (priv->pt == PJMEDIA_RTP_PT_PCMA)
+	    tab = pjmedia_alaw2linear_tab;
+	else if (priv->pt == PJMEDIA_RTP_PT_PCMU)
+	    tab = pjmedia_ulaw2linear_tab;
+	else
+	    return PJMEDIA_EINVALIDPT;
+
+	for (i=0; i<frame_cnt; ++i) {
+	    const pj_uint8_t *src = (const pj_uint8_t*) input[i].buf;
+
+	    PJ_ASSERT_RETURN(input[i].size == FRAME_SIZE, 
+			     PJMEDIA_CODEC_EFRMINLEN);
+
+	    for (j=0; j<FRAME_SIZE; ++j)
+		dst[j] = tab[src[j]];
+
+#if !PLC_DISABLED
+	    if (priv->plc_enabled)
+		pjmedia_plc_save(priv->plc, dst);
+#endif
+	    dst += SAMPLES_PER_FRAME;
+	}
+    }
+#else
+    for (i=0; i<frame_cnt; ++i) {
+	pjmedia_frame frm;
+	pj_status_t status;
+
+	frm.buf = dst;
+	status = g711_decode(codec, &input[i], SAMPLES_PER_FRAME * 2, &frm);
+	if (status != PJ_SUCCESS)
+	    return status;
+	dst += SAMPLES_PER_FRAME;
+    }
+#endif
+
+    output->type = PJMEDIA_FRAME_TYPE_AUDIO;
+    output->size = frame_cnt * SAMPLES_PER_FRAME * 2;
+    output->timestamp = input[0].timestamp;
+
+    return PJ_SUCCESS;
+}
+
 #if !PLC_DISABLED
 static pj_status_t  g711_recover( pjmedia_codec *codec,
 				  unsigned output_buf_len,
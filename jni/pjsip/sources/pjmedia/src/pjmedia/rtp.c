@@ -168,6 +168,11 @@ PJ_DEF(pj_status_t) pjmedia_rtp_decode_rtp( pjmedia_rtp_session *ses,
     if ((*hdr)->x) {
 	pjmedia_rtp_ext_hdr *ext = (pjmedia_rtp_ext_hdr*) 
 				    (((pj_uint8_t*)pkt) + offset);
+
+	/* Don't read the extension header past the end of packet */
+	if (offset + (int)sizeof(pjmedia_rtp_ext_hdr) > pkt_len)
+	    return PJMEDIA_RTP_EINLEN;
+
 	offset += ((pj_ntohs(ext->length)+1) * sizeof(pj_uint32_t));
     }
 
@@ -192,6 +197,147 @@ PJ_DEF(pj_status_t) pjmedia_rtp_decode_rtp( pjmedia_rtp_session *ses,
 }
 
 
+PJ_DEF(pj_status_t) pjmedia_rtp_decode_ext(const void *pkt, int pkt_len,
+					   pjmedia_rtp_ext_elem elem[],
+					   unsigned *count)
+{
+    const pjmedia_rtp_hdr *hdr = (const pjmedia_rtp_hdr*)pkt;
+    const pjmedia_rtp_ext_hdr *ext;
+    const pj_uint8_t *p, *end;
+    pj_uint16_t profile;
+    unsigned max_cnt;
+    int offset;
+
+    PJ_ASSERT_RETURN(pkt && elem && count, PJ_EINVAL);
+
+    max_cnt = *count;
+    *count = 0;
+
+    if (pkt_len < (int)sizeof(pjmedia_rtp_hdr) || !hdr->x)
+	return PJ_SUCCESS;
+
+    offset = sizeof(pjmedia_rtp_hdr) + (hdr->cc * sizeof(pj_uint32_t));
+    if (offset + (int)sizeof(pjmedia_rtp_ext_hdr) > pkt_len)
+	return PJMEDIA_RTP_EINLEN;
+
+    ext = (const pjmedia_rtp_ext_hdr*)(((const pj_uint8_t*)pkt) + offset);
+    p = (const pj_uint8_t*)(ext + 1);
+    end = p + pj_ntohs(ext->length) * sizeof(pj_uint32_t);
+    if (end > ((const pj_uint8_t*)pkt) + pkt_len)
+	return PJMEDIA_RTP_EINLEN;
+
+    profile = pj_ntohs(ext->profile_data);
+
+    if (profile == PJMEDIA_RTP_EXT_ONE_BYTE) {
+	while (p < end && *count < max_cnt) {
+	    unsigned id = (*p >> 4), len = (*p & 0x0F) + 1;
+
+	    /* Padding byte */
+	    if (*p == 0) {
+		++p;
+		continue;
+	    }
+
+	    /* ID 15 is reserved and terminates the processing */
+	    if (id == 15)
+		break;
+
+	    if (p + 1 + len > end)
+		return PJMEDIA_RTP_EINLEN;
+
+	    elem[*count].id = (pj_uint8_t)id;
+	    elem[*count].len = (pj_uint8_t)len;
+	    elem[*count].data = p + 1;
+	    ++(*count);
+
+	    p += 1 + len;
+	}
+
+    } else if ((profile & 0xFFF0) == PJMEDIA_RTP_EXT_TWO_BYTE) {
+	while (p < end && *count < max_cnt) {
+	    unsigned len;
+
+	    /* Padding byte */
+	    if (*p == 0) {
+		++p;
+		continue;
+	    }
+
+	    if (p + 2 > end)
+		return PJMEDIA_RTP_EINLEN;
+
+	    len = p[1];
+	    if (p + 2 + len > end)
+		return PJMEDIA_RTP_EINLEN;
+
+	    elem[*count].id = p[0];
+	    elem[*count].len = (pj_uint8_t)len;
+	    elem[*count].data = p + 2;
+	    ++(*count);
+
+	    p += 2 + len;
+	}
+
+    } else {
+	return PJ_ENOTSUP;
+    }
+
+    return PJ_SUCCESS;
+}
+
+
+PJ_DEF(pj_status_t) pjmedia_rtp_encode_ext(const pjmedia_rtp_ext_elem elem[],
+					   unsigned count,
+					   void *buf, unsigned buf_size,
+					   unsigned *len)
+{
+    pjmedia_rtp_ext_hdr *ext = (pjmedia_rtp_ext_hdr*)buf;
+    pj_uint8_t *p;
+    pj_bool_t one_byte = PJ_TRUE;
+    unsigned i, data_len = 0, total;
+
+    PJ_ASSERT_RETURN(elem && count && buf && len, PJ_EINVAL);
+
+    /* Use the one-byte format if all elements fit in it */
+    for (i=0; i<count; ++i) {
+	PJ_ASSERT_RETURN(elem[i].id != 0, PJ_EINVAL);
+	if (elem[i].id > 14 || elem[i].len == 0 || elem[i].len > 16)
+	    one_byte = PJ_FALSE;
+	data_len += elem[i].len;
+    }
+
+    data_len += count * (one_byte ? 1 : 2);
+    total = sizeof(pjmedia_rtp_ext_hdr) + ((data_len + 3) & ~3);
+    if (total > buf_size)
+	return PJ_ETOOSMALL;
+
+    ext->profile_data = pj_htons((pj_uint16_t)(one_byte ?
+						PJMEDIA_RTP_EXT_ONE_BYTE :
+						PJMEDIA_RTP_EXT_TWO_BYTE));
+    ext->length = pj_htons((pj_uint16_t)
+			   ((total - sizeof(pjmedia_rtp_ext_hdr)) / 4));
+
+    p = (pj_uint8_t*)(ext + 1);
+    for (i=0; i<count; ++i) {
+	if (one_byte) {
+	    *p++ = (pj_uint8_t)((elem[i].id << 4) | (elem[i].len - 1));
+	} else {
+	    *p++ = elem[i].id;
+	    *p++ = elem[i].len;
+	}
+	pj_memcpy(p, elem[i].data, elem[i].len);
+	p += elem[i].len;
+    }
+
+    /* Zero padding */
+    while (p < ((pj_uint8_t*)buf) + total)
+	*p++ = 0;
+
+    *len = total;
+    return PJ_SUCCESS;
+}
+
+
 PJ_DEF(void) pjmedia_rtp_session_update( pjmedia_rtp_session *ses, 
 					 const pjmedia_rtp_hdr *hdr,
 					 pjmedia_rtp_status *p_seq_st)
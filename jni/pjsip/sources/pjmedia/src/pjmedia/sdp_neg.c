@@ -593,6 +593,73 @@ static void update_media_direction(pj_pool_t *pool,
 }
 
 
+/* Get the URI of "a=extmap" attribute value, i.e. the second token. */
+static void get_extmap_uri(const pjmedia_sdp_attr *a, pj_str_t *uri)
+{
+    const char *p = a->value.ptr, *end = a->value.ptr + a->value.slen;
+
+    while (p < end && !pj_isspace(*p)) ++p;
+    while (p < end && pj_isspace(*p)) ++p;
+    uri->ptr = (char*)p;
+    while (p < end && !pj_isspace(*p)) ++p;
+    uri->slen = p - uri->ptr;
+}
+
+/* Only keep the RTP header extensions (RFC 5285) in the answer that are
+ * also in the offer, and use the ID chosen by the offerer for them.
+ */
+static void update_extmap(pj_pool_t *pool,
+			  const pjmedia_sdp_media *offer,
+			  pjmedia_sdp_media *answer)
+{
+    unsigned i, j;
+
+    for (i=0; i<answer->attr_count; ) {
+	pjmedia_sdp_attr *a = answer->attr[i];
+	const pjmedia_sdp_attr *oa = NULL;
+	pj_str_t uri, ouri;
+
+	if (pj_strcmp2(&a->name, "extmap") != 0) {
+	    ++i;
+	    continue;
+	}
+
+	get_extmap_uri(a, &uri);
+	for (j=0; j<offer->attr_count; ++j) {
+	    if (pj_strcmp2(&offer->attr[j]->name, "extmap") != 0)
+		continue;
+	    get_extmap_uri(offer->attr[j], &ouri);
+	    if (pj_strcmp(&uri, &ouri) == 0) {
+		oa = offer->attr[j];
+		break;
+	    }
+	}
+
+	if (oa == NULL) {
+	    pjmedia_sdp_media_remove_attr(answer, a);
+	    continue;
+	}
+
+	if (pj_strtoul(&oa->value) != pj_strtoul(&a->value)) {
+	    /* "<offerer's ID> <our URI and extension attributes>" */
+	    pj_str_t value;
+	    unsigned id_len = (unsigned)(uri.ptr - a->value.ptr);
+	    char id[12];
+	    int len;
+
+	    len = pj_utoa(pj_strtoul(&oa->value), id);
+	    value.ptr = (char*)pj_pool_alloc(pool, len + 1 + a->value.slen);
+	    pj_memcpy(value.ptr, id, len);
+	    value.ptr[len] = ' ';
+	    pj_memcpy(value.ptr + len + 1, uri.ptr, a->value.slen - id_len);
+	    value.slen = len + 1 + a->value.slen - id_len;
+	    a->value = value;
+	}
+	++i;
+    }
+}
+
+
 /* Update single local media description to after receiving answer
  * from remote.
  */
@@ -1235,6 +1302,9 @@ static pj_status_t match_offer(pj_pool_t *pool,
     }
     answer->desc.fmt_count = pt_answer_count;
 
+    /* Only answer the RTP header extensions that are offered. */
+    update_extmap(pool, offer, answer);
+
 #if PJMEDIA_SDP_NEG_ANSWER_SYMMETRIC_PT
     apply_answer_symmetric_pt(pool, answer, pt_answer_count,
 			      pt_offer, pt_answer);
@@ -19,10 +19,12 @@
  */
 #include <pjmedia/stream.h>
 #include <pjmedia/errno.h>
+#include <pjmedia/event.h>
 #include <pjmedia/rtp.h>
 #include <pjmedia/rtcp.h>
 #include <pjmedia/jbuf.h>
 #include <pjmedia/stream_common.h>
+#include <pjmedia/silencedet.h>
 #include <pj/array.h>
 #include <pj/assert.h>
 #include <pj/ctype.h>
@@ -76,6 +78,17 @@
 /* Number of DTMF E bit transmissions */
 #define DTMF_EBIT_RETRANSMIT_CNT	3
 
+/* Number of received frames whose RFC 6464 audio level is remembered,
+ * so that the level can be matched with the frame when it comes out of
+ * the jitter buffer. Must be a power of two.
+ */
+#define AUDIO_LEVEL_HIST_CNT		64
+
+/* Size of the RTP header extension block carrying the audio level:
+ * 4 bytes extension header, 2 bytes one-byte element, 2 bytes padding.
+ */
+#define AUDIO_LEVEL_EXT_LEN		8
+
 /**
  * Media channel.
  */
@@ -116,6 +129,7 @@ struct pjmedia_stream
     pjmedia_channel	    *dec;	    /**< Decoding channel.	    */
 
     pj_pool_t		    *own_pool;	    /**< Only created if not given  */
+    pj_pool_t		    *pool;	    /**< Pool for stream buffers.   */
 
     pjmedia_dir		     dir;	    /**< Stream direction.	    */
     void		    *user_data;	    /**< User data.		    */
@@ -128,6 +142,8 @@ struct pjmedia_stream
     pj_int16_t		    *enc_buf;	    /**< Encoding buffer, when enc's
 						 ptime is different than dec.
 						 Otherwise it's NULL.	    */
+    pj_int16_t		    *enc_buf_mem;   /**< Memory of enc_buf, kept
+						 while it is not used.	    */
 
     unsigned		     enc_samples_per_pkt;
     unsigned		     enc_buf_size;  /**< Encoding buffer size, in
@@ -147,11 +163,21 @@ struct pjmedia_stream
     pj_uint32_t		     ts_vad_disabled;/**< TS when VAD was disabled. */
     pj_uint32_t		     tx_duration;   /**< TX duration in timestamp.  */
 
+    pj_mutex_t		    *enc_mutex;	    /**< Protects the encoder side
+						 from stream updates.	    */
     pj_mutex_t		    *jb_mutex;
     pjmedia_jbuf	    *jb;	    /**< Jitter buffer.		    */
     char		     jb_last_frm;   /**< Last frame type from jb    */
     unsigned		     jb_last_frm_cnt;/**< Last JB frame type counter*/
 
+    unsigned		     dec_batch_max; /**< Max # of frames decoded in
+						 one call, zero to decode
+						 frames one by one.	    */
+    pj_uint8_t		    *dec_batch_buf; /**< Encoded frames of a batch. */
+    pjmedia_frame	    *dec_batch_frm; /**< Frames of a batch.	    */
+    unsigned		     dec_batch_size;/**< Size of dec_batch_buf.	    */
+    unsigned		     dec_batch_frm_cnt;/**< Count of dec_batch_frm. */
+
     pjmedia_rtcp_session     rtcp;	    /**< RTCP for incoming RTP.	    */
 
     pj_uint32_t		     rtcp_last_tx;  /**< RTCP tx time in timestamp  */
@@ -226,6 +252,31 @@ struct pjmedia_stream
 #endif
 
     pj_uint32_t		     rtp_rx_last_ts;        /**< Last received RTP timestamp*/
+
+    /* RFC 6464 audio level: */
+    int			     rx_audio_level;/**< Last received level, or -1.*/
+    struct {
+	int		     seq;	    /**< Frame sequence, or -1.	    */
+	pj_uint8_t	     level;	    /**< Level in -dBov.	    */
+    }			     rx_level_hist[AUDIO_LEVEL_HIST_CNT];
+					    /**< Level of received frames.  */
+    unsigned		     rx_silent_cnt; /**< # of consecutive frames
+						 below audio_level_skip.    */
+    unsigned		     rx_skip_hangover;/**< Silent frames to decode
+						 before skipping, in frames.*/
+
+    /* Adaptive packetization: */
+    unsigned		     ptime_base_fpp;/**< Negotiated frames per pkt. */
+    unsigned		     ptime_step_fpp;/**< Frames in a port frame.    */
+    unsigned		     ptime_max_fpp; /**< Max frames per packet, or
+						 zero if not adaptive.	    */
+    unsigned		     ptime_new_fpp; /**< Frames per packet to switch
+						 to at the next packet.	    */
+    unsigned		     ptime_good_cnt;/**< # of consecutive reports
+						 without congestion.	    */
+    unsigned		     ptime_rr_cnt;  /**< RTCP RR count last seen.   */
+    pj_uint32_t		     ptime_tx_pkt;  /**< Packets sent at last RR.   */
+    unsigned		     ptime_tx_loss; /**< Loss reported at last RR.  */
 };
 
 
@@ -256,6 +307,8 @@ static pj_status_t send_rtcp(pjmedia_stream *stream,
 			     pj_bool_t with_bye,
 			     pj_bool_t with_xr);
 
+static void init_enc_buf(pjmedia_stream *stream, pj_pool_t *pool);
+
 
 #if TRACE_JB
 
@@ -472,11 +525,125 @@ static void send_keep_alive_packet(pjmedia_stream *stream)
  * This callback is called by sound device's player thread when it
  * needs to feed the player with some frames.
  */
+/*
+ * Calculate the audio level of a PCM frame, in -dBov (RFC 6464). This
+ * uses the average absolute sample value rather than RMS, which is close
+ * enough for speaker detection and avoids floating point math.
+ */
+static pj_uint8_t calc_audio_level(const pjmedia_frame *frame)
+{
+    /* 32767 * 10^(-n/20) for n = 1..5 */
+    static const pj_int32_t thresh[] = { 29204, 26028, 23197, 20675, 18426 };
+    pj_int32_t avg;
+    unsigned i, level = 0;
+
+    if (frame->buf == NULL || frame->size < BYTES_PER_SAMPLE)
+	return 127;
+
+    avg = pjmedia_calc_avg_signal((const pj_int16_t*)frame->buf,
+				  frame->size / BYTES_PER_SAMPLE);
+    if (avg <= 0)
+	return 127;
+
+    /* Each doubling of the signal is (about) 6 dB */
+    while (avg < 16384 && level < 127) {
+	avg <<= 1;
+	level += 6;
+    }
+    for (i=0; i<PJ_ARRAY_SIZE(thresh) && avg < thresh[i]; ++i)
+	++level;
+
+    return (pj_uint8_t)(level > 127 ? 127 : level);
+}
+
+
+/*
+ * Get the audio level (RFC 6464) from the RTP header extension of an
+ * incoming packet, or -1 if the packet doesn't have it.
+ */
+static int get_rx_audio_level(pjmedia_stream *stream,
+			      const void *pkt, int pkt_len)
+{
+    pjmedia_rtp_ext_elem elem[PJMEDIA_RTP_EXT_MAX_ELEM];
+    unsigned i, count = PJ_ARRAY_SIZE(elem);
+
+    if (pjmedia_rtp_decode_ext(pkt, pkt_len, elem, &count) != PJ_SUCCESS)
+	return -1;
+
+    for (i=0; i<count; ++i) {
+	if (elem[i].id == stream->si.rx_audio_level_id && elem[i].len >= 1)
+	    return elem[i].data[0] & 0x7F;
+    }
+
+    return -1;
+}
+
+
+/*
+ * Check whether the decoder keeps no state between frames, so frames may
+ * be left out without affecting the ones that follow.
+ */
+static pj_bool_t codec_is_stateless(const pjmedia_codec_info *fmt)
+{
+    return fmt->pt == PJMEDIA_RTP_PT_PCMU || fmt->pt == PJMEDIA_RTP_PT_PCMA ||
+	   pj_stricmp2(&fmt->encoding_name, "L16") == 0;
+}
+
+
+/*
+ * Check whether a frame from the jitter buffer may be skipped without
+ * decoding, i.e. the remote has said it is silent, and it has been
+ * silent for longer than the hangover period. Frames of stateful codecs
+ * are always decoded, as the decoder would otherwise resume with stale
+ * state when speech comes back.
+ */
+static pj_bool_t skip_silent_frame(pjmedia_stream *stream, int frame_seq)
+{
+    unsigned idx = (unsigned)frame_seq & (AUDIO_LEVEL_HIST_CNT-1);
+
+    if (!codec_is_stateless(&stream->si.fmt) ||
+	stream->rx_level_hist[idx].seq != frame_seq ||
+	stream->rx_level_hist[idx].level < stream->si.audio_level_skip)
+    {
+	stream->rx_silent_cnt = 0;
+	return PJ_FALSE;
+    }
+
+    return ++stream->rx_silent_cnt > stream->rx_skip_hangover;
+}
+
+
+/*
+ * Decode the normal frames that get_frame() has collected, in one call.
+ */
+static void decode_frame_batch(pjmedia_stream *stream, unsigned frame_cnt,
+			       pj_int16_t *out, unsigned out_size,
+			       unsigned samples_per_frame)
+{
+    pjmedia_frame frame_out;
+    pj_status_t status;
+
+    frame_out.buf = out;
+    frame_out.size = out_size;
+    status = pjmedia_codec_decode_frames(stream->codec, frame_cnt,
+					 stream->dec_batch_frm, out_size,
+					 &frame_out);
+    if (status != PJ_SUCCESS) {
+	LOGERR_((stream->port.info.name.ptr, "codec decode_frames() error",
+		 status));
+
+	pjmedia_zero_samples(out, frame_cnt * samples_per_frame);
+    }
+}
+
+
 static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
 {
     pjmedia_stream *stream = (pjmedia_stream*) port->port_data.pdata;
     pjmedia_channel *channel = stream->dec;
     unsigned samples_count, samples_per_frame, samples_required;
+    unsigned skipped_samples = 0;
+    unsigned batch_cnt = 0, batch_pos = 0;
     pj_int16_t *p_out_samp;
     pj_status_t status;
 
@@ -507,15 +674,29 @@ static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
 	char frame_type;
 	pj_size_t frame_size;
 	pj_uint32_t bit_info;
+	int frame_seq = -1;
+	void *frame_buf = channel->out_pkt;
+
+	/* When decoding in batches, each frame needs its own buffer */
+	if (stream->dec_batch_max)
+	    frame_buf = stream->dec_batch_buf + batch_cnt * stream->frame_size;
 
 	/* Get frame from jitter buffer. */
-	pjmedia_jbuf_get_frame2(stream->jb, channel->out_pkt, &frame_size,
-			        &frame_type, &bit_info);
+	pjmedia_jbuf_get_frame3(stream->jb, frame_buf, &frame_size,
+			        &frame_type, &bit_info, NULL, &frame_seq);
 
 #if TRACE_JB
 	trace_jb_get(stream, frame_type, frame_size);
 #endif
 
+	/* The PLC below needs the frames before it decoded first */
+	if (batch_cnt && frame_type != PJMEDIA_JB_NORMAL_FRAME) {
+	    decode_frame_batch(stream, batch_cnt, p_out_samp + batch_pos,
+			       frame->size - batch_pos*BYTES_PER_SAMPLE,
+			       samples_per_frame);
+	    batch_cnt = 0;
+	}
+
 	if (frame_type == PJMEDIA_JB_MISSING_FRAME) {
 	    
 	    /* Activate PLC */
@@ -674,22 +855,62 @@ static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
 
 	    stream->plc_cnt = 0;
 
-	    /* Decode */
-	    frame_in.buf = channel->out_pkt;
-	    frame_in.size = frame_size;
-	    frame_in.bit_info = bit_info;
-	    frame_in.type = PJMEDIA_FRAME_TYPE_AUDIO;  /* ignored */
-
-	    frame_out.buf = p_out_samp + samples_count;
-	    frame_out.size = frame->size - samples_count*BYTES_PER_SAMPLE;
-	    status = pjmedia_codec_decode( stream->codec, &frame_in,
-					   frame_out.size, &frame_out);
-	    if (status != 0) {
-		LOGERR_((port->info.name.ptr, "codec decode() error", 
-			 status));
-
+	    if (stream->si.audio_level_skip &&
+		skip_silent_frame(stream, frame_seq))
+	    {
+		/* Remote says this frame is silent, don't bother decoding */
+		if (batch_cnt) {
+		    decode_frame_batch(stream, batch_cnt,
+				       p_out_samp + batch_pos,
+				       frame->size - batch_pos*BYTES_PER_SAMPLE,
+				       samples_per_frame);
+		    batch_cnt = 0;
+		}
 		pjmedia_zero_samples(p_out_samp + samples_count, 
 				     samples_per_frame);
+		skipped_samples += samples_per_frame;
+
+	    } else if (stream->dec_batch_max) {
+		/* Keep the frame, to be decoded together with the normal
+		 * frames that follow it.
+		 */
+		pjmedia_frame *f = &stream->dec_batch_frm[batch_cnt];
+
+		if (batch_cnt == 0)
+		    batch_pos = samples_count;
+
+		f->buf = frame_buf;
+		f->size = frame_size;
+		f->bit_info = bit_info;
+		f->type = PJMEDIA_FRAME_TYPE_AUDIO;  /* ignored */
+		f->timestamp.u64 = 0;
+
+		if (++batch_cnt == stream->dec_batch_max) {
+		    decode_frame_batch(stream, batch_cnt,
+				       p_out_samp + batch_pos,
+				       frame->size - batch_pos*BYTES_PER_SAMPLE,
+				       samples_per_frame);
+		    batch_cnt = 0;
+		}
+
+	    } else {
+		/* Decode */
+		frame_in.buf = channel->out_pkt;
+		frame_in.size = frame_size;
+		frame_in.bit_info = bit_info;
+		frame_in.type = PJMEDIA_FRAME_TYPE_AUDIO;  /* ignored */
+
+		frame_out.buf = p_out_samp + samples_count;
+		frame_out.size = frame->size - samples_count*BYTES_PER_SAMPLE;
+		status = pjmedia_codec_decode( stream->codec, &frame_in,
+					       frame_out.size, &frame_out);
+		if (status != 0) {
+		    LOGERR_((port->info.name.ptr, "codec decode() error", 
+			     status));
+
+		    pjmedia_zero_samples(p_out_samp + samples_count, 
+					 samples_per_frame);
+		}
 	    }
 
 	    if (stream->jb_last_frm != frame_type) {
@@ -708,13 +929,21 @@ static pj_status_t get_frame( pjmedia_port *port, pjmedia_frame *frame)
     }
 
 
+    if (batch_cnt) {
+	decode_frame_batch(stream, batch_cnt, p_out_samp + batch_pos,
+			   frame->size - batch_pos*BYTES_PER_SAMPLE,
+			   samples_per_frame);
+    }
+
     /* Unlock jitter buffer mutex. */
     pj_mutex_unlock( stream->jb_mutex );
 
     /* Return PJMEDIA_FRAME_TYPE_NONE if we have no frames at all
-     * (it can happen when jitter buffer returns PJMEDIA_JB_ZERO_EMPTY_FRAME).
+     * (it can happen when jitter buffer returns PJMEDIA_JB_ZERO_EMPTY_FRAME),
+     * or when all the frames were skipped as silent, so that the
+     * conference bridge doesn't need to mix them.
      */
-    if (samples_count == 0) {
+    if (samples_count == 0 || skipped_samples >= samples_count) {
 	frame->type = PJMEDIA_FRAME_TYPE_NONE;
 	frame->size = 0;
     } else {
@@ -1034,8 +1263,17 @@ static pj_status_t send_rtcp(pjmedia_stream *stream,
 	}
     }
 
-    /* Send! */
-    status = pjmedia_transport_send_rtcp(stream->transport, pkt, len);
+    /* Send! The RTCP packet built in our own buffer may be protected in
+     * place by the transport.
+     */
+    if (pkt == stream->out_rtcp_pkt) {
+	status = pjmedia_transport_send_rtcp_inplace(
+				stream->transport, pkt, len,
+				stream->out_rtcp_pkt_size +
+				    PJMEDIA_STREAM_RESV_PAYLOAD_LEN - len);
+    } else {
+	status = pjmedia_transport_send_rtcp(stream->transport, pkt, len);
+    }
 
     return status;
 }
@@ -1129,8 +1367,7 @@ static void rebuffer(pjmedia_stream *stream,
     }
 
     /* How many samples are needed */
-    count = stream->codec_param.info.enc_ptime * 
-	    PJMEDIA_PIA_SRATE(&stream->port.info) / 1000;
+    count = stream->enc_samples_per_pkt;
 
     /* See if we have enough samples */
     if (stream->enc_buf_count >= count) {
@@ -1162,6 +1399,8 @@ static pj_status_t put_frame_imp( pjmedia_port *port,
     unsigned ts_len, rtp_ts_len, samples_per_frame;
     void *rtphdr;
     int rtphdrlen;
+    unsigned ext_len = 0;
+    pj_size_t pkt_len;
     int inc_timestamp = 0;
 
 
@@ -1214,8 +1453,29 @@ static pj_status_t put_frame_imp( pjmedia_port *port,
     rtp_ts_len = ts_len;
 #endif
 
+    /* Stamp the audio level (RFC 6464) of outgoing audio packets, in
+     * the header extension that goes right after the RTP header.
+     */
+    if (stream->si.tx_audio_level_id && !stream->tx_dtmf_count &&
+	frame->type == PJMEDIA_FRAME_TYPE_AUDIO)
+    {
+	pjmedia_rtp_ext_elem elem;
+	pj_uint8_t level = calc_audio_level(frame);
+
+	elem.id = (pj_uint8_t)stream->si.tx_audio_level_id;
+	elem.len = 1;
+	elem.data = &level;
+	status = pjmedia_rtp_encode_ext(&elem, 1,
+					((char*)channel->out_pkt) +
+					    sizeof(pjmedia_rtp_hdr),
+					AUDIO_LEVEL_EXT_LEN, &ext_len);
+	if (status != PJ_SUCCESS)
+	    ext_len = 0;
+    }
+
     /* Init frame_out buffer. */
-    frame_out.buf = ((char*)channel->out_pkt) + sizeof(pjmedia_rtp_hdr);
+    frame_out.buf = ((char*)channel->out_pkt) + sizeof(pjmedia_rtp_hdr) +
+		    ext_len;
     frame_out.size = 0;
 
     /* Calculate number of samples per frame */
@@ -1284,7 +1544,7 @@ static pj_status_t put_frame_imp( pjmedia_port *port,
 	/* Encode! */
 	status = pjmedia_codec_encode( stream->codec, &silence_frame,
 				       channel->out_pkt_size - 
-				       sizeof(pjmedia_rtp_hdr),
+				       sizeof(pjmedia_rtp_hdr) - ext_len,
 				       &frame_out);
 	if (status != PJ_SUCCESS) {
 	    LOGERR_((stream->port.info.name.ptr, 
@@ -1308,7 +1568,7 @@ static pj_status_t put_frame_imp( pjmedia_port *port,
 	/* Encode! */
 	status = pjmedia_codec_encode( stream->codec, frame, 
 				       channel->out_pkt_size - 
-				       sizeof(pjmedia_rtp_hdr),
+				       sizeof(pjmedia_rtp_hdr) - ext_len,
 				       &frame_out);
 	if (status != PJ_SUCCESS) {
 	    LOGERR_((stream->port.info.name.ptr, 
@@ -1348,9 +1608,11 @@ static pj_status_t put_frame_imp( pjmedia_port *port,
 	check_tx_rtcp(stream, pj_ntohl(channel->rtp.out_hdr.ts));
     }
 
-    /* Do nothing if we have nothing to transmit */
+    /* Do nothing if we have nothing to transmit. A frame that is still
+     * being collected by rebuffer() is not the start of silence.
+     */
     if (frame_out.size == 0) {
-	if (stream->is_streaming) {
+	if (stream->is_streaming && frame->type != PJMEDIA_FRAME_TYPE_NONE) {
 	    PJ_LOG(5,(stream->port.info.name.ptr,"Starting silence"));
 	    stream->is_streaming = PJ_FALSE;
 	}
@@ -1361,6 +1623,8 @@ static pj_status_t put_frame_imp( pjmedia_port *port,
 
     /* Copy RTP header to the beginning of packet */
     pj_memcpy(channel->out_pkt, rtphdr, sizeof(pjmedia_rtp_hdr));
+    if (ext_len)
+	((pjmedia_rtp_hdr*)channel->out_pkt)->x = 1;
 
     /* Special case for DTMF: timestamp remains constant for
      * the same event, and is only updated after a complete event
@@ -1382,9 +1646,12 @@ static pj_status_t put_frame_imp( pjmedia_port *port,
     stream->is_streaming = PJ_TRUE;
 
     /* Send the RTP packet to the transport. */
-    status = pjmedia_transport_send_rtp(stream->transport, channel->out_pkt,
-                                        frame_out.size +
-					    sizeof(pjmedia_rtp_hdr));
+    pkt_len = frame_out.size + sizeof(pjmedia_rtp_hdr) + ext_len;
+    status = pjmedia_transport_send_rtp_inplace(stream->transport,
+						channel->out_pkt, pkt_len,
+						channel->out_pkt_size +
+						PJMEDIA_STREAM_RESV_PAYLOAD_LEN -
+						pkt_len);
     if (status != PJ_SUCCESS) {
 	PJ_PERROR(4,(stream->port.info.name.ptr, status,
 		     "Error sending RTP"));
@@ -1404,6 +1671,36 @@ static pj_status_t put_frame_imp( pjmedia_port *port,
 }
 
 
+/*
+ * Change the packet duration to the one chosen by adapt_ptime(), and
+ * let the application know so that it can update the ptime in SDP.
+ * The encoding buffer must be empty.
+ */
+static void switch_ptime(pjmedia_stream *stream)
+{
+    unsigned ptime;
+
+    stream->codec_param.setting.frm_per_pkt = (pj_uint8_t)
+					      stream->ptime_new_fpp;
+    stream->ptime_new_fpp = 0;
+    init_enc_buf(stream, stream->pool);
+
+    ptime = stream->codec_param.setting.frm_per_pkt *
+	    stream->codec_param.info.frm_ptime;
+    PJ_LOG(4,(stream->port.info.name.ptr,
+	      "Packetization changed to %u ms", ptime));
+
+    if (pjmedia_event_mgr_instance()) {
+	pjmedia_event event;
+
+	pjmedia_event_init(&event, PJMEDIA_EVENT_PTIME_CHANGED, NULL, stream);
+	event.data.ptime_changed.ptime = ptime;
+	pjmedia_event_publish(NULL, stream, &event,
+			      PJMEDIA_EVENT_PUBLISH_POST_EVENT);
+    }
+}
+
+
 /**
  * put_frame()
  *
@@ -1417,8 +1714,22 @@ static pj_status_t put_frame( pjmedia_port *port,
     pjmedia_stream *stream = (pjmedia_stream*) port->port_data.pdata;
     pjmedia_frame tmp_zero_frame;
     unsigned samples_per_frame;
+    pj_status_t status;
 
-    samples_per_frame = stream->enc_samples_per_pkt;
+    /* The codec and the encoding buffer may be replaced by
+     * pjmedia_stream_update().
+     */
+    pj_mutex_lock(stream->enc_mutex);
+
+    /* Change the packetization between packets */
+    if (stream->ptime_new_fpp && stream->enc_buf_count == 0)
+	switch_ptime(stream);
+
+    /* Frames going to the encoding buffer have the port frame size */
+    if (stream->enc_buf != NULL)
+	samples_per_frame = PJMEDIA_PIA_SPF(&stream->port.info);
+    else
+	samples_per_frame = stream->enc_samples_per_pkt;
 
     /* http://www.pjsip.org/trac/ticket/56:
      *  when input is PJMEDIA_FRAME_TYPE_NONE, feed zero PCM frame
@@ -1474,7 +1785,8 @@ static pj_status_t put_frame( pjmedia_port *port,
      */
     if (stream->enc_buf != NULL) {
 	pjmedia_frame tmp_rebuffer_frame;
-	pj_status_t status = PJ_SUCCESS;
+
+	status = PJ_SUCCESS;
 
 	/* Copy original frame to temporary frame since we need 
 	 * to modify it.
@@ -1507,11 +1819,13 @@ static pj_status_t put_frame( pjmedia_port *port,
 	    }
 	}
 
-	return status;
-
     } else {
-	return put_frame_imp(port, frame);
+	status = put_frame_imp(port, frame);
     }
+
+    pj_mutex_unlock(stream->enc_mutex);
+
+    return status;
 }
 
 
@@ -1626,6 +1940,7 @@ static void on_rx_rtp( void *data,
     pjmedia_rtp_status seq_st;
     pj_status_t status;
     pj_bool_t pkt_discarded = PJ_FALSE;
+    int level = -1;
 
     /* Check for errors */
     if (bytes_read < 0) {
@@ -1707,6 +2022,10 @@ static void on_rx_rtp( void *data,
 	goto on_return;
     }
 
+    /* Get the audio level (RFC 6464) of the packet, if remote sends it */
+    if (stream->si.rx_audio_level_id && hdr->x)
+	level = get_rx_audio_level(stream, pkt, (int)bytes_read);
+
     /* Put "good" packet to jitter buffer, or reset the jitter buffer
      * when RTP session is restarted.
      */
@@ -1827,8 +2146,21 @@ static void on_rx_rtp( void *data,
 				    frames[i].bit_info, ext_seq, &discarded);
 	    if (discarded)
 		pkt_discarded = PJ_TRUE;
+
+	    /* Remember the level until the frame is taken out of the
+	     * jitter buffer.
+	     */
+	    if (level >= 0) {
+		unsigned idx = ext_seq & (AUDIO_LEVEL_HIST_CNT-1);
+
+		stream->rx_level_hist[idx].seq = (int)ext_seq;
+		stream->rx_level_hist[idx].level = (pj_uint8_t)level;
+	    }
 	}
 
+	if (level >= 0)
+	    stream->rx_audio_level = level;
+
 #if TRACE_JB
 	trace_jb_put(stream, hdr, payloadlen, count);
 #endif
@@ -1878,6 +2210,65 @@ on_return:
  * This callback is called by stream transport on receipt of packets
  * in the RTCP socket. 
  */
+/*
+ * Choose the packet duration from the loss and round trip time in the
+ * RTCP reports of remote. Under congestion the packets are made longer
+ * one port frame at a time, to save the per packet overhead, and they
+ * are made shorter again after several clean reports.
+ */
+static void adapt_ptime(pjmedia_stream *stream)
+{
+    const pjmedia_rtcp_stat *stat = &stream->rtcp.stat;
+    unsigned fpp, new_fpp, sent, lost, loss_pct, rtt;
+
+    pj_mutex_lock(stream->enc_mutex);
+
+    sent = stat->tx.pkt - stream->ptime_tx_pkt;
+    lost = stat->tx.loss > stream->ptime_tx_loss ?
+	   stat->tx.loss - stream->ptime_tx_loss : 0;
+    loss_pct = sent ? lost * 100 / sent : 0;
+    rtt = stat->rtt.n ? stat->rtt.last / 1000 : 0;
+
+    stream->ptime_rr_cnt = stat->tx.update_cnt;
+    stream->ptime_tx_pkt = stat->tx.pkt;
+    stream->ptime_tx_loss = stat->tx.loss;
+
+    fpp = stream->ptime_new_fpp ? stream->ptime_new_fpp :
+				  stream->codec_param.setting.frm_per_pkt;
+    new_fpp = fpp;
+
+    if (loss_pct >= PJMEDIA_STREAM_ADAPTIVE_PTIME_LOSS ||
+	rtt >= PJMEDIA_STREAM_ADAPTIVE_PTIME_RTT)
+    {
+	stream->ptime_good_cnt = 0;
+	if (fpp + stream->ptime_step_fpp <= stream->ptime_max_fpp)
+	    new_fpp = fpp + stream->ptime_step_fpp;
+
+    } else if (fpp > stream->ptime_base_fpp &&
+	       loss_pct * 2 < PJMEDIA_STREAM_ADAPTIVE_PTIME_LOSS &&
+	       rtt * 2 < PJMEDIA_STREAM_ADAPTIVE_PTIME_RTT)
+    {
+	if (++stream->ptime_good_cnt >= PJMEDIA_STREAM_ADAPTIVE_PTIME_HOLD) {
+	    stream->ptime_good_cnt = 0;
+	    new_fpp = fpp - stream->ptime_step_fpp;
+	}
+
+    } else {
+	stream->ptime_good_cnt = 0;
+    }
+
+    if (new_fpp != fpp) {
+	PJ_LOG(5,(stream->port.info.name.ptr, "Loss %u%%, RTT %u ms: "
+		  "switching to %u ms packets", loss_pct, rtt,
+		  new_fpp * stream->codec_param.info.frm_ptime));
+	stream->ptime_new_fpp =
+	    (new_fpp == stream->codec_param.setting.frm_per_pkt) ? 0 : new_fpp;
+    }
+
+    pj_mutex_unlock(stream->enc_mutex);
+}
+
+
 static void on_rx_rtcp( void *data,
                         void *pkt, 
                         pj_ssize_t bytes_read)
@@ -1892,6 +2283,293 @@ static void on_rx_rtcp( void *data,
     }
 
     pjmedia_rtcp_rx_rtcp(&stream->rtcp, pkt, bytes_read);
+
+    /* Adapt the packetization to the new report block */
+    if (stream->ptime_max_fpp &&
+	stream->rtcp.stat.tx.update_cnt != stream->ptime_rr_cnt)
+    {
+	adapt_ptime(stream);
+    }
+}
+
+
+/*
+ * Get the size of the buffer needed for outgoing packets.
+ */
+static unsigned get_out_pkt_size(const pjmedia_codec_param *codec_param,
+				 const pjmedia_stream_info *info)
+{
+    unsigned size;
+
+    size = sizeof(pjmedia_rtp_hdr) + codec_param->info.max_bps * 
+	   PJMEDIA_MAX_FRAME_DURATION_MS / 8 / 1000;
+    if (info->tx_audio_level_id)
+	size += AUDIO_LEVEL_EXT_LEN;
+    if (size > PJMEDIA_MAX_MTU - PJMEDIA_STREAM_RESV_PAYLOAD_LEN)
+	size = PJMEDIA_MAX_MTU - PJMEDIA_STREAM_RESV_PAYLOAD_LEN;
+
+    return size;
+}
+
+
+/*
+ * Get the size of an encoded frame of the codec.
+ */
+static unsigned get_frame_size(const pjmedia_codec_param *param)
+{
+    unsigned size;
+
+    size = param->info.max_bps * param->info.frm_ptime / 8 / 1000;
+    if ((param->info.max_bps * param->info.frm_ptime) % 8000 != 0)
+	++size;
+
+    return size;
+}
+
+
+/*
+ * Create jitter buffer for the codec, with the settings in the stream
+ * info.
+ */
+static pj_status_t create_jbuf(pjmedia_stream *stream,
+			       pj_pool_t *pool,
+			       const pjmedia_stream_info *info,
+			       const pjmedia_codec_param *param,
+			       unsigned *p_jb_max,
+			       pjmedia_jbuf **p_jb)
+{
+    int frm_ptime = param->info.frm_ptime;
+    unsigned jb_init, jb_max, jb_min_pre, jb_max_pre;
+    pj_status_t status;
+
+    /* Init jitter buffer parameters: */
+    if (info->jb_max >= frm_ptime)
+	jb_max = (info->jb_max + frm_ptime - 1) / frm_ptime;
+    else
+	jb_max = 500 / frm_ptime;
+
+    if (info->jb_min_pre >= frm_ptime)
+	jb_min_pre = info->jb_min_pre / frm_ptime;
+    else
+	//jb_min_pre = 60 / frm_ptime;
+	jb_min_pre = 1;
+
+    if (info->jb_max_pre >= frm_ptime)
+	jb_max_pre = info->jb_max_pre / frm_ptime;
+    else
+	//jb_max_pre = 240 / frm_ptime;
+	jb_max_pre = jb_max * 4 / 5;
+
+    if (info->jb_init >= frm_ptime)
+	jb_init = info->jb_init / frm_ptime;
+    else
+	//jb_init = (jb_min_pre + jb_max_pre) / 2;
+	jb_init = 0;
+
+    /* Create jitter buffer */
+    status = pjmedia_jbuf_create(pool, &stream->port.info.name,
+				 get_frame_size(param), frm_ptime,
+				 jb_max, p_jb);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    /* Set up jitter buffer */
+    pjmedia_jbuf_set_adaptive(*p_jb, jb_init, jb_min_pre, jb_max_pre);
+
+    if (p_jb_max)
+	*p_jb_max = jb_max;
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Init the encoding side for the packet duration in the codec param.
+ * The encoding buffer is reused when it is already big enough.
+ */
+static void init_enc_buf(pjmedia_stream *stream, pj_pool_t *pool)
+{
+    const pjmedia_codec_param *param = &stream->codec_param;
+    unsigned port_ptime, pkt_ptime;
+
+    /* If the packets sent have different duration than the port frame,
+     * e.g: when encoder and decoder's ptime are asymmetric (such as with
+     * iLBC) or the packetization was changed after the stream was added
+     * to the bridge, then we need to create buffer on the encoder side.
+     */
+    port_ptime = PJMEDIA_PIA_PTIME(&stream->port.info);
+    if (param->info.enc_ptime != 0 &&
+	param->info.enc_ptime != param->info.frm_ptime)
+    {
+	pkt_ptime = param->info.enc_ptime;
+    } else {
+	pkt_ptime = param->info.frm_ptime * param->setting.frm_per_pkt;
+    }
+
+    stream->enc_samples_per_pkt = pkt_ptime * param->info.channel_cnt *
+				  param->info.clock_rate / 1000;
+
+    if (pkt_ptime != port_ptime) {
+	unsigned ptime, size;
+
+	/* Set buffer size as twice the largest ptime value between
+	 * stream's ptime, encoder ptime, or decoder ptime.
+	 */
+	ptime = port_ptime;
+
+	if (pkt_ptime > ptime)
+	    ptime = pkt_ptime;
+
+	if (param->info.frm_ptime > ptime)
+	    ptime = param->info.frm_ptime;
+
+	ptime <<= 1;
+
+	/* Allocate buffer */
+	size = param->info.clock_rate * ptime / 1000;
+	if (stream->enc_buf_mem == NULL || size > stream->enc_buf_size) {
+	    stream->enc_buf_mem = (pj_int16_t*)pj_pool_alloc(pool, size * 2);
+	    stream->enc_buf_size = size;
+	}
+	stream->enc_buf = stream->enc_buf_mem;
+
+    } else {
+	stream->enc_buf = NULL;
+    }
+    stream->enc_buf_pos = stream->enc_buf_count = 0;
+
+#if defined(PJMEDIA_HANDLE_G722_MPEG_BUG) && (PJMEDIA_HANDLE_G722_MPEG_BUG!=0)
+    stream->rtp_tx_ts_len_per_pkt = stream->enc_samples_per_pkt /
+				    param->info.channel_cnt;
+#endif
+}
+
+
+/*
+ * Init the state derived from the codec param: the encoded frame size,
+ * the encoding buffer, the batch decoding buffers, etc. Buffers that are
+ * already big enough are reused.
+ */
+static void init_codec_state(pjmedia_stream *stream, pj_pool_t *pool)
+{
+    const pjmedia_codec_param *param = &stream->codec_param;
+    unsigned batch_max;
+
+    /* Get the frame size */
+    stream->frame_size = get_frame_size(param);
+
+    /* How many consecutive PLC frames can be generated */
+    stream->max_plc_cnt = (MAX_PLC_MSEC + param->info.frm_ptime - 1) /
+			  param->info.frm_ptime;
+
+    init_enc_buf(stream, pool);
+
+    /* Decode the frames of a packet in one call when the codec can */
+    batch_max = 0;
+    if (stream->codec->op->decode_frames &&
+	param->setting.frm_per_pkt > 1 &&
+	param->info.fmt_id == PJMEDIA_FORMAT_L16)
+    {
+	batch_max = param->setting.frm_per_pkt;
+    }
+    if (batch_max * stream->frame_size > stream->dec_batch_size) {
+	stream->dec_batch_size = batch_max * stream->frame_size;
+	stream->dec_batch_buf = (pj_uint8_t*)
+				pj_pool_alloc(pool, stream->dec_batch_size);
+    }
+    if (batch_max > stream->dec_batch_frm_cnt) {
+	stream->dec_batch_frm_cnt = batch_max;
+	stream->dec_batch_frm = (pjmedia_frame*)
+				pj_pool_calloc(pool, batch_max,
+					       sizeof(pjmedia_frame));
+    }
+    stream->dec_batch_max = batch_max;
+
+#if defined(PJMEDIA_HANDLE_G722_MPEG_BUG) && (PJMEDIA_HANDLE_G722_MPEG_BUG!=0)
+    stream->rtp_rx_ts_len_per_frame = PJMEDIA_PIA_SPF(&stream->port.info) /
+				      param->setting.frm_per_pkt /
+				      param->info.channel_cnt;
+#endif
+
+    stream->rx_skip_hangover = PJMEDIA_STREAM_AUDIO_LEVEL_HANGOVER /
+			       param->info.frm_ptime;
+}
+
+
+/*
+ * Init adaptive packetization with the negotiated packet duration as the
+ * shortest one. The packets are made of whole port frames, so that the
+ * packet duration can be changed whenever the encoding buffer is empty.
+ */
+static void init_adaptive_ptime(pjmedia_stream *stream, pj_pool_t *pool)
+{
+    const pjmedia_codec_param *param = &stream->codec_param;
+    unsigned port_ptime, pkt_ptime, max_ptime, max_payload, size;
+
+    stream->ptime_max_fpp = stream->ptime_new_fpp = 0;
+    stream->ptime_good_cnt = 0;
+    stream->ptime_rr_cnt = stream->rtcp.stat.tx.update_cnt;
+    stream->ptime_tx_pkt = stream->rtcp.stat.tx.pkt;
+    stream->ptime_tx_loss = stream->rtcp.stat.tx.loss;
+
+    max_ptime = stream->si.adaptive_max_ptime;
+    if (stream->si.tx_maxptime && stream->si.tx_maxptime < max_ptime)
+	max_ptime = stream->si.tx_maxptime;
+    if (max_ptime > PJMEDIA_MAX_FRAME_DURATION_MS)
+	max_ptime = PJMEDIA_MAX_FRAME_DURATION_MS;
+
+    port_ptime = PJMEDIA_PIA_PTIME(&stream->port.info);
+    pkt_ptime = param->info.frm_ptime * param->setting.frm_per_pkt;
+
+    if (max_ptime < pkt_ptime + port_ptime ||
+	stream->port.info.fmt.id != PJMEDIA_FORMAT_L16 ||
+	(param->info.enc_ptime != 0 &&
+	 param->info.enc_ptime != param->info.frm_ptime) ||
+	port_ptime % param->info.frm_ptime != 0 ||
+	pkt_ptime % port_ptime != 0)
+    {
+	return;
+    }
+
+#if defined(PJMEDIA_HANDLE_G722_MPEG_BUG) && (PJMEDIA_HANDLE_G722_MPEG_BUG!=0)
+    /* The RTP timestamp normalization assumes fixed packetization */
+    if (stream->has_g722_mpeg_bug)
+	return;
+#endif
+
+    stream->ptime_base_fpp = param->setting.frm_per_pkt;
+    stream->ptime_step_fpp = port_ptime / param->info.frm_ptime;
+    stream->ptime_max_fpp = stream->ptime_base_fpp +
+			    (max_ptime - pkt_ptime) / port_ptime *
+			    stream->ptime_step_fpp;
+
+    /* The longest packet must fit in the packet buffer */
+    max_payload = stream->enc->out_pkt_size - sizeof(pjmedia_rtp_hdr) -
+		  AUDIO_LEVEL_EXT_LEN;
+    while (stream->ptime_max_fpp > stream->ptime_base_fpp &&
+	   (stream->ptime_max_fpp * stream->frame_size > max_payload ||
+	    stream->ptime_max_fpp > 255))
+    {
+	stream->ptime_max_fpp -= stream->ptime_step_fpp;
+    }
+    if (stream->ptime_max_fpp <= stream->ptime_base_fpp) {
+	stream->ptime_max_fpp = 0;
+	return;
+    }
+
+    /* Allocate the encoding buffer for the longest packet now, rather
+     * than when the packet duration is changed in put_frame().
+     */
+    size = param->info.clock_rate * param->info.channel_cnt *
+	   (stream->ptime_max_fpp * param->info.frm_ptime * 2) / 1000;
+    if (stream->enc_buf_mem == NULL || size > stream->enc_buf_size) {
+	stream->enc_buf_mem = (pj_int16_t*)pj_pool_alloc(pool, size * 2);
+	stream->enc_buf_size = size;
+    }
+
+    PJ_LOG(5,(stream->port.info.name.ptr, "Adaptive packetization "
+	      "between %u and %u ms", pkt_ptime,
+	      stream->ptime_max_fpp * param->info.frm_ptime));
 }
 
 
@@ -1924,21 +2602,17 @@ static pj_status_t create_channel( pj_pool_t *pool,
     /* Allocate buffer for outgoing packet. */
 
     if (param->type == PJMEDIA_TYPE_AUDIO) {
-        channel->out_pkt_size = sizeof(pjmedia_rtp_hdr) + 
-			        stream->codec_param.info.max_bps * 
-			        PJMEDIA_MAX_FRAME_DURATION_MS / 
-			        8 / 1000;
-        if (channel->out_pkt_size > PJMEDIA_MAX_MTU -
-				    PJMEDIA_STREAM_RESV_PAYLOAD_LEN)
-	{
-	    channel->out_pkt_size = PJMEDIA_MAX_MTU -
-				    PJMEDIA_STREAM_RESV_PAYLOAD_LEN;
-	}
+        channel->out_pkt_size = get_out_pkt_size(&stream->codec_param, param);
     } else {
         return PJ_ENOTSUP;
     }
 
-    channel->out_pkt = pj_pool_alloc(pool, channel->out_pkt_size);
+    /* The reserved payload length is kept as tailroom after the packet,
+     * so the transport can append its data (e.g: SRTP authentication tag)
+     * in place.
+     */
+    channel->out_pkt = pj_pool_alloc(pool, channel->out_pkt_size +
+					   PJMEDIA_STREAM_RESV_PAYLOAD_LEN);
     PJ_ASSERT_RETURN(channel->out_pkt != NULL, PJ_ENOMEM);
 
 
@@ -1980,9 +2654,10 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
     enum { M = 32 };
     pjmedia_stream *stream;
     pj_str_t name;
-    unsigned jb_init, jb_max, jb_min_pre, jb_max_pre;
+    unsigned jb_max;
     pjmedia_audio_format_detail *afd;
     pj_pool_t *own_pool = NULL;
+    unsigned i;
     char *p;
     pj_status_t status;
 
@@ -2001,6 +2676,7 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
     stream = PJ_POOL_ZALLOC_T(pool, pjmedia_stream);
     PJ_ASSERT_RETURN(stream != NULL, PJ_ENOMEM);
     stream->own_pool = own_pool;
+    stream->pool = pool;
     pj_memcpy(&stream->si, info, sizeof(*info));
     stream->si.param = pjmedia_codec_param_clone(pool, info->param);
 
@@ -2060,6 +2736,13 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
     if (status != PJ_SUCCESS)
 	goto err_cleanup;
 
+    /* Recursive, as a transport may deliver RTCP to adapt_ptime() while
+     * put_frame() is sending.
+     */
+    status = pj_mutex_create_recursive(pool, NULL, &stream->enc_mutex);
+    if (status != PJ_SUCCESS)
+	goto err_cleanup;
+
 
     /* Create and initialize codec: */
 
@@ -2130,42 +2813,8 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
 	stream->port.get_frame = &get_frame_ext;
     }
 
-    /* If encoder and decoder's ptime are asymmetric, then we need to
-     * create buffer on the encoder side. This could happen for example
-     * with iLBC 
-     */
-    if (stream->codec_param.info.enc_ptime!=0 &&
-	stream->codec_param.info.enc_ptime!=stream->codec_param.info.frm_ptime)
-    {
-	unsigned ptime;
-
-	stream->enc_samples_per_pkt = stream->codec_param.info.enc_ptime *
-				      stream->codec_param.info.channel_cnt *
-				      afd->clock_rate / 1000;
-
-	/* Set buffer size as twice the largest ptime value between
-	 * stream's ptime, encoder ptime, or decoder ptime.
-	 */
-
-	ptime = afd->frame_time_usec / 1000;
-
-	if (stream->codec_param.info.enc_ptime > ptime)
-	    ptime = stream->codec_param.info.enc_ptime;
-
-	if (stream->codec_param.info.frm_ptime > ptime)
-	    ptime = stream->codec_param.info.frm_ptime;
-
-	ptime <<= 1;
-
-	/* Allocate buffer */
-	stream->enc_buf_size = afd->clock_rate * ptime / 1000;
-	stream->enc_buf = (pj_int16_t*)
-			  pj_pool_alloc(pool, stream->enc_buf_size * 2);
-
-    } else {
-	stream->enc_samples_per_pkt = PJMEDIA_AFD_SPF(afd);
-    }
-
+    /* Init the frame size, encoding and decoding buffers, etc. */
+    init_codec_state(stream, pool);
 
     /* Initially disable the VAD in the stream, to help traverse NAT better */
     stream->vad_enabled = stream->codec_param.setting.vad;
@@ -2176,29 +2825,11 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
 	PJ_LOG(4,(stream->port.info.name.ptr,"VAD temporarily disabled"));
     }
 
-    /* Get the frame size */
-    stream->frame_size = stream->codec_param.info.max_bps * 
-			 stream->codec_param.info.frm_ptime / 8 / 1000;
-    if ((stream->codec_param.info.max_bps * stream->codec_param.info.frm_ptime) 
-	% 8000 != 0)
-    {
-	++stream->frame_size;
-    }
-
-    /* How many consecutive PLC frames can be generated */
-    stream->max_plc_cnt = (MAX_PLC_MSEC+stream->codec_param.info.frm_ptime-1)/
-			    stream->codec_param.info.frm_ptime;
-
 #if defined(PJMEDIA_HANDLE_G722_MPEG_BUG) && (PJMEDIA_HANDLE_G722_MPEG_BUG!=0)
     stream->rtp_rx_check_cnt = 50;
     stream->has_g722_mpeg_bug = PJ_FALSE;
     stream->rtp_rx_last_ts = 0;
     stream->rtp_rx_last_cnt = 0;
-    stream->rtp_tx_ts_len_per_pkt = stream->enc_samples_per_pkt /
-				     stream->codec_param.info.channel_cnt;
-    stream->rtp_rx_ts_len_per_frame = PJMEDIA_AFD_SPF(afd) /
-				      stream->codec_param.setting.frm_per_pkt /
-				      stream->codec_param.info.channel_cnt;
 
     if (info->fmt.pt == PJMEDIA_RTP_PT_G722) {
 	stream->has_g722_mpeg_bug = PJ_TRUE;
@@ -2207,42 +2838,16 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
     }
 #endif
 
-    /* Init jitter buffer parameters: */
-    if (info->jb_max >= stream->codec_param.info.frm_ptime)
-	jb_max = (info->jb_max + stream->codec_param.info.frm_ptime - 1) / 
-		 stream->codec_param.info.frm_ptime;
-    else
-	jb_max = 500 / stream->codec_param.info.frm_ptime;
-
-    if (info->jb_min_pre >= stream->codec_param.info.frm_ptime)
-	jb_min_pre = info->jb_min_pre / stream->codec_param.info.frm_ptime;
-    else
-	//jb_min_pre = 60 / stream->codec_param.info.frm_ptime;
-	jb_min_pre = 1;
-
-    if (info->jb_max_pre >= stream->codec_param.info.frm_ptime)
-	jb_max_pre = info->jb_max_pre / stream->codec_param.info.frm_ptime;
-    else
-	//jb_max_pre = 240 / stream->codec_param.info.frm_ptime;
-	jb_max_pre = jb_max * 4 / 5;
-
-    if (info->jb_init >= stream->codec_param.info.frm_ptime)
-	jb_init = info->jb_init / stream->codec_param.info.frm_ptime;
-    else
-	//jb_init = (jb_min_pre + jb_max_pre) / 2;
-	jb_init = 0;
-
     /* Create jitter buffer */
-    status = pjmedia_jbuf_create(pool, &stream->port.info.name,
-				 stream->frame_size, 
-				 stream->codec_param.info.frm_ptime,
-				 jb_max, &stream->jb);
+    status = create_jbuf(stream, pool, info, &stream->codec_param,
+			 &jb_max, &stream->jb);
     if (status != PJ_SUCCESS)
 	goto err_cleanup;
 
-
-    /* Set up jitter buffer */
-    pjmedia_jbuf_set_adaptive( stream->jb, jb_init, jb_min_pre, jb_max_pre);
+    /* Init received audio level (RFC 6464) state */
+    stream->rx_audio_level = -1;
+    for (i=0; i<AUDIO_LEVEL_HIST_CNT; ++i)
+	stream->rx_level_hist[i].seq = -1;
 
     /* Create decoder channel: */
 
@@ -2288,6 +2893,9 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
 	}
     }
 
+    /* Init adaptive packetization, if it's enabled */
+    init_adaptive_ptime(stream, pool);
+
     /* Allocate outgoing RTCP buffer, should be enough to hold SR/RR, SDES,
      * BYE, and XR.
      */
@@ -2304,7 +2912,8 @@ PJ_DEF(pj_status_t) pjmedia_stream_create( pjmedia_endpt *endpt,
     if (stream->out_rtcp_pkt_size > PJMEDIA_MAX_MTU)
 	stream->out_rtcp_pkt_size = PJMEDIA_MAX_MTU;
 
-    stream->out_rtcp_pkt = pj_pool_alloc(pool, stream->out_rtcp_pkt_size);
+    stream->out_rtcp_pkt = pj_pool_alloc(pool, stream->out_rtcp_pkt_size +
+						PJMEDIA_STREAM_RESV_PAYLOAD_LEN);
 
     /* Only attach transport when stream is ready. */
     status = pjmedia_transport_attach(tp, stream, &info->rem_addr, 
@@ -2508,6 +3117,11 @@ PJ_DEF(pj_status_t) pjmedia_stream_destroy( pjmedia_stream *stream )
 	stream->jb_mutex = NULL;
     }
 
+    if (stream->enc_mutex) {
+	pj_mutex_destroy(stream->enc_mutex);
+	stream->enc_mutex = NULL;
+    }
+
     /* Destroy jitter buffer */
     if (stream->jb)
 	pjmedia_jbuf_destroy(stream->jb);
@@ -2647,6 +3261,22 @@ PJ_DEF(pj_status_t) pjmedia_stream_get_stat_jbuf(const pjmedia_stream *stream,
     return pjmedia_jbuf_get_state(stream->jb, state);
 }
 
+/*
+ * Get the last received audio level.
+ */
+PJ_DEF(pj_status_t) pjmedia_stream_get_rx_audio_level(
+					    const pjmedia_stream *stream,
+					    unsigned *level)
+{
+    PJ_ASSERT_RETURN(stream && level, PJ_EINVAL);
+
+    if (stream->rx_audio_level < 0)
+	return PJ_ENOTFOUND;
+
+    *level = stream->rx_audio_level;
+    return PJ_SUCCESS;
+}
+
 /*
  * Pause stream.
  */
@@ -2696,6 +3326,308 @@ PJ_DEF(pj_status_t) pjmedia_stream_resume( pjmedia_stream *stream,
     return PJ_SUCCESS;
 }
 
+/*
+ * Check if two codec fmtp have the same parameters.
+ */
+static pj_bool_t is_fmtp_equal(const pjmedia_codec_fmtp *fmtp1,
+			       const pjmedia_codec_fmtp *fmtp2)
+{
+    unsigned i;
+
+    if (fmtp1->cnt != fmtp2->cnt)
+	return PJ_FALSE;
+
+    for (i = 0; i < fmtp1->cnt; ++i) {
+	if (pj_stricmp(&fmtp1->param[i].name, &fmtp2->param[i].name) ||
+	    pj_strcmp(&fmtp1->param[i].val, &fmtp2->param[i].val))
+	{
+	    return PJ_FALSE;
+	}
+    }
+
+    return PJ_TRUE;
+}
+
+
+/*
+ * Check if the codec of the new stream info needs a new codec instance.
+ */
+static pj_bool_t is_codec_changed(const pjmedia_stream *stream,
+				  const pjmedia_stream_info *info,
+				  const pjmedia_codec_param *param)
+{
+    const pjmedia_codec_param *cur;
+    unsigned cur_fpp;
+
+    /* The codec param in the stream info was cloned, its fmtp is still
+     * valid unlike the one in stream->codec_param.
+     */
+    cur = stream->si.param ? stream->si.param : &stream->codec_param;
+
+    /* Adaptive packetization doesn't change the negotiated one */
+    cur_fpp = stream->ptime_max_fpp ? stream->ptime_base_fpp :
+				      cur->setting.frm_per_pkt;
+
+    return pj_stricmp(&stream->si.fmt.encoding_name,
+		      &info->fmt.encoding_name) ||
+	   stream->si.fmt.clock_rate != info->fmt.clock_rate ||
+	   stream->si.fmt.channel_cnt != info->fmt.channel_cnt ||
+	   cur->info.enc_ptime != param->info.enc_ptime ||
+	   cur_fpp != param->setting.frm_per_pkt ||
+	   cur->setting.vad != param->setting.vad ||
+	   cur->setting.cng != param->setting.cng ||
+	   cur->setting.penh != param->setting.penh ||
+	   cur->setting.plc != param->setting.plc ||
+	   !is_fmtp_equal(&cur->setting.enc_fmtp, &param->setting.enc_fmtp) ||
+	   !is_fmtp_equal(&cur->setting.dec_fmtp, &param->setting.dec_fmtp);
+}
+
+
+/*
+ * Update stream with new stream info.
+ */
+PJ_DEF(pj_status_t) pjmedia_stream_update(pjmedia_stream *stream,
+					  const pjmedia_stream_info *info)
+{
+    pjmedia_stream_info old_si;
+    pjmedia_codec_param param;
+    pjmedia_codec *codec = NULL;
+    pjmedia_jbuf *jb = NULL;
+    unsigned jb_max = 0, pkt_size;
+    pj_bool_t addr_changed;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(stream && info, PJ_EINVAL);
+
+    if (info->type != PJMEDIA_TYPE_AUDIO)
+	return PJ_ENOTSUP;
+
+    /* Get codec param */
+    if (info->param) {
+	param = *info->param;
+    } else {
+	status = pjmedia_codec_mgr_get_default_param(stream->codec_mgr,
+						     &info->fmt, &param);
+	if (status != PJ_SUCCESS)
+	    return status;
+    }
+
+    if (param.info.max_bps < param.info.avg_bps)
+	param.info.max_bps = param.info.avg_bps;
+    if (param.setting.frm_per_pkt < 1)
+	param.setting.frm_per_pkt = 1;
+
+    /* Open the new codec first, so that the stream is left unchanged
+     * when it fails. The stream port must stay the same, as it may have
+     * been added to the conference bridge.
+     */
+    if (is_codec_changed(stream, info, &param)) {
+	pjmedia_jb_state jb_state;
+
+	if (info->fmt.clock_rate != PJMEDIA_PIA_SRATE(&stream->port.info) ||
+	    info->fmt.channel_cnt != PJMEDIA_PIA_CCNT(&stream->port.info) ||
+	    stream->port.info.fmt.id != PJMEDIA_FORMAT_L16)
+	{
+	    return PJ_ENOTSUP;
+	}
+
+#if defined(PJMEDIA_HANDLE_G722_MPEG_BUG) && (PJMEDIA_HANDLE_G722_MPEG_BUG!=0)
+	/* The RTP timestamp normalization is set up at creation only */
+	if (stream->has_g722_mpeg_bug || info->fmt.pt == PJMEDIA_RTP_PT_G722)
+	    return PJ_ENOTSUP;
+#endif
+
+	status = pjmedia_codec_mgr_alloc_codec(stream->codec_mgr,
+					       &info->fmt, &codec);
+	if (status != PJ_SUCCESS)
+	    return status;
+
+	status = pjmedia_codec_init(codec, stream->pool);
+	if (status == PJ_SUCCESS)
+	    status = pjmedia_codec_open(codec, &param);
+	if (status != PJ_SUCCESS) {
+	    pjmedia_codec_mgr_dealloc_codec(stream->codec_mgr, codec);
+	    return status;
+	}
+
+	/* get_frame() fills the port frame with whole codec frames */
+	if (param.info.fmt_id != PJMEDIA_FORMAT_L16 ||
+	    param.info.frm_ptime == 0 ||
+	    PJMEDIA_PIA_PTIME(&stream->port.info) % param.info.frm_ptime)
+	{
+	    status = PJ_ENOTSUP;
+	    goto on_error;
+	}
+
+	/* The jitter buffer can be kept if the frames still fit */
+	pjmedia_jbuf_get_state(stream->jb, &jb_state);
+	if (param.info.frm_ptime != stream->codec_param.info.frm_ptime ||
+	    get_frame_size(&param) > jb_state.frame_size)
+	{
+	    status = create_jbuf(stream, stream->pool, info, &param,
+				 &jb_max, &jb);
+	    if (status != PJ_SUCCESS)
+		goto on_error;
+	}
+
+	/* Initially disable the VAD, like a new stream does */
+	if (PJMEDIA_STREAM_VAD_SUSPEND_MSEC > 0 && param.setting.vad) {
+	    param.setting.vad = 0;
+	    pjmedia_codec_modify(codec, &param);
+	    param.setting.vad = 1;
+	}
+    }
+
+    /* Attach again to the transport when remote address is changed.
+     * MUST NOT hold stream mutex while doing this, see ticket #460.
+     */
+    addr_changed = pj_sockaddr_cmp(&info->rem_addr, &stream->si.rem_addr) ||
+		   pj_sockaddr_cmp(&info->rem_rtcp, &stream->si.rem_rtcp);
+    if (addr_changed) {
+	pjmedia_transport_detach(stream->transport, stream);
+	status = pjmedia_transport_attach(stream->transport, stream,
+					  &info->rem_addr, &info->rem_rtcp,
+					  pj_sockaddr_get_len(&info->rem_addr),
+					  &on_rx_rtp, &on_rx_rtcp);
+	if (status != PJ_SUCCESS)
+	    goto on_error;
+    }
+
+    pj_mutex_lock(stream->enc_mutex);
+    pj_mutex_lock(stream->jb_mutex);
+
+    pj_memcpy(&old_si, &stream->si, sizeof(old_si));
+
+    if (codec) {
+	pjmedia_codec *old_codec = stream->codec;
+
+	stream->codec = codec;
+	stream->codec_param = param;
+	codec = old_codec;
+
+	stream->vad_enabled = param.setting.vad;
+	if (PJMEDIA_STREAM_VAD_SUSPEND_MSEC > 0 && stream->vad_enabled) {
+	    stream->codec_param.setting.vad = 0;
+	    stream->ts_vad_disabled = stream->tx_duration;
+	}
+
+	init_codec_state(stream, stream->pool);
+	stream->plc_cnt = 0;
+
+	/* The frames in the jitter buffer are from the old codec */
+	if (jb) {
+	    pjmedia_jbuf_destroy(stream->jb);
+	    stream->jb = jb;
+	} else {
+	    pjmedia_jbuf_reset(stream->jb);
+	}
+
+    } else if (stream->ptime_max_fpp &&
+	       stream->codec_param.setting.frm_per_pkt !=
+		   stream->ptime_base_fpp)
+    {
+	/* Go back to the negotiated packetization */
+	stream->codec_param.setting.frm_per_pkt = (pj_uint8_t)
+						  stream->ptime_base_fpp;
+	init_enc_buf(stream, stream->pool);
+    }
+
+    /* Make sure the packet buffers are big enough */
+    pkt_size = get_out_pkt_size(&stream->codec_param, info);
+    if (pkt_size > stream->enc->out_pkt_size) {
+	stream->enc->out_pkt = pj_pool_alloc(stream->pool, pkt_size +
+					     PJMEDIA_STREAM_RESV_PAYLOAD_LEN);
+	stream->enc->out_pkt_size = pkt_size;
+    }
+    if (pkt_size > stream->dec->out_pkt_size) {
+	stream->dec->out_pkt = pj_pool_alloc(stream->pool, pkt_size +
+					     PJMEDIA_STREAM_RESV_PAYLOAD_LEN);
+	stream->dec->out_pkt_size = pkt_size;
+    }
+
+    /* Payload types */
+    stream->enc->pt = stream->enc->rtp.out_pt = info->tx_pt;
+    stream->dec->pt = stream->dec->rtp.out_pt = info->rx_pt;
+    stream->tx_event_pt = info->tx_event_pt ? info->tx_event_pt : -1;
+    stream->rx_event_pt = info->rx_event_pt ? info->rx_event_pt : -1;
+
+    /* Keep the RTP session settings of the running stream */
+    pj_memcpy(&stream->si, info, sizeof(*info));
+    stream->si.ssrc = old_si.ssrc;
+    stream->si.rtp_ts = old_si.rtp_ts;
+    stream->si.rtp_seq = old_si.rtp_seq;
+    stream->si.rtp_seq_ts_set = old_si.rtp_seq_ts_set;
+    if (codec && info->param)
+	stream->si.param = pjmedia_codec_param_clone(stream->pool,
+						     info->param);
+    else
+	stream->si.param = old_si.param;
+
+    stream->dir = info->dir;
+
+    /* The limits of adaptive packetization may have changed */
+    init_adaptive_ptime(stream, stream->pool);
+
+#if defined(PJMEDIA_STREAM_ENABLE_KA) && PJMEDIA_STREAM_ENABLE_KA!=0
+    /* NAT hole punching to the new remote address */
+    stream->use_ka = info->use_ka;
+    if (addr_changed && stream->use_ka)
+	send_keep_alive_packet(stream);
+#endif
+
+    pj_mutex_unlock(stream->jb_mutex);
+    pj_mutex_unlock(stream->enc_mutex);
+
+#if defined(PJMEDIA_HAS_RTCP_XR) && (PJMEDIA_HAS_RTCP_XR != 0)
+    if (jb && stream->rtcp.xr_enabled) {
+	pjmedia_rtcp_xr_update_info(&stream->rtcp.xr_session, 
+				    PJMEDIA_RTCP_XR_INFO_JB_ABS_MAX,
+				    jb_max * stream->codec_param.info.frm_ptime);
+    }
+#endif
+
+    /* Nobody is using the old codec now */
+    if (codec) {
+	pjmedia_codec_close(codec);
+	pjmedia_codec_mgr_dealloc_codec(stream->codec_mgr, codec);
+    }
+
+    /* Pause or resume the channels whose direction is changed */
+    if ((info->dir ^ old_si.dir) & PJMEDIA_DIR_ENCODING) {
+	if (info->dir & PJMEDIA_DIR_ENCODING)
+	    pjmedia_stream_resume(stream, PJMEDIA_DIR_ENCODING);
+	else
+	    pjmedia_stream_pause(stream, PJMEDIA_DIR_ENCODING);
+    }
+    if ((info->dir ^ old_si.dir) & PJMEDIA_DIR_DECODING) {
+	if (info->dir & PJMEDIA_DIR_DECODING)
+	    pjmedia_stream_resume(stream, PJMEDIA_DIR_DECODING);
+	else
+	    pjmedia_stream_pause(stream, PJMEDIA_DIR_DECODING);
+    }
+
+    PJ_LOG(4,(stream->port.info.name.ptr, "Stream updated: %.*s/%d, "
+	      "%d ms packets, dir=%d%s",
+	      (int)info->fmt.encoding_name.slen, info->fmt.encoding_name.ptr,
+	      info->fmt.clock_rate,
+	      stream->enc_samples_per_pkt * 1000 /
+		  stream->codec_param.info.channel_cnt /
+		  stream->codec_param.info.clock_rate,
+	      info->dir, (addr_changed ? ", new remote address" : "")));
+
+    return PJ_SUCCESS;
+
+on_error:
+    if (jb)
+	pjmedia_jbuf_destroy(jb);
+    if (codec) {
+	pjmedia_codec_close(codec);
+	pjmedia_codec_mgr_dealloc_codec(stream->codec_mgr, codec);
+    }
+    return status;
+}
+
+
 /*
  * Dial DTMF
  */
@@ -38,6 +38,55 @@ static const pj_str_t STR_SENDONLY = { "sendonly", 8 };
 static const pj_str_t STR_RECVONLY = { "recvonly", 8 };
 
 
+#if defined(PJMEDIA_RTP_AUDIO_LEVEL_EXT_ID) && \
+    PJMEDIA_RTP_AUDIO_LEVEL_EXT_ID != 0
+/*
+ * Find the ID of RTP header extension with the specified URI in the
+ * "a=extmap" attributes (RFC 5285) of the media, falling back to the
+ * session level attributes. Returns zero when not found.
+ */
+static int find_extmap_id(const pjmedia_sdp_session *sess,
+			  const pjmedia_sdp_media *m,
+			  const char *uri)
+{
+    unsigned attr_count = m->attr_count;
+    pjmedia_sdp_attr *const *attrs = m->attr;
+    unsigned i, round;
+
+    for (round=0; round<2; ++round) {
+	for (i=0; i<attr_count; ++i) {
+	    const pjmedia_sdp_attr *a = attrs[i];
+	    const char *p, *end;
+	    pj_str_t token;
+	    int id;
+
+	    if (pj_strcmp2(&a->name, "extmap") != 0 || a->value.slen == 0)
+		continue;
+
+	    /* "<id>[/<direction>] <uri> [<extension attributes>]" */
+	    id = (int)pj_strtoul(&a->value);
+
+	    p = a->value.ptr;
+	    end = a->value.ptr + a->value.slen;
+	    while (p < end && !pj_isspace(*p)) ++p;
+	    while (p < end && pj_isspace(*p)) ++p;
+	    token.ptr = (char*)p;
+	    while (p < end && !pj_isspace(*p)) ++p;
+	    token.slen = p - token.ptr;
+
+	    if (pj_strcmp2(&token, uri) == 0 && id > 0)
+		return id;
+	}
+
+	attr_count = sess->attr_count;
+	attrs = sess->attr;
+    }
+
+    return 0;
+}
+#endif
+
+
 /*
  * Internal function for collecting codec info and param from the SDP media.
  */
@@ -546,6 +595,19 @@ PJ_DEF(pj_status_t) pjmedia_stream_info_from_sdp(
     /* Set default jitter buffer parameter. */
     si->jb_init = si->jb_max = si->jb_min_pre = si->jb_max_pre = -1;
 
+#if defined(PJMEDIA_RTP_AUDIO_LEVEL_EXT_ID) && \
+    PJMEDIA_RTP_AUDIO_LEVEL_EXT_ID != 0
+    /* Audio level header extension (RFC 6464) is only used when both
+     * sides advertise it. Each side tells which ID it expects to receive.
+     */
+    si->rx_audio_level_id = find_extmap_id(local, local_m,
+					   PJMEDIA_RTP_EXT_AUDIO_LEVEL_URI);
+    si->tx_audio_level_id = find_extmap_id(remote, rem_m,
+					   PJMEDIA_RTP_EXT_AUDIO_LEVEL_URI);
+    if (si->rx_audio_level_id == 0 || si->tx_audio_level_id == 0)
+	si->rx_audio_level_id = si->tx_audio_level_id = 0;
+#endif
+
     return status;
 }
 
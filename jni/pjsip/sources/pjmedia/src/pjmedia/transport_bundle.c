@@ -0,0 +1,704 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <pjmedia/transport_bundle.h>
+#include <pjmedia/endpoint.h>
+#include <pjmedia/errno.h>
+#include <pjmedia/sdp.h>
+#include <pj/assert.h>
+#include <pj/log.h>
+#include <pj/os.h>
+#include <pj/pool.h>
+#include <pj/string.h>
+
+
+#define THIS_FILE   "transport_bundle.c"
+
+static const pj_str_t ID_RTCP_MUX = { "rtcp-mux", 8 };
+
+
+/* Transport functions prototypes */
+static pj_status_t transport_get_info (pjmedia_transport *tp,
+				       pjmedia_transport_info *info);
+static pj_status_t transport_attach   (pjmedia_transport *tp,
+				       void *user_data,
+				       const pj_sockaddr_t *rem_addr,
+				       const pj_sockaddr_t *rem_rtcp,
+				       unsigned addr_len,
+				       void (*rtp_cb)(void*,
+						      void*,
+						      pj_ssize_t),
+				       void (*rtcp_cb)(void*,
+						       void*,
+						       pj_ssize_t));
+static void	   transport_detach   (pjmedia_transport *tp,
+				       void *strm);
+static pj_status_t transport_send_rtp( pjmedia_transport *tp,
+				       const void *pkt,
+				       pj_size_t size);
+static pj_status_t transport_send_rtcp(pjmedia_transport *tp,
+				       const void *pkt,
+				       pj_size_t size);
+static pj_status_t transport_send_rtcp2(pjmedia_transport *tp,
+				       const pj_sockaddr_t *addr,
+				       unsigned addr_len,
+				       const void *pkt,
+				       pj_size_t size);
+static pj_status_t transport_media_create(pjmedia_transport *tp,
+				       pj_pool_t *sdp_pool,
+				       unsigned options,
+				       const pjmedia_sdp_session *rem_sdp,
+				       unsigned media_index);
+static pj_status_t transport_encode_sdp(pjmedia_transport *tp,
+				       pj_pool_t *sdp_pool,
+				       pjmedia_sdp_session *local_sdp,
+				       const pjmedia_sdp_session *rem_sdp,
+				       unsigned media_index);
+static pj_status_t transport_media_start (pjmedia_transport *tp,
+				       pj_pool_t *pool,
+				       const pjmedia_sdp_session *local_sdp,
+				       const pjmedia_sdp_session *rem_sdp,
+				       unsigned media_index);
+static pj_status_t transport_media_stop(pjmedia_transport *tp);
+static pj_status_t transport_simulate_lost(pjmedia_transport *tp,
+				       pjmedia_dir dir,
+				       unsigned pct_lost);
+static pj_status_t transport_destroy  (pjmedia_transport *tp);
+
+
+static struct pjmedia_transport_op tp_bundle_op =
+{
+    &transport_get_info,
+    &transport_attach,
+    &transport_detach,
+    &transport_send_rtp,
+    &transport_send_rtcp,
+    &transport_send_rtcp2,
+    &transport_media_create,
+    &transport_encode_sdp,
+    &transport_media_start,
+    &transport_media_stop,
+    &transport_simulate_lost,
+    &transport_destroy
+};
+
+
+struct bundle;
+
+/* Member transport, one for each media line of the group */
+struct member
+{
+    pjmedia_transport	 base;
+    struct bundle	*bundle;
+    struct member	*next;
+    pj_bool_t		 is_tag;	/**< Tagged media line.		    */
+    unsigned		 options;	/**< Options of media_create().	    */
+
+    pj_uint32_t		 pt_mask[4];	/**< Payload types of media line.   */
+    pj_bool_t		 has_rx_ssrc;
+    pj_uint32_t		 rx_ssrc;	/**< SSRC of the remote stream.	    */
+    pj_bool_t		 has_tx_ssrc;
+    pj_uint32_t		 tx_ssrc;	/**< SSRC of our stream.	    */
+
+    /* Stream information. */
+    void		*user_data;
+    void	       (*rtp_cb)(void *user_data,
+				 void *pkt,
+				 pj_ssize_t);
+    void	       (*rtcp_cb)(void *user_data,
+				  void *pkt,
+				  pj_ssize_t);
+    pj_sockaddr		 rem_rtp;
+    pj_sockaddr		 rem_rtcp;
+    unsigned		 addr_len;
+};
+
+/* The group, which owns the shared transport */
+struct bundle
+{
+    pj_pool_t		*pool;
+    pjmedia_transport	*base_tp;
+    pj_mutex_t		*mutex;
+    struct member	*members;
+    unsigned		 member_cnt;
+
+    /* Member whose remote addresses the base transport is attached with,
+     * or NULL if the base transport is not attached.
+     */
+    struct member	*attached_by;
+};
+
+
+static pj_uint32_t get_uint32(const pj_uint8_t *p)
+{
+    return ((pj_uint32_t)p[0] << 24) | ((pj_uint32_t)p[1] << 16) |
+	   ((pj_uint32_t)p[2] << 8) | p[3];
+}
+
+#define PT_IS_SET(m,pt)	    ((m)->pt_mask[(pt) >> 5] & (1U << ((pt) & 31)))
+#define PT_SET(m,pt)	    ((m)->pt_mask[(pt) >> 5] |= (1U << ((pt) & 31)))
+
+
+static pj_status_t create_member(struct bundle *bundle, const char *name,
+				 pjmedia_transport **p_tp)
+{
+    struct member *m, **pm;
+
+    m = PJ_POOL_ZALLOC_T(bundle->pool, struct member);
+    m->bundle = bundle;
+
+    if (name == NULL)
+	name = "bndl%p";
+    if (pj_ansi_strchr(name, '%'))
+	pj_ansi_snprintf(m->base.name, sizeof(m->base.name), name, m);
+    else
+	pj_ansi_strncpy(m->base.name, name, sizeof(m->base.name)-1);
+    m->base.op = &tp_bundle_op;
+    m->base.type = PJMEDIA_TRANSPORT_TYPE_BUNDLE;
+
+    /* Keep the members in the order they were added */
+    pj_mutex_lock(bundle->mutex);
+    for (pm = &bundle->members; *pm; pm = &(*pm)->next)
+	;
+    *pm = m;
+    ++bundle->member_cnt;
+    pj_mutex_unlock(bundle->mutex);
+
+    *p_tp = &m->base;
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Create the group.
+ */
+PJ_DEF(pj_status_t) pjmedia_transport_bundle_create(pjmedia_endpt *endpt,
+						     const char *name,
+						     pjmedia_transport *base_tp,
+						     pjmedia_transport **p_tp)
+{
+    pj_pool_t *pool;
+    struct bundle *bundle;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(endpt && base_tp && p_tp, PJ_EINVAL);
+
+    pool = pjmedia_endpt_create_pool(endpt, "bundle%p", 512, 512);
+    bundle = PJ_POOL_ZALLOC_T(pool, struct bundle);
+    bundle->pool = pool;
+    bundle->base_tp = base_tp;
+
+    status = pj_mutex_create_recursive(pool, pool->obj_name, &bundle->mutex);
+    if (status != PJ_SUCCESS) {
+	pj_pool_release(pool);
+	return status;
+    }
+
+    status = create_member(bundle, name, p_tp);
+    if (status != PJ_SUCCESS) {
+	pj_mutex_destroy(bundle->mutex);
+	pj_pool_release(pool);
+	return status;
+    }
+    ((struct member*)*p_tp)->is_tag = PJ_TRUE;
+
+    PJ_LOG(4,(bundle->pool->obj_name, "BUNDLE group created on %s",
+	      base_tp->name));
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Add a media line to the group.
+ */
+PJ_DEF(pj_status_t) pjmedia_transport_bundle_add_member(
+						pjmedia_transport *tp,
+						const char *name,
+						pjmedia_transport **p_tp)
+{
+    struct member *m = (struct member*)tp;
+
+    PJ_ASSERT_RETURN(tp && p_tp, PJ_EINVAL);
+    PJ_ASSERT_RETURN(tp->type == PJMEDIA_TRANSPORT_TYPE_BUNDLE, PJ_EINVAL);
+
+    return create_member(m->bundle, name, p_tp);
+}
+
+
+static pj_status_t transport_get_info(pjmedia_transport *tp,
+				      pjmedia_transport_info *info)
+{
+    struct member *m = (struct member*)tp;
+
+    /* All members share the address of the base transport */
+    return pjmedia_transport_get_info(m->bundle->base_tp, info);
+}
+
+
+/* Find the member of an incoming RTP packet. Must be called with the
+ * mutex held.
+ */
+static struct member *find_rtp_member(struct bundle *bundle,
+				      const pj_uint8_t *p, pj_ssize_t size)
+{
+    struct member *m, *found = NULL;
+    unsigned attached_cnt = 0;
+    pj_uint32_t ssrc;
+    unsigned pt;
+
+    if (size < 12)
+	return NULL;
+
+    ssrc = get_uint32(p + 8);
+    pt = p[1] & 0x7F;
+
+    for (m = bundle->members; m; m = m->next) {
+	if (!m->rtp_cb)
+	    continue;
+	if (m->has_rx_ssrc && m->rx_ssrc == ssrc)
+	    return m;
+	++attached_cnt;
+	found = m;
+    }
+
+    /* Nothing to demultiplex */
+    if (attached_cnt == 1)
+	return found;
+
+    /* A new remote stream, find it by payload type. Prefer the media
+     * lines that have not received any stream yet, in case several media
+     * lines use the same payload type.
+     */
+    for (m = bundle->members; m; m = m->next) {
+	if (m->rtp_cb && !m->has_rx_ssrc && PT_IS_SET(m, pt))
+	    break;
+    }
+    if (!m) {
+	for (m = bundle->members; m; m = m->next) {
+	    if (m->rtp_cb && PT_IS_SET(m, pt))
+		break;
+	}
+	if (!m)
+	    return NULL;
+
+	PJ_LOG(5,(m->base.name, "Remote SSRC changed from %u to %u",
+		  m->rx_ssrc, ssrc));
+    }
+
+    m->rx_ssrc = ssrc;
+    m->has_rx_ssrc = PJ_TRUE;
+    return m;
+}
+
+
+/* Find the member of an incoming RTCP packet. Must be called with the
+ * mutex held.
+ */
+static struct member *find_rtcp_member(struct bundle *bundle,
+				       const pj_uint8_t *p, pj_ssize_t size)
+{
+    struct member *m, *tag = NULL, *first = NULL;
+    unsigned pt, rc;
+    int block = -1;
+
+    if (size < 8)
+	return NULL;
+
+    /* By the sender, which is one of the remote streams */
+    for (m = bundle->members; m; m = m->next) {
+	if (!m->rtcp_cb)
+	    continue;
+	if (m->has_rx_ssrc && m->rx_ssrc == get_uint32(p + 4))
+	    return m;
+	if (m->is_tag)
+	    tag = m;
+	if (!first)
+	    first = m;
+    }
+
+    /* By the first report block, which is about one of our streams */
+    pt = p[1];
+    rc = p[0] & 0x1F;
+    if (rc && pt == 200 && size >= 28 + 24)
+	block = 28;
+    else if (rc && pt == 201 && size >= 8 + 24)
+	block = 8;
+
+    if (block > 0) {
+	pj_uint32_t ssrc = get_uint32(p + block);
+
+	for (m = bundle->members; m; m = m->next) {
+	    if (m->rtcp_cb && m->has_tx_ssrc && m->tx_ssrc == ssrc)
+		return m;
+	}
+    }
+
+    return tag ? tag : first;
+}
+
+
+/* Called by the base transport when it receives RTP packet */
+static void bundle_rtp_cb(void *user_data, void *pkt, pj_ssize_t size)
+{
+    struct bundle *bundle = (struct bundle*)user_data;
+    struct member *m;
+
+    pj_mutex_lock(bundle->mutex);
+
+    /* Negative size is an error report, give it to every stream */
+    if (size < 0) {
+	for (m = bundle->members; m; m = m->next) {
+	    if (m->rtp_cb)
+		(*m->rtp_cb)(m->user_data, pkt, size);
+	}
+	pj_mutex_unlock(bundle->mutex);
+	return;
+    }
+
+    m = find_rtp_member(bundle, (const pj_uint8_t*)pkt, size);
+    if (m) {
+	(*m->rtp_cb)(m->user_data, pkt, size);
+    } else {
+	PJ_LOG(5,(bundle->pool->obj_name, "RTP packet with unknown SSRC "
+		  "and payload type dropped (size=%d)", (int)size));
+    }
+
+    pj_mutex_unlock(bundle->mutex);
+}
+
+
+/* Called by the base transport when it receives RTCP packet */
+static void bundle_rtcp_cb(void *user_data, void *pkt, pj_ssize_t size)
+{
+    struct bundle *bundle = (struct bundle*)user_data;
+    struct member *m;
+
+    pj_mutex_lock(bundle->mutex);
+
+    m = find_rtcp_member(bundle, (const pj_uint8_t*)pkt, size);
+    if (m)
+	(*m->rtcp_cb)(m->user_data, pkt, size);
+
+    pj_mutex_unlock(bundle->mutex);
+}
+
+
+/* Attach the base transport with the remote addresses of the member.
+ * This must not be called with the mutex held, since the base transport
+ * holds its own lock when calling our callbacks.
+ */
+static pj_status_t attach_base(struct bundle *bundle, struct member *m)
+{
+    pj_status_t status;
+
+    if (bundle->attached_by)
+	pjmedia_transport_detach(bundle->base_tp, bundle);
+
+    status = pjmedia_transport_attach(bundle->base_tp, bundle, &m->rem_rtp,
+				      &m->rem_rtcp, m->addr_len,
+				      &bundle_rtp_cb, &bundle_rtcp_cb);
+    bundle->attached_by = (status == PJ_SUCCESS) ? m : NULL;
+
+    return status;
+}
+
+
+/*
+ * attach() is called by the stream of a media line. The shared transport
+ * is attached by the first stream, and again with the addresses of the
+ * tagged media line once its stream is attached.
+ */
+static pj_status_t transport_attach(pjmedia_transport *tp,
+				    void *user_data,
+				    const pj_sockaddr_t *rem_addr,
+				    const pj_sockaddr_t *rem_rtcp,
+				    unsigned addr_len,
+				    void (*rtp_cb)(void*,
+						   void*,
+						   pj_ssize_t),
+				    void (*rtcp_cb)(void*,
+						    void*,
+						    pj_ssize_t))
+{
+    struct member *m = (struct member*)tp;
+    struct bundle *bundle = m->bundle;
+    pj_status_t status = PJ_SUCCESS;
+
+    PJ_ASSERT_RETURN(addr_len <= sizeof(m->rem_rtp), PJ_EINVAL);
+
+    pj_memcpy(&m->rem_rtp, rem_addr, addr_len);
+    if (rem_rtcp)
+	pj_memcpy(&m->rem_rtcp, rem_rtcp, addr_len);
+    else
+	pj_memcpy(&m->rem_rtcp, rem_addr, addr_len);
+    m->addr_len = addr_len;
+
+    if (!bundle->attached_by ||
+	(m->is_tag && bundle->attached_by != m))
+    {
+	status = attach_base(bundle, m);
+	if (status != PJ_SUCCESS)
+	    return status;
+    }
+
+    pj_mutex_lock(bundle->mutex);
+    m->user_data = user_data;
+    m->rtp_cb = rtp_cb;
+    m->rtcp_cb = rtcp_cb;
+    pj_mutex_unlock(bundle->mutex);
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * detach() is called when the stream of a media line is destroyed. The
+ * shared transport is detached with the last stream.
+ */
+static void transport_detach(pjmedia_transport *tp, void *strm)
+{
+    struct member *m = (struct member*)tp;
+    struct bundle *bundle = m->bundle;
+    struct member *other, *attached = NULL;
+
+    PJ_UNUSED_ARG(strm);
+
+    if (!m->rtp_cb)
+	return;
+
+    pj_mutex_lock(bundle->mutex);
+    m->user_data = NULL;
+    m->rtp_cb = NULL;
+    m->rtcp_cb = NULL;
+    m->has_rx_ssrc = PJ_FALSE;
+    for (other = bundle->members; other; other = other->next) {
+	if (other->rtp_cb) {
+	    attached = other;
+	    break;
+	}
+    }
+    pj_mutex_unlock(bundle->mutex);
+
+    if (!attached && bundle->attached_by) {
+	pjmedia_transport_detach(bundle->base_tp, bundle);
+	bundle->attached_by = NULL;
+    } else if (attached && bundle->attached_by == m) {
+	/* Keep the base transport attached, with the addresses of a
+	 * stream that is still running.
+	 */
+	attach_base(bundle, attached);
+    }
+}
+
+
+static pj_status_t transport_send_rtp( pjmedia_transport *tp,
+				       const void *pkt,
+				       pj_size_t size)
+{
+    struct member *m = (struct member*)tp;
+
+    /* Remember our SSRC, to find the member of incoming reports. Only
+     * this function writes it, so the lock is needed for the update
+     * only, not to compare it.
+     */
+    if (size >= 12) {
+	pj_uint32_t ssrc = get_uint32((const pj_uint8_t*)pkt + 8);
+
+	if (!m->has_tx_ssrc || m->tx_ssrc != ssrc) {
+	    pj_mutex_lock(m->bundle->mutex);
+	    m->tx_ssrc = ssrc;
+	    m->has_tx_ssrc = PJ_TRUE;
+	    pj_mutex_unlock(m->bundle->mutex);
+	}
+    }
+
+    return pjmedia_transport_send_rtp(m->bundle->base_tp, pkt, size);
+}
+
+
+static pj_status_t transport_send_rtcp(pjmedia_transport *tp,
+				       const void *pkt,
+				       pj_size_t size)
+{
+    struct member *m = (struct member*)tp;
+    return pjmedia_transport_send_rtcp(m->bundle->base_tp, pkt, size);
+}
+
+
+static pj_status_t transport_send_rtcp2(pjmedia_transport *tp,
+				        const pj_sockaddr_t *addr,
+				        unsigned addr_len,
+				        const void *pkt,
+				        pj_size_t size)
+{
+    struct member *m = (struct member*)tp;
+    return pjmedia_transport_send_rtcp2(m->bundle->base_tp, addr, addr_len,
+					pkt, size);
+}
+
+
+static pj_status_t transport_media_create(pjmedia_transport *tp,
+				          pj_pool_t *sdp_pool,
+				          unsigned options,
+				          const pjmedia_sdp_session *rem_sdp,
+				          unsigned media_index)
+{
+    struct member *m = (struct member*)tp;
+
+    m->options = options;
+    if (!m->is_tag)
+	return PJ_SUCCESS;
+
+    return pjmedia_transport_media_create(m->bundle->base_tp, sdp_pool,
+					  options, rem_sdp, media_index);
+}
+
+
+static pj_status_t transport_encode_sdp(pjmedia_transport *tp,
+				        pj_pool_t *sdp_pool,
+				        pjmedia_sdp_session *local_sdp,
+				        const pjmedia_sdp_session *rem_sdp,
+				        unsigned media_index)
+{
+    struct member *m = (struct member*)tp;
+    pjmedia_sdp_media *m_loc, *m_rem;
+
+    if (m->is_tag) {
+	return pjmedia_transport_encode_sdp(m->bundle->base_tp, sdp_pool,
+					    local_sdp, rem_sdp, media_index);
+    }
+
+    /* The other media lines only carry the RTCP multiplexing flag. The
+     * transport attributes, e.g. ICE, are in the tagged media line.
+     */
+    if ((m->options & PJMEDIA_TPMED_RTCP_MUX) == 0)
+	return PJ_SUCCESS;
+
+    m_loc = local_sdp->media[media_index];
+    m_rem = rem_sdp ? rem_sdp->media[media_index] : NULL;
+    if (m_loc->desc.port &&
+	(!m_rem || pjmedia_sdp_media_find_attr(m_rem, &ID_RTCP_MUX, NULL)) &&
+	!pjmedia_sdp_media_find_attr(m_loc, &ID_RTCP_MUX, NULL) &&
+	m_loc->attr_count < PJMEDIA_MAX_SDP_ATTR)
+    {
+	pjmedia_sdp_attr *attr;
+
+	attr = pjmedia_sdp_attr_create(sdp_pool, ID_RTCP_MUX.ptr, NULL);
+	pjmedia_sdp_media_add_attr(m_loc, attr);
+    }
+
+    return PJ_SUCCESS;
+}
+
+
+/* Add the payload types of the media line to the member */
+static void add_pt(struct member *m, const pjmedia_sdp_media *sdp_m)
+{
+    unsigned i;
+
+    for (i = 0; i < sdp_m->desc.fmt_count; ++i) {
+	unsigned long pt = pj_strtoul(&sdp_m->desc.fmt[i]);
+
+	if (pt < 128)
+	    PT_SET(m, pt);
+    }
+}
+
+
+static pj_status_t transport_media_start(pjmedia_transport *tp,
+				         pj_pool_t *pool,
+				         const pjmedia_sdp_session *local_sdp,
+				         const pjmedia_sdp_session *rem_sdp,
+				         unsigned media_index)
+{
+    struct member *m = (struct member*)tp;
+
+    PJ_ASSERT_RETURN(local_sdp && rem_sdp, PJ_EINVAL);
+    PJ_ASSERT_RETURN(media_index < local_sdp->media_count &&
+		     media_index < rem_sdp->media_count, PJ_EINVAL);
+
+    pj_mutex_lock(m->bundle->mutex);
+    pj_bzero(m->pt_mask, sizeof(m->pt_mask));
+    add_pt(m, local_sdp->media[media_index]);
+    add_pt(m, rem_sdp->media[media_index]);
+    pj_mutex_unlock(m->bundle->mutex);
+
+    if (!m->is_tag)
+	return PJ_SUCCESS;
+
+    return pjmedia_transport_media_start(m->bundle->base_tp, pool, local_sdp,
+					 rem_sdp, media_index);
+}
+
+
+static pj_status_t transport_media_stop(pjmedia_transport *tp)
+{
+    struct member *m = (struct member*)tp;
+
+    if (!m->is_tag)
+	return PJ_SUCCESS;
+
+    return pjmedia_transport_media_stop(m->bundle->base_tp);
+}
+
+
+static pj_status_t transport_simulate_lost(pjmedia_transport *tp,
+				           pjmedia_dir dir,
+				           unsigned pct_lost)
+{
+    struct member *m = (struct member*)tp;
+    return pjmedia_transport_simulate_lost(m->bundle->base_tp, dir,
+					   pct_lost);
+}
+
+
+/*
+ * destroy() closes the member. The last member closes the base transport.
+ */
+static pj_status_t transport_destroy(pjmedia_transport *tp)
+{
+    struct member *m = (struct member*)tp;
+    struct bundle *bundle = m->bundle;
+    struct member **pm;
+    unsigned member_cnt;
+
+    transport_detach(tp, m->user_data);
+
+    pj_mutex_lock(bundle->mutex);
+    for (pm = &bundle->members; *pm; pm = &(*pm)->next) {
+	if (*pm == m) {
+	    *pm = m->next;
+	    break;
+	}
+    }
+    member_cnt = --bundle->member_cnt;
+    pj_mutex_unlock(bundle->mutex);
+
+    if (member_cnt)
+	return PJ_SUCCESS;
+
+    PJ_LOG(4,(bundle->pool->obj_name, "BUNDLE group destroyed"));
+
+    pjmedia_transport_close(bundle->base_tp);
+    pj_mutex_destroy(bundle->mutex);
+    pj_pool_release(bundle->pool);
+
+    return PJ_SUCCESS;
+}
+
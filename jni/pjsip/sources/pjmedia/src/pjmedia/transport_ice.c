@@ -69,6 +69,7 @@ struct transport_ice
     unsigned		 addr_len;	/**< Length of addresses.	    */
 
     pj_bool_t		 use_ice;
+    pj_bool_t		 rtcp_mux;	/**< RTCP is sent on RTP component. */
     pj_sockaddr		 rtp_src_addr;	/**< Actual source RTP address.	    */
     pj_sockaddr		 rtcp_src_addr;	/**< Actual source RTCP address.    */
     unsigned		 rtp_src_cnt;	/**< How many pkt from this addr.   */
@@ -175,6 +176,7 @@ static const pj_str_t STR_ICE_PWD	= { "ice-pwd", 7 };
 static const pj_str_t STR_IP4		= { "IP4", 3 };
 static const pj_str_t STR_IP6		= { "IP6", 3 };
 static const pj_str_t STR_RTCP		= { "rtcp", 4 };
+static const pj_str_t STR_RTCP_MUX	= { "rtcp-mux", 8 };
 static const pj_str_t STR_BANDW_RR	= { "RR", 2 };
 static const pj_str_t STR_BANDW_RS	= { "RS", 2 };
 
@@ -183,6 +185,18 @@ enum {
     COMP_RTCP = 2
 };
 
+
+/* Check if a packet received on the RTP component is actually RTCP, by
+ * looking at the payload type range reserved for RTCP (RFC 5761 section
+ * 4: RTCP packet types 192-223 overlap RTP payload types 64-95).
+ */
+static pj_bool_t is_rtcp_pkt(const void *pkt, pj_size_t size)
+{
+    const pj_uint8_t *p = (const pj_uint8_t*) pkt;
+
+    return size >= 8 && p[1] >= 192 && p[1] <= 223;
+}
+
 /*
  * Create ICE media transport.
  */
@@ -628,9 +642,14 @@ static pj_status_t encode_session_in_sdp(struct transport_ice *tp_ice,
 	attr = pjmedia_sdp_attr_find(m->attr_count, m->attr, &STR_RTCP, NULL);
 	if (attr)
 	    pjmedia_sdp_attr_remove(&m->attr_count, m->attr, attr);
-        /* If RTCP is not in use, we MUST send b=RS:0 and b=RR:0. */
+        /* If RTCP is not in use, we MUST send b=RS:0 and b=RR:0. RTCP is
+         * still in use when it is multiplexed on the RTP component.
+         */
         pj_assert(m->bandw_count + 2 <= PJ_ARRAY_SIZE(m->bandw));
-        if (m->bandw_count + 2 <= PJ_ARRAY_SIZE(m->bandw)) {
+        if (m->bandw_count + 2 <= PJ_ARRAY_SIZE(m->bandw) &&
+            !pjmedia_sdp_attr_find(m->attr_count, m->attr, &STR_RTCP_MUX,
+                                   NULL))
+        {
             m->bandw[m->bandw_count] = PJ_POOL_ZALLOC_T(sdp_pool,
                                                         pjmedia_sdp_bandw);
             pj_memcpy(&m->bandw[m->bandw_count]->modifier, &STR_BANDW_RS,
@@ -802,6 +821,7 @@ static pj_status_t verify_ice_sdp(struct transport_ice *tp_ice,
     const pjmedia_sdp_attr *ufrag_attr, *pwd_attr;
     const pjmedia_sdp_conn *rem_conn;
     pj_bool_t comp1_found=PJ_FALSE, comp2_found=PJ_FALSE, has_rtcp=PJ_FALSE;
+    pj_bool_t rtcp_mux;
     pj_sockaddr rem_conn_addr, rtcp_addr;
     unsigned i;
     pj_status_t status;
@@ -935,8 +955,13 @@ static pj_status_t verify_ice_sdp(struct transport_ice *tp_ice,
 	    break;
     }
 
+    /* With RTCP multiplexing (RFC 5761), only the RTP component is needed */
+    rtcp_mux = (tp_ice->media_option & PJMEDIA_TPMED_RTCP_MUX) &&
+	       pjmedia_sdp_attr_find(rem_m->attr_count, rem_m->attr,
+				     &STR_RTCP_MUX, NULL) != NULL;
+
     /* Check matched component count and ice_mismatch */
-    if (comp1_found && (tp_ice->comp_cnt==1 || !has_rtcp)) {
+    if (comp1_found && (tp_ice->comp_cnt==1 || !has_rtcp || rtcp_mux)) {
 	sdp_state->match_comp_cnt = 1;
 	sdp_state->ice_mismatch = PJ_FALSE;
     } else if (comp1_found && comp2_found) {
@@ -984,9 +1009,10 @@ static pj_status_t verify_ice_sdp(struct transport_ice *tp_ice,
 
     PJ_LOG(4,(tp_ice->base.name, 
 	      "Processing SDP: support ICE=%u, common comp_cnt=%u, "
-	      "ice_mismatch=%u, ice_restart=%u, local_role=%s",
+	      "rtcp_mux=%u, ice_mismatch=%u, ice_restart=%u, local_role=%s",
 	      (sdp_state->match_comp_cnt != 0), 
 	      sdp_state->match_comp_cnt, 
+	      rtcp_mux,
 	      sdp_state->ice_mismatch, 
 	      sdp_state->ice_restart,
 	      pj_ice_sess_role_name(sdp_state->local_role)));
@@ -1205,6 +1231,29 @@ static pj_status_t transport_encode_sdp(pjmedia_transport *tp,
 	}
     }
 
+    /* Offer RTCP multiplexing, or accept it when remote has offered it.
+     * This needs to be done before encoding ICE candidates, since only
+     * the RTP component is needed when RTCP is multiplexed.
+     */
+    if (tp_ice->media_option & PJMEDIA_TPMED_RTCP_MUX) {
+	pjmedia_sdp_media *loc_m, *rem_m;
+
+	rem_m = rem_sdp? rem_sdp->media[media_index] : NULL;
+	loc_m = sdp_local->media[media_index];
+
+	if (loc_m->desc.port &&
+	    (!rem_m || pjmedia_sdp_media_find_attr(rem_m, &STR_RTCP_MUX,
+						   NULL)) &&
+	    !pjmedia_sdp_media_find_attr(loc_m, &STR_RTCP_MUX, NULL) &&
+	    loc_m->attr_count < PJMEDIA_MAX_SDP_ATTR)
+	{
+	    pjmedia_sdp_attr *attr;
+
+	    attr = pjmedia_sdp_attr_create(sdp_pool, STR_RTCP_MUX.ptr, NULL);
+	    pjmedia_sdp_media_add_attr(loc_m, attr);
+	}
+    }
+
     if (tp_ice->initial_sdp) {
 	if (rem_sdp) {
 	    status = create_initial_answer(tp_ice, sdp_pool, sdp_local, 
@@ -1238,7 +1287,8 @@ static pj_status_t transport_encode_sdp(pjmedia_transport *tp,
 static pj_status_t start_ice(struct transport_ice *tp_ice,
 			     pj_pool_t *tmp_pool,
 			     const pjmedia_sdp_session *rem_sdp,
-			     unsigned media_index)
+			     unsigned media_index,
+			     unsigned comp_cnt)
 {
     pjmedia_sdp_media *rem_m = rem_sdp->media[media_index];
     const pjmedia_sdp_attr *ufrag_attr, *pwd_attr;
@@ -1274,6 +1324,10 @@ static pj_status_t start_ice(struct transport_ice *tp_ice,
 	    continue;
 	}
 
+	/* Skip RTCP candidates when RTCP is multiplexed */
+	if (cand[cand_cnt].comp_id > comp_cnt)
+	    continue;
+
 	cand_cnt++;
     }
 
@@ -1297,6 +1351,7 @@ static pj_status_t transport_media_start(pjmedia_transport *tp,
     pjmedia_sdp_media *rem_m;
     enum oa_role current_oa_role;
     pj_bool_t initial_oa;
+    unsigned comp_cnt;
     pj_status_t status;
 
     PJ_ASSERT_RETURN(tp && tmp_pool && rem_sdp, PJ_EINVAL);
@@ -1304,6 +1359,13 @@ static pj_status_t transport_media_start(pjmedia_transport *tp,
 
     rem_m = rem_sdp->media[media_index];
 
+    /* RTCP multiplexing is used when both sides have "a=rtcp-mux" */
+    tp_ice->rtcp_mux = (tp_ice->media_option & PJMEDIA_TPMED_RTCP_MUX) &&
+		       media_index < sdp_local->media_count &&
+		       pjmedia_sdp_media_find_attr(sdp_local->media[media_index],
+						   &STR_RTCP_MUX, NULL) &&
+		       pjmedia_sdp_media_find_attr(rem_m, &STR_RTCP_MUX, NULL);
+
     initial_oa = tp_ice->initial_sdp;
     current_oa_role = tp_ice->oa_role;
 
@@ -1394,6 +1456,7 @@ static pj_status_t transport_media_start(pjmedia_transport *tp,
 	}
 
 	/* Start ICE */
+	comp_cnt = answer_state.match_comp_cnt;
 
     } else {
 	/*
@@ -1465,10 +1528,11 @@ static pj_status_t transport_media_start(pjmedia_transport *tp,
 
 
 	/* start ICE */
+	comp_cnt = tp_ice->rem_offer_state.match_comp_cnt;
     }
 
     /* Now start ICE */
-    status = start_ice(tp_ice, tmp_pool, rem_sdp, media_index);
+    status = start_ice(tp_ice, tmp_pool, rem_sdp, media_index, comp_cnt);
     if (status != PJ_SUCCESS) {
 	PJ_LOG(1,(tp_ice->base.name, 
 		  "ICE restart failed (status=%d)!",
@@ -1652,7 +1716,15 @@ static pj_status_t transport_send_rtcp2(pjmedia_transport *tp,
 				        pj_size_t size)
 {
     struct transport_ice *tp_ice = (struct transport_ice*)tp;
-    if (tp_ice->comp_cnt > 1) {
+    if (tp_ice->rtcp_mux) {
+	/* RTCP is multiplexed with RTP on the RTP component */
+	if (addr == NULL) {
+	    addr = &tp_ice->remote_rtp;
+	    addr_len = tp_ice->addr_len;
+	}
+	return pj_ice_strans_sendto(tp_ice->ice_st, COMP_RTP, pkt, size,
+				    addr, addr_len);
+    } else if (tp_ice->comp_cnt > 1) {
 	if (addr == NULL) {
 	    addr = &tp_ice->remote_rtcp;
 	    addr_len = pj_sockaddr_get_len(addr);
@@ -1675,7 +1747,14 @@ static void ice_on_rx_data(pj_ice_strans *ice_st, unsigned comp_id,
 
     tp_ice = (struct transport_ice*) pj_ice_strans_get_user_data(ice_st);
 
-    if (comp_id==1 && tp_ice->rtp_cb) {
+    if (comp_id==1 && tp_ice->rtcp_mux && is_rtcp_pkt(pkt, size)) {
+
+	/* RTCP multiplexed on the RTP component (RFC 5761) */
+	pj_sockaddr_cp(&tp_ice->rtcp_src_addr, src_addr);
+	if (tp_ice->rtcp_cb)
+	    (*tp_ice->rtcp_cb)(tp_ice->stream, pkt, size);
+
+    } else if (comp_id==1 && tp_ice->rtp_cb) {
 
 	/* Simulate packet lost on RX direction */
 	if (tp_ice->rx_drop_pct) {
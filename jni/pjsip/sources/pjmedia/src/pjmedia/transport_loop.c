@@ -51,6 +51,8 @@ struct transport_loop
     unsigned		tx_drop_pct;	/**< Percent of tx pkts to drop.    */
     unsigned		rx_drop_pct;	/**< Percent of rx pkts to drop.    */
 
+    pj_sockaddr		rtp_addr;	/**< Advertised RTP address.	    */
+    pj_sockaddr		rtcp_addr;	/**< Advertised RTCP address.	    */
 };
 
 
@@ -123,18 +125,47 @@ static pjmedia_transport_op transport_udp_op =
 };
 
 
+/**
+ * Initialize loopback transport setting with default values.
+ */
+PJ_DEF(void) pjmedia_loop_tp_setting_default(pjmedia_loop_tp_setting *opt)
+{
+    pj_bzero(opt, sizeof(pjmedia_loop_tp_setting));
+    opt->af = pj_AF_INET();
+}
+
+
 /**
  * Create loopback transport.
  */
 PJ_DEF(pj_status_t) pjmedia_transport_loop_create(pjmedia_endpt *endpt,
 						  pjmedia_transport **p_tp)
 {
+    return pjmedia_transport_loop_create2(endpt, NULL, p_tp);
+}
+
+
+/**
+ * Create loopback transport with the specified settings.
+ */
+PJ_DEF(pj_status_t) pjmedia_transport_loop_create2(
+				    pjmedia_endpt *endpt,
+				    const pjmedia_loop_tp_setting *opt,
+				    pjmedia_transport **p_tp)
+{
+    pjmedia_loop_tp_setting def_opt;
     struct transport_loop *tp;
     pj_pool_t *pool;
+    pj_status_t status;
 
     /* Sanity check */
     PJ_ASSERT_RETURN(endpt && p_tp, PJ_EINVAL);
 
+    if (!opt) {
+	pjmedia_loop_tp_setting_default(&def_opt);
+	opt = &def_opt;
+    }
+
     /* Create transport structure */
     pool = pjmedia_endpt_create_pool(endpt, "tploop", 512, 512);
     if (!pool)
@@ -146,6 +177,16 @@ PJ_DEF(pj_status_t) pjmedia_transport_loop_create(pjmedia_endpt *endpt,
     tp->base.op = &transport_udp_op;
     tp->base.type = PJMEDIA_TRANSPORT_TYPE_UDP;
 
+    /* Advertised addresses */
+    status = pj_sockaddr_init(opt->af, &tp->rtp_addr, &opt->addr,
+			      (pj_uint16_t)opt->port);
+    if (status != PJ_SUCCESS) {
+	pj_pool_release(pool);
+	return status;
+    }
+    pj_sockaddr_cp(&tp->rtcp_addr, &tp->rtp_addr);
+    pj_sockaddr_set_port(&tp->rtcp_addr, (pj_uint16_t)(opt->port + 1));
+
     /* Done */
     *p_tp = &tp->base;
     return PJ_SUCCESS;
@@ -189,12 +230,14 @@ static pj_status_t transport_destroy(pjmedia_transport *tp)
 static pj_status_t transport_get_info(pjmedia_transport *tp,
 				      pjmedia_transport_info *info)
 {
+    struct transport_loop *loop = (struct transport_loop*) tp;
+
     PJ_ASSERT_RETURN(tp && info, PJ_EINVAL);
 
     info->sock_info.rtp_sock = 1;
-    pj_sockaddr_in_init(&info->sock_info.rtp_addr_name.ipv4, 0, 0);
+    pj_sockaddr_cp(&info->sock_info.rtp_addr_name, &loop->rtp_addr);
     info->sock_info.rtcp_sock = 2;
-    pj_sockaddr_in_init(&info->sock_info.rtcp_addr_name.ipv4, 0, 0);
+    pj_sockaddr_cp(&info->sock_info.rtcp_addr_name, &loop->rtcp_addr);
 
     return PJ_SUCCESS;
 }
@@ -38,6 +38,7 @@
 #define MAX_PENDING 4
 
 static const pj_str_t ID_RTP_AVP  = { "RTP/AVP", 7 };
+static const pj_str_t ID_RTCP_MUX = { "rtcp-mux", 8 };
 
 /* Pending write buffer */
 typedef struct pending_write
@@ -52,6 +53,7 @@ struct transport_udp
     pjmedia_transport	base;		/**< Base transport.		    */
 
     pj_pool_t	       *pool;		/**< Memory pool		    */
+    pj_ioqueue_t       *ioqueue;	/**< Ioqueue instance.		    */
     unsigned		options;	/**< Transport options.		    */
     unsigned		media_options;	/**< Transport media options.	    */
     void	       *user_data;	/**< Only valid when attached	    */
@@ -89,6 +91,10 @@ struct transport_udp
     pj_ioqueue_op_key_t rtcp_read_op;	/**< Pending read operation	    */
     pj_ioqueue_op_key_t rtcp_write_op;	/**< Pending write operation	    */
     char		rtcp_pkt[RTCP_LEN];/**< Incoming RTCP packet buffer */
+
+    pj_bool_t		rtcp_mux;	/**< RTCP is sent on RTP socket.    */
+    pj_sockaddr		rtcp_bound_addr;/**< RTCP bound address, to reopen
+					     RTCP socket after RTCP mux.    */
 };
 
 
@@ -99,6 +105,7 @@ static void on_rx_rtp( pj_ioqueue_key_t *key,
 static void on_rx_rtcp(pj_ioqueue_key_t *key, 
                        pj_ioqueue_op_key_t *op_key, 
                        pj_ssize_t bytes_read);
+static pj_status_t start_rtcp_sock(struct transport_udp *tp);
 
 /*
  * These are media transport operations.
@@ -271,11 +278,26 @@ PJ_DEF(pj_status_t) pjmedia_transport_udp_attach( pjmedia_endpt *endpt,
 						  const pjmedia_sock_info *si,
 						  unsigned options,
 						  pjmedia_transport **p_tp)
+{
+    return pjmedia_transport_udp_attach2(endpt, name, si, options, NULL,
+					 p_tp);
+}
+
+
+/**
+ * Create UDP stream transport from existing socket info, polled by
+ * the specified ioqueue.
+ */
+PJ_DEF(pj_status_t) pjmedia_transport_udp_attach2(pjmedia_endpt *endpt,
+						  const char *name,
+						  const pjmedia_sock_info *si,
+						  unsigned options,
+						  pj_ioqueue_t *ioqueue,
+						  pjmedia_transport **p_tp)
 {
     struct transport_udp *tp;
     pj_pool_t *pool;
-    pj_ioqueue_t *ioqueue;
-    pj_ioqueue_callback rtp_cb, rtcp_cb;
+    pj_ioqueue_callback rtp_cb;
     pj_ssize_t size;
     unsigned i;
     pj_status_t status;
@@ -285,7 +307,8 @@ PJ_DEF(pj_status_t) pjmedia_transport_udp_attach( pjmedia_endpt *endpt,
     PJ_ASSERT_RETURN(endpt && si && p_tp, PJ_EINVAL);
 
     /* Get ioqueue instance */
-    ioqueue = pjmedia_endpt_get_ioqueue(endpt);
+    if (ioqueue == NULL)
+	ioqueue = pjmedia_endpt_get_ioqueue(endpt);
 
     if (name==NULL)
 	name = "udp%p";
@@ -297,6 +320,7 @@ PJ_DEF(pj_status_t) pjmedia_transport_udp_attach( pjmedia_endpt *endpt,
 
     tp = PJ_POOL_ZALLOC_T(pool, struct transport_udp);
     tp->pool = pool;
+    tp->ioqueue = ioqueue;
     tp->options = options;
     pj_memcpy(tp->base.name, pool->obj_name, PJ_MAX_OBJ_NAME);
     tp->base.op = &transport_udp_op;
@@ -360,22 +384,46 @@ PJ_DEF(pj_status_t) pjmedia_transport_udp_attach( pjmedia_endpt *endpt,
 
 
     /* Setup RTCP socket with ioqueue */
+    status = start_rtcp_sock(tp);
+    if (status != PJ_SUCCESS)
+	goto on_error;
+
+
+    /* Done */
+    *p_tp = &tp->base;
+    return PJ_SUCCESS;
+
+
+on_error:
+    transport_destroy(&tp->base);
+    return status;
+}
+
+
+/*
+ * Register RTCP socket to the ioqueue and kick off pending read.
+ */
+static pj_status_t start_rtcp_sock(struct transport_udp *tp)
+{
+    pj_ioqueue_callback rtcp_cb;
+    pj_ssize_t size;
+    pj_status_t status;
+
     pj_bzero(&rtcp_cb, sizeof(rtcp_cb));
     rtcp_cb.on_read_complete = &on_rx_rtcp;
 
-    status = pj_ioqueue_register_sock(pool, ioqueue, tp->rtcp_sock, tp,
-				      &rtcp_cb, &tp->rtcp_key);
+    status = pj_ioqueue_register_sock(tp->pool, tp->ioqueue, tp->rtcp_sock,
+				      tp, &rtcp_cb, &tp->rtcp_key);
     if (status != PJ_SUCCESS)
-	goto on_error;
+	return status;
 
     status = pj_ioqueue_set_concurrency(tp->rtcp_key, PJ_FALSE);
     if (status != PJ_SUCCESS)
-	goto on_error;
+	return status;
 
     pj_ioqueue_op_key_init(&tp->rtcp_read_op, sizeof(tp->rtcp_read_op));
     pj_ioqueue_op_key_init(&tp->rtcp_write_op, sizeof(tp->rtcp_write_op));
 
-
     /* Kick of pending RTCP read from the ioqueue */
     size = sizeof(tp->rtcp_pkt);
     tp->rtcp_addr_len = sizeof(tp->rtcp_src_addr);
@@ -383,17 +431,90 @@ PJ_DEF(pj_status_t) pjmedia_transport_udp_attach( pjmedia_endpt *endpt,
 				  tp->rtcp_pkt, &size, PJ_IOQUEUE_ALWAYS_ASYNC,
 				  &tp->rtcp_src_addr, &tp->rtcp_addr_len);
     if (status != PJ_EPENDING)
-	goto on_error;
+	return status;
 
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Close the RTCP socket once RTCP is multiplexed on the RTP socket, so
+ * each media line only holds one socket. The socket is reopened on the
+ * same address if a later offer/answer turns multiplexing off again.
+ */
+static void close_rtcp_sock(struct transport_udp *udp)
+{
+    int addr_len = sizeof(udp->rtcp_bound_addr);
+
+    if (udp->rtcp_sock == PJ_INVALID_SOCKET)
+	return;
+
+    if (pj_sock_getsockname(udp->rtcp_sock, &udp->rtcp_bound_addr,
+			    &addr_len) != PJ_SUCCESS)
+    {
+	/* Without the bound address the socket can't be reopened */
+	return;
+    }
+
+    if (udp->rtcp_key) {
+	pj_ioqueue_unregister(udp->rtcp_key);
+	udp->rtcp_key = NULL;
+    } else {
+	pj_sock_close(udp->rtcp_sock);
+    }
+    udp->rtcp_sock = PJ_INVALID_SOCKET;
+
+    PJ_LOG(5,(udp->base.name, "RTCP is multiplexed, RTCP socket closed"));
+}
+
+
+/*
+ * Reopen RTCP socket closed by close_rtcp_sock().
+ */
+static pj_status_t reopen_rtcp_sock(struct transport_udp *udp)
+{
+    pj_status_t status;
+
+    if (udp->rtcp_sock != PJ_INVALID_SOCKET)
+	return PJ_SUCCESS;
+
+    status = pj_sock_socket(udp->rtcp_bound_addr.addr.sa_family,
+			    pj_SOCK_DGRAM(), 0, &udp->rtcp_sock);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    status = pj_sock_bind(udp->rtcp_sock, &udp->rtcp_bound_addr,
+			  pj_sockaddr_get_len(&udp->rtcp_bound_addr));
+    if (status == PJ_SUCCESS)
+	status = start_rtcp_sock(udp);
+
+    if (status != PJ_SUCCESS) {
+	if (udp->rtcp_key) {
+	    pj_ioqueue_unregister(udp->rtcp_key);
+	    udp->rtcp_key = NULL;
+	} else {
+	    pj_sock_close(udp->rtcp_sock);
+	}
+	udp->rtcp_sock = PJ_INVALID_SOCKET;
+	return status;
+    }
+
+    PJ_LOG(5,(udp->base.name, "RTCP is no longer multiplexed, RTCP socket "
+	      "reopened"));
 
-    /* Done */
-    *p_tp = &tp->base;
     return PJ_SUCCESS;
+}
 
 
-on_error:
-    transport_destroy(&tp->base);
-    return status;
+/* Check if a packet received on the RTP socket is actually RTCP, by
+ * looking at the payload type range reserved for RTCP (RFC 5761 section
+ * 4: RTCP packet types 192-223 overlap RTP payload types 64-95).
+ */
+static pj_bool_t is_rtcp_pkt(const void *pkt, pj_ssize_t size)
+{
+    const pj_uint8_t *p = (const pj_uint8_t*) pkt;
+
+    return size >= 8 && p[1] >= 192 && p[1] <= 223;
 }
 
 
@@ -454,12 +575,20 @@ static void on_rx_rtp( pj_ioqueue_key_t *key,
 	void (*cb)(void*,void*,pj_ssize_t);
 	void *user_data;
 	pj_bool_t discard = PJ_FALSE;
-
-	cb = udp->rtp_cb;
+	pj_bool_t is_rtcp;
+
+	/* With RTCP multiplexing, RTCP is received on the RTP socket too */
+	is_rtcp = udp->rtcp_mux && is_rtcp_pkt(udp->rtp_pkt, bytes_read);
+	if (is_rtcp) {
+	    cb = udp->rtcp_cb;
+	    pj_sockaddr_cp(&udp->rtcp_src_addr, &udp->rtp_src_addr);
+	} else {
+	    cb = udp->rtp_cb;
+	}
 	user_data = udp->user_data;
 
 	/* Simulate packet lost on RX direction */
-	if (udp->rx_drop_pct) {
+	if (udp->rx_drop_pct && !is_rtcp) {
 	    if ((pj_rand() % 100) <= (int)udp->rx_drop_pct) {
 		PJ_LOG(5,(udp->base.name, 
 			  "RX RTP packet dropped because of pkt lost "
@@ -473,7 +602,7 @@ static void on_rx_rtp( pj_ioqueue_key_t *key,
 	 * source packet address after several consecutive packets
 	 * have been received.
 	 */
-	if (bytes_read>0 && 
+	if (bytes_read>0 && !is_rtcp &&
 	    (udp->options & PJMEDIA_UDP_NO_SRC_ADDR_CHECKING)==0) 
 	{
 	    if (pj_sockaddr_cmp(&udp->rem_rtp_addr, &udp->rtp_src_addr) == 0) {
@@ -655,7 +784,8 @@ static pj_status_t transport_attach(   pjmedia_transport *tp,
      * not executed. See ticket #844 for details.
      */
     pj_ioqueue_lock_key(udp->rtp_key);
-    pj_ioqueue_lock_key(udp->rtcp_key);
+    if (udp->rtcp_key)
+	pj_ioqueue_lock_key(udp->rtcp_key);
 
     /* "Attach" the application: */
 
@@ -694,7 +824,8 @@ static pj_status_t transport_attach(   pjmedia_transport *tp,
     udp->rtcp_src_cnt = 0;
 
     /* Unlock keys */
-    pj_ioqueue_unlock_key(udp->rtcp_key);
+    if (udp->rtcp_key)
+	pj_ioqueue_unlock_key(udp->rtcp_key);
     pj_ioqueue_unlock_key(udp->rtp_key);
 
     return PJ_SUCCESS;
@@ -714,7 +845,8 @@ static void transport_detach( pjmedia_transport *tp,
 	 * not executed. See ticket #460 for details.
 	 */
 	pj_ioqueue_lock_key(udp->rtp_key);
-	pj_ioqueue_lock_key(udp->rtcp_key);
+	if (udp->rtcp_key)
+	    pj_ioqueue_lock_key(udp->rtcp_key);
 
 	/* User data is unreferenced on Release build */
 	PJ_UNUSED_ARG(user_data);
@@ -731,7 +863,8 @@ static void transport_detach( pjmedia_transport *tp,
 	udp->user_data = NULL;
 
 	/* Unlock keys */
-	pj_ioqueue_unlock_key(udp->rtcp_key);
+	if (udp->rtcp_key)
+	    pj_ioqueue_unlock_key(udp->rtcp_key);
 	pj_ioqueue_unlock_key(udp->rtp_key);
     }
 }
@@ -807,18 +940,35 @@ static pj_status_t transport_send_rtcp2(pjmedia_transport *tp,
 				        pj_size_t size)
 {
     struct transport_udp *udp = (struct transport_udp*)tp;
+    pj_ioqueue_key_t *key;
     pj_ssize_t sent;
     pj_status_t status;
 
     PJ_ASSERT_RETURN(udp->attached, PJ_EINVALIDOP);
 
-    if (addr == NULL) {
-	addr = &udp->rem_rtcp_addr;
-	addr_len = udp->addr_len;
+    /* When RTCP is multiplexed, send it with the RTP socket to the
+     * remote RTP address.
+     */
+    if (udp->rtcp_mux) {
+	key = udp->rtp_key;
+	if (addr == NULL) {
+	    addr = &udp->rem_rtp_addr;
+	    addr_len = udp->addr_len;
+	}
+    } else {
+	key = udp->rtcp_key;
+	if (addr == NULL) {
+	    addr = &udp->rem_rtcp_addr;
+	    addr_len = udp->addr_len;
+	}
     }
 
+    /* RTCP socket could not be reopened after RTCP mux was turned off */
+    if (key == NULL)
+	return PJ_EINVALIDOP;
+
     sent = size;
-    status = pj_ioqueue_sendto( udp->rtcp_key, &udp->rtcp_write_op,
+    status = pj_ioqueue_sendto( key, &udp->rtcp_write_op,
 				pkt, &sent, 0, addr, addr_len);
 
     if (status==PJ_SUCCESS || status==PJ_EPENDING)
@@ -869,6 +1019,25 @@ static pj_status_t transport_encode_sdp(pjmedia_transport *tp,
 	}
     }
 
+    /* Offer RTCP multiplexing, or accept it when remote has offered it */
+    if (udp->media_options & PJMEDIA_TPMED_RTCP_MUX) {
+	pjmedia_sdp_media *m_rem, *m_loc;
+
+	m_rem = rem_sdp? rem_sdp->media[media_index] : NULL;
+	m_loc = sdp_local->media[media_index];
+
+	if (m_loc->desc.port &&
+	    (!m_rem || pjmedia_sdp_media_find_attr(m_rem, &ID_RTCP_MUX, NULL)) &&
+	    !pjmedia_sdp_media_find_attr(m_loc, &ID_RTCP_MUX, NULL) &&
+	    m_loc->attr_count < PJMEDIA_MAX_SDP_ATTR)
+	{
+	    pjmedia_sdp_attr *attr;
+
+	    attr = pjmedia_sdp_attr_create(pool, ID_RTCP_MUX.ptr, NULL);
+	    pjmedia_sdp_media_add_attr(m_loc, attr);
+	}
+    }
+
     return PJ_SUCCESS;
 }
 
@@ -878,13 +1047,42 @@ static pj_status_t transport_media_start(pjmedia_transport *tp,
 				  const pjmedia_sdp_session *sdp_remote,
 				  unsigned media_index)
 {
+    struct transport_udp *udp = (struct transport_udp*)tp;
+    pj_bool_t rtcp_mux = PJ_FALSE;
+
     PJ_ASSERT_RETURN(tp && pool && sdp_local, PJ_EINVAL);
 
-    PJ_UNUSED_ARG(tp);
-    PJ_UNUSED_ARG(pool);
-    PJ_UNUSED_ARG(sdp_local);
-    PJ_UNUSED_ARG(sdp_remote);
-    PJ_UNUSED_ARG(media_index);
+    /* RTCP multiplexing is used when both sides have "a=rtcp-mux" */
+    if ((udp->media_options & PJMEDIA_TPMED_RTCP_MUX) && sdp_remote &&
+	media_index < sdp_local->media_count &&
+	media_index < sdp_remote->media_count)
+    {
+	rtcp_mux = pjmedia_sdp_media_find_attr(sdp_local->media[media_index],
+					       &ID_RTCP_MUX, NULL) &&
+		   pjmedia_sdp_media_find_attr(sdp_remote->media[media_index],
+					       &ID_RTCP_MUX, NULL);
+    }
+
+    if (rtcp_mux == udp->rtcp_mux)
+	return PJ_SUCCESS;
+
+    if (!rtcp_mux) {
+	pj_status_t status = reopen_rtcp_sock(udp);
+	if (status != PJ_SUCCESS) {
+	    PJ_PERROR(2,(udp->base.name, status,
+			 "Warning: unable to reopen RTCP socket"));
+	}
+    }
+
+    pj_ioqueue_lock_key(udp->rtp_key);
+    udp->rtcp_mux = rtcp_mux;
+    pj_ioqueue_unlock_key(udp->rtp_key);
+
+    if (rtcp_mux)
+	close_rtcp_sock(udp);
+
+    PJ_LOG(4,(udp->base.name, "RTCP multiplexing is %s",
+	      (rtcp_mux? "enabled" : "disabled")));
 
     return PJ_SUCCESS;
 }
@@ -152,9 +152,11 @@ static pj_status_t create_converter(pjmedia_vid_port *vp)
 	}
     }
 
-    if (vp->conv.conv ||
-        (vp->role==ROLE_ACTIVE && (vp->dir & PJMEDIA_DIR_ENCODING)))
-    {
+    /* Without a converter the encoding clock hands frm_buf directly to
+     * the client, so the conversion buffer is only needed along with
+     * the converter.
+     */
+    if (vp->conv.conv) {
 	pj_status_t status;
 	const pjmedia_video_format_info *vfi;
 	pjmedia_video_apply_fmt_param vafp;
@@ -717,6 +719,19 @@ static void enc_clock_cb(const pj_timestamp *ts, void *user_data)
 
     //save_rgb_frame(vp->cap_size.w, vp->cap_size.h, vp->frm_buf);
 
+    if (!vp->conv.conv) {
+        /* No conversion is needed, so hand the captured buffer straight
+         * to the client (e.g: the encoder) instead of copying it. The
+         * buffer is kept locked until the client has consumed it, so an
+         * active stream can't overwrite it halfway through encoding.
+         */
+        pj_mutex_lock(vp->frm_mutex);
+        frame_ = *vp->frm_buf;
+        status = pjmedia_port_put_frame(vp->client_port, &frame_);
+        pj_mutex_unlock(vp->frm_mutex);
+        return;
+    }
+
     frame_.buf = vp->conv.conv_buf;
     frame_.size = vp->conv.conv_buf_size;
     status = get_frame_from_buffer(vp, &frame_);
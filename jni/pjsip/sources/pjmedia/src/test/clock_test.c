@@ -0,0 +1,121 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2011-2011 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE   "clock_test.c"
+
+#define CLOCK_CNT   20
+#define PTIME	    20		/* msec */
+#define DURATION    2000	/* msec */
+
+
+static void clock_cb(const pj_timestamp *ts, void *user_data)
+{
+    PJ_UNUSED_ARG(ts);
+    PJ_UNUSED_ARG(user_data);
+}
+
+/* Run CLOCK_CNT asynchronous clocks, as many calls with a conference
+ * bridge each would, and report the thread wakeups and the tick jitter.
+ */
+static int run_clocks(unsigned options, const char *title)
+{
+    pj_pool_t *pool;
+    pjmedia_clock *clocks[CLOCK_CNT];
+    pjmedia_clock_stat stat;
+    pj_uint32_t wakeups = 0, ticks = 0;
+    pj_int32_t late_mean = 0, late_max = 0, late_dev = 0;
+    unsigned i, cnt = 0;
+    int rc = 0;
+
+    pool = pj_pool_create(mem, "clocktest", 1000, 1000, NULL);
+
+    for (cnt=0; cnt<CLOCK_CNT; ++cnt) {
+	pj_status_t status;
+
+	status = pjmedia_clock_create(pool, 8000, 1, 8000 * PTIME / 1000,
+				      options, &clock_cb, NULL,
+				      &clocks[cnt]);
+	if (status == PJ_SUCCESS)
+	    status = pjmedia_clock_start(clocks[cnt]);
+	if (status != PJ_SUCCESS) {
+	    app_perror(status, "   error creating clock");
+	    rc = -10;
+	    goto on_return;
+	}
+    }
+
+    pj_thread_sleep(DURATION);
+
+    for (i=0; i<cnt; ++i) {
+	pjmedia_clock_stop(clocks[i]);
+	pjmedia_clock_get_stat(clocks[i], &stat);
+
+	/* Clocks on a shared thread all report its wakeups */
+	if (options & PJMEDIA_CLOCK_NO_HIGHEST_PRIO)
+	    wakeups += stat.thread_wakeups;
+	else if (stat.thread_wakeups > wakeups)
+	    wakeups = stat.thread_wakeups;
+
+	ticks += stat.tick_cnt;
+	late_mean += stat.late_usec.mean;
+	late_dev += pj_math_stat_get_stddev(&stat.late_usec);
+	if (stat.late_usec.max > late_max)
+	    late_max = stat.late_usec.max;
+
+	/* Only check that the clock ran, the timing depends on the load */
+	if (stat.tick_cnt < DURATION / PTIME / 2) {
+	    PJ_LOG(3,(THIS_FILE, "   %s: clock %d only ticked %u times",
+		      title, i, stat.tick_cnt));
+	    rc = -20;
+	}
+    }
+
+    PJ_LOG(3,(THIS_FILE, "   %s: %u ticks, %u thread wakeups%s, late "
+	      "mean=%d stddev=%d max=%d usec", title, ticks, wakeups,
+	      (options & PJMEDIA_CLOCK_NO_HIGHEST_PRIO) ? "" :
+	      " (busiest scheduler)",
+	      late_mean / CLOCK_CNT, late_dev / CLOCK_CNT, late_max));
+
+on_return:
+    for (i=0; i<cnt; ++i)
+	pjmedia_clock_destroy(clocks[i]);
+    pj_pool_release(pool);
+    return rc;
+}
+
+int clock_test(void)
+{
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "  %d clocks with %d ms interval:", CLOCK_CNT,
+	      PTIME));
+
+    rc = run_clocks(PJMEDIA_CLOCK_NO_HIGHEST_PRIO, "own threads");
+    if (rc != 0)
+	return rc;
+
+#if PJMEDIA_CLOCK_SCHED_THREAD_CNT > 0
+    rc = run_clocks(0, "shared");
+    if (rc != 0)
+	return rc - 100;
+#endif
+
+    return 0;
+}
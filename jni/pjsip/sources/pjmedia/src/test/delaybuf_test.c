@@ -0,0 +1,137 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2011-2011 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE   "delaybuf_test.c"
+
+#define CLOCK_RATE	8000
+#define PTIME		20
+#define SPF		(CLOCK_RATE * PTIME / 1000)
+#define MAX_DELAY	(PJMEDIA_SOUND_BUFFER_COUNT * PTIME)
+#define DURATION	600	/* seconds of audio per run	    */
+#define SETTLE_TIME	120	/* seconds before events are counted */
+#define PUT_BURST	2	/* frames per producer callback	    */
+
+/* Skew of the producer clock against the consumer clock, in ppm */
+static const int skews[] = { 0, 100, -100, 1000, -1000, 3000, -3000 };
+
+
+/* Run a producer and a consumer at skewed rates in virtual time, as
+ * a capture and a playback device with separate clocks would do.
+ */
+static int run_skew(pj_pool_t *pool, int skew)
+{
+    pjmedia_delay_buf *db;
+    pjmedia_delay_buf_stat stat;
+    pj_int16_t frame[SPF];
+    pj_uint64_t put_time = 0, get_time = 0;
+    pj_uint64_t put_period, get_period;
+    pj_timestamp t0, t1, elapsed;
+    unsigned get_cnt = 0, phase = 0, events;
+    unsigned settle_shrink = 0, settle_expand = 0;
+    pj_status_t status;
+    int rc = 0;
+
+    status = pjmedia_delay_buf_create(pool, "dbtest", CLOCK_RATE, SPF, 1,
+				      MAX_DELAY, 0, &db);
+    if (status != PJ_SUCCESS) {
+	app_perror(status, "Error creating delay buffer");
+	return -10;
+    }
+
+    /* Periods in ns */
+    get_period = PTIME * 1000000;
+    put_period = get_period * PUT_BURST * 1000000 / (1000000 + skew);
+
+    elapsed.u64 = 0;
+    while (get_cnt < DURATION * 1000 / PTIME) {
+	if (put_time <= get_time) {
+	    unsigned i, j;
+
+	    for (i=0; i<PUT_BURST; ++i) {
+		for (j=0; j<SPF; ++j, ++phase)
+		    frame[j] = (pj_int16_t)((phase & 16) ? 4000 : -4000);
+		pjmedia_delay_buf_put(db, frame);
+	    }
+	    put_time += put_period;
+	} else {
+	    pj_get_timestamp(&t0);
+	    pjmedia_delay_buf_get(db, frame);
+	    pj_get_timestamp(&t1);
+	    elapsed.u64 += t1.u64 - t0.u64;
+
+	    get_time += get_period;
+	    if (++get_cnt == SETTLE_TIME * 1000 / PTIME) {
+		pjmedia_delay_buf_get_stat(db, &stat);
+		settle_shrink = stat.shrink_cnt;
+		settle_expand = stat.expand_cnt;
+	    }
+	}
+    }
+
+    pjmedia_delay_buf_get_stat(db, &stat);
+    events = stat.shrink_cnt - settle_shrink + stat.expand_cnt - settle_expand;
+
+    t0.u64 = 0;
+    PJ_LOG(3,(THIS_FILE, "  skew %5d ppm: drift=%5d ppm, buf_cnt=%3u, "
+	      "shrink=%u, expand=%u, %u after settling, %u nsec per get",
+	      skew, stat.drift, stat.buf_cnt, stat.shrink_cnt,
+	      stat.expand_cnt, events,
+	      pj_elapsed_nanosec(&t0, &elapsed) / get_cnt));
+
+#if PJMEDIA_DELAY_BUF_MAX_DRIFT
+    /* Drift within the limit must not need WSOLA once the rate is
+     * learnt. The estimate follows the level changes caused by the two
+     * clocks slipping past each other, so it is only checked roughly.
+     */
+    if (skew < PJMEDIA_DELAY_BUF_MAX_DRIFT &&
+	skew > -PJMEDIA_DELAY_BUF_MAX_DRIFT)
+    {
+	int err = stat.drift - skew;
+	int tolerance = 100 + (skew < 0 ? -skew : skew) / 2;
+
+	if (events)
+	    rc = -20;
+	else if (err > tolerance || -err > tolerance)
+	    rc = -30;
+    }
+#endif
+
+    pjmedia_delay_buf_destroy(db);
+    return rc;
+}
+
+int delaybuf_test(void)
+{
+    pj_pool_t *pool;
+    unsigned i;
+    int rc = 0;
+
+    PJ_LOG(3,(THIS_FILE, "  %d s of %d ms frames, producer in bursts of %d",
+	      DURATION, PTIME, PUT_BURST));
+
+    pool = pj_pool_create(mem, "dbtest", 4000, 4000, NULL);
+
+    for (i=0; i<PJ_ARRAY_SIZE(skews) && rc == 0; ++i)
+	rc = run_skew(pool, skews[i]);
+
+    pj_pool_release(pool);
+
+    return rc;
+}
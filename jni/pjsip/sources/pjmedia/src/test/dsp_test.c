@@ -0,0 +1,293 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE   "dsp_test.c"
+
+/* Large enough for the celt/silk pitch search and codec2 frames */
+#define MAX_LEN	    720
+#define MAX_LAG	    300
+#define MAX_TAP	    64
+#define ROUNDS	    200
+/* Speex echo canceller with 20ms frames at 16kHz and a 200ms tail */
+#define MAX_SPEC    640
+#define MAX_BLK	    10
+#define MAX_STAGES  10
+
+static pj_int16_t x16[MAX_LEN + MAX_LAG];
+static pj_int16_t y16[MAX_LEN + MAX_LAG];
+static float xf[MAX_LEN + MAX_TAP];
+static float hf[MAX_TAP];
+static float xs[MAX_SPEC * MAX_BLK];
+static float ys[MAX_SPEC * MAX_BLK];
+static pj_int16_t fft_in[2 << MAX_STAGES];
+static pj_int16_t fft_ref[2 << MAX_STAGES];
+static pj_int16_t fft_out[2 << MAX_STAGES];
+
+
+static void fill_vectors(pj_bool_t extreme)
+{
+    unsigned i;
+
+    for (i=0; i<PJ_ARRAY_SIZE(x16); ++i) {
+	if (extreme) {
+	    /* Makes the pairwise sums and the total wrap around */
+	    x16[i] = -32768;
+	    y16[i] = (i & 1) ? 32767 : -32768;
+	} else {
+	    x16[i] = (pj_int16_t)(pj_rand() & 0xFFFF);
+	    y16[i] = (pj_int16_t)(pj_rand() & 0xFFFF);
+	}
+    }
+    for (i=0; i<PJ_ARRAY_SIZE(xf); ++i)
+	xf[i] = (float)((pj_rand() % 65536) - 32768) / 32768.0f;
+    for (i=0; i<PJ_ARRAY_SIZE(hf); ++i)
+	hf[i] = (float)((pj_rand() % 2001) - 1000) / 1000.0f;
+    for (i=0; i<PJ_ARRAY_SIZE(xs); ++i) {
+	xs[i] = (float)((pj_rand() % 65536) - 32768);
+	ys[i] = (float)((pj_rand() % 2001) - 1000) / 1000.0f;
+    }
+    for (i=0; i<PJ_ARRAY_SIZE(fft_in); ++i) {
+	/* Full scale samples with random signs make the larger FFTs wrap
+	 * around 16 bits
+	 */
+	if (extreme)
+	    fft_in[i] = (pj_int16_t)((pj_rand() & 1) ? 32767 : -32768);
+	else
+	    fft_in[i] = (pj_int16_t)(pj_rand() & 0xFFFF);
+    }
+}
+
+/* Compare every kernel of the implementation for "features" with the
+ * scalar reference on one set of lengths.
+ */
+static int compare_one(unsigned features, unsigned len, unsigned lag_cnt,
+		       unsigned tap_cnt)
+{
+    pj_int32_t ref_xc[MAX_LAG], xc[MAX_LAG];
+    float ref_f[MAX_LEN], out_f[MAX_LEN];
+    pj_int32_t ref_ip, ip;
+    unsigned ac_len = (len < lag_cnt) ? lag_cnt : len;
+
+    pjmedia_dsp_set_features(0);
+    ref_ip = pjmedia_dsp_inner_prod16(x16, y16, len);
+    pjmedia_dsp_set_features(features);
+    ip = pjmedia_dsp_inner_prod16(x16, y16, len);
+    if (ip != ref_ip)
+	return -10;
+
+    pjmedia_dsp_set_features(0);
+    pjmedia_dsp_xcorr16(x16, y16, ref_xc, len, lag_cnt);
+    pjmedia_dsp_set_features(features);
+    pjmedia_dsp_xcorr16(x16, y16, xc, len, lag_cnt);
+    if (pj_memcmp(xc, ref_xc, lag_cnt * sizeof(xc[0])) != 0)
+	return -20;
+
+    pjmedia_dsp_set_features(0);
+    pjmedia_dsp_autocorr_f(xf, ref_f, ac_len, lag_cnt);
+    pjmedia_dsp_set_features(features);
+    pjmedia_dsp_autocorr_f(xf, out_f, ac_len, lag_cnt);
+    if (pj_memcmp(out_f, ref_f, lag_cnt * sizeof(out_f[0])) != 0)
+	return -30;
+
+    pjmedia_dsp_set_features(0);
+    pjmedia_dsp_fir_f(xf, hf, ref_f, len, tap_cnt);
+    pjmedia_dsp_set_features(features);
+    pjmedia_dsp_fir_f(xf, hf, out_f, len, tap_cnt);
+    if (pj_memcmp(out_f, ref_f, len * sizeof(out_f[0])) != 0)
+	return -40;
+
+    return 0;
+}
+
+/* Compare the FFT kernels with the scalar reference for every size */
+static int compare_fft(unsigned features)
+{
+    unsigned stages, precise, len;
+    int ref_scale, scale;
+
+    for (stages=0; stages<=MAX_STAGES; ++stages) {
+	len = 2 << stages;
+
+	for (precise=0; precise<2; ++precise) {
+	    pj_memcpy(fft_ref, fft_in, len * sizeof(fft_in[0]));
+	    pj_memcpy(fft_out, fft_in, len * sizeof(fft_in[0]));
+	    pjmedia_dsp_set_features(0);
+	    pjmedia_dsp_cfft16(fft_ref, stages, precise);
+	    pjmedia_dsp_set_features(features);
+	    pjmedia_dsp_cfft16(fft_out, stages, precise);
+	    if (pj_memcmp(fft_out, fft_ref, len * sizeof(fft_out[0])) != 0)
+		return -50;
+
+	    pj_memcpy(fft_ref, fft_in, len * sizeof(fft_in[0]));
+	    pj_memcpy(fft_out, fft_in, len * sizeof(fft_in[0]));
+	    pjmedia_dsp_set_features(0);
+	    ref_scale = pjmedia_dsp_cifft16(fft_ref, stages, precise);
+	    pjmedia_dsp_set_features(features);
+	    scale = pjmedia_dsp_cifft16(fft_out, stages, precise);
+	    if (scale != ref_scale ||
+		pj_memcmp(fft_out, fft_ref, len * sizeof(fft_out[0])) != 0)
+	    {
+		return -60;
+	    }
+	}
+    }
+
+    return 0;
+}
+
+static int compare_spectrum(unsigned features, unsigned len,
+			    unsigned blk_cnt)
+{
+    float ref_f[MAX_SPEC], out_f[MAX_SPEC];
+
+    pjmedia_dsp_set_features(0);
+    pjmedia_dsp_spectrum_mac_f(xs, ys, ref_f, len, blk_cnt);
+    pjmedia_dsp_set_features(features);
+    pjmedia_dsp_spectrum_mac_f(xs, ys, out_f, len, blk_cnt);
+    if (pj_memcmp(out_f, ref_f, len * sizeof(out_f[0])) != 0)
+	return -70;
+
+    return 0;
+}
+
+static int compare_impl(unsigned features)
+{
+    unsigned i;
+    int rc;
+
+    fill_vectors(PJ_TRUE);
+    rc = compare_one(features, MAX_LEN, MAX_LAG, MAX_TAP);
+    if (rc == 0)
+	rc = compare_fft(features);
+    if (rc != 0)
+	return rc - 1;
+
+    for (i=0; i<ROUNDS; ++i) {
+	unsigned len = pj_rand() % (MAX_LEN + 1);
+	unsigned lag_cnt = pj_rand() % (MAX_LAG + 1);
+	unsigned tap_cnt = pj_rand() % (MAX_TAP + 1);
+
+	fill_vectors(PJ_FALSE);
+	rc = compare_one(features, len, lag_cnt, tap_cnt);
+	if (rc != 0) {
+	    PJ_LOG(3,(THIS_FILE, "   %s mismatch: len=%u lag=%u tap=%u",
+		      pjmedia_dsp_get_impl_name(), len, lag_cnt, tap_cnt));
+	    return rc;
+	}
+    }
+
+    for (i=0; i<ROUNDS; ++i) {
+	unsigned len = 2 + (pj_rand() % (MAX_SPEC / 2)) * 2;
+	unsigned blk_cnt = pj_rand() % (MAX_BLK + 1);
+
+	fill_vectors(i & 1);
+	rc = compare_fft(features);
+	if (rc == 0)
+	    rc = compare_spectrum(features, len, blk_cnt);
+	if (rc != 0) {
+	    PJ_LOG(3,(THIS_FILE, "   %s mismatch: len=%u blocks=%u",
+		      pjmedia_dsp_get_impl_name(), len, blk_cnt));
+	    return rc;
+	}
+    }
+
+    return 0;
+}
+
+/* Time the kernels with the shapes used by the codecs */
+static pj_uint32_t time_kernels(unsigned features)
+{
+    enum { LOOP = 2000 };
+    pj_int32_t xc[MAX_LAG];
+    float out_f[MAX_LEN];
+    pj_timestamp t0, t1;
+    unsigned i;
+
+    pjmedia_dsp_set_features(features);
+    pj_get_timestamp(&t0);
+    for (i=0; i<LOOP; ++i) {
+	/* celt coarse pitch search at 48kHz */
+	pjmedia_dsp_xcorr16(x16, y16, xc, 240, 180);
+	/* codec2 LPC analysis and NLP decimation filter */
+	pjmedia_dsp_autocorr_f(xf, out_f, 320, 11);
+	pjmedia_dsp_fir_f(xf, hf, out_f, 80, 48);
+	/* WebRTC AECM and noise suppression at 16kHz */
+	pj_memcpy(fft_out, fft_in, 256 * sizeof(fft_in[0]));
+	pjmedia_dsp_cfft16(fft_out, 7, PJ_TRUE);
+	pjmedia_dsp_cifft16(fft_out, 7, PJ_TRUE);
+	/* speex echo canceller, 20ms frames at 8kHz and 200ms tail */
+	pjmedia_dsp_spectrum_mac_f(xs, ys, out_f, 320, 10);
+    }
+    pj_get_timestamp(&t1);
+
+    return pj_elapsed_usec(&t0, &t1);
+}
+
+int dsp_test(void)
+{
+    unsigned features, mask;
+    pj_uint32_t ref_usec;
+    int rc;
+
+    features = pjmedia_dsp_get_features();
+    PJ_LOG(3,(THIS_FILE, "  features=0x%x, using %s", features,
+	      pjmedia_dsp_get_impl_name()));
+
+    /* Every subset of the available features that selects a SIMD
+     * implementation
+     */
+    for (mask=1; mask<=features; ++mask) {
+	if ((mask & features) != mask)
+	    continue;
+
+	pjmedia_dsp_set_features(mask);
+	if (pj_ansi_strcmp(pjmedia_dsp_get_impl_name(), "c") == 0)
+	    continue;
+	PJ_LOG(3,(THIS_FILE, "  comparing %s with scalar",
+		  pjmedia_dsp_get_impl_name()));
+	rc = compare_impl(mask);
+	if (rc != 0) {
+	    pjmedia_dsp_set_features(features);
+	    return rc;
+	}
+    }
+
+    fill_vectors(PJ_FALSE);
+    ref_usec = time_kernels(0);
+    PJ_LOG(3,(THIS_FILE, "  c: %u usec", ref_usec));
+    for (mask=1; mask<=features; ++mask) {
+	pj_uint32_t usec;
+
+	if ((mask & features) != mask)
+	    continue;
+	pjmedia_dsp_set_features(mask);
+	if (pj_ansi_strcmp(pjmedia_dsp_get_impl_name(), "c") == 0)
+	    continue;
+	usec = time_kernels(mask);
+	PJ_LOG(3,(THIS_FILE, "  %s: %u usec (%u.%02ux)",
+		  pjmedia_dsp_get_impl_name(), usec,
+		  ref_usec / (usec ? usec : 1),
+		  (ref_usec * 100 / (usec ? usec : 1)) % 100));
+    }
+
+    pjmedia_dsp_set_features(features);
+    return 0;
+}
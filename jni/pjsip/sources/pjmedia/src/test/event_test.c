@@ -0,0 +1,368 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2011-2011 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE   "event_test.c"
+
+#define THREAD_CNT	8
+#define EVENT_CNT	2000
+#define TEST_EVENT	PJMEDIA_FOURCC('T', 'E', 'S', 'T')
+
+/* One publisher per thread. The subscriber of each publisher checks that
+ * its events arrive complete and in order.
+ */
+typedef struct publisher
+{
+    pjmedia_event_mgr	*mgr;
+    pj_bool_t		 post;
+    unsigned		 received;
+    unsigned		 out_of_order;
+    unsigned		 foreign;
+} publisher;
+
+static publisher pubs[THREAD_CNT];
+static pj_atomic_t *any_cnt;
+
+/* Used to hold the worker thread in a callback */
+static pj_sem_t *held, *gate;
+static pj_bool_t hold_worker;
+static unsigned coalesced_cnt;
+static pj_uint64_t coalesced_last;
+
+/* Keyframe events in the order of delivery */
+static pjmedia_event_type keyframe_types[8];
+static pj_uint64_t keyframe_ts[8];
+static unsigned keyframe_cnt;
+
+
+static pj_status_t pub_cb(pjmedia_event *event, void *user_data)
+{
+    publisher *pub = (publisher*)user_data;
+
+    if (event->type != TEST_EVENT)
+	return PJ_SUCCESS;
+    if (event->epub != pub) {
+	++pub->foreign;
+	return PJ_SUCCESS;
+    }
+    if (event->timestamp.u64 != pub->received)
+	++pub->out_of_order;
+    ++pub->received;
+
+    return PJ_SUCCESS;
+}
+
+static pj_status_t any_cb(pjmedia_event *event, void *user_data)
+{
+    PJ_UNUSED_ARG(user_data);
+
+    if (event->type == TEST_EVENT)
+	pj_atomic_inc(any_cnt);
+
+    return PJ_SUCCESS;
+}
+
+static pj_status_t gate_cb(pjmedia_event *event, void *user_data)
+{
+    PJ_UNUSED_ARG(user_data);
+
+    if (hold_worker) {
+	hold_worker = PJ_FALSE;
+	pj_sem_post(held);
+	pj_sem_wait(gate);
+    }
+    if (event->type == PJMEDIA_EVENT_KEYFRAME_MISSING) {
+	++coalesced_cnt;
+	coalesced_last = event->timestamp.u64;
+    }
+
+    return PJ_SUCCESS;
+}
+
+static pj_status_t keyframe_cb(pjmedia_event *event, void *user_data)
+{
+    PJ_UNUSED_ARG(user_data);
+
+    if ((event->type == PJMEDIA_EVENT_KEYFRAME_FOUND ||
+	 event->type == PJMEDIA_EVENT_KEYFRAME_MISSING) &&
+	keyframe_cnt < PJ_ARRAY_SIZE(keyframe_types))
+    {
+	keyframe_types[keyframe_cnt] = event->type;
+	keyframe_ts[keyframe_cnt] = event->timestamp.u64;
+	++keyframe_cnt;
+    }
+
+    return PJ_SUCCESS;
+}
+
+static int publish_thread(void *arg)
+{
+    publisher *pub = (publisher*)arg;
+    unsigned i;
+
+    for (i=0; i<EVENT_CNT; ++i) {
+	pjmedia_event event;
+	pj_timestamp ts;
+
+	ts.u64 = i;
+	pjmedia_event_init(&event, TEST_EVENT, &ts, pub);
+	pjmedia_event_publish(pub->mgr, pub, &event, pub->post ?
+			      PJMEDIA_EVENT_PUBLISH_POST_EVENT : 0);
+    }
+
+    return 0;
+}
+
+/* Wait until the worker thread has delivered everything */
+static void wait_for_events(unsigned expected)
+{
+    unsigned i;
+
+    for (i=0; i<500 && (unsigned)pj_atomic_get(any_cnt) < expected; ++i)
+	pj_thread_sleep(10);
+}
+
+/* Publish from many threads at once, and make sure that every subscriber
+ * gets every event of its publisher, in order, and nothing else.
+ */
+static int stress_test(pj_pool_t *pool, pjmedia_event_mgr *mgr,
+		       pj_bool_t post)
+{
+    pj_thread_t *threads[THREAD_CNT];
+    unsigned i;
+    int rc = 0;
+
+    PJ_LOG(3,(THIS_FILE, "  %s from %d threads", (post? "posting":
+	      "publishing"), THREAD_CNT));
+
+    pj_atomic_set(any_cnt, 0);
+    pjmedia_event_subscribe(mgr, &any_cb, NULL, NULL);
+    for (i=0; i<THREAD_CNT; ++i) {
+	pj_bzero(&pubs[i], sizeof(pubs[i]));
+	pubs[i].mgr = mgr;
+	pubs[i].post = post;
+	pjmedia_event_subscribe(mgr, &pub_cb, &pubs[i], &pubs[i]);
+    }
+
+    for (i=0; i<THREAD_CNT; ++i) {
+	if (pj_thread_create(pool, "evpub", &publish_thread, &pubs[i],
+			     0, 0, &threads[i]) != PJ_SUCCESS)
+	{
+	    return -10;
+	}
+    }
+    for (i=0; i<THREAD_CNT; ++i) {
+	pj_thread_join(threads[i]);
+	pj_thread_destroy(threads[i]);
+    }
+
+    wait_for_events(THREAD_CNT * EVENT_CNT);
+
+    for (i=0; i<THREAD_CNT; ++i) {
+	if (pubs[i].received != EVENT_CNT || pubs[i].out_of_order ||
+	    pubs[i].foreign)
+	{
+	    PJ_LOG(3,(THIS_FILE, "  publisher %d: received=%u, "
+		      "out of order=%u, foreign=%u", i, pubs[i].received,
+		      pubs[i].out_of_order, pubs[i].foreign));
+	    rc = -20;
+	}
+    }
+    if (pj_atomic_get(any_cnt) != THREAD_CNT * EVENT_CNT) {
+	PJ_LOG(3,(THIS_FILE, "  subscriber of all publishers got %d events",
+		  pj_atomic_get(any_cnt)));
+	rc = -30;
+    }
+
+    pjmedia_event_unsubscribe(mgr, &pub_cb, NULL, NULL);
+    pjmedia_event_unsubscribe(mgr, &any_cb, NULL, NULL);
+
+    return rc;
+}
+
+/* Overflow the event queue while the worker thread is busy, and check
+ * that nothing is lost and that idempotent events get coalesced.
+ */
+static int congestion_test(pjmedia_event_mgr *mgr)
+{
+    pjmedia_event event;
+    publisher *pub = &pubs[0];
+    unsigned i, cnt = PJMEDIA_EVENT_MGR_MAX_QUEUED_EVENTS + 3;
+    int rc = 0;
+
+    PJ_LOG(3,(THIS_FILE, "  posting to a congested queue"));
+
+    pj_atomic_set(any_cnt, 0);
+    pj_bzero(pub, sizeof(*pub));
+    pub->mgr = mgr;
+    pjmedia_event_subscribe(mgr, &gate_cb, NULL, pub);
+    pjmedia_event_subscribe(mgr, &pub_cb, pub, pub);
+    pjmedia_event_subscribe(mgr, &any_cb, NULL, NULL);
+
+    /* The first event keeps the worker thread in the callback */
+    hold_worker = PJ_TRUE;
+    pjmedia_event_init(&event, PJMEDIA_EVENT_WND_CLOSED, NULL, pub);
+    pjmedia_event_publish(mgr, pub, &event,
+			  PJMEDIA_EVENT_PUBLISH_POST_EVENT);
+    pj_sem_wait(held);
+
+    for (i=0; i<EVENT_CNT; ++i) {
+	pj_timestamp ts;
+
+	ts.u64 = i;
+	pjmedia_event_init(&event, PJMEDIA_EVENT_KEYFRAME_MISSING, &ts,
+			   pub);
+	pjmedia_event_publish(mgr, pub, &event,
+			      PJMEDIA_EVENT_PUBLISH_POST_EVENT);
+    }
+
+    /* More than the queue may hold */
+    for (i=0; i<cnt; ++i) {
+	pj_timestamp ts;
+
+	ts.u64 = i;
+	pjmedia_event_init(&event, TEST_EVENT, &ts, pub);
+	pjmedia_event_publish(mgr, pub, &event,
+			      PJMEDIA_EVENT_PUBLISH_POST_EVENT);
+    }
+
+    pj_sem_post(gate);
+    wait_for_events(cnt);
+
+    if (pub->received != cnt || pub->out_of_order) {
+	PJ_LOG(3,(THIS_FILE, "  received=%u of %u, out of order=%u",
+		  pub->received, cnt, pub->out_of_order));
+	rc = -40;
+    }
+    if (coalesced_cnt != 1 || coalesced_last != EVENT_CNT - 1) {
+	PJ_LOG(3,(THIS_FILE, "  %u keyframe requests delivered, last=%u",
+		  coalesced_cnt, (unsigned)coalesced_last));
+	rc = -50;
+    }
+
+    pjmedia_event_unsubscribe(mgr, &gate_cb, NULL, NULL);
+    pjmedia_event_unsubscribe(mgr, &pub_cb, NULL, NULL);
+    pjmedia_event_unsubscribe(mgr, &any_cb, NULL, NULL);
+
+    return rc;
+}
+
+/* Post idempotent events of different types from one publisher while the
+ * worker thread is busy, coalescing must not reorder them.
+ */
+static int interleave_test(pjmedia_event_mgr *mgr)
+{
+    static const pjmedia_event_type types[] = {
+	PJMEDIA_EVENT_KEYFRAME_MISSING,
+	PJMEDIA_EVENT_KEYFRAME_FOUND,
+	PJMEDIA_EVENT_KEYFRAME_MISSING
+    };
+    pjmedia_event event;
+    publisher *pub = &pubs[0];
+    pj_timestamp ts;
+    unsigned i;
+    int rc = 0;
+
+    PJ_LOG(3,(THIS_FILE, "  posting interleaved event types"));
+
+    pj_atomic_set(any_cnt, 0);
+    keyframe_cnt = 0;
+    pjmedia_event_subscribe(mgr, &gate_cb, NULL, pub);
+    pjmedia_event_subscribe(mgr, &keyframe_cb, NULL, pub);
+    pjmedia_event_subscribe(mgr, &any_cb, NULL, NULL);
+
+    /* The first event keeps the worker thread in the callback */
+    hold_worker = PJ_TRUE;
+    pjmedia_event_init(&event, PJMEDIA_EVENT_WND_CLOSED, NULL, pub);
+    pjmedia_event_publish(mgr, pub, &event,
+			  PJMEDIA_EVENT_PUBLISH_POST_EVENT);
+    pj_sem_wait(held);
+
+    for (i=0; i<PJ_ARRAY_SIZE(types); ++i) {
+	ts.u64 = i;
+	pjmedia_event_init(&event, types[i], &ts, pub);
+	pjmedia_event_publish(mgr, pub, &event,
+			      PJMEDIA_EVENT_PUBLISH_POST_EVENT);
+    }
+
+    /* Marks the end of the test */
+    ts.u64 = 0;
+    pjmedia_event_init(&event, TEST_EVENT, &ts, pub);
+    pjmedia_event_publish(mgr, pub, &event, PJMEDIA_EVENT_PUBLISH_POST_EVENT);
+
+    pj_sem_post(gate);
+    wait_for_events(1);
+
+    /* The last state of the publisher is "keyframe missing" */
+    if (keyframe_cnt != 2 ||
+	keyframe_types[0] != PJMEDIA_EVENT_KEYFRAME_FOUND ||
+	keyframe_types[1] != PJMEDIA_EVENT_KEYFRAME_MISSING ||
+	keyframe_ts[1] != 2)
+    {
+	PJ_LOG(3,(THIS_FILE, "  %u keyframe events delivered, last=%u",
+		  keyframe_cnt, keyframe_cnt ?
+		  (unsigned)keyframe_ts[keyframe_cnt-1] : 0));
+	rc = -60;
+    }
+
+    pjmedia_event_unsubscribe(mgr, &gate_cb, NULL, NULL);
+    pjmedia_event_unsubscribe(mgr, &keyframe_cb, NULL, NULL);
+    pjmedia_event_unsubscribe(mgr, &any_cb, NULL, NULL);
+
+    return rc;
+}
+
+int event_test(void)
+{
+    pj_pool_t *pool;
+    pjmedia_event_mgr *mgr;
+    pj_status_t status;
+    int rc;
+
+    pool = pj_pool_create(mem, "evtest", 1000, 1000, NULL);
+
+    status = pj_atomic_create(pool, 0, &any_cnt);
+    if (status == PJ_SUCCESS)
+	status = pj_sem_create(pool, "evheld", 0, 1, &held);
+    if (status == PJ_SUCCESS)
+	status = pj_sem_create(pool, "evgate", 0, 1, &gate);
+    if (status == PJ_SUCCESS)
+	status = pjmedia_event_mgr_create(pool, 0, &mgr);
+    if (status != PJ_SUCCESS) {
+	app_perror(status, "Error creating event manager");
+	pj_pool_release(pool);
+	return -1;
+    }
+
+    rc = stress_test(pool, mgr, PJ_TRUE);
+    if (rc == 0)
+	rc = stress_test(pool, mgr, PJ_FALSE);
+    if (rc == 0)
+	rc = congestion_test(mgr);
+    if (rc == 0)
+	rc = interleave_test(mgr);
+
+    pjmedia_event_mgr_destroy(mgr);
+    pj_sem_destroy(held);
+    pj_sem_destroy(gate);
+    pj_atomic_destroy(any_cnt);
+    pj_pool_release(pool);
+
+    return rc;
+}
@@ -363,6 +363,7 @@ static const pj_int16_t ref_signal[] = {
 #define THIS_FILE	    "mips_test.c"
 #define DURATION	    5000
 #define PTIME		    20	/* MUST be 20! */
+#define MAX_PTIME	    60	/* Largest ptime of the codec tests */
 #define MEGA		    1000000
 #define GIGA		    1000000000
 
@@ -672,14 +673,22 @@ static pjmedia_port* large_filt_resample( pj_pool_t *pool,
 /***************************************************************************/
 /* Codec encode/decode */
 
+/* Codec test flags */
+enum codec_flag
+{
+    CODEC_PTIME60   = 1,    /* 60ms worth of frames per packet	*/
+    CODEC_NO_BATCH  = 2	    /* Decode the frames one by one	*/
+};
+
 struct codec_port
 {
     pjmedia_port     base;
     pjmedia_endpt   *endpt;
     pjmedia_codec   *codec;
     pj_status_t	   (*codec_deinit)();
-    pj_uint8_t	     pkt[640];
-    pj_uint16_t	     pcm[32000 * PTIME / 1000];
+    pj_bool_t	     batch;
+    pj_uint8_t	     pkt[32000 * 2 * MAX_PTIME / 1000];
+    pj_uint16_t	     pcm[32000 * MAX_PTIME / 1000];
 };
 
 
@@ -697,7 +706,7 @@ static pj_status_t codec_put_frame(struct pjmedia_port *this_port,
     pj_assert(status == PJ_SUCCESS);
 
     if (out_frame.size != 0) {
-	pjmedia_frame parsed_frm[2], pcm_frm;
+	pjmedia_frame parsed_frm[MAX_PTIME / 10], pcm_frm;
 	unsigned frame_cnt = PJ_ARRAY_SIZE(parsed_frm);
 	unsigned i;
 
@@ -706,12 +715,24 @@ static pj_status_t codec_put_frame(struct pjmedia_port *this_port,
 				     &frame_cnt, parsed_frm);
 	pj_assert(status == PJ_SUCCESS);
 	
-	for (i=0; i<frame_cnt; ++i) {
+	if (cp->batch) {
 	    pcm_frm.buf = cp->pcm;
-	    pcm_frm.size = sizeof(cp->pkt);
-	    status = pjmedia_codec_decode(cp->codec, &parsed_frm[i], 
-					  sizeof(cp->pcm), &pcm_frm);
+	    pcm_frm.size = sizeof(cp->pcm);
+	    status = pjmedia_codec_decode_frames(cp->codec, frame_cnt,
+						 parsed_frm, sizeof(cp->pcm),
+						 &pcm_frm);
 	    pj_assert(status == PJ_SUCCESS);
+	} else {
+	    pj_uint8_t *pcm = (pj_uint8_t*)cp->pcm;
+
+	    for (i=0; i<frame_cnt; ++i) {
+		pcm_frm.buf = pcm;
+		pcm_frm.size = sizeof(cp->pcm) - (pcm - (pj_uint8_t*)cp->pcm);
+		status = pjmedia_codec_decode(cp->codec, &parsed_frm[i], 
+					      pcm_frm.size, &pcm_frm);
+		pj_assert(status == PJ_SUCCESS);
+		pcm += pcm_frm.size;
+	    }
 	}
     }
 
@@ -747,11 +768,14 @@ static pjmedia_port* codec_encode_decode( pj_pool_t *pool,
     pjmedia_codec_param codec_param;
     pj_status_t status;
 
-    PJ_UNUSED_ARG(flags);
     PJ_UNUSED_ARG(te);
 
+    if (flags & CODEC_PTIME60)
+	samples_per_frame = clock_rate * MAX_PTIME / 1000;
+
     codec_id = pj_str((char*)codec);
     cp = PJ_POOL_ZALLOC_T(pool, struct codec_port);
+    cp->batch = (flags & CODEC_NO_BATCH) == 0;
     pjmedia_port_info_init(&cp->base.info, &codec_id, 0x123456, clock_rate,
 			   channel_count, 16, samples_per_frame);
     cp->base.put_frame = &codec_put_frame;
@@ -782,6 +806,10 @@ static pjmedia_port* codec_encode_decode( pj_pool_t *pool,
     if (status != PJ_SUCCESS)
 	return NULL;
 
+    if (flags & CODEC_PTIME60)
+	codec_param.setting.frm_per_pkt = (pj_uint8_t)
+					  (MAX_PTIME / codec_param.info.frm_ptime);
+
     status = pjmedia_codec_init(cp->codec, pool);
     if (status != PJ_SUCCESS)
 	return NULL;
@@ -807,6 +835,31 @@ static pjmedia_port* g711_encode_decode(  pj_pool_t *pool,
 			       clock_rate, channel_count,
 			       samples_per_frame, flags, te);
 }
+
+/* G.711 with 60ms ptime, frames decoded in one call */
+static pjmedia_port* g711_p60_encode_decode(pj_pool_t *pool,
+					    unsigned clock_rate,
+					    unsigned channel_count,
+					    unsigned samples_per_frame,
+					    unsigned flags,
+					    struct test_entry *te)
+{
+    return g711_encode_decode(pool, clock_rate, channel_count,
+			      samples_per_frame, flags | CODEC_PTIME60, te);
+}
+
+/* G.711 with 60ms ptime, frames decoded one by one */
+static pjmedia_port* g711_p60_single_encode_decode(pj_pool_t *pool,
+						   unsigned clock_rate,
+						   unsigned channel_count,
+						   unsigned samples_per_frame,
+						   unsigned flags,
+						   struct test_entry *te)
+{
+    return g711_encode_decode(pool, clock_rate, channel_count,
+			      samples_per_frame,
+			      flags | CODEC_PTIME60 | CODEC_NO_BATCH, te);
+}
 #endif
 
 /* GSM benchmark */
@@ -892,6 +945,31 @@ static pjmedia_port* g722_encode_decode(pj_pool_t *pool,
 			       clock_rate, channel_count,
 			       samples_per_frame, flags, te);
 }
+
+/* G.722 with 60ms ptime, frames decoded in one call */
+static pjmedia_port* g722_p60_encode_decode(pj_pool_t *pool,
+					    unsigned clock_rate,
+					    unsigned channel_count,
+					    unsigned samples_per_frame,
+					    unsigned flags,
+					    struct test_entry *te)
+{
+    return g722_encode_decode(pool, clock_rate, channel_count,
+			      samples_per_frame, flags | CODEC_PTIME60, te);
+}
+
+/* G.722 with 60ms ptime, frames decoded one by one */
+static pjmedia_port* g722_p60_single_encode_decode(pj_pool_t *pool,
+						   unsigned clock_rate,
+						   unsigned channel_count,
+						   unsigned samples_per_frame,
+						   unsigned flags,
+						   struct test_entry *te)
+{
+    return g722_encode_decode(pool, clock_rate, channel_count,
+			      samples_per_frame,
+			      flags | CODEC_PTIME60 | CODEC_NO_BATCH, te);
+}
 #endif
 
 #if PJMEDIA_HAS_G7221_CODEC
@@ -976,6 +1054,31 @@ static pjmedia_port* l16_16_encode_decode(pj_pool_t *pool,
 			       clock_rate, channel_count,
 			       samples_per_frame, flags, te);
 }
+
+/* L16/16000/1 with 60ms ptime, frames decoded in one call */
+static pjmedia_port* l16_16_p60_encode_decode(pj_pool_t *pool,
+					      unsigned clock_rate,
+					      unsigned channel_count,
+					      unsigned samples_per_frame,
+					      unsigned flags,
+					      struct test_entry *te)
+{
+    return l16_16_encode_decode(pool, clock_rate, channel_count,
+				samples_per_frame, flags | CODEC_PTIME60, te);
+}
+
+/* L16/16000/1 with 60ms ptime, frames decoded one by one */
+static pjmedia_port* l16_16_p60_single_encode_decode(pj_pool_t *pool,
+						     unsigned clock_rate,
+						     unsigned channel_count,
+						     unsigned samples_per_frame,
+						     unsigned flags,
+						     struct test_entry *te)
+{
+    return l16_16_encode_decode(pool, clock_rate, channel_count,
+				samples_per_frame,
+				flags | CODEC_PTIME60 | CODEC_NO_BATCH, te);
+}
 #endif
 
 /***************************************************************************/
@@ -1586,6 +1689,49 @@ static pjmedia_port* es_create_800(pj_pool_t *pool,
 		     flags, te);
 }
 
+#if defined(PJMEDIA_HAS_WEBRTC_AEC) && PJMEDIA_HAS_WEBRTC_AEC!=0
+/* WebRTC AEC alone */
+static pjmedia_port* webrtc_ec_create(pj_pool_t *pool,
+				      unsigned clock_rate,
+				      unsigned channel_count,
+				      unsigned samples_per_frame,
+				      unsigned flags,
+				      struct test_entry *te)
+{
+    flags = PJMEDIA_ECHO_WEBRTC;
+    return ec_create(100, pool, clock_rate, channel_count, samples_per_frame,
+		     flags, te);
+}
+
+/* WebRTC AEC and noise suppressor */
+static pjmedia_port* webrtc_ec_ns_create(pj_pool_t *pool,
+					 unsigned clock_rate,
+					 unsigned channel_count,
+					 unsigned samples_per_frame,
+					 unsigned flags,
+					 struct test_entry *te)
+{
+    flags = PJMEDIA_ECHO_WEBRTC | PJMEDIA_ECHO_USE_NOISE_SUPPRESSOR;
+    return ec_create(100, pool, clock_rate, channel_count, samples_per_frame,
+		     flags, te);
+}
+
+/* WebRTC high-pass filter, AEC, noise suppressor and gain controller */
+static pjmedia_port* webrtc_ec_apm_create(pj_pool_t *pool,
+					  unsigned clock_rate,
+					  unsigned channel_count,
+					  unsigned samples_per_frame,
+					  unsigned flags,
+					  struct test_entry *te)
+{
+    flags = PJMEDIA_ECHO_WEBRTC | PJMEDIA_ECHO_USE_HIGH_PASS_FILTER |
+	    PJMEDIA_ECHO_USE_NOISE_SUPPRESSOR |
+	    PJMEDIA_ECHO_USE_GAIN_CONTROLLER;
+    return ec_create(100, pool, clock_rate, channel_count, samples_per_frame,
+		     flags, te);
+}
+#endif
+
 
 /***************************************************************************/
 /* Tone generator, single frequency */
@@ -1701,7 +1847,8 @@ static pjmedia_port* create_stream( pj_pool_t *pool,
     pjmedia_stream_info si;
     pj_status_t status;
 
-    PJ_UNUSED_ARG(flags);
+    if (flags & CODEC_PTIME60)
+	samples_per_frame = clock_rate * MAX_PTIME / 1000;
 
     codec_id = pj_str((char*)codec);
     sp = PJ_POOL_ZALLOC_T(pool, struct stream_port);
@@ -1733,6 +1880,10 @@ static pjmedia_port* create_stream( pj_pool_t *pool,
     if (status != PJ_SUCCESS)
 	return NULL;
 
+    if (flags & CODEC_PTIME60)
+	codec_param.setting.frm_per_pkt = (pj_uint8_t)
+					  (MAX_PTIME / codec_param.info.frm_ptime);
+
     /* Create stream info */
     pj_bzero(&si, sizeof(si));
     si.type = PJMEDIA_TYPE_AUDIO;
@@ -1741,7 +1892,7 @@ static pjmedia_port* create_stream( pj_pool_t *pool,
     pj_sockaddr_in_init(&si.rem_addr.ipv4, NULL, 4000);
     pj_sockaddr_in_init(&si.rem_rtcp.ipv4, NULL, 4001);
     pj_memcpy(&si.fmt, ci[0], sizeof(pjmedia_codec_info));
-    si.param = NULL;
+    si.param = &codec_param;
     si.tx_pt = ci[0]->pt;
     si.tx_event_pt = 101;
     si.rx_event_pt = 101;
@@ -1822,6 +1973,18 @@ static pjmedia_port* create_stream_pcmu( pj_pool_t *pool,
 			 samples_per_frame, flags, te);
 }
 
+/* G.711 stream with 60ms ptime, no SRTP */
+static pjmedia_port* create_stream_pcmu_p60( pj_pool_t *pool,
+					     unsigned clock_rate,
+					     unsigned channel_count,
+					     unsigned samples_per_frame,
+					     unsigned flags,
+					     struct test_entry *te)
+{
+    return create_stream_pcmu(pool, clock_rate, channel_count,
+			      samples_per_frame, flags | CODEC_PTIME60, te);
+}
+
 /* G.711 stream, SRTP 32bit key no auth */
 static pjmedia_port* create_stream_pcmu_srtp32_no_auth( pj_pool_t *pool,
 							unsigned clock_rate,
@@ -2026,6 +2189,187 @@ static pjmedia_port* create_stream_amr( pj_pool_t *pool,
 }
 #endif	/* PJMEDIA_HAS_OPENCORE_AMRNB_CODEC */ 
 
+/***************************************************************************/
+/* Conference of streams, most of them silent. Each participant is a G.711
+ * stream over a loop transport that transmits its own source port, so what
+ * the stream receives is what the participant "says". The bridge mixes the
+ * audio received by all streams.
+ */
+#if PJMEDIA_HAS_G711_CODEC
+enum { CONF_STREAM_MAX = 16 };
+
+struct conf_stream_port
+{
+    pjmedia_endpt	*endpt;
+    pjmedia_conf	*conf;
+    unsigned		 cnt;
+    unsigned		 slot[CONF_STREAM_MAX];
+    pjmedia_stream	*stream[CONF_STREAM_MAX];
+    pjmedia_transport	*transport[CONF_STREAM_MAX];
+};
+
+static void conf_stream_custom_deinit(struct test_entry *te)
+{
+    struct conf_stream_port *cs = (struct conf_stream_port*) te->pdata[0];
+    unsigned i;
+
+    for (i=0; i<cs->cnt; ++i) {
+	pjmedia_conf_remove_port(cs->conf, cs->slot[i]);
+	pjmedia_stream_destroy(cs->stream[i]);
+	pjmedia_transport_close(cs->transport[i]);
+    }
+    pjmedia_codec_g711_deinit();
+    pjmedia_endpt_destroy(cs->endpt);
+}
+
+static pjmedia_port* init_conf_stream_port(unsigned nb_participant,
+					   unsigned nb_talker,
+					   unsigned audio_level_skip,
+					   pj_pool_t *pool,
+					   unsigned clock_rate,
+					   unsigned channel_count,
+					   unsigned samples_per_frame,
+					   unsigned flags,
+					   struct test_entry *te)
+{
+    struct conf_stream_port *cs;
+    pj_str_t codec_id = pj_str("pcmu");
+    const pjmedia_codec_info *ci[1];
+    pjmedia_codec_param *codec_param;
+    unsigned i, count;
+    pj_status_t status;
+
+    PJ_UNUSED_ARG(flags);
+    PJ_ASSERT_RETURN(nb_participant <= CONF_STREAM_MAX, NULL);
+
+    cs = PJ_POOL_ZALLOC_T(pool, struct conf_stream_port);
+    te->pdata[0] = cs;
+    te->custom_deinit = &conf_stream_custom_deinit;
+
+    status = pjmedia_endpt_create(mem, NULL, 0, &cs->endpt);
+    if (status != PJ_SUCCESS)
+	return NULL;
+
+    status = pjmedia_codec_g711_init(cs->endpt);
+    if (status != PJ_SUCCESS)
+	return NULL;
+
+    count = 1;
+    status = pjmedia_codec_mgr_find_codecs_by_id(
+				    pjmedia_endpt_get_codec_mgr(cs->endpt),
+				    &codec_id, &count, ci, NULL);
+    if (status != PJ_SUCCESS)
+	return NULL;
+
+    /* Disable VAD, otherwise silent participants would not send anything
+     * and there would be nothing to skip.
+     */
+    codec_param = PJ_POOL_ZALLOC_T(pool, pjmedia_codec_param);
+    status = pjmedia_codec_mgr_get_default_param(
+				    pjmedia_endpt_get_codec_mgr(cs->endpt),
+				    ci[0], codec_param);
+    if (status != PJ_SUCCESS)
+	return NULL;
+    codec_param->setting.vad = 0;
+
+    status = pjmedia_conf_create(pool, 2+nb_participant*2, clock_rate, 
+				 channel_count, samples_per_frame, 16, 
+				 PJMEDIA_CONF_NO_DEVICE, &cs->conf);
+    if (status != PJ_SUCCESS)
+	return NULL;
+
+    for (i=0; i<nb_participant; ++i) {
+	pjmedia_stream_info si;
+	pjmedia_port *gen_port, *port;
+	unsigned gen_slot;
+
+	pj_bzero(&si, sizeof(si));
+	si.type = PJMEDIA_TYPE_AUDIO;
+	si.proto = PJMEDIA_TP_PROTO_RTP_AVP;
+	si.dir = PJMEDIA_DIR_ENCODING_DECODING;
+	pj_sockaddr_in_init(&si.rem_addr.ipv4, NULL, 4000);
+	pj_sockaddr_in_init(&si.rem_rtcp.ipv4, NULL, 4001);
+	pj_memcpy(&si.fmt, ci[0], sizeof(pjmedia_codec_info));
+	si.param = codec_param;
+	si.tx_pt = ci[0]->pt;
+	si.tx_event_pt = 101;
+	si.rx_event_pt = 101;
+	si.ssrc = pj_rand();
+	si.jb_init = si.jb_min_pre = si.jb_max_pre = si.jb_max = -1;
+	si.tx_audio_level_id = si.rx_audio_level_id = 1;
+	si.audio_level_skip = audio_level_skip;
+
+	status = pjmedia_transport_loop_create(cs->endpt, &cs->transport[i]);
+	if (status != PJ_SUCCESS)
+	    return NULL;
+
+	status = pjmedia_stream_create(cs->endpt, pool, &si,
+				       cs->transport[i], NULL,
+				       &cs->stream[i]);
+	if (status != PJ_SUCCESS)
+	    return NULL;
+	++cs->cnt;
+
+	status = pjmedia_stream_start(cs->stream[i]);
+	if (status != PJ_SUCCESS)
+	    return NULL;
+
+	pjmedia_stream_get_port(cs->stream[i], &port);
+	status = pjmedia_conf_add_port(cs->conf, pool, port, NULL,
+				       &cs->slot[i]);
+	if (status != PJ_SUCCESS)
+	    return NULL;
+
+	/* Only the first few participants talk */
+	gen_port = create_gen_port(pool, clock_rate, channel_count,
+				   samples_per_frame,
+				   (i < nb_talker) ? 100 : 0);
+	if (!gen_port)
+	    return NULL;
+
+	status = pjmedia_conf_add_port(cs->conf, pool, gen_port, NULL,
+				       &gen_slot);
+	if (status != PJ_SUCCESS)
+	    return NULL;
+
+	/* Source -> stream, and stream -> "sound device" */
+	status = pjmedia_conf_connect_port(cs->conf, gen_slot, cs->slot[i], 0);
+	if (status != PJ_SUCCESS)
+	    return NULL;
+
+	status = pjmedia_conf_connect_port(cs->conf, cs->slot[i], 0, 0);
+	if (status != PJ_SUCCESS)
+	    return NULL;
+    }
+
+    return pjmedia_conf_get_master_port(cs->conf);
+}
+
+/* 16 participants, 2 talking, all decoded and mixed */
+static pjmedia_port* conf16_stream_test_init(pj_pool_t *pool,
+					     unsigned clock_rate,
+					     unsigned channel_count,
+					     unsigned samples_per_frame,
+					     unsigned flags,
+					     struct test_entry *te)
+{
+    return init_conf_stream_port(16, 2, 0, pool, clock_rate, channel_count,
+				 samples_per_frame, flags, te);
+}
+
+/* 16 participants, 2 talking, silent ones skipped using audio level */
+static pjmedia_port* conf16_stream_skip_test_init(pj_pool_t *pool,
+						  unsigned clock_rate,
+						  unsigned channel_count,
+						  unsigned samples_per_frame,
+						  unsigned flags,
+						  struct test_entry *te)
+{
+    return init_conf_stream_port(16, 2, 50, pool, clock_rate, channel_count,
+				 samples_per_frame, flags, te);
+}
+#endif	/* PJMEDIA_HAS_G711_CODEC */
+
 /***************************************************************************/
 /* Delay buffer */
 enum {DELAY_BUF_MAX_DELAY = 80};
@@ -2255,7 +2599,7 @@ static pj_timestamp run_entry(unsigned clock_rate, struct test_entry *e)
     pjmedia_port *port;
     pj_timestamp t0, t1;
     unsigned j, samples_per_frame;
-    pj_int16_t pcm[32000 * PTIME / 1000];
+    pj_int16_t pcm[32000 * MAX_PTIME / 1000];
     pjmedia_port *gen_port;
     pj_status_t status;
 
@@ -2394,13 +2738,22 @@ int mips_test(void)
 	{ "echo suppressor 512ms tail len", OP_GET_PUT, K8|K16, &es_create_512},
 	{ "echo suppressor 600ms tail len", OP_GET_PUT, K8|K16, &es_create_600},
 	{ "echo suppressor 800ms tail len", OP_GET_PUT, K8|K16, &es_create_800},
+#if defined(PJMEDIA_HAS_WEBRTC_AEC) && PJMEDIA_HAS_WEBRTC_AEC!=0
+	{ "WebRTC AEC", OP_GET_PUT, K8|K16, &webrtc_ec_create},
+	{ "WebRTC AEC+NS", OP_GET_PUT, K8|K16, &webrtc_ec_ns_create},
+	{ "WebRTC HPF+AEC+NS+AGC", OP_GET_PUT, K8|K16, &webrtc_ec_apm_create},
+#endif
 	{ "tone generator with single freq", OP_GET, K8|K16, &create_tonegen1},
 	{ "tone generator with dual freq", OP_GET, K8|K16, &create_tonegen2},
 #if PJMEDIA_HAS_G711_CODEC
 	{ "codec encode/decode - G.711", OP_PUT, K8, &g711_encode_decode},
+	{ "codec encode/decode - G.711 60ms", OP_PUT, K8, &g711_p60_encode_decode},
+	{ "codec encode/decode - G.711 60ms 1by1", OP_PUT, K8, &g711_p60_single_encode_decode},
 #endif
 #if PJMEDIA_HAS_G722_CODEC
 	{ "codec encode/decode - G.722", OP_PUT, K16, &g722_encode_decode},
+	{ "codec encode/decode - G.722 60ms", OP_PUT, K16, &g722_p60_encode_decode},
+	{ "codec encode/decode - G.722 60ms 1by1", OP_PUT, K16, &g722_p60_single_encode_decode},
 #endif
 #if PJMEDIA_HAS_GSM_CODEC
 	{ "codec encode/decode - GSM", OP_PUT, K8, &gsm_encode_decode},
@@ -2422,9 +2775,12 @@ int mips_test(void)
 #if PJMEDIA_HAS_L16_CODEC
 	{ "codec encode/decode - L16/8000/1", OP_PUT, K8, &l16_8_encode_decode},
 	{ "codec encode/decode - L16/16000/1", OP_PUT, K16, &l16_16_encode_decode},
+	{ "codec encode/decode - L16/16000/1 60ms", OP_PUT, K16, &l16_16_p60_encode_decode},
+	{ "codec encode/decode - L16/16000/1 60ms 1by1", OP_PUT, K16, &l16_16_p60_single_encode_decode},
 #endif
 #if PJMEDIA_HAS_G711_CODEC
 	{ "stream TX/RX - G.711", OP_PUT_GET, K8, &create_stream_pcmu},
+	{ "stream TX/RX - G.711 60ms", OP_PUT_GET, K8, &create_stream_pcmu_p60},
 	{ "stream TX/RX - G.711 SRTP 32bit", OP_PUT_GET, K8, &create_stream_pcmu_srtp32_no_auth},
 	{ "stream TX/RX - G.711 SRTP 32bit +auth", OP_PUT_GET, K8, &create_stream_pcmu_srtp32_with_auth},
 	{ "stream TX/RX - G.711 SRTP 80bit", OP_PUT_GET, K8, &create_stream_pcmu_srtp80_no_auth},
@@ -2446,6 +2802,10 @@ int mips_test(void)
 #endif
 #if PJMEDIA_HAS_OPENCORE_AMRNB_CODEC
 	{ "stream TX/RX - AMR-NB", OP_PUT_GET, K8, &create_stream_amr},
+#endif
+#if PJMEDIA_HAS_G711_CODEC
+	{ "conf 16 streams, 2 talking", OP_GET_PUT, K8, &conf16_stream_test_init},
+	{ "conf 16 streams, 2 talking, level skip", OP_GET_PUT, K8, &conf16_stream_skip_test_init},
 #endif
     };
 
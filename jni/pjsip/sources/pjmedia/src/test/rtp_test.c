@@ -17,9 +17,11 @@
  * along with this program; if not, write to the Free Software
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
  */
-#include <pjmedia/rtp.h>
+#include "test.h"
 #include <stdio.h>
 
+#define THIS_FILE   "rtp_test.c"
+
 int rtp_test()
 {
     pjmedia_rtp_session rtp;
@@ -39,3 +41,221 @@ int rtp_test()
     fclose(fhnd);
     return 0;
 }
+
+
+/* Build an RTP packet with a header extension of the specified profile,
+ * and return the packet length.
+ */
+static int build_ext_pkt(pj_uint8_t *pkt, pj_uint16_t profile,
+			 const pj_uint8_t *ext, unsigned ext_words)
+{
+    pjmedia_rtp_hdr *hdr = (pjmedia_rtp_hdr*)pkt;
+    pjmedia_rtp_ext_hdr *ext_hdr;
+
+    pj_bzero(pkt, sizeof(pjmedia_rtp_hdr));
+    hdr->v = 2;
+    hdr->x = 1;
+    hdr->pt = 0;
+    hdr->ssrc = pj_htonl(0x12345678);
+
+    ext_hdr = (pjmedia_rtp_ext_hdr*)(hdr + 1);
+    ext_hdr->profile_data = pj_htons(profile);
+    ext_hdr->length = pj_htons((pj_uint16_t)ext_words);
+    pj_memcpy(ext_hdr + 1, ext, ext_words * 4);
+
+    /* Four bytes of payload */
+    pj_memset(pkt + sizeof(pjmedia_rtp_hdr) + 4 + ext_words * 4, 0xFF, 4);
+
+    return sizeof(pjmedia_rtp_hdr) + 4 + ext_words * 4 + 4;
+}
+
+static int check_elem(const pjmedia_rtp_ext_elem *elem, unsigned id,
+		      unsigned len, const pj_uint8_t *data)
+{
+    return elem->id == id && elem->len == len &&
+	   pj_memcmp(elem->data, data, len) == 0;
+}
+
+/* Decode RFC 5285 header extensions, including malformed ones */
+int rtp_ext_test(void)
+{
+    static const pj_uint8_t level[1] = { 0x85 };
+    static const pj_uint8_t abc[3] = { 'a', 'b', 'c' };
+    pj_uint8_t pkt[128];
+    pjmedia_rtp_ext_elem elem[PJMEDIA_RTP_EXT_MAX_ELEM];
+    unsigned cnt, len;
+    int pkt_len;
+    pj_status_t status;
+
+    PJ_LOG(3,(THIS_FILE, "  RTP header extension test"));
+
+    /* One-byte format: ID 1 with one byte, padding, ID 2 with three */
+    {
+	static const pj_uint8_t ext[] = {
+	    0x10, 0x85, 0x00, 0x00,
+	    0x22, 'a', 'b', 'c'
+	};
+
+	pkt_len = build_ext_pkt(pkt, PJMEDIA_RTP_EXT_ONE_BYTE, ext, 2);
+	cnt = PJ_ARRAY_SIZE(elem);
+	status = pjmedia_rtp_decode_ext(pkt, pkt_len, elem, &cnt);
+	if (status != PJ_SUCCESS || cnt != 2 ||
+	    !check_elem(&elem[0], 1, 1, level) ||
+	    !check_elem(&elem[1], 2, 3, abc))
+	{
+	    return -10;
+	}
+    }
+
+    /* Two-byte format with appbits, an empty element and padding */
+    {
+	static const pj_uint8_t ext[] = {
+	    0x14, 0x00, 0x00, 0x03,
+	    0x03, 'a', 'b', 'c',
+	};
+
+	pkt_len = build_ext_pkt(pkt, PJMEDIA_RTP_EXT_TWO_BYTE | 0x5,
+				ext, 2);
+	cnt = PJ_ARRAY_SIZE(elem);
+	status = pjmedia_rtp_decode_ext(pkt, pkt_len, elem, &cnt);
+	if (status != PJ_SUCCESS || cnt != 2 ||
+	    !check_elem(&elem[0], 20, 0, NULL) ||
+	    !check_elem(&elem[1], 3, 3, abc))
+	{
+	    return -20;
+	}
+    }
+
+    /* ID 15 stops the processing of the one-byte format */
+    {
+	static const pj_uint8_t ext[] = {
+	    0x10, 0x85, 0xF0, 0x00,
+	    0x22, 'a', 'b', 'c'
+	};
+
+	pkt_len = build_ext_pkt(pkt, PJMEDIA_RTP_EXT_ONE_BYTE, ext, 2);
+	cnt = PJ_ARRAY_SIZE(elem);
+	status = pjmedia_rtp_decode_ext(pkt, pkt_len, elem, &cnt);
+	if (status != PJ_SUCCESS || cnt != 1 ||
+	    !check_elem(&elem[0], 1, 1, level))
+	{
+	    return -30;
+	}
+    }
+
+    /* Element longer than the extension */
+    {
+	static const pj_uint8_t ext[] = { 0x13, 'a', 'b', 'c' };
+
+	pkt_len = build_ext_pkt(pkt, PJMEDIA_RTP_EXT_ONE_BYTE, ext, 1);
+	cnt = PJ_ARRAY_SIZE(elem);
+	if (pjmedia_rtp_decode_ext(pkt, pkt_len, elem, &cnt) !=
+	    PJMEDIA_RTP_EINLEN)
+	{
+	    return -40;
+	}
+
+	pkt_len = build_ext_pkt(pkt, PJMEDIA_RTP_EXT_TWO_BYTE, ext, 1);
+	cnt = PJ_ARRAY_SIZE(elem);
+	if (pjmedia_rtp_decode_ext(pkt, pkt_len, elem, &cnt) !=
+	    PJMEDIA_RTP_EINLEN)
+	{
+	    return -41;
+	}
+    }
+
+    /* Extension longer than the packet, and packet truncated in the
+     * extension header.
+     */
+    {
+	static const pj_uint8_t ext[] = { 0x10, 0x85, 0x00, 0x00 };
+	pjmedia_rtp_session ses;
+	const pjmedia_rtp_hdr *hdr;
+	const void *payload;
+	unsigned payload_len;
+
+	pkt_len = build_ext_pkt(pkt, PJMEDIA_RTP_EXT_ONE_BYTE, ext, 1);
+	((pjmedia_rtp_ext_hdr*)(pkt + sizeof(pjmedia_rtp_hdr)))->length =
+	    pj_htons(8);
+	cnt = PJ_ARRAY_SIZE(elem);
+	if (pjmedia_rtp_decode_ext(pkt, pkt_len, elem, &cnt) !=
+	    PJMEDIA_RTP_EINLEN)
+	{
+	    return -50;
+	}
+
+	pkt_len = sizeof(pjmedia_rtp_hdr) + 2;
+	cnt = PJ_ARRAY_SIZE(elem);
+	if (pjmedia_rtp_decode_ext(pkt, pkt_len, elem, &cnt) !=
+	    PJMEDIA_RTP_EINLEN)
+	{
+	    return -51;
+	}
+
+	pjmedia_rtp_session_init(&ses, 0, 0x12345678);
+	if (pjmedia_rtp_decode_rtp(&ses, pkt, pkt_len, &hdr, &payload,
+				   &payload_len) != PJMEDIA_RTP_EINLEN)
+	{
+	    return -52;
+	}
+    }
+
+    /* Other profiles are not decoded */
+    {
+	static const pj_uint8_t ext[] = { 0x10, 0x85, 0x00, 0x00 };
+
+	pkt_len = build_ext_pkt(pkt, 0xABAC, ext, 1);
+	cnt = PJ_ARRAY_SIZE(elem);
+	if (pjmedia_rtp_decode_ext(pkt, pkt_len, elem, &cnt) != PJ_ENOTSUP)
+	    return -60;
+    }
+
+    /* Encoding uses the one-byte format and pads to 32 bits, and
+     * switches to the two-byte format for ID 15 and above.
+     */
+    {
+	pjmedia_rtp_ext_elem in[2];
+	pj_uint8_t *ext = pkt + sizeof(pjmedia_rtp_hdr);
+
+	in[0].id = 1; in[0].len = 1; in[0].data = level;
+	in[1].id = 2; in[1].len = 3; in[1].data = abc;
+
+	build_ext_pkt(pkt, 0, NULL, 0);
+	status = pjmedia_rtp_encode_ext(in, 2, ext, 64, &len);
+	if (status != PJ_SUCCESS || len != 12 || ext[0] != 0xBE ||
+	    ext[1] != 0xDE || ext[11] != 0)
+	{
+	    return -70;
+	}
+
+	cnt = PJ_ARRAY_SIZE(elem);
+	status = pjmedia_rtp_decode_ext(pkt, sizeof(pjmedia_rtp_hdr) + len,
+					elem, &cnt);
+	if (status != PJ_SUCCESS || cnt != 2 ||
+	    !check_elem(&elem[0], 1, 1, level) ||
+	    !check_elem(&elem[1], 2, 3, abc))
+	{
+	    return -71;
+	}
+
+	in[1].id = 15;
+	status = pjmedia_rtp_encode_ext(in, 2, ext, 64, &len);
+	if (status != PJ_SUCCESS || ext[0] != 0x10 || len != 12)
+	    return -72;
+
+	cnt = PJ_ARRAY_SIZE(elem);
+	status = pjmedia_rtp_decode_ext(pkt, sizeof(pjmedia_rtp_hdr) + len,
+					elem, &cnt);
+	if (status != PJ_SUCCESS || cnt != 2 ||
+	    !check_elem(&elem[0], 1, 1, level) ||
+	    !check_elem(&elem[1], 15, 3, abc))
+	{
+	    return -73;
+	}
+
+	if (pjmedia_rtp_encode_ext(in, 2, ext, 8, &len) != PJ_ETOOSMALL)
+	    return -74;
+    }
+
+    return 0;
+}
@@ -1241,6 +1241,53 @@ static struct test
 	}
     },
 
+    /* test 17: */
+    {
+	/*********************************************************************
+	 * RTP header extensions (RFC 5285): the answer uses the offerer's
+	 * ID, and extensions that were not offered are dropped.
+	 */
+
+	"RTP header extension ID and offered extensions",
+	1,
+	{
+	  {
+	    REMOTE_OFFER,
+	    /* Bob offers: */
+	    "v=0\r\n"
+	    "o=bob 2808844564 2808844564 IN IP4 host.biloxi.example.com\r\n"
+	    "s=bob\r\n"
+	    "c=IN IP4 host.biloxi.example.com\r\n"
+	    "t=0 0\r\n"
+	    "m=audio 4000 RTP/AVP 0\r\n"
+	    "a=rtpmap:0 PCMU/8000\r\n"
+	    "a=extmap:3 urn:ietf:params:rtp-hdrext:ssrc-audio-level\r\n"
+	    "",
+	    /* Alice's initial SDP: */
+	    "v=0\r\n"
+	    "o=alice 2890844526 2890844526 IN IP4 host.atlanta.example.com\r\n"
+	    "s=alice\r\n"
+	    "c=IN IP4 host.atlanta.example.com\r\n"
+	    "t=0 0\r\n"
+	    "m=audio 3000 RTP/AVP 0\r\n"
+	    "a=rtpmap:0 PCMU/8000\r\n"
+	    "a=extmap:1 urn:ietf:params:rtp-hdrext:ssrc-audio-level vad=on\r\n"
+	    "a=extmap:2 urn:ietf:params:rtp-hdrext:toffset\r\n"
+	    "",
+	    /* Alice's answer: */
+	    "v=0\r\n"
+	    "o=alice 2890844526 2890844527 IN IP4 host.atlanta.example.com\r\n"
+	    "s=alice\r\n"
+	    "c=IN IP4 host.atlanta.example.com\r\n"
+	    "t=0 0\r\n"
+	    "m=audio 3000 RTP/AVP 0\r\n"
+	    "a=rtpmap:0 PCMU/8000\r\n"
+	    "a=extmap:3 urn:ietf:params:rtp-hdrext:ssrc-audio-level vad=on\r\n"
+	    "",
+	  }
+	}
+    },
+
 };
 
 static const char *find_diff(const char *s1, const char *s2,
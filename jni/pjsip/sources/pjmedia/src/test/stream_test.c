@@ -0,0 +1,323 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2011-2011 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE   "stream_test.c"
+
+#define CYCLE_CNT	1000
+#define CLOCK_RATE	8000
+#define SPF		(CLOCK_RATE * 20 / 1000)
+#define PKT_OVERHEAD	(20 + 8 + sizeof(pjmedia_rtp_hdr))  /* IP/UDP/RTP */
+#define PHASE_SEC	60
+
+/* The stream receives its own packets through the loopback transport */
+static pjmedia_endpt *endpt;
+static pjmedia_transport *tp;
+static pj_int16_t pcm[SPF];
+
+
+static int init_stream_info(pj_pool_t *pool, const char *codec,
+			    pjmedia_stream_info *si)
+{
+    pjmedia_codec_mgr *mgr = pjmedia_endpt_get_codec_mgr(endpt);
+    const pjmedia_codec_info *ci[1];
+    pjmedia_codec_param *param;
+    pj_str_t codec_id = pj_str((char*)codec);
+    unsigned count = 1;
+
+    if (pjmedia_codec_mgr_find_codecs_by_id(mgr, &codec_id, &count,
+					    ci, NULL) != PJ_SUCCESS)
+    {
+	return -10;
+    }
+
+    param = PJ_POOL_ZALLOC_T(pool, pjmedia_codec_param);
+    if (pjmedia_codec_mgr_get_default_param(mgr, ci[0], param) !=PJ_SUCCESS)
+	return -11;
+
+    pj_bzero(si, sizeof(*si));
+    si->type = PJMEDIA_TYPE_AUDIO;
+    si->proto = PJMEDIA_TP_PROTO_RTP_AVP;
+    si->dir = PJMEDIA_DIR_ENCODING_DECODING;
+    pj_sockaddr_in_init(&si->rem_addr.ipv4, NULL, 4000);
+    pj_sockaddr_in_init(&si->rem_rtcp.ipv4, NULL, 4001);
+    pj_memcpy(&si->fmt, ci[0], sizeof(pjmedia_codec_info));
+    si->param = param;
+    si->tx_pt = si->rx_pt = ci[0]->pt;
+    si->tx_event_pt = si->rx_event_pt = 101;
+    si->ssrc = pj_rand();
+    si->jb_init = si->jb_min_pre = si->jb_max_pre = si->jb_max = -1;
+
+    return 0;
+}
+
+/* Send frames and return the number of frames waiting in the jitter
+ * buffer afterwards.
+ */
+static unsigned send_frames(pjmedia_stream *stream, unsigned cnt)
+{
+    pjmedia_port *port;
+    pjmedia_jb_state jb_state;
+    unsigned i;
+
+    pjmedia_stream_get_port(stream, &port);
+    for (i=0; i<cnt; ++i) {
+	pjmedia_frame frame;
+
+	pj_bzero(&frame, sizeof(frame));
+	frame.type = PJMEDIA_FRAME_TYPE_AUDIO;
+	frame.buf = pcm;
+	frame.size = sizeof(pcm);
+	pjmedia_port_put_frame(port, &frame);
+    }
+
+    pjmedia_stream_get_stat_jbuf(stream, &jb_state);
+    return jb_state.size;
+}
+
+static unsigned get_tx_pkt(pjmedia_stream *stream)
+{
+    pjmedia_rtcp_stat stat;
+
+    pjmedia_stream_get_stat(stream, &stat);
+    return stat.tx.pkt;
+}
+
+/* Put the stream on hold and back many times, and make sure that the
+ * stream doesn't allocate memory for it.
+ */
+static int hold_test(pj_pool_t *pool, pjmedia_stream *stream,
+		     pjmedia_stream_info *si)
+{
+    pj_timestamp t0, t1;
+    pj_size_t used;
+    unsigned i;
+
+    PJ_LOG(3,(THIS_FILE, "  %d hold/unhold cycles", CYCLE_CNT));
+
+    used = pj_pool_get_used_size(pool);
+    pj_get_timestamp(&t0);
+
+    for (i=0; i<CYCLE_CNT; ++i) {
+	si->dir = PJMEDIA_DIR_ENCODING;
+	if (pjmedia_stream_update(stream, si) != PJ_SUCCESS)
+	    return -20;
+	if (i % 100 == 0 && send_frames(stream, 4) != 0)
+	    return -21;
+
+	si->dir = PJMEDIA_DIR_ENCODING_DECODING;
+	if (pjmedia_stream_update(stream, si) != PJ_SUCCESS)
+	    return -22;
+	if (i % 100 == 0 && send_frames(stream, 4) == 0)
+	    return -23;
+    }
+
+    pj_get_timestamp(&t1);
+    PJ_LOG(3,(THIS_FILE, "  ..%u nsec per update",
+	      pj_elapsed_nanosec(&t0, &t1) / (CYCLE_CNT * 2)));
+
+    if (pj_pool_get_used_size(pool) != used) {
+	PJ_LOG(3,(THIS_FILE, "  ..stream allocated %d bytes",
+		  (int)(pj_pool_get_used_size(pool) - used)));
+	return -24;
+    }
+
+    return 0;
+}
+
+/* Switch to another codec and packetization while keeping the port */
+static int codec_test(pj_pool_t *pool, pjmedia_stream *stream)
+{
+    pjmedia_stream_info si;
+    pjmedia_port *port, *new_port;
+    unsigned tx_pkt;
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "  switching to PCMA with 40 ms packets"));
+
+    rc = init_stream_info(pool, "pcma", &si);
+    if (rc != 0)
+	return rc;
+    si.param->setting.frm_per_pkt = (pj_uint8_t)
+				    (40 / si.param->info.frm_ptime);
+
+    pjmedia_stream_get_port(stream, &port);
+    if (pjmedia_stream_update(stream, &si) != PJ_SUCCESS)
+	return -30;
+    pjmedia_stream_get_port(stream, &new_port);
+    if (new_port != port || PJMEDIA_PIA_SPF(&port->info) != SPF)
+	return -31;
+
+    /* Two port frames go in one packet */
+    tx_pkt = get_tx_pkt(stream);
+    if (send_frames(stream, 10) == 0)
+	return -32;
+    if (get_tx_pkt(stream) - tx_pkt != 5)
+	return -33;
+
+    /* The port frame must stay a multiple of the codec frame */
+    si.fmt.clock_rate = 16000;
+    if (pjmedia_stream_update(stream, &si) != PJ_ENOTSUP)
+	return -34;
+
+    /* .. and the stream must be left working */
+    tx_pkt = get_tx_pkt(stream);
+    send_frames(stream, 10);
+    if (get_tx_pkt(stream) - tx_pkt != 5)
+	return -35;
+
+    return 0;
+}
+
+/* Send a phase of audio and report the packet rate and the bandwidth
+ * on the wire in its last twenty seconds.
+ */
+static unsigned send_phase(pjmedia_stream *stream, const char *title)
+{
+    pjmedia_rtcp_stat stat;
+    unsigned pkt, bytes, pps;
+
+    send_frames(stream, (PHASE_SEC - 20) * 50);
+
+    pjmedia_stream_get_stat(stream, &stat);
+    pkt = stat.tx.pkt;
+    bytes = stat.tx.bytes;
+
+    send_frames(stream, 20 * 50);
+
+    pjmedia_stream_get_stat(stream, &stat);
+    pkt = stat.tx.pkt - pkt;
+    bytes = stat.tx.bytes - bytes + pkt * PKT_OVERHEAD;
+    pps = pkt / 20;
+
+    PJ_LOG(3,(THIS_FILE, "  ..%s: %u packets/s, %u bps on the wire",
+	      title, pps, bytes * 8 / 20));
+
+    return pps;
+}
+
+/* Make the packets longer when remote reports loss, and shorter again
+ * after the loss is over.
+ */
+static int adaptive_test(pj_pool_t *pool, pj_pool_t *strm_pool)
+{
+    pjmedia_stream_info si;
+    pjmedia_stream *stream;
+    unsigned pps;
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "  adaptive packetization, 20 to 60 ms"));
+
+    rc = init_stream_info(pool, "pcmu", &si);
+    if (rc != 0)
+	return rc;
+    si.adaptive_max_ptime = 60;
+
+    if (pjmedia_stream_create(endpt, strm_pool, &si, tp, NULL,
+			      &stream) != PJ_SUCCESS)
+    {
+	return -40;
+    }
+    pjmedia_stream_start(stream);
+
+    /* RTCP reports come every five seconds of audio */
+    pps = send_phase(stream, "no loss");
+    if (pps != 50)
+	rc = -41;
+
+    pjmedia_transport_simulate_lost(tp, PJMEDIA_DIR_ENCODING, 10);
+    pps = send_phase(stream, "10% loss");
+    if (rc == 0 && pps > 17)
+	rc = -42;
+
+    pjmedia_transport_simulate_lost(tp, PJMEDIA_DIR_ENCODING, 0);
+    pps = send_phase(stream, "loss is over");
+    if (rc == 0 && pps != 50)
+	rc = -43;
+
+    pjmedia_stream_destroy(stream);
+    return rc;
+}
+
+int stream_test(void)
+{
+    pj_pool_t *pool, *strm_pool;
+    pjmedia_stream_info si;
+    pjmedia_stream *stream = NULL;
+    pj_status_t status;
+    unsigned i;
+    int rc;
+
+    /* Loud enough not to be suppressed by VAD */
+    for (i=0; i<SPF; ++i)
+	pcm[i] = (pj_int16_t)((i & 8) ? 8000 : -8000);
+
+    endpt = NULL;
+    tp = NULL;
+    pool = pj_pool_create(mem, "strmtest", 1000, 1000, NULL);
+    strm_pool = pj_pool_create(mem, "strm", 4000, 4000, NULL);
+
+    status = pjmedia_endpt_create(mem, NULL, 0, &endpt);
+    if (status == PJ_SUCCESS)
+	status = pjmedia_codec_g711_init(endpt);
+    if (status == PJ_SUCCESS)
+	status = pjmedia_transport_loop_create(endpt, &tp);
+    if (status != PJ_SUCCESS) {
+	app_perror(status, "Error initializing stream test");
+	rc = -1;
+	goto on_return;
+    }
+
+    rc = init_stream_info(pool, "pcmu", &si);
+    if (rc != 0)
+	goto on_return;
+
+    status = pjmedia_stream_create(endpt, strm_pool, &si, tp, NULL, &stream);
+    if (status == PJ_SUCCESS)
+	status = pjmedia_stream_start(stream);
+    if (status != PJ_SUCCESS) {
+	app_perror(status, "Error creating stream");
+	rc = -2;
+	goto on_return;
+    }
+
+    rc = hold_test(strm_pool, stream, &si);
+    if (rc == 0)
+	rc = codec_test(pool, stream);
+
+    /* The loop transport can only serve one stream at a time */
+    pjmedia_stream_destroy(stream);
+    stream = NULL;
+    if (rc == 0)
+	rc = adaptive_test(pool, strm_pool);
+
+on_return:
+    if (stream)
+	pjmedia_stream_destroy(stream);
+    if (tp)
+	pjmedia_transport_close(tp);
+    if (endpt) {
+	pjmedia_codec_g711_deinit();
+	pjmedia_endpt_destroy(endpt);
+    }
+    pj_pool_release(strm_pool);
+    pj_pool_release(pool);
+
+    return rc;
+}
@@ -88,15 +88,43 @@ int test_main(void)
     DO_TEST(vid_codec_test());
 #endif
 
+#if HAS_EVENT_TEST
+    DO_TEST(event_test());
+#endif
+
+#if HAS_STREAM_TEST
+    DO_TEST(stream_test());
+#endif
+
+#if HAS_RTP_EXT_TEST
+    DO_TEST(rtp_ext_test());
+#endif
+
 #if HAS_SDP_NEG_TEST
     DO_TEST(sdp_neg_test());
 #endif
+
+#if HAS_TRANSPORT_MUX_TEST
+    DO_TEST(transport_mux_test());
+#endif
     //DO_TEST(sdp_test (&caching_pool.factory));
     //DO_TEST(rtp_test(&caching_pool.factory));
     //DO_TEST(session_test (&caching_pool.factory));
+#if HAS_DSP_TEST
+    DO_TEST(dsp_test());
+#endif
 #if HAS_JBUF_TEST
     DO_TEST(jbuf_main());
 #endif
+#if HAS_DELAYBUF_TEST
+    DO_TEST(delaybuf_test());
+#endif
+#if HAS_WORKER_TEST
+    DO_TEST(worker_test());
+#endif
+#if HAS_CLOCK_TEST
+    DO_TEST(clock_test());
+#endif
 #if HAS_MIPS_TEST
     DO_TEST(mips_test());
 #endif
@@ -30,9 +30,18 @@
 #define HAS_JBUF_TEST		1
 #define HAS_MIPS_TEST		1
 #define HAS_CODEC_VECTOR_TEST	1
+#define HAS_DSP_TEST		1
+#define HAS_EVENT_TEST		1
+#define HAS_STREAM_TEST		1
+#define HAS_DELAYBUF_TEST	1
+#define HAS_WORKER_TEST		1
+#define HAS_CLOCK_TEST		1
+#define HAS_RTP_EXT_TEST	1
+#define HAS_TRANSPORT_MUX_TEST	1
 
 int session_test(void);
 int rtp_test(void);
+int rtp_ext_test(void);
 int sdp_test(void);
 int jbuf_main(void);
 int sdp_neg_test(void);
@@ -41,6 +50,13 @@ int codec_test_vectors(void);
 int vid_codec_test(void);
 int vid_dev_test(void);
 int vid_port_test(void);
+int dsp_test(void);
+int event_test(void);
+int stream_test(void);
+int delaybuf_test(void);
+int worker_test(void);
+int clock_test(void);
+int transport_mux_test(void);
 
 extern pj_pool_factory *mem;
 void app_perror(pj_status_t status, const char *title);
@@ -0,0 +1,1169 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2011-2011 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+#include <pjnath.h>
+#include <stdio.h>
+
+#define THIS_FILE   "transport_mux_test.c"
+
+#define PKT_CNT		4	/* RTP and RTCP packets sent each way	    */
+#define RX_TIMEOUT	2000	/* msec					    */
+#define ICE_TIMEOUT	5000	/* msec					    */
+
+/* Two transports on the loopback interface negotiate RTCP multiplexing
+ * (RFC 5761) with each other, then exchange RTP and RTCP. Each case
+ * checks how many sockets every side ends up holding and, for ICE, how
+ * many connectivity checks were needed. The BUNDLE cases run two media
+ * lines over one transport and check that every packet reaches the
+ * stream of its media line.
+ */
+struct peer
+{
+    const char		*name;
+    pjmedia_transport	*tp;
+    pj_bool_t		 mux;
+    pjmedia_sdp_session	*sdp;
+
+    pj_bool_t		 ice_init_done;
+    pj_bool_t		 ice_nego_done;
+    pj_status_t		 ice_status;
+
+    unsigned		 rtp_cnt;
+    unsigned		 rtcp_cnt;
+};
+
+static pjmedia_endpt *endpt;
+static pj_timer_heap_t *timer_heap;
+
+
+static void poll_events(pj_bool_t yield)
+{
+    pj_time_val timeout = { 0, 10 };
+
+    if (timer_heap)
+	pj_timer_heap_poll(timer_heap, NULL);
+    pj_ioqueue_poll(pjmedia_endpt_get_ioqueue(endpt), &timeout);
+
+    if (yield)
+	pj_thread_sleep(0);
+}
+
+static void on_rx_rtp(void *user_data, void *pkt, pj_ssize_t size)
+{
+    struct peer *peer = (struct peer*) user_data;
+    const pj_uint8_t *p = (const pj_uint8_t*) pkt;
+
+    /* RTCP must never be delivered as RTP */
+    if (size > 1 && p[1] < 192)
+	++peer->rtp_cnt;
+}
+
+static void on_rx_rtcp(void *user_data, void *pkt, pj_ssize_t size)
+{
+    struct peer *peer = (struct peer*) user_data;
+    const pj_uint8_t *p = (const pj_uint8_t*) pkt;
+
+    if (size >= 8 && p[1] == 201)
+	++peer->rtcp_cnt;
+}
+
+static void on_ice_complete(pjmedia_transport *tp,
+			    pj_ice_strans_op op,
+			    pj_status_t status)
+{
+    struct peer *peer = (struct peer*) tp->user_data;
+
+    if (op == PJ_ICE_STRANS_OP_INIT)
+	peer->ice_init_done = PJ_TRUE;
+    else if (op == PJ_ICE_STRANS_OP_NEGOTIATION)
+	peer->ice_nego_done = PJ_TRUE;
+    peer->ice_status = status;
+}
+
+/* Wait until *flag is set by a callback */
+static pj_status_t wait_flag(const pj_bool_t *flag, unsigned msec)
+{
+    pj_time_val start, now;
+
+    pj_gettimeofday(&start);
+    for (;;) {
+	if (*flag)
+	    return PJ_SUCCESS;
+
+	pj_gettimeofday(&now);
+	PJ_TIME_VAL_SUB(now, start);
+	if (PJ_TIME_VAL_MSEC(now) > (long)msec)
+	    return PJ_ETIMEDOUT;
+
+	poll_events(PJ_TRUE);
+    }
+}
+
+static pj_status_t create_sock(pj_sock_t *sock, pj_sockaddr *addr)
+{
+    pj_str_t localhost = pj_str("127.0.0.1");
+    int addr_len = sizeof(*addr);
+    pj_status_t status;
+
+    status = pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, sock);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    pj_sockaddr_init(pj_AF_INET(), addr, &localhost, 0);
+    status = pj_sock_bind(*sock, addr, pj_sockaddr_get_len(addr));
+    if (status == PJ_SUCCESS)
+	status = pj_sock_getsockname(*sock, addr, &addr_len);
+    if (status != PJ_SUCCESS) {
+	pj_sock_close(*sock);
+	*sock = PJ_INVALID_SOCKET;
+    }
+
+    return status;
+}
+
+static pj_status_t create_udp(struct peer *peer)
+{
+    pjmedia_sock_info si;
+    pj_status_t status;
+
+    pj_bzero(&si, sizeof(si));
+    si.rtp_sock = si.rtcp_sock = PJ_INVALID_SOCKET;
+
+    status = create_sock(&si.rtp_sock, &si.rtp_addr_name);
+    if (status == PJ_SUCCESS)
+	status = create_sock(&si.rtcp_sock, &si.rtcp_addr_name);
+    if (status == PJ_SUCCESS)
+	status = pjmedia_transport_udp_attach(endpt, peer->name, &si, 0,
+					      &peer->tp);
+    if (status != PJ_SUCCESS) {
+	if (si.rtp_sock != PJ_INVALID_SOCKET)
+	    pj_sock_close(si.rtp_sock);
+	if (si.rtcp_sock != PJ_INVALID_SOCKET)
+	    pj_sock_close(si.rtcp_sock);
+    }
+
+    return status;
+}
+
+static pj_status_t create_ice(struct peer *peer, unsigned comp_cnt)
+{
+    pj_ice_strans_cfg ice_cfg;
+    pjmedia_ice_cb ice_cb;
+    pj_str_t localhost = pj_str("127.0.0.1");
+    pj_status_t status;
+
+    /* A single loopback host candidate per component, so the checklist
+     * has exactly one pair for each component both sides share.
+     */
+    pj_ice_strans_cfg_default(&ice_cfg);
+    pj_stun_config_init(&ice_cfg.stun_cfg, mem, 0,
+			pjmedia_endpt_get_ioqueue(endpt), timer_heap);
+    ice_cfg.af = pj_AF_INET();
+    ice_cfg.stun.loop_addr = PJ_TRUE;
+    pj_sockaddr_init(pj_AF_INET(), &ice_cfg.stun.cfg.bound_addr,
+		     &localhost, 0);
+
+    pj_bzero(&ice_cb, sizeof(ice_cb));
+    ice_cb.on_ice_complete = &on_ice_complete;
+
+    status = pjmedia_ice_create3(endpt, peer->name, comp_cnt, &ice_cfg,
+				 &ice_cb, 0, peer, &peer->tp);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    status = wait_flag(&peer->ice_init_done, ICE_TIMEOUT);
+    if (status == PJ_SUCCESS)
+	status = peer->ice_status;
+
+    return status;
+}
+
+/* Local SDP with the transport's default address, as pjsua would build */
+static pjmedia_sdp_session *create_sdp(pj_pool_t *pool, struct peer *peer)
+{
+    pjmedia_transport_info tpinfo;
+    pjmedia_sdp_session *sdp;
+    char addr[PJ_INET6_ADDRSTRLEN];
+    char *buf;
+    int len;
+
+    pjmedia_transport_info_init(&tpinfo);
+    if (pjmedia_transport_get_info(peer->tp, &tpinfo) != PJ_SUCCESS)
+	return NULL;
+
+    pj_sockaddr_print(&tpinfo.sock_info.rtp_addr_name, addr, sizeof(addr),
+		      0);
+
+    buf = (char*) pj_pool_alloc(pool, 256);
+    len = pj_ansi_snprintf(buf, 256,
+			   "v=0\r\n"
+			   "o=%s 1 1 IN IP4 %s\r\n"
+			   "s=-\r\n"
+			   "c=IN IP4 %s\r\n"
+			   "t=0 0\r\n"
+			   "m=audio %d RTP/AVP 0\r\n",
+			   peer->name, addr, addr,
+			   pj_sockaddr_get_port(&tpinfo.sock_info.
+							rtp_addr_name));
+
+    /* pjmedia_endpt_create_sdp() always advertises the RTCP port */
+    if (tpinfo.sock_info.rtcp_addr_name.addr.sa_family) {
+	len += pj_ansi_snprintf(buf+len, 256-len, "a=rtcp:%d\r\n",
+				pj_sockaddr_get_port(&tpinfo.sock_info.
+							    rtcp_addr_name));
+    }
+
+    if (pjmedia_sdp_parse(pool, buf, len, &sdp) != PJ_SUCCESS)
+	return NULL;
+
+    return sdp;
+}
+
+/* Remote RTP and RTCP addresses from the SDP */
+static void get_rem_addr(const pjmedia_sdp_session *sdp,
+			 pj_sockaddr *rtp, pj_sockaddr *rtcp)
+{
+    const pjmedia_sdp_media *m = sdp->media[0];
+    const pjmedia_sdp_conn *c = m->conn ? m->conn : sdp->conn;
+    const pjmedia_sdp_attr *a;
+    pjmedia_sdp_rtcp_attr rtcp_attr;
+
+    pj_sockaddr_init(pj_AF_INET(), rtp, &c->addr, m->desc.port);
+    pj_sockaddr_cp(rtcp, rtp);
+    pj_sockaddr_set_port(rtcp, (pj_uint16_t)(m->desc.port + 1));
+
+    a = pjmedia_sdp_media_find_attr2(m, "rtcp", NULL);
+    if (a && pjmedia_sdp_attr_get_rtcp(a, &rtcp_attr) == PJ_SUCCESS) {
+	if (rtcp_attr.addr.slen)
+	    pj_sockaddr_init(pj_AF_INET(), rtcp, &rtcp_attr.addr,
+			     (pj_uint16_t)rtcp_attr.port);
+	else
+	    pj_sockaddr_set_port(rtcp, (pj_uint16_t)rtcp_attr.port);
+    }
+}
+
+static pj_bool_t has_mux(const pjmedia_sdp_session *sdp)
+{
+    return pjmedia_sdp_media_find_attr2(sdp->media[0], "rtcp-mux",
+					NULL) != NULL;
+}
+
+/* Number of ICE candidates of a component in the SDP */
+static unsigned cand_cnt(const pjmedia_sdp_session *sdp, unsigned comp_id)
+{
+    const pjmedia_sdp_media *m = sdp->media[0];
+    unsigned i, cnt = 0;
+
+    for (i=0; i<m->attr_count; ++i) {
+	char value[80];
+	unsigned id;
+
+	if (pj_strcmp2(&m->attr[i]->name, "candidate") != 0 ||
+	    m->attr[i]->value.slen >= (pj_ssize_t)sizeof(value))
+	{
+	    continue;
+	}
+
+	/* "foundation component-id transport priority address port ..." */
+	pj_memcpy(value, m->attr[i]->value.ptr, m->attr[i]->value.slen);
+	value[m->attr[i]->value.slen] = '\0';
+	if (sscanf(value, "%*s %u", &id) == 1 && id == comp_id)
+	    ++cnt;
+    }
+
+    return cnt;
+}
+
+/* Run one offer/answer between the two peers. The answerer is started
+ * first, like pjsua does when it sends the answer.
+ */
+static int negotiate(pj_pool_t *pool, struct peer *offerer,
+		     struct peer *answerer)
+{
+    pj_status_t status;
+
+    status = pjmedia_transport_media_create(offerer->tp, pool,
+					    offerer->mux ?
+						PJMEDIA_TPMED_RTCP_MUX : 0,
+					    NULL, 0);
+    if (status != PJ_SUCCESS)
+	return -100;
+
+    offerer->sdp = create_sdp(pool, offerer);
+    if (!offerer->sdp)
+	return -105;
+
+    status = pjmedia_transport_encode_sdp(offerer->tp, pool, offerer->sdp,
+					  NULL, 0);
+    if (status != PJ_SUCCESS)
+	return -110;
+
+    status = pjmedia_transport_media_create(answerer->tp, pool,
+					    answerer->mux ?
+						PJMEDIA_TPMED_RTCP_MUX : 0,
+					    offerer->sdp, 0);
+    if (status != PJ_SUCCESS)
+	return -115;
+
+    answerer->sdp = create_sdp(pool, answerer);
+    if (!answerer->sdp)
+	return -120;
+
+    status = pjmedia_transport_encode_sdp(answerer->tp, pool, answerer->sdp,
+					  offerer->sdp, 0);
+    if (status != PJ_SUCCESS)
+	return -125;
+
+    status = pjmedia_transport_media_start(answerer->tp, pool, answerer->sdp,
+					   offerer->sdp, 0);
+    if (status != PJ_SUCCESS)
+	return -130;
+
+    status = pjmedia_transport_media_start(offerer->tp, pool, offerer->sdp,
+					   answerer->sdp, 0);
+    if (status != PJ_SUCCESS)
+	return -135;
+
+    return 0;
+}
+
+static pj_status_t attach(struct peer *peer, const struct peer *remote)
+{
+    pj_sockaddr rtp, rtcp;
+
+    get_rem_addr(remote->sdp, &rtp, &rtcp);
+    return pjmedia_transport_attach(peer->tp, peer, &rtp, &rtcp,
+				    pj_sockaddr_get_len(&rtp),
+				    &on_rx_rtp, &on_rx_rtcp);
+}
+
+/* Send RTP and RTCP both ways and check that each arrives on its own
+ * callback.
+ */
+static int exchange(struct peer *a, struct peer *b)
+{
+    pj_uint8_t rtp[12+160], rtcp[8];
+    pj_time_val start, now;
+    unsigned i;
+
+    pj_bzero(rtp, sizeof(rtp));
+    rtp[0] = 0x80;		/* V=2, PT=0 (PCMU) */
+    pj_bzero(rtcp, sizeof(rtcp));
+    rtcp[0] = 0x80;		/* V=2, RC=0 */
+    rtcp[1] = 201;		/* RR */
+    rtcp[3] = 1;		/* length */
+
+    a->rtp_cnt = a->rtcp_cnt = b->rtp_cnt = b->rtcp_cnt = 0;
+
+    for (i=0; i<PKT_CNT; ++i) {
+	rtp[3] = (pj_uint8_t)i;
+	if (pjmedia_transport_send_rtp(a->tp, rtp, sizeof(rtp)) != PJ_SUCCESS ||
+	    pjmedia_transport_send_rtp(b->tp, rtp, sizeof(rtp)) != PJ_SUCCESS)
+	{
+	    return -200;
+	}
+	if (pjmedia_transport_send_rtcp(a->tp, rtcp, sizeof(rtcp))
+		!= PJ_SUCCESS ||
+	    pjmedia_transport_send_rtcp(b->tp, rtcp, sizeof(rtcp))
+		!= PJ_SUCCESS)
+	{
+	    return -205;
+	}
+	/* Let the send complete before reusing the buffers */
+	poll_events(PJ_FALSE);
+    }
+
+    pj_gettimeofday(&start);
+    while (a->rtp_cnt < PKT_CNT || a->rtcp_cnt < PKT_CNT ||
+	   b->rtp_cnt < PKT_CNT || b->rtcp_cnt < PKT_CNT)
+    {
+	pj_gettimeofday(&now);
+	PJ_TIME_VAL_SUB(now, start);
+	if (PJ_TIME_VAL_MSEC(now) > RX_TIMEOUT)
+	    break;
+	poll_events(PJ_TRUE);
+    }
+
+    if (a->rtp_cnt != PKT_CNT || b->rtp_cnt != PKT_CNT) {
+	PJ_LOG(3,(THIS_FILE, "    RTP received: %u/%u, expecting %u",
+		  a->rtp_cnt, b->rtp_cnt, PKT_CNT));
+	return -210;
+    }
+    if (a->rtcp_cnt != PKT_CNT || b->rtcp_cnt != PKT_CNT) {
+	PJ_LOG(3,(THIS_FILE, "    RTCP received: %u/%u, expecting %u",
+		  a->rtcp_cnt, b->rtcp_cnt, PKT_CNT));
+	return -215;
+    }
+
+    return 0;
+}
+
+static unsigned udp_sock_cnt(const struct peer *peer)
+{
+    pjmedia_transport_info tpinfo;
+
+    pjmedia_transport_info_init(&tpinfo);
+    pjmedia_transport_get_info(peer->tp, &tpinfo);
+
+    return (tpinfo.sock_info.rtp_sock != PJ_INVALID_SOCKET) +
+	   (tpinfo.sock_info.rtcp_sock != PJ_INVALID_SOCKET);
+}
+
+static pj_uint16_t udp_rtcp_port(const struct peer *peer)
+{
+    pjmedia_transport_info tpinfo;
+
+    pjmedia_transport_info_init(&tpinfo);
+    pjmedia_transport_get_info(peer->tp, &tpinfo);
+
+    return pj_sockaddr_get_port(&tpinfo.sock_info.rtcp_addr_name);
+}
+
+static int udp_test(const char *title, pj_bool_t offer_mux,
+		    pj_bool_t answer_mux, unsigned expected_sock_cnt,
+		    pj_bool_t renego)
+{
+    pj_pool_t *pool;
+    struct peer off, ans;
+    pj_uint16_t rtcp_port;
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "  UDP: %s", title));
+
+    pool = pj_pool_create(mem, "muxudp", 4000, 4000, NULL);
+    pj_bzero(&off, sizeof(off));
+    pj_bzero(&ans, sizeof(ans));
+    off.name = "off";
+    off.mux = offer_mux;
+    ans.name = "ans";
+    ans.mux = answer_mux;
+
+    if (create_udp(&off) != PJ_SUCCESS || create_udp(&ans) != PJ_SUCCESS) {
+	rc = -10;
+	goto on_return;
+    }
+    rtcp_port = udp_rtcp_port(&off);
+
+    rc = negotiate(pool, &off, &ans);
+    if (rc != 0)
+	goto on_return;
+
+    /* The answer may only carry a=rtcp-mux when both sides want it */
+    if (has_mux(ans.sdp) != (offer_mux && answer_mux)) {
+	rc = -20;
+	goto on_return;
+    }
+
+    if (attach(&off, &ans) != PJ_SUCCESS || attach(&ans, &off) != PJ_SUCCESS)
+    {
+	rc = -30;
+	goto on_return;
+    }
+
+    if (udp_sock_cnt(&off) != expected_sock_cnt ||
+	udp_sock_cnt(&ans) != expected_sock_cnt)
+    {
+	PJ_LOG(3,(THIS_FILE, "    sockets: offerer=%u answerer=%u, "
+		  "expecting %u", udp_sock_cnt(&off), udp_sock_cnt(&ans),
+		  expected_sock_cnt));
+	rc = -40;
+	goto on_return;
+    }
+
+    rc = exchange(&off, &ans);
+    if (rc != 0)
+	goto on_return;
+
+    if (renego) {
+	/* Re-offer to a peer that no longer wants multiplexing. The
+	 * offerer must get its RTCP socket back on the same port.
+	 */
+	pjmedia_transport_detach(off.tp, &off);
+	pjmedia_transport_detach(ans.tp, &ans);
+	ans.mux = PJ_FALSE;
+
+	rc = negotiate(pool, &off, &ans);
+	if (rc != 0)
+	    goto on_return;
+
+	if (attach(&off, &ans) != PJ_SUCCESS ||
+	    attach(&ans, &off) != PJ_SUCCESS)
+	{
+	    rc = -50;
+	    goto on_return;
+	}
+
+	if (udp_sock_cnt(&off) != 2 || udp_sock_cnt(&ans) != 2) {
+	    rc = -60;
+	    goto on_return;
+	}
+	if (udp_rtcp_port(&off) != rtcp_port) {
+	    rc = -65;
+	    goto on_return;
+	}
+
+	rc = exchange(&off, &ans);
+	if (rc != 0)
+	    goto on_return;
+    }
+
+on_return:
+    if (off.tp)
+	pjmedia_transport_close(off.tp);
+    if (ans.tp)
+	pjmedia_transport_close(ans.tp);
+    pj_pool_release(pool);
+
+    return rc;
+}
+
+static int ice_test(const char *title, pj_bool_t offer_mux,
+		    pj_bool_t answer_mux, unsigned expected_comp_cnt)
+{
+    pj_pool_t *pool;
+    struct peer off, ans;
+    pjmedia_transport_info tpinfo;
+    pjmedia_ice_transport_info *ii;
+    unsigned ans_comp_cnt, off_sock_cnt, ans_sock_cnt, checks, comp_id;
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "  ICE: %s", title));
+
+    pool = pj_pool_create(mem, "muxice", 4000, 4000, NULL);
+    pj_bzero(&off, sizeof(off));
+    pj_bzero(&ans, sizeof(ans));
+    off.name = "off";
+    off.mux = offer_mux;
+    ans.name = "ans";
+    ans.mux = answer_mux;
+
+    /* The offerer doesn't know yet whether the answerer will multiplex,
+     * so it always gathers both components.
+     */
+    if (create_ice(&off, 2) != PJ_SUCCESS) {
+	rc = -10;
+	goto on_return;
+    }
+
+    rc = pjmedia_transport_media_create(off.tp, pool,
+					offer_mux? PJMEDIA_TPMED_RTCP_MUX : 0,
+					NULL, 0);
+    off.sdp = create_sdp(pool, &off);
+    if (rc != PJ_SUCCESS || !off.sdp ||
+	pjmedia_transport_encode_sdp(off.tp, pool, off.sdp, NULL, 0) !=
+	    PJ_SUCCESS)
+    {
+	rc = -15;
+	goto on_return;
+    }
+
+    /* Like pjsua, the answerer only creates the RTP component when the
+     * offer allows multiplexing.
+     */
+    ans_comp_cnt = (answer_mux && has_mux(off.sdp)) ? 1 : 2;
+    if (create_ice(&ans, ans_comp_cnt) != PJ_SUCCESS) {
+	rc = -20;
+	goto on_return;
+    }
+
+    rc = pjmedia_transport_media_create(ans.tp, pool,
+					answer_mux? PJMEDIA_TPMED_RTCP_MUX : 0,
+					off.sdp, 0);
+    ans.sdp = create_sdp(pool, &ans);
+    if (rc != PJ_SUCCESS || !ans.sdp ||
+	pjmedia_transport_encode_sdp(ans.tp, pool, ans.sdp, off.sdp, 0) !=
+	    PJ_SUCCESS)
+    {
+	rc = -25;
+	goto on_return;
+    }
+
+    if (has_mux(ans.sdp) != (offer_mux && answer_mux)) {
+	rc = -30;
+	goto on_return;
+    }
+
+    if (pjmedia_transport_media_start(ans.tp, pool, ans.sdp, off.sdp, 0) !=
+	    PJ_SUCCESS ||
+	pjmedia_transport_media_start(off.tp, pool, off.sdp, ans.sdp, 0) !=
+	    PJ_SUCCESS)
+    {
+	rc = -35;
+	goto on_return;
+    }
+
+    if (wait_flag(&off.ice_nego_done, ICE_TIMEOUT) != PJ_SUCCESS ||
+	wait_flag(&ans.ice_nego_done, ICE_TIMEOUT) != PJ_SUCCESS ||
+	off.ice_status != PJ_SUCCESS || ans.ice_status != PJ_SUCCESS)
+    {
+	rc = -40;
+	goto on_return;
+    }
+
+    /* Each side pairs its candidates of a component with the remote
+     * candidates of the same component, for every component they share.
+     * With one host candidate per component this is one check per
+     * running component.
+     */
+    checks = 0;
+    for (comp_id=1; comp_id<=expected_comp_cnt; ++comp_id)
+	checks += cand_cnt(off.sdp, comp_id) * cand_cnt(ans.sdp, comp_id);
+
+    pjmedia_transport_info_init(&tpinfo);
+    pjmedia_transport_get_info(off.tp, &tpinfo);
+    ii = (pjmedia_ice_transport_info*) tpinfo.spc_info[0].buffer;
+    if (ii->comp_cnt != expected_comp_cnt) {
+	PJ_LOG(3,(THIS_FILE, "    offerer runs %u components, expecting %u",
+		  ii->comp_cnt, expected_comp_cnt));
+	rc = -50;
+	goto on_return;
+    }
+
+    pjmedia_transport_info_init(&tpinfo);
+    pjmedia_transport_get_info(ans.tp, &tpinfo);
+    ii = (pjmedia_ice_transport_info*) tpinfo.spc_info[0].buffer;
+    if (ii->comp_cnt != expected_comp_cnt) {
+	PJ_LOG(3,(THIS_FILE, "    answerer runs %u components, expecting %u",
+		  ii->comp_cnt, expected_comp_cnt));
+	rc = -55;
+	goto on_return;
+    }
+
+    /* Sockets: one per gathered component, as advertised in the SDP */
+    off_sock_cnt = (cand_cnt(off.sdp, 1) > 0) + (cand_cnt(off.sdp, 2) > 0);
+    ans_sock_cnt = (cand_cnt(ans.sdp, 1) > 0) + (cand_cnt(ans.sdp, 2) > 0);
+
+    PJ_LOG(3,(THIS_FILE, "    sockets: offerer=%u answerer=%u, checks=%u",
+	      off_sock_cnt, ans_sock_cnt, checks));
+
+    if (off_sock_cnt != 2 || ans_sock_cnt != ans_comp_cnt ||
+	checks != expected_comp_cnt)
+    {
+	rc = -60;
+	goto on_return;
+    }
+
+    if (attach(&off, &ans) != PJ_SUCCESS || attach(&ans, &off) != PJ_SUCCESS)
+    {
+	rc = -70;
+	goto on_return;
+    }
+
+    rc = exchange(&off, &ans);
+
+on_return:
+    if (off.tp)
+	pjmedia_transport_close(off.tp);
+    if (ans.tp)
+	pjmedia_transport_close(ans.tp);
+    pj_pool_release(pool);
+
+    return rc;
+}
+
+/* BUNDLE: an audio (PT 0) and a video (PT 96) media line share the UDP
+ * transport of the audio line on each side.
+ */
+struct bundle_stream
+{
+    pj_uint8_t		 pt;
+    pj_uint32_t		 ssrc;
+    pj_uint32_t		 rem_ssrc;
+    pjmedia_transport	*tp;
+
+    unsigned		 rtp_cnt;
+    unsigned		 rtcp_cnt;
+    unsigned		 bad_cnt;
+};
+
+struct bundle_peer
+{
+    struct peer		 base;
+    struct bundle_stream st[2];
+};
+
+static pj_uint32_t get_ssrc(const pj_uint8_t *p)
+{
+    return ((pj_uint32_t)p[0] << 24) | ((pj_uint32_t)p[1] << 16) |
+	   ((pj_uint32_t)p[2] << 8) | p[3];
+}
+
+static void set_ssrc(pj_uint8_t *p, pj_uint32_t ssrc)
+{
+    p[0] = (pj_uint8_t)(ssrc >> 24);
+    p[1] = (pj_uint8_t)(ssrc >> 16);
+    p[2] = (pj_uint8_t)(ssrc >> 8);
+    p[3] = (pj_uint8_t)ssrc;
+}
+
+static void on_bundle_rtp(void *user_data, void *pkt, pj_ssize_t size)
+{
+    struct bundle_stream *st = (struct bundle_stream*) user_data;
+    const pj_uint8_t *p = (const pj_uint8_t*) pkt;
+
+    if (size >= 12 && (p[1] & 0x7F) == st->pt &&
+	get_ssrc(p + 8) == st->rem_ssrc)
+    {
+	++st->rtp_cnt;
+    } else {
+	++st->bad_cnt;
+    }
+}
+
+static void on_bundle_rtcp(void *user_data, void *pkt, pj_ssize_t size)
+{
+    struct bundle_stream *st = (struct bundle_stream*) user_data;
+    const pj_uint8_t *p = (const pj_uint8_t*) pkt;
+
+    /* Either sent by the remote stream, or reporting on ours */
+    if (size >= 8 + 24 && p[1] == 201 &&
+	(get_ssrc(p + 4) == st->rem_ssrc || get_ssrc(p + 8) == st->ssrc))
+    {
+	++st->rtcp_cnt;
+    } else {
+	++st->bad_cnt;
+    }
+}
+
+static pjmedia_sdp_session *create_bundle_sdp(pj_pool_t *pool,
+					      struct bundle_peer *peer)
+{
+    pjmedia_transport_info tpinfo;
+    pjmedia_sdp_session *sdp;
+    char addr[PJ_INET6_ADDRSTRLEN];
+    char rtcp[32];
+    char *buf;
+    int len;
+
+    pjmedia_transport_info_init(&tpinfo);
+    if (pjmedia_transport_get_info(peer->st[0].tp, &tpinfo) != PJ_SUCCESS)
+	return NULL;
+
+    pj_sockaddr_print(&tpinfo.sock_info.rtp_addr_name, addr, sizeof(addr),
+		      0);
+    rtcp[0] = '\0';
+    if (tpinfo.sock_info.rtcp_addr_name.addr.sa_family) {
+	pj_ansi_snprintf(rtcp, sizeof(rtcp), "a=rtcp:%d\r\n",
+			 pj_sockaddr_get_port(&tpinfo.sock_info.
+							rtcp_addr_name));
+    }
+
+    buf = (char*) pj_pool_alloc(pool, 512);
+    len = pj_ansi_snprintf(buf, 512,
+			   "v=0\r\n"
+			   "o=%s 1 1 IN IP4 %s\r\n"
+			   "s=-\r\n"
+			   "c=IN IP4 %s\r\n"
+			   "t=0 0\r\n"
+			   "a=group:BUNDLE a v\r\n"
+			   "m=audio %d RTP/AVP 0\r\n"
+			   "%s"
+			   "a=mid:a\r\n"
+			   "m=video %d RTP/AVP 96\r\n"
+			   "%s"
+			   "a=rtpmap:96 H264/90000\r\n"
+			   "a=mid:v\r\n",
+			   peer->base.name, addr, addr,
+			   pj_sockaddr_get_port(&tpinfo.sock_info.
+							rtp_addr_name),
+			   rtcp,
+			   pj_sockaddr_get_port(&tpinfo.sock_info.
+							rtp_addr_name),
+			   rtcp);
+
+    if (pjmedia_sdp_parse(pool, buf, len, &sdp) != PJ_SUCCESS)
+	return NULL;
+
+    return sdp;
+}
+
+static int bundle_negotiate(pj_pool_t *pool, struct bundle_peer *off,
+			    struct bundle_peer *ans)
+{
+    unsigned i;
+
+    for (i=0; i<2; ++i) {
+	if (pjmedia_transport_media_create(off->st[i].tp, pool,
+					   off->base.mux ?
+						PJMEDIA_TPMED_RTCP_MUX : 0,
+					   NULL, i) != PJ_SUCCESS)
+	{
+	    return -100;
+	}
+    }
+
+    off->base.sdp = create_bundle_sdp(pool, off);
+    if (!off->base.sdp)
+	return -105;
+
+    for (i=0; i<2; ++i) {
+	if (pjmedia_transport_encode_sdp(off->st[i].tp, pool, off->base.sdp,
+					 NULL, i) != PJ_SUCCESS)
+	{
+	    return -110;
+	}
+	if (pjmedia_transport_media_create(ans->st[i].tp, pool,
+					   ans->base.mux ?
+						PJMEDIA_TPMED_RTCP_MUX : 0,
+					   off->base.sdp, i) != PJ_SUCCESS)
+	{
+	    return -115;
+	}
+    }
+
+    ans->base.sdp = create_bundle_sdp(pool, ans);
+    if (!ans->base.sdp)
+	return -120;
+
+    for (i=0; i<2; ++i) {
+	if (pjmedia_transport_encode_sdp(ans->st[i].tp, pool, ans->base.sdp,
+					 off->base.sdp, i) != PJ_SUCCESS)
+	{
+	    return -125;
+	}
+    }
+
+    for (i=0; i<2; ++i) {
+	if (pjmedia_transport_media_start(ans->st[i].tp, pool,
+					  ans->base.sdp, off->base.sdp,
+					  i) != PJ_SUCCESS ||
+	    pjmedia_transport_media_start(off->st[i].tp, pool,
+					  off->base.sdp, ans->base.sdp,
+					  i) != PJ_SUCCESS)
+	{
+	    return -130;
+	}
+    }
+
+    return 0;
+}
+
+/* Send one RTP packet of every stream, then one RTCP RR of every stream
+ * reporting on the remote stream of the same media line.
+ */
+static void bundle_send(struct bundle_peer *peer, const pj_uint8_t *rtp_tpl,
+			pj_size_t rtp_size, unsigned seq)
+{
+    pj_uint8_t rtp[12+160], rtcp[8+24];
+    unsigned i;
+
+    for (i=0; i<2; ++i) {
+	pj_memcpy(rtp, rtp_tpl, rtp_size);
+	rtp[1] = peer->st[i].pt;
+	rtp[3] = (pj_uint8_t)seq;
+	set_ssrc(rtp + 8, peer->st[i].ssrc);
+	pjmedia_transport_send_rtp(peer->st[i].tp, rtp, rtp_size);
+	poll_events(PJ_FALSE);
+    }
+
+    for (i=0; i<2; ++i) {
+	pj_bzero(rtcp, sizeof(rtcp));
+	rtcp[0] = 0x81;		/* V=2, RC=1 */
+	rtcp[1] = 201;		/* RR */
+	rtcp[3] = 7;		/* length */
+	set_ssrc(rtcp + 4, peer->st[i].ssrc);
+	set_ssrc(rtcp + 8, peer->st[i].rem_ssrc);
+	pjmedia_transport_send_rtcp(peer->st[i].tp, rtcp, sizeof(rtcp));
+	poll_events(PJ_FALSE);
+    }
+}
+
+static int bundle_exchange(struct bundle_peer *a, struct bundle_peer *b)
+{
+    pj_uint8_t rtp[12+160], rtcp[8+24];
+    pj_time_val start, now;
+    unsigned i, expected_rtcp;
+
+    pj_bzero(rtp, sizeof(rtp));
+    rtp[0] = 0x80;
+
+    for (i=0; i<PKT_CNT; ++i) {
+	bundle_send(a, rtp, sizeof(rtp), i);
+	bundle_send(b, rtp, sizeof(rtp), i);
+    }
+
+    /* A receive-only stream reports with an SSRC that has never sent
+     * RTP, so the report must be matched by its report block: send one
+     * about the video stream of b.
+     */
+    pj_bzero(rtcp, sizeof(rtcp));
+    rtcp[0] = 0x81;
+    rtcp[1] = 201;
+    rtcp[3] = 7;
+    set_ssrc(rtcp + 4, 0x7E57);
+    set_ssrc(rtcp + 8, b->st[1].ssrc);
+    pjmedia_transport_send_rtcp(a->st[1].tp, rtcp, sizeof(rtcp));
+
+    pj_gettimeofday(&start);
+    for (;;) {
+	pj_bool_t done = PJ_TRUE;
+
+	for (i=0; i<2; ++i) {
+	    expected_rtcp = PKT_CNT + (i == 1);
+	    if (a->st[i].rtp_cnt < PKT_CNT || a->st[i].rtcp_cnt < PKT_CNT ||
+		b->st[i].rtp_cnt < PKT_CNT ||
+		b->st[i].rtcp_cnt < expected_rtcp)
+	    {
+		done = PJ_FALSE;
+	    }
+	}
+	if (done)
+	    break;
+
+	pj_gettimeofday(&now);
+	PJ_TIME_VAL_SUB(now, start);
+	if (PJ_TIME_VAL_MSEC(now) > RX_TIMEOUT)
+	    break;
+	poll_events(PJ_TRUE);
+    }
+
+    for (i=0; i<2; ++i) {
+	expected_rtcp = PKT_CNT + (i == 1);
+	PJ_LOG(3,(THIS_FILE, "    %s: RTP %u/%u, RTCP %u/%u, misrouted %u/%u",
+		  (i==0 ? "audio" : "video"),
+		  a->st[i].rtp_cnt, b->st[i].rtp_cnt,
+		  a->st[i].rtcp_cnt, b->st[i].rtcp_cnt,
+		  a->st[i].bad_cnt, b->st[i].bad_cnt));
+	if (a->st[i].bad_cnt || b->st[i].bad_cnt)
+	    return -220;
+	if (a->st[i].rtp_cnt != PKT_CNT || b->st[i].rtp_cnt != PKT_CNT)
+	    return -225;
+	if (a->st[i].rtcp_cnt != PKT_CNT || b->st[i].rtcp_cnt != expected_rtcp)
+	    return -230;
+    }
+
+    return 0;
+}
+
+static pj_status_t create_bundle_peer(struct bundle_peer *peer,
+				      pj_uint32_t ssrc_base,
+				      pj_uint32_t rem_ssrc_base)
+{
+    pj_status_t status;
+    unsigned i;
+
+    status = create_udp(&peer->base);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    status = pjmedia_transport_bundle_create(endpt, peer->base.name,
+					     peer->base.tp, &peer->st[0].tp);
+    if (status != PJ_SUCCESS) {
+	pjmedia_transport_close(peer->base.tp);
+	return status;
+    }
+    /* The group owns the UDP transport now */
+    peer->base.tp = NULL;
+
+    status = pjmedia_transport_bundle_add_member(peer->st[0].tp, NULL,
+						 &peer->st[1].tp);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    for (i=0; i<2; ++i) {
+	peer->st[i].pt = (pj_uint8_t)(i == 0 ? 0 : 96);
+	peer->st[i].ssrc = ssrc_base + i;
+	peer->st[i].rem_ssrc = rem_ssrc_base + i;
+    }
+
+    return PJ_SUCCESS;
+}
+
+static int bundle_test(const char *title, pj_bool_t mux,
+		       unsigned expected_sock_cnt)
+{
+    pj_pool_t *pool;
+    struct bundle_peer off, ans;
+    pjmedia_transport_info tpinfo;
+    unsigned i, sock_cnt[2];
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "  BUNDLE: %s", title));
+
+    pool = pj_pool_create(mem, "muxbndl", 4000, 4000, NULL);
+    pj_bzero(&off, sizeof(off));
+    pj_bzero(&ans, sizeof(ans));
+    off.base.name = "off";
+    off.base.mux = mux;
+    ans.base.name = "ans";
+    ans.base.mux = mux;
+
+    if (create_bundle_peer(&off, 0x1000, 0x2000) != PJ_SUCCESS ||
+	create_bundle_peer(&ans, 0x2000, 0x1000) != PJ_SUCCESS)
+    {
+	rc = -10;
+	goto on_return;
+    }
+
+    rc = bundle_negotiate(pool, &off, &ans);
+    if (rc != 0)
+	goto on_return;
+
+    /* Both media lines say whether RTCP is multiplexed */
+    for (i=0; i<2; ++i) {
+	if ((pjmedia_sdp_media_find_attr2(ans.base.sdp->media[i], "rtcp-mux",
+					  NULL) != NULL) != mux)
+	{
+	    rc = -20;
+	    goto on_return;
+	}
+    }
+
+    for (i=0; i<2; ++i) {
+	pj_sockaddr rtp, rtcp;
+
+	get_rem_addr(ans.base.sdp, &rtp, &rtcp);
+	if (pjmedia_transport_attach(off.st[i].tp, &off.st[i], &rtp, &rtcp,
+				     pj_sockaddr_get_len(&rtp),
+				     &on_bundle_rtp, &on_bundle_rtcp)
+		!= PJ_SUCCESS)
+	{
+	    rc = -30;
+	    goto on_return;
+	}
+
+	get_rem_addr(off.base.sdp, &rtp, &rtcp);
+	if (pjmedia_transport_attach(ans.st[i].tp, &ans.st[i], &rtp, &rtcp,
+				     pj_sockaddr_get_len(&rtp),
+				     &on_bundle_rtp, &on_bundle_rtcp)
+		!= PJ_SUCCESS)
+	{
+	    rc = -35;
+	    goto on_return;
+	}
+    }
+
+    /* Sockets of the whole call: two media lines on one transport */
+    pjmedia_transport_info_init(&tpinfo);
+    pjmedia_transport_get_info(off.st[1].tp, &tpinfo);
+    sock_cnt[0] = (tpinfo.sock_info.rtp_sock != PJ_INVALID_SOCKET) +
+		  (tpinfo.sock_info.rtcp_sock != PJ_INVALID_SOCKET);
+    pjmedia_transport_info_init(&tpinfo);
+    pjmedia_transport_get_info(ans.st[1].tp, &tpinfo);
+    sock_cnt[1] = (tpinfo.sock_info.rtp_sock != PJ_INVALID_SOCKET) +
+		  (tpinfo.sock_info.rtcp_sock != PJ_INVALID_SOCKET);
+
+    PJ_LOG(3,(THIS_FILE, "    sockets for 2 media lines: offerer=%u "
+	      "answerer=%u", sock_cnt[0], sock_cnt[1]));
+    if (sock_cnt[0] != expected_sock_cnt ||
+	sock_cnt[1] != expected_sock_cnt)
+    {
+	rc = -40;
+	goto on_return;
+    }
+
+    rc = bundle_exchange(&off, &ans);
+
+on_return:
+    /* The shared transport is closed with the last member */
+    for (i=0; i<2; ++i) {
+	if (off.st[i].tp)
+	    pjmedia_transport_close(off.st[i].tp);
+	if (ans.st[i].tp)
+	    pjmedia_transport_close(ans.st[i].tp);
+    }
+    if (off.base.tp)
+	pjmedia_transport_close(off.base.tp);
+    if (ans.base.tp)
+	pjmedia_transport_close(ans.base.tp);
+    pj_pool_release(pool);
+
+    return rc;
+}
+
+int transport_mux_test(void)
+{
+    pj_pool_t *pool;
+    pj_status_t status;
+    int rc;
+
+    pool = pj_pool_create(mem, "muxtest", 1000, 1000, NULL);
+
+    status = pjmedia_endpt_create(mem, NULL, 0, &endpt);
+    if (status != PJ_SUCCESS) {
+	pj_pool_release(pool);
+	return -1;
+    }
+
+    status = pj_timer_heap_create(pool, 64, &timer_heap);
+    if (status != PJ_SUCCESS) {
+	rc = -2;
+	goto on_return;
+    }
+
+    rc = udp_test("both sides multiplex", PJ_TRUE, PJ_TRUE, 1, PJ_FALSE);
+    if (rc != 0)
+	goto on_return;
+
+    rc = udp_test("neither side multiplexes", PJ_FALSE, PJ_FALSE, 2,
+		  PJ_FALSE);
+    if (rc != 0)
+	goto on_return;
+
+    rc = udp_test("fallback to non-mux answerer", PJ_TRUE, PJ_FALSE, 2,
+		  PJ_FALSE);
+    if (rc != 0)
+	goto on_return;
+
+    rc = udp_test("re-offer drops multiplexing", PJ_TRUE, PJ_TRUE, 1,
+		  PJ_TRUE);
+    if (rc != 0)
+	goto on_return;
+
+    rc = ice_test("both sides multiplex", PJ_TRUE, PJ_TRUE, 1);
+    if (rc != 0) {
+	rc -= 1000;
+	goto on_return;
+    }
+
+    rc = ice_test("neither side multiplexes", PJ_FALSE, PJ_FALSE, 2);
+    if (rc != 0) {
+	rc -= 1000;
+	goto on_return;
+    }
+
+    rc = ice_test("fallback to non-mux answerer", PJ_TRUE, PJ_FALSE, 2);
+    if (rc != 0) {
+	rc -= 1000;
+	goto on_return;
+    }
+
+    rc = bundle_test("audio and video, RTCP multiplexed", PJ_TRUE, 1);
+    if (rc != 0) {
+	rc -= 2000;
+	goto on_return;
+    }
+
+    rc = bundle_test("audio and video, separate RTCP", PJ_FALSE, 2);
+    if (rc != 0) {
+	rc -= 2000;
+	goto on_return;
+    }
+
+on_return:
+    if (timer_heap) {
+	pj_timer_heap_destroy(timer_heap);
+	timer_heap = NULL;
+    }
+    pjmedia_endpt_destroy(endpt);
+    endpt = NULL;
+    pj_pool_release(pool);
+
+    return rc;
+}
@@ -185,7 +185,8 @@ static int vidport_test(void)
     int cap_id, rend_id;
     pjmedia_format_id test_fmts[] = {
         PJMEDIA_FORMAT_RGBA,
-        PJMEDIA_FORMAT_I420
+        PJMEDIA_FORMAT_I420,
+        PJMEDIA_FORMAT_NV21
     };
 
     PJ_LOG(3, (THIS_FILE, " Video port tests:"));
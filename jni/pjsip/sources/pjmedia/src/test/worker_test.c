@@ -0,0 +1,268 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2011-2011 Teluu Inc. (http://www.teluu.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "test.h"
+
+#define THIS_FILE   "worker_test.c"
+
+#define BURST_CNT	32	/* Flood packets sent every interval	    */
+#define BURST_INTERVAL	10	/* msec					    */
+#define WORK_USEC	250	/* Time to process one flood packet	    */
+#define PROBE_CNT	200
+
+/* One transport is flooded with packets that are slow to process, as
+ * a busy call would be, while the other one receives timestamped probes.
+ */
+static volatile pj_bool_t flood_busy;
+static unsigned probe_cnt;
+static pj_uint32_t probe_total_usec, probe_max_usec;
+
+
+static void flood_rx_rtp(void *user_data, void *pkt, pj_ssize_t size)
+{
+    pj_timestamp t0, t1;
+
+    PJ_UNUSED_ARG(user_data);
+    PJ_UNUSED_ARG(pkt);
+    PJ_UNUSED_ARG(size);
+
+    pj_get_timestamp(&t0);
+    do {
+	pj_get_timestamp(&t1);
+    } while (flood_busy && pj_elapsed_usec(&t0, &t1) < WORK_USEC);
+}
+
+static void probe_rx_rtp(void *user_data, void *pkt, pj_ssize_t size)
+{
+    pj_timestamp sent, now;
+    pj_uint32_t usec;
+
+    PJ_UNUSED_ARG(user_data);
+
+    if (size != sizeof(sent))
+	return;
+
+    pj_memcpy(&sent, pkt, sizeof(sent));
+    pj_get_timestamp(&now);
+    usec = pj_elapsed_usec(&sent, &now);
+
+    probe_total_usec += usec;
+    if (usec > probe_max_usec)
+	probe_max_usec = usec;
+    ++probe_cnt;
+}
+
+static pj_status_t create_sock(pj_sock_t *sock, pj_sockaddr *addr)
+{
+    pj_str_t localhost = pj_str("127.0.0.1");
+    int addr_len = sizeof(*addr);
+    pj_status_t status;
+
+    status = pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0, sock);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    pj_sockaddr_init(pj_AF_INET(), addr, &localhost, 0);
+    status = pj_sock_bind(*sock, addr, pj_sockaddr_get_len(addr));
+    if (status == PJ_SUCCESS)
+	status = pj_sock_getsockname(*sock, addr, &addr_len);
+    if (status != PJ_SUCCESS) {
+	pj_sock_close(*sock);
+	*sock = PJ_INVALID_SOCKET;
+    }
+
+    return status;
+}
+
+/* Create UDP transport polled by the ioqueue of the key */
+static pj_status_t create_tp(pjmedia_endpt *endpt, unsigned key,
+			     const pj_sockaddr *rem_addr,
+			     void (*rtp_cb)(void*, void*, pj_ssize_t),
+			     pjmedia_transport **p_tp)
+{
+    pjmedia_sock_info si;
+    pj_status_t status;
+
+    pj_bzero(&si, sizeof(si));
+    si.rtp_sock = si.rtcp_sock = PJ_INVALID_SOCKET;
+
+    status = create_sock(&si.rtp_sock, &si.rtp_addr_name);
+    if (status == PJ_SUCCESS)
+	status = create_sock(&si.rtcp_sock, &si.rtcp_addr_name);
+    if (status == PJ_SUCCESS) {
+	status = pjmedia_transport_udp_attach2(endpt, NULL, &si,
+				PJMEDIA_UDP_NO_SRC_ADDR_CHECKING,
+				pjmedia_endpt_get_ioqueue_by_key(endpt, key),
+				p_tp);
+    }
+    if (status != PJ_SUCCESS) {
+	if (si.rtp_sock != PJ_INVALID_SOCKET)
+	    pj_sock_close(si.rtp_sock);
+	if (si.rtcp_sock != PJ_INVALID_SOCKET)
+	    pj_sock_close(si.rtcp_sock);
+	return status;
+    }
+
+    return pjmedia_transport_attach(*p_tp, NULL, rem_addr, rem_addr,
+				    sizeof(pj_sockaddr_in), rtp_cb, NULL);
+}
+
+/* Measure the probe latency while the other transport is flooded, and
+ * check that the packets were handled by the workers of the ioqueue of
+ * their transport.
+ */
+static int run_flood(unsigned ioqueue_cnt)
+{
+    pj_uint32_t ioq_events[2] = { 0, 0 };
+    unsigned avg;
+    pjmedia_endpt *endpt = NULL;
+    pjmedia_endpt_worker_param param;
+    pjmedia_transport *flood_tp = NULL, *probe_tp = NULL;
+    pjmedia_transport_info info;
+    pj_sockaddr tx_addr, flood_addr, probe_addr;
+    pj_sock_t tx_sock = PJ_INVALID_SOCKET;
+    pj_uint8_t pkt[172];
+    unsigned i, j;
+    pj_status_t status;
+    int rc;
+
+    probe_cnt = 0;
+    probe_total_usec = probe_max_usec = 0;
+    flood_busy = PJ_TRUE;
+    pj_bzero(pkt, sizeof(pkt));
+
+    pjmedia_endpt_worker_param_default(&param);
+    param.ioqueue_cnt = ioqueue_cnt;
+
+    status = pjmedia_endpt_create2(mem, NULL, &param, &endpt);
+    if (status == PJ_SUCCESS)
+	status = create_sock(&tx_sock, &tx_addr);
+    if (status == PJ_SUCCESS)
+	status = create_tp(endpt, 0, &tx_addr, &flood_rx_rtp, &flood_tp);
+    if (status == PJ_SUCCESS)
+	status = create_tp(endpt, 1, &tx_addr, &probe_rx_rtp, &probe_tp);
+    if (status != PJ_SUCCESS) {
+	app_perror(status, "Error creating worker test");
+	rc = -10;
+	goto on_return;
+    }
+
+    pjmedia_transport_info_init(&info);
+    pjmedia_transport_get_info(flood_tp, &info);
+    pj_sockaddr_cp(&flood_addr, &info.sock_info.rtp_addr_name);
+    pjmedia_transport_info_init(&info);
+    pjmedia_transport_get_info(probe_tp, &info);
+    pj_sockaddr_cp(&probe_addr, &info.sock_info.rtp_addr_name);
+
+    /* Each probe is sent right after a burst of flood packets */
+    for (i=0; i<PROBE_CNT; ++i) {
+	pj_timestamp now;
+	pj_ssize_t len;
+
+	for (j=0; j<BURST_CNT; ++j) {
+	    len = sizeof(pkt);
+	    pj_sock_sendto(tx_sock, pkt, &len, 0, &flood_addr,
+			   sizeof(pj_sockaddr_in));
+	}
+
+	pj_get_timestamp(&now);
+	len = sizeof(now);
+	pj_sock_sendto(tx_sock, &now, &len, 0, &probe_addr,
+		       sizeof(pj_sockaddr_in));
+
+	pj_thread_sleep(BURST_INTERVAL);
+    }
+
+    /* Let the workers catch up */
+    pj_thread_sleep(200);
+    flood_busy = PJ_FALSE;
+
+    if (probe_cnt == 0) {
+	PJ_LOG(3,(THIS_FILE, "  ..no probe received"));
+	rc = -20;
+	goto on_return;
+    }
+
+    avg = probe_total_usec / probe_cnt;
+    PJ_LOG(3,(THIS_FILE, "  %d ioqueue(s): %u probes, latency avg=%u usec, "
+	      "max=%u usec", ioqueue_cnt, probe_cnt, avg, probe_max_usec));
+
+    for (i=0; i<pjmedia_endpt_get_thread_count(endpt); ++i) {
+	pjmedia_endpt_worker_stat stat;
+
+	pjmedia_endpt_get_worker_stat(endpt, i, &stat);
+	PJ_LOG(3,(THIS_FILE, "  ..worker %d: ioqueue=%u, events=%u, "
+		  "cpu=%u ms", i, stat.ioqueue_idx, stat.event_cnt,
+		  (unsigned)(stat.cpu_usec / 1000)));
+
+	if (stat.ioqueue_idx >= ioqueue_cnt) {
+	    rc = -30;
+	    goto on_return;
+	}
+	ioq_events[stat.ioqueue_idx] += stat.event_cnt;
+    }
+
+    /* Latency depends on the number of CPUs and on the load of the host,
+     * so only check that the flood stayed on its own ioqueue: the workers
+     * of the probe ioqueue must have seen the probes and nothing else.
+     * The flood packets are fewer events than packets, as the socket
+     * drops some of them and a poll may read several.
+     */
+    if (ioqueue_cnt > 1 &&
+	(ioq_events[0] == 0 || ioq_events[1] < probe_cnt ||
+	 ioq_events[1] > PROBE_CNT + BURST_CNT))
+    {
+	PJ_LOG(3,(THIS_FILE, "  ..error: %u events on the flood ioqueue, "
+		  "%u on the probe ioqueue", ioq_events[0], ioq_events[1]));
+	rc = -40;
+	goto on_return;
+    }
+
+    rc = 0;
+
+on_return:
+    flood_busy = PJ_FALSE;
+    if (flood_tp)
+	pjmedia_transport_close(flood_tp);
+    if (probe_tp)
+	pjmedia_transport_close(probe_tp);
+    if (tx_sock != PJ_INVALID_SOCKET)
+	pj_sock_close(tx_sock);
+    if (endpt)
+	pjmedia_endpt_destroy(endpt);
+
+    return rc;
+}
+
+int worker_test(void)
+{
+    int rc;
+
+    PJ_LOG(3,(THIS_FILE, "  %d packets of %d usec work every %d ms on "
+	      "one transport", BURST_CNT, WORK_USEC, BURST_INTERVAL));
+
+    rc = run_flood(1);
+    if (rc != 0)
+	return rc;
+
+    rc = run_flood(2);
+    if (rc != 0)
+	return rc - 100;
+
+    return 0;
+}
@@ -420,6 +420,30 @@ typedef enum pj_ice_strans_state
 } pj_ice_strans_state;
 
 
+/**
+ * This structure describes how long the ICE stream transport took to
+ * gather its candidates. All components gather their candidates at the
+ * same time, so the total is about the time of the slowest candidate
+ * type rather than the sum of them.
+ */
+typedef struct pj_ice_strans_gather_stat
+{
+    /**
+     * Time from creation until the candidates of all components have
+     * been gathered, in msec. Zero if gathering has not completed yet.
+     */
+    unsigned	total_msec;
+
+    /**
+     * Time from creation until the last candidate of each type became
+     * ready, in msec, indexed by #pj_ice_cand_type. Zero when there is
+     * no such candidate.
+     */
+    unsigned	msec[PJ_ICE_CAND_TYPE_RELAYED+1];
+
+} pj_ice_strans_gather_stat;
+
+
 /** 
  * Initialize ICE transport configuration with default values.
  *
@@ -483,6 +507,18 @@ PJ_DECL(pj_ice_strans_state) pj_ice_strans_get_state(pj_ice_strans *ice_st);
 PJ_DECL(const char*) pj_ice_strans_state_name(pj_ice_strans_state state);
 
 
+/**
+ * Get the candidate gathering times of the ICE stream transport.
+ *
+ * @param ice_st	The ICE stream transport.
+ * @param stat		Structure to receive the gathering times.
+ *
+ * @return		PJ_SUCCESS, or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pj_ice_strans_get_gather_stat(pj_ice_strans *ice_st,
+					   pj_ice_strans_gather_stat *stat);
+
+
 /**
  * Destroy the ICE stream transport. This will destroy the ICE session
  * inside the ICE stream transport, close all sockets and release all
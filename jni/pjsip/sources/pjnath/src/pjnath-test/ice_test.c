@@ -335,6 +335,30 @@ static void ice_on_ice_complete(pj_ice_strans *ice_st,
 /* Start ICE negotiation on the endpoint, based on parameter from
  * the other endpoint.
  */
+/* Check the candidate gathering times of ICE stream transport */
+static int check_gather_stat(struct ice_ept *ept)
+{
+    pj_ice_strans_gather_stat stat;
+    unsigned i;
+
+    if (pj_ice_strans_get_gather_stat(ept->ice, &stat) != PJ_SUCCESS)
+	return -150;
+
+    PJ_LOG(4,("", INDENT "gathering took %u ms (host %u ms, srflx %u ms, "
+	      "relay %u ms)", stat.total_msec,
+	      stat.msec[PJ_ICE_CAND_TYPE_HOST],
+	      stat.msec[PJ_ICE_CAND_TYPE_SRFLX],
+	      stat.msec[PJ_ICE_CAND_TYPE_RELAYED]));
+
+    /* Gathering completes with the slowest candidate */
+    for (i=0; i<PJ_ARRAY_SIZE(stat.msec); ++i) {
+	if (stat.msec[i] > stat.total_msec)
+	    return -151;
+    }
+
+    return 0;
+}
+
 static pj_status_t start_ice(struct ice_ept *ept, const struct ice_ept *remote)
 {
     pj_ice_sess_cand rcand[32];
@@ -490,6 +514,15 @@ static int perform_test(const char *title,
 	goto on_return;
     }
 
+    rc = check_gather_stat(&sess->caller);
+    if (rc == 0)
+	rc = check_gather_stat(&sess->callee);
+    if (rc != 0) {
+	PJ_LOG(3,("", INDENT "err: invalid gathering time"));
+	destroy_sess(sess, 500);
+	return rc;
+    }
+
     /* Init ICE on caller */
     rc = pj_ice_strans_init_ice(sess->caller.ice, sess->caller.cfg.role, 
 				&sess->caller.ufrag, &sess->caller.pass);
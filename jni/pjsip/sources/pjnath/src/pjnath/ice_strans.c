@@ -178,6 +178,9 @@ struct pj_ice_strans
     pj_ice_sess		    *ice;	/**< ICE session.		*/
     pj_time_val		     start_time;/**< Time when ICE was started	*/
 
+    pj_time_val		     gather_start;/**< Creation time.		*/
+    pj_ice_strans_gather_stat gather_stat;/**< Gathering times.	*/
+
     unsigned		     comp_cnt;	/**< Number of components.	*/
     pj_ice_strans_comp	   **comp;	/**< Components array.		*/
 
@@ -189,6 +192,63 @@ struct pj_ice_strans
 };
 
 
+/* Record the time when a candidate has finished gathering */
+static void gather_done(pj_ice_strans *ice_st, unsigned comp_id,
+			pj_ice_cand_type type)
+{
+    pj_time_val now;
+    unsigned msec;
+
+    /* Only the initial gathering is of interest */
+    if (ice_st->cb_called)
+	return;
+
+    pj_gettickcount(&now);
+    PJ_TIME_VAL_SUB(now, ice_st->gather_start);
+    msec = PJ_TIME_VAL_MSEC(now);
+
+    if (msec > ice_st->gather_stat.msec[type])
+	ice_st->gather_stat.msec[type] = msec;
+
+    PJ_LOG(5,(ice_st->obj_name, "Comp %d: %s candidate ready in %u ms",
+	      comp_id, pj_ice_get_cand_type_name(type), msec));
+}
+
+/* Resolve the STUN server name once for all components. Without a DNS
+ * resolver each component would otherwise block on its own lookup of
+ * the same name, one after another. The STUN socket only uses the first
+ * address of the lookup anyway, so nothing is lost by passing just that
+ * one. The TURN server name is not resolved here: the TURN session tries
+ * every address of its own lookup in turn, which a single address would
+ * defeat.
+ */
+static void resolve_server(pj_ice_strans *ice_st, pj_str_t *server)
+{
+    pj_in6_addr tmp_addr;
+    pj_addrinfo ai;
+    unsigned cnt = 1;
+    char addr[PJ_INET6_ADDRSTRLEN];
+
+    if (server->slen == 0 || ice_st->cfg.resolver)
+	return;
+
+    /* Nothing to do if it's an IP address already */
+    if (pj_inet_pton(ice_st->cfg.af, server, &tmp_addr) == PJ_SUCCESS)
+	return;
+
+    /* On failure, leave the name so the component reports the error */
+    if (pj_getaddrinfo(ice_st->cfg.af, server, &cnt, &ai) != PJ_SUCCESS ||
+	cnt == 0)
+    {
+	return;
+    }
+
+    pj_sockaddr_print(&ai.ai_addr, addr, sizeof(addr), 0);
+    PJ_LOG(5,(ice_st->obj_name, "%.*s resolved to %s",
+	      (int)server->slen, server->ptr, addr));
+    pj_strdup2(ice_st->pool, server, addr);
+}
+
 /* Validate configuration */
 static pj_status_t pj_ice_strans_cfg_check_valid(const pj_ice_strans_cfg *cfg)
 {
@@ -551,8 +611,12 @@ PJ_DEF(pj_status_t) pj_ice_strans_create( const char *name,
 	      comp_cnt));
     pj_log_push_indent();
 
+    pj_gettickcount(&ice_st->gather_start);
+
     pj_ice_strans_cfg_copy(pool, &ice_st->cfg, cfg);
     pj_memcpy(&ice_st->cb, cb, sizeof(*cb));
+
+    resolve_server(ice_st, &ice_st->cfg.stun.server);
     
     status = pj_atomic_create(pool, 0, &ice_st->busy_cnt);
     if (status != PJ_SUCCESS) {
@@ -588,6 +652,9 @@ PJ_DEF(pj_status_t) pj_ice_strans_create( const char *name,
 	    pj_log_pop_indent();
 	    return status;
 	}
+
+	/* Host candidates are ready as soon as the socket is created */
+	gather_done(ice_st, i+1, PJ_ICE_CAND_TYPE_HOST);
     }
 
     /* Done with initialization */
@@ -664,6 +731,16 @@ PJ_DEF(pj_ice_strans_state) pj_ice_strans_get_state(pj_ice_strans *ice_st)
     return ice_st->state;
 }
 
+/* Get candidate gathering times. */
+PJ_DEF(pj_status_t) pj_ice_strans_get_gather_stat(pj_ice_strans *ice_st,
+					  pj_ice_strans_gather_stat *stat)
+{
+    PJ_ASSERT_RETURN(ice_st && stat, PJ_EINVAL);
+
+    pj_memcpy(stat, &ice_st->gather_stat, sizeof(*stat));
+    return PJ_SUCCESS;
+}
+
 /* State string */
 PJ_DEF(const char*) pj_ice_strans_state_name(pj_ice_strans_state state)
 {
@@ -707,6 +784,7 @@ static void sess_fail(pj_ice_strans *ice_st, pj_ice_strans_op op,
 /* Update initialization status */
 static void sess_init_update(pj_ice_strans *ice_st)
 {
+    pj_time_val now;
     unsigned i;
 
     /* Ignore if init callback has been called */
@@ -727,6 +805,12 @@ static void sess_init_update(pj_ice_strans *ice_st)
     }
 
     /* All candidates have been gathered */
+    pj_gettickcount(&now);
+    PJ_TIME_VAL_SUB(now, ice_st->gather_start);
+    ice_st->gather_stat.total_msec = PJ_TIME_VAL_MSEC(now);
+    PJ_LOG(4,(ice_st->obj_name, "Candidate gathering complete in %u ms",
+	      ice_st->gather_stat.total_msec));
+
     ice_st->cb_called = PJ_TRUE;
     ice_st->state = PJ_ICE_STRANS_STATE_READY;
     if (ice_st->cb.on_ice_complete)
@@ -1568,6 +1652,9 @@ static pj_bool_t stun_on_status(pj_stun_sock *stun_sock,
 		    cand->status = PJ_SUCCESS;
 		}
 
+		if (op == PJ_STUN_SOCK_BINDING_OP)
+		    gather_done(ice_st, comp->comp_id, PJ_ICE_CAND_TYPE_SRFLX);
+
 		PJ_LOG(4,(comp->ice_st->obj_name, 
 			  "Comp %d: %s, "
 			  "srflx address is %s",
@@ -1725,6 +1812,8 @@ static void turn_on_state(pj_turn_sock *turn_sock, pj_turn_state_t old_state,
 	/* Set default candidate to relay */
 	comp->default_cand = cand - comp->cand_list;
 
+	gather_done(comp->ice_st, comp->comp_id, PJ_ICE_CAND_TYPE_RELAYED);
+
 	PJ_LOG(4,(comp->ice_st->obj_name, 
 		  "Comp %d: TURN allocation complete, relay address is %s",
 		  comp->comp_id, 
@@ -17,14 +17,17 @@ SAMPLES := auddemo \
 	   aviplay \
 	   aectest \
 	   aviplay \
+	   callstorm \
 	   confsample \
 	   encdec \
 	   httpdemo \
 	   icedemo \
+	   imstorm \
 	   jbsim \
 	   latency \
 	   level \
 	   mix \
+	   natcache \
 	   pjsip-perf \
 	   pcaputil \
 	   playfile \
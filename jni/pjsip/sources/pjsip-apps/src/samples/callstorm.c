@@ -0,0 +1,884 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * \page page_pjsip_sample_callstorm_c Samples: Call-storm Load Generator
+ *
+ * <b>callstorm</b> measures how many full pjsua calls per second the
+ * library can set up and tear down. It runs both the caller (UAC) and the
+ * callee (UAS) in a single process: SIP messages are carried by the
+ * loopback SIP transport (sip_transport_loop.c), and every call's media
+ * runs over its own loopback media transport (transport_loop.c), so the
+ * complete INVITE, SDP negotiation, stream creation, re-INVITE and BYE
+ * path is exercised without touching the network or a sound card (the
+ * null audio device is used). Alternatively the calls may use pjsua's own
+ * UDP or ICE media transports, to measure their cost as well.
+ *
+ * The program launches calls at the requested rate (calls per second)
+ * while keeping at most the requested number of UAC/UAS pairs active,
+ * holds every call for the requested duration, optionally sends
+ * re-INVITEs during the call, and then hangs up. At the end it reports:
+ *  - the latency distribution of each call phase (setup, media
+ *    activation, re-INVITE and teardown),
+ *  - CPU time per call (Linux only),
+ *  - pool memory per active call, as seen by pjsua's caching pool, and
+ *  - open sockets per active call (Linux only).
+ *
+ * Note that the number of concurrent pairs is limited by PJSUA_MAX_CALLS,
+ * since every pair occupies two pjsua call slots.
+ *
+ * This file is pjsip-apps/src/samples/callstorm.c
+ *
+ * \includelineno callstorm.c
+ */
+
+#include <pjsua-lib/pjsua.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(PJ_LINUX) && PJ_LINUX!=0
+#   include <sys/time.h>
+#   include <sys/resource.h>
+#   include <dirent.h>
+#endif
+
+#define THIS_FILE	"callstorm.c"
+
+/* Maximum number of latency samples kept per phase for percentiles */
+#define MAX_SAMPLES	100000
+
+/* Base port advertised by the loopback media transports */
+#define LOOP_MEDIA_PORT	4000
+
+
+/* Call phases being measured */
+enum phase
+{
+    PH_SETUP,	    /* make_call() until UAC is CONFIRMED	    */
+    PH_MEDIA,	    /* make_call() until UAC media is ACTIVE	    */
+    PH_REINVITE,    /* re-INVITE sent until media is updated	    */
+    PH_TEARDOWN,    /* hangup() until UAC is DISCONNECTED	    */
+    PH_COUNT
+};
+
+static const char *phase_names[PH_COUNT] =
+{
+    "setup", "media", "re-INVITE", "teardown"
+};
+
+
+/* Media transport used by the calls */
+enum media_tp
+{
+    MEDIA_LOOP,	    /* Loopback media transport, no sockets	    */
+    MEDIA_UDP,	    /* pjsua's UDP media transport		    */
+    MEDIA_ICE	    /* pjsua's ICE media transport		    */
+};
+
+
+/* Latency statistic for one phase, in microseconds */
+struct phase_stat
+{
+    unsigned	    cnt;
+    unsigned	    min;
+    unsigned	    max;
+    pj_uint64_t	    sum;
+    unsigned	    sample_cnt;
+    unsigned	   *samples;
+};
+
+
+/* One UAC/UAS pair, identified by the UAC call */
+struct pair
+{
+    pj_bool_t	    in_use;
+    pjsua_call_id   uac;
+    pj_bool_t	    confirmed;
+    pj_bool_t	    media_active;
+    pj_bool_t	    reinv_pending;
+    pj_bool_t	    hangup_sent;
+    unsigned	    reinv_cnt;
+    pj_timestamp    t_start;
+    pj_timestamp    t_confirmed;
+    pj_timestamp    t_reinv;
+    pj_timestamp    t_hangup;
+};
+
+
+static struct app
+{
+    /* Options */
+    unsigned	    call_count;
+    unsigned	    concurrency;
+    unsigned	    cps;
+    unsigned	    hold_msec;
+    unsigned	    reinv_rate;
+    unsigned	    thread_cnt;
+    unsigned	    sip_delay;
+    pj_bool_t	    connect_media;
+    enum media_tp   media_tp;
+    pj_bool_t	    rtcp_mux;
+    int		    log_level;
+
+    /* Runtime */
+    pj_pool_t	   *pool;
+    pj_mutex_t	   *mutex;
+    pjsua_acc_id    acc_id;
+    char	    dst_uri[80];
+    struct pair	   *pairs;
+    unsigned	    started;
+    unsigned	    completed;
+    unsigned	    failed;
+    unsigned	    active;
+    unsigned	    peak_active;
+    unsigned	    incoming;
+    pj_size_t	    base_mem;
+    pj_size_t	    peak_mem;
+    unsigned	    base_fd;
+    unsigned	    peak_fd;
+
+    struct phase_stat stat[PH_COUNT];
+} app;
+
+
+static void app_perror(const char *sender, const char *title,
+		       pj_status_t status)
+{
+    char errmsg[PJ_ERR_MSG_SIZE];
+
+    pj_strerror(status, errmsg, sizeof(errmsg));
+    PJ_LOG(1,(sender, "%s: %s [code=%d]", title, errmsg, status));
+}
+
+
+/* Record one latency sample. Must be called with app.mutex held. */
+static void add_sample(enum phase ph, const pj_timestamp *start)
+{
+    struct phase_stat *st = &app.stat[ph];
+    pj_timestamp now;
+    unsigned usec;
+
+    pj_get_timestamp(&now);
+    usec = pj_elapsed_usec(start, &now);
+
+    if (st->cnt == 0 || usec < st->min)
+	st->min = usec;
+    if (usec > st->max)
+	st->max = usec;
+    st->sum += usec;
+    ++st->cnt;
+
+    if (st->sample_cnt < MAX_SAMPLES)
+	st->samples[st->sample_cnt++] = usec;
+}
+
+
+/* Release a pair. Must be called with app.mutex held. */
+static void release_pair(struct pair *p, pj_bool_t success)
+{
+    if (!p->in_use)
+	return;
+
+    if (success)
+	++app.completed;
+    else
+	++app.failed;
+
+    p->in_use = PJ_FALSE;
+    --app.active;
+}
+
+
+/* Sample the memory usage of pjsua's caching pool */
+static void sample_memory(void)
+{
+    pj_caching_pool *cp = (pj_caching_pool*) pjsua_get_pool_factory();
+
+    if (cp->used_size > app.peak_mem)
+	app.peak_mem = cp->used_size;
+}
+
+
+/* Count open file descriptors (sockets, mostly) of this process */
+static unsigned count_fds(void)
+{
+#if defined(PJ_LINUX) && PJ_LINUX!=0
+    DIR *dir;
+    unsigned cnt = 0;
+
+    dir = opendir("/proc/self/fd");
+    if (!dir)
+	return 0;
+
+    while (readdir(dir) != NULL)
+	++cnt;
+
+    closedir(dir);
+    return cnt;
+#else
+    return 0;
+#endif
+}
+
+
+/* Sample the number of open sockets */
+static void sample_fds(void)
+{
+    unsigned cnt = count_fds();
+
+    if (cnt > app.peak_fd)
+	app.peak_fd = cnt;
+}
+
+
+/* Replace the media transport created by pjsua with a loopback one */
+static pjmedia_transport* on_create_media_transport(pjsua_call_id call_id,
+						    unsigned media_idx,
+						    pjmedia_transport *base_tp,
+						    unsigned flags)
+{
+    pjmedia_loop_tp_setting opt;
+    pjmedia_transport *tp;
+    pj_status_t status;
+
+    PJ_UNUSED_ARG(flags);
+
+    if (app.media_tp != MEDIA_LOOP)
+	return base_tp;
+
+    pjmedia_loop_tp_setting_default(&opt);
+    opt.addr = pj_str("127.0.0.1");
+    opt.port = LOOP_MEDIA_PORT + (call_id * 8 + media_idx) * 2;
+
+    status = pjmedia_transport_loop_create2(pjsua_get_pjmedia_endpt(),
+					    &opt, &tp);
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "Error creating loop media transport", status);
+	return base_tp;
+    }
+
+    /* pjsua only closes the transport we return, so close the original */
+    pjmedia_transport_close(base_tp);
+    return tp;
+}
+
+
+/* Automatically answer incoming calls (the UAS side) */
+static void on_incoming_call(pjsua_acc_id acc_id, pjsua_call_id call_id,
+			     pjsip_rx_data *rdata)
+{
+    PJ_UNUSED_ARG(acc_id);
+    PJ_UNUSED_ARG(rdata);
+
+    pj_mutex_lock(app.mutex);
+    ++app.incoming;
+    pj_mutex_unlock(app.mutex);
+
+    pjsua_call_answer(call_id, 200, NULL, NULL);
+}
+
+
+/* Track the UAC call state */
+static void on_call_state(pjsua_call_id call_id, pjsip_event *e)
+{
+    struct pair *p = (struct pair*) pjsua_call_get_user_data(call_id);
+    pjsua_call_info ci;
+
+    PJ_UNUSED_ARG(e);
+
+    /* Nothing to measure for the UAS side */
+    if (!p)
+	return;
+
+    pjsua_call_get_info(call_id, &ci);
+
+    pj_mutex_lock(app.mutex);
+
+    if (!p->in_use) {
+	pj_mutex_unlock(app.mutex);
+	return;
+    }
+
+    p->uac = call_id;
+    if (ci.state == PJSIP_INV_STATE_CONFIRMED && !p->confirmed) {
+	p->confirmed = PJ_TRUE;
+	pj_get_timestamp(&p->t_confirmed);
+	add_sample(PH_SETUP, &p->t_start);
+
+    } else if (ci.state == PJSIP_INV_STATE_DISCONNECTED) {
+	pj_bool_t success = p->hangup_sent && p->confirmed;
+
+	if (p->hangup_sent)
+	    add_sample(PH_TEARDOWN, &p->t_hangup);
+	else
+	    PJ_LOG(3,(THIS_FILE, "Call %d disconnected prematurely "
+		      "(%d/%.*s)", call_id, ci.last_status,
+		      (int)ci.last_status_text.slen,
+		      ci.last_status_text.ptr));
+
+	release_pair(p, success);
+    }
+
+    pj_mutex_unlock(app.mutex);
+}
+
+
+/* Track media activation and re-INVITE completion */
+static void on_call_media_state(pjsua_call_id call_id)
+{
+    struct pair *p = (struct pair*) pjsua_call_get_user_data(call_id);
+    pjsua_call_info ci;
+
+    pjsua_call_get_info(call_id, &ci);
+
+    if (app.connect_media && ci.media_status == PJSUA_CALL_MEDIA_ACTIVE &&
+	ci.conf_slot != PJSUA_INVALID_ID)
+    {
+	/* Route the call through the bridge so that the streams encode
+	 * and decode audio as they would in a real call.
+	 */
+	pjsua_conf_connect(ci.conf_slot, 0);
+	pjsua_conf_connect(0, ci.conf_slot);
+    }
+
+    if (!p)
+	return;
+
+    pj_mutex_lock(app.mutex);
+
+    if (p->in_use) {
+	p->uac = call_id;
+	if (!p->media_active && ci.media_status == PJSUA_CALL_MEDIA_ACTIVE) {
+	    p->media_active = PJ_TRUE;
+	    add_sample(PH_MEDIA, &p->t_start);
+	} else if (p->reinv_pending) {
+	    p->reinv_pending = PJ_FALSE;
+	    ++p->reinv_cnt;
+	    add_sample(PH_REINVITE, &p->t_reinv);
+	}
+    }
+
+    pj_mutex_unlock(app.mutex);
+}
+
+
+/* Start a new call on a free pair */
+static pj_status_t launch_call(void)
+{
+    struct pair *p = NULL;
+    pj_str_t dst = pj_str(app.dst_uri);
+    pjsua_call_id call_id;
+    pj_status_t status;
+    unsigned i;
+
+    pj_mutex_lock(app.mutex);
+    for (i=0; i<app.concurrency; ++i) {
+	if (!app.pairs[i].in_use) {
+	    p = &app.pairs[i];
+	    break;
+	}
+    }
+    if (!p) {
+	pj_mutex_unlock(app.mutex);
+	return PJ_ETOOMANY;
+    }
+
+    pj_bzero(p, sizeof(*p));
+    p->in_use = PJ_TRUE;
+    p->uac = PJSUA_INVALID_ID;
+    pj_get_timestamp(&p->t_start);
+    ++app.started;
+    ++app.active;
+    if (app.active > app.peak_active)
+	app.peak_active = app.active;
+    pj_mutex_unlock(app.mutex);
+
+    /* Callbacks may run before make_call() returns, so the pair is given
+     * as the call's user data and the callbacks fill in p->uac too.
+     */
+    status = pjsua_call_make_call(app.acc_id, &dst, NULL, p, NULL,
+				  &call_id);
+
+    pj_mutex_lock(app.mutex);
+    if (status != PJ_SUCCESS)
+	release_pair(p, PJ_FALSE);
+    else if (p->in_use)
+	p->uac = call_id;
+    pj_mutex_unlock(app.mutex);
+
+    return status;
+}
+
+
+/* Send re-INVITE or hangup on calls that are due */
+static void service_calls(void)
+{
+    enum { ACT_NONE, ACT_REINVITE, ACT_HANGUP };
+    pj_timestamp now;
+    unsigned i;
+
+    pj_get_timestamp(&now);
+
+    for (i=0; i<app.concurrency; ++i) {
+	struct pair *p = &app.pairs[i];
+	pjsua_call_id call_id = PJSUA_INVALID_ID;
+	int action = ACT_NONE;
+	unsigned elapsed;
+
+	pj_mutex_lock(app.mutex);
+	if (p->in_use && p->uac != PJSUA_INVALID_ID &&
+	    p->confirmed && p->media_active &&
+	    !p->hangup_sent && !p->reinv_pending)
+	{
+	    elapsed = pj_elapsed_msec(&p->t_confirmed, &now);
+	    call_id = p->uac;
+
+	    if (elapsed >= app.hold_msec) {
+		action = ACT_HANGUP;
+		p->hangup_sent = PJ_TRUE;
+		pj_get_timestamp(&p->t_hangup);
+	    } else if (app.reinv_rate &&
+		       elapsed >= (p->reinv_cnt+1) * 60000 / app.reinv_rate)
+	    {
+		action = ACT_REINVITE;
+		p->reinv_pending = PJ_TRUE;
+		pj_get_timestamp(&p->t_reinv);
+	    }
+	}
+	pj_mutex_unlock(app.mutex);
+
+	if (action == ACT_HANGUP) {
+	    pjsua_call_hangup(call_id, 0, NULL, NULL);
+	} else if (action == ACT_REINVITE) {
+	    pj_status_t status;
+
+	    status = pjsua_call_reinvite(call_id, 0, NULL);
+	    if (status != PJ_SUCCESS) {
+		pj_mutex_lock(app.mutex);
+		p->reinv_pending = PJ_FALSE;
+		++p->reinv_cnt;
+		pj_mutex_unlock(app.mutex);
+	    }
+	}
+    }
+}
+
+
+static int cmp_unsigned(const void *a, const void *b)
+{
+    unsigned ua = *(const unsigned*)a, ub = *(const unsigned*)b;
+    return ua < ub ? -1 : (ua > ub ? 1 : 0);
+}
+
+
+static unsigned percentile(const struct phase_stat *st, unsigned pct)
+{
+    unsigned idx;
+
+    if (st->sample_cnt == 0)
+	return 0;
+
+    idx = (st->sample_cnt - 1) * pct / 100;
+    return st->samples[idx];
+}
+
+
+static void print_report(unsigned elapsed_msec, pj_uint64_t cpu_usec)
+{
+    unsigned i;
+
+    printf("\n"
+	   "Calls: %u started, %u completed, %u failed, %u incoming\n"
+	   "Elapsed: %u.%03u s, %.1f calls/s, peak %u concurrent pairs\n\n",
+	   app.started, app.completed, app.failed, app.incoming,
+	   elapsed_msec / 1000, elapsed_msec % 1000,
+	   elapsed_msec ? app.completed * 1000.0 / elapsed_msec : 0.0,
+	   app.peak_active);
+
+    printf("Phase latency (usec):\n"
+	   "  %-10s %8s %8s %8s %8s %8s %8s %8s\n",
+	   "phase", "count", "min", "avg", "p50", "p95", "p99", "max");
+
+    for (i=0; i<PH_COUNT; ++i) {
+	struct phase_stat *st = &app.stat[i];
+
+	qsort(st->samples, st->sample_cnt, sizeof(unsigned), &cmp_unsigned);
+	printf("  %-10s %8u %8u %8u %8u %8u %8u %8u\n",
+	       phase_names[i], st->cnt, st->min,
+	       st->cnt ? (unsigned)(st->sum / st->cnt) : 0,
+	       percentile(st, 50), percentile(st, 95), percentile(st, 99),
+	       st->max);
+    }
+
+    printf("\nResources:\n");
+    if (cpu_usec && app.completed) {
+	printf("  CPU per call        : %u usec\n",
+	       (unsigned)(cpu_usec / app.completed));
+    }
+    if (app.peak_active) {
+	/* Every pair holds two calls, the UAC and the UAS */
+	printf("  Pool memory per call: %u bytes (peak %u KB, base %u KB)\n",
+	       (unsigned)((app.peak_mem - app.base_mem) /
+			  (app.peak_active * 2)),
+	       (unsigned)(app.peak_mem / 1024),
+	       (unsigned)(app.base_mem / 1024));
+    }
+    if (app.peak_active && app.peak_fd) {
+	printf("  Sockets per call    : %.1f (peak %u fds, base %u fds)\n",
+	       (app.peak_fd - app.base_fd) / (app.peak_active * 2.0),
+	       app.peak_fd, app.base_fd);
+    }
+}
+
+
+static pj_uint64_t get_cpu_usec(void)
+{
+#if defined(PJ_LINUX) && PJ_LINUX!=0
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+	return 0;
+
+    return (pj_uint64_t)ru.ru_utime.tv_sec * 1000000 + ru.ru_utime.tv_usec +
+	   (pj_uint64_t)ru.ru_stime.tv_sec * 1000000 + ru.ru_stime.tv_usec;
+#else
+    return 0;
+#endif
+}
+
+
+static void usage(void)
+{
+    printf(
+	"Usage:\n"
+	"   callstorm [OPTIONS]\n"
+	"\n"
+	"Options:\n"
+	"   --count=N, -n           Total number of calls [default: 100]\n"
+	"   --concurrency=N, -c     Maximum concurrent UAC/UAS pairs\n"
+	"                           [default and maximum: %d]\n"
+	"   --cps=N, -r             Calls to start per second [default: 10]\n"
+	"   --hold=MS, -d           Call hold time in msec [default: 1000]\n"
+	"   --reinvite-rate=N       re-INVITEs per call per minute [default: 0]\n"
+	"   --thread-count=N        Number of SIP worker threads [default: 1]\n"
+	"   --sip-delay=MS          SIP loop transport delivery delay, minimum 1\n"
+	"                           [default: 1]\n"
+	"   --no-media-connect      Don't connect calls to the conference bridge\n"
+	"   --media=TP              Media transport: loop, udp or ice\n"
+	"                           [default: loop]\n"
+	"   --no-rtcp-mux           Don't offer RTCP multiplexing (RFC 5761)\n"
+	"   --verbose, -v           Verbose logging (may be repeated)\n"
+	"   --help, -h              Display this screen\n",
+	PJSUA_MAX_CALLS / 2);
+}
+
+
+static int my_atoi(const char *s)
+{
+    pj_str_t ss = pj_str((char*)s);
+    return pj_strtoul(&ss);
+}
+
+
+static pj_status_t init_options(int argc, char *argv[])
+{
+    enum { OPT_REINVITE_RATE = 1, OPT_THREAD_COUNT, OPT_SIP_DELAY,
+	   OPT_NO_MEDIA_CONNECT, OPT_MEDIA, OPT_NO_RTCP_MUX };
+    struct pj_getopt_option long_options[] = {
+	{ "count",	    1, 0, 'n' },
+	{ "concurrency",    1, 0, 'c' },
+	{ "cps",	    1, 0, 'r' },
+	{ "hold",	    1, 0, 'd' },
+	{ "reinvite-rate",  1, 0, OPT_REINVITE_RATE },
+	{ "thread-count",   1, 0, OPT_THREAD_COUNT },
+	{ "sip-delay",	    1, 0, OPT_SIP_DELAY },
+	{ "no-media-connect",0,0, OPT_NO_MEDIA_CONNECT },
+	{ "media",	    1, 0, OPT_MEDIA },
+	{ "no-rtcp-mux",    0, 0, OPT_NO_RTCP_MUX },
+	{ "verbose",	    0, 0, 'v' },
+	{ "help",	    0, 0, 'h' },
+	{ NULL, 0, 0, 0 },
+    };
+    int c;
+    int option_index;
+
+    app.call_count = 100;
+    app.concurrency = PJSUA_MAX_CALLS / 2;
+    app.cps = 10;
+    app.hold_msec = 1000;
+    app.thread_cnt = 1;
+    app.sip_delay = 1;
+    app.connect_media = PJ_TRUE;
+    app.media_tp = MEDIA_LOOP;
+    app.rtcp_mux = PJ_TRUE;
+    app.log_level = 1;
+
+    pj_optind = 0;
+    while((c=pj_getopt_long(argc,argv, "n:c:r:d:vh",
+			    long_options, &option_index))!=-1)
+    {
+	switch (c) {
+	case 'n':
+	    app.call_count = my_atoi(pj_optarg);
+	    break;
+
+	case 'c':
+	    app.concurrency = my_atoi(pj_optarg);
+	    if (app.concurrency < 1 || app.concurrency > PJSUA_MAX_CALLS/2) {
+		PJ_LOG(1,(THIS_FILE, "Invalid --concurrency %s (max %d)",
+			  pj_optarg, PJSUA_MAX_CALLS/2));
+		return -1;
+	    }
+	    break;
+
+	case 'r':
+	    app.cps = my_atoi(pj_optarg);
+	    if (app.cps < 1) {
+		PJ_LOG(1,(THIS_FILE, "Invalid --cps %s", pj_optarg));
+		return -1;
+	    }
+	    break;
+
+	case 'd':
+	    app.hold_msec = my_atoi(pj_optarg);
+	    break;
+
+	case OPT_REINVITE_RATE:
+	    app.reinv_rate = my_atoi(pj_optarg);
+	    break;
+
+	case OPT_THREAD_COUNT:
+	    app.thread_cnt = my_atoi(pj_optarg);
+	    if (app.thread_cnt < 1 || app.thread_cnt > 16) {
+		PJ_LOG(1,(THIS_FILE, "Invalid --thread-count %s", pj_optarg));
+		return -1;
+	    }
+	    break;
+
+	case OPT_SIP_DELAY:
+	    app.sip_delay = my_atoi(pj_optarg);
+	    if (app.sip_delay < 1) {
+		PJ_LOG(1,(THIS_FILE, "Invalid --sip-delay %s", pj_optarg));
+		return -1;
+	    }
+	    break;
+
+	case OPT_NO_MEDIA_CONNECT:
+	    app.connect_media = PJ_FALSE;
+	    break;
+
+	case OPT_MEDIA:
+	    if (pj_ansi_stricmp(pj_optarg, "loop") == 0) {
+		app.media_tp = MEDIA_LOOP;
+	    } else if (pj_ansi_stricmp(pj_optarg, "udp") == 0) {
+		app.media_tp = MEDIA_UDP;
+	    } else if (pj_ansi_stricmp(pj_optarg, "ice") == 0) {
+		app.media_tp = MEDIA_ICE;
+	    } else {
+		PJ_LOG(1,(THIS_FILE, "Invalid --media %s", pj_optarg));
+		return -1;
+	    }
+	    break;
+
+	case OPT_NO_RTCP_MUX:
+	    app.rtcp_mux = PJ_FALSE;
+	    break;
+
+	case 'v':
+	    app.log_level++;
+	    break;
+
+	case 'h':
+	    usage();
+	    return -1;
+
+	default:
+	    PJ_LOG(1,(THIS_FILE, "Invalid argument. Use --help to see help"));
+	    return -1;
+	}
+    }
+
+    return PJ_SUCCESS;
+}
+
+
+static pj_status_t init_stack(void)
+{
+    pjsua_config cfg;
+    pjsua_logging_config log_cfg;
+    pjsua_media_config med_cfg;
+    pjsip_transport *tp;
+    pjsua_transport_id tid;
+    unsigned i;
+    pj_status_t status;
+
+    status = pjsua_create();
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "pjsua_create() error", status);
+	return status;
+    }
+
+    pjsua_config_default(&cfg);
+    cfg.max_calls = PJSUA_MAX_CALLS;
+    cfg.thread_cnt = app.thread_cnt;
+    cfg.cb.on_incoming_call = &on_incoming_call;
+    cfg.cb.on_call_state = &on_call_state;
+    cfg.cb.on_call_media_state = &on_call_media_state;
+    cfg.cb.on_create_media_transport = &on_create_media_transport;
+
+    pjsua_logging_config_default(&log_cfg);
+    log_cfg.console_level = app.log_level;
+    log_cfg.level = app.log_level;
+
+    pjsua_media_config_default(&med_cfg);
+    med_cfg.ec_tail_len = 0;
+    med_cfg.enable_ice = (app.media_tp == MEDIA_ICE);
+    med_cfg.enable_rtcp_mux = app.rtcp_mux;
+
+    status = pjsua_init(&cfg, &log_cfg, &med_cfg);
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "pjsua_init() error", status);
+	return status;
+    }
+
+    /* SIP goes over the loopback transport */
+    status = pjsip_loop_start(pjsua_get_pjsip_endpt(), &tp);
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "Error starting SIP loop transport", status);
+	return status;
+    }
+
+    /* Messages must not be delivered synchronously from within the send
+     * path, otherwise the UAS response would reach the UAC transaction
+     * before it has even left the Null state.
+     */
+    pjsip_loop_set_recv_delay(tp, app.sip_delay, NULL);
+
+    status = pjsua_transport_register(tp, &tid);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    status = pjsua_acc_add_local(tid, PJ_TRUE, &app.acc_id);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    pj_ansi_snprintf(app.dst_uri, sizeof(app.dst_uri),
+		     "sip:storm@%.*s:%d;transport=loop-dgram",
+		     (int)tp->local_name.host.slen, tp->local_name.host.ptr,
+		     tp->local_name.port);
+
+    status = pjsua_start();
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "pjsua_start() error", status);
+	return status;
+    }
+
+    /* Headless: run the bridge from the null audio device */
+    status = pjsua_set_null_snd_dev();
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "Error setting null sound device", status);
+	return status;
+    }
+
+    app.pool = pjsua_pool_create("callstorm", 1000, 1000);
+    status = pj_mutex_create_simple(app.pool, "callstorm", &app.mutex);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    app.pairs = (struct pair*)
+		pj_pool_calloc(app.pool, app.concurrency, sizeof(struct pair));
+    for (i=0; i<PH_COUNT; ++i) {
+	app.stat[i].samples = (unsigned*)
+			      pj_pool_alloc(app.pool,
+					    MAX_SAMPLES * sizeof(unsigned));
+    }
+
+    return PJ_SUCCESS;
+}
+
+
+int main(int argc, char *argv[])
+{
+    pj_timestamp t_begin, now;
+    pj_uint64_t cpu_begin, cpu_end;
+    unsigned elapsed, due;
+    pj_status_t status;
+
+    if (init_options(argc, argv) != PJ_SUCCESS)
+	return 1;
+
+    status = init_stack();
+    if (status != PJ_SUCCESS) {
+	pjsua_destroy();
+	return 1;
+    }
+
+    PJ_LOG(1,(THIS_FILE, "Starting %u calls at %u cps, %u concurrent, "
+	      "hold %u ms, %u re-INVITE/min to %s", app.call_count, app.cps,
+	      app.concurrency, app.hold_msec, app.reinv_rate, app.dst_uri));
+
+    app.base_mem = app.peak_mem =
+	((pj_caching_pool*)pjsua_get_pool_factory())->used_size;
+    app.base_fd = app.peak_fd = count_fds();
+    cpu_begin = get_cpu_usec();
+    pj_get_timestamp(&t_begin);
+
+    for (;;) {
+	pj_bool_t done;
+
+	pj_get_timestamp(&now);
+	elapsed = pj_elapsed_msec(&t_begin, &now);
+
+	/* Launch calls that are due, within the concurrency limit */
+	due = (unsigned)((pj_uint64_t)elapsed * app.cps / 1000) + 1;
+	if (due > app.call_count)
+	    due = app.call_count;
+	while (app.started < due && app.active < app.concurrency) {
+	    status = launch_call();
+	    if (status != PJ_SUCCESS) {
+		app_perror(THIS_FILE, "Error making call", status);
+		break;
+	    }
+	}
+
+	service_calls();
+	sample_memory();
+	sample_fds();
+
+	pj_mutex_lock(app.mutex);
+	done = (app.started >= app.call_count && app.active == 0);
+	pj_mutex_unlock(app.mutex);
+
+	if (done)
+	    break;
+
+	pj_thread_sleep(1);
+    }
+
+    pj_get_timestamp(&now);
+    elapsed = pj_elapsed_msec(&t_begin, &now);
+    cpu_end = get_cpu_usec();
+
+    print_report(elapsed, cpu_end - cpu_begin);
+
+    pjsua_destroy();
+    return app.failed ? 1 : 0;
+}
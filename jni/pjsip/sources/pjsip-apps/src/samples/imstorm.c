@@ -0,0 +1,498 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * \page page_pjsip_sample_imstorm_c Samples: Instant Messaging Load Generator
+ *
+ * <b>imstorm</b> measures the cost of pjsua's instant messaging outside
+ * dialog. Like callstorm, it runs the sender and the receiving UAS in a
+ * single process over the loopback SIP transport (sip_transport_loop.c),
+ * so no network is involved. Two tests are run:
+ *  - <b>throughput</b>: the requested number of MESSAGE requests are
+ *    sent to a set of remote URIs as fast as pjsua accepts them, and the
+ *    rate of delivered messages is reported.
+ *  - <b>typing</b>: a chatty client is simulated, which calls
+ *    #pjsua_im_typing() on every keystroke and sends the message after a
+ *    number of keystrokes. The number of SIP packets (requests and
+ *    responses) carrying MESSAGE per 1,000 keystrokes is reported.
+ *
+ * With <tt>--raw</tt>, typing indications are sent with an (empty)
+ * message data, which bypasses the coalescing of the IM session layer and
+ * shows the cost of sending each indication as its own transaction.
+ *
+ * This file is pjsip-apps/src/samples/imstorm.c
+ *
+ * \includelineno imstorm.c
+ */
+
+#include <pjsua-lib/pjsua.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define THIS_FILE	"imstorm.c"
+
+/* Maximum number of remote URIs used by the throughput test */
+#define MAX_PEERS	64
+
+
+static struct app
+{
+    /* Options */
+    unsigned	    msg_count;
+    unsigned	    peer_cnt;
+    unsigned	    keystrokes;
+    unsigned	    msg_len;
+    unsigned	    key_interval;
+    unsigned	    sip_delay;
+    pj_bool_t	    raw;
+    int		    log_level;
+
+    /* Runtime */
+    pj_mutex_t	   *mutex;
+    pjsua_acc_id    acc_id;
+    char	    dst_uri[MAX_PEERS][80];
+    unsigned	    status_cnt;
+    unsigned	    failed;
+    unsigned	    tx_req;
+    unsigned	    tx_res;
+} app;
+
+
+static void app_perror(const char *sender, const char *title,
+		       pj_status_t status)
+{
+    char errmsg[PJ_ERR_MSG_SIZE];
+
+    pj_strerror(status, errmsg, sizeof(errmsg));
+    PJ_LOG(1,(sender, "%s: %s [code=%d]", title, errmsg, status));
+}
+
+
+/* Count MESSAGE requests and responses as they are transmitted */
+static pj_status_t on_tx_request(pjsip_tx_data *tdata)
+{
+    if (pjsip_method_cmp(&tdata->msg->line.req.method,
+			 &pjsip_message_method) == 0)
+    {
+	pj_mutex_lock(app.mutex);
+	++app.tx_req;
+	pj_mutex_unlock(app.mutex);
+    }
+    return PJ_SUCCESS;
+}
+
+static pj_status_t on_tx_response(pjsip_tx_data *tdata)
+{
+    pjsip_cseq_hdr *cseq = PJSIP_MSG_CSEQ_HDR(tdata->msg);
+
+    if (cseq && pjsip_method_cmp(&cseq->method, &pjsip_message_method)==0) {
+	pj_mutex_lock(app.mutex);
+	++app.tx_res;
+	pj_mutex_unlock(app.mutex);
+    }
+    return PJ_SUCCESS;
+}
+
+static pjsip_module mod_counter =
+{
+    NULL, NULL,				/* prev, next.		*/
+    { "mod-imstorm-counter", 19 },	/* Name.		*/
+    -1,					/* Id			*/
+    PJSIP_MOD_PRIORITY_TRANSPORT_LAYER-1,/* Priority		*/
+    NULL,				/* load()		*/
+    NULL,				/* start()		*/
+    NULL,				/* stop()		*/
+    NULL,				/* unload()		*/
+    NULL,				/* on_rx_request()	*/
+    NULL,				/* on_rx_response()	*/
+    &on_tx_request,			/* on_tx_request.	*/
+    &on_tx_response,			/* on_tx_response()	*/
+    NULL,				/* on_tsx_state()	*/
+};
+
+
+/* Delivery report of an outgoing MESSAGE */
+static void on_pager_status(pjsua_call_id call_id,
+			    const pj_str_t *to,
+			    const pj_str_t *body,
+			    void *user_data,
+			    pjsip_status_code status,
+			    const pj_str_t *reason)
+{
+    PJ_UNUSED_ARG(call_id);
+    PJ_UNUSED_ARG(to);
+    PJ_UNUSED_ARG(body);
+    PJ_UNUSED_ARG(user_data);
+
+    pj_mutex_lock(app.mutex);
+    ++app.status_cnt;
+    if (status/100 != 2) {
+	++app.failed;
+	PJ_LOG(3,(THIS_FILE, "Message failed: %d/%.*s", status,
+		  (int)reason->slen, reason->ptr));
+    }
+    pj_mutex_unlock(app.mutex);
+}
+
+
+/* Reset packet counters */
+static void reset_counters(void)
+{
+    pj_mutex_lock(app.mutex);
+    app.status_cnt = app.failed = 0;
+    app.tx_req = app.tx_res = 0;
+    pj_mutex_unlock(app.mutex);
+}
+
+
+/* Wait until the given number of delivery reports have arrived and all
+ * outstanding typing indications are answered.
+ */
+static void wait_reports(unsigned cnt)
+{
+    for (;;) {
+	pj_bool_t done;
+
+	pj_mutex_lock(app.mutex);
+	done = (app.status_cnt >= cnt && app.tx_res >= app.tx_req);
+	pj_mutex_unlock(app.mutex);
+
+	if (done)
+	    break;
+	pj_thread_sleep(1);
+    }
+}
+
+
+/* Send a message, waiting while the IM session queue is full */
+static pj_status_t send_message(const char *uri, const char *text)
+{
+    pj_str_t to = pj_str((char*)uri);
+    pj_str_t body = pj_str((char*)text);
+    pj_status_t status;
+
+    for (;;) {
+	status = pjsua_im_send(app.acc_id, &to, NULL, &body, NULL, NULL);
+	if (status != PJ_ETOOMANY)
+	    return status;
+	pj_thread_sleep(1);
+    }
+}
+
+
+static void test_throughput(void)
+{
+    pj_timestamp t_begin, t_end;
+    unsigned i, msec;
+    char text[32];
+
+    reset_counters();
+    pj_get_timestamp(&t_begin);
+
+    for (i=0; i<app.msg_count; ++i) {
+	pj_status_t status;
+
+	pj_ansi_snprintf(text, sizeof(text), "Message %u", i);
+	status = send_message(app.dst_uri[i % app.peer_cnt], text);
+	if (status != PJ_SUCCESS) {
+	    app_perror(THIS_FILE, "Error sending message", status);
+	    pj_mutex_lock(app.mutex);
+	    ++app.status_cnt;
+	    ++app.failed;
+	    pj_mutex_unlock(app.mutex);
+	}
+    }
+
+    wait_reports(app.msg_count);
+
+    pj_get_timestamp(&t_end);
+    msec = pj_elapsed_msec(&t_begin, &t_end);
+    if (msec == 0)
+	msec = 1;
+
+    printf("Throughput: %u messages to %u URIs in %u ms\n",
+	   app.msg_count, app.peer_cnt, msec);
+    printf("  Messages per second : %u\n", app.msg_count * 1000 / msec);
+    printf("  Failed              : %u\n", app.failed);
+    printf("  MESSAGE packets     : %u requests, %u responses\n",
+	   app.tx_req, app.tx_res);
+}
+
+
+static void test_typing(void)
+{
+    pj_str_t to = pj_str(app.dst_uri[0]);
+    pjsua_msg_data msg_data;
+    unsigned i, msg_cnt = 0;
+
+    pjsua_msg_data_init(&msg_data);
+
+    reset_counters();
+
+    for (i=1; i<=app.keystrokes; ++i) {
+	pj_status_t status;
+
+	status = pjsua_im_typing(app.acc_id, &to, PJ_TRUE,
+				 app.raw ? &msg_data : NULL);
+	if (status != PJ_SUCCESS)
+	    app_perror(THIS_FILE, "Error sending typing indication", status);
+
+	if (i % app.msg_len == 0) {
+	    status = send_message(app.dst_uri[0], "Typed message");
+	    if (status != PJ_SUCCESS)
+		app_perror(THIS_FILE, "Error sending message", status);
+	    else
+		++msg_cnt;
+	}
+
+	pj_thread_sleep(app.key_interval);
+    }
+
+    wait_reports(msg_cnt);
+
+    printf("Typing: %u keystrokes, %u messages, %s indications\n",
+	   app.keystrokes, msg_cnt, app.raw ? "raw" : "coalesced");
+    printf("  MESSAGE packets     : %u requests, %u responses\n",
+	   app.tx_req, app.tx_res);
+    printf("  Packets per 1000 keystrokes: %u\n",
+	   (app.tx_req + app.tx_res) * 1000 / app.keystrokes);
+}
+
+
+static void usage(void)
+{
+    printf(
+	"Usage:\n"
+	"   imstorm [OPTIONS]\n"
+	"\n"
+	"Options:\n"
+	"   --count=N, -n           Messages in the throughput test\n"
+	"                           [default: 1000]\n"
+	"   --peers=N, -p           Remote URIs in the throughput test\n"
+	"                           [default: 4, maximum: %d]\n"
+	"   --keystrokes=N, -k      Keystrokes in the typing test [default: 1000]\n"
+	"   --msg-len=N             Keystrokes per message [default: 40]\n"
+	"   --key-interval=MS       Delay between keystrokes [default: 5]\n"
+	"   --sip-delay=MS          SIP loop transport delivery delay, minimum 1\n"
+	"                           [default: 1]\n"
+	"   --raw                   Send every typing indication\n"
+	"   --verbose, -v           Verbose logging (may be repeated)\n"
+	"   --help, -h              Display this screen\n",
+	MAX_PEERS);
+}
+
+
+static int my_atoi(const char *s)
+{
+    pj_str_t ss = pj_str((char*)s);
+    return pj_strtoul(&ss);
+}
+
+
+static pj_status_t init_options(int argc, char *argv[])
+{
+    enum { OPT_MSG_LEN = 1, OPT_KEY_INTERVAL, OPT_SIP_DELAY, OPT_RAW };
+    struct pj_getopt_option long_options[] = {
+	{ "count",	    1, 0, 'n' },
+	{ "peers",	    1, 0, 'p' },
+	{ "keystrokes",	    1, 0, 'k' },
+	{ "msg-len",	    1, 0, OPT_MSG_LEN },
+	{ "key-interval",   1, 0, OPT_KEY_INTERVAL },
+	{ "sip-delay",	    1, 0, OPT_SIP_DELAY },
+	{ "raw",	    0, 0, OPT_RAW },
+	{ "verbose",	    0, 0, 'v' },
+	{ "help",	    0, 0, 'h' },
+	{ NULL, 0, 0, 0 },
+    };
+    int c;
+    int option_index;
+
+    app.msg_count = 1000;
+    app.peer_cnt = 4;
+    app.keystrokes = 1000;
+    app.msg_len = 40;
+    app.key_interval = 5;
+    app.sip_delay = 1;
+    app.log_level = 1;
+
+    pj_optind = 0;
+    while((c=pj_getopt_long(argc,argv, "n:p:k:vh",
+			    long_options, &option_index))!=-1)
+    {
+	switch (c) {
+	case 'n':
+	    app.msg_count = my_atoi(pj_optarg);
+	    break;
+
+	case 'p':
+	    app.peer_cnt = my_atoi(pj_optarg);
+	    if (app.peer_cnt < 1 || app.peer_cnt > MAX_PEERS) {
+		PJ_LOG(1,(THIS_FILE, "Invalid --peers %s", pj_optarg));
+		return -1;
+	    }
+	    break;
+
+	case 'k':
+	    app.keystrokes = my_atoi(pj_optarg);
+	    if (app.keystrokes < 1) {
+		PJ_LOG(1,(THIS_FILE, "Invalid --keystrokes %s", pj_optarg));
+		return -1;
+	    }
+	    break;
+
+	case OPT_MSG_LEN:
+	    app.msg_len = my_atoi(pj_optarg);
+	    if (app.msg_len < 1) {
+		PJ_LOG(1,(THIS_FILE, "Invalid --msg-len %s", pj_optarg));
+		return -1;
+	    }
+	    break;
+
+	case OPT_KEY_INTERVAL:
+	    app.key_interval = my_atoi(pj_optarg);
+	    break;
+
+	case OPT_SIP_DELAY:
+	    app.sip_delay = my_atoi(pj_optarg);
+	    if (app.sip_delay < 1) {
+		PJ_LOG(1,(THIS_FILE, "Invalid --sip-delay %s", pj_optarg));
+		return -1;
+	    }
+	    break;
+
+	case OPT_RAW:
+	    app.raw = PJ_TRUE;
+	    break;
+
+	case 'v':
+	    app.log_level++;
+	    break;
+
+	case 'h':
+	    usage();
+	    return -1;
+
+	default:
+	    PJ_LOG(1,(THIS_FILE, "Invalid argument. Use --help to see help"));
+	    return -1;
+	}
+    }
+
+    return PJ_SUCCESS;
+}
+
+
+static pj_status_t init_stack(void)
+{
+    pjsua_config cfg;
+    pjsua_logging_config log_cfg;
+    pjsua_media_config med_cfg;
+    pjsip_transport *tp;
+    pjsua_transport_id tid;
+    pj_pool_t *pool;
+    unsigned i;
+    pj_status_t status;
+
+    status = pjsua_create();
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "pjsua_create() error", status);
+	return status;
+    }
+
+    pjsua_config_default(&cfg);
+    cfg.cb.on_pager_status = &on_pager_status;
+
+    pjsua_logging_config_default(&log_cfg);
+    log_cfg.console_level = app.log_level;
+    log_cfg.level = app.log_level;
+
+    pjsua_media_config_default(&med_cfg);
+
+    status = pjsua_init(&cfg, &log_cfg, &med_cfg);
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "pjsua_init() error", status);
+	return status;
+    }
+
+    pool = pjsua_pool_create("imstorm", 1000, 1000);
+    status = pj_mutex_create_simple(pool, "imstorm", &app.mutex);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    status = pjsip_endpt_register_module(pjsua_get_pjsip_endpt(),
+					 &mod_counter);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    /* SIP goes over the loopback transport, with delayed delivery so that
+     * responses don't arrive from within the send path.
+     */
+    status = pjsip_loop_start(pjsua_get_pjsip_endpt(), &tp);
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "Error starting SIP loop transport", status);
+	return status;
+    }
+    pjsip_loop_set_recv_delay(tp, app.sip_delay, NULL);
+
+    status = pjsua_transport_register(tp, &tid);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    status = pjsua_acc_add_local(tid, PJ_TRUE, &app.acc_id);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    for (i=0; i<app.peer_cnt; ++i) {
+	pj_ansi_snprintf(app.dst_uri[i], sizeof(app.dst_uri[i]),
+			 "sip:im%u@%.*s:%d;transport=loop-dgram", i,
+			 (int)tp->local_name.host.slen, tp->local_name.host.ptr,
+			 tp->local_name.port);
+    }
+
+    status = pjsua_start();
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "pjsua_start() error", status);
+	return status;
+    }
+
+    return PJ_SUCCESS;
+}
+
+
+int main(int argc, char *argv[])
+{
+    pj_status_t status;
+
+    if (init_options(argc, argv) != PJ_SUCCESS)
+	return 1;
+
+    status = init_stack();
+    if (status != PJ_SUCCESS) {
+	pjsua_destroy();
+	return 1;
+    }
+
+    test_throughput();
+    test_typing();
+
+    pjsua_destroy();
+    return app.failed ? 1 : 0;
+}
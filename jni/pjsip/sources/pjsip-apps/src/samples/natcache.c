@@ -0,0 +1,474 @@
+/* $Id$ */
+/*
+ * Copyright (C) 2008-2011 Teluu Inc. (http://www.teluu.com)
+ * Copyright (C) 2003-2008 Benny Prijono <benny@prijono.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * \page page_pjsip_sample_natcache_c Samples: NAT Cache Startup Time
+ *
+ * <b>natcache</b> measures the time to the first call after pjsua is
+ * started, with and without the NAT cache (see \a nat_cache_file in
+ * #pjsua_config). The STUN server is a stand-in running in this process
+ * on the loopback interface, which answers every Binding request after
+ * the configured delay to simulate the round trip to a real server.
+ *
+ * pjsua is started the requested number of times. The cache file is
+ * removed before the first start, so that start resolves the STUN server
+ * and detects the NAT type as if the network was new. The following
+ * starts find the network in the cache. Each start is timed from
+ * #pjsua_create() until the call that pjsua makes to itself over UDP is
+ * confirmed, and the number of STUN requests the stand-in received in
+ * that time is reported.
+ *
+ * This file is pjsip-apps/src/samples/natcache.c
+ *
+ * \includelineno natcache.c
+ */
+
+#include <pjsua-lib/pjsua.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define THIS_FILE	"natcache.c"
+
+
+static struct app
+{
+    /* Options */
+    unsigned	    rtt;
+    unsigned	    runs;
+    const char	   *file;
+    int		    log_level;
+
+    /* STUN server stand-in */
+    pj_caching_pool cp;
+    pj_pool_t	   *pool;
+    pj_sock_t	    stun_sock;
+    pj_sockaddr_in  stun_addr;
+    pj_thread_t	   *stun_thread;
+    pj_bool_t	    stun_quit;
+    unsigned	    stun_req_cnt;
+
+    /* Runtime */
+    pj_bool_t	    confirmed;
+    pj_bool_t	    nat_detected;
+} app;
+
+
+static void app_perror(const char *sender, const char *title,
+		       pj_status_t status)
+{
+    char errmsg[PJ_ERR_MSG_SIZE];
+
+    pj_strerror(status, errmsg, sizeof(errmsg));
+    PJ_LOG(1,(sender, "%s: %s [code=%d]", title, errmsg, status));
+}
+
+
+/* Answer a STUN Binding request. Both MAPPED-ADDRESS and
+ * XOR-MAPPED-ADDRESS are returned, for the RFC 3489 client used by pjsua
+ * for its sockets, and CHANGED-ADDRESS is returned for NAT type
+ * detection. Since the stand-in answers the "change address" tests too,
+ * the NAT type is detected as open.
+ */
+static void stun_respond(pj_pool_t *pool, const pj_uint8_t *pkt,
+			 pj_size_t len, const pj_sockaddr_in *src)
+{
+    pj_stun_msg *req, *res;
+    pj_sockaddr_in changed;
+    pj_uint8_t out[512];
+    pj_size_t out_len;
+    pj_ssize_t sent;
+    pj_status_t status;
+
+    status = pj_stun_msg_decode(pool, pkt, len,
+				PJ_STUN_IS_DATAGRAM | PJ_STUN_CHECK_PACKET,
+				&req, NULL, NULL);
+    if (status != PJ_SUCCESS || req->hdr.type != PJ_STUN_BINDING_REQUEST)
+	return;
+
+    status = pj_stun_msg_create_response(pool, req, 0, NULL, &res);
+    if (status != PJ_SUCCESS)
+	return;
+
+    pj_memcpy(&changed, &app.stun_addr, sizeof(changed));
+    changed.sin_port = pj_htons((pj_uint16_t)(pj_ntohs(changed.sin_port)+1));
+
+    pj_stun_msg_add_sockaddr_attr(pool, res, PJ_STUN_ATTR_MAPPED_ADDR,
+				  PJ_FALSE, src, sizeof(*src));
+    pj_stun_msg_add_sockaddr_attr(pool, res, PJ_STUN_ATTR_XOR_MAPPED_ADDR,
+				  PJ_TRUE, src, sizeof(*src));
+    pj_stun_msg_add_sockaddr_attr(pool, res, PJ_STUN_ATTR_CHANGED_ADDR,
+				  PJ_FALSE, &changed, sizeof(changed));
+
+    status = pj_stun_msg_encode(res, out, sizeof(out), 0, NULL, &out_len);
+    if (status != PJ_SUCCESS)
+	return;
+
+    pj_thread_sleep(app.rtt);
+
+    sent = out_len;
+    pj_sock_sendto(app.stun_sock, out, &sent, 0, src, sizeof(*src));
+}
+
+
+static int stun_thread_proc(void *arg)
+{
+    PJ_UNUSED_ARG(arg);
+
+    while (!app.stun_quit) {
+	pj_fd_set_t rset;
+	pj_time_val timeout = { 0, 100 };
+	pj_uint8_t pkt[512];
+	pj_ssize_t len = sizeof(pkt);
+	pj_sockaddr_in src;
+	int src_len = sizeof(src);
+	pj_pool_t *pool;
+
+	PJ_FD_ZERO(&rset);
+	PJ_FD_SET(app.stun_sock, &rset);
+	if (pj_sock_select((int)app.stun_sock+1, &rset, NULL, NULL,
+			   &timeout) <= 0)
+	{
+	    continue;
+	}
+
+	if (pj_sock_recvfrom(app.stun_sock, pkt, &len, 0, &src,
+			     &src_len) != PJ_SUCCESS)
+	{
+	    continue;
+	}
+
+	++app.stun_req_cnt;
+
+	pool = pj_pool_create(&app.cp.factory, "stunsrv", 1000, 1000, NULL);
+	stun_respond(pool, pkt, len, &src);
+	pj_pool_release(pool);
+    }
+
+    return 0;
+}
+
+
+static pj_status_t stun_start(void)
+{
+    pj_str_t localhost = pj_str("127.0.0.1");
+    int addr_len = sizeof(app.stun_addr);
+    pj_status_t status;
+
+    pj_caching_pool_init(&app.cp, NULL, 0);
+    app.pool = pj_pool_create(&app.cp.factory, "natcache", 1000, 1000, NULL);
+
+    status = pj_sock_socket(pj_AF_INET(), pj_SOCK_DGRAM(), 0,
+			    &app.stun_sock);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    pj_sockaddr_in_init(&app.stun_addr, &localhost, 0);
+    status = pj_sock_bind(app.stun_sock, &app.stun_addr,
+			  sizeof(app.stun_addr));
+    if (status != PJ_SUCCESS)
+	return status;
+
+    status = pj_sock_getsockname(app.stun_sock, &app.stun_addr, &addr_len);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    return pj_thread_create(app.pool, "stunsrv", &stun_thread_proc, NULL,
+			    0, 0, &app.stun_thread);
+}
+
+
+static void stun_stop(void)
+{
+    if (app.stun_thread) {
+	app.stun_quit = PJ_TRUE;
+	pj_thread_join(app.stun_thread);
+	pj_thread_destroy(app.stun_thread);
+	app.stun_thread = NULL;
+    }
+    if (app.stun_sock != PJ_INVALID_SOCKET) {
+	pj_sock_close(app.stun_sock);
+	app.stun_sock = PJ_INVALID_SOCKET;
+    }
+    if (app.pool) {
+	pj_pool_release(app.pool);
+	app.pool = NULL;
+	pj_caching_pool_destroy(&app.cp);
+    }
+}
+
+
+/* Answer incoming calls */
+static void on_incoming_call(pjsua_acc_id acc_id, pjsua_call_id call_id,
+			     pjsip_rx_data *rdata)
+{
+    PJ_UNUSED_ARG(acc_id);
+    PJ_UNUSED_ARG(rdata);
+
+    pjsua_call_answer(call_id, 200, NULL, NULL);
+}
+
+
+static void on_call_state(pjsua_call_id call_id, pjsip_event *e)
+{
+    pjsua_call_info ci;
+
+    PJ_UNUSED_ARG(e);
+
+    pjsua_call_get_info(call_id, &ci);
+    if (ci.role == PJSIP_ROLE_UAC && ci.state == PJSIP_INV_STATE_CONFIRMED)
+	app.confirmed = PJ_TRUE;
+}
+
+
+static void on_nat_detect(const pj_stun_nat_detect_result *res)
+{
+    PJ_LOG(4,(THIS_FILE, "NAT type: %s", res->nat_type_name));
+    app.nat_detected = PJ_TRUE;
+}
+
+
+/* Start pjsua, make the first call and return the time it took */
+static pj_status_t run_once(unsigned *p_msec, unsigned *p_stun_req)
+{
+    pjsua_config cfg;
+    pjsua_logging_config log_cfg;
+    pjsua_media_config med_cfg;
+    pjsua_transport_config tcfg;
+    pjsua_transport_info ti;
+    pjsua_transport_id tid;
+    pjsua_acc_id acc_id;
+    pjsua_call_id call_id;
+    pj_timestamp t_start, t_end;
+    char stun_srv[32], uri[64];
+    pj_str_t dst;
+    unsigned i, stun_req_cnt;
+    pj_status_t status;
+
+    app.confirmed = app.nat_detected = PJ_FALSE;
+    stun_req_cnt = app.stun_req_cnt;
+    pj_get_timestamp(&t_start);
+
+    status = pjsua_create();
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "pjsua_create() error", status);
+	return status;
+    }
+
+    pj_ansi_snprintf(stun_srv, sizeof(stun_srv), "127.0.0.1:%d",
+		     pj_ntohs(app.stun_addr.sin_port));
+
+    pjsua_config_default(&cfg);
+    cfg.cb.on_incoming_call = &on_incoming_call;
+    cfg.cb.on_call_state = &on_call_state;
+    cfg.cb.on_nat_detect = &on_nat_detect;
+    cfg.stun_srv_cnt = 1;
+    cfg.stun_srv[0] = pj_str(stun_srv);
+    cfg.nat_cache_file = pj_str((char*)app.file);
+
+    pjsua_logging_config_default(&log_cfg);
+    log_cfg.console_level = app.log_level;
+    log_cfg.level = app.log_level;
+
+    pjsua_media_config_default(&med_cfg);
+
+    status = pjsua_init(&cfg, &log_cfg, &med_cfg);
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "pjsua_init() error", status);
+	goto on_return;
+    }
+
+    pjsua_transport_config_default(&tcfg);
+    tcfg.bound_addr = pj_str("127.0.0.1");
+    status = pjsua_transport_create(PJSIP_TRANSPORT_UDP, &tcfg, &tid);
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "Error creating SIP transport", status);
+	goto on_return;
+    }
+    pjsua_transport_get_info(tid, &ti);
+
+    status = pjsua_acc_add_local(tid, PJ_TRUE, &acc_id);
+    if (status != PJ_SUCCESS)
+	goto on_return;
+
+    status = pjsua_start();
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "pjsua_start() error", status);
+	goto on_return;
+    }
+    pjsua_set_null_snd_dev();
+
+    pj_ansi_snprintf(uri, sizeof(uri), "sip:natcache@127.0.0.1:%d",
+		     pj_sockaddr_get_port(&ti.local_addr));
+    dst = pj_str(uri);
+    status = pjsua_call_make_call(acc_id, &dst, NULL, NULL, NULL, &call_id);
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "Error making call", status);
+	goto on_return;
+    }
+
+    for (i=0; !app.confirmed && i<10000; ++i)
+	pj_thread_sleep(1);
+    if (!app.confirmed) {
+	PJ_LOG(1,(THIS_FILE, "Call was not confirmed"));
+	status = PJ_ETIMEDOUT;
+	goto on_return;
+    }
+
+    pj_get_timestamp(&t_end);
+    *p_msec = pj_elapsed_msec(&t_start, &t_end);
+    *p_stun_req = app.stun_req_cnt - stun_req_cnt;
+
+    /* Let NAT type detection finish, so that the result is saved */
+    for (i=0; !app.nat_detected && i<10000; ++i)
+	pj_thread_sleep(1);
+
+    pjsua_call_hangup_all();
+
+on_return:
+    pjsua_destroy();
+    return status;
+}
+
+
+static void usage(void)
+{
+    printf(
+	"Usage:\n"
+	"   natcache [OPTIONS]\n"
+	"\n"
+	"Options:\n"
+	"   --rtt=MS                Delay of the STUN server stand-in\n"
+	"                           [default: 100]\n"
+	"   --runs=N, -n            Number of starts, the first one without\n"
+	"                           the cache [default: 3]\n"
+	"   --file=PATH, -f         NAT cache file, removed at startup\n"
+	"                           [default: natcache.txt]\n"
+	"   --verbose, -v           Verbose logging (may be repeated)\n"
+	"   --help, -h              Display this screen\n");
+}
+
+
+static int my_atoi(const char *s)
+{
+    pj_str_t ss = pj_str((char*)s);
+    return pj_strtoul(&ss);
+}
+
+
+static pj_status_t init_options(int argc, char *argv[])
+{
+    enum { OPT_RTT = 1 };
+    struct pj_getopt_option long_options[] = {
+	{ "rtt",	    1, 0, OPT_RTT },
+	{ "runs",	    1, 0, 'n' },
+	{ "file",	    1, 0, 'f' },
+	{ "verbose",	    0, 0, 'v' },
+	{ "help",	    0, 0, 'h' },
+	{ NULL, 0, 0, 0 },
+    };
+    int c;
+    int option_index;
+
+    app.rtt = 100;
+    app.runs = 3;
+    app.file = "natcache.txt";
+    app.log_level = 1;
+
+    pj_optind = 0;
+    while((c=pj_getopt_long(argc,argv, "n:f:vh",
+			    long_options, &option_index))!=-1)
+    {
+	switch (c) {
+	case OPT_RTT:
+	    app.rtt = my_atoi(pj_optarg);
+	    break;
+
+	case 'n':
+	    app.runs = my_atoi(pj_optarg);
+	    if (app.runs < 2) {
+		PJ_LOG(1,(THIS_FILE, "Invalid --runs %s", pj_optarg));
+		return -1;
+	    }
+	    break;
+
+	case 'f':
+	    app.file = pj_optarg;
+	    break;
+
+	case 'v':
+	    app.log_level++;
+	    break;
+
+	case 'h':
+	    usage();
+	    return -1;
+
+	default:
+	    PJ_LOG(1,(THIS_FILE, "Invalid argument. Use --help to see help"));
+	    return -1;
+	}
+    }
+
+    return PJ_SUCCESS;
+}
+
+
+int main(int argc, char *argv[])
+{
+    unsigned i, msec, stun_req;
+    int rc = 0;
+    pj_status_t status;
+
+    if (init_options(argc, argv) != PJ_SUCCESS)
+	return 1;
+
+    /* Keep pjlib initialized across pjsua restarts, for the stand-in */
+    pj_init();
+    pj_log_set_level(app.log_level);
+    app.stun_sock = PJ_INVALID_SOCKET;
+
+    status = stun_start();
+    if (status != PJ_SUCCESS) {
+	app_perror(THIS_FILE, "Error starting STUN server stand-in", status);
+	stun_stop();
+	pj_shutdown();
+	return 1;
+    }
+
+    pj_file_delete(app.file);
+
+    printf("Time to first call, STUN server delay %u ms:\n", app.rtt);
+
+    for (i=0; i<app.runs; ++i) {
+	status = run_once(&msec, &stun_req);
+	if (status != PJ_SUCCESS) {
+	    rc = 1;
+	    break;
+	}
+
+	printf("  %-6s start: %5u ms, %u STUN requests\n",
+	       i==0 ? "cold" : "cached", msec, stun_req);
+    }
+
+    stun_stop();
+    pj_shutdown();
+    return rc;
+}
@@ -91,7 +91,10 @@ PJ_DECL(pj_xml_node*) pjsip_iscomposing_create_xml(pj_pool_t *pool,
  *
  * @return		    The SIP message body containing XML message 
  *			    indication. NULL will be returned when there's not
- *			    enough memory to allocate the message.
+ *			    enough memory to allocate the message. When
+ *			    neither content type nor refresh is specified,
+ *			    the body carries a pre-printed text document
+ *			    rather than an XML tree.
  */
 PJ_DECL(pjsip_msg_body*) pjsip_iscomposing_create_body( pj_pool_t *pool,
 						   pj_bool_t is_composing,
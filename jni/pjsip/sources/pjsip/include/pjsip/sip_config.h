@@ -94,6 +94,12 @@ typedef struct pjsip_cfg_t
 	 */
 	pj_bool_t disable_tcp_switch;
 
+	/**
+	 * Parse headers that are not needed by the core stack for every
+	 * message only when they are looked up. See PJSIP_LAZY_HDR_PARSE.
+	 */
+	pj_bool_t lazy_hdr_parse;
+
     } endpt;
 
     /** Transaction layer settings. */
@@ -286,6 +292,26 @@ PJ_INLINE(pjsip_cfg_t*) pjsip_cfg(void)
 #endif
 
 
+/**
+ * Enable lazy header parsing. When enabled, the parser parses the headers
+ * that the core stack needs for every message (the first Via, From, To,
+ * Call-ID, CSeq, Max-Forwards, Route, Record-Route, Contact, Content-Type,
+ * Content-Length, Require, Supported and the authentication headers), and
+ * only records the raw value of the other known headers. These headers
+ * are parsed when they are first looked up with #pjsip_msg_find_hdr() and
+ * its relatives. Code that walks the header list directly should call
+ * #pjsip_msg_parse_lazy_hdrs() first.
+ *
+ * This option can also be controlled at run-time by the \a lazy_hdr_parse
+ * setting in pjsip_cfg_t.
+ *
+ * Default is 0 (no).
+ */
+#ifndef PJSIP_LAZY_HDR_PARSE
+#   define PJSIP_LAZY_HDR_PARSE		0
+#endif
+
+
 /**
  * Encode SIP headers in their short forms to reduce size. By default,
  * SIP headers in outgoing messages will be encoded in their full names. 
@@ -490,6 +516,47 @@ PJ_INLINE(pjsip_cfg_t*) pjsip_cfg(void)
 #endif
 
 
+/**
+ * Size of the buffer that each TCP and TLS connection keeps reading into.
+ * Incoming data is copied from this buffer to a receive buffer borrowed
+ * from the transport manager only while a message is being received, so
+ * an idle connection holds no more receive memory than this.
+ *
+ * Default: 1500
+ *
+ * @see PJSIP_RX_SLAB_MAX_CNT
+ */
+#ifndef PJSIP_TCP_READ_BUF_LEN
+#   define PJSIP_TCP_READ_BUF_LEN	1500
+#endif
+
+
+/**
+ * Maximum number of receive buffers (#pjsip_rx_data, each with a packet
+ * buffer of PJSIP_MAX_PKT_LEN bytes and its own pool) that the transport
+ * manager lends to stream transports at the same time. When the limit is
+ * reached, a connection that needs a buffer will be closed instead, so
+ * the memory used stays bounded under load. Zero means no limit.
+ *
+ * Default: 512
+ */
+#ifndef PJSIP_RX_SLAB_MAX_CNT
+#   define PJSIP_RX_SLAB_MAX_CNT	512
+#endif
+
+
+/**
+ * Number of receive buffers allocated at once when the transport manager
+ * runs out of free buffers. Buffers are never freed until the transport
+ * manager is destroyed, they are reused by other connections instead.
+ *
+ * Default: 16
+ */
+#ifndef PJSIP_RX_SLAB_CHUNK_CNT
+#   define PJSIP_RX_SLAB_CHUNK_CNT	16
+#endif
+
+
 /**
  * Set the interval to send keep-alive packet for TCP transports.
  * If the value is zero, keep-alive will be disabled for TCP.
@@ -1058,6 +1058,81 @@ PJ_DECL(void) pjsip_generic_string_hdr_init2(pjsip_generic_string_hdr *h,
 					     pj_str_t *hvalue);
 
 
+/* **************************************************************************/
+
+/* Forward declaration, see sip_parser.h */
+struct pjsip_parse_ctx;
+
+/**
+ * Lazily parsed header. When lazy header parsing is enabled (see
+ * \a lazy_hdr_parse setting in pjsip_cfg_t), the parser only records the
+ * name and the raw value of some headers, and the header is fully parsed
+ * when it is first looked up with #pjsip_msg_find_hdr() and its relatives.
+ * The parsed header then replaces the lazy header in the message.
+ *
+ * The header type of a lazy header is PJSIP_H_OTHER and its layout starts
+ * with the same fields as #pjsip_generic_string_hdr, so code that walks the
+ * header list directly sees it as a generic string header.
+ */
+typedef struct pjsip_lazy_hdr
+{
+    /** Standard header field. */
+    PJSIP_DECL_HDR_MEMBER(struct pjsip_lazy_hdr);
+    /** Raw header value. */
+    pj_str_t	 hvalue;
+    /** Type of the header once it is parsed. */
+    pjsip_hdr_e	 htype;
+    /** The function to parse the header value. */
+    pjsip_hdr*	(*parse)(struct pjsip_parse_ctx *ctx);
+    /** Pool to allocate the parsed header from. */
+    pj_pool_t	*pool;
+} pjsip_lazy_hdr;
+
+
+/**
+ * Create a lazy header. The name and value are not duplicated.
+ *
+ * @param pool	    The pool to allocate the header and later to allocate
+ *		    the parsed header.
+ * @param hname	    The header name.
+ * @param hsname    The header name as it appears in the message.
+ * @param hvalue    The raw header value. The character following the value
+ *		    must not be part of the header value (e.g. a newline or
+ *		    NULL terminator).
+ * @param htype	    The type of the header once it is parsed.
+ * @param parse	    The function to parse the header value.
+ *
+ * @return	    The header instance.
+ */
+PJ_DECL(pjsip_lazy_hdr*) pjsip_lazy_hdr_create(pj_pool_t *pool,
+					       const pj_str_t *hname,
+					       const pj_str_t *hsname,
+					       const pj_str_t *hvalue,
+					       pjsip_hdr_e htype,
+					       pjsip_hdr* (*parse)
+						   (struct pjsip_parse_ctx*));
+
+
+/**
+ * Check whether the header is a lazy header that has not been parsed.
+ *
+ * @param hdr	    The header.
+ *
+ * @return	    PJ_TRUE if the header is a lazy header.
+ */
+PJ_DECL(pj_bool_t) pjsip_hdr_is_lazy(const void *hdr);
+
+
+/**
+ * Parse all lazy headers in the message. This is needed only by code that
+ * walks the header list directly and needs every header in parsed form.
+ * Lazy headers that fail to parse are removed from the message.
+ *
+ * @param msg	    The message.
+ */
+PJ_DECL(void) pjsip_msg_parse_lazy_hdrs(pjsip_msg *msg);
+
+
 /* **************************************************************************/
 
 /**
@@ -130,6 +130,29 @@ PJ_DECL(pj_status_t) pjsip_register_hdr_parser( const char *hname,
 						const char *hshortname,
 						pjsip_parse_hdr_func *fptr);
 
+/**
+ * Register header parser handler for a header that may be parsed lazily.
+ * When lazy header parsing is enabled (see \a lazy_hdr_parse setting in
+ * pjsip_cfg_t), the message parser only records the raw value of such
+ * header, and the handler is called when the header is first looked up
+ * with #pjsip_msg_find_hdr_by_name() and its relatives. Since the header
+ * type of the parsed header is not known until then, such header MUST be
+ * looked up by name.
+ *
+ * Only register headers that are not needed by the core stack for every
+ * message, and whose parser does not use the \a rdata field of the
+ * parsing context.
+ *
+ * @param hname		The header name.
+ * @param hshortname	The short header name or NULL.
+ * @param fptr		The pointer to function to parser the header.
+ *
+ * @return		PJ_SUCCESS if success, or the appropriate error code.
+ */
+PJ_DECL(pj_status_t) pjsip_register_lazy_hdr_parser(const char *hname,
+						    const char *hshortname,
+						    pjsip_parse_hdr_func *fptr);
+
 /**
  * Unregister previously registered header parser handler.
  * All the arguments MUST exactly equal to the value specified upon 
@@ -283,6 +306,18 @@ PJ_DECL(void*) pjsip_parse_hdr( pj_pool_t *pool, const pj_str_t *hname,
 				char *line, pj_size_t size,
 				int *parsed_len);
 
+/**
+ * Parse a lazy header and replace it with the parsed header(s) in the
+ * header list. The lazy header is removed from the list even when parsing
+ * fails. Application normally does not need to call this function since
+ * lazy headers are parsed when they are looked up.
+ *
+ * @param hdr		The lazy header.
+ *
+ * @return		The first parsed header, or NULL if parsing failed.
+ */
+PJ_DECL(pjsip_hdr*) pjsip_parse_lazy_hdr( pjsip_lazy_hdr *hdr );
+
 /**
  * Parse header line(s). Multiple headers can be parsed by this function.
  * When there are multiple headers, the headers MUST be separated by either
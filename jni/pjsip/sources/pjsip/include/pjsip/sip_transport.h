@@ -925,6 +925,66 @@ PJ_DECL(pj_ssize_t) pjsip_tpmgr_receive_packet(pjsip_tpmgr *mgr,
 					       pjsip_rx_data *rdata);
 
 
+/**
+ * Statistic of the receive buffers that the transport manager lends to
+ * stream transports, see #pjsip_tpmgr_get_rx_slab_stat().
+ */
+typedef struct pjsip_rx_slab_stat
+{
+    unsigned	total;	    /**< Number of buffers allocated.		    */
+    unsigned	in_use;	    /**< Number of buffers currently lent.	    */
+    unsigned	peak;	    /**< Highest number of buffers lent at once.    */
+    unsigned	fail_cnt;   /**< Number of requests that were refused.	    */
+} pjsip_rx_slab_stat;
+
+
+/**
+ * Borrow a receive buffer from the transport manager. Stream transports
+ * (e.g. TCP, TLS) call this when data arrives on an idle connection, and
+ * give the buffer back with #pjsip_tpmgr_release_rdata() once all data
+ * in it has been processed, so that idle connections don't hold
+ * PJSIP_MAX_PKT_LEN bytes of receive memory each.
+ *
+ * The tp_info.transport, tp_info.pool and tp_info.op_key.rdata members of
+ * the returned rdata are initialized, the transport must initialize the
+ * rest of tp_info and pkt_info.
+ *
+ * @param mgr		The transport manager instance.
+ * @param tp		The transport that will use the buffer.
+ * @param p_rdata	Pointer to receive the buffer.
+ *
+ * @return		PJ_SUCCESS on success, PJ_ETOOMANY if the
+ *			PJSIP_RX_SLAB_MAX_CNT limit has been reached, or
+ *			PJ_ENOMEM.
+ */
+PJ_DECL(pj_status_t) pjsip_tpmgr_acquire_rdata(pjsip_tpmgr *mgr,
+					       pjsip_transport *tp,
+					       pjsip_rx_data **p_rdata);
+
+
+/**
+ * Give back a receive buffer that was borrowed with
+ * #pjsip_tpmgr_acquire_rdata().
+ *
+ * @param mgr		The transport manager instance.
+ * @param rdata		The receive buffer.
+ */
+PJ_DECL(void) pjsip_tpmgr_release_rdata(pjsip_tpmgr *mgr,
+					pjsip_rx_data *rdata);
+
+
+/**
+ * Get the statistic of the receive buffers lent by the transport manager.
+ *
+ * @param mgr		The transport manager instance.
+ * @param stat		Structure to receive the statistic.
+ *
+ * @return		PJ_SUCCESS on success.
+ */
+PJ_DECL(pj_status_t) pjsip_tpmgr_get_rx_slab_stat(pjsip_tpmgr *mgr,
+						  pjsip_rx_slab_stat *stat);
+
+
 /*****************************************************************************
  *
  * TRANSPORT FACTORY
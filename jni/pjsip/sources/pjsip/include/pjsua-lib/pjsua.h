@@ -327,6 +327,28 @@ typedef struct pjsua_msg_data pjsua_msg_data;
 #   define PJSUA_ACQUIRE_CALL_TIMEOUT 2000
 #endif
 
+/**
+ * Maximum number of networks remembered in the NAT cache file. When the
+ * file is full, the network that was seen least recently is forgotten.
+ * See \a nat_cache_file in #pjsua_config.
+ *
+ * Default: 8
+ */
+#ifndef PJSUA_NAT_CACHE_MAX
+#   define PJSUA_NAT_CACHE_MAX		8
+#endif
+
+/**
+ * Delay before a STUN server address and NAT type taken from the NAT cache
+ * are revalidated in the background, in milliseconds. This keeps the
+ * revalidation from competing with the registrations at startup.
+ *
+ * Default: 5000 ms
+ */
+#ifndef PJSUA_NAT_CACHE_REVALIDATE_DELAY
+#   define PJSUA_NAT_CACHE_REVALIDATE_DELAY 5000
+#endif
+
 /**
  * Is video enabled.
  */
@@ -1481,6 +1503,33 @@ typedef struct pjsua_config
      */
     int		    nat_type_in_sdp;
 
+    /**
+     * File where the resolved STUN server address and the detected NAT
+     * type are saved for each network. When the current network is found
+     * in this file at startup, the library uses the saved results right
+     * away instead of waiting for STUN server resolution and NAT type
+     * detection, and revalidates them in the background after
+     * #PJSUA_NAT_CACHE_REVALIDATE_DELAY. When the saved NAT type says that
+     * the local address is public, sockets are not queried for their STUN
+     * mapped address.
+     *
+     * Networks are told apart by the address of the default interface, by
+     * the default gateway (where the system lets it be read, e.g. Linux
+     * and Android) and by \a network_id.
+     *
+     * Default: empty (no cache)
+     */
+    pj_str_t	    nat_cache_file;
+
+    /**
+     * Optional identity of the current network, such as the Wi-Fi SSID,
+     * to tell apart networks that assign the same local address and
+     * gateway. See \a nat_cache_file.
+     *
+     * Default: empty
+     */
+    pj_str_t	    network_id;
+
     /**
      * Specify how the support for reliable provisional response (100rel/
      * PRACK) should be used by default. Note that this setting can be
@@ -5120,6 +5169,48 @@ PJ_DECL(pj_status_t) pjsua_pres_notify(pjsua_acc_id acc_id,
 PJ_DECL(void) pjsua_pres_dump(pj_bool_t verbose);
 
 
+/**
+ * Maximum number of outstanding MESSAGE transactions to the same remote
+ * URI. Requests beyond this window are queued and sent as earlier ones
+ * complete, and typing indications waiting in the queue are coalesced.
+ * Set to zero to send every request immediately.
+ */
+#ifndef PJSUA_IM_WINDOW
+#   define PJSUA_IM_WINDOW	    8
+#endif
+
+
+/**
+ * Maximum number of remote URIs for which outgoing IM sessions are
+ * tracked at the same time. When all are busy, further requests are
+ * sent immediately without queueing or coalescing.
+ */
+#ifndef PJSUA_IM_MAX_PEERS
+#   define PJSUA_IM_MAX_PEERS	    16
+#endif
+
+
+/**
+ * Maximum number of requests waiting to be sent to one remote URI.
+ * #pjsua_im_send() returns PJ_ETOOMANY when the queue is full.
+ */
+#ifndef PJSUA_IM_MAX_QUEUE
+#   define PJSUA_IM_MAX_QUEUE	    64
+#endif
+
+
+/**
+ * Interval, in seconds, at which an unchanged "active" typing indication
+ * is sent again to keep the remote composing state from expiring. Repeated
+ * calls to #pjsua_im_typing() with the same state within this interval
+ * do not generate requests. RFC 3994 uses 120 seconds as the default
+ * refresh at the receiver.
+ */
+#ifndef PJSUA_IM_TYPING_REFRESH
+#   define PJSUA_IM_TYPING_REFRESH  60
+#endif
+
+
 /**
  * The MESSAGE method (defined in pjsua_im.c)
  */
@@ -5147,6 +5238,10 @@ extern const pjsip_method pjsip_info_method;
  * @param user_data	Optional user data, which will be given back when
  *			the IM callback is called.
  *
+ * The request may be queued when #PJSUA_IM_WINDOW requests to the same
+ * remote URI are still outstanding. Failure to send a queued request is
+ * reported through the pager status callback.
+ *
  * @return		PJ_SUCCESS on success, or the appropriate error code.
  */
 PJ_DECL(pj_status_t) pjsua_im_send(pjsua_acc_id acc_id, 
@@ -5167,6 +5262,10 @@ PJ_DECL(pj_status_t) pjsua_im_send(pjsua_acc_id acc_id,
  * @param msg_data	Optional list of headers etc to be added to outgoing
  *			request.
  *
+ * When \a msg_data is NULL, the indication is coalesced with the state
+ * already sent or queued for the same remote URI, so it is safe to call
+ * this function on every keystroke. See #PJSUA_IM_TYPING_REFRESH.
+ *
  * @return		PJ_SUCCESS on success, or the appropriate error code.
  */
 PJ_DECL(pj_status_t) pjsua_im_typing(pjsua_acc_id acc_id, 
@@ -5418,6 +5517,29 @@ struct pjsua_media_config
      */
     unsigned		thread_cnt;
 
+    /**
+     * Specify the number of media ioqueues, each polled by its own
+     * \a thread_cnt worker threads. The RTP and RTCP sockets of a call
+     * are polled by one of them, chosen by the call index, so a busy
+     * call only delays the calls sharing its ioqueue. With more than
+     * one ioqueue, ICE media transports are polled there too, rather
+     * than by the SIP worker threads. Only used when \a has_ioqueue
+     * is set.
+     *
+     * Default: 1
+     */
+    unsigned		ioqueue_cnt;
+
+    /**
+     * Run the media worker threads with real-time priority, so that SIP
+     * processing, DNS and application callbacks in other threads don't
+     * delay incoming RTP. This usually needs special privilege, and the
+     * threads keep the normal priority when it's not granted.
+     *
+     * Default: PJ_FALSE
+     */
+    pj_bool_t		thread_realtime;
+
     /**
      * Media quality, 0-10, according to this table:
      *   5-10: resampling use large filter,
@@ -5524,6 +5646,61 @@ struct pjsua_media_config
      */
     int			jb_max;
 
+    /**
+     * Skip decoding (and hence mixing in the conference bridge) incoming
+     * audio frames that the remote reports as quieter than this level, in
+     * -dBov, in the RFC 6464 audio level RTP header extension. This saves
+     * a lot of CPU when hosting a conference with many mostly silent
+     * participants. A value of around 50 is suitable for that. Only the
+     * frames of stateless codecs (G.711 and L16) are skipped, codecs that
+     * keep state between frames (e.g. G.722, iLBC or Opus) are always
+     * decoded. The extension must be enabled with
+     * PJMEDIA_RTP_AUDIO_LEVEL_EXT_ID. Set to zero to always decode. See
+     * \a audio_level_skip in #pjmedia_stream_info.
+     *
+     * Default: 0 (always decode)
+     */
+    unsigned		audio_level_skip;
+
+    /**
+     * Let audio streams send longer packets, up to this duration in msec,
+     * while the RTCP reports of remote show congestion. This saves the
+     * per packet IP/UDP/RTP overhead when it matters most. The application
+     * is told about the changes with PJMEDIA_EVENT_PTIME_CHANGED event in
+     * \a on_call_media_event callback. See \a adaptive_max_ptime in
+     * #pjmedia_stream_info.
+     *
+     * Default: 0 (fixed packetization)
+     */
+    unsigned		adaptive_max_ptime;
+
+    /**
+     * Offer and accept multiplexing RTCP on the RTP port (RFC 5761). When
+     * both sides agree, each media line only needs one socket, and ICE
+     * only needs to check and keep alive one component. When remote does
+     * not support it, RTCP is sent to the separate RTCP port as usual.
+     *
+     * Default: PJMEDIA_ADVERTISE_RTCP_MUX (yes)
+     */
+    pj_bool_t		enable_rtcp_mux;
+
+    /**
+     * Offer and accept sending all media lines of a call over the
+     * transport of the first media line (BUNDLE, RFC 8843), so a call
+     * with audio and video needs as many sockets and ICE checks as an
+     * audio only call. The media lines are only bundled when both sides
+     * agree; otherwise each media line keeps its own transport. Enable
+     * \a enable_rtcp_mux too, to use a single socket per call.
+     *
+     * Current limitations: BUNDLE is not used for accounts with SRTP
+     * enabled, media lines can't be removed from the group once it is
+     * established, and the first bundled media line must be the first
+     * media line of the group.
+     *
+     * Default: PJ_FALSE (no)
+     */
+    pj_bool_t		enable_bundle;
+
     /**
      * Enable ICE
      */
@@ -85,6 +85,9 @@ struct pjsua_call_media
 					    (used to update ICE default
 					    address)			    */
     pjmedia_srtp_use	 rem_srtp_use; /**< Remote's SRTP usage policy.	    */
+    pj_bool_t		 rem_rtcp_mux; /**< Remote offers RTCP mux.	    */
+    pj_bool_t		 bundled;   /**< Media line is in BUNDLE group.  */
+    unsigned		 bundle_tag;/**< Index of the tagged media line.  */
     pj_timestamp	 last_req_keyframe;/**< Last TX keyframe request.   */
 
     pjsua_med_tp_state_cb      med_init_cb;/**< Media transport
@@ -412,6 +415,7 @@ struct pjsua_data
     /* STUN and resolver */
     pj_stun_config	 stun_cfg;  /**< Global STUN settings.		*/
     pj_sockaddr		 stun_srv;  /**< Resolved STUN server address	*/
+    char		 stun_srv_name[PJ_MAX_HOSTNAME]; /**< Its entry	*/
     pj_status_t		 stun_status; /**< STUN server status.		*/
     pjsua_stun_resolve	 stun_res;  /**< List of pending STUN resolution*/
     pj_dns_resolver	*resolver;  /**< DNS resolver.			*/
@@ -421,6 +425,11 @@ struct pjsua_data
     pj_status_t		 nat_status;	/**< Detection status.		*/
     pj_bool_t		 nat_in_progress; /**< Detection in progress	*/
 
+    /* NAT cache */
+    char		 nat_cache_key[PJ_MAX_HOSTNAME]; /**< Network	*/
+    pj_bool_t		 nat_cached;	/**< Results are from the cache	*/
+    pj_timer_entry	 nat_cache_timer; /**< Revalidation timer	*/
+
     /* List of outbound proxies: */
     pjsip_route_hdr	 outbound_proxy;
 
@@ -497,6 +506,11 @@ PJ_DECL(struct pjsua_data*) pjsua_get_var(void);
 
 
 
+/**
+ * Outgoing IM session to a remote URI (defined in pjsua_im.c).
+ */
+typedef struct pjsua_im_peer pjsua_im_peer;
+
 /**
  * IM callback data.
  */
@@ -507,6 +521,7 @@ typedef struct pjsua_im_data
     pj_str_t	     to;
     pj_str_t	     body;
     void	    *user_data;
+    pjsua_im_peer   *peer;	/**< IM session slot held by the request. */
 } pjsua_im_data;
 
 pj_status_t pjsua_media_apply_xml_control(pjsua_call_id call_id,
@@ -527,6 +542,7 @@ PJ_INLINE(pjsua_im_data*) pjsua_im_data_dup(pj_pool_t *pool,
     pj_strdup_with_null(pool, &dst->to, &src->to);
     dst->user_data = src->user_data;
     pj_strdup_with_null(pool, &dst->body, &src->body);
+    dst->peer = src->peer;
 
     return dst;
 }
@@ -580,6 +596,12 @@ void pjsua_set_state(pjsua_state new_state);
 /* Resolve the STUN server */
 pj_status_t resolve_stun_server(pj_bool_t wait);
 
+/* Check if the NAT type says that local addresses are public, so sockets
+ * don't need to query their STUN mapped address. This is only trusted when
+ * the NAT cache is enabled and the type was found on the current network.
+ */
+pj_bool_t pjsua_nat_is_open(void);
+
 /** 
  * Normalize route URI (check for ";lr" and append one if it doesn't
  * exist and pjsua_config.force_lr is set.
@@ -691,6 +713,11 @@ void pjsua_pres_delete_acc(int acc_id, unsigned flags);
  */
 pj_status_t pjsua_im_init(void);
 
+/**
+ * Drop queued outgoing IM and release IM sessions.
+ */
+void pjsua_im_shutdown(void);
+
 /**
  * Start MWI subscription
  */
@@ -793,6 +820,8 @@ pj_status_t pjsua_aud_channel_update(pjsua_call_media *call_med,
                                      pjmedia_stream_info *si,
 				     const pjmedia_sdp_session *local_sdp,
 				     const pjmedia_sdp_session *remote_sdp);
+pj_status_t pjsua_aud_stream_update(pjsua_call_media *call_med,
+				    pjmedia_stream_info *si);
 void pjsua_check_snd_dev_idle();
 
 /*
@@ -295,10 +295,10 @@ static pjsip_hdr* parse_hdr_sub_state( pjsip_parse_ctx *ctx )
  */
 PJ_DEF(void) pjsip_evsub_init_parser(void)
 {
-    pjsip_register_hdr_parser( "Event", "o",
-			       &parse_hdr_event);
+    pjsip_register_lazy_hdr_parser( "Event", "o",
+				    &parse_hdr_event);
 
-    pjsip_register_hdr_parser( "Subscription-State", NULL, 
-			       &parse_hdr_sub_state);
+    pjsip_register_lazy_hdr_parser( "Subscription-State", NULL, 
+				    &parse_hdr_sub_state);
 }
 
@@ -49,6 +49,29 @@ static const pj_str_t STR_XSI_SLOC_NAME =  { "xsi:schemaLocation", 18 };
 static const pj_str_t STR_XSI_SLOC_VAL =   { "urn:ietf:params:xml:ns:im-composing iscomposing.xsd", 51 };
 
 
+/* Pre-printed documents for the common case where only the state is
+ * conveyed. These must match what pj_xml_print() would produce for the
+ * document built by pjsip_iscomposing_create_xml().
+ */
+#define TPL_HEAD    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" \
+		    "<isComposing xmlns=\"urn:ietf:params:xml:ns:im-iscomposing\"" \
+		    " xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"" \
+		    " xsi:schemaLocation=\"urn:ietf:params:xml:ns:im-composing" \
+		    " iscomposing.xsd\">\n"
+#define TPL_TAIL    "</isComposing>\n"
+
+static const pj_str_t STR_TPL_ACTIVE = 
+{
+    TPL_HEAD " <state>active</state>\n" TPL_TAIL,
+    sizeof(TPL_HEAD " <state>active</state>\n" TPL_TAIL) - 1
+};
+static const pj_str_t STR_TPL_IDLE = 
+{
+    TPL_HEAD " <state>idle</state>\n" TPL_TAIL,
+    sizeof(TPL_HEAD " <state>idle</state>\n" TPL_TAIL) - 1
+};
+
+
 PJ_DEF(pj_xml_node*) pjsip_iscomposing_create_xml( pj_pool_t *pool,
 						   pj_bool_t is_composing,
 						   const pj_time_val *lst_actv,
@@ -139,6 +162,26 @@ PJ_DEF(pjsip_msg_body*) pjsip_iscomposing_create_body( pj_pool_t *pool,
     pj_xml_node *doc;
     pjsip_msg_body *body;
 
+    /* When only the state is conveyed, use the pre-printed document
+     * instead of building and printing the XML tree for every request.
+     */
+    if (content_tp == NULL && (!is_composing || refresh < 2 || refresh > 3600))
+    {
+	body = PJ_POOL_ZALLOC_T(pool, pjsip_msg_body);
+	body->content_type.type = STR_MIME_TYPE;
+	body->content_type.subtype = STR_MIME_SUBTYPE;
+
+	body->data = (void*)(is_composing ? STR_TPL_ACTIVE.ptr : 
+					    STR_TPL_IDLE.ptr);
+	body->len = (unsigned)(is_composing ? STR_TPL_ACTIVE.slen : 
+					      STR_TPL_IDLE.slen);
+
+	body->print_body = &pjsip_print_text_body;
+	body->clone_data = &pjsip_clone_text_data;
+
+	return body;
+    }
+
     doc = pjsip_iscomposing_create_xml( pool, is_composing, lst_actv,
 					content_tp, refresh);
     if (doc == NULL)
@@ -183,8 +183,8 @@ PJ_DEF(pj_status_t) pjsip_replaces_init_module(pjsip_endpoint *endpt)
 	return PJ_SUCCESS;
 
     /* Register Replaces header parser */
-    status = pjsip_register_hdr_parser( "Replaces", NULL, 
-				        &parse_hdr_replaces);
+    status = pjsip_register_lazy_hdr_parser( "Replaces", NULL, 
+					     &parse_hdr_replaces);
     if (status != PJ_SUCCESS)
 	return status;
 
@@ -515,14 +515,14 @@ PJ_DEF(pj_status_t) pjsip_timer_init_module(pjsip_endpoint *endpt)
 	return PJ_SUCCESS;
 
     /* Register Session-Expires header parser */
-    status = pjsip_register_hdr_parser( STR_SE.ptr, STR_SHORT_SE.ptr, 
-				        &parse_hdr_se);
+    status = pjsip_register_lazy_hdr_parser( STR_SE.ptr, STR_SHORT_SE.ptr, 
+					     &parse_hdr_se);
     if (status != PJ_SUCCESS)
 	return status;
 
     /* Register Min-SE header parser */
-    status = pjsip_register_hdr_parser( STR_MIN_SE.ptr, NULL, 
-				        &parse_hdr_min_se);
+    status = pjsip_register_lazy_hdr_parser( STR_MIN_SE.ptr, NULL, 
+					     &parse_hdr_min_se);
     if (status != PJ_SUCCESS)
 	return status;
 
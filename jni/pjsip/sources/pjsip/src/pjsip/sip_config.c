@@ -27,7 +27,9 @@ pjsip_cfg_t pjsip_sip_cfg_var =
     {
        PJSIP_ALLOW_PORT_IN_FROMTO_HDR,
        0,
-       PJSIP_DONT_SWITCH_TO_TCP
+       0,
+       PJSIP_DONT_SWITCH_TO_TCP,
+       PJSIP_LAZY_HDR_PARSE
     },
 
     /* Transaction settings */
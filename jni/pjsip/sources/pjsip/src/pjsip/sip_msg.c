@@ -46,6 +46,8 @@ PJ_DEF_DATA(const pjsip_method) pjsip_register_method =
 PJ_DEF_DATA(const pjsip_method) pjsip_options_method =
 	{ PJSIP_OPTIONS_METHOD, { "OPTIONS",7}};
 
+static pjsip_hdr_vptr lazy_hdr_vptr;
+
 
 /** INVITE method constant. */
 PJ_DEF(const pjsip_method*) pjsip_get_invite_method(void)
@@ -335,6 +337,24 @@ PJ_DEF(pjsip_msg*) pjsip_msg_clone( pj_pool_t *pool, const pjsip_msg *src)
     return dst;
 }
 
+/* Parse a lazy header found during header lookup. The parsed header
+ * replaces the lazy header in the message, so the message is modified
+ * even though it is passed as const. Returns NULL if the header can't be
+ * parsed, in which case it has been removed and *p_hdr is set to its
+ * predecessor so the lookup can continue.
+ */
+static pjsip_hdr *find_parse_lazy(const pjsip_hdr **p_hdr)
+{
+    const pjsip_hdr *prev = (*p_hdr)->prev;
+    pjsip_hdr *hdr;
+
+    hdr = pjsip_parse_lazy_hdr((pjsip_lazy_hdr*)*p_hdr);
+    if (!hdr)
+	*p_hdr = prev;
+
+    return hdr;
+}
+
 PJ_DEF(void*)  pjsip_msg_find_hdr( const pjsip_msg *msg, 
 				   pjsip_hdr_e hdr_type, const void *start)
 {
@@ -344,8 +364,15 @@ PJ_DEF(void*)  pjsip_msg_find_hdr( const pjsip_msg *msg,
 	hdr = msg->hdr.next;
     }
     for (; hdr!=end; hdr = hdr->next) {
-	if (hdr->type == hdr_type)
+	if (hdr->vptr == &lazy_hdr_vptr) {
+	    if (((const pjsip_lazy_hdr*)hdr)->htype == hdr_type) {
+		pjsip_hdr *h = find_parse_lazy(&hdr);
+		if (h)
+		    return h;
+	    }
+	} else if (hdr->type == hdr_type) {
 	    return (void*)hdr;
+	}
     }
     return NULL;
 }
@@ -360,8 +387,15 @@ PJ_DEF(void*)  pjsip_msg_find_hdr_by_name( const pjsip_msg *msg,
 	hdr = msg->hdr.next;
     }
     for (; hdr!=end; hdr = hdr->next) {
-	if (pj_stricmp(&hdr->name, name) == 0)
-	    return (void*)hdr;
+	if (pj_stricmp(&hdr->name, name) == 0) {
+	    if (hdr->vptr == &lazy_hdr_vptr) {
+		pjsip_hdr *h = find_parse_lazy(&hdr);
+		if (h)
+		    return h;
+	    } else {
+		return (void*)hdr;
+	    }
+	}
     }
     return NULL;
 }
@@ -377,10 +411,17 @@ PJ_DEF(void*)  pjsip_msg_find_hdr_by_names( const pjsip_msg *msg,
 	hdr = msg->hdr.next;
     }
     for (; hdr!=end; hdr = hdr->next) {
-	if (pj_stricmp(&hdr->name, name) == 0)
-	    return (void*)hdr;
-	if (pj_stricmp(&hdr->name, sname) == 0)
-	    return (void*)hdr;
+	if (pj_stricmp(&hdr->name, name) == 0 ||
+	    pj_stricmp(&hdr->name, sname) == 0)
+	{
+	    if (hdr->vptr == &lazy_hdr_vptr) {
+		pjsip_hdr *h = find_parse_lazy(&hdr);
+		if (h)
+		    return h;
+	    } else {
+		return (void*)hdr;
+	    }
+	}
     }
     return NULL;
 }
@@ -785,6 +826,84 @@ static pjsip_generic_string_hdr* pjsip_generic_string_hdr_shallow_clone( pj_pool
     return hdr;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+/*
+ * Lazy header.
+ */
+
+static pjsip_lazy_hdr* pjsip_lazy_hdr_clone( pj_pool_t *pool, 
+					     const pjsip_lazy_hdr *hdr);
+static pjsip_lazy_hdr* pjsip_lazy_hdr_shallow_clone( pj_pool_t *pool,
+						     const pjsip_lazy_hdr *hdr);
+
+static pjsip_hdr_vptr lazy_hdr_vptr = 
+{
+    (pjsip_hdr_clone_fptr) &pjsip_lazy_hdr_clone,
+    (pjsip_hdr_clone_fptr) &pjsip_lazy_hdr_shallow_clone,
+    (pjsip_hdr_print_fptr) &pjsip_generic_string_hdr_print,
+};
+
+PJ_DEF(pjsip_lazy_hdr*) pjsip_lazy_hdr_create(pj_pool_t *pool,
+					      const pj_str_t *hname,
+					      const pj_str_t *hsname,
+					      const pj_str_t *hvalue,
+					      pjsip_hdr_e htype,
+					      pjsip_hdr* (*parse)
+						  (struct pjsip_parse_ctx*))
+{
+    pjsip_lazy_hdr *hdr = PJ_POOL_ALLOC_T(pool, pjsip_lazy_hdr);
+
+    init_hdr(hdr, PJSIP_H_OTHER, &lazy_hdr_vptr);
+    hdr->name = *hname;
+    hdr->sname = *hsname;
+    hdr->hvalue = *hvalue;
+    hdr->htype = htype;
+    hdr->parse = parse;
+    hdr->pool = pool;
+    return hdr;
+}
+
+PJ_DEF(pj_bool_t) pjsip_hdr_is_lazy(const void *hdr)
+{
+    return ((const pjsip_hdr*)hdr)->vptr == &lazy_hdr_vptr;
+}
+
+PJ_DEF(void) pjsip_msg_parse_lazy_hdrs(pjsip_msg *msg)
+{
+    pjsip_hdr *hdr = msg->hdr.next;
+
+    while (hdr != &msg->hdr) {
+	pjsip_hdr *next = hdr->next;
+	if (hdr->vptr == &lazy_hdr_vptr)
+	    pjsip_parse_lazy_hdr((pjsip_lazy_hdr*)hdr);
+	hdr = next;
+    }
+}
+
+static pjsip_lazy_hdr* pjsip_lazy_hdr_clone( pj_pool_t *pool, 
+					     const pjsip_lazy_hdr *rhs)
+{
+    pjsip_lazy_hdr *hdr = PJ_POOL_ALLOC_T(pool, pjsip_lazy_hdr);
+
+    pj_memcpy(hdr, rhs, sizeof(*hdr));
+    pj_strdup(pool, &hdr->name, &rhs->name);
+    pj_strdup(pool, &hdr->sname, &rhs->sname);
+    /* The parser needs a terminator after the value */
+    pj_strdup_with_null(pool, &hdr->hvalue, &rhs->hvalue);
+    hdr->pool = pool;
+    return hdr;
+}
+
+static pjsip_lazy_hdr* pjsip_lazy_hdr_shallow_clone( pj_pool_t *pool,
+						     const pjsip_lazy_hdr *rhs)
+{
+    pjsip_lazy_hdr *hdr = PJ_POOL_ALLOC_T(pool, pjsip_lazy_hdr);
+
+    pj_memcpy(hdr, rhs, sizeof(*hdr));
+    hdr->pool = pool;
+    return hdr;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /*
  * Generic pjsip_hdr_names/integer value header.
@@ -22,6 +22,7 @@
 #include <pjsip/sip_msg.h>
 #include <pjsip/sip_multipart.h>
 #include <pjsip/sip_auth_parser.h>
+#include <pjsip/sip_config.h>
 #include <pjsip/sip_errno.h>
 #include <pjsip/sip_transport.h>        /* rdata structure */
 #include <pjlib-util/scanner.h>
@@ -71,10 +72,27 @@ typedef struct handler_rec
     pj_size_t		  hname_len;
     pj_uint32_t		  hname_hash;
     pjsip_parse_hdr_func *handler;
+    const pj_str_t	 *lname;    /* Full name if parsed lazily, or NULL  */
+    pjsip_hdr_e		  htype;    /* Type of the parsed header	    */
 } handler_rec;
 
 static handler_rec handler[PJSIP_MAX_HEADER_TYPES];
 static unsigned handler_count;
+
+/*
+ * Full names of the lazily parsed headers. They are kept out of the
+ * handler table so that the table stays small for the lookup, and so that
+ * lazy headers can point to them without copying.
+ */
+typedef struct lazy_name_rec
+{
+    char		  buf[PJSIP_MAX_HNAME_LEN+1];
+    pj_str_t		  name;
+} lazy_name_rec;
+
+static lazy_name_rec lazy_name[PJSIP_MAX_HEADER_TYPES];
+static unsigned lazy_name_count;
+
 static int parser_is_initialized;
 
 /*
@@ -184,6 +202,14 @@ static pjsip_hdr*   parse_hdr_to( pjsip_parse_ctx *ctx );
 static pjsip_hdr*   parse_hdr_unsupported( pjsip_parse_ctx *ctx );
 static pjsip_hdr*   parse_hdr_via( pjsip_parse_ctx *ctx );
 static pjsip_hdr*   parse_hdr_generic_string( pjsip_parse_ctx *ctx);
+static pjsip_hdr*   parse_hdr_lazy( pjsip_parse_ctx *ctx,
+				    const handler_rec *rec,
+				    const pj_str_t *hname);
+static pj_status_t  register_hdr_parser( const char *hname,
+					 const char *hshortname,
+					 pjsip_parse_hdr_func *fptr,
+					 pjsip_hdr_e htype,
+					 pj_bool_t lazy);
 
 /* Convert non NULL terminated string to integer. */
 static unsigned long pj_strtoul_mindigit(const pj_str_t *str, 
@@ -405,10 +431,12 @@ static pj_status_t init_parser()
      * Register header parsers.
      */
 
-    status = pjsip_register_hdr_parser( "Accept", NULL, &parse_hdr_accept);
+    status = register_hdr_parser( "Accept", NULL, &parse_hdr_accept, 
+				  PJSIP_H_ACCEPT, PJ_TRUE);
     PJ_ASSERT_RETURN(status == PJ_SUCCESS, status);
 
-    status = pjsip_register_hdr_parser( "Allow", NULL, &parse_hdr_allow);
+    status = register_hdr_parser( "Allow", NULL, &parse_hdr_allow, 
+				  PJSIP_H_ALLOW, PJ_TRUE);
     PJ_ASSERT_RETURN(status == PJ_SUCCESS, status);
 
     status = pjsip_register_hdr_parser( "Call-ID", "i", &parse_hdr_call_id);
@@ -428,7 +456,8 @@ static pj_status_t init_parser()
     status = pjsip_register_hdr_parser( "CSeq", NULL, &parse_hdr_cseq);
     PJ_ASSERT_RETURN(status == PJ_SUCCESS, status);
 
-    status = pjsip_register_hdr_parser( "Expires", NULL, &parse_hdr_expires);
+    status = register_hdr_parser( "Expires", NULL, &parse_hdr_expires,
+				  PJSIP_H_EXPIRES, PJ_TRUE);
     PJ_ASSERT_RETURN(status == PJ_SUCCESS, status);
 
     status = pjsip_register_hdr_parser( "From", "f", &parse_hdr_from);
@@ -438,8 +467,9 @@ static pj_status_t init_parser()
                                         &parse_hdr_max_forwards);
     PJ_ASSERT_RETURN(status == PJ_SUCCESS, status);
 
-    status = pjsip_register_hdr_parser( "Min-Expires", NULL, 
-                                        &parse_hdr_min_expires);
+    status = register_hdr_parser( "Min-Expires", NULL, 
+				  &parse_hdr_min_expires,
+				  PJSIP_H_MIN_EXPIRES, PJ_TRUE);
     PJ_ASSERT_RETURN(status == PJ_SUCCESS, status);
 
     status = pjsip_register_hdr_parser( "Record-Route", NULL, &parse_hdr_rr);
@@ -451,8 +481,9 @@ static pj_status_t init_parser()
     status = pjsip_register_hdr_parser( "Require", NULL, &parse_hdr_require);
     PJ_ASSERT_RETURN(status == PJ_SUCCESS, status);
 
-    status = pjsip_register_hdr_parser( "Retry-After", NULL, 
-                                        &parse_hdr_retry_after);
+    status = register_hdr_parser( "Retry-After", NULL, 
+				  &parse_hdr_retry_after,
+				  PJSIP_H_RETRY_AFTER, PJ_TRUE);
     PJ_ASSERT_RETURN(status == PJ_SUCCESS, status);
 
     status = pjsip_register_hdr_parser( "Supported", "k", 
@@ -462,11 +493,14 @@ static pj_status_t init_parser()
     status = pjsip_register_hdr_parser( "To", "t", &parse_hdr_to);
     PJ_ASSERT_RETURN(status == PJ_SUCCESS, status);
 
-    status = pjsip_register_hdr_parser( "Unsupported", NULL, 
-                                        &parse_hdr_unsupported);
+    status = register_hdr_parser( "Unsupported", NULL, 
+				  &parse_hdr_unsupported,
+				  PJSIP_H_UNSUPPORTED, PJ_TRUE);
     PJ_ASSERT_RETURN(status == PJ_SUCCESS, status);
 
-    status = pjsip_register_hdr_parser( "Via", "v", &parse_hdr_via);
+    /* Only Via headers after the first one are parsed lazily */
+    status = register_hdr_parser( "Via", "v", &parse_hdr_via,
+				  PJSIP_H_VIA, PJ_TRUE);
     PJ_ASSERT_RETURN(status == PJ_SUCCESS, status);
 
     /* 
@@ -494,6 +528,7 @@ void deinit_sip_parser(void)
 	/* Clear header handlers */
 	pj_bzero(handler, sizeof(handler));
 	handler_count = 0;
+	lazy_name_count = 0;
 
 	/* Clear URI handlers */
 	pj_bzero(uri_handler, sizeof(uri_handler));
@@ -538,7 +573,9 @@ PJ_INLINE(int) compare_handler( const handler_rec *r1,
 
 /* Register one handler for one header name. */
 static pj_status_t int_register_parser( const char *name, 
-                                        pjsip_parse_hdr_func *fptr )
+                                        pjsip_parse_hdr_func *fptr,
+					const pj_str_t *lname,
+					pjsip_hdr_e htype)
 {
     unsigned	pos;
     handler_rec rec;
@@ -559,6 +596,9 @@ static pj_status_t int_register_parser( const char *name,
     pj_memcpy(rec.hname, name, rec.hname_len);
     rec.hname[rec.hname_len] = '\0';
 
+    rec.lname = lname;
+    rec.htype = htype;
+
     /* Calculate hash value. */
     rec.hname_hash = pj_hash_calc(0, rec.hname, rec.hname_len);
 
@@ -591,12 +631,15 @@ static pj_status_t int_register_parser( const char *name,
 /* Register parser handler. If both header name and short name are valid,
  * then two instances of handler will be registered.
  */
-PJ_DEF(pj_status_t) pjsip_register_hdr_parser( const char *hname,
-					       const char *hshortname,
-					       pjsip_parse_hdr_func *fptr)
+static pj_status_t register_hdr_parser( const char *hname,
+					const char *hshortname,
+					pjsip_parse_hdr_func *fptr,
+					pjsip_hdr_e htype,
+					pj_bool_t lazy)
 {
     unsigned i, len;
     char hname_lcase[PJSIP_MAX_HNAME_LEN+1];
+    const pj_str_t *lname = NULL;
     pj_status_t status;
 
     /* Check that name is not too long */
@@ -606,8 +649,24 @@ PJ_DEF(pj_status_t) pjsip_register_hdr_parser( const char *hname,
 	return PJ_ENAMETOOLONG;
     }
 
+    /* Keep the full name for the lazy headers */
+    if (lazy) {
+	lazy_name_rec *lrec;
+
+	if (lazy_name_count >= PJ_ARRAY_SIZE(lazy_name)) {
+	    pj_assert(!"Too many lazy handlers!");
+	    return PJ_ETOOMANY;
+	}
+	lrec = &lazy_name[lazy_name_count];
+	pj_memcpy(lrec->buf, hname, len);
+	lrec->buf[len] = '\0';
+	lrec->name.ptr = lrec->buf;
+	lrec->name.slen = len;
+	lname = &lrec->name;
+    }
+
     /* Register the normal Mixed-Case name */
-    status = int_register_parser(hname, fptr);
+    status = int_register_parser(hname, fptr, lname, htype);
     if (status != PJ_SUCCESS) {
 	return status;
     }
@@ -619,7 +678,7 @@ PJ_DEF(pj_status_t) pjsip_register_hdr_parser( const char *hname,
     hname_lcase[len] = '\0';
 
     /* Register the lower-case version of the name */
-    status = int_register_parser(hname_lcase, fptr);
+    status = int_register_parser(hname_lcase, fptr, lname, htype);
     if (status != PJ_SUCCESS) {
 	return status;
     }
@@ -627,17 +686,37 @@ PJ_DEF(pj_status_t) pjsip_register_hdr_parser( const char *hname,
 
     /* Register the shortname version of the name */
     if (hshortname) {
-        status = int_register_parser(hshortname, fptr);
+        status = int_register_parser(hshortname, fptr, lname, htype);
         if (status != PJ_SUCCESS) 
 	    return status;
     }
+
+    if (lazy)
+	++lazy_name_count;
+
     return PJ_SUCCESS;
 }
 
+PJ_DEF(pj_status_t) pjsip_register_hdr_parser( const char *hname,
+					       const char *hshortname,
+					       pjsip_parse_hdr_func *fptr)
+{
+    return register_hdr_parser(hname, hshortname, fptr, PJSIP_H_OTHER,
+			       PJ_FALSE);
+}
+
+PJ_DEF(pj_status_t) pjsip_register_lazy_hdr_parser(const char *hname,
+						   const char *hshortname,
+						   pjsip_parse_hdr_func *fptr)
+{
+    return register_hdr_parser(hname, hshortname, fptr, PJSIP_H_OTHER,
+			       PJ_TRUE);
+}
+
 
 /* Find handler to parse the header name. */
-static pjsip_parse_hdr_func * find_handler_imp(pj_uint32_t  hash, 
-					       const pj_str_t *hname)
+static const handler_rec* find_handler_imp(pj_uint32_t  hash, 
+					   const pj_str_t *hname)
 {
     handler_rec *first;
     int		 comp;
@@ -663,17 +742,17 @@ static pjsip_parse_hdr_func * find_handler_imp(pj_uint32_t  hash,
 	}
     }
 
-    return comp==0 ? first->handler : NULL;
+    return comp==0 ? first : NULL;
 }
 
 
-/* Find handler to parse the header name. */
-static pjsip_parse_hdr_func* find_handler(const pj_str_t *hname)
+/* Find handler record to parse the header name. */
+static const handler_rec* find_handler_rec(const pj_str_t *hname)
 {
     pj_uint32_t hash;
     char hname_copy[PJSIP_MAX_HNAME_LEN];
     pj_str_t tmp;
-    pjsip_parse_hdr_func *handler;
+    const handler_rec *rec;
 
     if (hname->slen >= PJSIP_MAX_HNAME_LEN) {
 	/* Guaranteed not to be able to find handler. */
@@ -682,9 +761,9 @@ static pjsip_parse_hdr_func* find_handler(const pj_str_t *hname)
 
     /* First, common case, try to find handler with exact name */
     hash = pj_hash_calc(0, hname->ptr, hname->slen);
-    handler = find_handler_imp(hash, hname);
-    if (handler)
-	return handler;
+    rec = find_handler_imp(hash, hname);
+    if (rec)
+	return rec;
 
 
     /* If not found, try converting the header name to lowercase and
@@ -696,6 +775,13 @@ static pjsip_parse_hdr_func* find_handler(const pj_str_t *hname)
     return find_handler_imp(hash, &tmp);
 }
 
+/* Find handler to parse the header name. */
+static pjsip_parse_hdr_func* find_handler(const pj_str_t *hname)
+{
+    const handler_rec *rec = find_handler_rec(hname);
+    return rec ? rec->handler : NULL;
+}
+
 
 /* Find URI handler. */
 static pjsip_parse_uri_func* find_uri_handler(const pj_str_t *scheme)
@@ -938,6 +1024,7 @@ static pjsip_msg *int_parse_msg( pjsip_parse_ctx *ctx,
 				 pjsip_parser_err_report *err_list)
 {
     pj_bool_t parsing_headers;
+    pj_bool_t lazy_parse, via_parsed;
     pjsip_msg *msg = NULL;
     pj_str_t hname;
     pjsip_ctype_hdr *ctype_hdr = NULL;
@@ -946,6 +1033,8 @@ static pjsip_msg *int_parse_msg( pjsip_parse_ctx *ctx,
     PJ_USE_EXCEPTION;
 
     parsing_headers = PJ_FALSE;
+    lazy_parse = pjsip_cfg()->endpt.lazy_hdr_parse;
+    via_parsed = PJ_FALSE;
 
 retry_parse:
     PJ_TRY 
@@ -979,7 +1068,7 @@ retry_parse:
 parse_headers:
 	/* Parse headers. */
 	do {
-	    pjsip_parse_hdr_func * handler;
+	    const handler_rec *rec;
 	    pjsip_hdr *hdr = NULL;
 
 	    /* Init hname just in case parsing fails.
@@ -994,14 +1083,21 @@ parse_headers:
 	    }
 	    
 	    /* Find handler. */
-	    handler = find_handler(&hname);
+	    rec = find_handler_rec(&hname);
 	    
 	    /* Call the handler if found.
 	     * If no handler is found, then treat the header as generic
 	     * hname/hvalue pair.
+	     * The first Via is always parsed since the transaction layer
+	     * needs it for every message.
 	     */
-	    if (handler) {
-		hdr = (*handler)(ctx);
+	    if (rec && rec->lname && lazy_parse &&
+		(rec->htype != PJSIP_H_VIA || via_parsed))
+	    {
+		hdr = parse_hdr_lazy(ctx, rec, &hname);
+
+	    } else if (rec) {
+		hdr = (*rec->handler)(ctx);
 
 		/* Note:
 		 *  hdr MAY BE NULL, if parsing does not yield a new header
@@ -1015,6 +1111,8 @@ parse_headers:
 		 */
 		if (hdr && hdr->type == PJSIP_H_CONTENT_TYPE) {
 		    ctype_hdr = (pjsip_ctype_hdr*)hdr;
+		} else if (hdr && hdr->type == PJSIP_H_VIA) {
+		    via_parsed = PJ_TRUE;
 		}
 
 	    } else {
@@ -2229,6 +2327,84 @@ static pjsip_hdr* parse_hdr_generic_string( pjsip_parse_ctx *ctx )
 
 }
 
+/* Record the raw value of a header to be parsed when it is accessed. */
+static pjsip_hdr* parse_hdr_lazy( pjsip_parse_ctx *ctx,
+				  const handler_rec *rec,
+				  const pj_str_t *hname)
+{
+    pj_scanner *scanner = ctx->scanner;
+    pj_str_t hvalue;
+    char *p = scanner->curptr;
+
+    /* Skip the value up to the end of the line, including the
+     * continuation lines, without tokenizing it.
+     */
+    for (;;) {
+	char *next;
+
+	while (p != scanner->end && !IS_NEWLINE(*p))
+	    ++p;
+
+	next = p;
+	if (next != scanner->end && *next == '\r')
+	    ++next;
+	if (next != scanner->end && *next == '\n')
+	    ++next;
+	if (next == p || next == scanner->end || !IS_SPACE(*next))
+	    break;
+
+	++scanner->line;
+	scanner->start_line = p = next;
+    }
+    hvalue.ptr = scanner->curptr;
+    hvalue.slen = p - scanner->curptr;
+    scanner->curptr = p;
+
+    parse_hdr_end(scanner);
+
+    /* Use the full header name so that lookup by name works for compact
+     * and lowercase names too.
+     */
+    return (pjsip_hdr*)pjsip_lazy_hdr_create(ctx->pool, rec->lname, hname, 
+					     &hvalue, rec->htype,
+					     rec->handler);
+}
+
+/* Parse lazy header. */
+PJ_DEF(pjsip_hdr*) pjsip_parse_lazy_hdr( pjsip_lazy_hdr *lhdr )
+{
+    pj_scanner scanner;
+    pjsip_hdr *hdr = NULL;
+    pjsip_parse_ctx context;
+    PJ_USE_EXCEPTION;
+
+    pj_scan_init(&scanner, lhdr->hvalue.ptr, lhdr->hvalue.slen, 
+		 PJ_SCAN_AUTOSKIP_WS_HEADER, &on_syntax_error);
+
+    context.scanner = &scanner;
+    context.pool = lhdr->pool;
+    context.rdata = NULL;
+
+    PJ_TRY {
+	hdr = (*lhdr->parse)(&context);
+    }
+    PJ_CATCH_ANY {
+	hdr = NULL;
+	PJ_LOG(4,(THIS_FILE, "Error parsing %.*s header, header is dropped",
+		  (int)lhdr->name.slen, lhdr->name.ptr));
+    }
+    PJ_END
+
+    pj_scan_fini(&scanner);
+
+    /* Replace the lazy header with the parsed header(s). */
+    if (hdr)
+	pj_list_insert_nodes_before(lhdr, hdr);
+    pj_list_erase(lhdr);
+
+    return hdr;
+}
+
 /* Public function to parse a header value. */
 PJ_DEF(void*) pjsip_parse_hdr( pj_pool_t *pool, const pj_str_t *hname,
 			       char *buf, pj_size_t size, int *parsed_len )
@@ -77,6 +77,18 @@ static pjsip_module mod_msg_print =
     NULL,				/* on_tsx_state()		    */
 };
 
+/*
+ * Receive buffer lent to stream transports. The rdata must be the first
+ * member, so that the item can be found from the rdata when it is given
+ * back.
+ */
+typedef struct rx_slab_item
+{
+    pjsip_rx_data	    rdata;
+    struct rx_slab_item    *next;	/* Next free buffer		    */
+    struct rx_slab_item    *next_all;	/* Next allocated buffer	    */
+} rx_slab_item;
+
 /*
  * Transport manager.
  */
@@ -92,6 +104,13 @@ struct pjsip_tpmgr
     void           (*on_rx_msg)(pjsip_endpoint*, pj_status_t, pjsip_rx_data*);
     pj_status_t	   (*on_tx_msg)(pjsip_endpoint*, pjsip_tx_data*);
     pjsip_tp_state_callback tp_state_cb;
+
+    /* Receive buffers for stream transports */
+    pj_pool_t	    *rx_slab_pool;
+    pj_lock_t	    *rx_slab_lock;
+    rx_slab_item    *rx_slab_free;
+    rx_slab_item    *rx_slab_all;
+    pjsip_rx_slab_stat rx_slab_stat;
 };
 
 
@@ -1139,6 +1158,16 @@ PJ_DEF(pj_status_t) pjsip_tpmgr_create( pj_pool_t *pool,
 	return status;
 #endif
 
+    status = pj_lock_create_simple_mutex(pool, "rxs%p", &mgr->rx_slab_lock);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    mgr->rx_slab_pool = pjsip_endpt_create_pool(endpt, "rxs%p",
+						PJSIP_POOL_LEN_TRANSPORT,
+						PJSIP_POOL_INC_TRANSPORT);
+    if (!mgr->rx_slab_pool)
+	return PJ_ENOMEM;
+
     /* Set transport state callback */
     status = pjsip_tpmgr_set_state_cb(mgr, &tp_state_callback);
     if (status != PJ_SUCCESS)
@@ -1408,6 +1437,22 @@ PJ_DEF(pj_status_t) pjsip_tpmgr_destroy( pjsip_tpmgr *mgr )
     pj_lock_release(mgr->lock);
     pj_lock_destroy(mgr->lock);
 
+    /* Release receive buffers */
+    if (mgr->rx_slab_stat.in_use) {
+	PJ_LOG(3,(THIS_FILE, "Warning: %d receive buffer(s) not released!",
+		  mgr->rx_slab_stat.in_use));
+    }
+    while (mgr->rx_slab_all) {
+	rx_slab_item *item = mgr->rx_slab_all;
+
+	mgr->rx_slab_all = item->next_all;
+	pjsip_endpt_release_pool(endpt, item->rdata.tp_info.pool);
+    }
+    mgr->rx_slab_free = NULL;
+    pjsip_endpt_release_pool(endpt, mgr->rx_slab_pool);
+    mgr->rx_slab_pool = NULL;
+    pj_lock_destroy(mgr->rx_slab_lock);
+
     /* Unregister mod_msg_print. */
     if (mod_msg_print.id != -1) {
 	pjsip_endpt_unregister_module(endpt, &mod_msg_print);
@@ -1637,6 +1682,126 @@ finish_process_fragment:
     return total_processed;
 }
 
+/* Allocate more receive buffers. Must be called with rx_slab_lock held. */
+static pj_status_t rx_slab_grow(pjsip_tpmgr *mgr)
+{
+    rx_slab_item *items;
+    unsigned i, cnt = PJSIP_RX_SLAB_CHUNK_CNT;
+
+    if (PJSIP_RX_SLAB_MAX_CNT &&
+	mgr->rx_slab_stat.total + cnt > PJSIP_RX_SLAB_MAX_CNT)
+    {
+	cnt = PJSIP_RX_SLAB_MAX_CNT - mgr->rx_slab_stat.total;
+	if (cnt == 0)
+	    return PJ_ETOOMANY;
+    }
+
+    items = (rx_slab_item*) pj_pool_calloc(mgr->rx_slab_pool, cnt,
+					   sizeof(rx_slab_item));
+    if (!items)
+	return PJ_ENOMEM;
+
+    for (i=0; i<cnt; ++i) {
+	rx_slab_item *item = &items[i];
+
+	item->rdata.tp_info.pool = pjsip_endpt_create_pool(mgr->endpt,
+							   "rtd%p",
+							   PJSIP_POOL_RDATA_LEN,
+							   PJSIP_POOL_RDATA_INC);
+	if (!item->rdata.tp_info.pool)
+	    break;
+
+	item->rdata.tp_info.op_key.rdata = &item->rdata;
+	pj_ioqueue_op_key_init(&item->rdata.tp_info.op_key.op_key,
+			       sizeof(pj_ioqueue_op_key_t));
+
+	item->next = mgr->rx_slab_free;
+	mgr->rx_slab_free = item;
+	item->next_all = mgr->rx_slab_all;
+	mgr->rx_slab_all = item;
+    }
+
+    mgr->rx_slab_stat.total += i;
+
+    return i ? PJ_SUCCESS : PJ_ENOMEM;
+}
+
+/*
+ * pjsip_tpmgr_acquire_rdata()
+ */
+PJ_DEF(pj_status_t) pjsip_tpmgr_acquire_rdata(pjsip_tpmgr *mgr,
+					      pjsip_transport *tp,
+					      pjsip_rx_data **p_rdata)
+{
+    rx_slab_item *item;
+    pj_status_t status;
+
+    PJ_ASSERT_RETURN(mgr && tp && p_rdata, PJ_EINVAL);
+
+    pj_lock_acquire(mgr->rx_slab_lock);
+
+    if (mgr->rx_slab_free == NULL) {
+	status = rx_slab_grow(mgr);
+	if (status != PJ_SUCCESS) {
+	    ++mgr->rx_slab_stat.fail_cnt;
+	    pj_lock_release(mgr->rx_slab_lock);
+	    return status;
+	}
+    }
+
+    item = mgr->rx_slab_free;
+    mgr->rx_slab_free = item->next;
+    item->next = NULL;
+
+    if (++mgr->rx_slab_stat.in_use > mgr->rx_slab_stat.peak)
+	mgr->rx_slab_stat.peak = mgr->rx_slab_stat.in_use;
+
+    pj_lock_release(mgr->rx_slab_lock);
+
+    item->rdata.tp_info.transport = tp;
+    item->rdata.tp_info.tp_data = NULL;
+    item->rdata.pkt_info.len = 0;
+
+    *p_rdata = &item->rdata;
+    return PJ_SUCCESS;
+}
+
+/*
+ * pjsip_tpmgr_release_rdata()
+ */
+PJ_DEF(void) pjsip_tpmgr_release_rdata(pjsip_tpmgr *mgr,
+				       pjsip_rx_data *rdata)
+{
+    rx_slab_item *item = (rx_slab_item*) rdata;
+
+    PJ_ASSERT_ON_FAIL(mgr && rdata, return);
+
+    pj_pool_reset(rdata->tp_info.pool);
+    rdata->tp_info.transport = NULL;
+    rdata->tp_info.tp_data = NULL;
+
+    pj_lock_acquire(mgr->rx_slab_lock);
+    item->next = mgr->rx_slab_free;
+    mgr->rx_slab_free = item;
+    --mgr->rx_slab_stat.in_use;
+    pj_lock_release(mgr->rx_slab_lock);
+}
+
+/*
+ * pjsip_tpmgr_get_rx_slab_stat()
+ */
+PJ_DEF(pj_status_t) pjsip_tpmgr_get_rx_slab_stat(pjsip_tpmgr *mgr,
+						 pjsip_rx_slab_stat *stat)
+{
+    PJ_ASSERT_RETURN(mgr && stat, PJ_EINVAL);
+
+    pj_lock_acquire(mgr->rx_slab_lock);
+    pj_memcpy(stat, &mgr->rx_slab_stat, sizeof(*stat));
+    pj_lock_release(mgr->rx_slab_lock);
+
+    return PJ_SUCCESS;
+}
+
 
 /*
  * pjsip_tpmgr_acquire_transport()
@@ -1848,6 +2013,11 @@ PJ_DEF(void) pjsip_tpmgr_dump_transports(pjsip_tpmgr *mgr)
 	      pj_atomic_get(mgr->tdata_counter)));
 #endif
 
+    PJ_LOG(3,(THIS_FILE, " Receive buffers: %u allocated, %u in use "
+	      "(peak %u), %u refused",
+	      mgr->rx_slab_stat.total, mgr->rx_slab_stat.in_use,
+	      mgr->rx_slab_stat.peak, mgr->rx_slab_stat.fail_cnt));
+
     PJ_LOG(3, (THIS_FILE, " Dumping listeners:"));
     factory = mgr->factory_list.next;
     while (factory != &mgr->factory_list) {
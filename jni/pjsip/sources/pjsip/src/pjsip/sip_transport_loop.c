@@ -380,6 +380,9 @@ PJ_DEF(pj_status_t) pjsip_loop_start( pjsip_endpoint *endpt,
     loop->base.local_name.port = 
 	pjsip_transport_get_default_port_for_type((pjsip_transport_type_e)
 						  loop->base.key.type);
+    pj_sockaddr_in_init(&loop->base.local_addr.ipv4, 
+			&loop->base.local_name.host,
+			(pj_uint16_t)loop->base.local_name.port);
     loop->base.addr_len = sizeof(pj_sockaddr_in);
     loop->base.dir = PJSIP_TP_DIR_NONE;
     loop->base.endpt = endpt;
@@ -108,9 +108,10 @@ struct tcp_transport
 
     /* TCP transport can only have  one rdata!
      * Otherwise chunks of incoming PDU may be received on different
-     * buffer.
+     * buffer. The rdata is borrowed from the transport manager only
+     * while there is unprocessed data.
      */
-    pjsip_rx_data	     rdata;
+    pjsip_rx_data	    *rdata;
 
     /* Pending transmission list. */
     struct delayed_tdata     delayed_list;
@@ -752,11 +753,6 @@ static pj_status_t tcp_destroy(pjsip_transport *transport,
 	on_data_sent(tcp->asock, op_key, -reason);
     }
 
-    if (tcp->rdata.tp_info.pool) {
-	pj_pool_release(tcp->rdata.tp_info.pool);
-	tcp->rdata.tp_info.pool = NULL;
-    }
-
     if (tcp->asock) {
 	pj_activesock_close(tcp->asock);
 	tcp->asock = NULL;
@@ -766,6 +762,11 @@ static pj_status_t tcp_destroy(pjsip_transport *transport,
 	tcp->sock = PJ_INVALID_SOCKET;
     }
 
+    if (tcp->rdata) {
+	pjsip_tpmgr_release_rdata(tcp->base.tpmgr, tcp->rdata);
+	tcp->rdata = NULL;
+    }
+
     if (tcp->base.lock) {
 	pj_lock_destroy(tcp->base.lock);
 	tcp->base.lock = NULL;
@@ -804,47 +805,50 @@ static pj_status_t tcp_destroy(pjsip_transport *transport,
 
 
 /*
- * This utility function creates receive data buffers and start
- * asynchronous recv() operations from the socket. It is called after
- * accept() or connect() operation complete.
+ * This utility function borrows receive data buffer from the transport
+ * manager. It is called when data arrives and there is no unprocessed
+ * data from previous reads.
  */
-static pj_status_t tcp_start_read(struct tcp_transport *tcp)
+static pj_status_t tcp_acquire_rdata(struct tcp_transport *tcp)
 {
-    pj_pool_t *pool;
-    pj_ssize_t size;
+    pjsip_rx_data *rdata;
     pj_sockaddr *rem_addr;
-    void *readbuf[1];
     pj_status_t status;
 
-    /* Init rdata */
-    pool = pjsip_endpt_create_pool(tcp->base.endpt,
-				   "rtd%p",
-				   PJSIP_POOL_RDATA_LEN,
-				   PJSIP_POOL_RDATA_INC);
-    if (!pool) {
-	tcp_perror(tcp->base.obj_name, "Unable to create pool", PJ_ENOMEM);
-	return PJ_ENOMEM;
-    }
-
-    tcp->rdata.tp_info.pool = pool;
+    status = pjsip_tpmgr_acquire_rdata(tcp->base.tpmgr, &tcp->base, &rdata);
+    if (status != PJ_SUCCESS)
+	return status;
 
-    tcp->rdata.tp_info.transport = &tcp->base;
-    tcp->rdata.tp_info.tp_data = tcp;
-    tcp->rdata.tp_info.op_key.rdata = &tcp->rdata;
-    pj_ioqueue_op_key_init(&tcp->rdata.tp_info.op_key.op_key, 
-			   sizeof(pj_ioqueue_op_key_t));
+    rdata->tp_info.tp_data = tcp;
 
-    tcp->rdata.pkt_info.src_addr = tcp->base.key.rem_addr;
-    tcp->rdata.pkt_info.src_addr_len = sizeof(tcp->rdata.pkt_info.src_addr);
+    rdata->pkt_info.src_addr = tcp->base.key.rem_addr;
+    rdata->pkt_info.src_addr_len = sizeof(rdata->pkt_info.src_addr);
     rem_addr = &tcp->base.key.rem_addr;
-    pj_sockaddr_print(rem_addr, tcp->rdata.pkt_info.src_name,
-                      sizeof(tcp->rdata.pkt_info.src_name), 0);
-    tcp->rdata.pkt_info.src_port = pj_sockaddr_get_port(rem_addr);
-
-    size = sizeof(tcp->rdata.pkt_info.packet);
-    readbuf[0] = tcp->rdata.pkt_info.packet;
-    status = pj_activesock_start_read2(tcp->asock, tcp->base.pool, size,
-				       readbuf, 0);
+    pj_sockaddr_print(rem_addr, rdata->pkt_info.src_name,
+                      sizeof(rdata->pkt_info.src_name), 0);
+    rdata->pkt_info.src_port = pj_sockaddr_get_port(rem_addr);
+
+    tcp->rdata = rdata;
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * This utility function creates read buffer and start asynchronous
+ * recv() operations from the socket. It is called after accept() or
+ * connect() operation complete.
+ */
+static pj_status_t tcp_start_read(struct tcp_transport *tcp)
+{
+    void *readbuf[1];
+    pj_status_t status;
+
+    /* The read buffer is small, data is copied to the rdata borrowed
+     * from the transport manager, see on_data_read().
+     */
+    readbuf[0] = pj_pool_alloc(tcp->base.pool, PJSIP_TCP_READ_BUF_LEN);
+    status = pj_activesock_start_read2(tcp->asock, tcp->base.pool,
+				       PJSIP_TCP_READ_BUF_LEN, readbuf, 0);
     if (status != PJ_SUCCESS && status != PJ_EPENDING) {
 	PJ_LOG(4, (tcp->base.obj_name, 
 		   "pj_activesock_start_read() error, status=%d", 
@@ -1243,10 +1247,7 @@ static pj_bool_t on_data_read(pj_activesock_t *asock,
     struct tcp_transport *tcp;
     pjsip_rx_data *rdata;
 
-    PJ_UNUSED_ARG(data);
-
     tcp = (struct tcp_transport*) pj_activesock_get_user_data(asock);
-    rdata = &tcp->rdata;
 
     /* Don't do anything if transport is closing. */
     if (tcp->is_closing) {
@@ -1258,34 +1259,69 @@ static pj_bool_t on_data_read(pj_activesock_t *asock,
      * to be parsed.
      */
     if (status == PJ_SUCCESS) {
-	pj_size_t size_eaten;
 
 	/* Mark this as an activity */
 	pj_gettimeofday(&tcp->last_activity);
 
-	pj_assert((void*)rdata->pkt_info.packet == data);
-
-	/* Init pkt_info part. */
-	rdata->pkt_info.len = size;
-	rdata->pkt_info.zero = 0;
-	pj_gettimeofday(&rdata->pkt_info.timestamp);
-
-	/* Report to transport manager.
-	 * The transport manager will tell us how many bytes of the packet
-	 * have been processed (as valid SIP message).
+	/* All data is taken from the read buffer, unprocessed data is
+	 * kept in the rdata.
 	 */
-	size_eaten = 
-	    pjsip_tpmgr_receive_packet(rdata->tp_info.transport->tpmgr, 
-				       rdata);
-
-	pj_assert(size_eaten <= (pj_size_t)rdata->pkt_info.len);
-
-	/* Move unprocessed data to the front of the buffer */
-	*remainder = size - size_eaten;
-	if (*remainder > 0 && *remainder != size) {
-	    pj_memmove(rdata->pkt_info.packet,
-		       rdata->pkt_info.packet + size_eaten,
-		       *remainder);
+	*remainder = 0;
+
+	while (size > 0) {
+	    pj_size_t len, size_eaten;
+
+	    if (!tcp->rdata) {
+		status = tcp_acquire_rdata(tcp);
+		if (status != PJ_SUCCESS) {
+		    tcp_perror(tcp->base.obj_name,
+			       "Unable to get receive buffer", status);
+		    tcp_init_shutdown(tcp, status);
+		    return PJ_FALSE;
+		}
+	    }
+	    rdata = tcp->rdata;
+
+	    /* Append to the unprocessed data */
+	    len = PJSIP_MAX_PKT_LEN - rdata->pkt_info.len;
+	    if (len > size)
+		len = size;
+	    pj_memcpy(rdata->pkt_info.packet + rdata->pkt_info.len, data, len);
+	    data = (char*)data + len;
+	    size -= len;
+	    len += rdata->pkt_info.len;
+
+	    /* Init pkt_info part. */
+	    rdata->pkt_info.len = len;
+	    rdata->pkt_info.zero = 0;
+	    pj_gettimeofday(&rdata->pkt_info.timestamp);
+
+	    /* Report to transport manager.
+	     * The transport manager will tell us how many bytes of the packet
+	     * have been processed (as valid SIP message).
+	     */
+	    size_eaten = 
+		pjsip_tpmgr_receive_packet(rdata->tp_info.transport->tpmgr, 
+					   rdata);
+
+	    pj_assert(size_eaten <= len);
+
+	    if (size_eaten == len) {
+		/* Nothing left, give the buffer back */
+		pjsip_tpmgr_release_rdata(tcp->base.tpmgr, rdata);
+		tcp->rdata = NULL;
+	    } else {
+		/* Move unprocessed data to the front of the buffer */
+		if (size_eaten > 0) {
+		    pj_memmove(rdata->pkt_info.packet,
+			       rdata->pkt_info.packet + size_eaten,
+			       len - size_eaten);
+		}
+		rdata->pkt_info.len = len - size_eaten;
+
+		/* Reset pool. */
+		pj_pool_reset(rdata->tp_info.pool);
+	    }
 	}
 
     } else {
@@ -1299,9 +1335,6 @@ static pj_bool_t on_data_read(pj_activesock_t *asock,
 
     }
 
-    /* Reset pool. */
-    pj_pool_reset(rdata->tp_info.pool);
-
     return PJ_TRUE;
 }
 
@@ -100,9 +100,10 @@ struct tls_transport
 
     /* TLS transport can only have  one rdata!
      * Otherwise chunks of incoming PDU may be received on different
-     * buffer.
+     * buffer. The rdata is borrowed from the transport manager only
+     * while there is unprocessed data.
      */
-    pjsip_rx_data	     rdata;
+    pjsip_rx_data	    *rdata;
 
     /* Pending transmission list. */
     struct delayed_tdata     delayed_list;
@@ -776,15 +777,16 @@ static pj_status_t tls_destroy(pjsip_transport *transport,
 	on_data_sent(tls->ssock, op_key, -reason);
     }
 
-    if (tls->rdata.tp_info.pool) {
-	pj_pool_release(tls->rdata.tp_info.pool);
-	tls->rdata.tp_info.pool = NULL;
-    }
-
     if (tls->ssock) {
 	pj_ssl_sock_close(tls->ssock);
 	tls->ssock = NULL;
     }
+
+    if (tls->rdata) {
+	pjsip_tpmgr_release_rdata(tls->base.tpmgr, tls->rdata);
+	tls->rdata = NULL;
+    }
+
     if (tls->base.lock) {
 	pj_lock_destroy(tls->base.lock);
 	tls->base.lock = NULL;
@@ -823,47 +825,50 @@ static pj_status_t tls_destroy(pjsip_transport *transport,
 
 
 /*
- * This utility function creates receive data buffers and start
- * asynchronous recv() operations from the socket. It is called after
- * accept() or connect() operation complete.
+ * This utility function borrows receive data buffer from the transport
+ * manager. It is called when data arrives and there is no unprocessed
+ * data from previous reads.
  */
-static pj_status_t tls_start_read(struct tls_transport *tls)
+static pj_status_t tls_acquire_rdata(struct tls_transport *tls)
 {
-    pj_pool_t *pool;
-    pj_ssize_t size;
+    pjsip_rx_data *rdata;
     pj_sockaddr *rem_addr;
-    void *readbuf[1];
     pj_status_t status;
 
-    /* Init rdata */
-    pool = pjsip_endpt_create_pool(tls->base.endpt,
-				   "rtd%p",
-				   PJSIP_POOL_RDATA_LEN,
-				   PJSIP_POOL_RDATA_INC);
-    if (!pool) {
-	tls_perror(tls->base.obj_name, "Unable to create pool", PJ_ENOMEM);
-	return PJ_ENOMEM;
-    }
-
-    tls->rdata.tp_info.pool = pool;
+    status = pjsip_tpmgr_acquire_rdata(tls->base.tpmgr, &tls->base, &rdata);
+    if (status != PJ_SUCCESS)
+	return status;
 
-    tls->rdata.tp_info.transport = &tls->base;
-    tls->rdata.tp_info.tp_data = tls;
-    tls->rdata.tp_info.op_key.rdata = &tls->rdata;
-    pj_ioqueue_op_key_init(&tls->rdata.tp_info.op_key.op_key, 
-			   sizeof(pj_ioqueue_op_key_t));
+    rdata->tp_info.tp_data = tls;
 
-    tls->rdata.pkt_info.src_addr = tls->base.key.rem_addr;
-    tls->rdata.pkt_info.src_addr_len = sizeof(tls->rdata.pkt_info.src_addr);
+    rdata->pkt_info.src_addr = tls->base.key.rem_addr;
+    rdata->pkt_info.src_addr_len = sizeof(rdata->pkt_info.src_addr);
     rem_addr = &tls->base.key.rem_addr;
-    pj_sockaddr_print(rem_addr, tls->rdata.pkt_info.src_name,
-                          sizeof(tls->rdata.pkt_info.src_name), 0);
-    tls->rdata.pkt_info.src_port = pj_sockaddr_get_port(rem_addr);
-
-    size = sizeof(tls->rdata.pkt_info.packet);
-    readbuf[0] = tls->rdata.pkt_info.packet;
-    status = pj_ssl_sock_start_read2(tls->ssock, tls->base.pool, size,
-				     readbuf, 0);
+    pj_sockaddr_print(rem_addr, rdata->pkt_info.src_name,
+                          sizeof(rdata->pkt_info.src_name), 0);
+    rdata->pkt_info.src_port = pj_sockaddr_get_port(rem_addr);
+
+    tls->rdata = rdata;
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * This utility function creates read buffer and start asynchronous
+ * recv() operations from the socket. It is called after accept() or
+ * connect() operation complete.
+ */
+static pj_status_t tls_start_read(struct tls_transport *tls)
+{
+    void *readbuf[1];
+    pj_status_t status;
+
+    /* The read buffer is small, data is copied to the rdata borrowed
+     * from the transport manager, see on_data_read().
+     */
+    readbuf[0] = pj_pool_alloc(tls->base.pool, PJSIP_TCP_READ_BUF_LEN);
+    status = pj_ssl_sock_start_read2(tls->ssock, tls->base.pool,
+				     PJSIP_TCP_READ_BUF_LEN, readbuf, 0);
     if (status != PJ_SUCCESS && status != PJ_EPENDING) {
 	PJ_LOG(4, (tls->base.obj_name, 
 		   "pj_ssl_sock_start_read() error, status=%d", 
@@ -1361,10 +1366,7 @@ static pj_bool_t on_data_read(pj_ssl_sock_t *ssock,
     struct tls_transport *tls;
     pjsip_rx_data *rdata;
 
-    PJ_UNUSED_ARG(data);
-
     tls = (struct tls_transport*) pj_ssl_sock_get_user_data(ssock);
-    rdata = &tls->rdata;
 
     /* Don't do anything if transport is closing. */
     if (tls->is_closing) {
@@ -1376,34 +1378,69 @@ static pj_bool_t on_data_read(pj_ssl_sock_t *ssock,
      * to be parsed.
      */
     if (status == PJ_SUCCESS) {
-	pj_size_t size_eaten;
 
 	/* Mark this as an activity */
 	pj_gettimeofday(&tls->last_activity);
 
-	pj_assert((void*)rdata->pkt_info.packet == data);
-
-	/* Init pkt_info part. */
-	rdata->pkt_info.len = size;
-	rdata->pkt_info.zero = 0;
-	pj_gettimeofday(&rdata->pkt_info.timestamp);
-
-	/* Report to transport manager.
-	 * The transport manager will tell us how many bytes of the packet
-	 * have been processed (as valid SIP message).
+	/* All data is taken from the read buffer, unprocessed data is
+	 * kept in the rdata.
 	 */
-	size_eaten = 
-	    pjsip_tpmgr_receive_packet(rdata->tp_info.transport->tpmgr, 
-				       rdata);
-
-	pj_assert(size_eaten <= (pj_size_t)rdata->pkt_info.len);
-
-	/* Move unprocessed data to the front of the buffer */
-	*remainder = size - size_eaten;
-	if (*remainder > 0 && *remainder != size) {
-	    pj_memmove(rdata->pkt_info.packet,
-		       rdata->pkt_info.packet + size_eaten,
-		       *remainder);
+	*remainder = 0;
+
+	while (size > 0) {
+	    pj_size_t len, size_eaten;
+
+	    if (!tls->rdata) {
+		status = tls_acquire_rdata(tls);
+		if (status != PJ_SUCCESS) {
+		    tls_perror(tls->base.obj_name,
+			       "Unable to get receive buffer", status);
+		    tls_init_shutdown(tls, status);
+		    return PJ_FALSE;
+		}
+	    }
+	    rdata = tls->rdata;
+
+	    /* Append to the unprocessed data */
+	    len = PJSIP_MAX_PKT_LEN - rdata->pkt_info.len;
+	    if (len > size)
+		len = size;
+	    pj_memcpy(rdata->pkt_info.packet + rdata->pkt_info.len, data, len);
+	    data = (char*)data + len;
+	    size -= len;
+	    len += rdata->pkt_info.len;
+
+	    /* Init pkt_info part. */
+	    rdata->pkt_info.len = len;
+	    rdata->pkt_info.zero = 0;
+	    pj_gettimeofday(&rdata->pkt_info.timestamp);
+
+	    /* Report to transport manager.
+	     * The transport manager will tell us how many bytes of the packet
+	     * have been processed (as valid SIP message).
+	     */
+	    size_eaten = 
+		pjsip_tpmgr_receive_packet(rdata->tp_info.transport->tpmgr, 
+					   rdata);
+
+	    pj_assert(size_eaten <= len);
+
+	    if (size_eaten == len) {
+		/* Nothing left, give the buffer back */
+		pjsip_tpmgr_release_rdata(tls->base.tpmgr, rdata);
+		tls->rdata = NULL;
+	    } else {
+		/* Move unprocessed data to the front of the buffer */
+		if (size_eaten > 0) {
+		    pj_memmove(rdata->pkt_info.packet,
+			       rdata->pkt_info.packet + size_eaten,
+			       len - size_eaten);
+		}
+		rdata->pkt_info.len = len - size_eaten;
+
+		/* Reset pool. */
+		pj_pool_reset(rdata->tp_info.pool);
+	    }
 	}
 
     } else {
@@ -1417,9 +1454,6 @@ static pj_bool_t on_data_read(pj_ssl_sock_t *ssock,
 
     }
 
-    /* Reset pool. */
-    pj_pool_reset(rdata->tp_info.pool);
-
     return PJ_TRUE;
 }
 
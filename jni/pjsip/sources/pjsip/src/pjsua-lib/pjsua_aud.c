@@ -529,6 +529,11 @@ void pjsua_aud_stop_stream(pjsua_call_media *call_med)
 	                                            strm, call_med->idx);
 	}
 
+	if (pjmedia_event_mgr_instance()) {
+	    pjmedia_event_unsubscribe(NULL, &call_media_on_event, call_med,
+				      strm);
+	}
+
 	pjmedia_stream_destroy(strm);
 	call_med->strm.a.stream = NULL;
     }
@@ -560,6 +565,77 @@ static void dtmf_callback(pjmedia_stream *strm, void *user_data,
     pj_log_pop_indent();
 }
 
+/* Apply the media config and call media state to the stream info */
+static void init_stream_info(pjsua_call_media *call_med,
+			     pjmedia_stream_info *si)
+{
+    /* Override ptime, if this option is specified. */
+    if (pjsua_var.media_cfg.ptime != 0) {
+	si->param->setting.frm_per_pkt = (pj_uint8_t)
+	    (pjsua_var.media_cfg.ptime / si->param->info.frm_ptime);
+	if (si->param->setting.frm_per_pkt == 0)
+	    si->param->setting.frm_per_pkt = 1;
+    }
+
+    /* Disable VAD, if this option is specified. */
+    if (pjsua_var.media_cfg.no_vad) {
+	si->param->setting.vad = 0;
+    }
+
+
+    /* Optionally, application may modify other stream settings here
+     * (such as jitter buffer parameters, codec ptime, etc.)
+     */
+    si->jb_init = pjsua_var.media_cfg.jb_init;
+    si->jb_min_pre = pjsua_var.media_cfg.jb_min_pre;
+    si->jb_max_pre = pjsua_var.media_cfg.jb_max_pre;
+    si->jb_max = pjsua_var.media_cfg.jb_max;
+    si->audio_level_skip = pjsua_var.media_cfg.audio_level_skip;
+    si->adaptive_max_ptime = pjsua_var.media_cfg.adaptive_max_ptime;
+
+    /* Set SSRC */
+    si->ssrc = call_med->ssrc;
+
+    /* Set RTP timestamp & sequence, normally these value are intialized
+     * automatically when stream session created, but for some cases (e.g:
+     * call reinvite, call update) timestamp and sequence need to be kept
+     * contigue.
+     */
+    si->rtp_ts = call_med->rtp_tx_ts;
+    si->rtp_seq = call_med->rtp_tx_seq;
+    si->rtp_seq_ts_set = call_med->rtp_tx_seq_ts_set;
+
+#if defined(PJMEDIA_STREAM_ENABLE_KA) && PJMEDIA_STREAM_ENABLE_KA!=0
+    /* Enable/disable stream keep-alive and NAT hole punch. */
+    si->use_ka = pjsua_var.acc[call_med->call->acc_id].cfg.use_stream_ka;
+#endif
+}
+
+/* Internal function: apply the stream info of a new SDP negotiation to
+ * the running audio stream, so that it keeps its conference slot. When
+ * this fails, the stream must be recreated with pjsua_aud_channel_update().
+ */
+pj_status_t pjsua_aud_stream_update(pjsua_call_media *call_med,
+				    pjmedia_stream_info *si)
+{
+    pj_status_t status;
+
+    PJ_LOG(4,(THIS_FILE,"Audio stream update.."));
+    pj_log_push_indent();
+
+    si->rtcp_sdes_bye_disabled = PJ_TRUE;
+    init_stream_info(call_med, si);
+
+    status = pjmedia_stream_update(call_med->strm.a.stream, si);
+    if (status != PJ_SUCCESS) {
+	PJ_PERROR(4,(THIS_FILE, status,
+		     "Unable to update the audio stream, recreating it"));
+    }
+
+    pj_log_pop_indent();
+    return status;
+}
+
 /* Internal function: update audio channel after SDP negotiation.
  * Warning: do not use temporary/flip-flop pool, e.g: inv->pool_prov,
  *          for creating stream, etc, as after SDP negotiation and when
@@ -589,44 +665,8 @@ pj_status_t pjsua_aud_channel_update(pjsua_call_media *call_med,
     /* Check if no media is active */
     if (si->dir != PJMEDIA_DIR_NONE) {
 
-	/* Override ptime, if this option is specified. */
-	if (pjsua_var.media_cfg.ptime != 0) {
-	    si->param->setting.frm_per_pkt = (pj_uint8_t)
-		(pjsua_var.media_cfg.ptime / si->param->info.frm_ptime);
-	    if (si->param->setting.frm_per_pkt == 0)
-		si->param->setting.frm_per_pkt = 1;
-	}
-
-	/* Disable VAD, if this option is specified. */
-	if (pjsua_var.media_cfg.no_vad) {
-	    si->param->setting.vad = 0;
-	}
-
-
-	/* Optionally, application may modify other stream settings here
-	 * (such as jitter buffer parameters, codec ptime, etc.)
-	 */
-	si->jb_init = pjsua_var.media_cfg.jb_init;
-	si->jb_min_pre = pjsua_var.media_cfg.jb_min_pre;
-	si->jb_max_pre = pjsua_var.media_cfg.jb_max_pre;
-	si->jb_max = pjsua_var.media_cfg.jb_max;
-
-	/* Set SSRC */
-	si->ssrc = call_med->ssrc;
-
-	/* Set RTP timestamp & sequence, normally these value are intialized
-	 * automatically when stream session created, but for some cases (e.g:
-	 * call reinvite, call update) timestamp and sequence need to be kept
-	 * contigue.
-	 */
-	si->rtp_ts = call_med->rtp_tx_ts;
-	si->rtp_seq = call_med->rtp_tx_seq;
-	si->rtp_seq_ts_set = call_med->rtp_tx_seq_ts_set;
-
-#if defined(PJMEDIA_STREAM_ENABLE_KA) && PJMEDIA_STREAM_ENABLE_KA!=0
-	/* Enable/disable stream keep-alive and NAT hole punch. */
-	si->use_ka = pjsua_var.acc[call->acc_id].cfg.use_stream_ka;
-#endif
+	/* Apply the stream settings of the application */
+	init_stream_info(call_med, si);
 
 	/* Create session based on session info. */
 	status = pjmedia_stream_create(pjsua_var.med_endpt, NULL, si,
@@ -645,6 +685,12 @@ pj_status_t pjsua_aud_channel_update(pjsua_call_media *call_med,
         if (call_med->prev_state == PJSUA_CALL_MEDIA_NONE)
             pjmedia_stream_send_rtcp_sdes(call_med->strm.a.stream);
 
+	/* Forward the stream events, such as packetization changes */
+	if (pjmedia_event_mgr_instance()) {
+	    pjmedia_event_subscribe(NULL, &call_media_on_event, call_med,
+				    call_med->strm.a.stream);
+	}
+
 	/* If DTMF callback is installed by application, install our
 	 * callback to the session.
 	 */
@@ -26,6 +26,8 @@
 
 /* Internal prototypes */
 static void resolve_stun_entry(pjsua_stun_resolve *sess);
+static pj_bool_t nat_cache_lookup(void);
+static void nat_cache_shutdown(void);
 
 
 /* PJSUA application instance. */
@@ -140,6 +142,9 @@ PJ_DEF(void) pjsua_config_dup(pj_pool_t *pool,
     for (i=0; i<src->stun_srv_cnt; ++i) {
 	pj_strdup_with_null(pool, &dst->stun_srv[i], &src->stun_srv[i]);
     }
+
+    pj_strdup_with_null(pool, &dst->nat_cache_file, &src->nat_cache_file);
+    pj_strdup_with_null(pool, &dst->network_id, &src->network_id);
 }
 
 PJ_DEF(void) pjsua_msg_data_init(pjsua_msg_data *msg_data)
@@ -315,6 +320,7 @@ PJ_DEF(void) pjsua_media_config_default(pjsua_media_config *cfg)
     cfg->max_media_ports = PJSUA_MAX_CONF_PORTS;
     cfg->has_ioqueue = PJ_TRUE;
     cfg->thread_cnt = 1;
+    cfg->ioqueue_cnt = 1;
     cfg->quality = PJSUA_DEFAULT_CODEC_QUALITY;
     cfg->ilbc_mode = PJSUA_DEFAULT_ILBC_MODE;
     cfg->ec_tail_len = PJSUA_DEFAULT_EC_TAIL_LEN;
@@ -322,6 +328,7 @@ PJ_DEF(void) pjsua_media_config_default(pjsua_media_config *cfg)
     cfg->snd_play_latency = PJMEDIA_SND_DEFAULT_PLAY_LATENCY;
     cfg->jb_init = cfg->jb_min_pre = cfg->jb_max_pre = cfg->jb_max = -1;
     cfg->snd_auto_close_time = 1;
+    cfg->enable_rtcp_mux = PJMEDIA_ADVERTISE_RTCP_MUX;
 
     cfg->ice_max_host_cands = -1;
     pj_ice_sess_options_default(&cfg->ice_opt);
@@ -1394,6 +1401,9 @@ static void internal_stun_resolve_cb(const pj_stun_resolve_result *result)
     pjsua_var.stun_status = result->status;
     if (result->status == PJ_SUCCESS) {
 	pj_memcpy(&pjsua_var.stun_srv, &result->addr, sizeof(result->addr));
+	pj_ansi_snprintf(pjsua_var.stun_srv_name,
+			 sizeof(pjsua_var.stun_srv_name), "%.*s",
+			 (int)result->name.slen, result->name.ptr);
     }
 }
 
@@ -1410,8 +1420,12 @@ pj_status_t resolve_stun_server(pj_bool_t wait)
 			    pjsip_endpt_get_ioqueue(pjsua_var.endpt),
 			    pjsip_endpt_get_timer_heap(pjsua_var.endpt));
 
-	/* Start STUN server resolution */
-	if (pjsua_var.ua_cfg.stun_srv_cnt) {
+	/* Start STUN server resolution, unless the result for this
+	 * network is known from previous runs.
+	 */
+	if (pjsua_var.ua_cfg.stun_srv_cnt && nat_cache_lookup()) {
+	    pjsua_var.stun_status = PJ_SUCCESS;
+	} else if (pjsua_var.ua_cfg.stun_srv_cnt) {
 	    pjsua_var.stun_status = PJ_EPENDING;
 	    status = pjsua_resolve_stun_servers(pjsua_var.ua_cfg.stun_srv_cnt,
 						pjsua_var.ua_cfg.stun_srv,
@@ -1505,6 +1519,12 @@ PJ_DEF(pj_status_t) pjsua_destroy2(unsigned flags)
 	/* Terminate all presence subscriptions. */
 	pjsua_pres_shutdown(flags);
 
+	/* Drop queued instant messages. */
+	pjsua_im_shutdown();
+
+	/* Stop revalidating the NAT cache */
+	nat_cache_shutdown();
+
 	/* Destroy media (to shutdown media transports etc) */
 	pjsua_media_subsys_destroy(flags);
 
@@ -1928,7 +1948,7 @@ static pj_status_t create_sip_udp_sock(int af,
 	if (pj_sockaddr_get_port(p_pub_addr) == 0)
 	    pj_sockaddr_set_port(p_pub_addr, (pj_uint16_t)port);
 
-    } else if (stun_srv.slen) {
+    } else if (stun_srv.slen && !pjsua_nat_is_open()) {
 	pjstun_setting stun_opt;
 
 	/*
@@ -2606,6 +2626,406 @@ void pjsua_init_tpselector(pjsua_transport_id tp_id,
 }
 
 
+/*****************************************************************************
+ * NAT cache.
+ *
+ * The cache file has one line for each network:
+ *   <time> <NAT type> <STUN server address> <STUN server entry> <network>
+ * where the network key runs until the end of the line.
+ */
+
+typedef struct nat_cache_entry
+{
+    unsigned long    time;
+    int		     nat_type;
+    char	     srv_addr[PJ_INET6_ADDRSTRLEN+10];
+    char	     srv_name[PJ_MAX_HOSTNAME];
+    char	     key[PJ_MAX_HOSTNAME];
+} nat_cache_entry;
+
+/* Get the default gateway from the routing table of the kernel, which
+ * lists it as:
+ *   <iface> <destination> <gateway> <flags> ...
+ * with the addresses in hex as they are stored in memory. pjlib has no
+ * way to get the gateway on other systems, where networks that assign
+ * the same local address are only told apart by network_id.
+ */
+static void nat_cache_get_gateway(pj_pool_t *pool, char *gw, unsigned len)
+{
+#if (defined(PJ_LINUX) && PJ_LINUX!=0) || \
+    (defined(PJ_ANDROID) && PJ_ANDROID!=0)
+    enum { ROUTE_BUF_SIZE = 4096, RTF_UP_GW = 0x0003 };
+    char *buf, *line, *next;
+    pj_ssize_t size = ROUTE_BUF_SIZE - 1;
+    pj_oshandle_t fd;
+
+    gw[0] = '\0';
+
+    if (pj_file_open(pool, "/proc/net/route", PJ_O_RDONLY, &fd) != PJ_SUCCESS)
+	return;
+    buf = (char*) pj_pool_alloc(pool, ROUTE_BUF_SIZE);
+    if (pj_file_read(fd, buf, &size) != PJ_SUCCESS)
+	size = 0;
+    pj_file_close(fd);
+    buf[size] = '\0';
+
+    /* Skip the header line */
+    line = pj_ansi_strchr(buf, '\n');
+    line = line ? line + 1 : buf + size;
+
+    for (; *line; line = next) {
+	char *field[4];
+	pj_in_addr addr;
+	pj_str_t tmp;
+	unsigned i;
+
+	next = pj_ansi_strchr(line, '\n');
+	if (next)
+	    *next++ = '\0';
+	else
+	    next = line + pj_ansi_strlen(line);
+
+	for (i=0; i<PJ_ARRAY_SIZE(field) && line; ++i) {
+	    field[i] = line;
+	    line = pj_ansi_strchr(line, '\t');
+	    if (line)
+		*line++ = '\0';
+	}
+	if (i < PJ_ARRAY_SIZE(field))
+	    continue;
+
+	/* The default route through a gateway */
+	if (pj_strtoul2(pj_cstr(&tmp, field[1]), NULL, 16) != 0 ||
+	    (pj_strtoul2(pj_cstr(&tmp, field[3]), NULL, 16) & RTF_UP_GW) !=
+	    RTF_UP_GW)
+	{
+	    continue;
+	}
+
+	addr.s_addr = (pj_uint32_t)pj_strtoul2(pj_cstr(&tmp, field[2]),
+					       NULL, 16);
+	pj_inet_ntop(pj_AF_INET(), &addr, gw, len);
+	return;
+    }
+#else
+    PJ_UNUSED_ARG(pool);
+    PJ_UNUSED_ARG(len);
+    gw[0] = '\0';
+#endif
+}
+
+/* Get the key identifying the current network */
+static void nat_cache_get_key(pj_pool_t *pool, char *key, unsigned len)
+{
+    pj_sockaddr addr;
+    char ip[PJ_INET6_ADDRSTRLEN];
+    char gw[PJ_INET6_ADDRSTRLEN];
+
+    if (pj_getdefaultipinterface(pj_AF_INET(), &addr) != PJ_SUCCESS)
+	pj_bzero(&addr, sizeof(addr));
+    pj_sockaddr_print(&addr, ip, sizeof(ip), 0);
+
+    nat_cache_get_gateway(pool, gw, sizeof(gw));
+
+    pj_ansi_snprintf(key, len, "%s/%s/%.*s", ip, gw,
+		     (int)pjsua_var.ua_cfg.network_id.slen,
+		     pjsua_var.ua_cfg.network_id.ptr);
+}
+
+/* Identify the current network */
+static void nat_cache_init_key(pj_pool_t *pool)
+{
+    nat_cache_get_key(pool, pjsua_var.nat_cache_key,
+		      sizeof(pjsua_var.nat_cache_key));
+}
+
+/* Read the cache file into an array of PJSUA_NAT_CACHE_MAX entries
+ * allocated from the pool.
+ */
+static unsigned nat_cache_load(pj_pool_t *pool, nat_cache_entry **p_entries)
+{
+    enum { BUF_SIZE = PJSUA_NAT_CACHE_MAX * sizeof(nat_cache_entry) };
+    nat_cache_entry *entries;
+    pj_ssize_t size = BUF_SIZE - 1;
+    pj_oshandle_t fd;
+    char *buf, *line, *next;
+    unsigned cnt = 0;
+
+    entries = (nat_cache_entry*)
+	      pj_pool_calloc(pool, PJSUA_NAT_CACHE_MAX, sizeof(*entries));
+    *p_entries = entries;
+
+    if (pj_file_open(pool, pjsua_var.ua_cfg.nat_cache_file.ptr,
+		     PJ_O_RDONLY, &fd) != PJ_SUCCESS)
+    {
+	return 0;
+    }
+    buf = (char*) pj_pool_alloc(pool, BUF_SIZE);
+    if (pj_file_read(fd, buf, &size) != PJ_SUCCESS)
+	size = 0;
+    pj_file_close(fd);
+    buf[size] = '\0';
+
+    for (line = buf; *line && cnt < PJSUA_NAT_CACHE_MAX; line = next) {
+	nat_cache_entry *e = &entries[cnt];
+	char *field[4];
+	pj_str_t tmp;
+	unsigned i;
+
+	next = pj_ansi_strchr(line, '\n');
+	if (next)
+	    *next++ = '\0';
+	else
+	    next = line + pj_ansi_strlen(line);
+
+	for (i=0; i<PJ_ARRAY_SIZE(field) && line; ++i) {
+	    field[i] = line;
+	    line = pj_ansi_strchr(line, ' ');
+	    if (line)
+		*line++ = '\0';
+	}
+	if (i < PJ_ARRAY_SIZE(field) || !line || !*line)
+	    continue;
+
+	e->time = pj_strtoul(pj_cstr(&tmp, field[0]));
+	e->nat_type = (int)pj_strtoul(pj_cstr(&tmp, field[1]));
+	pj_ansi_snprintf(e->srv_addr, sizeof(e->srv_addr), "%s", field[2]);
+	pj_ansi_snprintf(e->srv_name, sizeof(e->srv_name), "%s", field[3]);
+	pj_ansi_snprintf(e->key, sizeof(e->key), "%s", line);
+	++cnt;
+    }
+
+    return cnt;
+}
+
+/* Save the current results for the current network */
+static void nat_cache_save(void)
+{
+    nat_cache_entry *entries;
+    nat_cache_entry *e = NULL;
+    pj_time_val now;
+    pj_pool_t *pool;
+    pj_oshandle_t fd;
+    unsigned i, cnt;
+
+    pool = pjsua_pool_create("natcache", 1000, 1000);
+    if (!pool)
+	return;
+
+    nat_cache_init_key(pool);
+    cnt = nat_cache_load(pool, &entries);
+
+    /* Replace the entry of this network, or the least recent one */
+    for (i=0; i<cnt; ++i) {
+	if (pj_ansi_strcmp(entries[i].key, pjsua_var.nat_cache_key) == 0) {
+	    e = &entries[i];
+	    break;
+	}
+	if (!e || entries[i].time < e->time)
+	    e = &entries[i];
+    }
+    if (i == cnt && cnt < PJSUA_NAT_CACHE_MAX)
+	e = &entries[cnt++];
+
+    pj_gettimeofday(&now);
+    e->time = now.sec;
+    e->nat_type = pjsua_var.nat_type;
+    pj_sockaddr_print(&pjsua_var.stun_srv, e->srv_addr,
+		      sizeof(e->srv_addr), 3);
+    pj_ansi_strcpy(e->srv_name, pjsua_var.stun_srv_name);
+    pj_ansi_strcpy(e->key, pjsua_var.nat_cache_key);
+
+    if (pj_file_open(pool, pjsua_var.ua_cfg.nat_cache_file.ptr,
+		     PJ_O_WRONLY, &fd) != PJ_SUCCESS)
+    {
+	PJ_LOG(3,(THIS_FILE, "Unable to write NAT cache file %s",
+		  pjsua_var.ua_cfg.nat_cache_file.ptr));
+	pj_pool_release(pool);
+	return;
+    }
+
+    for (i=0; i<cnt; ++i) {
+	char line[sizeof(nat_cache_entry) + 32];
+	pj_ssize_t len;
+
+	len = pj_ansi_snprintf(line, sizeof(line), "%lu %d %s %s %s\n",
+			       entries[i].time, entries[i].nat_type,
+			       entries[i].srv_addr, entries[i].srv_name,
+			       entries[i].key);
+	if (len > 0 && len < (pj_ssize_t)sizeof(line))
+	    pj_file_write(fd, line, &len);
+    }
+    pj_file_close(fd);
+    pj_pool_release(pool);
+}
+
+/* Revalidation has resolved the STUN server, now detect the NAT type */
+static void nat_cache_stun_cb(const pj_stun_resolve_result *result)
+{
+    if (result->status == PJ_ECANCELLED)
+	return;
+
+    pjsua_var.nat_cached = PJ_FALSE;
+
+    if (result->status != PJ_SUCCESS) {
+	PJ_PERROR(3,(THIS_FILE, result->status,
+		     "Cached STUN server is no longer usable"));
+	pj_bzero(&pjsua_var.stun_srv, sizeof(pjsua_var.stun_srv));
+	pjsua_var.stun_status = pjsua_var.ua_cfg.stun_ignore_failure ?
+				PJ_SUCCESS : result->status;
+	pjsua_var.nat_status = result->status;
+	pjsua_var.nat_type = PJ_STUN_NAT_TYPE_ERR_UNKNOWN;
+	return;
+    }
+
+    pj_memcpy(&pjsua_var.stun_srv, &result->addr, sizeof(result->addr));
+    pj_ansi_snprintf(pjsua_var.stun_srv_name,
+		     sizeof(pjsua_var.stun_srv_name), "%.*s",
+		     (int)result->name.slen, result->name.ptr);
+
+    pjsua_detect_nat_type();
+}
+
+static void nat_cache_timer_cb(pj_timer_heap_t *th, pj_timer_entry *entry)
+{
+    pj_status_t status;
+
+    PJ_UNUSED_ARG(th);
+
+    entry->id = PJ_FALSE;
+
+    PJ_LOG(4,(THIS_FILE, "Revalidating cached NAT type and STUN server"));
+    status = pjsua_resolve_stun_servers(pjsua_var.ua_cfg.stun_srv_cnt,
+					pjsua_var.ua_cfg.stun_srv,
+					PJ_FALSE, entry, &nat_cache_stun_cb);
+    if (status != PJ_SUCCESS) {
+	pj_stun_resolve_result result;
+
+	pj_bzero(&result, sizeof(result));
+	result.status = status;
+	nat_cache_stun_cb(&result);
+    }
+}
+
+/* Start with the saved results for this network, if there are any */
+static pj_bool_t nat_cache_lookup(void)
+{
+    nat_cache_entry *entries;
+    pj_time_val delay;
+    pj_sockaddr addr;
+    pj_pool_t *pool;
+    pj_str_t tmp;
+    unsigned i, j, cnt;
+    pj_bool_t found = PJ_FALSE;
+
+    if (pjsua_var.ua_cfg.nat_cache_file.slen == 0)
+	return PJ_FALSE;
+
+    pool = pjsua_pool_create("natcache", 1000, 1000);
+    if (!pool)
+	return PJ_FALSE;
+
+    nat_cache_init_key(pool);
+    cnt = nat_cache_load(pool, &entries);
+
+    for (i=0; i<cnt; ++i) {
+	if (pj_ansi_strcmp(entries[i].key, pjsua_var.nat_cache_key) == 0)
+	    break;
+    }
+    if (i == cnt)
+	goto on_return;
+
+    /* The STUN server must still be configured */
+    for (j=0; j<pjsua_var.ua_cfg.stun_srv_cnt; ++j) {
+	if (pj_stricmp2(&pjsua_var.ua_cfg.stun_srv[j],
+			entries[i].srv_name) == 0)
+	{
+	    break;
+	}
+    }
+    if (j == pjsua_var.ua_cfg.stun_srv_cnt)
+	goto on_return;
+
+    if (pj_sockaddr_parse(pj_AF_UNSPEC(), 0,
+			  pj_cstr(&tmp, entries[i].srv_addr),
+			  &addr) != PJ_SUCCESS)
+    {
+	goto on_return;
+    }
+
+    pj_memcpy(&pjsua_var.stun_srv, &addr, sizeof(addr));
+    pj_ansi_strcpy(pjsua_var.stun_srv_name, entries[i].srv_name);
+    pjsua_var.nat_type = (pj_stun_nat_type)entries[i].nat_type;
+    pjsua_var.nat_status = PJ_SUCCESS;
+    pjsua_var.nat_cached = PJ_TRUE;
+    found = PJ_TRUE;
+
+    PJ_LOG(4,(THIS_FILE, "Using cached STUN server %s and NAT type %s for "
+	      "network %s", entries[i].srv_addr,
+	      pj_stun_get_nat_name(pjsua_var.nat_type),
+	      pjsua_var.nat_cache_key));
+
+    /* Revalidate once startup is done */
+    pj_timer_entry_init(&pjsua_var.nat_cache_timer, PJ_FALSE, NULL,
+			&nat_cache_timer_cb);
+    delay.sec = 0;
+    delay.msec = PJSUA_NAT_CACHE_REVALIDATE_DELAY;
+    pj_time_val_normalize(&delay);
+    if (pjsip_endpt_schedule_timer(pjsua_var.endpt, &pjsua_var.nat_cache_timer,
+				   &delay) == PJ_SUCCESS)
+    {
+	pjsua_var.nat_cache_timer.id = PJ_TRUE;
+    }
+
+on_return:
+    pj_pool_release(pool);
+    return found;
+}
+
+/* Cancel pending revalidation */
+static void nat_cache_shutdown(void)
+{
+    if (pjsua_var.nat_cache_timer.id) {
+	pjsip_endpt_cancel_timer(pjsua_var.endpt, &pjsua_var.nat_cache_timer);
+	pjsua_var.nat_cache_timer.id = PJ_FALSE;
+    }
+    pjsua_cancel_stun_resolution(&pjsua_var.nat_cache_timer, PJ_FALSE);
+}
+
+/*
+ * Check if sockets need to query their STUN mapped address.
+ */
+pj_bool_t pjsua_nat_is_open(void)
+{
+    char key[PJ_MAX_HOSTNAME];
+    pj_pool_t *pool;
+
+    if (pjsua_var.nat_status != PJ_SUCCESS ||
+	(pjsua_var.nat_type != PJ_STUN_NAT_TYPE_OPEN &&
+	 pjsua_var.nat_type != PJ_STUN_NAT_TYPE_SYMMETRIC_UDP))
+    {
+	return PJ_FALSE;
+    }
+
+    /* Only trust the NAT type when the cache is enabled and the type was
+     * found on the network we're on now, it's stale after a handover.
+     */
+    if (pjsua_var.ua_cfg.nat_cache_file.slen == 0 ||
+	!pjsua_var.nat_cache_key[0])
+    {
+	return PJ_FALSE;
+    }
+
+    pool = pjsua_pool_create("natcache", 512, 512);
+    if (!pool)
+	return PJ_FALSE;
+    nat_cache_get_key(pool, key, sizeof(key));
+    pj_pool_release(pool);
+
+    return pj_ansi_strcmp(key, pjsua_var.nat_cache_key) == 0;
+}
+
+
 /* Callback upon NAT detection completion */
 static void nat_detect_cb(void *user_data, 
 			  const pj_stun_nat_detect_result *res)
@@ -2616,6 +3036,9 @@ static void nat_detect_cb(void *user_data,
     pjsua_var.nat_status = res->status;
     pjsua_var.nat_type = res->nat_type;
 
+    if (res->status == PJ_SUCCESS && pjsua_var.ua_cfg.nat_cache_file.slen)
+	nat_cache_save();
+
     if (pjsua_var.ua_cfg.cb.on_nat_detect) {
 	(*pjsua_var.ua_cfg.cb.on_nat_detect)(res);
     }
@@ -2632,6 +3055,10 @@ PJ_DEF(pj_status_t) pjsua_detect_nat_type()
     if (pjsua_var.nat_in_progress)
 	return PJ_SUCCESS;
 
+    /* Cached result will be revalidated in the background */
+    if (pjsua_var.nat_cached)
+	return PJ_SUCCESS;
+
     /* Make sure STUN server resolution has completed */
     status = resolve_stun_server(PJ_TRUE);
     if (status != PJ_SUCCESS) {
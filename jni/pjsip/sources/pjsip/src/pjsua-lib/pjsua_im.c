@@ -337,6 +337,89 @@ static pj_bool_t im_on_rx_request(pjsip_rx_data *rdata)
 }
 
 
+/* Outgoing request of an IM session. */
+typedef struct im_req
+{
+    PJ_DECL_LIST_MEMBER(struct im_req);
+    pjsip_tx_data	     *tdata;
+    pjsua_im_data	     *im_data;
+    pjsip_endpt_send_callback cb;
+} im_req;
+
+
+/* Outgoing IM session to one remote URI. Requests are created from the
+ * parsed template headers, at most PJSUA_IM_WINDOW of them are
+ * outstanding at a time, and the rest wait in the queue.
+ */
+struct pjsua_im_peer
+{
+    pj_pool_t		*pool;		/**< Pool for the template.	    */
+    pjsua_acc_id	 acc_id;	/**< Account, -1 if slot is unused. */
+    pj_str_t		 to;		/**< Remote URI.		    */
+    pj_time_val		 last_use;	/**< Last time a request was queued.*/
+
+    pj_str_t		 acc_uri;	/**< Account URI of the template.   */
+    pj_str_t		 acc_contact;	/**< Account Contact of template.   */
+    pjsip_uri		*target;	/**< Parsed request URI.	    */
+    pjsip_from_hdr	*from_hdr;	/**< From header, without tag.	    */
+    pjsip_to_hdr	*to_hdr;	/**< To header.			    */
+    pjsip_hdr		*contact_hdr;	/**< Contact header.		    */
+    pjsip_hdr		*accept_hdr;	/**< Accept header.		    */
+
+    unsigned		 inflight;	/**< Outstanding transactions.	    */
+    unsigned		 queued;	/**< Number of queued requests.	    */
+    im_req		 queue;		/**< Requests waiting to be sent.   */
+
+    int			 typing_sent;	/**< Last state sent, -1: unknown.  */
+    pj_time_val		 typing_time;	/**< When typing_sent was set.	    */
+    pj_bool_t		 typing_busy;	/**< Typing request is outstanding. */
+    im_req		*typing_req;	/**< Typing request still queued.   */
+    int			 typing_want;	/**< State to send after typing_busy
+					     completes, -1: none.	    */
+};
+
+
+/* Outgoing IM sessions. */
+static struct im_sess_mgr
+{
+    pj_mutex_t	    *mutex;
+    pjsua_im_peer    peer[PJSUA_IM_MAX_PEERS];
+} im_sess;
+
+
+static void im_peer_complete(pjsua_im_data *im_data, pj_bool_t is_typing,
+			     int status_code);
+
+
+/* Report outgoing IM status to application. */
+static void notify_pager_status(const pjsua_im_data *im_data,
+				int status_code,
+				const pj_str_t *reason,
+				pjsip_tx_data *tdata,
+				pjsip_rx_data *rdata)
+{
+    if (pjsua_var.ua_cfg.cb.on_pager_status) {
+	pjsua_var.ua_cfg.cb.on_pager_status(im_data->call_id, 
+					    &im_data->to,
+					    &im_data->body,
+					    im_data->user_data,
+					    (pjsip_status_code) status_code,
+					    reason);
+    }
+
+    if (pjsua_var.ua_cfg.cb.on_pager_status2) {
+	pjsua_var.ua_cfg.cb.on_pager_status2(im_data->call_id, 
+					     &im_data->to,
+					     &im_data->body,
+					     im_data->user_data,
+					     (pjsip_status_code) status_code,
+					     reason,
+					     tdata,
+					     rdata, im_data->acc_id);
+    }
+}
+
+
 /* Outgoing IM callback. */
 static void im_callback(void *token, pjsip_event *e)
 {
@@ -345,6 +428,7 @@ static void im_callback(void *token, pjsip_event *e)
     if (e->type == PJSIP_EVENT_TSX_STATE) {
 
 	pjsip_transaction *tsx = e->body.tsx_state.tsx;
+	pjsip_rx_data *rdata;
 
 	/* Ignore provisional response, if any */
 	if (tsx->status_code < 200)
@@ -377,19 +461,31 @@ static void im_callback(void *token, pjsip_event *e)
 	    if (status == PJ_SUCCESS) {
 		pjsua_im_data *im_data2;
 
-		/* Must duplicate im_data */
+		/* Must duplicate im_data. The IM session slot, if any,
+		 * now belongs to the new request.
+		 */
 		im_data2 = pjsua_im_data_dup(tdata->pool, im_data);
+		im_data->peer = NULL;
 
 		/* Increment CSeq */
 		PJSIP_MSG_CSEQ_HDR(tdata->msg)->cseq++;
 
 		/* Re-send request */
+		pjsip_tx_data_add_ref(tdata);
 		status = pjsip_endpt_send_request( pjsua_var.endpt, tdata, -1,
 						   im_data2, &im_callback);
 		if (status == PJ_SUCCESS) {
 		    /* Done */
+		    pjsip_tx_data_dec_ref(tdata);
 		    return;
 		}
+
+		/* Take back the slot, unless the new request has already
+		 * completed it.
+		 */
+		im_data->peer = im_data2->peer;
+		im_data2->peer = NULL;
+		pjsip_tx_data_dec_ref(tdata);
 	    }
 	}
 
@@ -406,34 +502,15 @@ static void im_callback(void *token, pjsip_event *e)
 		      tsx->status_text.ptr));
 	}
 
-	if (pjsua_var.ua_cfg.cb.on_pager_status) {
-	    pjsua_var.ua_cfg.cb.on_pager_status(im_data->call_id, 
-					        &im_data->to,
-						&im_data->body,
-						im_data->user_data,
-						(pjsip_status_code) 
-						    tsx->status_code,
-						&tsx->status_text);
-	}
+	if (e->body.tsx_state.type == PJSIP_EVENT_RX_MSG)
+	    rdata = e->body.tsx_state.src.rdata;
+	else
+	    rdata = NULL;
 
-	if (pjsua_var.ua_cfg.cb.on_pager_status2) {
-	    pjsip_rx_data *rdata;
-
-	    if (e->body.tsx_state.type == PJSIP_EVENT_RX_MSG)
-		rdata = e->body.tsx_state.src.rdata;
-	    else
-		rdata = NULL;
-
-	    pjsua_var.ua_cfg.cb.on_pager_status2(im_data->call_id, 
-					         &im_data->to,
-					 	 &im_data->body,
-						 im_data->user_data,
-						 (pjsip_status_code) 
-						    tsx->status_code,
-						 &tsx->status_text,
-						 tsx->last_tx,
-						 rdata, im_data->acc_id);
-	}
+	notify_pager_status(im_data, tsx->status_code, &tsx->status_text,
+			    tsx->last_tx, rdata);
+
+	im_peer_complete(im_data, PJ_FALSE, tsx->status_code);
     }
 }
 
@@ -481,54 +558,193 @@ static void typing_callback(void *token, pjsip_event *e)
 
 		/* Must duplicate im_data */
 		im_data2 = pjsua_im_data_dup(tdata->pool, im_data);
+		im_data->peer = NULL;
 
 		/* Increment CSeq */
 		PJSIP_MSG_CSEQ_HDR(tdata->msg)->cseq++;
 
 		/* Re-send request */
+		pjsip_tx_data_add_ref(tdata);
 		status = pjsip_endpt_send_request( pjsua_var.endpt, tdata, -1,
 						   im_data2, &typing_callback);
 		if (status == PJ_SUCCESS) {
 		    /* Done */
+		    pjsip_tx_data_dec_ref(tdata);
 		    return;
 		}
+
+		im_data->peer = im_data2->peer;
+		im_data2->peer = NULL;
+		pjsip_tx_data_dec_ref(tdata);
 	    }
 	}
 
+	im_peer_complete(im_data, PJ_TRUE, tsx->status_code);
     }
 }
 
 
 /*
- * Send instant messaging outside dialog, using the specified account for
- * route set and authentication.
+ * Find the IM session for the remote URI, or allocate one by reusing
+ * an unused or idle slot. Returns NULL when all slots are busy.
+ * Must be called with im_sess.mutex held.
  */
-PJ_DEF(pj_status_t) pjsua_im_send( pjsua_acc_id acc_id, 
-				   const pj_str_t *to,
-				   const pj_str_t *mime_type,
-				   const pj_str_t *content,
-				   const pjsua_msg_data *msg_data,
-				   void *user_data)
+static pjsua_im_peer *im_peer_get(pjsua_acc_id acc_id, const pj_str_t *to)
+{
+    pjsua_im_peer *peer = NULL;
+    unsigned i;
+
+    if (PJSUA_IM_WINDOW == 0 || im_sess.mutex == NULL)
+	return NULL;
+
+    for (i=0; i<PJ_ARRAY_SIZE(im_sess.peer); ++i) {
+	pjsua_im_peer *p = &im_sess.peer[i];
+
+	if (p->acc_id == acc_id && pj_strcmp(&p->to, to) == 0) {
+	    pj_gettickcount(&p->last_use);
+	    return p;
+	}
+
+	/* Remember the least recently used idle slot */
+	if (p->acc_id == PJSUA_INVALID_ID) {
+	    if (peer == NULL || peer->acc_id != PJSUA_INVALID_ID)
+		peer = p;
+	} else if (p->inflight == 0 && p->queued == 0 && 
+		   (peer == NULL || (peer->acc_id != PJSUA_INVALID_ID && 
+				     PJ_TIME_VAL_LT(p->last_use, 
+						    peer->last_use))))
+	{
+	    peer = p;
+	}
+    }
+
+    if (peer == NULL)
+	return NULL;
+
+    if (peer->pool == NULL) {
+	peer->pool = pjsua_pool_create("imsess%p", 512, 512);
+	if (peer->pool == NULL)
+	    return NULL;
+    } else {
+	pj_pool_reset(peer->pool);
+    }
+
+    peer->acc_id = acc_id;
+    pj_strdup_with_null(peer->pool, &peer->to, to);
+    pj_gettickcount(&peer->last_use);
+    peer->target = NULL;
+    peer->typing_sent = -1;
+    peer->typing_busy = PJ_FALSE;
+    peer->typing_req = NULL;
+    peer->typing_want = -1;
+
+    return peer;
+}
+
+
+/*
+ * (Re)build the request template of the IM session when the account
+ * identity or Contact has changed since it was last built.
+ */
+static pj_status_t im_peer_update_template(pjsua_im_peer *peer)
 {
-    pjsip_tx_data *tdata;
-    const pj_str_t mime_text_plain = pj_str("text/plain");
     const pj_str_t STR_CONTACT = { "Contact", 7 };
-    pjsip_media_type media_type;
-    pjsua_im_data *im_data;
+    pjsua_acc *acc = &pjsua_var.acc[peer->acc_id];
+    pjsip_uri *target;
+    pjsip_from_hdr *from;
+    pjsip_to_hdr *to;
+    pj_str_t tmp, contact;
+    pj_status_t status;
+
+    if (peer->target && pj_strcmp(&peer->acc_uri, &acc->cfg.id) == 0 &&
+	pj_strcmp(&peer->acc_contact, &acc->contact) == 0)
+    {
+	return PJ_SUCCESS;
+    }
+
+    peer->target = NULL;
+
+    pj_strdup_with_null(peer->pool, &tmp, &peer->to);
+    target = pjsip_parse_uri(peer->pool, tmp.ptr, tmp.slen, 0);
+    if (target == NULL)
+	return PJSIP_EINVALIDREQURI;
+
+    from = pjsip_from_hdr_create(peer->pool);
+    pj_strdup_with_null(peer->pool, &tmp, &acc->cfg.id);
+    from->uri = pjsip_parse_uri(peer->pool, tmp.ptr, tmp.slen,
+				PJSIP_PARSE_URI_AS_NAMEADDR);
+    if (from->uri == NULL)
+	return PJSIP_EINVALIDHDR;
+
+    to = pjsip_to_hdr_create(peer->pool);
+    pj_strdup_with_null(peer->pool, &tmp, &peer->to);
+    to->uri = pjsip_parse_uri(peer->pool, tmp.ptr, tmp.slen,
+			      PJSIP_PARSE_URI_AS_NAMEADDR);
+    if (to->uri == NULL)
+	return PJSIP_EINVALIDHDR;
+
+    /* Create suitable Contact header unless a Contact header has been
+     * set in the account.
+     */
+    if (acc->contact.slen) {
+	contact = acc->contact;
+    } else {
+	status = pjsua_acc_create_uac_contact(peer->pool, &contact,
+					      peer->acc_id, &peer->to);
+	if (status != PJ_SUCCESS)
+	    return status;
+    }
+
+    peer->contact_hdr = (pjsip_hdr*)
+	pjsip_generic_string_hdr_create(peer->pool, &STR_CONTACT, &contact);
+    peer->accept_hdr = (pjsip_hdr*) pjsua_im_create_accept(peer->pool);
+
+    pj_strdup_with_null(peer->pool, &peer->acc_uri, &acc->cfg.id);
+    pj_strdup_with_null(peer->pool, &peer->acc_contact, &acc->contact);
+    peer->from_hdr = from;
+    peer->to_hdr = to;
+    peer->target = target;
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Create MESSAGE request outside dialog, with transport selector, Accept
+ * and Contact header set for the account. When IM session is given, the
+ * request is created from its template instead of parsing the URIs.
+ */
+static pj_status_t create_im_request(pjsua_acc_id acc_id,
+				     const pj_str_t *to,
+				     pjsua_im_peer *peer,
+				     pjsip_tx_data **p_tdata)
+{
+    const pj_str_t STR_CONTACT = { "Contact", 7 };
+    pjsip_tx_data *tdata;
     pjsua_acc *acc;
     pj_str_t contact;
     pj_status_t status;
 
-    /* To and message body must be specified. */
-    PJ_ASSERT_RETURN(to && content, PJ_EINVAL);
-
     acc = &pjsua_var.acc[acc_id];
 
     /* Create request. */
-    status = pjsip_endpt_create_request(pjsua_var.endpt, 
-					&pjsip_message_method, to, 
-					&acc->cfg.id,
-					to, NULL, NULL, -1, NULL, &tdata);
+    if (peer) {
+	status = im_peer_update_template(peer);
+	if (status == PJ_SUCCESS) {
+	    status = pjsip_endpt_create_request_from_hdr(pjsua_var.endpt,
+							 &pjsip_message_method,
+							 peer->target,
+							 peer->from_hdr,
+							 peer->to_hdr,
+							 NULL, NULL, -1, NULL,
+							 &tdata);
+	}
+    } else {
+	status = pjsip_endpt_create_request(pjsua_var.endpt, 
+					    &pjsip_message_method, to, 
+					    &acc->cfg.id,
+					    to, NULL, NULL, -1, NULL, &tdata);
+    }
     if (status != PJ_SUCCESS) {
 	pjsua_perror(THIS_FILE, "Unable to create request", status);
 	return status;
@@ -544,6 +760,20 @@ PJ_DEF(pj_status_t) pjsua_im_send( pjsua_acc_id acc_id,
 	pjsip_tx_data_set_transport(tdata, &tp_sel);
     }
 
+    if (peer) {
+	/* Template From header has no tag */
+	pj_create_unique_string(tdata->pool, 
+				&PJSIP_MSG_FROM_HDR(tdata->msg)->tag);
+
+	pjsip_msg_add_hdr(tdata->msg, (pjsip_hdr*)
+			  pjsip_hdr_clone(tdata->pool, peer->accept_hdr));
+	pjsip_msg_add_hdr(tdata->msg, (pjsip_hdr*)
+			  pjsip_hdr_clone(tdata->pool, peer->contact_hdr));
+
+	*p_tdata = tdata;
+	return PJ_SUCCESS;
+    }
+
     /* Add accept header. */
     pjsip_msg_add_hdr( tdata->msg, 
 		       (pjsip_hdr*)pjsua_im_create_accept(tdata->pool));
@@ -566,6 +796,243 @@ PJ_DEF(pj_status_t) pjsua_im_send( pjsua_acc_id acc_id,
 	pjsip_generic_string_hdr_create(tdata->pool, 
 					&STR_CONTACT, &contact));
 
+    *p_tdata = tdata;
+    return PJ_SUCCESS;
+}
+
+
+/* Add route set and Via address of the account to the request. */
+static void finalize_im_request(pjsip_tx_data *tdata, pjsua_acc *acc,
+				const pjsua_msg_data *msg_data)
+{
+    /* Add additional headers etc. */
+    pjsua_process_msg_data(tdata, msg_data);
+
+    /* Add route set */
+    pjsua_set_msg_route_set(tdata, &acc->route_set);
+
+    /* If via_addr is set, use this address for the Via header. */
+    if (acc->cfg.allow_via_rewrite && acc->via_addr.host.slen > 0) {
+        tdata->via_addr = acc->via_addr;
+        tdata->via_tp = acc->via_tp;
+    }
+}
+
+
+/*
+ * Submit request to the IM session. Returns PJ_TRUE when the window
+ * allows the request to be sent now, otherwise the request is queued.
+ * Must be called with im_sess.mutex held.
+ */
+static pj_bool_t im_peer_submit(pjsua_im_peer *peer, im_req *req)
+{
+    req->im_data->peer = peer;
+
+    if (peer->inflight < PJSUA_IM_WINDOW && pj_list_empty(&peer->queue)) {
+	++peer->inflight;
+	return PJ_TRUE;
+    }
+
+    pj_list_push_back(&peer->queue, req);
+    ++peer->queued;
+    return PJ_FALSE;
+}
+
+
+/*
+ * Send request statefully. When sending fails without the transaction
+ * reporting it, the IM session slot is released here and, if notify is
+ * set, the failure is reported to application.
+ */
+static pj_status_t im_req_send(im_req *req, pj_bool_t notify)
+{
+    pjsip_tx_data *tdata = req->tdata;
+    pjsua_im_data *im_data = req->im_data;
+    pj_bool_t is_typing = (req->cb == &typing_callback);
+    pj_status_t status;
+
+    /* Keep im_data alive should sending fail */
+    pjsip_tx_data_add_ref(tdata);
+
+    status = pjsip_endpt_send_request(pjsua_var.endpt, tdata, -1,
+				      im_data, req->cb);
+    if (status != PJ_SUCCESS) {
+	pjsua_perror(THIS_FILE, "Unable to send request", status);
+
+	if (im_data->peer) {
+	    if (notify && !is_typing) {
+		char errmsg[PJ_ERR_MSG_SIZE];
+		pj_str_t reason;
+
+		reason = pj_strerror(status, errmsg, sizeof(errmsg));
+		notify_pager_status(im_data, 
+				    PJSIP_ERRNO_TO_SIP_STATUS(status),
+				    &reason, tdata, NULL);
+	    }
+	    im_peer_complete(im_data, is_typing,
+			     PJSIP_ERRNO_TO_SIP_STATUS(status));
+	}
+    }
+
+    pjsip_tx_data_dec_ref(tdata);
+    return status;
+}
+
+
+/* Send queued requests of the IM session while the window allows. */
+static void im_peer_pump(pjsua_im_peer *peer)
+{
+    for (;;) {
+	im_req *req;
+
+	pj_mutex_lock(im_sess.mutex);
+	if (peer->inflight >= PJSUA_IM_WINDOW || pj_list_empty(&peer->queue)) {
+	    pj_mutex_unlock(im_sess.mutex);
+	    break;
+	}
+
+	req = peer->queue.next;
+	pj_list_erase(req);
+	--peer->queued;
+	++peer->inflight;
+
+	if (req == peer->typing_req) {
+	    peer->typing_req = NULL;
+	    peer->typing_busy = PJ_TRUE;
+	}
+	pj_mutex_unlock(im_sess.mutex);
+
+	im_req_send(req, PJ_TRUE);
+    }
+}
+
+
+/*
+ * Create typing indication request and submit it to the IM session.
+ * Returns the request if it may be sent now. Must be called with
+ * im_sess.mutex held.
+ */
+static pj_status_t im_peer_typing(pjsua_im_peer *peer, pj_bool_t is_typing,
+				  im_req **p_req)
+{
+    pjsua_im_data *im_data;
+    pjsip_tx_data *tdata;
+    im_req *req;
+    pj_status_t status;
+
+    *p_req = NULL;
+
+    status = create_im_request(peer->acc_id, &peer->to, peer, &tdata);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    tdata->msg->body = pjsip_iscomposing_create_body( tdata->pool, is_typing,
+						      NULL, NULL, -1);
+    finalize_im_request(tdata, &pjsua_var.acc[peer->acc_id], NULL);
+
+    im_data = PJ_POOL_ZALLOC_T(tdata->pool, pjsua_im_data);
+    im_data->acc_id = peer->acc_id;
+
+    req = PJ_POOL_ZALLOC_T(tdata->pool, im_req);
+    req->tdata = tdata;
+    req->im_data = im_data;
+    req->cb = &typing_callback;
+
+    peer->typing_sent = is_typing;
+    pj_gettickcount(&peer->typing_time);
+
+    if (im_peer_submit(peer, req)) {
+	peer->typing_busy = PJ_TRUE;
+	*p_req = req;
+    } else {
+	peer->typing_req = req;
+    }
+
+    return PJ_SUCCESS;
+}
+
+
+/*
+ * Release the IM session slot held by a completed request, send the
+ * typing state that changed while it was outstanding, and send queued
+ * requests that now fit in the window.
+ */
+static void im_peer_complete(pjsua_im_data *im_data, pj_bool_t is_typing,
+			     int status_code)
+{
+    pjsua_im_peer *peer = im_data->peer;
+    im_req *req = NULL;
+
+    if (peer == NULL || im_sess.mutex == NULL)
+	return;
+
+    im_data->peer = NULL;
+
+    pj_mutex_lock(im_sess.mutex);
+
+    pj_assert(peer->inflight > 0);
+    --peer->inflight;
+
+    if (is_typing) {
+	peer->typing_busy = PJ_FALSE;
+	if (status_code/100 != 2)
+	    peer->typing_sent = -1;
+
+	if (peer->typing_want >= 0 && peer->typing_want != peer->typing_sent)
+	    im_peer_typing(peer, peer->typing_want, &req);
+	peer->typing_want = -1;
+    }
+
+    pj_mutex_unlock(im_sess.mutex);
+
+    if (req)
+	im_req_send(req, PJ_FALSE);
+
+    im_peer_pump(peer);
+}
+
+
+/*
+ * Send instant messaging outside dialog, using the specified account for
+ * route set and authentication.
+ */
+PJ_DEF(pj_status_t) pjsua_im_send( pjsua_acc_id acc_id, 
+				   const pj_str_t *to,
+				   const pj_str_t *mime_type,
+				   const pj_str_t *content,
+				   const pjsua_msg_data *msg_data,
+				   void *user_data)
+{
+    pjsip_tx_data *tdata;
+    const pj_str_t mime_text_plain = pj_str("text/plain");
+    pjsip_media_type media_type;
+    pjsua_im_data *im_data;
+    pjsua_im_peer *peer = NULL;
+    pjsua_acc *acc;
+    im_req *req;
+    pj_bool_t send_now = PJ_TRUE;
+    pj_status_t status;
+
+    /* To and message body must be specified. */
+    PJ_ASSERT_RETURN(to && content, PJ_EINVAL);
+
+    acc = &pjsua_var.acc[acc_id];
+
+    if (im_sess.mutex)
+	pj_mutex_lock(im_sess.mutex);
+
+    peer = im_peer_get(acc_id, to);
+    if (peer && peer->queued >= PJSUA_IM_MAX_QUEUE) {
+	/* Let application retry later */
+	status = PJ_ETOOMANY;
+	goto on_return;
+    }
+
+    /* Create request. */
+    status = create_im_request(acc_id, to, peer, &tdata);
+    if (status != PJ_SUCCESS)
+	goto on_return;
+
     /* Create IM data to keep message details and give it back to
      * application on the callback
      */
@@ -592,30 +1059,46 @@ PJ_DEF(pj_status_t) pjsua_im_send( pjsua_acc_id acc_id,
     if (tdata->msg->body == NULL) {
 	pjsua_perror(THIS_FILE, "Unable to create msg body", PJ_ENOMEM);
 	pjsip_tx_data_dec_ref(tdata);
-	return PJ_ENOMEM;
+	status = PJ_ENOMEM;
+	goto on_return;
     }
 
-    /* Add additional headers etc. */
-    pjsua_process_msg_data(tdata, msg_data);
-
-    /* Add route set */
-    pjsua_set_msg_route_set(tdata, &acc->route_set);
+    finalize_im_request(tdata, acc, msg_data);
+
+    req = PJ_POOL_ZALLOC_T(tdata->pool, im_req);
+    req->tdata = tdata;
+    req->im_data = im_data;
+    req->cb = &im_callback;
+
+    if (peer) {
+	/* Receiving a message makes the remote consider us idle, so an
+	 * indication still waiting in the queue is no longer needed.
+	 */
+	if (peer->typing_req) {
+	    pj_list_erase(peer->typing_req);
+	    --peer->queued;
+	    pjsip_tx_data_dec_ref(peer->typing_req->tdata);
+	    peer->typing_req = NULL;
+	}
+	peer->typing_sent = PJ_FALSE;
+	peer->typing_want = -1;
 
-    /* If via_addr is set, use this address for the Via header. */
-    if (acc->cfg.allow_via_rewrite && acc->via_addr.host.slen > 0) {
-        tdata->via_addr = acc->via_addr;
-        tdata->via_tp = acc->via_tp;
+	send_now = im_peer_submit(peer, req);
     }
 
+    if (im_sess.mutex)
+	pj_mutex_unlock(im_sess.mutex);
+
     /* Send request (statefully) */
-    status = pjsip_endpt_send_request( pjsua_var.endpt, tdata, -1, 
-				       im_data, &im_callback);
-    if (status != PJ_SUCCESS) {
-	pjsua_perror(THIS_FILE, "Unable to send request", status);
-	return status;
-    }
+    if (send_now)
+	return im_req_send(req, PJ_FALSE);
 
     return PJ_SUCCESS;
+
+on_return:
+    if (im_sess.mutex)
+	pj_mutex_unlock(im_sess.mutex);
+    return status;
 }
 
 
@@ -627,74 +1110,75 @@ PJ_DEF(pj_status_t) pjsua_im_typing( pjsua_acc_id acc_id,
 				     pj_bool_t is_typing,
 				     const pjsua_msg_data *msg_data)
 {
-    const pj_str_t STR_CONTACT = { "Contact", 7 };
     pjsua_im_data *im_data;
+    pjsua_im_peer *peer = NULL;
     pjsip_tx_data *tdata;
-    pjsua_acc *acc;
-    pj_str_t contact;
+    im_req *req = NULL;
     pj_status_t status;
 
-    acc = &pjsua_var.acc[acc_id];
+    is_typing = (is_typing != PJ_FALSE);
 
-    /* Create request. */
-    status = pjsip_endpt_create_request( pjsua_var.endpt, &pjsip_message_method,
-					 to, &acc->cfg.id,
-					 to, NULL, NULL, -1, NULL, &tdata);
-    if (status != PJ_SUCCESS) {
-	pjsua_perror(THIS_FILE, "Unable to create request", status);
-	return status;
-    }
+    if (im_sess.mutex)
+	pj_mutex_lock(im_sess.mutex);
 
+    /* Indications with custom headers or body are sent as they are */
+    if (msg_data == NULL)
+	peer = im_peer_get(acc_id, to);
 
-    /* If account is locked to specific transport, then set transport to
-     * the request.
-     */
-    if (acc->cfg.transport_id != PJSUA_INVALID_ID) {
-	pjsip_tpselector tp_sel;
+    if (peer) {
+	pj_time_val now;
 
-	pjsua_init_tpselector(acc->cfg.transport_id, &tp_sel);
-	pjsip_tx_data_set_transport(tdata, &tp_sel);
-    }
+	pj_gettickcount(&now);
+	PJ_TIME_VAL_SUB(now, peer->typing_time);
 
-    /* Add accept header. */
-    pjsip_msg_add_hdr( tdata->msg, 
-		       (pjsip_hdr*)pjsua_im_create_accept(tdata->pool));
+	if (peer->typing_req) {
+	    /* Still queued, just update its state */
+	    pjsip_tx_data *queued_tdata = peer->typing_req->tdata;
 
+	    if (peer->typing_sent != is_typing) {
+		queued_tdata->msg->body = 
+		    pjsip_iscomposing_create_body(queued_tdata->pool, 
+						  is_typing, NULL, NULL, -1);
+		peer->typing_sent = is_typing;
+		pj_gettickcount(&peer->typing_time);
+	    }
+	    status = PJ_SUCCESS;
 
-    /* Create suitable Contact header unless a Contact header has been
-     * set in the account.
-     */
-    if (acc->contact.slen) {
-	contact = acc->contact;
-    } else {
-	status = pjsua_acc_create_uac_contact(tdata->pool, &contact, acc_id, to);
-	if (status != PJ_SUCCESS) {
-	    pjsua_perror(THIS_FILE, "Unable to generate Contact header", status);
-	    pjsip_tx_data_dec_ref(tdata);
-	    return status;
+	} else if (peer->typing_sent == is_typing && 
+		   (!is_typing || now.sec < PJSUA_IM_TYPING_REFRESH)) 
+	{
+	    /* Remote already has this state */
+	    status = PJ_SUCCESS;
+
+	} else if (peer->typing_busy) {
+	    /* Send it when the outstanding indication completes */
+	    peer->typing_want = is_typing;
+	    status = PJ_SUCCESS;
+
+	} else {
+	    status = im_peer_typing(peer, is_typing, &req);
 	}
+
+	pj_mutex_unlock(im_sess.mutex);
+
+	if (req)
+	    return im_req_send(req, PJ_FALSE);
+
+	return status;
     }
 
-    pjsip_msg_add_hdr( tdata->msg, (pjsip_hdr*)
-	pjsip_generic_string_hdr_create(tdata->pool, 
-					&STR_CONTACT, &contact));
+    if (im_sess.mutex)
+	pj_mutex_unlock(im_sess.mutex);
 
+    status = create_im_request(acc_id, to, NULL, &tdata);
+    if (status != PJ_SUCCESS)
+	return status;
 
     /* Create "application/im-iscomposing+xml" msg body. */
     tdata->msg->body = pjsip_iscomposing_create_body( tdata->pool, is_typing,
 						      NULL, NULL, -1);
 
-    /* Add additional headers etc. */
-    pjsua_process_msg_data(tdata, msg_data);
-
-    /* Add route set */
-    pjsua_set_msg_route_set(tdata, &acc->route_set);
-
-    /* If via_addr is set, use this address for the Via header. */
-    if (acc->cfg.allow_via_rewrite && acc->via_addr.host.slen > 0) {
-        tdata->via_addr = acc->via_addr;
-        tdata->via_tp = acc->via_tp;
-    }
+    finalize_im_request(tdata, &pjsua_var.acc[acc_id], msg_data);
 
     /* Create data to reauthenticate */
     im_data = PJ_POOL_ZALLOC_T(tdata->pool, pjsua_im_data);
@@ -721,6 +1205,7 @@ pj_status_t pjsua_im_init(void)
     const pj_str_t STR_MIME_TEXT_PLAIN = { "text/plain", 10 };
     const pj_str_t STR_MIME_APP_ISCOMPOSING = 
 		    { "application/im-iscomposing+xml", 30 };
+    unsigned i;
     pj_status_t status;
 
     /* Register module */
@@ -740,6 +1225,76 @@ pj_status_t pjsua_im_init(void)
     pjsip_endpt_add_capability( pjsua_var.endpt, &mod_pjsua_im, PJSIP_H_ACCEPT,
 				NULL, 1, &STR_MIME_TEXT_PLAIN);
 
+    /* Init outgoing IM sessions */
+    pj_bzero(&im_sess, sizeof(im_sess));
+    for (i=0; i<PJ_ARRAY_SIZE(im_sess.peer); ++i) {
+	im_sess.peer[i].acc_id = PJSUA_INVALID_ID;
+	pj_list_init(&im_sess.peer[i].queue);
+    }
+
+    status = pj_mutex_create_recursive(pjsua_var.pool, "imsess", 
+				       &im_sess.mutex);
+    if (status != PJ_SUCCESS)
+	return status;
+
     return PJ_SUCCESS;
 }
 
+
+/*
+ * Drop queued outgoing instant messages and release IM sessions. The
+ * dropped messages are reported to application as failed.
+ */
+void pjsua_im_shutdown(void)
+{
+    const pj_str_t reason = { "Shutting down", 13 };
+    im_req dropped;
+    unsigned i;
+
+    if (im_sess.mutex == NULL)
+	return;
+
+    pj_list_init(&dropped);
+
+    pj_mutex_lock(im_sess.mutex);
+
+    for (i=0; i<PJ_ARRAY_SIZE(im_sess.peer); ++i) {
+	pjsua_im_peer *peer = &im_sess.peer[i];
+
+	while (!pj_list_empty(&peer->queue)) {
+	    im_req *req = peer->queue.next;
+
+	    pj_list_erase(req);
+	    req->im_data->peer = NULL;
+	    pj_list_push_back(&dropped, req);
+	}
+	peer->queued = 0;
+	peer->typing_req = NULL;
+
+	if (peer->pool) {
+	    pj_pool_release(peer->pool);
+	    peer->pool = NULL;
+	}
+	peer->acc_id = PJSUA_INVALID_ID;
+    }
+
+    pj_mutex_unlock(im_sess.mutex);
+
+    /* Outstanding transactions no longer touch the sessions */
+    pj_mutex_destroy(im_sess.mutex);
+    im_sess.mutex = NULL;
+
+    /* Report dropped messages, outside the mutex */
+    while (!pj_list_empty(&dropped)) {
+	im_req *req = dropped.next;
+	pjsip_tx_data *tdata = req->tdata;
+
+	pj_list_erase(req);
+	if (req->cb != &typing_callback) {
+	    notify_pager_status(req->im_data, PJSIP_SC_SERVICE_UNAVAILABLE,
+				&reason, tdata, NULL);
+	}
+	pjsip_tx_data_dec_ref(tdata);
+    }
+}
+
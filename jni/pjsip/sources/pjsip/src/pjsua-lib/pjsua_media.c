@@ -47,6 +47,7 @@ static void pjsua_media_config_dup(pj_pool_t *pool,
  */
 pj_status_t pjsua_media_subsys_init(const pjsua_media_config *cfg)
 {
+    pjmedia_endpt_worker_param worker_param;
     pj_status_t status;
 
     pj_log_push_indent();
@@ -75,16 +76,28 @@ pj_status_t pjsua_media_subsys_init(const pjsua_media_config *cfg)
 	pjsua_var.media_cfg.thread_cnt = 1;
     }
 
+    /* Media shares the SIP ioqueue when it has none of its own */
+    if (!pjsua_var.media_cfg.has_ioqueue ||
+	pjsua_var.media_cfg.ioqueue_cnt == 0)
+    {
+	pjsua_var.media_cfg.ioqueue_cnt = 1;
+    }
+
     if (pjsua_var.media_cfg.max_media_ports < pjsua_var.ua_cfg.max_calls) {
 	pjsua_var.media_cfg.max_media_ports = pjsua_var.ua_cfg.max_calls + 2;
     }
 
     /* Create media endpoint. */
-    status = pjmedia_endpt_create(&pjsua_var.cp.factory, 
-				  pjsua_var.media_cfg.has_ioqueue? NULL :
+    pjmedia_endpt_worker_param_default(&worker_param);
+    worker_param.worker_cnt = pjsua_var.media_cfg.thread_cnt;
+    worker_param.ioqueue_cnt = pjsua_var.media_cfg.ioqueue_cnt;
+    worker_param.realtime = pjsua_var.media_cfg.thread_realtime;
+
+    status = pjmedia_endpt_create2(&pjsua_var.cp.factory, 
+				   pjsua_var.media_cfg.has_ioqueue? NULL :
 				     pjsip_endpt_get_ioqueue(pjsua_var.endpt),
-				  pjsua_var.media_cfg.thread_cnt,
-				  &pjsua_var.med_endpt);
+				   &worker_param,
+				   &pjsua_var.med_endpt);
     if (status != PJ_SUCCESS) {
 	pjsua_perror(THIS_FILE, 
 		     "Media stack initialization has returned error", 
@@ -332,7 +345,7 @@ static pj_status_t create_rtp_rtcp_sock(pjsua_call_media *call_med,
 	 * and make sure that the mapped RTCP port is adjacent with the RTP.
 	 */
 	if (!use_ipv6 && pjsua_sip_acc_is_using_stun(call_med->call->acc_id) &&
-	    pjsua_var.stun_srv.addr.sa_family != 0)
+	    pjsua_var.stun_srv.addr.sa_family != 0 && !pjsua_nat_is_open())
 	{
 	    char ip_addr[32];
 	    pj_str_t stun_srv;
@@ -468,8 +481,13 @@ static pj_status_t create_udp_media_transport(const pjsua_transport_config *cfg,
 	goto on_error;
     }
 
-    status = pjmedia_transport_udp_attach(pjsua_var.med_endpt, NULL,
-					  &skinfo, 0, &call_med->tp);
+    /* Keep all media of a call on the same media worker threads */
+    status = pjmedia_transport_udp_attach2(pjsua_var.med_endpt, NULL,
+					   &skinfo, 0,
+					   pjmedia_endpt_get_ioqueue_by_key(
+						pjsua_var.med_endpt,
+						call_med->call->index),
+					   &call_med->tp);
     if (status != PJ_SUCCESS) {
 	pjsua_perror(THIS_FILE, "Unable to create media transport",
 		     status);
@@ -710,6 +728,13 @@ static pj_status_t create_ice_media_transport(
     pj_stun_config_init(&ice_cfg.stun_cfg, &pjsua_var.cp.factory, 0,
 		        pjsip_endpt_get_ioqueue(pjsua_var.endpt),
 			pjsip_endpt_get_timer_heap(pjsua_var.endpt));
+
+    /* Keep ICE media off the SIP worker threads with media worker pool */
+    if (pjsua_var.media_cfg.ioqueue_cnt > 1) {
+	ice_cfg.stun_cfg.ioqueue =
+	    pjmedia_endpt_get_ioqueue_by_key(pjsua_var.med_endpt,
+					     call_med->call->index);
+    }
     
     ice_cfg.af = pj_AF_INET();
     ice_cfg.resolver = pjsua_var.resolver;
@@ -761,9 +786,15 @@ static pj_status_t create_ice_media_transport(
     pj_ansi_snprintf(name, sizeof(name), "icetp%02d", call_med->idx);
     call_med->tp_ready = PJ_EPENDING;
 
+    /* The RTCP component is not needed when answering an offer that
+     * multiplexes RTCP on the RTP port.
+     */
     comp_cnt = 1;
-    if (PJMEDIA_ADVERTISE_RTCP && !acc_cfg->ice_cfg.ice_no_rtcp)
+    if (PJMEDIA_ADVERTISE_RTCP && !acc_cfg->ice_cfg.ice_no_rtcp &&
+	!(pjsua_var.media_cfg.enable_rtcp_mux && call_med->rem_rtcp_mux))
+    {
 	++comp_cnt;
+    }
 
     status = pjmedia_ice_create3(pjsua_var.med_endpt, name, comp_cnt,
 				 &ice_cfg, &ice_cb, 0, call_med,
@@ -1301,6 +1332,16 @@ pj_status_t pjsua_call_media_init(pjsua_call_media *call_med,
          */
         call_med->med_init_cb = NULL;
 
+    } else if (call_med->tp_st == PJSUA_MED_TP_CREATING) {
+	/* The ICE transport has been started together with the other
+	 * media lines by start_ice_media_transports(), and has completed.
+	 */
+	status = call_med->tp_ready;
+	if (status != PJ_SUCCESS)
+	    PJ_PERROR(1,(THIS_FILE, status, "Error creating media transport"));
+
+	call_med->med_init_cb = NULL;
+
     } else if (call_med->tp_st == PJSUA_MED_TP_DISABLED) {
 	/* Media is being reenabled. */
 	//pjsua_set_media_tp_state(call_med, PJSUA_MED_TP_IDLE);
@@ -1312,6 +1353,452 @@ pj_status_t pjsua_call_media_init(pjsua_call_media *call_med,
                               sip_err_code);
 }
 
+/*
+ * BUNDLE (RFC 8843) support. The first bundled media line is the tagged
+ * media line, its transport is shared by the other media lines of the
+ * group through pjmedia_transport_bundle.
+ */
+
+/* Check whether the call may bundle its media lines */
+static pj_bool_t bundle_enabled(const pjsua_call *call)
+{
+    return pjsua_var.media_cfg.enable_bundle &&
+	   pjsua_var.acc[call->acc_id].cfg.use_srtp == PJMEDIA_SRTP_DISABLED;
+}
+
+/* Get the identification tag ("a=mid") of a media line */
+static pj_bool_t get_mid(const pjmedia_sdp_media *m, pj_str_t *mid)
+{
+    const pjmedia_sdp_attr *a;
+
+    a = pjmedia_sdp_media_find_attr2(m, "mid", NULL);
+    if (!a || a->value.slen == 0)
+	return PJ_FALSE;
+
+    *mid = a->value;
+    return PJ_TRUE;
+}
+
+/* Check whether the media line with the mid is in the BUNDLE group of
+ * the session.
+ */
+static pj_bool_t in_bundle_group(const pjmedia_sdp_session *sdp,
+				 const pj_str_t *mid)
+{
+    unsigned i;
+
+    for (i = 0; i < sdp->attr_count; ++i) {
+	const pjmedia_sdp_attr *a = sdp->attr[i];
+	const char *p, *end;
+
+	if (pj_stricmp2(&a->name, "group") != 0 || a->value.slen < 6 ||
+	    pj_ansi_strnicmp(a->value.ptr, "BUNDLE", 6) != 0 ||
+	    (a->value.slen > 6 && a->value.ptr[6] != ' '))
+	{
+	    continue;
+	}
+
+	/* "BUNDLE" *(SP identification-tag) */
+	p = a->value.ptr + 6;
+	end = a->value.ptr + a->value.slen;
+	while (p < end) {
+	    const char *tok;
+
+	    while (p < end && (*p == ' ' || *p == '\t'))
+		++p;
+	    tok = p;
+	    while (p < end && *p != ' ' && *p != '\t')
+		++p;
+	    if (p - tok == mid->slen &&
+		pj_memcmp(tok, mid->ptr, mid->slen) == 0)
+	    {
+		return PJ_TRUE;
+	    }
+	}
+    }
+
+    return PJ_FALSE;
+}
+
+/* Check whether the media line is active and in the BUNDLE group of
+ * the SDP, and get its mid.
+ */
+static pj_bool_t is_bundled_in(const pjmedia_sdp_session *sdp, unsigned mi,
+			       pj_str_t *mid)
+{
+    return mi < sdp->media_count && sdp->media[mi]->desc.port != 0 &&
+	   get_mid(sdp->media[mi], mid) && in_bundle_group(sdp, mid);
+}
+
+/* Check whether the transport of the provisional media is used by the
+ * current call media.
+ */
+static pj_bool_t is_tp_in_use(const pjsua_call *call, unsigned mi)
+{
+    return mi < call->med_cnt && call->media[mi].tp &&
+	   call->media[mi].tp == call->media_prov[mi].tp;
+}
+
+/* Decide which media lines to bundle in our answer to the remote offer.
+ * The media lines to be added to the group get no transport of their
+ * own, media_channel_init_cb() creates their member transport once the
+ * transport of the tagged media line is ready.
+ */
+static void plan_bundle(pjsua_call *call, const pjmedia_sdp_session *rem_sdp,
+			const pj_bool_t enabled[])
+{
+    pj_bool_t bundle[PJSUA_MAX_CALL_MEDIA];
+    unsigned mi, tag = 0, cnt = 0;
+
+    if (!bundle_enabled(call))
+	return;
+
+    for (mi = 0; mi < call->med_prov_cnt; ++mi) {
+	pjsua_call_media *call_med = &call->media_prov[mi];
+	pj_str_t mid;
+
+	bundle[mi] = enabled[mi] && is_bundled_in(rem_sdp, mi, &mid);
+	if (!bundle[mi])
+	    continue;
+
+	if (cnt == 0) {
+	    tag = mi;
+	} else if (call_med->tp &&
+		   (!call_med->bundled || call_med->bundle_tag != tag))
+	{
+	    /* Media lines can't join the group once they have their own
+	     * transport.
+	     */
+	    bundle[mi] = PJ_FALSE;
+	    continue;
+	}
+	++cnt;
+    }
+
+    if (cnt < 2)
+	return;
+
+    /* A new group is only created for media lines without transports */
+    if (call->media_prov[tag].tp && !call->media_prov[tag].bundled)
+	return;
+
+    for (mi = tag; mi < call->med_prov_cnt; ++mi) {
+	pjsua_call_media *call_med = &call->media_prov[mi];
+
+	if (bundle[mi] && !call_med->tp) {
+	    call_med->bundled = PJ_TRUE;
+	    call_med->bundle_tag = tag;
+	}
+    }
+}
+
+/* Create the transports of the bundled media lines, after the transport
+ * of the tagged media line is ready.
+ */
+static pj_status_t create_bundle_transports(pjsua_call *call)
+{
+    unsigned mi;
+    pj_status_t status;
+
+    for (mi = 0; mi < call->med_prov_cnt; ++mi) {
+	pjsua_call_media *call_med = &call->media_prov[mi];
+	pjsua_call_media *tag_med;
+	pjmedia_transport_info tpinfo;
+
+	if (!call_med->bundled || call_med->tp)
+	    continue;
+
+	tag_med = &call->media_prov[call_med->bundle_tag];
+	if (!tag_med->tp)
+	    return PJ_EINVALIDOP;
+
+	if (tag_med->tp->type != PJMEDIA_TRANSPORT_TYPE_BUNDLE) {
+	    pjmedia_transport *tp;
+
+	    status = pjmedia_transport_bundle_create(pjsua_var.med_endpt,
+						     NULL, tag_med->tp, &tp);
+	    if (status != PJ_SUCCESS)
+		return status;
+	    tag_med->tp = tp;
+	}
+
+	status = pjmedia_transport_bundle_add_member(tag_med->tp, NULL,
+						     &call_med->tp);
+	if (status != PJ_SUCCESS) {
+	    call_med->tp = NULL;
+	    return status;
+	}
+	call_med->tp_orig = call_med->tp;
+	call_med->use_custom_med_tp = PJ_FALSE;
+
+	pjmedia_transport_info_init(&tpinfo);
+	pjmedia_transport_get_info(call_med->tp, &tpinfo);
+	pj_sockaddr_cp(&call_med->rtp_addr, &tpinfo.sock_info.rtp_addr_name);
+
+	pjsua_set_media_tp_state(call_med, PJSUA_MED_TP_IDLE);
+
+	PJ_LOG(4,(THIS_FILE, "Call %d: media #%d bundled with media #%d",
+		  call->index, mi, call_med->bundle_tag));
+    }
+
+    return PJ_SUCCESS;
+}
+
+/* Add the media identification tags and the BUNDLE group to our SDP */
+static void encode_bundle_sdp(pjsua_call *call, pj_pool_t *pool,
+			      pjmedia_sdp_session *sdp,
+			      const pjmedia_sdp_session *rem_sdp)
+{
+    const pjmedia_sdp_session *active_sdp = NULL;
+    char group[128];
+    pj_str_t value;
+    unsigned mi, cnt = 0;
+    int len;
+
+    if (!bundle_enabled(call))
+	return;
+
+    /* Keep the mids of the current session in our re-offer */
+    if (!rem_sdp && call->inv && call->inv->neg &&
+	pjmedia_sdp_neg_get_state(call->inv->neg) ==
+	    PJMEDIA_SDP_NEG_STATE_DONE)
+    {
+	pjmedia_sdp_neg_get_active_local(call->inv->neg, &active_sdp);
+    }
+
+    len = pj_ansi_snprintf(group, sizeof(group), "BUNDLE");
+    for (mi = 0; mi < sdp->media_count; ++mi) {
+	pjmedia_sdp_media *m = sdp->media[mi];
+	pj_bool_t grouped = PJ_TRUE;
+	pj_str_t mid;
+	char buf[16];
+
+	if (m->desc.port == 0 || mi >= call->med_prov_cnt ||
+	    pjmedia_sdp_media_find_attr2(m, "mid", NULL))
+	{
+	    continue;
+	}
+
+	if (rem_sdp) {
+	    /* Answer with the mid of the offer, and only group the media
+	     * lines that are bundled.
+	     */
+	    if (!get_mid(rem_sdp->media[mi], &mid))
+		continue;
+	    grouped = call->media_prov[mi].bundled &&
+		      in_bundle_group(rem_sdp, &mid);
+	} else if (!active_sdp || mi >= active_sdp->media_count ||
+		   !get_mid(active_sdp->media[mi], &mid))
+	{
+	    pj_ansi_snprintf(buf, sizeof(buf), "%d", mi);
+	    mid = pj_str(buf);
+	}
+
+	pjmedia_sdp_media_add_attr(m, pjmedia_sdp_attr_create(pool, "mid",
+							       &mid));
+
+	if (grouped && len + 1 + mid.slen < (int)sizeof(group)) {
+	    len += pj_ansi_snprintf(group + len, sizeof(group) - len, " %.*s",
+				    (int)mid.slen, mid.ptr);
+	    ++cnt;
+	}
+    }
+
+    if (cnt < 2)
+	return;
+
+    value.ptr = group;
+    value.slen = len;
+    pjmedia_sdp_attr_add(&sdp->attr_count, sdp->attr,
+			 pjmedia_sdp_attr_create(pool, "group", &value));
+}
+
+/* Bundle the media lines that both SDPs have put in the BUNDLE group,
+ * before the media transports are started. This replaces the transports
+ * that we have created for our offer.
+ */
+static void update_bundle(pjsua_call *call,
+			  const pjmedia_sdp_session *local_sdp,
+			  const pjmedia_sdp_session *remote_sdp)
+{
+    pj_bool_t agreed[PJSUA_MAX_CALL_MEDIA];
+    pjsua_call_media *tag_med;
+    unsigned mi, tag = 0, cnt = 0;
+    pj_status_t status;
+
+    if (!bundle_enabled(call))
+	return;
+
+    for (mi = 0; mi < call->med_prov_cnt; ++mi) {
+	pj_str_t mid, rem_mid;
+
+	agreed[mi] = call->media_prov[mi].tp &&
+		     is_bundled_in(local_sdp, mi, &mid) &&
+		     is_bundled_in(remote_sdp, mi, &rem_mid) &&
+		     pj_strcmp(&mid, &rem_mid) == 0;
+	if (agreed[mi]) {
+	    if (cnt == 0)
+		tag = mi;
+	    ++cnt;
+	} else if (call->media_prov[mi].bundled &&
+		   call->media_prov[mi].tp &&
+		   mi < local_sdp->media_count &&
+		   local_sdp->media[mi]->desc.port != 0)
+	{
+	    PJ_LOG(3,(THIS_FILE, "Call %d: media #%d stays bundled, removing "
+		      "media lines from BUNDLE group is not supported",
+		      call->index, mi));
+	}
+    }
+
+    if (cnt < 2)
+	return;
+
+    tag_med = &call->media_prov[tag];
+    if (!tag_med->bundled) {
+	pjmedia_transport *tp;
+
+	if (is_tp_in_use(call, tag)) {
+	    PJ_LOG(3,(THIS_FILE, "Call %d: can't bundle media lines of "
+		      "established session", call->index));
+	    return;
+	}
+
+	status = pjmedia_transport_bundle_create(pjsua_var.med_endpt, NULL,
+						 tag_med->tp, &tp);
+	if (status != PJ_SUCCESS) {
+	    PJ_PERROR(1,(THIS_FILE, status, "Error creating BUNDLE group"));
+	    return;
+	}
+	tag_med->tp = tp;
+	tag_med->bundled = PJ_TRUE;
+	tag_med->bundle_tag = tag;
+    } else if (tag_med->bundle_tag != tag) {
+	PJ_LOG(3,(THIS_FILE, "Call %d: media #%d can't be the tagged media "
+		  "line of the established BUNDLE group", call->index, tag));
+	return;
+    }
+
+    for (mi = tag + 1; mi < call->med_prov_cnt; ++mi) {
+	pjsua_call_media *call_med = &call->media_prov[mi];
+
+	if (!agreed[mi] || call_med->bundled)
+	    continue;
+
+	if (is_tp_in_use(call, mi)) {
+	    PJ_LOG(3,(THIS_FILE, "Call %d: media #%d of established session "
+		      "can't join BUNDLE group", call->index, mi));
+	    continue;
+	}
+
+	/* Replace the transport of our offer */
+	if (call_med->tp_st > PJSUA_MED_TP_IDLE) {
+	    pjsua_set_media_tp_state(call_med, PJSUA_MED_TP_IDLE);
+	    pjmedia_transport_media_stop(call_med->tp);
+	}
+	pjsua_set_media_tp_state(call_med, PJSUA_MED_TP_NULL);
+	pjmedia_transport_close(call_med->tp);
+	call_med->tp = call_med->tp_orig = NULL;
+
+	status = pjmedia_transport_bundle_add_member(tag_med->tp, NULL,
+						     &call_med->tp);
+	if (status != PJ_SUCCESS) {
+	    PJ_PERROR(1,(THIS_FILE, status, "Error adding media to BUNDLE "
+			 "group"));
+	    call_med->tp = NULL;
+	    continue;
+	}
+	call_med->tp_orig = call_med->tp;
+	call_med->bundled = PJ_TRUE;
+	call_med->bundle_tag = tag;
+	pjsua_set_media_tp_state(call_med, PJSUA_MED_TP_INIT);
+
+	PJ_LOG(4,(THIS_FILE, "Call %d: media #%d bundled with media #%d",
+		  call->index, mi, tag));
+    }
+}
+
+
+/* Start ICE transports of all media lines that need one and wait for
+ * them together, instead of gathering the candidates of one media line
+ * after another. pjsua_call_media_init() picks up the result later.
+ */
+static void start_ice_media_transports(pjsua_call *call,
+				       const pjsua_transport_config *tcfg,
+				       const pjmedia_type media_types[],
+				       const pj_bool_t enabled[])
+{
+    pj_bool_t has_pjsua_lock;
+    pj_bool_t pending;
+    pj_time_val t0, t1;
+    unsigned mi, cnt = 0;
+
+    pj_gettickcount(&t0);
+
+    for (mi=0; mi < call->med_prov_cnt; ++mi) {
+	pjsua_call_media *call_med = &call->media_prov[mi];
+	pj_status_t status;
+
+	if (!enabled[mi] || call_med->tp ||
+	    (call_med->bundled && call_med->bundle_tag != mi))
+	{
+	    continue;
+	}
+
+	call_med->type = media_types[mi];
+#if defined(PJMEDIA_HAS_VIDEO) && (PJMEDIA_HAS_VIDEO != 0)
+	if (media_types[mi] == PJMEDIA_TYPE_VIDEO &&
+	    pjsua_vid_channel_init(call_med) != PJ_SUCCESS)
+	{
+	    continue;
+	}
+#endif
+
+	pjsua_set_media_tp_state(call_med, PJSUA_MED_TP_CREATING);
+	call_med->med_create_cb = NULL;
+
+	status = create_ice_media_transport(tcfg, call_med, PJ_TRUE);
+	if (status != PJ_SUCCESS && status != PJ_EPENDING) {
+	    /* Let pjsua_call_media_init() retry and report the error */
+	    pjsua_set_media_tp_state(call_med, PJSUA_MED_TP_NULL);
+	    continue;
+	}
+	++cnt;
+    }
+
+    if (cnt == 0)
+	return;
+
+    has_pjsua_lock = PJSUA_LOCK_IS_LOCKED();
+    if (has_pjsua_lock)
+	PJSUA_UNLOCK();
+
+    do {
+	pending = PJ_FALSE;
+	for (mi=0; mi < call->med_prov_cnt; ++mi) {
+	    pjsua_call_media *call_med = &call->media_prov[mi];
+
+	    if (call_med->tp && call_med->tp_st == PJSUA_MED_TP_CREATING &&
+		call_med->tp_ready == PJ_EPENDING)
+	    {
+		pending = PJ_TRUE;
+		break;
+	    }
+	}
+	if (pending)
+	    pjsua_handle_events(100);
+    } while (pending);
+
+    if (has_pjsua_lock)
+	PJSUA_LOCK();
+
+    pj_gettickcount(&t1);
+    PJ_TIME_VAL_SUB(t1, t0);
+    PJ_LOG(4,(THIS_FILE, "Call %d: ICE transports of %d media line(s) "
+			 "ready in %ld ms",
+	      call->index, cnt, PJ_TIME_VAL_MSEC(t1)));
+}
+
 /* Callback to resume pjsua_media_channel_init() after media transport
  * initialization is completed.
  */
@@ -1369,6 +1856,15 @@ static pj_status_t media_channel_init_cb(pjsua_call_id call_id,
         goto on_return;
     }
 
+    /* Bundled media lines share the transport of the tagged media line */
+    status = create_bundle_transports(call);
+    if (status != PJ_SUCCESS) {
+	call->med_ch_info.status = status;
+	call->med_ch_info.sip_err_code = PJSIP_SC_TEMPORARILY_UNAVAILABLE;
+	pjsua_media_prov_clean_up(call_id);
+	goto on_return;
+    }
+
     /* Tell the media transport of a new offer/answer session */
     for (mi=0; mi < call->med_prov_cnt; ++mi) {
 	pjsua_call_media *call_med = &call->media_prov[mi];
@@ -1399,7 +1895,9 @@ static pj_status_t media_channel_init_cb(pjsua_call_id call_id,
             if (call_med->tp) {
                 status = pjmedia_transport_media_create(
                              call_med->tp, tmp_pool,
-                             0, call->async_call.rem_sdp, mi);
+                             (pjsua_var.media_cfg.enable_rtcp_mux?
+                              PJMEDIA_TPMED_RTCP_MUX : 0),
+                             call->async_call.rem_sdp, mi);
             }
 	    if (status != PJ_SUCCESS) {
                 call->med_ch_info.status = status;
@@ -1460,6 +1958,7 @@ void pjsua_media_prov_clean_up(pjsua_call_id call_id)
 }
 
 
+
 pj_status_t pjsua_media_channel_init(pjsua_call_id call_id,
 				     pjsip_role_e role,
 				     int security_level,
@@ -1479,6 +1978,8 @@ pj_status_t pjsua_media_channel_init(pjsua_call_id call_id,
     pj_uint8_t mvididx[PJSUA_MAX_CALL_MEDIA];
     unsigned mvidcnt = PJ_ARRAY_SIZE(mvididx);
     unsigned mtotvidcnt = PJ_ARRAY_SIZE(mvididx);
+    pjmedia_type media_types[PJSUA_MAX_CALL_MEDIA];
+    pj_bool_t enabled[PJSUA_MAX_CALL_MEDIA];
     unsigned mi;
     pj_bool_t pending_med_tp = PJ_FALSE;
     pj_bool_t reinit = PJ_FALSE;
@@ -1669,29 +2170,79 @@ pj_status_t pjsua_media_channel_init(pjsua_call_id call_id,
 
     call->async_call.pool_prov = tmp_pool;
 
-    /* Initialize each media line */
+    /* Media lines whose transport has been closed have left the group */
+    for (mi=0; mi < call->med_prov_cnt; ++mi) {
+	if (call->media_prov[mi].tp == NULL)
+	    call->media_prov[mi].bundled = PJ_FALSE;
+    }
+
+    /* Get the type of each media line and whether it's enabled */
     for (mi=0; mi < call->med_prov_cnt; ++mi) {
 	pjsua_call_media *call_med = &call->media_prov[mi];
-	pj_bool_t enabled = PJ_FALSE;
-	pjmedia_type media_type = PJMEDIA_TYPE_UNKNOWN;
+
+	enabled[mi] = PJ_FALSE;
+	media_types[mi] = PJMEDIA_TYPE_UNKNOWN;
 
 	if (pj_memchr(maudidx, mi, mtotaudcnt * sizeof(maudidx[0]))) {
-	    media_type = PJMEDIA_TYPE_AUDIO;
+	    media_types[mi] = PJMEDIA_TYPE_AUDIO;
 	    if (call->opt.aud_cnt &&
 		pj_memchr(maudidx, mi, maudcnt * sizeof(maudidx[0])))
 	    {
-		enabled = PJ_TRUE;
+		enabled[mi] = PJ_TRUE;
 	    }
 	} else if (pj_memchr(mvididx, mi, mtotvidcnt * sizeof(mvididx[0]))) {
-	    media_type = PJMEDIA_TYPE_VIDEO;
+	    media_types[mi] = PJMEDIA_TYPE_VIDEO;
 	    if (call->opt.vid_cnt &&
 		pj_memchr(mvididx, mi, mvidcnt * sizeof(mvididx[0])))
 	    {
-		enabled = PJ_TRUE;
+		enabled[mi] = PJ_TRUE;
 	    }
 	}
 
-	if (enabled) {
+	if (enabled[mi]) {
+	    /* Creating one ICE component is enough if remote offers to
+	     * multiplex RTCP on the RTP port.
+	     */
+	    call_med->rem_rtcp_mux =
+		rem_sdp && mi < rem_sdp->media_count &&
+		pjmedia_sdp_media_find_attr2(rem_sdp->media[mi], "rtcp-mux",
+					     NULL) != NULL;
+	}
+    }
+
+    if (rem_sdp)
+	plan_bundle(call, rem_sdp, enabled);
+
+    /* Asynchronous initialization already gathers the ICE candidates of
+     * all media lines at once. Do the same when we must wait here.
+     */
+    if (!async && acc->cfg.ice_cfg.enable_ice) {
+	start_ice_media_transports(call, &acc->cfg.rtp_cfg, media_types,
+				   enabled);
+    }
+
+    /* Initialize each media line */
+    for (mi=0; mi < call->med_prov_cnt; ++mi) {
+	pjsua_call_media *call_med = &call->media_prov[mi];
+	pjmedia_type media_type = media_types[mi];
+
+	if (enabled[mi] && call_med->bundled && call_med->bundle_tag != mi &&
+	    call_med->tp == NULL)
+	{
+	    /* The transport is created by media_channel_init_cb() */
+	    call_med->type = media_type;
+	    call_med->tp_ready = PJ_SUCCESS;
+	    call_med->med_init_cb = NULL;
+#if defined(PJMEDIA_HAS_VIDEO) && (PJMEDIA_HAS_VIDEO != 0)
+	    if (media_type == PJMEDIA_TYPE_VIDEO) {
+		status = pjsua_vid_channel_init(call_med);
+		if (status != PJ_SUCCESS) {
+		    pjsua_media_prov_clean_up(call_id);
+		    goto on_error;
+		}
+	    }
+#endif
+	} else if (enabled[mi]) {
 	    status = pjsua_call_media_init(call_med, media_type,
 	                                   &acc->cfg.rtp_cfg,
 					   security_level, sip_err_code,
@@ -1993,6 +2544,9 @@ pj_status_t pjsua_media_channel_create_sdp(pjsua_call_id call_id,
 	}
     }
 
+    /* Offer or accept BUNDLE */
+    encode_bundle_sdp(call, pool, sdp, rem_sdp);
+
     /* Add NAT info in the SDP */
     if (pjsua_var.ua_cfg.nat_type_in_sdp) {
 	pjmedia_sdp_attr *a;
@@ -2294,6 +2848,13 @@ static pj_bool_t is_media_changed(const pjsua_call *call,
 	    return PJ_TRUE;
 	}
 
+	/* Compare RTP header extensions */
+	if (old_si->tx_audio_level_id != new_si->tx_audio_level_id ||
+	    old_si->rx_audio_level_id != new_si->rx_audio_level_id)
+	{
+	    return PJ_TRUE;
+	}
+
 	/* Compare codec param */
 	if (old_cp->setting.frm_per_pkt != new_cp->setting.frm_per_pkt ||
 	    old_cp->setting.vad != new_cp->setting.vad ||
@@ -2462,6 +3023,9 @@ pj_status_t pjsua_media_channel_update(pjsua_call_id call_id,
 	need_renego_sdp = PJ_TRUE;
     }
 
+    /* Share the transport of the bundled media lines */
+    update_bundle(call, local_sdp, remote_sdp);
+
     /* Process each media stream */
     for (mi=0; mi < call->med_prov_cnt; ++mi) {
 	pjsua_call_media *call_med = &call->media_prov[mi];
@@ -2516,8 +3080,14 @@ pj_status_t pjsua_media_channel_update(pjsua_call_id call_id,
 		is_media_changed(call, mi, &stream_info))
 	    {
 		media_changed = PJ_TRUE;
-		/* Stop the media */
-		stop_media_stream(call, mi);
+		/* Stop the media, unless the running stream may be updated
+		 * once the media transport is restarted below.
+		 */
+		if (pjsua_var.media_cfg.no_smart_media_update ||
+		    si->dir == PJMEDIA_DIR_NONE)
+		{
+		    stop_media_stream(call, mi);
+		}
 	    } else {
 		PJ_LOG(4,(THIS_FILE, "Call %d: stream #%d (audio) unchanged.",
 			  call_id, mi));
@@ -2542,6 +3112,8 @@ pj_status_t pjsua_media_channel_update(pjsua_call_id call_id,
 				 "pjmedia_transport_media_start() failed "
 				     "for call_id %d media %d",
 				 call_id, mi));
+		    if (media_changed)
+			stop_media_stream(call, mi);
 		    continue;
 		}
 
@@ -2565,8 +3137,16 @@ pj_status_t pjsua_media_channel_update(pjsua_call_id call_id,
 		    }
 		}
 
-		/* Update audio channel */
-		if (media_changed) {
+		/* Update audio channel. The running stream is updated in
+		 * place when possible, to keep its conference slot and
+		 * jitter buffer, otherwise it's recreated.
+		 */
+		if (media_changed && call_med->strm.a.stream &&
+		    pjsua_aud_stream_update(call_med, si) != PJ_SUCCESS)
+		{
+		    stop_media_stream(call, mi);
+		}
+		if (media_changed && !call_med->strm.a.stream) {
 		    status = pjsua_aud_channel_update(call_med,
 						      call->inv->pool, si,
 						      local_sdp, remote_sdp);
@@ -1547,6 +1547,7 @@ static pj_status_t call_add_video(pjsua_call *call,
 
     /* Initialize call media */
     call_med = &call->media_prov[call->med_prov_cnt++];
+    call_med->rem_rtcp_mux = PJ_FALSE;
     status = pjsua_call_media_init(call_med, PJMEDIA_TYPE_VIDEO,
 				   &acc_cfg->rtp_cfg, call->secure_level,
 				   NULL, PJ_FALSE, NULL);
@@ -1557,7 +1558,9 @@ static pj_status_t call_add_video(pjsua_call *call,
     call_med->strm.v.cap_dev = cap_dev;
 
     /* Init transport media */
-    status = pjmedia_transport_media_create(call_med->tp, pool, 0,
+    status = pjmedia_transport_media_create(call_med->tp, pool,
+					    (pjsua_var.media_cfg.enable_rtcp_mux?
+					     PJMEDIA_TPMED_RTCP_MUX : 0),
 					    NULL, call_med->idx);
     if (status != PJ_SUCCESS)
 	goto on_error;
@@ -1694,6 +1697,7 @@ static pj_status_t call_modify_video(pjsua_call *call,
 		call->opt.vid_cnt++;
 	}
 
+	call_med->rem_rtcp_mux = PJ_FALSE;
 	status = pjsua_call_media_init(call_med, PJMEDIA_TYPE_VIDEO,
 				       &acc_cfg->rtp_cfg, call->secure_level,
 				       NULL, PJ_FALSE, NULL);
@@ -1702,8 +1706,11 @@ static pj_status_t call_modify_video(pjsua_call *call,
 
 	/* Init transport media */
 	if (call_med->tp && call_med->tp_st == PJSUA_MED_TP_IDLE) {
-	    status = pjmedia_transport_media_create(call_med->tp, pool, 0,
-						    NULL, call_med->idx);
+	    status = pjmedia_transport_media_create(
+				call_med->tp, pool,
+				(pjsua_var.media_cfg.enable_rtcp_mux?
+				 PJMEDIA_TPMED_RTCP_MUX : 0),
+				NULL, call_med->idx);
 	    if (status != PJ_SUCCESS)
 		goto on_error;
 	}
@@ -235,6 +235,88 @@ struct test_msg
 }
 };
 
+/* Typical traffic seen by a UA behind a couple of proxies, used to compare
+ * the lazy and full header parsing.
+ */
+static struct test_msg mixed_array[] = 
+{
+{
+    /* Response to INVITE, routed through two proxies. */
+    "SIP/2.0 200 OK\r\n"
+    "Via: SIP/2.0/UDP proxy2.biloxi.com:5060;branch=z9hG4bK721e418c4.1\r\n"
+    "Via: SIP/2.0/UDP proxy1.atlanta.com:5060;branch=z9hG4bK2d4790.1\r\n"
+    "Via: SIP/2.0/UDP pc33.atlanta.com;rport=5060;branch=z9hG4bK74bf9"
+    ";received=192.0.2.101\r\n"
+    "Record-Route: <sip:proxy2.biloxi.com;lr>, <sip:proxy1.atlanta.com;lr>\r\n"
+    "From: Alice <sip:alice@atlanta.com>;tag=9fxced76sl\r\n"
+    "To: Bob <sip:bob@biloxi.com>;tag=314159\r\n"
+    "Call-ID: 3848276298220188511@atlanta.example.com\r\n"
+    "CSeq: 2 INVITE\r\n"
+    "Contact: <sip:bob@192.0.2.4;transport=udp>\r\n"
+    "Allow: INVITE, ACK, CANCEL, OPTIONS, BYE, REFER, NOTIFY, "
+    "SUBSCRIBE, UPDATE, PRACK, MESSAGE, INFO\r\n"
+    "Accept: application/sdp, application/dtmf-relay\r\n"
+    "Supported: replaces, timer, 100rel\r\n"
+    "Session-Expires: 1800;refresher=uac\r\n"
+    "User-Agent: Softphone Beta1.5\r\n"
+    "Content-Type: application/sdp\r\n"
+    "Content-Length: 133\r\n"
+    "\r\n"
+    "v=0\r\n"
+    "o=bob 2890844527 2890844527 IN IP4 192.0.2.4\r\n"
+    "s=-\r\n"
+    "c=IN IP4 192.0.2.4\r\n"
+    "t=0 0\r\n"
+    "m=audio 3456 RTP/AVP 0 101\r\n"
+    "a=rtpmap:0 PCMU/8000\r\n",
+    NULL,
+    0,
+    PJ_SUCCESS
+},
+{
+    /* Presence notification. */
+    "NOTIFY sip:alice@pc33.atlanta.com SIP/2.0\r\n"
+    "Via: SIP/2.0/TCP proxy1.atlanta.com;branch=z9hG4bKna998sl.1\r\n"
+    "Via: SIP/2.0/TCP server.biloxi.com;branch=z9hG4bKna998sk\r\n"
+    "Max-Forwards: 69\r\n"
+    "Route: <sip:proxy1.atlanta.com;lr>\r\n"
+    "From: <sip:bob@biloxi.com>;tag=ffd2\r\n"
+    "To: <sip:alice@atlanta.com>;tag=xfg9\r\n"
+    "Call-ID: 2010@pc33.atlanta.com\r\n"
+    "CSeq: 20 NOTIFY\r\n"
+    "Contact: <sip:server.biloxi.com;transport=tcp>\r\n"
+    "Event: presence\r\n"
+    "Subscription-State: active;expires=599\r\n"
+    "Allow-Events: presence, message-summary, refer\r\n"
+    "Content-Type: application/pidf+xml\r\n"
+    "Content-Length: 0\r\n"
+    "\r\n",
+    NULL,
+    0,
+    PJ_SUCCESS
+},
+{
+    /* Registration refresh. */
+    "REGISTER sip:registrar.biloxi.com SIP/2.0\r\n"
+    "Via: SIP/2.0/UDP bobspc.biloxi.com:5060;rport;branch=z9hG4bKnashds7\r\n"
+    "Max-Forwards: 70\r\n"
+    "To: Bob <sip:bob@biloxi.com>\r\n"
+    "From: Bob <sip:bob@biloxi.com>;tag=456248\r\n"
+    "Call-ID: 843817637684230@998sdasdh09\r\n"
+    "CSeq: 1826 REGISTER\r\n"
+    "Contact: <sip:bob@192.0.2.4>;expires=3600\r\n"
+    "Expires: 7200\r\n"
+    "Allow: INVITE, ACK, CANCEL, OPTIONS, BYE, NOTIFY, SUBSCRIBE\r\n"
+    "Supported: path, outbound, gruu\r\n"
+    "User-Agent: Softphone Beta1.5\r\n"
+    "Content-Length: 0\r\n"
+    "\r\n",
+    NULL,
+    0,
+    PJ_SUCCESS
+}
+};
+
 static struct
 {
     int flag;
@@ -315,6 +397,10 @@ parse_msg:
     if ((var.flag & FLAG_PARSE_ONLY) || entry->creator==NULL)
 	return PJ_SUCCESS;
 
+    /* Lazy headers are compared in their parsed form */
+    if (pjsip_cfg()->endpt.lazy_hdr_parse)
+	pjsip_msg_parse_lazy_hdrs(parsed_msg);
+
     /* Create reference message. */
     ref_msg = entry->creator(pool);
 
@@ -843,6 +929,113 @@ static pj_status_t simple_test(void)
     return PJ_SUCCESS;
 }
 
+/* Run the message tests with lazy header parsing, and check that lazy
+ * headers are parsed on lookup.
+ */
+static int lazy_test(void)
+{
+    static const pj_str_t STR_ALLOW = { "Allow", 5 };
+    static const pj_str_t STR_SE = { "Session-Expires", 15 };
+    pj_bool_t saved_lazy = pjsip_cfg()->endpt.lazy_hdr_parse;
+    struct test_msg *entry = &mixed_array[0];
+    pj_pool_t *pool;
+    pjsip_msg *msg;
+    pjsip_via_hdr *via;
+    pjsip_allow_hdr *allow;
+    pjsip_hdr *hdr;
+    unsigned i, lazy_cnt;
+    int rc = 0;
+
+    PJ_LOG(3,(THIS_FILE, "  lazy header parsing test.."));
+
+    pjsip_cfg()->endpt.lazy_hdr_parse = PJ_TRUE;
+
+    for (i=0; i<PJ_ARRAY_SIZE(test_array); ++i) {
+	pool = pjsip_endpt_create_pool(endpt, NULL, POOL_SIZE, POOL_SIZE);
+	rc = test_entry( pool, &test_array[i] );
+	pjsip_endpt_release_pool(endpt, pool);
+
+	if (rc != PJ_SUCCESS)
+	    goto on_return;
+    }
+
+    pool = pjsip_endpt_create_pool(endpt, NULL, PJSIP_MAX_PKT_LEN,
+				   POOL_SIZE);
+    msg = pjsip_parse_msg(pool, entry->msg, pj_ansi_strlen(entry->msg), 
+			  NULL);
+    if (!msg) {
+	rc = -200;
+	goto on_release;
+    }
+
+    /* The first Via must have been parsed, the next ones must not. */
+    via = (pjsip_via_hdr*)msg->hdr.next;
+    if (via->type != PJSIP_H_VIA || pjsip_hdr_is_lazy(via)) {
+	rc = -210;
+	goto on_release;
+    }
+    for (hdr=msg->hdr.next, lazy_cnt=0; hdr!=&msg->hdr; hdr=hdr->next) {
+	if (pjsip_hdr_is_lazy(hdr))
+	    ++lazy_cnt;
+    }
+    if (!pjsip_hdr_is_lazy(via->next) || lazy_cnt != 4) {
+	PJ_LOG(3,(THIS_FILE, "   error: %d lazy headers", lazy_cnt));
+	rc = -220;
+	goto on_release;
+    }
+
+    /* Lookup by type parses the header in place. */
+    via = (pjsip_via_hdr*)pjsip_msg_find_hdr(msg, PJSIP_H_VIA, via->next);
+    if (!via || pjsip_hdr_is_lazy(via) || 
+	pj_strcmp2(&via->sent_by.host, "proxy1.atlanta.com") != 0 ||
+	(pjsip_hdr*)via->prev != msg->hdr.next)
+    {
+	rc = -230;
+	goto on_release;
+    }
+
+    /* So does lookup by name. */
+    allow = (pjsip_allow_hdr*)pjsip_msg_find_hdr_by_name(msg, &STR_ALLOW,
+							 NULL);
+    if (!allow || allow->type != PJSIP_H_ALLOW || allow->count != 12) {
+	rc = -240;
+	goto on_release;
+    }
+    if (pjsip_msg_find_hdr(msg, PJSIP_H_ALLOW, NULL) != allow) {
+	rc = -250;
+	goto on_release;
+    }
+
+    /* Unregistered headers stay as generic string headers. */
+    hdr = (pjsip_hdr*)pjsip_msg_find_hdr_by_name(msg, &STR_SE, NULL);
+    if (!hdr || pjsip_hdr_is_lazy(hdr) || 
+	pj_strcmp2(&((pjsip_generic_string_hdr*)hdr)->hvalue,
+		   "1800;refresher=uac") != 0)
+    {
+	rc = -260;
+	goto on_release;
+    }
+
+    /* All other headers can be parsed at once. */
+    pjsip_msg_parse_lazy_hdrs(msg);
+    for (hdr=msg->hdr.next; hdr!=&msg->hdr; hdr=hdr->next) {
+	if (pjsip_hdr_is_lazy(hdr)) {
+	    rc = -270;
+	    goto on_release;
+	}
+    }
+    if (pjsip_msg_find_hdr(msg, PJSIP_H_ACCEPT, NULL) == NULL) {
+	rc = -280;
+	goto on_release;
+    }
+
+on_release:
+    pjsip_endpt_release_pool(endpt, pool);
+on_return:
+    pjsip_cfg()->endpt.lazy_hdr_parse = saved_lazy;
+    return rc;
+}
+
 
 #if INCLUDE_BENCHMARKS
 static int msg_benchmark(unsigned *p_detect, unsigned *p_parse, 
@@ -919,6 +1112,82 @@ static int msg_benchmark(unsigned *p_detect, unsigned *p_parse,
     *p_print = (unsigned)avg_print;
     return status;
 }
+
+/* Convert the total parse time to msg parsing/sec. */
+static unsigned parse_per_sec(const char *mode, const pj_timestamp *time,
+			      pj_highprec_t len)
+{
+    pj_timestamp zero;
+    pj_time_val elapsed;
+    pj_highprec_t avg_parse;
+
+    zero.u64 = 0;
+    elapsed = pj_elapsed_time(&zero, time);
+    avg_parse = pj_elapsed_usec(&zero, time);
+    pj_highprec_mul(avg_parse, AVERAGE_MSG_LEN);
+    pj_highprec_div(avg_parse, len);
+    avg_parse = 1000000 / avg_parse;
+
+    PJ_LOG(3,(THIS_FILE, 
+	      "    %s parsing: %d.%03ds (avg=%d msg parsing/sec)", 
+	      mode, elapsed.sec, elapsed.msec, (unsigned)avg_parse));
+
+    return (unsigned)avg_parse;
+}
+
+/* Parse only benchmark of the mixed messages with full and lazy header
+ * parsing. Each message is parsed in both modes in turn, so that both
+ * get the same share of CPU frequency changes and other noise.
+ */
+static int parse_benchmark(unsigned *p_full, unsigned *p_lazy)
+{
+    pj_bool_t saved_lazy = pjsip_cfg()->endpt.lazy_hdr_parse;
+    pj_timestamp time[2];
+    pj_highprec_t len;
+    pj_pool_t *pool;
+    int i, loop, lazy;
+    pj_status_t status = PJ_SUCCESS;
+
+    pj_bzero(&var, sizeof(var));
+    pj_bzero(time, sizeof(time));
+    var.flag = FLAG_PARSE_ONLY;
+
+    for (loop=0; loop<LOOP && status==PJ_SUCCESS; ++loop) {
+	for (i=0; i<(int)PJ_ARRAY_SIZE(mixed_array); ++i) {
+	    for (lazy=0; lazy<2; ++lazy) {
+		pjsip_cfg()->endpt.lazy_hdr_parse = lazy;
+		var.parse_time.u64 = 0;
+
+		pool = pjsip_endpt_create_pool(endpt, NULL, PJSIP_MAX_PKT_LEN,
+					       POOL_SIZE);
+		status = test_entry( pool, &mixed_array[i] );
+		pjsip_endpt_release_pool(endpt, pool);
+
+		if (status != PJ_SUCCESS)
+		    break;
+
+		pj_add_timestamp(&time[lazy], &var.parse_time);
+	    }
+	    if (status != PJ_SUCCESS)
+		break;
+	}
+    }
+
+    pjsip_cfg()->endpt.lazy_hdr_parse = saved_lazy;
+    var.flag = 0;
+
+    if (status != PJ_SUCCESS)
+	return status;
+
+    /* Both modes parsed the same messages */
+    len = var.parse_len;
+    pj_highprec_div(len, 2);
+
+    *p_full = parse_per_sec("full", &time[0], len);
+    *p_lazy = parse_per_sec("lazy", &time[1], len);
+
+    return PJ_SUCCESS;
+}
 #endif	/* INCLUDE_BENCHMARKS */
 
 /*****************************************************************************/
@@ -1994,7 +2263,7 @@ int msg_test(void)
 	unsigned parse;
 	unsigned print;
     } run[COUNT];
-    unsigned i, max, avg_len;
+    unsigned i, max, avg_len, full;
     char desc[250];
     pj_status_t status;
 
@@ -2006,6 +2275,10 @@ int msg_test(void)
     if (status != PJ_SUCCESS)
 	return status;
 
+    status = lazy_test();
+    if (status != PJ_SUCCESS)
+	return status;
+
 #if INCLUDE_BENCHMARKS
     for (i=0; i<COUNT; ++i) {
 	PJ_LOG(3,(THIS_FILE, "  benchmarking (%d of %d)..", i+1, COUNT));
@@ -2074,6 +2347,26 @@ int msg_test(void)
 		"SIP messages printed per second). "
 		"The value is derived from msg-print-per-sec above.");
 
+    /* Full vs lazy parsing of typical messages */
+    PJ_LOG(3,(THIS_FILE, "  benchmarking lazy header parsing.."));
+    status = parse_benchmark(&full, &max);
+    if (status != PJ_SUCCESS)
+	return status;
+
+    pj_ansi_sprintf(desc, "Number of typical SIP messages "
+			  "can be <b>parsed</b> by <tt>pjsip_parse_msg()</tt> "
+			  "per second with full header parsing (tested "
+			  "with %d message sets)", 
+			  (int)PJ_ARRAY_SIZE(mixed_array));
+    report_ival("msg-full-parse-per-sec", full, "msg/sec", desc);
+
+    pj_ansi_sprintf(desc, "Number of typical SIP messages "
+			  "can be <b>parsed</b> by <tt>pjsip_parse_msg()</tt> "
+			  "per second with lazy header parsing (tested "
+			  "with %d message sets)", 
+			  (int)PJ_ARRAY_SIZE(mixed_array));
+    report_ival("msg-lazy-parse-per-sec", max, "msg/sec", desc);
+
 #endif	/* INCLUDE_BENCHMARKS */
 
     return PJ_SUCCESS;
@@ -29,6 +29,211 @@
  * TCP transport test.
  */
 #if PJ_HAS_TCP
+
+/*
+ * Many connections, most of them idle. Only connections with unprocessed
+ * data may hold receive buffers.
+ */
+#ifndef IDLE_CONN_CNT
+#   define IDLE_CONN_CNT    32
+#endif
+#define IDLE_ROUNDS	    20
+
+static pj_bool_t idle_on_rx_request(pjsip_rx_data *rdata);
+
+static pjsip_module mod_idle = 
+{
+    NULL, NULL,				/* prev and next	*/
+    { "mod-idle-test", 13},		/* Name.		*/
+    -1,					/* Id			*/
+    PJSIP_MOD_PRIORITY_TSX_LAYER-2,	/* Priority		*/
+    NULL,				/* load()		*/
+    NULL,				/* start()		*/
+    NULL,				/* stop()		*/
+    NULL,				/* unload()		*/
+    &idle_on_rx_request,		/* on_rx_request()	*/
+    NULL,				/* on_rx_response()	*/
+    NULL,				/* tsx_handler()	*/
+};
+
+static unsigned idle_rx_cnt;
+
+static pj_bool_t idle_on_rx_request(pjsip_rx_data *rdata)
+{
+    PJ_UNUSED_ARG(rdata);
+    ++idle_rx_cnt;
+    return PJ_TRUE;
+}
+
+/* Handle events until there is nothing more to do */
+static void idle_flush(void)
+{
+    unsigned cnt;
+
+    do {
+	pj_time_val delay = {0, 1};
+	cnt = 0;
+	pjsip_endpt_handle_events2(endpt, &delay, &cnt);
+    } while (cnt != 0);
+}
+
+static int send_all(pj_sock_t sock[], const char *data, pj_ssize_t len)
+{
+    unsigned i;
+
+    for (i=0; i<IDLE_CONN_CNT; ++i) {
+	pj_ssize_t sent = len;
+
+	if (pj_sock_send(sock[i], data, &sent, 0) != PJ_SUCCESS ||
+	    sent != len)
+	{
+	    return -1;
+	}
+    }
+
+    return 0;
+}
+
+static int idle_conn_test(const pj_sockaddr_in *addr)
+{
+    static const char msg[] =
+	"OPTIONS sip:bob@127.0.0.1 SIP/2.0\r\n"
+	"Via: SIP/2.0/TCP 127.0.0.1:5060;branch=z9hG4bKidletest\r\n"
+	"From: <sip:alice@127.0.0.1>;tag=idletest\r\n"
+	"To: <sip:bob@127.0.0.1>\r\n"
+	"Call-ID: idle-conn-test\r\n"
+	"CSeq: 1 OPTIONS\r\n"
+	"Max-Forwards: 70\r\n"
+	"Content-Length: 0\r\n\r\n";
+    enum { MSG_LEN = sizeof(msg) - 1, HALF_LEN = MSG_LEN / 2 };
+    pjsip_tpmgr *mgr = pjsip_endpt_get_tpmgr(endpt);
+    pj_caching_pool *cp;
+    pj_pool_t *pool;
+    pj_sock_t sock[IDLE_CONN_CNT];
+    pjsip_rx_slab_stat stat0, stat;
+    pj_size_t used0;
+    pj_timestamp t0, t1;
+    unsigned i, in_use, expected, msec;
+    int rc = 0;
+
+    PJ_LOG(3,(THIS_FILE, "  %d idle connections test...", IDLE_CONN_CNT));
+
+    for (i=0; i<IDLE_CONN_CNT; ++i)
+	sock[i] = PJ_INVALID_SOCKET;
+
+    if (pjsip_endpt_register_module(endpt, &mod_idle) != PJ_SUCCESS)
+	return -200;
+    idle_rx_cnt = 0;
+
+    /* Test pool factory is a caching pool */
+    pool = pjsip_endpt_create_pool(endpt, "idle", 512, 512);
+    cp = (pj_caching_pool*) pool->factory;
+    pjsip_endpt_release_pool(endpt, pool);
+
+    idle_flush();
+    pjsip_tpmgr_get_rx_slab_stat(mgr, &stat0);
+    used0 = cp->used_size;
+
+    for (i=0; i<IDLE_CONN_CNT; ++i) {
+	if (pj_sock_socket(pj_AF_INET(), pj_SOCK_STREAM(), 0,
+			   &sock[i]) != PJ_SUCCESS ||
+	    pj_sock_connect(sock[i], addr, sizeof(*addr)) != PJ_SUCCESS)
+	{
+	    rc = -210;
+	    goto on_return;
+	}
+	idle_flush();
+    }
+
+    PJ_LOG(3,(THIS_FILE, "   memory used by idle connections: %d bytes each",
+	      (int)((cp->used_size - used0) / IDLE_CONN_CNT)));
+
+    /* Connections with partial message hold receive buffer */
+    if (send_all(sock, msg, HALF_LEN) != 0) {
+	rc = -220;
+	goto on_return;
+    }
+    idle_flush();
+
+    expected = IDLE_CONN_CNT;
+    if (PJSIP_RX_SLAB_MAX_CNT &&
+	expected > PJSIP_RX_SLAB_MAX_CNT - stat0.in_use)
+    {
+	expected = PJSIP_RX_SLAB_MAX_CNT - stat0.in_use;
+    }
+
+    pjsip_tpmgr_get_rx_slab_stat(mgr, &stat);
+    in_use = stat.in_use - stat0.in_use;
+    if (in_use != expected) {
+	PJ_LOG(3,(THIS_FILE, "   error: %d buffers in use, expecting %d",
+		  in_use, expected));
+	rc = -230;
+	goto on_return;
+    }
+
+    /* Connections that couldn't get a buffer have been closed */
+    if (expected != IDLE_CONN_CNT) {
+	PJ_LOG(3,(THIS_FILE, "   buffer limit reached, skipping the rest"));
+	goto on_return;
+    }
+
+    /* ..and give it back once the message is complete */
+    if (send_all(sock, msg+HALF_LEN, MSG_LEN-HALF_LEN) != 0) {
+	rc = -240;
+	goto on_return;
+    }
+    idle_flush();
+
+    pjsip_tpmgr_get_rx_slab_stat(mgr, &stat);
+    if (idle_rx_cnt != IDLE_CONN_CNT || stat.in_use != stat0.in_use) {
+	PJ_LOG(3,(THIS_FILE, "   error: %d messages received, %d buffers "
+		  "in use", idle_rx_cnt, stat.in_use - stat0.in_use));
+	rc = -250;
+	goto on_return;
+    }
+
+    /* Throughput */
+    idle_rx_cnt = 0;
+    pj_get_timestamp(&t0);
+    for (i=0; i<IDLE_ROUNDS; ++i) {
+	if (send_all(sock, msg, MSG_LEN) != 0) {
+	    rc = -260;
+	    goto on_return;
+	}
+    }
+    do {
+	pj_time_val delay = {0, 10};
+
+	pjsip_endpt_handle_events(endpt, &delay);
+	pj_get_timestamp(&t1);
+	msec = pj_elapsed_msec(&t0, &t1);
+    } while (idle_rx_cnt < IDLE_ROUNDS * IDLE_CONN_CNT && msec < 5000);
+
+    if (idle_rx_cnt != IDLE_ROUNDS * IDLE_CONN_CNT) {
+	PJ_LOG(3,(THIS_FILE, "   error: %d of %d messages received",
+		  idle_rx_cnt, IDLE_ROUNDS * IDLE_CONN_CNT));
+	rc = -270;
+	goto on_return;
+    }
+
+    if (msec == 0)
+	msec = 1;
+
+    pjsip_tpmgr_get_rx_slab_stat(mgr, &stat);
+    PJ_LOG(3,(THIS_FILE, "   %d messages/sec, %d receive buffers allocated",
+	      idle_rx_cnt * 1000 / msec, stat.total));
+
+on_return:
+    for (i=0; i<IDLE_CONN_CNT; ++i) {
+	if (sock[i] != PJ_INVALID_SOCKET)
+	    pj_sock_close(sock[i]);
+    }
+    idle_flush();
+    pjsip_endpt_unregister_module(endpt, &mod_idle);
+
+    return rc;
+}
+
 int transport_tcp_test(void)
 {
     enum { SEND_RECV_LOOP = 8 };
@@ -90,6 +295,13 @@ int transport_tcp_test(void)
     if (transport_load_test(url) != 0)
 	return -60;
 
+    /* Many connections test */
+    status = idle_conn_test(&rem_addr);
+    if (status != 0) {
+	pjsip_transport_dec_ref(tcp);
+	return status;
+    }
+
     /* Basic transport's send/receive loopback test. */
     for (i=0; i<SEND_RECV_LOOP; ++i) {
 	status = transport_send_recv_test(PJSIP_TRANSPORT_TCP, tcp, url, &rtt[i]);
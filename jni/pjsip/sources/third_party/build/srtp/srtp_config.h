@@ -211,6 +211,13 @@
 /* Define to 1 if you have the ANSI C header files. */
 //#define STDC_HEADERS 1
 
+/* Use the SHA-1 compression function of pjlib-util, which uses the SHA1
+ * instructions of the CPU when there are some, for HMAC-SHA1.
+ */
+#ifndef SRTP_USE_PJLIB_SHA1
+#   define SRTP_USE_PJLIB_SHA1	    1
+#endif
+
 /* Endianness would have been set by pjlib. */
 /* #undef WORDS_BIGENDIAN */
 
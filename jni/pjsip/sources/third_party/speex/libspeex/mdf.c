@@ -76,6 +76,10 @@
 #include "math_approx.h"
 #include "os_support.h"
 
+#ifdef SPEEX_HAVE_PJMEDIA_DSP
+#include <pjmedia/dsp.h>
+#endif
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
@@ -294,6 +298,9 @@ static inline void spectral_mul_accum16(const spx_word16_t *X, const spx_word16_
 #else
 static inline void spectral_mul_accum(const spx_word16_t *X, const spx_word32_t *Y, spx_word16_t *acc, int N, int M)
 {
+#ifdef SPEEX_HAVE_PJMEDIA_DSP
+   pjmedia_dsp_spectrum_mac_f(X, Y, acc, N, M);
+#else
    int i,j;
    for (i=0;i<N;i++)
       acc[i] = 0;
@@ -309,6 +316,7 @@ static inline void spectral_mul_accum(const spx_word16_t *X, const spx_word32_t
       X += N;
       Y += N;
    }
+#endif
 }
 #define spectral_mul_accum16 spectral_mul_accum
 #endif
@@ -47,6 +47,10 @@
 
 #include "sha1.h"
 
+#if defined(SRTP_USE_PJLIB_SHA1) && SRTP_USE_PJLIB_SHA1
+#include <pjlib-util/sha1.h>
+#endif
+
 debug_module_t mod_sha1 = {
   0,                 /* debugging is off by default */
   "sha-1"            /* printable module name       */
@@ -95,6 +99,21 @@ sha1(const uint8_t *msg,  int octets_in_msg, uint32_t hash_value[5]) {
  *  (crypto/cipher/seal.c)
  */
 
+#if defined(SRTP_USE_PJLIB_SHA1) && SRTP_USE_PJLIB_SHA1
+
+/*
+ * pjlib-util does the compression function, with the SHA1 instructions
+ * of the CPU if it has them. Whole blocks are hashed straight from the
+ * message and the padding goes through the same function.
+ */
+
+void
+sha1_core(const uint32_t M[16], uint32_t hash_value[5]) {
+  pj_sha1_transform(hash_value, (const uint8_t *)M, 1);
+}
+
+#else	/* SRTP_USE_PJLIB_SHA1 */
+
 void
 sha1_core(const uint32_t M[16], uint32_t hash_value[5]) {
   uint32_t H0;
@@ -182,6 +201,8 @@ sha1_core(const uint32_t M[16], uint32_t hash_value[5]) {
   return;
 }
 
+#endif	/* SRTP_USE_PJLIB_SHA1 */
+
 void
 sha1_init(sha1_ctx_t *ctx) {
  
@@ -200,6 +221,99 @@ sha1_init(sha1_ctx_t *ctx) {
 
 }
 
+#if defined(SRTP_USE_PJLIB_SHA1) && SRTP_USE_PJLIB_SHA1
+
+void
+sha1_update(sha1_ctx_t *ctx, const uint8_t *msg, int octets_in_msg) {
+  uint8_t *buf = (uint8_t *)ctx->M;
+  int n;
+
+  /* update message bit-count */
+  ctx->num_bits_in_msg += octets_in_msg * 8;
+
+  /* top up a partial block first */
+  if (ctx->octets_in_buffer > 0) {
+    n = 64 - ctx->octets_in_buffer;
+    if (n > octets_in_msg)
+      n = octets_in_msg;
+    memcpy(buf + ctx->octets_in_buffer, msg, n);
+    ctx->octets_in_buffer += n;
+    msg += n;
+    octets_in_msg -= n;
+
+    if (ctx->octets_in_buffer < 64)
+      return;
+
+    debug_print(mod_sha1, "(update) running sha1_core()", NULL);
+
+    pj_sha1_transform(ctx->H, buf, 1);
+    ctx->octets_in_buffer = 0;
+  }
+
+  /* then the whole blocks, without copying them */
+  if (octets_in_msg >= 64) {
+    n = octets_in_msg & ~63;
+
+    debug_print(mod_sha1, "(update) running sha1_core()", NULL);
+
+    pj_sha1_transform(ctx->H, msg, n / 64);
+    msg += n;
+    octets_in_msg -= n;
+  }
+
+  memcpy(buf, msg, octets_in_msg);
+  ctx->octets_in_buffer = octets_in_msg;
+}
+
+/*
+ * sha1_final(ctx, output) computes the result for ctx and copies it
+ * into the twenty octets located at *output
+ */
+
+void
+sha1_final(sha1_ctx_t *ctx, uint32_t *output) {
+  uint8_t *buf = (uint8_t *)ctx->M;
+  int n = ctx->octets_in_buffer;
+
+  /* set the high bit of the octet immediately following the message */
+  buf[n++] = 0x80;
+
+  /* if there's no room for the bit-length, it goes in one more block */
+  if (n > 56) {
+    memset(buf + n, 0, 64 - n);
+
+    debug_print(mod_sha1, "(final) running sha1_core() again", NULL);
+
+    pj_sha1_transform(ctx->H, buf, 1);
+    n = 0;
+  }
+  memset(buf + n, 0, 60 - n);
+
+  /* the last word is the bit-length of the message */
+  buf[60] = (uint8_t)(ctx->num_bits_in_msg >> 24);
+  buf[61] = (uint8_t)(ctx->num_bits_in_msg >> 16);
+  buf[62] = (uint8_t)(ctx->num_bits_in_msg >> 8);
+  buf[63] = (uint8_t)(ctx->num_bits_in_msg);
+
+  debug_print(mod_sha1, "(final) running sha1_core()", NULL);
+
+  pj_sha1_transform(ctx->H, buf, 1);
+
+  /* copy result into output buffer */
+  output[0] = be32_to_cpu(ctx->H[0]);
+  output[1] = be32_to_cpu(ctx->H[1]);
+  output[2] = be32_to_cpu(ctx->H[2]);
+  output[3] = be32_to_cpu(ctx->H[3]);
+  output[4] = be32_to_cpu(ctx->H[4]);
+
+  /* indicate that message buffer in context is empty */
+  ctx->octets_in_buffer = 0;
+
+  return;
+}
+
+#else	/* SRTP_USE_PJLIB_SHA1 */
+
 void
 sha1_update(sha1_ctx_t *ctx, const uint8_t *msg, int octets_in_msg) {
   int i;
@@ -400,5 +514,4 @@ sha1_final(sha1_ctx_t *ctx, uint32_t *output) {
   return;
 }
 
-
-
+#endif	/* SRTP_USE_PJLIB_SHA1 */
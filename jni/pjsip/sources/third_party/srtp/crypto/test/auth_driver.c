@@ -54,6 +54,7 @@
 #define PRINT_DEBUG_DATA 0
 
 extern auth_type_t tmmhv2;
+extern auth_type_t hmac;
 
 const uint16_t msg0[9] = {
   0x6015, 0xf141, 0x5ba1, 0x29a0, 0xf604, 0xd1c, 0x2d9, 0xaa8a, 0x7931
@@ -153,6 +154,33 @@ main (int argc, char *argv[]) {
       printf("error deallocating auth function\n");
       exit(status);
     }
+
+    /* HMAC-SHA1 timing test, with the key and tag lengths of SRTP */
+    status = auth_type_alloc(&hmac, &a, 20, 10);
+    if (status) {
+      fprintf(stderr, "can't allocate hmac\n");
+      exit(status);
+    }
+    status = auth_init(a, (uint8_t *)key1);
+    if (status) {
+      printf("error initializaing auth function\n");
+      exit(status);
+    }
+
+    printf("timing %s (tag length %d)\n", 
+	   hmac.description, auth_get_tag_length(a));
+    /* 172 octets is an RTP packet with 20ms of G.711 */
+    printf("msg len: %d\tgigabits per second: %f\n",
+	   172, auth_bits_per_second(a, 172) / 1E9);
+    for (i=8; i <= MAX_MSG_LEN; i *= 2)
+      printf("msg len: %d\tgigabits per second: %f\n",
+	     i, auth_bits_per_second(a, i) / 1E9);
+
+    status = auth_dealloc(a);
+    if (status) {
+      printf("error deallocating auth function\n");
+      exit(status);
+    }
     
   }
 
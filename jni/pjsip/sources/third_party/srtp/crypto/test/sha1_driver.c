@@ -44,6 +44,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "sha1.h"
 
 #define SHA_PASS 0
@@ -515,9 +516,36 @@ sha1_validate(void) {
 
 
 
+#define NUM_TRIALS 100000
+
+#include <time.h>
+
+double
+sha1_bits_per_second(int msg_len_octets) {
+  uint8_t msg[MAX_HASH_DATA_LEN];
+  uint32_t hash_value[5];
+  sha1_ctx_t ctx;
+  clock_t timer;
+  int i;
+
+  for (i=0; i < msg_len_octets; i++)
+    msg[i] = (uint8_t) i;
+
+  timer = clock();
+  for (i=0; i < NUM_TRIALS; i++) {
+    sha1_init(&ctx);
+    sha1_update(&ctx, msg, msg_len_octets);
+    sha1_final(&ctx, hash_value);
+  }
+  timer = clock() - timer;
+
+  return (double) NUM_TRIALS * 8 * msg_len_octets * CLOCKS_PER_SEC / timer;
+}
+
 int
-main (void) {
+main (int argc, char *argv[]) {
   err_status_t err;
+  int i;
 
   printf("sha1 test driver\n");
 
@@ -528,6 +556,13 @@ main (void) {
   }
   printf("SHA1 passed validation tests\n");
 
+  /* timing test with -t */
+  if (argc > 1 && strcmp(argv[1], "-t") == 0) {
+    for (i=16; i <= MAX_HASH_DATA_LEN; i *= 2)
+      printf("msg len: %d\tgigabits per second: %f\n",
+	     i, sha1_bits_per_second(i) / 1E9);
+  }
+
   return 0;
 
 }
@@ -55,6 +55,9 @@ include $(WEBRTC_PATH)/modules/audio_coding/codecs/isac/main/source/Android.mk
 ### NOISE SUPPR ###
 include $(WEBRTC_PATH)/modules/audio_processing/ns/Android.mk
 
+### GAIN CONTROL ###
+include $(WEBRTC_PATH)/modules/audio_processing/agc/Android.mk
+
 # WARN ABOUT DUPLICATE CODEC !
 ifeq ($(MY_USE_ILBC),1)
 $(warning MY_USE_ILBC and MY_USE_WEBRTC will both produce iLBC codec)
@@ -57,6 +57,15 @@ LOCAL_C_INCLUDES := \
     $(LOCAL_PATH)/include \
     $(LOCAL_PATH)/../.. 
 
+# Complex FFT from the pjmedia DSP kernels
+MY_PJ_DIR := $(LOCAL_PATH)/../../../../pjsip/sources
+LOCAL_CFLAGS += \
+    $(MY_PJSIP_FLAGS) \
+    -DWEBRTC_HAVE_PJMEDIA_DSP
+LOCAL_C_INCLUDES += \
+    $(MY_PJ_DIR)/pjlib/include \
+    $(MY_PJ_DIR)/pjmedia/include
+
 ifeq ($(ARCH_ARM_HAVE_ARMV7A),true)
 LOCAL_SRC_FILES += \
     filter_ar_fast_q12_armv7.s
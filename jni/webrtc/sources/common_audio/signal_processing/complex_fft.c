@@ -17,6 +17,10 @@
 
 #include "signal_processing_library.h"
 
+#ifdef WEBRTC_HAVE_PJMEDIA_DSP
+#include <pjmedia/dsp.h>
+#endif
+
 #define CFFTSFT 14
 #define CFFTRND 1
 #define CFFTRND2 16384
@@ -24,6 +28,7 @@
 #define CIFFTSFT 14
 #define CIFFTRND 1
 
+#ifndef WEBRTC_HAVE_PJMEDIA_DSP
 static const WebRtc_Word16 kSinTable1024[] = {
       0,    201,    402,    603,    804,   1005,   1206,   1406,
    1607,   1808,   2009,   2209,   2410,   2610,   2811,   3011,
@@ -155,9 +160,13 @@ static const WebRtc_Word16 kSinTable1024[] = {
   -3211,  -3011,  -2811,  -2610,  -2410,  -2209,  -2009,  -1808,
   -1607,  -1406,  -1206,  -1005,   -804,   -603,   -402,   -201
 };
+#endif
 
 int WebRtcSpl_ComplexFFT(WebRtc_Word16 frfi[], int stages, int mode)
 {
+#ifdef WEBRTC_HAVE_PJMEDIA_DSP
+    return pjmedia_dsp_cfft16(frfi, stages, mode != 0);
+#else
     int i, j, l, k, istep, n, m;
     WebRtc_Word16 wr, wi;
     WebRtc_Word32 tr32, ti32, qr32, qi32;
@@ -282,10 +291,14 @@ int WebRtcSpl_ComplexFFT(WebRtc_Word16 frfi[], int stages, int mode)
         }
     }
     return 0;
+#endif
 }
 
 int WebRtcSpl_ComplexIFFT(WebRtc_Word16 frfi[], int stages, int mode)
 {
+#ifdef WEBRTC_HAVE_PJMEDIA_DSP
+    return pjmedia_dsp_cifft16(frfi, stages, mode != 0);
+#else
     int i, j, l, k, istep, n, m, scale, shift;
     WebRtc_Word16 wr, wi;
     WebRtc_Word32 tr32, ti32, qr32, qi32;
@@ -422,4 +435,5 @@ int WebRtcSpl_ComplexIFFT(WebRtc_Word16 frfi[], int stages, int mode)
         l = istep;
     }
     return scale;
+#endif
 }
@@ -196,14 +196,12 @@ int32_t zsrtp_unprotect(ZsrtpContext* ctx, uint8_t* buffer, int32_t length,
     uint64_t guessedIndex = pcc->guessIndex(seqnum);
 
     uint32_t guessedRoc = guessedIndex >> 16;
-    uint8_t* mac = new uint8_t[pcc->getTagLength()];
+    uint8_t mac[20];
 
     pcc->srtpAuthenticate(buffer, length, guessedRoc, mac);
     if (pj_memcmp(tag, mac, pcc->getTagLength()) != 0) {
-        delete[] mac;
         return -1;
     }
-    delete[] mac;
 
     /* Decrypt the content */
     ssrc = hdr->ssrc;
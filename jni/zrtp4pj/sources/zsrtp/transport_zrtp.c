@@ -35,6 +35,20 @@
 
 #define THIS_FILE "transport_zrtp.c"
 
+/* Largest trailer appended by SRTP/SRTCP protect: the 4 bytes SRTCP index
+ * and an 80 bits authentication tag (no MKI).
+ */
+#define MAX_SRTP_TRAILER_LEN    14
+
+/* The packet counters are only reported in level 4 logs, don't update
+ * them on the media path if those logs are compiled out.
+ */
+#if PJ_LOG_MAX_LEVEL >= 4
+#   define COUNT_PACKET(cnt)    ++(cnt)
+#else
+#   define COUNT_PACKET(cnt)
+#endif
+
 /* Transport functions prototypes */
 static pj_status_t transport_get_info(pjmedia_transport *tp,
                                       pjmedia_transport_info *info);
@@ -82,6 +96,14 @@ static pj_status_t transport_simulate_lost(pjmedia_transport *tp,
         pjmedia_dir dir,
         unsigned pct_lost);
 static pj_status_t transport_destroy(pjmedia_transport *tp);
+static pj_status_t transport_send_rtp_inplace(pjmedia_transport *tp,
+                                              void *pkt,
+                                              pj_size_t size,
+                                              pj_size_t tailroom);
+static pj_status_t transport_send_rtcp_inplace(pjmedia_transport *tp,
+                                               void *pkt,
+                                               pj_size_t size,
+                                               pj_size_t tailroom);
 
 
 /* The transport operations */
@@ -98,7 +120,9 @@ static struct pjmedia_transport_op tp_zrtp_op =
     &transport_media_start,
     &transport_media_stop,
     &transport_simulate_lost,
-    &transport_destroy
+    &transport_destroy,
+    &transport_send_rtp_inplace,
+    &transport_send_rtcp_inplace
 };
 
 /* The transport zrtp instance */
@@ -931,6 +955,7 @@ static pj_status_t transport_get_info(pjmedia_transport *tp,
 static void transport_rtp_cb(void *user_data, void *pkt, pj_ssize_t size)
 {
     struct tp_zrtp *zrtp = (struct tp_zrtp*)user_data;
+    ZsrtpContext* srtp = zrtp->srtpReceive;
 
     pj_uint8_t* buffer = (pj_uint8_t*)pkt;
     int32_t newLen = 0;
@@ -941,36 +966,36 @@ static void transport_rtp_cb(void *user_data, void *pkt, pj_ssize_t size)
     // check if this could be a real RTP/SRTP packet.
     if ((*buffer & 0xf0) != 0x10)
     {
-        //  Could be real RTP, check if we are in secure mode
-        if (zrtp->srtpReceive == NULL)
+        //  Could be real RTP, check if we are in secure mode. Once the
+        //  keys are established ZRTP is running, so only unprotect.
+        if (srtp != NULL)
         {
-            zrtp->stream_rtp_cb(zrtp->stream_user_data, pkt, size);
-        }
-        else
-        {
-            rc = zsrtp_unprotect(zrtp->srtpReceive, pkt, size, &newLen);
+            rc = zsrtp_unprotect(srtp, pkt, size, &newLen);
             if (rc == 1)
             {
-                zrtp->unprotect++;
+                COUNT_PACKET(zrtp->unprotect);
                 zrtp->stream_rtp_cb(zrtp->stream_user_data, pkt,
                                     newLen);
-                zrtp->unprotect_err = 0;
+                if (zrtp->unprotect_err)
+                    zrtp->unprotect_err = 0;
+                return;
             }
-            else
-            {
-                if (rc == -1) {
-                    zrtp->userCallback->zrtp_showMessage(zrtp->userCallback->userData,
-                                                         zrtp_Warning, 
-                                                         zrtp_WarningSRTPauthError);
-                }
-                else {
-                    zrtp->userCallback->zrtp_showMessage(zrtp->userCallback->userData,
-                                                         zrtp_Warning,
-                                                         zrtp_WarningSRTPreplayError);
-                }
-                zrtp->unprotect_err = rc;
+            if (rc == -1) {
+                zrtp->userCallback->zrtp_showMessage(zrtp->userCallback->userData,
+                                                     zrtp_Warning, 
+                                                     zrtp_WarningSRTPauthError);
             }
+            else {
+                zrtp->userCallback->zrtp_showMessage(zrtp->userCallback->userData,
+                                                     zrtp_Warning,
+                                                     zrtp_WarningSRTPreplayError);
+            }
+            zrtp->unprotect_err = rc;
+            return;
         }
+
+        zrtp->stream_rtp_cb(zrtp->stream_user_data, pkt, size);
+
         if (!zrtp->started && zrtp->enableZrtp)
             pjmedia_transport_zrtp_startZrtp((pjmedia_transport *)zrtp);
 
@@ -1026,28 +1051,19 @@ static void transport_rtp_cb(void *user_data, void *pkt, pj_ssize_t size)
 static void transport_rtcp_cb(void *user_data, void *pkt, pj_ssize_t size)
 {
     struct tp_zrtp *zrtp = (struct tp_zrtp*)user_data;
+    ZsrtpContextCtrl* srtcp = zrtp->srtcpReceive;
     int32_t newLen = 0;
-    pj_status_t rc = PJ_SUCCESS;
     
     pj_assert(zrtp && zrtp->stream_rtcp_cb);
     
-    if (zrtp->srtcpReceive == NULL)
+    if (srtcp == NULL)
     {
         zrtp->stream_rtcp_cb(zrtp->stream_user_data, pkt, size);
     }
-    else
+    else if (zsrtp_unprotectCtrl(srtcp, pkt, size, &newLen) == 1)
     {
-        rc = zsrtp_unprotectCtrl(zrtp->srtcpReceive, pkt, size, &newLen);
-
-        if (rc == 1)
-        {
-            /* Call stream's callback */
-            zrtp->stream_rtcp_cb(zrtp->stream_user_data, pkt, newLen);
-        }
-        else
-        {
-            // Testing: print some error output
-        }
+        /* Call stream's callback */
+        zrtp->stream_rtcp_cb(zrtp->stream_user_data, pkt, newLen);
     }
 }
 
@@ -1126,39 +1142,61 @@ static pj_status_t transport_send_rtp(pjmedia_transport *tp,
                                       pj_size_t size)
 {
     struct tp_zrtp *zrtp = (struct tp_zrtp*)tp;
+    ZsrtpContext* srtp = zrtp->srtpSend;
     pj_uint32_t* pui = (pj_uint32_t*)pkt;
     int32_t newLen = 0;
-    pj_status_t rc = PJ_SUCCESS;
 
     PJ_ASSERT_RETURN(tp && pkt, PJ_EINVAL);
 
-
-    if (!zrtp->started && zrtp->enableZrtp)
+    if (srtp == NULL)
     {
-        if (zrtp->localSSRC == 0)
-            zrtp->localSSRC = pj_ntohl(pui[2]);   /* Learn own SSRC before starting ZRTP */
-
-        pjmedia_transport_zrtp_startZrtp((pjmedia_transport *)zrtp);
-    }
+        if (!zrtp->started && zrtp->enableZrtp)
+        {
+            if (zrtp->localSSRC == 0)
+                zrtp->localSSRC = pj_ntohl(pui[2]);   /* Learn own SSRC before starting ZRTP */
 
-    if (zrtp->srtpSend == NULL)
-    {
+            pjmedia_transport_zrtp_startZrtp((pjmedia_transport *)zrtp);
+        }
         return pjmedia_transport_send_rtp(zrtp->slave_tp, pkt, size);
     }
-    else
-    {
-        if (size+80 > MAX_RTP_BUFFER_LEN)
-            return PJ_ETOOBIG;
 
-        pj_memcpy(zrtp->sendBuffer, pkt, size);
-        rc = zsrtp_protect(zrtp->srtpSend, zrtp->sendBuffer, size, &newLen);
-        zrtp->protect++;
+    if (size+80 > MAX_RTP_BUFFER_LEN)
+        return PJ_ETOOBIG;
 
-        if (rc == 1)
-            return pjmedia_transport_send_rtp(zrtp->slave_tp, zrtp->sendBuffer, newLen);
-        else
-            return PJ_EIGNORED;
-    }
+    pj_memcpy(zrtp->sendBuffer, pkt, size);
+    if (zsrtp_protect(srtp, zrtp->sendBuffer, size, &newLen) != 1)
+        return PJ_EIGNORED;
+    COUNT_PACKET(zrtp->protect);
+
+    return pjmedia_transport_send_rtp(zrtp->slave_tp, zrtp->sendBuffer, newLen);
+}
+
+
+/*
+ * send_rtp_inplace() is called to send RTP packet from a writable buffer.
+ * Once the keys are established the packet is protected in the caller's
+ * buffer, the SRTP trailer is appended in its tailroom.
+ */
+static pj_status_t transport_send_rtp_inplace(pjmedia_transport *tp,
+                                              void *pkt,
+                                              pj_size_t size,
+                                              pj_size_t tailroom)
+{
+    struct tp_zrtp *zrtp = (struct tp_zrtp*)tp;
+    ZsrtpContext* srtp = zrtp->srtpSend;
+    int32_t newLen = 0;
+
+    PJ_ASSERT_RETURN(tp && pkt, PJ_EINVAL);
+
+    if (srtp == NULL || tailroom < MAX_SRTP_TRAILER_LEN)
+        return transport_send_rtp(tp, pkt, size);
+
+    if (zsrtp_protect(srtp, (uint8_t*)pkt, size, &newLen) != 1)
+        return PJ_EIGNORED;
+    COUNT_PACKET(zrtp->protect);
+
+    return pjmedia_transport_send_rtp_inplace(zrtp->slave_tp, pkt, newLen,
+                                              tailroom - (newLen - size));
 }
 
 
@@ -1171,31 +1209,46 @@ static pj_status_t transport_send_rtcp(pjmedia_transport *tp,
                                        pj_size_t size)
 {
     struct tp_zrtp *zrtp = (struct tp_zrtp*)tp;
-    pj_status_t rc = PJ_SUCCESS;
+    ZsrtpContextCtrl* srtcp = zrtp->srtcpSend;
     int32_t newLen = 0;
     PJ_ASSERT_RETURN(tp, PJ_EINVAL);
 
-    /* You may do some processing to the RTCP packet here if you want. */
-    if (zrtp->srtcpSend == NULL)
-    {
+    if (srtcp == NULL)
         return pjmedia_transport_send_rtcp(zrtp->slave_tp, pkt, size);
-    }
-    else
-    {
-        if (size+80 > MAX_RTCP_BUFFER_LEN)
-            return PJ_ETOOBIG;
 
-        pj_memcpy(zrtp->sendBufferCtrl, pkt, size);
-        rc = zsrtp_protectCtrl(zrtp->srtcpSend, zrtp->sendBufferCtrl, size, &newLen);
+    if (size+80 > MAX_RTCP_BUFFER_LEN)
+        return PJ_ETOOBIG;
 
-        if (rc == 1)
-            return pjmedia_transport_send_rtcp(zrtp->slave_tp, zrtp->sendBufferCtrl, newLen);
-        else
-            return PJ_EIGNORED;
-    }
+    pj_memcpy(zrtp->sendBufferCtrl, pkt, size);
+    if (zsrtp_protectCtrl(srtcp, zrtp->sendBufferCtrl, size, &newLen) != 1)
+        return PJ_EIGNORED;
+
+    return pjmedia_transport_send_rtcp(zrtp->slave_tp, zrtp->sendBufferCtrl, newLen);
+}
+
+
+/*
+ * send_rtcp_inplace() is the RTCP variant of send_rtp_inplace().
+ */
+static pj_status_t transport_send_rtcp_inplace(pjmedia_transport *tp,
+                                               void *pkt,
+                                               pj_size_t size,
+                                               pj_size_t tailroom)
+{
+    struct tp_zrtp *zrtp = (struct tp_zrtp*)tp;
+    ZsrtpContextCtrl* srtcp = zrtp->srtcpSend;
+    int32_t newLen = 0;
+
+    PJ_ASSERT_RETURN(tp && pkt, PJ_EINVAL);
+
+    if (srtcp == NULL || tailroom < MAX_SRTP_TRAILER_LEN)
+        return transport_send_rtcp(tp, pkt, size);
+
+    if (zsrtp_protectCtrl(srtcp, (uint8_t*)pkt, size, &newLen) != 1)
+        return PJ_EIGNORED;
 
-    /* Send the packet using the slave transport */
-//    return pjmedia_transport_send_rtcp(zrtp->slave_tp, pkt, size);
+    return pjmedia_transport_send_rtcp_inplace(zrtp->slave_tp, pkt, newLen,
+                                               tailroom - (newLen - size));
 }
 
 